@@ -55,6 +55,8 @@ namespace pcpp
 		PacketLogModuleModbusTcpLayer, ///< ModbusTcpLayer module (Packet++)
 		PacketLogModuleTcpReassembly, ///< TcpReassembly module (Packet++)
 		PacketLogModuleIPReassembly, ///< IPReassembly module (Packet++)
+		PacketLogModuleRuleClassifier, ///< RuleClassifier module (Packet++)
+		PacketLogModuleMultiPatternMatcher, ///< MultiPatternMatcher module (Packet++)
 		PcapLogModuleWinPcapLiveDevice, ///< WinPcapLiveDevice module (Pcap++)
 		PcapLogModuleRemoteDevice, ///< WinPcapRemoteDevice module (Pcap++)
 		PcapLogModuleLiveDevice, ///< PcapLiveDevice module (Pcap++)
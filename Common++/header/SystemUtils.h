@@ -12,7 +12,18 @@
 
 /// @file
 
-#define MAX_NUM_OF_CORES 32
+/**
+ * The maximum number of cores supported by PcapPlusPlus (core IDs 0 to MAX_NUM_OF_CORES-1)
+ */
+#define MAX_NUM_OF_CORES 256
+
+// constexpr lets the SystemCores constants be initialized at compile time. Visual Studio supports it since VS2015
+#if __cplusplus > 199711L || _MSC_VER >= 1900
+#define PCPP_HAS_CORE_MASK_CONSTEXPR
+#define PCPP_CORE_MASK_CONSTEXPR constexpr
+#else
+#define PCPP_CORE_MASK_CONSTEXPR
+#endif
 
 #ifdef _MSC_VER
 int gettimeofday(struct timeval * tp, struct timezone * tzp);
@@ -25,23 +36,191 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp);
 namespace pcpp
 {
 
+	/**
+	 * @class CoreMask
+	 * A set of CPU cores, used by all multi-core APIs of PcapPlusPlus. It's a fixed-width bit-mask covering core IDs 0 to
+	 * MAX_NUM_OF_CORES-1, so unlike the plain integer bit-mask used before it isn't limited to 32 or 64 cores. For backward
+	 * compatibility a CoreMask can be implicitly constructed from an integer bit-mask (covering cores 0-63), for example:
+	 * CoreMask coreMask = 0x6 means cores 1 and 2, and the bitwise operators, comparison with an integer and testing the mask as a
+	 * boolean work like they did on the integer, for example: if (coreMask & SystemCores::Core1.Mask) or
+	 * if ((coreMask & core.Mask) == 0). Shifting and integer arithmetic aren't supported, use addCore(), removeCore() and
+	 * isCoreSet() instead.<BR>
+	 * The class has no dynamic memory and (when compiled as C++11 or later) constexpr c'tors, so the SystemCores constants are
+	 * initialized at compile time and can be used safely by the initializers of other global objects
+	 */
+	class CoreMask
+	{
+		friend struct SystemCores;
+
+		// the safe bool idiom, so a mask can be tested as a boolean without being convertible to an integer
+		typedef void (CoreMask::*BoolType)() const;
+		void boolTypeHelper() const {}
+
+	public:
+		/**
+		 * A c'tor that creates an empty core mask
+		 */
+		PCPP_CORE_MASK_CONSTEXPR CoreMask() : m_Words() {}
+
+		/**
+		 * A c'tor that creates a core mask from an integer bit-mask where each set bit represents a core. For example: 0x6 means
+		 * cores 1 and 2
+		 * @param[in] mask The bit-mask of cores 0-63
+		 */
+#ifdef PCPP_HAS_CORE_MASK_CONSTEXPR
+		constexpr CoreMask(uint64_t mask) : m_Words{ mask } {}
+#else
+		CoreMask(uint64_t mask) : m_Words() { m_Words[0] = mask; }
+#endif
+
+		/**
+		 * Add a core to the mask. Core IDs outside 0 to MAX_NUM_OF_CORES-1 are ignored
+		 * @param[in] coreId The core ID to add
+		 */
+		void addCore(int coreId)
+		{
+			if (coreId >= 0 && coreId < MAX_NUM_OF_CORES)
+				m_Words[coreId / 64] |= ((uint64_t)1 << (coreId % 64));
+		}
+
+		/**
+		 * Remove a core from the mask. Nothing is done if the core isn't in the mask
+		 * @param[in] coreId The core ID to remove
+		 */
+		void removeCore(int coreId)
+		{
+			if (coreId >= 0 && coreId < MAX_NUM_OF_CORES)
+				m_Words[coreId / 64] &= ~((uint64_t)1 << (coreId % 64));
+		}
+
+		/**
+		 * @param[in] coreId The core ID to check
+		 * @return True if the core is in the mask, false otherwise
+		 */
+		bool isCoreSet(int coreId) const
+		{
+			return coreId >= 0 && coreId < MAX_NUM_OF_CORES && (m_Words[coreId / 64] & ((uint64_t)1 << (coreId % 64))) != 0;
+		}
+
+		/**
+		 * @return True if no core is set in the mask, false otherwise
+		 */
+		bool isEmpty() const;
+
+		/**
+		 * @return The number of cores set in the mask
+		 */
+		int getCoreCount() const;
+
+		/**
+		 * @return The highest core ID set in the mask or -1 if the mask is empty. Useful as the upper bound when iterating the cores
+		 */
+		int getHighestCoreId() const;
+
+		/**
+		 * @return The bit-mask of cores 0-63, the integer this mask would have been before it covered more than 64 cores
+		 */
+		uint64_t getLowCoresMask() const { return m_Words[0]; }
+
+		/**
+		 * Convert the mask to a hexadecimal string of any length without the "0x" prefix, for example: cores 1, 2 and 65 are converted
+		 * to "20000000000000006". This is the core mask format used by DPDK and other tools
+		 * @return The core mask as a hexadecimal string. An empty mask is converted to "0"
+		 */
+		std::string toHexString() const;
+
+		/**
+		 * Parse a hexadecimal core mask of any length, with or without the "0x" prefix
+		 * @param[in] hexString The hexadecimal string to parse
+		 * @param[out] result The parsed core mask
+		 * @return True if the string was parsed successfully, false if it's empty, contains non-hexadecimal characters or sets a core
+		 * ID that isn't lower than MAX_NUM_OF_CORES
+		 */
+		static bool fromHexString(const std::string& hexString, CoreMask& result);
+
+		/**
+		 * @return A union of this core mask and another core mask
+		 */
+		CoreMask operator|(const CoreMask& other) const;
+
+		/**
+		 * @return An intersection of this core mask and another core mask
+		 */
+		CoreMask operator&(const CoreMask& other) const;
+
+		/**
+		 * @return A core mask of all the cores (up to MAX_NUM_OF_CORES) that aren't in this core mask
+		 */
+		CoreMask operator~() const;
+
+		/**
+		 * Add all the cores of another core mask to this core mask
+		 */
+		CoreMask& operator|=(const CoreMask& other);
+
+		/**
+		 * Keep only the cores that also appear in another core mask
+		 */
+		CoreMask& operator&=(const CoreMask& other);
+
+		/**
+		 * @return True if both core masks contain the same cores, false otherwise
+		 */
+		bool operator==(const CoreMask& other) const;
+
+		/**
+		 * @return True if the core masks contain different cores, false otherwise
+		 */
+		bool operator!=(const CoreMask& other) const { return !(*this == other); }
+
+		/**
+		 * Compare with an integer bit-mask, for example: (coreMask & core.Mask) == 0
+		 * @return True if the core mask contains exactly the cores of the integer bit-mask, false otherwise
+		 */
+		bool operator==(uint64_t mask) const { return *this == CoreMask(mask); }
+
+		/**
+		 * Compare with an integer bit-mask
+		 * @return True if the core mask contains different cores than the integer bit-mask, false otherwise
+		 */
+		bool operator!=(uint64_t mask) const { return !(*this == CoreMask(mask)); }
+
+		/**
+		 * Test the mask as a boolean, for example: if (coreMask & core.Mask)
+		 * @return A value that is true if the mask contains any core, false if it's empty
+		 */
+		operator BoolType() const { return isEmpty() ? NULL : &CoreMask::boolTypeHelper; }
+
+	private:
+		uint64_t m_Words[MAX_NUM_OF_CORES / 64];
+
+		// a mask of a single core. It's used to initialize SystemCores#IdToSystemCore at compile time, which can't be done with
+		// addCore()
+#ifdef PCPP_HAS_CORE_MASK_CONSTEXPR
+		static constexpr uint64_t singleCoreWord(int coreId, int word) { return (coreId / 64 == word ? (uint64_t)1 << (coreId % 64) : 0); }
+		constexpr CoreMask(int coreId, bool) :
+			m_Words{ singleCoreWord(coreId, 0), singleCoreWord(coreId, 1), singleCoreWord(coreId, 2), singleCoreWord(coreId, 3) } {}
+#else
+		CoreMask(int coreId, bool) : m_Words() { m_Words[coreId / 64] = (uint64_t)1 << (coreId % 64); }
+#endif
+	};
+
 	/**
 	 * @struct SystemCore
-	 * Represents data of 1 CPU core. Current implementation supports up to 32 cores
+	 * Represents data of 1 CPU core. Current implementation supports up to MAX_NUM_OF_CORES cores
 	 */
 	struct SystemCore
 	{
 		/**
-		 * Core position in a 32-bit mask. For each core this attribute holds a 4B integer where only 1 bit is set, according to the core ID.
-		 * For example: in core #0 the right-most bit will be set (meaning the number 0x01);
-		 * 				in core #5 the 5th right-most bit will be set (meaning the number 0x20)...
+		 * A core mask that contains only this core. For example: in core #0 it contains only core 0, in core #5 it contains only
+		 * core 5, etc.
 		 */
-		uint32_t Mask;
+		CoreMask Mask;
 
 		/**
-		 * Core ID - a value between 0 and 31
+		 * Core ID - a value between 0 and MAX_NUM_OF_CORES-1
 		 */
-		uint8_t Id;
+		uint16_t Id;
 
 		/**
 		* Overload of the comparison operator
@@ -52,7 +231,8 @@ namespace pcpp
 
 	/**
 	 * @struct SystemCores
-	 * Contains static representation to all 32 cores and a static array to map core ID (integer) to a SystemCore struct
+	 * Contains static representation of the first 32 cores and a static array to map core ID (integer) to a SystemCore struct for
+	 * all MAX_NUM_OF_CORES cores
 	 */
 	struct SystemCores
 	{
@@ -191,8 +371,6 @@ namespace pcpp
 		static const SystemCore IdToSystemCore[MAX_NUM_OF_CORES];
 	};
 
-	typedef uint32_t CoreMask;
-
 	/**
 	 * Get total number of cores on device
 	 * @return Total number of CPU cores on device
@@ -201,10 +379,33 @@ namespace pcpp
 
 	/**
 	 * Create a core mask for all cores available on machine
-	 * @return A core mask for all cores available on machine
+	 * @return A core mask for all cores available on machine (up to MAX_NUM_OF_CORES cores)
 	 */
 	CoreMask getCoreMaskForAllMachineCores();
 
+	/**
+	 * Get the number of NUMA nodes (sockets) on the machine
+	 * @return The number of NUMA nodes. On machines without NUMA support, or on platforms where this information isn't available,
+	 * 1 is returned
+	 */
+	int getNumOfNumaNodes();
+
+	/**
+	 * Get the NUMA node (socket) a core belongs to
+	 * @param[in] coreId The core ID
+	 * @return The NUMA node of the core. On machines without NUMA support, or on platforms where this information isn't available,
+	 * 0 is returned. If the core doesn't exist -1 is returned
+	 */
+	int getNumaNodeOfCore(int coreId);
+
+	/**
+	 * Create a core mask for all cores of a NUMA node (socket)
+	 * @param[in] numaNode The NUMA node
+	 * @return A core mask for all the cores of this NUMA node (up to MAX_NUM_OF_CORES cores). The mask is empty if the NUMA node
+	 * doesn't exist
+	 */
+	CoreMask getCoreMaskForNumaNode(int numaNode);
+
 
 	/**
 	 * Create a core mask from a vector of system cores
@@ -227,7 +428,7 @@ namespace pcpp
 	 * @param[in] coreMask The input core mask
 	 * @param[out] resultVec The vector that will contain the system cores
 	 */
-	void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& resultVec);
+	void createCoreVectorFromCoreMask(const CoreMask& coreMask, std::vector<SystemCore>& resultVec);
 
 	/**
 	 * Execute a shell command and return its output
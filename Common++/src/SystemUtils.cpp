@@ -38,75 +38,210 @@ int gettimeofday(struct timeval * tp, struct timezone * tzp)
 namespace pcpp
 {
 
-const SystemCore SystemCores::Core0 = { 0x01, 0 };
-const SystemCore SystemCores::Core1 = { 0x02, 1 };
-const SystemCore SystemCores::Core2 = { 0x04, 2 };
-const SystemCore SystemCores::Core3 = { 0x08, 3 };
-const SystemCore SystemCores::Core4 = { 0x10, 4 };
-const SystemCore SystemCores::Core5 = { 0x20, 5 };
-const SystemCore SystemCores::Core6 = { 0x40, 6 };
-const SystemCore SystemCores::Core7 = { 0x80, 7 };
-const SystemCore SystemCores::Core8 = { 0x100, 8 };
-const SystemCore SystemCores::Core9 = { 0x200, 9 };
-const SystemCore SystemCores::Core10 = { 0x400, 10 };
-const SystemCore SystemCores::Core11 = { 0x800, 11 };
-const SystemCore SystemCores::Core12 = { 0x1000, 12 };
-const SystemCore SystemCores::Core13 = { 0x2000, 13 };
-const SystemCore SystemCores::Core14 = { 0x4000, 14 };
-const SystemCore SystemCores::Core15 = { 0x8000, 15 };
-const SystemCore SystemCores::Core16 = { 0x10000, 16 };
-const SystemCore SystemCores::Core17 = { 0x20000, 17 };
-const SystemCore SystemCores::Core18 = { 0x40000, 18 };
-const SystemCore SystemCores::Core19 = { 0x80000, 19 };
-const SystemCore SystemCores::Core20 = { 0x100000, 20 };
-const SystemCore SystemCores::Core21 = { 0x200000, 21 };
-const SystemCore SystemCores::Core22 = { 0x400000, 22 };
-const SystemCore SystemCores::Core23 = { 0x800000, 23 };
-const SystemCore SystemCores::Core24 = { 0x1000000, 24 };
-const SystemCore SystemCores::Core25 = { 0x2000000, 25 };
-const SystemCore SystemCores::Core26 = { 0x4000000, 26 };
-const SystemCore SystemCores::Core27 = { 0x8000000, 27 };
-const SystemCore SystemCores::Core28 = { 0x10000000, 28 };
-const SystemCore SystemCores::Core29 = { 0x20000000, 29 };
-const SystemCore SystemCores::Core30 = { 0x40000000, 30 };
-const SystemCore SystemCores::Core31 = { 0x80000000, 31 };
+// all the SystemCores constants are initialized with constant expressions, so they're initialized before any code runs
+#define PCPP_SYSTEM_CORE(id) { CoreMask(id, true), id }
+#define PCPP_SYSTEM_CORES_8(base) \
+	PCPP_SYSTEM_CORE(base), PCPP_SYSTEM_CORE(base + 1), PCPP_SYSTEM_CORE(base + 2), PCPP_SYSTEM_CORE(base + 3), \
+	PCPP_SYSTEM_CORE(base + 4), PCPP_SYSTEM_CORE(base + 5), PCPP_SYSTEM_CORE(base + 6), PCPP_SYSTEM_CORE(base + 7)
+
+const SystemCore SystemCores::Core0 = PCPP_SYSTEM_CORE(0);
+const SystemCore SystemCores::Core1 = PCPP_SYSTEM_CORE(1);
+const SystemCore SystemCores::Core2 = PCPP_SYSTEM_CORE(2);
+const SystemCore SystemCores::Core3 = PCPP_SYSTEM_CORE(3);
+const SystemCore SystemCores::Core4 = PCPP_SYSTEM_CORE(4);
+const SystemCore SystemCores::Core5 = PCPP_SYSTEM_CORE(5);
+const SystemCore SystemCores::Core6 = PCPP_SYSTEM_CORE(6);
+const SystemCore SystemCores::Core7 = PCPP_SYSTEM_CORE(7);
+const SystemCore SystemCores::Core8 = PCPP_SYSTEM_CORE(8);
+const SystemCore SystemCores::Core9 = PCPP_SYSTEM_CORE(9);
+const SystemCore SystemCores::Core10 = PCPP_SYSTEM_CORE(10);
+const SystemCore SystemCores::Core11 = PCPP_SYSTEM_CORE(11);
+const SystemCore SystemCores::Core12 = PCPP_SYSTEM_CORE(12);
+const SystemCore SystemCores::Core13 = PCPP_SYSTEM_CORE(13);
+const SystemCore SystemCores::Core14 = PCPP_SYSTEM_CORE(14);
+const SystemCore SystemCores::Core15 = PCPP_SYSTEM_CORE(15);
+const SystemCore SystemCores::Core16 = PCPP_SYSTEM_CORE(16);
+const SystemCore SystemCores::Core17 = PCPP_SYSTEM_CORE(17);
+const SystemCore SystemCores::Core18 = PCPP_SYSTEM_CORE(18);
+const SystemCore SystemCores::Core19 = PCPP_SYSTEM_CORE(19);
+const SystemCore SystemCores::Core20 = PCPP_SYSTEM_CORE(20);
+const SystemCore SystemCores::Core21 = PCPP_SYSTEM_CORE(21);
+const SystemCore SystemCores::Core22 = PCPP_SYSTEM_CORE(22);
+const SystemCore SystemCores::Core23 = PCPP_SYSTEM_CORE(23);
+const SystemCore SystemCores::Core24 = PCPP_SYSTEM_CORE(24);
+const SystemCore SystemCores::Core25 = PCPP_SYSTEM_CORE(25);
+const SystemCore SystemCores::Core26 = PCPP_SYSTEM_CORE(26);
+const SystemCore SystemCores::Core27 = PCPP_SYSTEM_CORE(27);
+const SystemCore SystemCores::Core28 = PCPP_SYSTEM_CORE(28);
+const SystemCore SystemCores::Core29 = PCPP_SYSTEM_CORE(29);
+const SystemCore SystemCores::Core30 = PCPP_SYSTEM_CORE(30);
+const SystemCore SystemCores::Core31 = PCPP_SYSTEM_CORE(31);
 
 const SystemCore SystemCores::IdToSystemCore[MAX_NUM_OF_CORES] =
 {
-	SystemCores::Core0,
-	SystemCores::Core1,
-	SystemCores::Core2,
-	SystemCores::Core3,
-	SystemCores::Core4,
-	SystemCores::Core5,
-	SystemCores::Core6,
-	SystemCores::Core7,
-	SystemCores::Core8,
-	SystemCores::Core9,
-	SystemCores::Core10,
-	SystemCores::Core11,
-	SystemCores::Core12,
-	SystemCores::Core13,
-	SystemCores::Core14,
-	SystemCores::Core15,
-	SystemCores::Core16,
-	SystemCores::Core17,
-	SystemCores::Core18,
-	SystemCores::Core19,
-	SystemCores::Core20,
-	SystemCores::Core21,
-	SystemCores::Core22,
-	SystemCores::Core23,
-	SystemCores::Core24,
-	SystemCores::Core25,
-	SystemCores::Core26,
-	SystemCores::Core27,
-	SystemCores::Core28,
-	SystemCores::Core29,
-	SystemCores::Core30,
-	SystemCores::Core31
+	PCPP_SYSTEM_CORES_8(0), PCPP_SYSTEM_CORES_8(8), PCPP_SYSTEM_CORES_8(16), PCPP_SYSTEM_CORES_8(24),
+	PCPP_SYSTEM_CORES_8(32), PCPP_SYSTEM_CORES_8(40), PCPP_SYSTEM_CORES_8(48), PCPP_SYSTEM_CORES_8(56),
+	PCPP_SYSTEM_CORES_8(64), PCPP_SYSTEM_CORES_8(72), PCPP_SYSTEM_CORES_8(80), PCPP_SYSTEM_CORES_8(88),
+	PCPP_SYSTEM_CORES_8(96), PCPP_SYSTEM_CORES_8(104), PCPP_SYSTEM_CORES_8(112), PCPP_SYSTEM_CORES_8(120),
+	PCPP_SYSTEM_CORES_8(128), PCPP_SYSTEM_CORES_8(136), PCPP_SYSTEM_CORES_8(144), PCPP_SYSTEM_CORES_8(152),
+	PCPP_SYSTEM_CORES_8(160), PCPP_SYSTEM_CORES_8(168), PCPP_SYSTEM_CORES_8(176), PCPP_SYSTEM_CORES_8(184),
+	PCPP_SYSTEM_CORES_8(192), PCPP_SYSTEM_CORES_8(200), PCPP_SYSTEM_CORES_8(208), PCPP_SYSTEM_CORES_8(216),
+	PCPP_SYSTEM_CORES_8(224), PCPP_SYSTEM_CORES_8(232), PCPP_SYSTEM_CORES_8(240), PCPP_SYSTEM_CORES_8(248)
 };
 
+#if MAX_NUM_OF_CORES != 256
+#error "SystemCores::IdToSystemCore and the single core CoreMask c'tor must be updated when MAX_NUM_OF_CORES changes"
+#endif
+
+
+bool CoreMask::isEmpty() const
+{
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+	{
+		if (m_Words[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+int CoreMask::getCoreCount() const
+{
+	int result = 0;
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+	{
+		uint64_t word = m_Words[i];
+		while (word != 0)
+		{
+			word &= word - 1;
+			result++;
+		}
+	}
+
+	return result;
+}
+
+int CoreMask::getHighestCoreId() const
+{
+	for (int i = MAX_NUM_OF_CORES / 64 - 1; i >= 0; i--)
+	{
+		if (m_Words[i] == 0)
+			continue;
+
+		int bit = 63;
+		while ((m_Words[i] & ((uint64_t)1 << bit)) == 0)
+			bit--;
+
+		return i * 64 + bit;
+	}
+
+	return -1;
+}
+
+std::string CoreMask::toHexString() const
+{
+	std::string result;
+	char buffer[17];
+	for (int i = MAX_NUM_OF_CORES / 64 - 1; i >= 0; i--)
+	{
+		// the most significant word is printed without leading zeros
+		if (result.empty() && m_Words[i] == 0)
+			continue;
+		snprintf(buffer, sizeof(buffer), (result.empty() ? "%llx" : "%016llx"), (unsigned long long)m_Words[i]);
+		result += buffer;
+	}
+
+	return (result.empty() ? "0" : result);
+}
+
+bool CoreMask::fromHexString(const std::string& hexString, CoreMask& result)
+{
+	size_t start = 0;
+	if (hexString.size() > 2 && hexString[0] == '0' && (hexString[1] == 'x' || hexString[1] == 'X'))
+		start = 2;
+
+	if (start == hexString.size())
+		return false;
+
+	CoreMask mask;
+	int coreId = 0;
+	for (size_t i = hexString.size(); i > start; i--)
+	{
+		char digit = hexString[i - 1];
+		int value;
+		if (digit >= '0' && digit <= '9')
+			value = digit - '0';
+		else if (digit >= 'a' && digit <= 'f')
+			value = digit - 'a' + 10;
+		else if (digit >= 'A' && digit <= 'F')
+			value = digit - 'A' + 10;
+		else
+			return false;
+
+		for (int bit = 0; bit < 4; bit++, coreId++)
+		{
+			if ((value & (1 << bit)) == 0)
+				continue;
+			if (coreId >= MAX_NUM_OF_CORES)
+				return false;
+			mask.addCore(coreId);
+		}
+	}
+
+	result = mask;
+	return true;
+}
+
+CoreMask CoreMask::operator|(const CoreMask& other) const
+{
+	CoreMask result(*this);
+	result |= other;
+	return result;
+}
+
+CoreMask CoreMask::operator&(const CoreMask& other) const
+{
+	CoreMask result(*this);
+	result &= other;
+	return result;
+}
+
+CoreMask CoreMask::operator~() const
+{
+	CoreMask result;
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+		result.m_Words[i] = ~m_Words[i];
+
+	return result;
+}
+
+CoreMask& CoreMask::operator|=(const CoreMask& other)
+{
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+		m_Words[i] |= other.m_Words[i];
+
+	return *this;
+}
+
+CoreMask& CoreMask::operator&=(const CoreMask& other)
+{
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+		m_Words[i] &= other.m_Words[i];
+
+	return *this;
+}
+
+bool CoreMask::operator==(const CoreMask& other) const
+{
+	for (int i = 0; i < MAX_NUM_OF_CORES / 64; i++)
+	{
+		if (m_Words[i] != other.m_Words[i])
+			return false;
+	}
+
+	return true;
+}
+
 
 int getNumOfCores()
 {
@@ -121,11 +256,63 @@ int getNumOfCores()
 
 CoreMask getCoreMaskForAllMachineCores()
 {
-	int numOfCores = getNumOfCores() < 32 ? getNumOfCores() : 32;
-	CoreMask result = 0;
+	int numOfCores = getNumOfCores() < MAX_NUM_OF_CORES ? getNumOfCores() : MAX_NUM_OF_CORES;
+	CoreMask result;
+	for (int i = 0; i < numOfCores; i++)
+	{
+		result.addCore(i);
+	}
+
+	return result;
+}
+
+int getNumOfNumaNodes()
+{
+#ifdef LINUX
+	int numOfNodes = 0;
+	char nodePath[64];
+	while (true)
+	{
+		snprintf(nodePath, sizeof(nodePath), "/sys/devices/system/node/node%d", numOfNodes);
+		if (!directoryExists(nodePath))
+			break;
+		numOfNodes++;
+	}
+
+	return (numOfNodes > 0 ? numOfNodes : 1);
+#else
+	return 1;
+#endif
+}
+
+int getNumaNodeOfCore(int coreId)
+{
+	if (coreId < 0 || coreId >= getNumOfCores())
+		return -1;
+
+#ifdef LINUX
+	// each core directory contains a link to the NUMA node it belongs to
+	int numOfNodes = getNumOfNumaNodes();
+	char nodePath[96];
+	for (int node = 0; node < numOfNodes; node++)
+	{
+		snprintf(nodePath, sizeof(nodePath), "/sys/devices/system/cpu/cpu%d/node%d", coreId, node);
+		if (directoryExists(nodePath))
+			return node;
+	}
+#endif
+
+	return 0;
+}
+
+CoreMask getCoreMaskForNumaNode(int numaNode)
+{
+	int numOfCores = getNumOfCores() < MAX_NUM_OF_CORES ? getNumOfCores() : MAX_NUM_OF_CORES;
+	CoreMask result;
 	for (int i = 0; i < numOfCores; i++)
 	{
-		result = result | SystemCores::IdToSystemCore[i].Mask;
+		if (getNumaNodeOfCore(i) == numaNode)
+			result.addCore(i);
 	}
 
 	return result;
@@ -133,10 +320,10 @@ CoreMask getCoreMaskForAllMachineCores()
 
 CoreMask createCoreMaskFromCoreVector(std::vector<SystemCore> cores)
 {
-	CoreMask result = 0;
+	CoreMask result;
 	for (std::vector<SystemCore>::iterator iter = cores.begin(); iter != cores.end(); iter++)
 	{
-		result |= iter->Mask;
+		result.addCore(iter->Id);
 	}
 
 	return result;
@@ -144,27 +331,24 @@ CoreMask createCoreMaskFromCoreVector(std::vector<SystemCore> cores)
 
 CoreMask createCoreMaskFromCoreIds(std::vector<int> coreIds)
 {
-	CoreMask result = 0;
+	CoreMask result;
 	for (std::vector<int>::iterator iter = coreIds.begin(); iter != coreIds.end(); iter++)
 	{
-		result |= SystemCores::IdToSystemCore[*iter].Mask;
+		result.addCore(*iter);
 	}
 
 	return result;
 }
 
-void createCoreVectorFromCoreMask(CoreMask coreMask, std::vector<SystemCore>& resultVec)
+void createCoreVectorFromCoreMask(const CoreMask& coreMask, std::vector<SystemCore>& resultVec)
 {
-	int i = 0;
-	while (coreMask != 0)
+	int highestCoreId = coreMask.getHighestCoreId();
+	for (int i = 0; i <= highestCoreId && i < MAX_NUM_OF_CORES; i++)
 	{
-		if (1 & coreMask)
+		if (coreMask.isCoreSet(i))
 		{
 			resultVec.push_back(SystemCores::IdToSystemCore[i]);
 		}
-
-		coreMask = coreMask >> 1;
-		i++;
 	}
 }
 
@@ -71,6 +71,7 @@ void printUsage()
 			"    -l|--list                                  : Print the list of DPDK ports and exits\n"
 			"    -v|--version                               : Displays the current version and exits\n"
 			"    -c|--core-mask CORE_MASK                   : Core mask of cores to use. For example: use 7 (binary 0111) to use cores 0,1,2.\n"
+			"                                                 Masks prefixed with 0x are hexadecimal and may be of any length.\n"
 			"                                                 Default is using all cores except management core\n"
 			"    -m|--mbuf-pool-size POOL_SIZE              : DPDK mBuf pool size to initialize DPDK with. Default value is 4095\n\n"
 			"    -d|--dpdk-ports PORT_1,PORT_2              : A comma-separated list of two DPDK port numbers to be bridged.\n"
@@ -212,7 +213,15 @@ int main(int argc, char* argv[])
 			}
 			case 'c':
 			{
-				coreMaskToUse = atoi(optarg);
+				// a hexadecimal core mask of any length (for machines with more than 64 cores) or a decimal one
+				string coreMaskAsString = string(optarg);
+				if (coreMaskAsString.compare(0, 2, "0x") == 0)
+				{
+					if (!CoreMask::fromHexString(coreMaskAsString, coreMaskToUse))
+						EXIT_WITH_ERROR_AND_PRINT_USAGE("Core mask '%s' is not a valid hexadecimal number", optarg);
+				}
+				else
+					coreMaskToUse = (uint64_t)strtoull(optarg, NULL, 10);
 				break;
 			}
 			case 'd':
@@ -297,7 +306,7 @@ int main(int argc, char* argv[])
 	}
 
 	// removing DPDK master core from core mask because DPDK worker threads cannot run on master core
-	coreMaskToUse = coreMaskToUse & ~(DpdkDeviceList::getInstance().getDpdkMasterCore().Mask);
+	coreMaskToUse.removeCore(DpdkDeviceList::getInstance().getDpdkMasterCore().Id);
 
 	// re-calculate cores to use after removing master core
 	coresToUse.clear();
@@ -3,9 +3,10 @@
 #include "Common.h"
 #include "PacketMatchingEngine.h"
 
-#include "PacketUtils.h"
+#include "FlowKey.h"
 #include "DpdkDevice.h"
 #include "DpdkDeviceList.h"
+#include "DpdkTxContext.h"
 #include "PcapFileDevice.h"
 
 /**
@@ -21,7 +22,7 @@ private:
 	uint32_t m_CoreId;
 	PacketStats m_Stats;
 	PacketMatchingEngine& m_PacketMatchingEngine;
-	map<uint32_t, bool> m_FlowTable;
+	map<pcpp::FlowKey, bool> m_FlowTable;
 
 public:
 	AppWorkerThread(AppWorkerConfig& workerConfig, PacketMatchingEngine& matchingEngine) :
@@ -48,8 +49,15 @@ public:
 		m_Stop = false;
 		m_Stats.WorkerId = coreId;
 		pcpp::DpdkDevice* sendPacketsTo = m_WorkerConfig.SendPacketsTo;
+		pcpp::DpdkTxContext* txContext = NULL;
 		pcpp::PcapFileWriterDevice* pcapWriter = NULL;
 
+		// if needed, create a TX context which batches the matched packets sent by this worker into bursts
+		if (sendPacketsTo != NULL)
+		{
+			txContext = new pcpp::DpdkTxContext(sendPacketsTo, m_WorkerConfig.SendPacketsToTxQueue);
+		}
+
 		// if needed, create the pcap file writer which all matched packets will be written into
 		if (m_WorkerConfig.WriteMatchedPacketsToFile)
 		{
@@ -93,9 +101,11 @@ public:
 
 						bool packetMatched = false;
 
-						// hash the packet by 5-tuple and look in the flow table to see whether this packet belongs to an existing or new flow
-						uint32_t hash = pcpp::hash5Tuple(&parsedPacket);
-						map<uint32_t, bool>::const_iterator iter = m_FlowTable.find(hash);
+						// extract the packet's flow key and look in the flow table to see whether this packet belongs to an existing or new flow
+						pcpp::FlowKey flowKey;
+						flowKey.fromPacket(&parsedPacket);
+						flowKey.makeCanonical();
+						map<pcpp::FlowKey, bool>::const_iterator iter = m_FlowTable.find(flowKey);
 
 						// if packet belongs to an already existing flow
 						if (iter != m_FlowTable.end() && iter->second)
@@ -108,7 +118,7 @@ public:
 							if (packetMatched)
 							{
 								// put new flow in flow table
-								m_FlowTable[hash] = true;
+								m_FlowTable[flowKey] = true;
 
 								//collect stats
 								if (parsedPacket.isPacketOfType(pcpp::TCP))
@@ -125,23 +135,36 @@ public:
 
 						if (packetMatched)
 						{
-							// send packet to TX port if needed
-							if (sendPacketsTo != NULL)
-							{
-								sendPacketsTo->sendPacket(*packetArr[i], 0);
-							}
-
 							// save packet to file if needed
 							if (pcapWriter != NULL)
 							{
 								pcapWriter->writePacket(*packetArr[i]);
 							}
 
+							// send packet to TX port if needed. The packet mbuf is handed over to the TX context so it can't be
+							// used after this point
+							if (txContext != NULL)
+							{
+								txContext->sendPacket(*packetArr[i]);
+							}
+
 							m_Stats.MatchedPackets++;
 						}
 					}
 				}
 			}
+
+			// don't keep matched packets waiting in the TX context when traffic stops
+			if (txContext != NULL)
+			{
+				txContext->flushIfExpired();
+			}
+		}
+
+		// send the matched packets still waiting in the TX context
+		if (txContext != NULL)
+		{
+			delete txContext;
 		}
 
 		// free packet array (frees all mbufs as well)
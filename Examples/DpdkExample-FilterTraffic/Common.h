@@ -43,10 +43,11 @@ struct AppWorkerConfig
 	uint32_t CoreId;
 	InputDataConfig InDataCfg;
 	pcpp::DpdkDevice* SendPacketsTo;
+	uint16_t SendPacketsToTxQueue;
 	bool WriteMatchedPacketsToFile;
 	string PathToWritePackets;
 
-	AppWorkerConfig() : CoreId(MAX_NUM_OF_CORES+1), SendPacketsTo(NULL), WriteMatchedPacketsToFile(false), PathToWritePackets("")
+	AppWorkerConfig() : CoreId(MAX_NUM_OF_CORES+1), SendPacketsTo(NULL), SendPacketsToTxQueue(0), WriteMatchedPacketsToFile(false), PathToWritePackets("")
 	{
 	}
 };
@@ -58,7 +59,7 @@ struct AppWorkerConfig
 struct PacketStats
 {
 public:
-	uint8_t WorkerId;
+	uint16_t WorkerId;
 
 	int PacketCount;
 	int EthCount;
@@ -2,104 +2,63 @@
 
 #include "Packet.h"
 #include "IPv4Layer.h"
-#include "TcpLayer.h"
-#include "UdpLayer.h"
-#include <in.h>
+#include "RuleClassifier.h"
 
 /**
  * Responsible for matching packets by match criteria received from the user. Current match criteria are a combination of zero or more of the
  * following parameters: source IP, dest IP, source TCP/UDP port, dest TCP/UDP port and TCP/UDP protocol.
+ * The criteria are kept as a single rule in a pcpp::RuleClassifier, which matches a packet with one hash lookup per rule shape, so the
+ * engine can be extended to a full rule list (an ACL) without checking the rules one by one
  */
 class PacketMatchingEngine
 {
 private:
-	pcpp::IPv4Address m_SrcIpToMatch, m_DstIpToMatch;
-	uint16_t m_SrcPortToMatch, m_DstPortToMatch;
-	pcpp::ProtocolType m_ProtocolToMatch;
-	bool m_MatchSrcIp, m_MatchDstIp;
-	bool m_MatchSrcPort, m_MatchDstPort;
-	bool m_MatchProtocol;
+	pcpp::RuleClassifier m_Classifier;
+	bool m_MatchAll;
 public:
 	PacketMatchingEngine(const pcpp::IPv4Address& srcIpToMatch, const pcpp::IPv4Address& dstIpToMatch, uint16_t srcPortToMatch, uint16_t dstPortToMatch, pcpp::ProtocolType protocolToMatch)
-		: m_SrcIpToMatch(srcIpToMatch), m_DstIpToMatch(dstIpToMatch),
-		  m_SrcPortToMatch(srcPortToMatch), m_DstPortToMatch(dstPortToMatch), m_ProtocolToMatch(protocolToMatch),
-		  m_MatchSrcIp(false), m_MatchDstIp(false), m_MatchSrcPort(false), m_MatchDstPort(false), m_MatchProtocol(false)
+		: m_MatchAll(true)
 	{
-		if (m_SrcIpToMatch != pcpp::IPv4Address::Zero)
-			m_MatchSrcIp = true;
-		if (m_DstIpToMatch != pcpp::IPv4Address::Zero)
-			m_MatchDstIp = true;
-		if (m_SrcPortToMatch != 0)
-			m_MatchSrcPort = true;
-		if (m_DstPortToMatch != 0)
-			m_MatchDstPort = true;
-		if (m_ProtocolToMatch == pcpp::TCP || m_ProtocolToMatch == pcpp::UDP)
-			m_MatchProtocol = true;
-	}
+		pcpp::ClassifierRule rule(0, 0);
 
-	bool isMatched(pcpp::Packet& packet)
-	{
-		if (m_MatchSrcIp || m_MatchDstIp)
+		if (srcIpToMatch != pcpp::IPv4Address::Zero)
 		{
-			if (!packet.isPacketOfType(pcpp::IPv4))
-			{
-				return false;
-			}
-
-			pcpp::IPv4Layer* ip4Layer = packet.getLayerOfType<pcpp::IPv4Layer>();
-			if (m_MatchSrcIp && (ip4Layer->getSrcIpAddress() != m_SrcIpToMatch))
-			{
-				return false;
-			}
-
-			if (m_MatchDstIp && (ip4Layer->getDstIpAddress() != m_DstIpToMatch))
-			{
-				return false;
-			}
+			rule.setSrcIPv4(srcIpToMatch, 32);
+			m_MatchAll = false;
 		}
-
-		if (m_MatchSrcPort || m_MatchDstPort)
+		if (dstIpToMatch != pcpp::IPv4Address::Zero)
 		{
-			uint16_t srcPort, dstPort;
-			if (packet.isPacketOfType(pcpp::TCP))
-			{
-				srcPort = ntohs(packet.getLayerOfType<pcpp::TcpLayer>()->getTcpHeader()->portSrc);
-				dstPort = ntohs(packet.getLayerOfType<pcpp::TcpLayer>()->getTcpHeader()->portDst);
-			}
-			else if (packet.isPacketOfType(pcpp::UDP))
-			{
-				srcPort = ntohs(packet.getLayerOfType<pcpp::UdpLayer>()->getUdpHeader()->portSrc);
-				dstPort = ntohs(packet.getLayerOfType<pcpp::UdpLayer>()->getUdpHeader()->portDst);
-			}
-			else
-			{
-				return false;
-			}
-
-			if (m_MatchSrcPort && (srcPort != m_SrcPortToMatch))
-			{
-				return false;
-			}
-
-			if (m_MatchDstPort && (dstPort != m_DstPortToMatch))
-			{
-				return false;
-			}
+			rule.setDstIPv4(dstIpToMatch, 32);
+			m_MatchAll = false;
 		}
-
-		if (m_MatchProtocol)
+		// packets without TCP/UDP ports have port 0 in their flow key, so they never match a port criteria
+		if (srcPortToMatch != 0)
 		{
-			if (m_ProtocolToMatch == pcpp::TCP && (!packet.isPacketOfType(pcpp::TCP)))
-			{
-				return false;
-			}
+			rule.setSrcPortRange(srcPortToMatch, srcPortToMatch);
+			m_MatchAll = false;
+		}
+		if (dstPortToMatch != 0)
+		{
+			rule.setDstPortRange(dstPortToMatch, dstPortToMatch);
+			m_MatchAll = false;
+		}
+		if (protocolToMatch == pcpp::TCP || protocolToMatch == pcpp::UDP)
+		{
+			rule.setProtocol(protocolToMatch == pcpp::TCP ? pcpp::PACKETPP_IPPROTO_TCP : pcpp::PACKETPP_IPPROTO_UDP);
+			m_MatchAll = false;
+		}
 
-			if (m_ProtocolToMatch == pcpp::UDP && (!packet.isPacketOfType(pcpp::UDP)))
-			{
-				return false;
-			}
+		m_Classifier.addRule(rule);
+	}
+
+	bool isMatched(pcpp::Packet& packet)
+	{
+		// without criteria every packet matches, including non-IP packets which have no flow key
+		if (m_MatchAll)
+		{
+			return true;
 		}
 
-		return true;
+		return m_Classifier.classify(&packet) != NULL;
 	}
 };
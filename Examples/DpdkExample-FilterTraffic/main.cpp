@@ -31,6 +31,7 @@
 #include "TablePrinter.h"
 
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <stdlib.h>
@@ -87,6 +88,7 @@ void printUsage()
 			"    -P|--match-dest-port      PORT             : Match destination TCP/UDP port\n"
 			"    -r|--match-protocol       PROTOCOL         : Match protocol. Valid values are 'TCP' or 'UDP'\n"
 			"    -c|--core-mask            CORE_MASK        : Core mask of cores to use. For example: use 7 (binary 0111) to use cores 0,1,2.\n"
+			"                                                 Masks prefixed with 0x are hexadecimal and may be of any length.\n"
 			"                                                 Default is using all cores except management core\n"
 			"    -m|--mbuf-pool-size       POOL_SIZE        : DPDK mBuf pool size to initialize DPDK with. Default value is 4095\n\n", AppName::get().c_str());
 }
@@ -141,26 +143,19 @@ void prepareCoreConfiguration(vector<DpdkDevice*>& dpdkDevicesToUse, vector<Syst
 		bool writePacketsToDisk, string packetFilePath, DpdkDevice* sendPacketsTo,
 		AppWorkerConfig workerConfigArr[], int workerConfigArrLen)
 {
-	// create a list of pairs of DpdkDevice and RX queues for all RX queues in all requested devices
-	int totalNumOfRxQueues = 0;
-	vector<pair<DpdkDevice*, int> > deviceAndRxQVec;
-	for (vector<DpdkDevice*>::iterator iter = dpdkDevicesToUse.begin(); iter != dpdkDevicesToUse.end(); iter++)
+	// spread the RX queues of all requested devices between the cores, keeping each RX queue on a core on its device NUMA node
+	CoreMask coreMask;
+	for (vector<SystemCore>::iterator iter = coresToUse.begin(); iter != coresToUse.end(); iter++)
+		coreMask.addCore(iter->Id);
+
+	vector<RxQueueCoreAssignment> rxQueueAssignment;
+	if (!DpdkDeviceList::getInstance().assignRxQueuesToCores(dpdkDevicesToUse, coreMask, rxQueueAssignment))
 	{
-		for (int rxQueueIndex = 0; rxQueueIndex < (*iter)->getTotalNumOfRxQueues(); rxQueueIndex++)
-		{
-			pair<DpdkDevice*, int> curPair(*iter, rxQueueIndex);
-			deviceAndRxQVec.push_back(curPair);
-		}
-		totalNumOfRxQueues += (*iter)->getTotalNumOfRxQueues();
+		EXIT_WITH_ERROR("Couldn't assign RX queues to cores");
 	}
 
-	// calculate how many RX queues each core will read packets from. We divide the total number of RX queues with total number of core
-	int numOfRxQueuesPerCore = totalNumOfRxQueues / coresToUse.size();
-	int rxQueuesRemainder = totalNumOfRxQueues % coresToUse.size();
-
-	// prepare the configuration for every core: divide the devices and RX queue for each device with the various cores
+	// prepare the configuration for every core
 	int i = 0;
-	vector<pair<DpdkDevice*, int> >::iterator pairVecIter = deviceAndRxQVec.begin();
 	for (vector<SystemCore>::iterator iter = coresToUse.begin(); iter != coresToUse.end(); iter++)
 	{
 		printf("Using core %d\n", iter->Id);
@@ -172,18 +167,18 @@ void prepareCoreConfiguration(vector<DpdkDevice*>& dpdkDevicesToUse, vector<Syst
 		workerConfigArr[i].PathToWritePackets = packetFileName.str();
 
 		workerConfigArr[i].SendPacketsTo = sendPacketsTo;
-		for (int rxQIndex = 0; rxQIndex < numOfRxQueuesPerCore; rxQIndex++)
+		// DPDK TX queues aren't thread-safe, so give each core its own TX queue when the TX device has enough of them
+		if (sendPacketsTo != NULL && sendPacketsTo->getNumOfOpenedTxQueues() > 0)
+			workerConfigArr[i].SendPacketsToTxQueue = i % sendPacketsTo->getNumOfOpenedTxQueues();
+		for (vector<RxQueueCoreAssignment>::iterator assignIter = rxQueueAssignment.begin(); assignIter != rxQueueAssignment.end(); assignIter++)
 		{
-			if (pairVecIter == deviceAndRxQVec.end())
-				break;
-			workerConfigArr[i].InDataCfg[pairVecIter->first].push_back(pairVecIter->second);
-			pairVecIter++;
-		}
-		if (rxQueuesRemainder > 0 && (pairVecIter != deviceAndRxQVec.end()))
-		{
-			workerConfigArr[i].InDataCfg[pairVecIter->first].push_back(pairVecIter->second);
-			pairVecIter++;
-			rxQueuesRemainder--;
+			if (assignIter->coreId != iter->Id)
+				continue;
+
+			workerConfigArr[i].InDataCfg[assignIter->device].push_back(assignIter->rxQueueId);
+			if (assignIter->isCrossNuma)
+				printf("   Warning: DPDK device#%d is on NUMA node %d but core %d is on another NUMA node\n",
+						assignIter->device->getDeviceId(), assignIter->device->getNumaNode(), iter->Id);
 		}
 
 		// print configuration for core
@@ -322,7 +317,15 @@ int main(int argc, char* argv[])
 			}
 			case 'c':
 			{
-				coreMaskToUse = atoi(optarg);
+				// a hexadecimal core mask of any length (for machines with more than 64 cores) or a decimal one
+				string coreMaskAsString = string(optarg);
+				if (coreMaskAsString.compare(0, 2, "0x") == 0)
+				{
+					if (!CoreMask::fromHexString(coreMaskAsString, coreMaskToUse))
+						EXIT_WITH_ERROR_AND_PRINT_USAGE("Core mask '%s' is not a valid hexadecimal number", optarg);
+				}
+				else
+					coreMaskToUse = (uint64_t)strtoull(optarg, NULL, 10);
 				break;
 			}
 			case 'f':
@@ -435,7 +438,7 @@ int main(int argc, char* argv[])
 	}
 
 	// removing DPDK master core from core mask because DPDK worker threads cannot run on master core
-	coreMaskToUse = coreMaskToUse & ~(DpdkDeviceList::getInstance().getDpdkMasterCore().Mask);
+	coreMaskToUse.removeCore(DpdkDeviceList::getInstance().getDpdkMasterCore().Id);
 
 	// re-calculate cores to use after removing master core
 	coresToUse.clear();
@@ -464,7 +467,8 @@ int main(int argc, char* argv[])
 
 	// get DPDK device to send packets to (or NULL if doesn't exist)
 	DpdkDevice* sendPacketsTo = DpdkDeviceList::getInstance().getDeviceByPort(sendPacketsToPort);
-	if (sendPacketsTo != NULL && !sendPacketsTo->isOpened() &&  !sendPacketsTo->open())
+	if (sendPacketsTo != NULL && !sendPacketsTo->isOpened() &&
+			!sendPacketsTo->openMultiQueues(1, std::min((uint16_t)coresToUse.size(), sendPacketsTo->getTotalNumOfTxQueues())))
 	{
 		EXIT_WITH_ERROR("Could not open port#%d for sending matched packets", sendPacketsToPort);
 	}
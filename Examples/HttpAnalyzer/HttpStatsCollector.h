@@ -6,7 +6,7 @@
 #include "TcpLayer.h"
 #include "IPv4Layer.h"
 #include "PayloadLayer.h"
-#include "PacketUtils.h"
+#include "FlowKey.h"
 #include "SystemUtils.h"
 
 /**
@@ -155,14 +155,14 @@ public:
 			return;
 
 		// collect general HTTP traffic stats on this packet
-		uint32_t hashVal = collectHttpTrafficStats(httpPacket);
+		pcpp::FlowKey flowKey = collectHttpTrafficStats(httpPacket);
 
 		// if packet is an HTTP request - collect HTTP request stats on this packet
 		if (httpPacket->isPacketOfType(pcpp::HTTPRequest))
 		{
 			pcpp::HttpRequestLayer* req = httpPacket->getLayerOfType<pcpp::HttpRequestLayer>();
 			pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
-			collectHttpGeneralStats(tcpLayer, req, hashVal);
+			collectHttpGeneralStats(tcpLayer, req, flowKey);
 			collectRequestStats(req);
 		}
 		// if packet is an HTTP response - collect HTTP response stats on this packet
@@ -170,7 +170,7 @@ public:
 		{
 			pcpp::HttpResponseLayer* res = httpPacket->getLayerOfType<pcpp::HttpResponseLayer>();
 			pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
-			collectHttpGeneralStats(tcpLayer, res, hashVal);
+			collectHttpGeneralStats(tcpLayer, res, flowKey);
 			collectResponseStats(res);
 		}
 
@@ -281,7 +281,7 @@ private:
 	 * Collect stats relevant for every HTTP packet (request, response or any other)
 	 * This method calculates and returns the flow key for this packet
 	 */
-	uint32_t collectHttpTrafficStats(pcpp::Packet* httpPacket)
+	pcpp::FlowKey collectHttpTrafficStats(pcpp::Packet* httpPacket)
 	{
 		pcpp::TcpLayer* tcpLayer = httpPacket->getLayerOfType<pcpp::TcpLayer>();
 
@@ -291,15 +291,17 @@ private:
 		// count packet num
 		m_GeneralStats.numOfHttpPackets++;
 
-		// calculate a hash key for this flow to be used in the flow table
-		uint32_t hashVal = pcpp::hash5Tuple(httpPacket);
+		// calculate a key for this flow to be used in the flow table. Both directions of the flow get the same key
+		pcpp::FlowKey flowKey;
+		flowKey.fromPacket(httpPacket);
+		flowKey.makeCanonical();
 
 		// if flow is a new flow (meaning it's not already in the flow table)
-		if (m_FlowTable.find(hashVal) == m_FlowTable.end())
+		if (m_FlowTable.find(flowKey) == m_FlowTable.end())
 		{
 			// count this new flow
 			m_GeneralStats.numOfHttpFlows++;
-			m_FlowTable[hashVal].clear();
+			m_FlowTable[flowKey].clear();
 		}
 
 		// calculate averages
@@ -309,14 +311,14 @@ private:
 			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfHttpPackets / (double)m_FlowTable.size();
 		}
 
-		return hashVal;
+		return flowKey;
 	}
 
 
 	/**
 	 * Collect stats relevant for HTTP messages (requests or responses)
 	 */
-	void collectHttpGeneralStats(pcpp::TcpLayer* tcpLayer, pcpp::HttpMessage* message, uint32_t flowKey)
+	void collectHttpGeneralStats(pcpp::TcpLayer* tcpLayer, pcpp::HttpMessage* message, const pcpp::FlowKey& flowKey)
 	{
 		// if num of current opened transaction is negative it means something went completely wrong
 		if (m_FlowTable[flowKey].numOfOpenTransactions < 0)
@@ -461,7 +463,7 @@ private:
 	HttpResponseStats m_ResponseStats;
 	HttpResponseStats m_PrevResponseStats;
 
-	std::map<uint32_t, HttpFlowData> m_FlowTable;
+	std::map<pcpp::FlowKey, HttpFlowData> m_FlowTable;
 
 	double m_LastCalcRateTime;
 	double m_StartTime;
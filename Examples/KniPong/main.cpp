@@ -5,6 +5,7 @@
 #include <csignal>
 #include <ctime>
 #include <string>
+#include <deque>
 
 #include <unistd.h>
 #include <errno.h>
@@ -50,6 +51,7 @@ struct KniPongArgs
 	std::string outIp;
 	std::string kniName;
 	uint16_t kniPort;
+	pcpp::KniDevice::KniPollingConfiguration polling;
 };
 
 typedef int linuxFd;
@@ -69,6 +71,16 @@ struct PacketStats
 	unsigned long arpPacketsOutFail;
 };
 
+// Round trip times of the datagrams sent to the socket and echoed back by the KNI thread
+struct LatencyStats
+{
+	std::deque<double> pendingSendTimes;
+	unsigned long count;
+	double totalUsec;
+	double minUsec;
+	double maxUsec;
+};
+
 static bool doContinue = true;
 
 inline void printVersion()
@@ -87,16 +99,21 @@ inline void printUsage()
 {
 	std::printf(
 		"\nUsage:\n\n"
-		"    %s -s <src_ipv4> -d <dst_ipv4> [-n <kni_device_name>] [-p <port>] [-v] [-h]\n\n"
+		"    %s -s <src_ipv4> -d <dst_ipv4> [-n <kni_device_name>] [-p <port>] [-i <spin_iterations>] [-m <max_sleep_usec>] [-v] [-h]\n\n"
 		"Options:\n"
 		"    -s --src <src_ipv4>           : IP to assign to created KNI device\n"
 		"    -d --dst <dst_ipv4>           : Virtual IP to communicate with. Must be in /24 subnet with <src_ipv4>\n"
 		"    -n --name <kni_device_name>   : Name for KNI device. Default: \"" DEFAULT_KNI_NAME "\"\n"
 		"    -p --port <port>              : Port for communication. Default: %d\n"
+		"    -i --idle-spin <iterations>   : Number of empty polls before the KNI thread starts sleeping. Default: %u\n"
+		"    -m --max-sleep <usec>         : Maximal sleep time of an idle KNI thread in microseconds. 0 means the thread never\n"
+		"                                    sleeps. Default: %ld\n"
 		"    -v --version                  : Displays the current version and exits\n"
 		"    -h --help                     : Displays this help message and exits\n\n",
 		pcpp::AppName::get().c_str(),
-		DEFAULT_PORT
+		DEFAULT_PORT,
+		pcpp::KniDevice::KniPollingConfiguration().idleSpinIterations,
+		pcpp::KniDevice::KniPollingConfiguration().maxSleepNanoSeconds / 1000
 	);
 }
 
@@ -108,6 +125,8 @@ inline void parseArgs(int argc, char* argv[], KniPongArgs& args)
 		{"dst", required_argument, NULL, 'd'},
 		{"name", optional_argument, NULL, 'n'},
 		{"port", optional_argument, NULL, 'p'},
+		{"idle-spin", required_argument, NULL, 'i'},
+		{"max-sleep", required_argument, NULL, 'm'},
 		{"help", no_argument, NULL, 'h'},
 		{"version", no_argument, NULL, 'v'},
 		{NULL, 0, NULL, 0}
@@ -116,7 +135,7 @@ inline void parseArgs(int argc, char* argv[], KniPongArgs& args)
 	args.kniPort = DEFAULT_PORT;
 	int optionIndex = 0;
 	char opt = 0;
-	while ((opt = getopt_long(argc, argv, "s:d:n:p:hv", KniPongOptions, &optionIndex)) != -1)
+	while ((opt = getopt_long(argc, argv, "s:d:n:p:i:m:hv", KniPongOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -134,6 +153,12 @@ inline void parseArgs(int argc, char* argv[], KniPongArgs& args)
 			case 'p':
 				args.kniPort = std::strtoul(optarg, NULL, 10) & 0xFFFF;
 				break;
+			case 'i':
+				args.polling.idleSpinIterations = std::strtoul(optarg, NULL, 10);
+				break;
+			case 'm':
+				args.polling.maxSleepNanoSeconds = std::strtol(optarg, NULL, 10) * 1000;
+				break;
 			case 'v':
 				printVersion();
 				/* fall-through */
@@ -252,6 +277,7 @@ inline pcpp::KniDevice* setupKniDevice(const KniPongArgs& args)
 		EXIT_WITH_ERROR("Could not open KNI device");
 	if (!device->startRequestHandlerThread(0, 500000000))
 		EXIT_WITH_ERROR("Could not start KNI device request handler thread");
+	device->setPollingConfiguration(args.polling);
 	// Assign IP
 	if (!setKniIp(kniIp, args.kniName))
 		EXIT_WITH_ERROR("Can't set KNI device IP");
@@ -368,13 +394,16 @@ inline bool processUdp(pcpp::Packet& packet, pcpp::UdpLayer* udpLayer)
 	return true;
 }
 
-// Process burst of packets
+// Process burst of packets. Replies are collected and sent back to kernel in a single burst
 bool processBurst(pcpp::MBufRawPacket packets[], uint32_t numOfPackets, pcpp::KniDevice* kni, void* cookie)
 {
 	PacketStats* packetStats = (PacketStats*)cookie;
 	pcpp::Packet packet;
 	pcpp::ArpLayer* arpLayer = NULL;
 	pcpp::UdpLayer* udpLayer = NULL;
+	pcpp::MBufRawPacket* replies[numOfPackets];
+	bool isArpReply[numOfPackets];
+	uint16_t numOfReplies = 0;
 
 	packetStats->totalPackets += numOfPackets;
 	for (uint32_t i = 0; i < numOfPackets; ++i)
@@ -385,8 +414,8 @@ bool processBurst(pcpp::MBufRawPacket packets[], uint32_t numOfPackets, pcpp::Kn
 			++packetStats->arpPacketsIn;
 			processArp(packet, arpLayer);
 			// Packet is ready to be sent -> have no fields to recalculate
-			if (!kni->sendPacket(packet))
-				++packetStats->arpPacketsOutFail;
+			isArpReply[numOfReplies] = true;
+			replies[numOfReplies++] = packets + i;
 			arpLayer = NULL;
 			continue;
 		}
@@ -394,8 +423,12 @@ bool processBurst(pcpp::MBufRawPacket packets[], uint32_t numOfPackets, pcpp::Kn
 		if ((udpLayer = packet.getLayerOfType<pcpp::UdpLayer>()) != NULL)
 		{	
 			++packetStats->udpPacketsIn;
-			//! Warning (echo-Mike): DO NOT normalize next logic statement it relays on short circuiting
-			if (!processUdp(packet, udpLayer) || !kni->sendPacket(packet))
+			if (processUdp(packet, udpLayer))
+			{
+				isArpReply[numOfReplies] = false;
+				replies[numOfReplies++] = packets + i;
+			}
+			else
 				++packetStats->udpPacketsOutFail;
 			udpLayer = NULL;
 			continue;
@@ -404,6 +437,19 @@ bool processBurst(pcpp::MBufRawPacket packets[], uint32_t numOfPackets, pcpp::Kn
 		// Other packets are just ignored
 	}
 
+	if (numOfReplies == 0)
+		return true;
+
+	// Replies that didn't fit into the kernel queue are counted as failures
+	uint16_t repliesSent = kni->sendPackets(replies, numOfReplies);
+	for (uint16_t i = repliesSent; i < numOfReplies; ++i)
+	{
+		if (isArpReply[i])
+			++packetStats->arpPacketsOutFail;
+		else
+			++packetStats->udpPacketsOutFail;
+	}
+
 	return true;
 }
 
@@ -457,8 +503,31 @@ ssize_t drainbuf(linuxFd fd, unsigned char buff[], size_t& buffPos)
 	return n;
 }
 
+inline double getTimeUsec()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000.0 + now.tv_nsec / 1000.0;
+}
+
+// Every write to the UDP socket is a datagram which is echoed back by the KNI thread as a single datagram,
+// so the echoes arrive in the order the datagrams were sent
+inline void onDatagramEchoed(LatencyStats& latencyStats)
+{
+	if (latencyStats.pendingSendTimes.empty())
+		return;
+	double rtt = getTimeUsec() - latencyStats.pendingSendTimes.front();
+	latencyStats.pendingSendTimes.pop_front();
+	if (latencyStats.count == 0 || rtt < latencyStats.minUsec)
+		latencyStats.minUsec = rtt;
+	if (rtt > latencyStats.maxUsec)
+		latencyStats.maxUsec = rtt;
+	latencyStats.totalUsec += rtt;
+	++latencyStats.count;
+}
+
 // Reworked readwrite from netcat. See description in pingPongProcess
-void pingPongProcess(const LinuxSocket& sock)
+void pingPongProcess(const LinuxSocket& sock, LatencyStats& latencyStats)
 {	//? Note (echo-Mike): This function and fillbuf/drainbuf
 	//? are analogous to code of NETCAT utility (OpenBSD version)
 	// Authors of original codebase:
@@ -587,6 +656,8 @@ void pingPongProcess(const LinuxSocket& sock)
 		if (pfd[POLL_NETOUT].revents & POLLOUT && ttybuffPos > 0)
 		{
 			ret = drainbuf(pfd[POLL_NETOUT].fd, ttybuff, ttybuffPos);
+			if (ret > 0)
+				latencyStats.pendingSendTimes.push_back(getTimeUsec());
 			if (ret == WANT_POLLOUT)
 				pfd[POLL_NETOUT].events = POLLOUT;
 			else if (ret == -1)
@@ -602,6 +673,8 @@ void pingPongProcess(const LinuxSocket& sock)
 		if (pfd[POLL_NETIN].revents & POLLIN && netbuffPos < IO_BUFF_SIZE)
 		{
 			ret = fillbuf(pfd[POLL_NETIN].fd, netbuff, netbuffPos);
+			if (ret > 0)
+				onDatagramEchoed(latencyStats);
 			if (ret == WANT_POLLIN)
 				pfd[POLL_NETIN].events = POLLIN;
 			else if (ret == -1)
@@ -673,9 +746,16 @@ int main(int argc, char* argv[])
 	connectUDPSocket(sock, args);
 	std::signal(SIGINT, signal_handler);
 	std::printf("Ready for input:\n");
-	pingPongProcess(sock);
+	LatencyStats latencyStats;
+	latencyStats.count = 0;
+	latencyStats.totalUsec = latencyStats.minUsec = latencyStats.maxUsec = 0;
+	double startTime = getTimeUsec();
+	pingPongProcess(sock, latencyStats);
+	double elapsedSec = (getTimeUsec() - startTime) / 1000000.0;
 	//! Close socket before device
 	close(sock);
+	pcpp::KniDevice::KniCaptureStats captureStats;
+	device->getCaptureStats(captureStats);
 	device->stopCapture();
 	device->close();
 	device->stopRequestHandlerThread();
@@ -692,5 +772,31 @@ int main(int argc, char* argv[])
 		packetStats.arpPacketsIn,
 		packetStats.arpPacketsOutFail
 	);
+	std::printf(
+		"\nKNI thread polling statistics:\n"
+		"    Polls: %llu\n"
+		"    Empty polls: %llu\n"
+		"    Sleeps: %llu\n"
+		"    Average burst size: %.2f\n"
+		"    Throughput: %.2f packets/sec\n",
+		(unsigned long long)captureStats.polls,
+		(unsigned long long)captureStats.emptyPolls,
+		(unsigned long long)captureStats.sleeps,
+		captureStats.polls > captureStats.emptyPolls ? (double)captureStats.packets / (captureStats.polls - captureStats.emptyPolls) : 0.0,
+		elapsedSec > 0 ? captureStats.packets / elapsedSec : 0.0
+	);
+	if (latencyStats.count > 0)
+	{
+		std::printf(
+			"\nRound trip time of %lu echoed datagrams:\n"
+			"    Min: %.1f usec\n"
+			"    Avg: %.1f usec\n"
+			"    Max: %.1f usec\n",
+			latencyStats.count,
+			latencyStats.minUsec,
+			latencyStats.totalUsec / latencyStats.count,
+			latencyStats.maxUsec
+		);
+	}
 	return 0;
 }
\ No newline at end of file
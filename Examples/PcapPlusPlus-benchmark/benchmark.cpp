@@ -11,20 +11,46 @@
  * application folder to packet-capture-benchmarks/ , rename it to PcapPlusPlus and compile it using the makefile provided here.
  * Then use benchmark.sh script provided in packet-capture-benchmarks with all benchmarks you want to run. For example:
  * ./benchmark.sh libpcap PcapPlusPlus libtins libcrafter
+ * In addition to the "dns" and "packet" benchmarks of this project, the application can measure the throughput of the flow hashes
+ * used for distributing packets between cores: "toeplitz" runs the software RSS hash (ToeplitzHash) on the IPs and TCP/UDP ports of
+ * every packet, and "hash5tuple" runs hash5Tuple() on every packet (which requires parsing the packet). In these benchmarks the file
+ * is read into memory once and only the hashing is measured.
+ * "classify" measures RuleClassifier: a set of 50,000 synthetic 5-tuple rules (prefixes, port ranges and priorities, derived from the
+ * flows in the file so some of them match) is built once and the time it took is printed to stderr, then the flow key of every packet is
+ * classified in batches. "classify-linear" matches the same rules one by one for comparison
+ * "filters" runs a corpus of filter trees built from the PcapFilter.h classes over the packets in the file with every filter backend:
+ * libpcap (pcap_offline_filter() on the filter's BPF string), BpfJit native code, the BpfJit interpreter and NativeFilter. For every
+ * filter its selectivity and the ns/packet of each backend are printed to stderr. The verdict of every backend on every packet is
+ * compared with libpcap's, and the application fails if any of them disagrees
  */
 
 #include <Packet.h>
 #include <DnsLayer.h>
 #include <PcapFileDevice.h>
+#include <PacketUtils.h>
+#include <ToeplitzHash.h>
+#include <FlowKey.h>
+#include <RuleClassifier.h>
+#include <EthLayer.h>
+#include <PcapFilter.h>
+#include <NativeFilter.h>
+#include <BpfJit.h>
+#include <pcap.h>
 #include <iostream>
 #include <chrono>
 #include <string>
 #include <vector>
 #include <numeric>
+#include <algorithm>
+#include <string.h>
+#include <random>
+#include <memory>
+#include <iomanip>
 
 using namespace pcpp;
 
 size_t count = 0;
+uint32_t hash_sum = 0;
 
 bool handle_dns(Packet& packet) {
     if (!packet.isPacketOfType(DNS))
@@ -54,9 +80,272 @@ bool handle_packet(Packet& packet) {
     return true;
 }
 
+void handle_toeplitz(const ToeplitzHash& rssHash, const std::vector<RawPacket>& packets) {
+    for (std::vector<RawPacket>::const_iterator iter = packets.begin(); iter != packets.end(); ++iter) {
+        uint32_t hash;
+        rssHash.calculateHash(&(*iter), hash);
+        hash_sum += hash;
+        count++;
+    }
+}
+
+void handle_hash5tuple(std::vector<RawPacket>& packets) {
+    for (std::vector<RawPacket>::iterator iter = packets.begin(); iter != packets.end(); ++iter) {
+        Packet packet(&(*iter), OsiModelTransportLayer);
+        hash_sum += hash5Tuple(&packet);
+        count++;
+    }
+}
+
+const size_t num_classifier_rules = 50000;
+
+std::vector<ClassifierRule> create_rules(const std::vector<FlowKey>& keys) {
+    std::mt19937 rng(1);
+    std::vector<ClassifierRule> rules;
+    for (uint32_t rule_id = 0; rule_id < num_classifier_rules; ++rule_id) {
+        ClassifierRule rule(rule_id, rng() % 1000);
+        const FlowKey& key = keys[rng() % keys.size()];
+        if (key.isIPv4()) {
+            // generalize the flow of a packet, sometimes to random prefixes that don't match anything
+            uint32_t src_ip, dst_ip;
+            memcpy(&src_ip, key.getSrcIPData(), 4);
+            memcpy(&dst_ip, key.getDstIPData(), 4);
+            if (rng() % 4 == 0) {
+                src_ip = rng();
+                dst_ip = rng();
+            }
+            if (rng() % 4 != 0)
+                rule.setSrcIPv4(IPv4Address(src_ip), 8 * (1 + rng() % 4));
+            if (rng() % 4 != 0)
+                rule.setDstIPv4(IPv4Address(dst_ip), 8 * (1 + rng() % 4));
+        }
+        if (rng() % 2 == 0)
+            rule.setProtocol(key.getProtocol());
+        if (rng() % 2 == 0)
+            rule.setDstPortRange(key.getDstPort(), key.getDstPort());
+        else if (rng() % 4 == 0)
+            rule.setDstPortRange(key.getDstPort() & 0xff00, key.getDstPort() | 0x00ff);
+        if (rng() % 8 == 0)
+            rule.setSrcPortRange(1024, 65535);
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+void handle_classify(const RuleClassifier& classifier, const std::vector<FlowKey>& keys) {
+    std::vector<const ClassifierRule*> results(keys.size());
+    hash_sum += classifier.classify(&keys[0], keys.size(), &results[0]);
+    count += keys.size();
+}
+
+void handle_classify_linear(const std::vector<ClassifierRule>& rules, const std::vector<FlowKey>& keys) {
+    for (std::vector<FlowKey>::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+        const ClassifierRule* best = NULL;
+        for (std::vector<ClassifierRule>::const_iterator rule = rules.begin(); rule != rules.end(); ++rule) {
+            if ((best == NULL || rule->getPriority() > best->getPriority()) && rule->matchFlowKey(*key))
+                best = &(*rule);
+        }
+        if (best != NULL)
+            hash_sum++;
+        count++;
+    }
+}
+
+// the filter corpus: single filters of every class that compiles natively, and trees combining them
+std::vector<GeneralFilter*> create_filters(std::vector<std::unique_ptr<GeneralFilter>>& owned) {
+    auto own = [&owned](GeneralFilter* filter) { owned.emplace_back(filter); return filter; };
+    std::vector<GeneralFilter*> filters;
+
+    GeneralFilter* tcp = own(new ProtoFilter(TCP));
+    GeneralFilter* udp = own(new ProtoFilter(UDP));
+    GeneralFilter* http = own(new PortFilter(80, SRC_OR_DST));
+    GeneralFilter* dns = own(new PortFilter(53, DST));
+    GeneralFilter* vlan = own(new ProtoFilter(VLAN));
+    filters.push_back(tcp);
+    filters.push_back(udp);
+    filters.push_back(own(new ProtoFilter(ICMP)));
+    filters.push_back(own(new ProtoFilter(ARP)));
+    filters.push_back(vlan);
+    filters.push_back(http);
+    filters.push_back(dns);
+    filters.push_back(own(new IPFilter("10.0.0.0", DST, 8)));
+    filters.push_back(own(new IPv4TotalLengthFilter(576, LESS_OR_EQUAL)));
+    filters.push_back(own(new PortRangeFilter(1000, 2000, SRC_OR_DST)));
+    filters.push_back(own(new EtherTypeFilter(PCPP_ETHERTYPE_IPV6)));
+    filters.push_back(own(new TcpFlagsFilter(TcpFlagsFilter::tcpSyn, TcpFlagsFilter::MatchOneAtLeast)));
+    filters.push_back(own(new TcpWindowSizeFilter(8312, NOT_EQUALS)));
+    filters.push_back(own(new UdpLengthFilter(46, EQUALS)));
+
+    PortSetFilter* port_set = new PortSetFilter(SRC_OR_DST);
+    own(port_set);
+    port_set->addPort(80);
+    port_set->addPort(443);
+    port_set->addPort(8080);
+    port_set->addPortRange(40000, 50000);
+    filters.push_back(port_set);
+
+    SubnetSetFilter* subnet_set = new SubnetSetFilter(SRC_OR_DST);
+    own(subnet_set);
+    subnet_set->addSubnet("212.199.202.0/24");
+    subnet_set->addSubnet("10.0.0.0/8");
+    subnet_set->addSubnet("172.16.0.0/12");
+    subnet_set->addSubnet("192.168.0.0/16");
+    subnet_set->addSubnet("2001:db8::/32");
+    subnet_set->addSubnet("fe80::/10");
+    filters.push_back(subnet_set);
+
+    // ((tcp) and (port 80)) or ((udp) and (dst port 53)), and its negation
+    AndFilter* web = new AndFilter();
+    own(web);
+    web->addFilter(tcp);
+    web->addFilter(http);
+    AndFilter* dns_query = new AndFilter();
+    own(dns_query);
+    dns_query->addFilter(udp);
+    dns_query->addFilter(dns);
+    OrFilter* web_or_dns = new OrFilter();
+    own(web_or_dns);
+    web_or_dns->addFilter(web);
+    web_or_dns->addFilter(dns_query);
+    filters.push_back(web_or_dns);
+    filters.push_back(own(new NotFilter(web_or_dns)));
+
+    AndFilter* vlan_tcp = new AndFilter();
+    own(vlan_tcp);
+    vlan_tcp->addFilter(vlan);
+    vlan_tcp->addFilter(tcp);
+    filters.push_back(vlan_tcp);
+
+    return filters;
+}
+
+// times one backend over all packets and repetitions, stores its verdicts and returns the average ns/packet
+template<typename Matcher>
+double time_filter_backend(const std::vector<RawPacket>& packets, int total_runs, std::vector<bool>& verdicts, Matcher match) {
+    verdicts.assign(packets.size(), false);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < total_runs; ++run) {
+        for (size_t i = 0; i < packets.size(); ++i)
+            verdicts[i] = match(i);
+    }
+    auto time = std::chrono::high_resolution_clock::now() - start;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / ((double)packets.size() * total_runs);
+}
+
+// returns the index of the first packet the verdicts disagree on, or -1 if they agree on all packets
+long find_disagreement(const std::vector<bool>& expected, const std::vector<bool>& verdicts) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] != verdicts[i])
+            return (long)i;
+    }
+    return -1;
+}
+
+int benchmark_filters(const char* file_name, const std::vector<RawPacket>& packets, int total_runs) {
+    if (packets.empty()) {
+        std::cout << "No packets in " << file_name << "\n";
+        return 1;
+    }
+
+    // libpcap has no DLT for LINKTYPE_RAW, a file with raw IP packets is compiled as DLT_RAW
+    int link_type = packets[0].getLinkLayerType();
+    if (link_type == LINKTYPE_RAW)
+        link_type = LINKTYPE_DLT_RAW1;
+
+    std::vector<struct pcap_pkthdr> headers(packets.size());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].caplen = packets[i].getRawDataLen();
+        headers[i].len = packets[i].getFrameLength();
+    }
+
+    std::vector<std::unique_ptr<GeneralFilter>> owned;
+    std::vector<GeneralFilter*> filters = create_filters(owned);
+
+    std::cerr << std::setw(10) << "matched" << std::setw(10) << "libpcap" << std::setw(10) << "jit" << std::setw(10) << "interp"
+        << std::setw(10) << "native" << "  filter (ns/packet)\n";
+    std::cerr << std::fixed << std::setprecision(1);
+
+    bool all_agree = true;
+    double total_ns = 0;
+    size_t total_matched = 0;
+    for (std::vector<GeneralFilter*>::iterator iter = filters.begin(); iter != filters.end(); ++iter) {
+        std::string filter_string;
+        (*iter)->parseToString(filter_string);
+
+        struct bpf_program program;
+        if (pcap_compile_nopcap(9000, link_type, &program, filter_string.c_str(), 1, 0) < 0) {
+            // for example a MAC address filter on raw IP packets
+            std::cerr << std::setw(10) << "n/a" << "  " << filter_string << "\n";
+            continue;
+        }
+
+        std::vector<bool> expected;
+        double pcap_ns = time_filter_backend(packets, total_runs, expected, [&](size_t i) {
+            return pcap_offline_filter(&program, &headers[i], packets[i].getRawData()) != 0;
+        });
+        size_t matched = std::count(expected.begin(), expected.end(), true);
+        total_matched += matched;
+        total_ns += pcap_ns;
+
+        BpfJit jit, interpreter;
+        jit.compile(&program);
+        interpreter.compile(&program, false);
+        pcap_freecode(&program);
+
+        NativeFilter native;
+        bool native_compiled = native.compile(**iter);
+
+        const char* backend_names[] = { "jit", "interpreter", "native" };
+        double backend_ns[3] = { 0, 0, 0 };
+        std::vector<bool> verdicts;
+        for (int backend = 0; backend < 3; ++backend) {
+            if (backend == 0)
+                backend_ns[backend] = time_filter_backend(packets, total_runs, verdicts, [&](size_t i) {
+                    return jit.matchPacket(packets[i].getRawData(), headers[i].caplen, headers[i].len);
+                });
+            else if (backend == 1)
+                backend_ns[backend] = time_filter_backend(packets, total_runs, verdicts, [&](size_t i) {
+                    return interpreter.matchPacket(packets[i].getRawData(), headers[i].caplen, headers[i].len);
+                });
+            else if (native_compiled)
+                backend_ns[backend] = time_filter_backend(packets, total_runs, verdicts, [&](size_t i) {
+                    return native.matchPacket(&packets[i]);
+                });
+            else
+                continue;
+
+            total_ns += backend_ns[backend];
+            long bad_packet = find_disagreement(expected, verdicts);
+            if (bad_packet >= 0) {
+                std::cerr << backend_names[backend] << " and libpcap disagree on filter '" << filter_string << "' on packet #"
+                    << (bad_packet + 1) << ": libpcap " << (expected[bad_packet] ? "matches" : "doesn't match") << " it\n";
+                all_agree = false;
+            }
+        }
+
+        std::cerr << std::setw(9) << (100.0 * matched / packets.size()) << "%" << std::setw(10) << pcap_ns
+            << std::setw(10) << backend_ns[0] << std::setw(10) << backend_ns[1];
+        if (native_compiled)
+            std::cerr << std::setw(10) << backend_ns[2];
+        else
+            std::cerr << std::setw(10) << "n/a";
+        std::cerr << "  " << filter_string << "\n";
+    }
+
+    if (!all_agree) {
+        std::cerr << "FAILED: filter backends disagree with libpcap\n";
+        return 1;
+    }
+
+    // packets matched per run, and ms per run summed over all the backends
+    std::cout << total_matched << " " << (long)(total_ns * packets.size() / 1000000) << std::endl;
+    return 0;
+}
+
 int main(int argc, char *argv[]) { 
     if(argc != 4) {
-        std::cout << "Usage: " << *argv << " <input-file> <dns|packet> <repetitions>\n";
+        std::cout << "Usage: " << *argv << " <input-file> <dns|packet|toeplitz|hash5tuple|classify|classify-linear|filters> <repetitions>\n";
         return 1;
     }
     std::chrono::high_resolution_clock myClock;
@@ -64,12 +353,67 @@ int main(int argc, char *argv[]) {
     int total_runs = std::stoi(argv[3]);
     size_t total_packets = 0;
     std::vector<std::chrono::high_resolution_clock::duration> durations;
+    // the hash benchmarks run on packets that are already in memory
+    std::vector<RawPacket> packets;
+    bool classify = (input_type == "classify" || input_type == "classify-linear");
+    if(input_type == "toeplitz" || input_type == "hash5tuple" || classify || input_type == "filters") {
+        PcapFileReaderDevice reader(argv[1]);
+        reader.open();
+        RawPacket rawPacket;
+        while (reader.getNextPacket(rawPacket))
+            packets.push_back(rawPacket);
+        reader.close();
+    }
+    // every filter backend is timed separately, so the filter benchmark has its own loop
+    if(input_type == "filters")
+        return benchmark_filters(argv[1], packets, total_runs);
+    // the classifier benchmarks run on the flow keys of the packets, against rules created from them
+    std::vector<FlowKey> keys;
+    std::vector<ClassifierRule> rules;
+    RuleClassifier classifier;
+    if(classify) {
+        for (std::vector<RawPacket>::iterator iter = packets.begin(); iter != packets.end(); ++iter) {
+            Packet packet(&(*iter), OsiModelTransportLayer);
+            FlowKey key;
+            if (key.fromPacket(&packet))
+                keys.push_back(key);
+        }
+        if (keys.empty()) {
+            std::cout << "No IP packets in " << argv[1] << "\n";
+            return 1;
+        }
+        rules = create_rules(keys);
+        auto build_start = std::chrono::high_resolution_clock::now();
+        classifier.addRules(rules);
+        auto build_time = std::chrono::high_resolution_clock::now() - build_start;
+        std::cerr << "built " << classifier.getNumOfRules() << " rules in " << classifier.getNumOfTuples() << " tuples in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(build_time).count() << " ms\n";
+    }
+    ToeplitzHash rssHash(ToeplitzHash::SymmetricKey, ToeplitzHash::DefaultKeyLength,
+        ToeplitzHash::RSS_IPV4 | ToeplitzHash::RSS_NONFRAG_IPV4_TCP | ToeplitzHash::RSS_NONFRAG_IPV4_UDP |
+        ToeplitzHash::RSS_IPV6 | ToeplitzHash::RSS_NONFRAG_IPV6_TCP | ToeplitzHash::RSS_NONFRAG_IPV6_UDP);
     for(int i = 0; i < total_runs; ++i) {
         count = 0;
         PcapFileReaderDevice reader(argv[1]);
         reader.open();
         std::chrono::high_resolution_clock::time_point start;
-        if(input_type == "dns") {
+        if(input_type == "toeplitz") {
+            start = std::chrono::high_resolution_clock::now();
+            handle_toeplitz(rssHash, packets);
+        }
+        else if(input_type == "hash5tuple") {
+            start = std::chrono::high_resolution_clock::now();
+            handle_hash5tuple(packets);
+        }
+        else if(input_type == "classify") {
+            start = std::chrono::high_resolution_clock::now();
+            handle_classify(classifier, keys);
+        }
+        else if(input_type == "classify-linear") {
+            start = std::chrono::high_resolution_clock::now();
+            handle_classify_linear(rules, keys);
+        }
+        else if(input_type == "dns") {
             start = std::chrono::high_resolution_clock::now();
             RawPacket rawPacket;
             while (reader.getNextPacket(rawPacket))
@@ -19,6 +19,17 @@
  * There are switches that allows the user to search only in the provided folder (without sub-directories), search user-defined file extensions (sometimes
  * pcap files have an extension which is not '.pcap'), and output or not output the detailed report
  *
+ * In addition to (or instead of) a BPF search criteria, the user can give a file of payload patterns, for example a list of signatures or IOC strings, one
+ * pattern per line. All the patterns are searched in a single pass using pcpp#MultiPatternMatcher: TCP payloads are searched as reassembled streams (using
+ * pcpp#TcpReassembly) so patterns that span several packets are found too, UDP payloads are searched per packet, and other packets are searched as a whole.
+ * A packet is reported as found if a pattern occurrence ends in the data it carries. When both a search criteria and patterns are given only packets that
+ * match the search criteria are searched for the patterns
+ *
+ * Files are searched in parallel by a pool of worker threads (one per core by default), and the results are printed in the same order a serial search
+ * would print them. Optionally, a small index file is kept next to each capture file (see pcpp#CaptureIndex) with the file's time range and Bloom
+ * filters of the IP addresses and ports it contains. When the index is used, files whose index shows they can't contain matching packets (for example
+ * files that never saw the host in a 'host 1.1.1.1' search criteria, or files outside the requested time range) are skipped without being read
+ *
  * For more details about modes of operation and parameters please run PcapSearch -h
  */
 
@@ -28,14 +39,21 @@
 #include <sstream>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <pthread.h>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <Logger.h>
 #include <PcapPlusPlusVersion.h>
 #include <SystemUtils.h>
 #include <RawPacket.h>
 #include <Packet.h>
 #include <PcapFileDevice.h>
+#include <CaptureIndex.h>
+#include <TcpLayer.h>
+#include <UdpLayer.h>
+#include <TcpReassembly.h>
+#include <MultiPatternMatcher.h>
 #include <getopt.h>
 
 
@@ -48,6 +66,11 @@ static struct option PcapSearchOptions[] =
 	{"search", required_argument, 0, 's'},
 	{"detailed-report", required_argument, 0, 'r'},
 	{"set-extensions", required_argument, 0, 'e'},
+	{"patterns-file", required_argument, 0, 'p'},
+	{"threads", required_argument, 0, 't'},
+	{"use-index", no_argument, 0, 'i'},
+	{"start-time", required_argument, 0, 'S'},
+	{"end-time", required_argument, 0, 'E'},
 	{"version", no_argument, 0, 'v'},
 	{"help", no_argument, 0, 'h'},
     {0, 0, 0, 0}
@@ -72,6 +95,85 @@ static struct option PcapSearchOptions[] =
 
 char errorString[ERROR_STRING_LEN];
 
+
+// libpcap before version 1.8 isn't thread safe when opening files and compiling filters, and errorString is shared by all threads
+pthread_mutex_t readerOpenMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * The payload patterns to search, shared by all the worker threads
+ */
+struct PatternList
+{
+	MultiPatternMatcher matcher;
+	std::vector<std::string> patternsAsText;
+};
+
+
+/**
+ * The state of a payload pattern search in a single file: the matches found in the packet currently searched and the stream state of each side of
+ * each TCP connection
+ */
+struct PatternSearchContext
+{
+	struct TcpStreamStates
+	{
+		MultiPatternMatcher::StreamState sides[2];
+	};
+
+	const PatternList* patterns;
+	std::vector<int> matchCount;
+	std::vector<uint32_t> currentPacketMatches;
+	std::map<FlowKey, TcpStreamStates> tcpStreams;
+};
+
+
+/**
+ * The search settings, shared by all the worker threads
+ */
+struct SearchSettings
+{
+	std::string searchCriteria;
+	const PatternList* patterns;
+	bool detailedReport;
+	bool useIndex;
+	CaptureIndexQuery indexQuery;
+	bool hasTimeRange;
+	timespec startTime;
+	timespec endTime;
+};
+
+
+/**
+ * The result of searching a single file
+ */
+struct FileSearchResult
+{
+	bool done;
+	bool skippedByIndex;
+	int packetsFound;
+	std::vector<int> patternMatchCount;
+	std::string report;
+
+	FileSearchResult() : done(false), skippedByIndex(false), packetsFound(0) {}
+};
+
+
+/**
+ * The files to search and their results, shared by the worker threads (which search the files) and the main thread (which prints the results in
+ * the order of the files)
+ */
+struct SearchJob
+{
+	const SearchSettings* settings;
+	const std::vector<std::string>* files;
+	std::vector<FileSearchResult>* results;
+	size_t nextFile;
+	pthread_mutex_t mutex;
+	pthread_cond_t resultReady;
+};
+
+
 /**
  * Print application usage
  */
@@ -79,11 +181,21 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-n] [-r file_name] [-e extension_list] -d directory -s search_criteria\n"
+			"%s [-h] [-v] [-n] [-i] [-r file_name] [-e extension_list] [-p patterns_file] [-t num_of_threads] [-S start_time] [-E end_time] -d directory -s search_criteria\n"
 			"\nOptions:\n\n"
 			"    -d directory        : Input directory\n"
 			"    -n                  : Don't include sub-directories (default is include them)\n"
 			"    -s search_criteria  : Criteria to search in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html) i.e: 'ip net 1.1.1.1'\n"
+			"    -p patterns_file    : A file of payload patterns to search, one pattern per line. Empty lines and lines starting with '#' are ignored.\n"
+			"                          A byte can be written in hex as '\\xHH' and a backslash as '\\\\', for example: GET /admin\\x00\n"
+			"                          Either -s or -p (or both) must be given\n"
+			"    -t num_of_threads   : The number of files to search in parallel. The default is the number of cores\n"
+			"    -i                  : Use an index file kept next to each capture file to skip files that can't contain matching packets. The index\n"
+			"                          is built (and saved as '<capture file>.pcppidx') the first time a file is searched or after it changed. Files are\n"
+			"                          skipped by the hosts and ports the search criteria requires (when it's a conjunction such as 'host 1.1.1.1 and\n"
+			"                          tcp port 80') and by the time range\n"
+			"    -S start_time       : Search only packets captured at or after this time, given in seconds since the epoch\n"
+			"    -E end_time         : Search only packets captured at or before this time, given in seconds since the epoch\n"
 			"    -r file_name        : Write a detailed search report to a file\n"
 			"    -e extension_list   : Set file extensions to search. The default is searching '.pcap' and '.pcapng' files.\n"
 			"                          extnesions_list should be a comma-separated list of extensions, for example: pcap,net,dmp\n"
@@ -115,96 +227,300 @@ std::string getExtension(std::string fileName)
 
 
 /**
- * Searches all packet in a given pcap file for a certain search criteria. Returns how many packets matched the seatch criteria
+ * Load the patterns file into the matcher. Exits with an error if the file can't be read or one of the patterns is invalid
+ */
+void loadPatterns(std::string patternsFileName, PatternList& patterns)
+{
+	std::ifstream patternsFile(patternsFileName.c_str());
+	if (!patternsFile.is_open())
+	{
+		EXIT_WITH_ERROR("Couldn't open patterns file '%s'", patternsFileName.c_str());
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(patternsFile, line))
+	{
+		lineNumber++;
+
+		// remove the carriage return of files written on Windows
+		if (!line.empty() && line[line.length() - 1] == '\r')
+			line.erase(line.length() - 1);
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::string pattern;
+		if (!MultiPatternMatcher::parsePattern(line, pattern))
+		{
+			EXIT_WITH_ERROR("Invalid pattern in line %d of the patterns file", lineNumber);
+		}
+
+		patterns.matcher.addPattern(pattern);
+		patterns.patternsAsText.push_back(line);
+	}
+
+	if (patterns.patternsAsText.empty())
+	{
+		EXIT_WITH_ERROR("Patterns file '%s' doesn't contain any pattern", patternsFileName.c_str());
+	}
+
+	if (!patterns.matcher.compile())
+	{
+		EXIT_WITH_ERROR("Couldn't compile the patterns");
+	}
+}
+
+
+/**
+ * The callback invoked for each pattern occurrence found
+ */
+void onPatternMatch(const PatternMatch& match, void* userCookie)
+{
+	PatternSearchContext* context = (PatternSearchContext*)userCookie;
+	context->matchCount[match.patternId]++;
+	context->currentPacketMatches.push_back(match.patternId);
+}
+
+
+/**
+ * The callback invoked by TcpReassembly when new data of a TCP connection is ready. The data is searched as a continuation of the data previously
+ * received on the same side of the connection
+ */
+void onTcpMessageReady(int side, const TcpStreamData& tcpData, void* userCookie)
+{
+	PatternSearchContext* context = (PatternSearchContext*)userCookie;
+	MultiPatternMatcher::StreamState& streamState = context->tcpStreams[tcpData.getConnectionData().flowKey].sides[side];
+	context->patterns->matcher.search(streamState, tcpData.getData(), tcpData.getDataLength(), onPatternMatch, context);
+}
+
+
+/**
+ * The callback invoked by TcpReassembly when a TCP connection ends
+ */
+void onTcpConnectionEnd(const ConnectionData& connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
+{
+	PatternSearchContext* context = (PatternSearchContext*)userCookie;
+	context->tcpStreams.erase(connectionData.flowKey);
+}
+
+
+/**
+ * Searches the payload of a packet for the patterns. Returns true if any pattern occurrence was found
+ */
+bool searchPacketPayload(Packet& packet, PatternSearchContext& context, TcpReassembly& tcpReassembly)
+{
+	context.currentPacketMatches.clear();
+
+	if (packet.isPacketOfType(TCP))
+	{
+		tcpReassembly.reassemblePacket(packet);
+	}
+	else if (packet.isPacketOfType(UDP))
+	{
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		context.patterns->matcher.search(udpLayer->getLayerPayload(), udpLayer->getLayerPayloadSize(), onPatternMatch, &context);
+	}
+	else
+	{
+		RawPacket* rawPacket = packet.getRawPacket();
+		context.patterns->matcher.search(rawPacket->getRawData(), rawPacket->getRawDataLen(), onPatternMatch, &context);
+	}
+
+	return !context.currentPacketMatches.empty();
+}
+
+
+/**
+ * Check whether a timestamp is within the time range the user asked to search
+ */
+bool isInTimeRange(const timespec& timestamp, const SearchSettings& settings)
+{
+	if (!settings.hasTimeRange)
+		return true;
+
+	if (timestamp.tv_sec < settings.startTime.tv_sec || (timestamp.tv_sec == settings.startTime.tv_sec && timestamp.tv_nsec < settings.startTime.tv_nsec))
+		return false;
+
+	if (timestamp.tv_sec > settings.endTime.tv_sec || (timestamp.tv_sec == settings.endTime.tv_sec && timestamp.tv_nsec > settings.endTime.tv_nsec))
+		return false;
+
+	return true;
+}
+
+
+/**
+ * Consult the index of a capture file, building it first if it doesn't exist or is out of date. Returns false if the file certainly doesn't contain
+ * packets that match the search
+ */
+bool mayFileMatch(const std::string& pcapFilePath, const SearchSettings& settings)
+{
+	std::string indexFileName = CaptureIndex::getIndexFileName(pcapFilePath);
+	CaptureIndex index;
+
+	std::ifstream indexFile(indexFileName.c_str());
+	bool indexExists = indexFile.is_open();
+	indexFile.close();
+
+	if (!indexExists || !index.readFromFile(indexFileName) || !index.isUpToDate(pcapFilePath))
+	{
+		// if the index can't be built search the file
+		if (!index.build(pcapFilePath))
+			return true;
+
+		// an index that can't be saved (for example in a read-only archive) is still good for this search
+		index.writeToFile(indexFileName);
+	}
+
+	return index.mayMatch(settings.indexQuery);
+}
+
+
+/**
+ * Searches all packet in a given pcap file for a certain search criteria and/or payload patterns. Fills the result with how many packets matched
+ * the search criteria and contain any of the patterns, and with the detailed report of the file if it's required
  */
-int searchPcap(std::string pcapFilePath, std::string searchCriteria, std::ofstream* detailedReportFile)
+void searchPcap(std::string pcapFilePath, const SearchSettings& settings, FileSearchResult& result)
 {
+	if (settings.patterns != NULL)
+		result.patternMatchCount.resize(settings.patterns->patternsAsText.size(), 0);
+
+	if (settings.useIndex && !mayFileMatch(pcapFilePath, settings))
+	{
+		result.skippedByIndex = true;
+		return;
+	}
+
+	std::ostringstream detailedReport;
+
 	// create the pcap/pcap-ng reader
 	IFileReaderDevice* reader = IFileReaderDevice::getReader(pcapFilePath.c_str());
 
+	pthread_mutex_lock(&readerOpenMutex);
+
 	// if the reader fails to open
 	if (!reader->open())
 	{
-		if (detailedReportFile != NULL)
+		if (settings.detailedReport)
 		{
 			// PcapPlusPlus writes the error to the error string variable we set it to write to
 			// write this error to the report file
-			(*detailedReportFile) << "File '" << pcapFilePath << "':" << std::endl;
-			(*detailedReportFile) << "    ";
+			detailedReport << "File '" << pcapFilePath << "':" << std::endl;
+			detailedReport << "    ";
 			std::string errorStr = errorString;
-			(*detailedReportFile) << errorStr << std::endl;
+			detailedReport << errorStr << std::endl;
+			result.report = detailedReport.str();
 		}
 
+		pthread_mutex_unlock(&readerOpenMutex);
+
 		// free the reader memory and return
 		delete reader;
-		return 0;
+		return;
 	}
 
 	// set the filter for the file so only packets that match the search criteria will be read
-	if (!reader->setFilter(searchCriteria))
+	if (settings.searchCriteria != "" && !reader->setFilter(settings.searchCriteria))
 	{
+		pthread_mutex_unlock(&readerOpenMutex);
+
 		// free the reader memory and return
 		delete reader;
-		return 0;
+		return;
 	}
 
-	if (detailedReportFile != NULL)
+	pthread_mutex_unlock(&readerOpenMutex);
+
+	if (settings.detailedReport)
 	{
-		(*detailedReportFile) << "File '" << pcapFilePath << "':" << std::endl;
+		detailedReport << "File '" << pcapFilePath << "':" << std::endl;
 	}
 
 	int packetCount = 0;
 	RawPacket rawPacket;
 
+	// TCP streams are searched per file, the reassembly is needed only when searching for patterns
+	PatternSearchContext patternContext;
+	patternContext.patterns = settings.patterns;
+	patternContext.matchCount.resize(result.patternMatchCount.size(), 0);
+	TcpReassembly tcpReassembly(onTcpMessageReady, &patternContext, NULL, onTcpConnectionEnd);
+
 	// read packets from the file. Since we already set the filter, only packets that matches the filter will be read
 	while (reader->getNextPacket(rawPacket))
 	{
-		// if a detailed report is required, parse the packet and print it to the report file
-		if (detailedReportFile != NULL)
+		// skip packets outside the time range
+		if (!isInTimeRange(rawPacket.getPacketTimeStamp(), settings))
+			continue;
+
+		// parse the packet only if it's needed
+		if (settings.patterns == NULL && !settings.detailedReport)
 		{
-			// parse the packet
-			Packet parsedPacket(&rawPacket);
+			packetCount++;
+			continue;
+		}
+
+		Packet parsedPacket(&rawPacket);
 
+		// skip packets that don't contain any of the patterns
+		if (settings.patterns != NULL && !searchPacketPayload(parsedPacket, patternContext, tcpReassembly))
+			continue;
+
+		// if a detailed report is required, print the packet to the report
+		if (settings.detailedReport)
+		{
 			// print layer by layer by layer as we want to add a few spaces before each layer
 			std::vector<std::string> packetLayers;
 			parsedPacket.toStringList(packetLayers);
 			for (std::vector<std::string>::iterator iter = packetLayers.begin(); iter != packetLayers.end(); iter++)
-				(*detailedReportFile) << "\n    " << (*iter);
-			(*detailedReportFile) << std::endl;
+				detailedReport << "\n    " << (*iter);
+
+			// print the patterns found in the packet
+			if (settings.patterns != NULL)
+			{
+				detailedReport << "\n    Patterns found:";
+				for (std::vector<uint32_t>::iterator iter = patternContext.currentPacketMatches.begin(); iter != patternContext.currentPacketMatches.end(); iter++)
+					detailedReport << " '" << settings.patterns->patternsAsText[*iter] << "'";
+			}
+
+			detailedReport << std::endl;
 		}
 
 		// count the packet read
 		packetCount++;
 	}
 
+	// flush the data of TCP connections that are still open, patterns found in it are counted but can't be attributed to a packet
+	if (settings.patterns != NULL)
+		tcpReassembly.closeAllConnections();
+
 	// close the reader file
 	reader->close();
 
 	// finalize the report
-	if (detailedReportFile != NULL)
+	if (settings.detailedReport)
 	{
 		if (packetCount > 0)
-			(*detailedReportFile) << "\n";
-
-		(*detailedReportFile) << "    ----> Found " << packetCount << " packets" << std::endl << std::endl;
+			detailedReport << "\n";
 
+		detailedReport << "    ----> Found " << packetCount << " packets" << std::endl << std::endl;
+		result.report = detailedReport.str();
 	}
 
 	// free the reader memory
 	delete reader;
 
-	// return how many packets matched the search criteria
-	return packetCount;
+	result.packetsFound = packetCount;
+	result.patternMatchCount = patternContext.matchCount;
 }
 
 
 /**
- * Searches all pcap files in given directory (and sub-directories if directed by the user) and output how many packets in each file matches a given
- * search criteria. This method outputs how many directories were searched, how many files were searched and how many packets were matched
+ * Collects all pcap files in given directory (and sub-directories if directed by the user) in the order they are searched: the files of each
+ * sub-directory before the files of the directory itself, and the files of each directory sorted by name. This method outputs how many
+ * directories were searched
  */
-void searchtDirectories(std::string directory, bool includeSubDirectories, std::string searchCriteria, std::ofstream* detailedReportFile,
-		std::map<std::string, bool> extensionsToSearch,
-		int& totalDirSearched, int& totalFilesSearched, int& totalPacketsFound)
+void collectPcapFiles(std::string directory, bool includeSubDirectories, std::map<std::string, bool> extensionsToSearch,
+		std::vector<std::string>& pcapFiles, int& totalDirSearched)
 {
     // open the directory
     DIR *dir = opendir(directory.c_str());
@@ -259,7 +575,7 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     	// if we got to here it means the file is actually a directory. If required to search sub-directories, call this method recursively to search
     	// inside this sub-directory
         if (includeSubDirectories)
-        	searchtDirectories(dirPath, true, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+        	collectPcapFiles(dirPath, true, extensionsToSearch, pcapFiles, totalDirSearched);
 
         // move to the next file
         entry = readdir(dir);
@@ -271,24 +587,112 @@ void searchtDirectories(std::string directory, bool includeSubDirectories, std::
     totalDirSearched++;
 
     // when we get to here we already covered all sub-directories and collected all the files in this directory that are required for search
-    // go over each such file and search its packets to find the search criteria
-    for (std::vector<std::string>::iterator iter = pcapList.begin(); iter != pcapList.end(); iter++)
-    {
-    	// do the actual search
-    	int packetsFound = searchPcap(*iter, searchCriteria, detailedReportFile);
+    // add them after the files of the sub-directories, sorted so the search order doesn't depend on the file system
+    std::sort(pcapList.begin(), pcapList.end());
+    pcapFiles.insert(pcapFiles.end(), pcapList.begin(), pcapList.end());
+}
 
-    	// add to total matched packets
-    	totalFilesSearched++;
-    	if (packetsFound > 0)
-    	{
-    		printf("%d packets found in '%s'\n", packetsFound, iter->c_str());
-    		totalPacketsFound += packetsFound;
-    	}
-    }
 
+/**
+ * A worker thread: searches files until there are no more files to search
+ */
+void* searchWorkerThread(void* cookie)
+{
+	SearchJob* job = (SearchJob*)cookie;
+
+	while (true)
+	{
+		pthread_mutex_lock(&job->mutex);
+		size_t fileIndex = job->nextFile++;
+		pthread_mutex_unlock(&job->mutex);
+
+		if (fileIndex >= job->files->size())
+			break;
+
+		FileSearchResult result;
+		searchPcap(job->files->at(fileIndex), *job->settings, result);
+
+		pthread_mutex_lock(&job->mutex);
+		result.done = true;
+		job->results->at(fileIndex) = result;
+		pthread_cond_broadcast(&job->resultReady);
+		pthread_mutex_unlock(&job->mutex);
+	}
+
+	return NULL;
 }
 
 
+/**
+ * Parse a time given in seconds since the epoch
+ */
+bool parseTime(const char* timeAsString, timespec& time)
+{
+	char* end = NULL;
+	double seconds = strtod(timeAsString, &end);
+	if (end == timeAsString || *end != '\0' || seconds < 0)
+		return false;
+
+	time.tv_sec = (time_t)seconds;
+	time.tv_nsec = (long)((seconds - (double)time.tv_sec) * 1000000000);
+	return true;
+}
+
+
+/**
+ * Derive the index query from the search criteria. Only a conjunction of terms can be used: each 'host X' and 'port N' term (optionally qualified
+ * by 'src', 'dst', 'ip', 'ip6', 'tcp' or 'udp') is a host or a port every matching packet contains. Other terms are ignored, and a search criteria
+ * that has 'or', 'not' or parentheses isn't used at all, since a file may match it without containing any specific host or port
+ */
+void buildIndexQuery(const std::string& searchCriteria, CaptureIndexQuery& query)
+{
+	std::vector<std::string> tokens;
+	std::stringstream stream(searchCriteria);
+	std::string token;
+	while (stream >> token)
+	{
+		if (token == "or" || token == "||" || token == "not" || token[0] == '!' || token.find_first_of("()") != std::string::npos)
+			return;
+		tokens.push_back(token);
+	}
+
+	// split to the terms of the conjunction
+	tokens.push_back("and");
+	std::vector<std::string> term;
+	for (std::vector<std::string>::iterator iter = tokens.begin(); iter != tokens.end(); iter++)
+	{
+		if (*iter != "and" && *iter != "&&")
+		{
+			term.push_back(*iter);
+			continue;
+		}
+
+		// skip the qualifiers that don't change the meaning of the host or port
+		size_t first = 0;
+		while (first < term.size() && (term[first] == "src" || term[first] == "dst" || term[first] == "ip" || term[first] == "ip6" || term[first] == "tcp" || term[first] == "udp"))
+			first++;
+
+		if (term.size() == first + 2 && term[first] == "host")
+		{
+			IPv4Address ipv4Address(term[first + 1]);
+			IPv6Address ipv6Address(term[first + 1]);
+			if (ipv4Address.isValid())
+				query.addAddress(ipv4Address);
+			else if (ipv6Address.isValid())
+				query.addAddress(ipv6Address);
+		}
+		else if (term.size() == first + 2 && term[first] == "port")
+		{
+			char* end = NULL;
+			long port = strtol(term[first + 1].c_str(), &end, 10);
+			if (*end == '\0' && port >= 0 && port <= 65535)
+				query.addPort((uint16_t)port);
+		}
+
+		term.clear();
+	}
+}
+
 
 /**
  * main method of this utility
@@ -305,6 +709,15 @@ int main(int argc, char* argv[])
 
 	std::string detailedReportFileName = "";
 
+	std::string patternsFileName = "";
+
+	int numOfThreads = getNumOfCores();
+
+	bool useIndex = false;
+
+	bool hasStartTime = false, hasEndTime = false;
+	timespec startTime, endTime;
+
 	std::map<std::string, bool> extensionsToSearch;
 
 	// the default (unless set otherwise) is to search in '.pcap' and '.pcapng' extensions
@@ -314,7 +727,7 @@ int main(int argc, char* argv[])
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "d:s:r:e:hvn", PcapSearchOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "d:s:r:e:p:t:S:E:hvni", PcapSearchOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -332,6 +745,33 @@ int main(int argc, char* argv[])
 			case 'r':
 				detailedReportFileName = optarg;
 				break;
+			case 'p':
+				patternsFileName = optarg;
+				break;
+			case 't':
+				numOfThreads = atoi(optarg);
+				if (numOfThreads < 1)
+				{
+					EXIT_WITH_ERROR("Number of threads must be a positive number");
+				}
+				break;
+			case 'i':
+				useIndex = true;
+				break;
+			case 'S':
+				if (!parseTime(optarg, startTime))
+				{
+					EXIT_WITH_ERROR("Start time isn't valid");
+				}
+				hasStartTime = true;
+				break;
+			case 'E':
+				if (!parseTime(optarg, endTime))
+				{
+					EXIT_WITH_ERROR("End time isn't valid");
+				}
+				hasEndTime = true;
+				break;
 			case 'e':
 			{
 				// read the extension list into the map
@@ -371,9 +811,9 @@ int main(int argc, char* argv[])
 		EXIT_WITH_ERROR("Input directory was not given");
 	}
 
-	if (searchCriteria == "")
+	if (searchCriteria == "" && patternsFileName == "")
 	{
-		EXIT_WITH_ERROR("Search criteria was not given");
+		EXIT_WITH_ERROR("Neither search criteria nor patterns file were given");
 	}
 
 	DIR *dir = opendir(inputDirectory.c_str());
@@ -384,11 +824,47 @@ int main(int argc, char* argv[])
 
 	// verify the search criteria is a valid BPF filter
 	BPFStringFilter filter(searchCriteria);
-	if(!filter.verifyFilter())
+	if(searchCriteria != "" && !filter.verifyFilter())
 	{
 		EXIT_WITH_ERROR("Search criteria isn't valid");
 	}
 
+	// load the patterns to search if requested by the user
+	PatternList* patterns = NULL;
+	if (patternsFileName != "")
+	{
+		patterns = new PatternList();
+		loadPatterns(patternsFileName, *patterns);
+	}
+
+	SearchSettings settings;
+	settings.searchCriteria = searchCriteria;
+	settings.patterns = patterns;
+	settings.detailedReport = (detailedReportFileName != "");
+	settings.useIndex = useIndex;
+	settings.hasTimeRange = (hasStartTime || hasEndTime);
+	settings.startTime.tv_sec = 0;
+	settings.startTime.tv_nsec = 0;
+	settings.endTime.tv_sec = (sizeof(time_t) > 4 ? (time_t)0x7fffffffffffffffLL : (time_t)0x7fffffff);
+	settings.endTime.tv_nsec = 999999999;
+	if (hasStartTime)
+		settings.startTime = startTime;
+	if (hasEndTime)
+		settings.endTime = endTime;
+
+	if (settings.hasTimeRange && (settings.startTime.tv_sec > settings.endTime.tv_sec ||
+			(settings.startTime.tv_sec == settings.endTime.tv_sec && settings.startTime.tv_nsec > settings.endTime.tv_nsec)))
+	{
+		EXIT_WITH_ERROR("Start time is later than end time");
+	}
+
+	if (useIndex)
+	{
+		buildIndexQuery(searchCriteria, settings.indexQuery);
+		if (settings.hasTimeRange)
+			settings.indexQuery.setTimeRange(settings.startTime, settings.endTime);
+	}
+
 	// open the detailed report file if requested by the user
 	std::ofstream* detailedReportFile = NULL;
 	if (detailedReportFileName != "")
@@ -409,13 +885,81 @@ int main(int argc, char* argv[])
 	printf("Searching...\n");
 	int totalDirSearched = 0;
 	int totalFilesSearched = 0;
+	int totalFilesSkipped = 0;
 	int totalPacketsFound = 0;
+	std::vector<int> totalPatternMatchCount(patterns != NULL ? patterns->patternsAsText.size() : 0, 0);
+
+	std::vector<std::string> pcapFiles;
+	collectPcapFiles(inputDirectory, includeSubDirectories, extensionsToSearch, pcapFiles, totalDirSearched);
+
+	// the main call - start searching! the worker threads search the files and the main thread prints the result of each file in order as soon
+	// as it's ready, so the output is the same regardless of the number of threads
+	std::vector<FileSearchResult> results(pcapFiles.size());
+	SearchJob job;
+	job.settings = &settings;
+	job.files = &pcapFiles;
+	job.results = &results;
+	job.nextFile = 0;
+	pthread_mutex_init(&job.mutex, NULL);
+	pthread_cond_init(&job.resultReady, NULL);
+
+	if ((size_t)numOfThreads > pcapFiles.size())
+		numOfThreads = (int)pcapFiles.size();
+
+	std::vector<pthread_t> workerThreads;
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, searchWorkerThread, &job) != 0)
+			break;
+		workerThreads.push_back(thread);
+	}
+
+	if (workerThreads.empty() && !pcapFiles.empty())
+	{
+		EXIT_WITH_ERROR("Couldn't start worker threads");
+	}
+
+	for (size_t i = 0; i < pcapFiles.size(); i++)
+	{
+		pthread_mutex_lock(&job.mutex);
+		while (!results[i].done)
+			pthread_cond_wait(&job.resultReady, &job.mutex);
+		FileSearchResult result;
+		std::swap(result, results[i]);
+		pthread_mutex_unlock(&job.mutex);
+
+		// add to total matched packets
+		totalFilesSearched++;
+		if (result.skippedByIndex)
+		{
+			totalFilesSkipped++;
+			continue;
+		}
+
+		if (result.packetsFound > 0)
+		{
+			printf("%d packets found in '%s'\n", result.packetsFound, pcapFiles[i].c_str());
+			totalPacketsFound += result.packetsFound;
+		}
+
+		for (size_t patternId = 0; patternId < result.patternMatchCount.size(); patternId++)
+			totalPatternMatchCount[patternId] += result.patternMatchCount[patternId];
+
+		if (detailedReportFile != NULL)
+			(*detailedReportFile) << result.report;
+	}
 
-	// the main call - start searching!
-	searchtDirectories(inputDirectory, includeSubDirectories, searchCriteria, detailedReportFile, extensionsToSearch, totalDirSearched, totalFilesSearched, totalPacketsFound);
+	for (std::vector<pthread_t>::iterator iter = workerThreads.begin(); iter != workerThreads.end(); iter++)
+		pthread_join(*iter, NULL);
+
+	pthread_cond_destroy(&job.resultReady);
+	pthread_mutex_destroy(&job.mutex);
 
 	// after search is done, close the report file and delete its instance
 	printf("\n\nDone! Searched %d files in %d directories, %d packets were matched to search criteria\n", totalFilesSearched, totalDirSearched, totalPacketsFound);
+	if (useIndex)
+		printf("%d files were skipped using their index\n", totalFilesSkipped);
 	if (detailedReportFile != NULL)
 	{
 		if (detailedReportFile->is_open())
@@ -425,5 +969,15 @@ int main(int argc, char* argv[])
 		printf("Detailed report written to '%s'\n", detailedReportFileName.c_str());
 	}
 
+	// print how many times each pattern was found
+	if (patterns != NULL)
+	{
+		printf("\nPattern matches:\n");
+		for (size_t i = 0; i < patterns->patternsAsText.size(); i++)
+			printf("    '%s': %d\n", patterns->patternsAsText[i].c_str(), totalPatternMatchCount[i]);
+
+		delete patterns;
+	}
+
 	return 0;
 }
@@ -24,8 +24,8 @@ public:
 	 */
 	int getFileNumber(pcpp::Packet& packet, std::vector<int>& filesToClose)
 	{
-		// hash the 2-tuple and look for it in the flow table
-		uint32_t hash = pcpp::hash2Tuple(&packet);
+		// extract the 2-tuple and look for it in the flow table
+		pcpp::FlowKey hash = getFlowKey(packet, false);
 
 		// if flow isn't found in the flow table
 		if (m_FlowTable.find(hash) == m_FlowTable.end())
@@ -58,7 +58,7 @@ private:
 
 	// a flow table for saving TCP state per flow. Currently the only data that is saved is whether
 	// the last packet seen on the flow was a TCP SYN packet
-	std::map<uint32_t, bool> m_TcpFlowTable;
+	std::map<pcpp::FlowKey, bool> m_TcpFlowTable;
 
 	/**
 	 * A utility method that takes a packet and returns true if it's a TCP SYN packet
@@ -94,8 +94,8 @@ public:
 	 */
 	int getFileNumber(pcpp::Packet& packet, std::vector<int>& filesToClose)
 	{
-		// hash the 5-tuple and look for it in the flow table
-		uint32_t hash = pcpp::hash5Tuple(&packet);
+		// extract the 5-tuple and look for it in the flow table
+		pcpp::FlowKey hash = getFlowKey(packet, true);
 
 		// if flow isn't found in the flow table
 		if (m_FlowTable.find(hash) == m_FlowTable.end())
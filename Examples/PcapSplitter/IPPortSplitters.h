@@ -34,8 +34,8 @@ public:
 			return 0;
 		}
 
-		// hash the 5-tuple and look for it in the flow table
-		uint32_t hash = pcpp::hash5Tuple(&packet);
+		// extract the 5-tuple and look for it in the flow table
+		pcpp::FlowKey hash = getFlowKey(packet, true);
 
 		if (m_FlowTable.find(hash) != m_FlowTable.end())
 		{
@@ -9,7 +9,7 @@
 #include <TcpLayer.h>
 #include <UdpLayer.h>
 #include <DnsLayer.h>
-#include <PacketUtils.h>
+#include <FlowKey.h>
 #include <map>
 #include <algorithm>
 #include <iomanip>
@@ -167,7 +167,7 @@ class ValueBasedSplitter : public SplitterWithMaxFiles
 {
 protected:
 	// A flow table that keeps track of all flows (a flow is usually identified by 5-tuple)
-	std::map<uint32_t, int> m_FlowTable;
+	std::map<pcpp::FlowKey, int> m_FlowTable;
 	// a map between the relevant packet value (e.g client-ip) and the file to write the packet to
 	std::map<uint32_t, int> m_ValueToFileTable;
 
@@ -176,6 +176,31 @@ protected:
 	 */
 	ValueBasedSplitter(int maxFiles) : SplitterWithMaxFiles(maxFiles, 1) {}
 
+	/**
+	 * A helper method that extracts the canonical flow key of a packet, so both directions of a connection get the same key.
+	 * If fiveTuple is false the key contains only the IP addresses. Packets that aren't IPv4/IPv6, or aren't TCP/UDP when
+	 * fiveTuple is true, get an empty key so they all belong to the same flow
+	 */
+	pcpp::FlowKey getFlowKey(pcpp::Packet& packet, bool fiveTuple)
+	{
+		pcpp::FlowKey flowKey;
+		if (!flowKey.fromPacket(&packet))
+			return flowKey;
+
+		if (fiveTuple)
+		{
+			if (flowKey.getProtocol() != pcpp::PACKETPP_IPPROTO_TCP && flowKey.getProtocol() != pcpp::PACKETPP_IPPROTO_UDP)
+				return pcpp::FlowKey();
+		}
+		else if (flowKey.isIPv4())
+			flowKey = pcpp::FlowKey(flowKey.getSrcIPv4Address(), flowKey.getDstIPv4Address());
+		else
+			flowKey = pcpp::FlowKey(flowKey.getSrcIPv6Address(), flowKey.getDstIPv6Address());
+
+		flowKey.makeCanonical();
+		return flowKey;
+	}
+
 	/**
 	 * A helper method that gets the packet value and returns the file to write it to, and also a file to close if the
 	 * LRU list is full
@@ -36,6 +36,8 @@
  *   contains
  * - The user can also set a BPF filter to instruct the application to handle only packets filtered by the filter. The rest
  *   of the packets in the input file will be ignored
+ * - The user can also set a flow filter to instruct the application to handle only whole connections whose first packet
+ *   matches the filter, in both directions. The rest of the packets in the input file will be ignored
  * - In options 3-5 & 7 all packets which aren't UDP or TCP (hence don't belong to any connection) will be written to
  *   one output file, separate from the other output files (usually file#0)
  * - Works only on files of the pcap (TCPDUMP) format
@@ -53,6 +55,7 @@
 #include <RawPacket.h>
 #include <Packet.h>
 #include <PcapFileDevice.h>
+#include <StatefulFilter.h>
 #include "SimpleSplitters.h"
 #include "IPPortSplitters.h"
 #include "ConnectionSplitters.h"
@@ -70,6 +73,7 @@ static struct option PcapSplitterOptions[] =
 	{"method", required_argument, 0, 'm'},
 	{"param", required_argument, 0, 'p'},
 	{"filter", required_argument, 0, 'i'},
+	{"flow-filter", required_argument, 0, 'F'},
 	{"help", no_argument, 0, 'h'},
 	{"version", no_argument, 0, 'v'},
 	{0, 0, 0, 0}
@@ -93,6 +97,11 @@ static struct option PcapSplitterOptions[] =
 #define SPLIT_BY_BPF_FILTER    "bpf-filter"
 #define SPLIT_BY_ROUND_ROBIN   "round-robin"
 
+// the flow table of the flow filter: the max number of concurrent connections tracked and the idle timeout after which a
+// connection is forgotten
+#define FLOW_FILTER_MAX_FLOWS          1000000
+#define FLOW_FILTER_IDLE_TIMEOUT_SEC   120
+
 #if defined(WIN32) || defined(WINx64)
 #define SEPARATOR '\\'
 #else
@@ -106,7 +115,7 @@ void printUsage()
 {
 	printf("\nUsage:\n"
 			"-------\n"
-			"%s [-h] [-v] [-i filter] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
+			"%s [-h] [-v] [-i filter] [-F flow_filter] -f pcap_file -o output_dir -m split_method [-p split_param]\n"
 			"\nOptions:\n\n"
 			"    -f pcap_file    : Input pcap file name\n"
 			"    -o output_dir   : The directory where the output files shall be written\n"
@@ -146,6 +155,9 @@ void printUsage()
 			"                      'method = bpf-filter'   => split-param is the BPF filter to match upon\n"
 			"                      'method = round-robin'  => split-param is number of files to round-robin packets between\n"
 			"    -i filter       : Apply a BPF filter, meaning only filtered packets will be counted in the split\n"
+			"    -F flow_filter  : Apply a BPF filter on connections, meaning only connections whose first packet\n"
+			"                      matches the filter will be counted in the split, with all their packets in both\n"
+			"                      directions\n"
 			"    -v              : Displays the current version and exists\n"
 			"    -h              : Displays this help message and exits\n", AppName::get().c_str());
 	exit(0);
@@ -214,6 +226,7 @@ int main(int argc, char* argv[])
 	std::string outputPcapDir = "";
 
 	std::string filter = "";
+	std::string flowFilter = "";
 
 	std::string method = "";
 
@@ -225,7 +238,7 @@ int main(int argc, char* argv[])
 	int optionIndex = 0;
 	char opt = 0;
 
-	while((opt = getopt_long (argc, argv, "f:o:m:p:i:vh", PcapSplitterOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "f:o:m:p:i:F:vh", PcapSplitterOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -247,6 +260,9 @@ int main(int argc, char* argv[])
 			case 'i':
 				filter = optarg;
 				break;
+			case 'F':
+				flowFilter = optarg;
+				break;
 			case 'h':
 				printUsage();
 				break;
@@ -357,6 +373,15 @@ int main(int argc, char* argv[])
 			EXIT_WITH_ERROR("Couldn't set filter '%s'", filter.c_str());
 	}
 
+	// set a flow filter if provided. It's applied on the packets that passed the BPF filter
+	StatefulFilter statefulFilter(FLOW_FILTER_MAX_FLOWS, FLOW_FILTER_IDLE_TIMEOUT_SEC);
+	if (flowFilter != "")
+	{
+		if (!statefulFilter.setFlowFilter(flowFilter))
+			EXIT_WITH_ERROR("Couldn't set flow filter '%s'", flowFilter.c_str());
+		reader->setStatefulFilter(&statefulFilter);
+	}
+
 	printf("Started...\n");
 
 	// determine output file extension
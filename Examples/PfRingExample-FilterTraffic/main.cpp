@@ -32,7 +32,7 @@
 #include "PacketMatchingEngine.h"
 #include <PfRingDeviceList.h>
 #include <PcapFileDevice.h>
-#include <PacketUtils.h>
+#include <FlowKey.h>
 #include <SystemUtils.h>
 #include <PcapPlusPlusVersion.h>
 #include <TablePrinter.h>
@@ -71,7 +71,7 @@ struct CaptureThreadArgs
 {
 	PacketStats* packetStatArr;
 	PacketMatchingEngine* matchingEngine;
-	map<uint32_t, bool>* flowTables;
+	map<FlowKey, bool>* flowTables;
 	PfRingDevice* sendPacketsTo;
 	PcapFileWriterDevice** pcapWriters;
 
@@ -160,9 +160,11 @@ void packetArrived(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId,
 
 		bool packetMatched = false;
 
-		// hash the packet by 5-tuple and look in the flow table to see whether this packet belongs to an existing or new flow
-		uint32_t hash = hash5Tuple(&packet);
-		map<uint32_t, bool>::const_iterator iter = args->flowTables[threadId].find(hash);
+		// extract the packet's flow key and look in the flow table to see whether this packet belongs to an existing or new flow
+		FlowKey flowKey;
+		flowKey.fromPacket(&packet);
+		flowKey.makeCanonical();
+		map<FlowKey, bool>::const_iterator iter = args->flowTables[threadId].find(flowKey);
 
 		// if packet belongs to an already existing flow
 		if (iter !=args->flowTables[threadId].end() && iter->second)
@@ -175,7 +177,7 @@ void packetArrived(RawPacket* packets, uint32_t numOfPackets, uint8_t threadId,
 			if (packetMatched)
 			{
 				// put new flow in flow table
-				args->flowTables[threadId][hash] = true;
+				args->flowTables[threadId][flowKey] = true;
 
 				//collect stats
 				if (packet.isPacketOfType(TCP))
@@ -396,7 +398,7 @@ int main(int argc, char* argv[])
 	PacketMatchingEngine matchingEngine(srcIPToMatch, dstIPToMatch, srcPortToMatch, dstPortToMatch, protocolToMatch);
 
 	// create a flow table for each core
-	map<uint32_t, bool> flowTables[totalNumOfCores];
+	map<FlowKey, bool> flowTables[totalNumOfCores];
 
 	PcapFileWriterDevice** pcapWriters = NULL;
 
@@ -408,7 +410,7 @@ int main(int argc, char* argv[])
 		for (int coreId = 0; coreId < totalNumOfCores; coreId++)
 		{
 			// if core doesn't participate in capturing, skip it
-			if ((coreMask & SystemCores::IdToSystemCore[coreId].Mask) == 0)
+			if (!coreMask.isCoreSet(coreId))
 			{
 				pcapWriters[coreId] = NULL;
 				continue;
@@ -425,7 +427,7 @@ int main(int argc, char* argv[])
 	}
 
 
-	printf("Start capturing on %d threads core mask = 0x%X\n", numOfCaptureThreads, coreMask);
+	printf("Start capturing on %d threads core mask = 0x%s\n", numOfCaptureThreads, coreMask.toHexString().c_str());
 
 	// prepare packet capture configuration
 	CaptureThreadArgs args;
@@ -437,7 +439,7 @@ int main(int argc, char* argv[])
 
 	// start capturing packets on all threads
 	if (!dev->startCaptureMultiThread(packetArrived, &args, coreMask))
-		EXIT_WITH_ERROR("Couldn't start capturing on core mask %X on interface '%s'", coreMask, dev->getDeviceName().c_str());
+		EXIT_WITH_ERROR("Couldn't start capturing on core mask 0x%s on interface '%s'", coreMask.toHexString().c_str(), dev->getDeviceName().c_str());
 
 	bool shouldStop = false;
 
@@ -459,7 +461,7 @@ int main(int argc, char* argv[])
 	{
 		for (int coreId = 0; coreId < totalNumOfCores; coreId++)
 		{
-			if ((coreMask & SystemCores::IdToSystemCore[coreId].Mask) == 0)
+			if (!coreMask.isCoreSet(coreId))
 				continue;
 
 			pcapWriters[coreId]->close();
@@ -5,7 +5,7 @@
 #include "TcpLayer.h"
 #include "IPv4Layer.h"
 #include "PayloadLayer.h"
-#include "PacketUtils.h"
+#include "FlowKey.h"
 #include "SSLLayer.h"
 #include "SystemUtils.h"
 
@@ -128,12 +128,12 @@ public:
 			return;
 
 		// collect general SSL traffic stats on this packet
-		uint32_t hashVal = collectSSLTrafficStats(sslPacket);
+		pcpp::FlowKey flowKey = collectSSLTrafficStats(sslPacket);
 
 		// if packet contains one or more SSL messages, collect stats on them
 		if (sslPacket->isPacketOfType(pcpp::SSL))
 		{
-			collectSSLStats(sslPacket, hashVal);
+			collectSSLStats(sslPacket, flowKey);
 		}
 
 		// calculate current sample time which is the time-span from start time until current time
@@ -237,7 +237,7 @@ private:
 	 * Collect stats relevant for every SSL packet (any SSL message)
 	 * This method calculates and returns the flow key for this packet
 	 */
-	uint32_t collectSSLTrafficStats(pcpp::Packet* sslpPacket)
+	pcpp::FlowKey collectSSLTrafficStats(pcpp::Packet* sslpPacket)
 	{
 		pcpp::TcpLayer* tcpLayer = sslpPacket->getLayerOfType<pcpp::TcpLayer>();
 
@@ -247,11 +247,13 @@ private:
 		// count packet num
 		m_GeneralStats.numOfSSLPackets++;
 
-		// calculate a hash key for this flow to be used in the flow table
-		uint32_t hashVal = hash5Tuple(sslpPacket);
+		// calculate a key for this flow to be used in the flow table. Both directions of the flow get the same key
+		pcpp::FlowKey flowKey;
+		flowKey.fromPacket(sslpPacket);
+		flowKey.makeCanonical();
 
 		// if flow is a new flow (meaning it's not already in the flow table)
-		if (m_FlowTable.find(hashVal) == m_FlowTable.end())
+		if (m_FlowTable.find(flowKey) == m_FlowTable.end())
 		{
 			// count this new flow
 			m_GeneralStats.numOfSSLFlows++;
@@ -264,7 +266,7 @@ private:
 			else
 				m_GeneralStats.sslPortCount[dstPort]++;
 
-			m_FlowTable[hashVal].clear();
+			m_FlowTable[flowKey].clear();
 		}
 
 		// calculate averages
@@ -274,13 +276,13 @@ private:
 			m_GeneralStats.averageNumOfPacketsPerFlow = (double)m_GeneralStats.numOfSSLPackets / (double)m_FlowTable.size();
 		}
 
-		return hashVal;
+		return flowKey;
 	}
 
 	/**
 	 * Collect stats relevant for several kinds SSL messages
 	 */
-	void collectSSLStats(pcpp::Packet* sslPacket, uint32_t flowKey)
+	void collectSSLStats(pcpp::Packet* sslPacket, const pcpp::FlowKey& flowKey)
 	{
 		// go over all SSL messages in this packet
 		pcpp::SSLLayer* sslLayer = sslPacket->getLayerOfType<pcpp::SSLLayer>();
@@ -381,7 +383,7 @@ private:
 	ServerHelloStats m_ServerHelloStats;
 	ServerHelloStats m_PrevServerHelloStats;
 
-	std::map<uint32_t, SSLFlowData> m_FlowTable;
+	std::map<pcpp::FlowKey, SSLFlowData> m_FlowTable;
 
 	double m_LastCalcRateTime;
 	double m_StartTime;
@@ -89,7 +89,7 @@ private:
 
 	// A least-recently-used (LRU) list of all connections seen so far. Each connection is represented by its flow key. This LRU list is used to decide which connection was seen least
 	// recently in case we reached max number of open file descriptors and we need to decide which files to close
-	LRUList<uint32_t>* m_RecentConnsWithActivity;
+	LRUList<FlowKey>* m_RecentConnsWithActivity;
 
 public:
 
@@ -178,13 +178,13 @@ public:
 	/**
 	 * Return a pointer to the least-recently-used (LRU) list of connections
 	 */
-	LRUList<uint32_t>* getRecentConnsWithActivity()
+	LRUList<FlowKey>* getRecentConnsWithActivity()
 	{
 		// This is a lazy implementation - the instance isn't created until the user requests it for the first time.
 		// the side of the LRU list is determined by the max number of allowed open files at any point in time. Default is DEFAULT_MAX_NUMBER_OF_CONCURRENT_OPEN_FILES
 		// but the user can choose another number
 		if (m_RecentConnsWithActivity == NULL)
-			m_RecentConnsWithActivity = new LRUList<uint32_t>(maxOpenFiles);
+			m_RecentConnsWithActivity = new LRUList<FlowKey>(maxOpenFiles);
 
 		// return the pointer
 		return m_RecentConnsWithActivity;
@@ -279,8 +279,8 @@ struct TcpReassemblyData
 
 
 // typedef representing the connection manager and its iterator
-typedef std::map<uint32_t, TcpReassemblyData> TcpReassemblyConnMgr;
-typedef std::map<uint32_t, TcpReassemblyData>::iterator TcpReassemblyConnMgrIter;
+typedef std::map<FlowKey, TcpReassemblyData> TcpReassemblyConnMgr;
+typedef std::map<FlowKey, TcpReassemblyData>::iterator TcpReassemblyConnMgrIter;
 
 
 /**
@@ -365,7 +365,7 @@ static void tcpReassemblyMsgReadyCallback(int sideIndex, const TcpStreamData& tc
 		// add the flow key of this connection to the list of open connections. If the return value isn't NULL it means that there are too many open files
 		// and we need to close the connection with least recently used file(s) in order to open a new one.
 		// The connection with the least recently used file is the return value
-		uint32_t flowKeyToCloseFiles;
+		FlowKey flowKeyToCloseFiles;
 		int result = GlobalConfig::getInstance().getRecentConnsWithActivity()->put(tcpData.getConnectionData().flowKey, &flowKeyToCloseFiles);
 
 		// if result equals to 1 it means we need to close the open files in this connection (the one with the least recently used files)
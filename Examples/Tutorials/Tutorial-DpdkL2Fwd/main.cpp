@@ -101,10 +101,10 @@ int main(int argc, char* argv[])
 	workers.push_back(new L2FwdWorkerThread(device2, device1));
 
 	// Create core mask - use core 1 and 2 for the two threads
-	int workersCoreMask = 0;
+	pcpp::CoreMask workersCoreMask;
 	for (int i = 1; i <= 2; i++)
 	{
-		workersCoreMask = workersCoreMask | (1 << (i+1));
+		workersCoreMask.addCore(i);
 	}
 
 	// Start capture in async mode
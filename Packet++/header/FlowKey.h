@@ -0,0 +1,249 @@
+#ifndef PACKETPP_FLOW_KEY
+#define PACKETPP_FLOW_KEY
+
+#include "IpAddress.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <string>
+
+/// @file
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class Packet;
+
+	/**
+	 * @class FlowKey
+	 * A compact value type that identifies a flow: source and destination IPv4/IPv6 addresses, IP protocol, source and destination
+	 * TCP/UDP ports, and optionally a VLAN ID and a tunnel ID. It can be extracted from a parsed packet in a single pass over its layers
+	 * (see fromPacket()), compared, ordered (so it can be used as a std::map key) and hashed.<BR>
+	 * A flow key is directional: the keys of the two directions of a connection are different. The canonical form of a key orders the
+	 * two endpoints (IP address and port) so both directions of a connection have the same canonical key. Use makeCanonical() or
+	 * getCanonical() to get it, or symmetricHash() to hash it directly.<BR>
+	 * hash() is CRC32C when the library is compiled with SSE4.2 support (for example with -msse4.2 or -march=native) and xxHash32
+	 * otherwise, so hash values should not be stored or compared between different builds or platforms
+	 */
+	class FlowKey
+	{
+	public:
+
+		/**
+		 * A c'tor that creates an empty key. isValid() returns false for an empty key
+		 */
+		FlowKey();
+
+		/**
+		 * A c'tor that creates an IPv4 flow key
+		 * @param[in] srcIP Source IPv4 address
+		 * @param[in] dstIP Destination IPv4 address
+		 * @param[in] protocol IP protocol number (for example ::PACKETPP_IPPROTO_TCP). The default is 0
+		 * @param[in] srcPort Source port (in host byte order). The default is 0
+		 * @param[in] dstPort Destination port (in host byte order). The default is 0
+		 * @param[in] vlanId VLAN ID. The default is 0 (no VLAN)
+		 * @param[in] tunnelId Tunnel ID. The default is 0 (no tunnel)
+		 */
+		FlowKey(const IPv4Address& srcIP, const IPv4Address& dstIP, uint8_t protocol = 0, uint16_t srcPort = 0, uint16_t dstPort = 0,
+				uint16_t vlanId = 0, uint32_t tunnelId = 0);
+
+		/**
+		 * A c'tor that creates an IPv6 flow key
+		 * @param[in] srcIP Source IPv6 address
+		 * @param[in] dstIP Destination IPv6 address
+		 * @param[in] protocol IP protocol number (for example ::PACKETPP_IPPROTO_TCP). The default is 0
+		 * @param[in] srcPort Source port (in host byte order). The default is 0
+		 * @param[in] dstPort Destination port (in host byte order). The default is 0
+		 * @param[in] vlanId VLAN ID. The default is 0 (no VLAN)
+		 * @param[in] tunnelId Tunnel ID. The default is 0 (no tunnel)
+		 */
+		FlowKey(const IPv6Address& srcIP, const IPv6Address& dstIP, uint8_t protocol = 0, uint16_t srcPort = 0, uint16_t dstPort = 0,
+				uint16_t vlanId = 0, uint32_t tunnelId = 0);
+
+		/**
+		 * Extract the flow key of a parsed packet. The packet layers are traversed once:
+		 * - The VLAN ID is taken from the outermost VLAN tag in front of the IP layer
+		 * - The IP addresses and protocol are taken from the innermost IPv4/IPv6 layer, so tunneled packets are keyed by the tunneled flow
+		 * - The ports are taken from the TCP/UDP layer following that IP layer. They're 0 for other protocols and for IP fragments
+		 * - The tunnel ID is the GRE key (GREv0), call ID (GREv1), VNI (VXLAN) or TEID (GTPv1) of the innermost tunnel
+		 * - In ICMP packets the key ends at the ICMP layer, the IP and transport headers quoted inside ICMP messages are ignored<BR>
+		 * For IPv6 packets without a TCP/UDP layer the protocol is the next header value of the IPv6 base header
+		 * @param[in] packet The packet to extract the key from
+		 * @return True if the packet contains an IPv4 or IPv6 layer and the key was extracted, false otherwise (in which case the key is
+		 * empty)
+		 */
+		bool fromPacket(Packet* packet);
+
+		/**
+		 * Extract the flow key directly from raw packet data without parsing it into layers, which is much cheaper than fromPacket() in
+		 * per-packet paths. The result is the same as the one of fromPacket() for plain (non-tunneled) IPv4/IPv6 traffic:
+		 * - The headers are found by parseRawPacketHeaders(), which lists the supported link types, VLAN tags and IPv6 extension
+		 *   headers. The VLAN ID is taken from the outer VLAN tag
+		 * - The ports are taken from TCP/UDP headers. They're 0 for other protocols and for IP fragments, including the first
+		 *   fragment of a datagram, so all fragments between two hosts share one key, which is different than the key of their
+		 *   datagram's connection
+		 * - Tunnels aren't followed: a tunneled packet is keyed by its outer IP header, with the tunnel protocol (for example GRE) as
+		 *   the protocol and no tunnel ID
+		 * @param[in] data A pointer to the raw packet data
+		 * @param[in] dataLen The raw packet data length
+		 * @param[in] linkType The link layer type of the packet
+		 * @return True if the packet is an IPv4 or IPv6 packet of a supported link type and the key was extracted, false otherwise (in
+		 * which case the key is empty)
+		 */
+		bool fromRawData(const uint8_t* data, int dataLen, LinkLayerType linkType);
+
+		/**
+		 * @return True if this key holds an IPv4 or IPv6 flow, false if it's empty
+		 */
+		bool isValid() const { return m_IPVersion != 0; }
+
+		/**
+		 * @return True if this key holds an IPv4 flow
+		 */
+		bool isIPv4() const { return m_IPVersion == 4; }
+
+		/**
+		 * @return True if this key holds an IPv6 flow
+		 */
+		bool isIPv6() const { return m_IPVersion == 6; }
+
+		/**
+		 * @return The source IPv4 address, or IPv4Address#Zero if this key isn't an IPv4 key
+		 */
+		IPv4Address getSrcIPv4Address() const;
+
+		/**
+		 * @return The destination IPv4 address, or IPv4Address#Zero if this key isn't an IPv4 key
+		 */
+		IPv4Address getDstIPv4Address() const;
+
+		/**
+		 * @return The source IPv6 address, or IPv6Address#Zero if this key isn't an IPv6 key
+		 */
+		IPv6Address getSrcIPv6Address() const;
+
+		/**
+		 * @return The destination IPv6 address, or IPv6Address#Zero if this key isn't an IPv6 key
+		 */
+		IPv6Address getDstIPv6Address() const;
+
+		/**
+		 * @return A pointer to the 16 bytes of the source address in network byte order. An IPv4 address takes the first 4 bytes and the
+		 * rest are zero. Unlike getSrcIPv4Address() and getSrcIPv6Address() no address object is created, which matters in fast paths
+		 */
+		const uint8_t* getSrcIPData() const { return m_SrcIP; }
+
+		/**
+		 * @return A pointer to the 16 bytes of the destination address in network byte order, laid out as in getSrcIPData()
+		 */
+		const uint8_t* getDstIPData() const { return m_DstIP; }
+
+		/**
+		 * @return The source port in host byte order
+		 */
+		uint16_t getSrcPort() const { return m_SrcPort; }
+
+		/**
+		 * @return The destination port in host byte order
+		 */
+		uint16_t getDstPort() const { return m_DstPort; }
+
+		/**
+		 * @return The IP protocol number
+		 */
+		uint8_t getProtocol() const { return m_Protocol; }
+
+		/**
+		 * @return The VLAN ID or 0 if there is none
+		 */
+		uint16_t getVlanId() const { return m_VlanId; }
+
+		/**
+		 * @return The tunnel ID or 0 if there is none
+		 */
+		uint32_t getTunnelId() const { return m_TunnelId; }
+
+		/**
+		 * @return True if this key is in its canonical form, meaning the source endpoint (IP address and port) isn't greater than the
+		 * destination endpoint
+		 */
+		bool isCanonical() const;
+
+		/**
+		 * Convert this key to its canonical form by swapping the source and destination endpoints if needed
+		 * @return True if the endpoints were swapped, false if the key was already canonical
+		 */
+		bool makeCanonical();
+
+		/**
+		 * @return A copy of this key in its canonical form
+		 */
+		FlowKey getCanonical() const;
+
+		/**
+		 * @return A copy of this key with the source and destination endpoints swapped, which is the key of the opposite direction
+		 */
+		FlowKey getReversed() const;
+
+		/**
+		 * Calculate a hash of the key. Different directions of the same connection get different values
+		 * @param[in] seed A seed to mix into the hash. The default is 0
+		 * @return The hash value
+		 */
+		uint32_t hash(uint32_t seed = 0) const;
+
+		/**
+		 * Calculate a hash of the canonical form of the key, so both directions of a connection get the same value
+		 * @param[in] seed A seed to mix into the hash. The default is 0
+		 * @return The hash value
+		 */
+		uint32_t symmetricHash(uint32_t seed = 0) const;
+
+		/**
+		 * @return A string representation of the key, for example: "TCP 10.0.0.1:1234 -> 10.0.0.2:80"
+		 */
+		std::string toString() const;
+
+		/**
+		 * Compare two keys
+		 * @param[in] other The key to compare with
+		 * @return True if all fields of both keys are equal
+		 */
+		bool operator==(const FlowKey& other) const;
+
+		/**
+		 * Compare two keys
+		 * @param[in] other The key to compare with
+		 * @return True if any field of the keys is different
+		 */
+		bool operator!=(const FlowKey& other) const { return !(*this == other); }
+
+		/**
+		 * A strict weak ordering of keys, so they can be used in ordered containers such as std::map. The order itself has no meaning
+		 * @param[in] other The key to compare with
+		 * @return True if this key is ordered before the other key
+		 */
+		bool operator<(const FlowKey& other) const;
+
+	private:
+		// the members are laid out without padding so the key can be hashed and compared as a byte array. IPv4 addresses are stored
+		// in the first 4 bytes of the address arrays and the rest is zeroed
+		uint8_t m_SrcIP[16];
+		uint8_t m_DstIP[16];
+		uint32_t m_TunnelId;
+		uint16_t m_SrcPort;
+		uint16_t m_DstPort;
+		uint16_t m_VlanId;
+		uint8_t m_Protocol;
+		uint8_t m_IPVersion;
+
+		void clear();
+		void swapEndpoints();
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_FLOW_KEY */
@@ -4,6 +4,7 @@
 #include "Packet.h"
 #include "LRUList.h"
 #include "IpAddress.h"
+#include "FlowKey.h"
 #include "PointerVector.h"
 #include <map>
 
@@ -79,9 +80,15 @@ namespace pcpp
 			virtual ~PacketKey() {}
 
 			/**
-			 * @return A 4-byte hash value of the packet key
+			 * @return A 4-byte hash value of the packet key, which is the hash of getFlowKey()
 			 */
-			virtual uint32_t getHashValue() const = 0;
+			uint32_t getHashValue() const { return getFlowKey().hash(); }
+
+			/**
+			 * @return A FlowKey that uniquely identifies the packet. It contains the source and destination IP addresses, and the
+			 * IP ID (IPv4) or fragment ID (IPv6) is stored in its tunnel ID field
+			 */
+			virtual FlowKey getFlowKey() const = 0;
 
 			/**
 			 * @return The IP protocol this key represents (pcpp#IPv4 or pcpp#IPv6)
@@ -177,7 +184,7 @@ namespace pcpp
 
 			// implement abstract methods
 
-			uint32_t getHashValue() const;
+			FlowKey getFlowKey() const { return FlowKey(m_SrcIP, m_DstIP, 0, 0, 0, 0, m_IpID); }
 
 			/**
 			 * @return pcpp#IPv4 protocol
@@ -269,7 +276,7 @@ namespace pcpp
 
 			// implement abstract methods
 
-			uint32_t getHashValue() const;
+			FlowKey getFlowKey() const { return FlowKey(m_SrcIP, m_DstIP, 0, 0, 0, 0, m_FragmentID); }
 
 			/**
 			 * @return pcpp#IPv6 protocol
@@ -443,12 +450,12 @@ namespace pcpp
 			~IPFragmentData() { delete packetKey; if (deleteData && data != NULL) { delete data; } }
 		};
 
-		LRUList<uint32_t> m_PacketLRU;
-		std::map<uint32_t, IPFragmentData*> m_FragmentMap;
+		LRUList<FlowKey> m_PacketLRU;
+		std::map<FlowKey, IPFragmentData*> m_FragmentMap;
 		OnFragmentsClean m_OnFragmentsCleanCallback;
 		void* m_CallbackUserCookie;
 
-		void addNewFragment(uint32_t hash, IPFragmentData* fragData);
+		void addNewFragment(const FlowKey& flowKey, IPFragmentData* fragData);
 		bool matchOutOfOrderFragments(IPFragmentData* fragData);
 	};
 
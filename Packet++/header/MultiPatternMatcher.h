@@ -0,0 +1,238 @@
+#ifndef PACKETPP_MULTI_PATTERN_MATCHER
+#define PACKETPP_MULTI_PATTERN_MATCHER
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @file
+ * This file provides MultiPatternMatcher, an Aho-Corasick matcher that finds all the occurrences of a large number of byte patterns
+ * (for example signature or IOC lists) in a single pass over the data, whatever the number of patterns. It can search a single buffer
+ * such as a layer payload (see Layer#getLayerPayload()) or a stream that arrives in chunks, such as the data TcpReassembly delivers, in
+ * which case matches that span chunk boundaries are found as well
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class Layer;
+
+	/**
+	 * @struct PatternMatch
+	 * A single occurrence of a pattern found by MultiPatternMatcher
+	 */
+	struct PatternMatch
+	{
+		/** The ID of the pattern, as returned by MultiPatternMatcher#addPattern() */
+		uint32_t patternId;
+		/** The offset of the byte following the last byte of the occurrence. For a stream search it's the offset from the beginning of the
+		 * stream, otherwise from the beginning of the searched data. The occurrence starts at endOffset minus the pattern length */
+		uint64_t endOffset;
+	};
+
+
+	/**
+	 * @class MultiPatternMatcher
+	 * A multi-pattern matcher based on the Aho-Corasick algorithm. Patterns are added with addPattern() and then compiled once by compile()
+	 * into a DFA, after which searching costs a single table lookup per byte of data regardless of the number of patterns, and reports
+	 * every occurrence of every pattern, including overlapping ones.<BR>
+	 * To keep the DFA compact, bytes that don't appear in any pattern share a single column of the transition table, so the table size
+	 * depends on the number of distinct bytes in the patterns rather than on the whole byte range. In addition, while no pattern is
+	 * partially matched the search skips ahead to the next byte that may start a pattern. When the patterns start with a few distinct
+	 * bytes only (which is typical for short patterns and for patterns sharing a prefix) this skip uses SSE2 to test 16 bytes at a time.<BR>
+	 * A compiled matcher isn't changed by searches, so it may be used by several threads at the same time. The state of a stream search
+	 * is kept by the caller in a StreamState, one per stream. For example, to search TCP connections each side of each connection
+	 * needs its own StreamState (indexed by ConnectionData#flowKey and the side), which is passed along with the data to search() from the
+	 * TcpReassembly#OnTcpMessageReady callback
+	 */
+	class MultiPatternMatcher
+	{
+	public:
+
+		/**
+		 * @typedef OnPatternMatch
+		 * A callback invoked for every occurrence of a pattern found by search()
+		 * @param[in] match The occurrence found
+		 * @param[in] userCookie A pointer to the object given by the user to search()
+		 */
+		typedef void (*OnPatternMatch)(const PatternMatch& match, void* userCookie);
+
+		/**
+		 * @struct StreamState
+		 * The state of a stream search: the DFA state at the end of the data searched so far and the stream offset of that data, so a
+		 * pattern that starts in one chunk and ends in the next one is found. A new StreamState starts a new stream
+		 */
+		struct StreamState
+		{
+			/** The DFA state */
+			uint32_t state;
+			/** The number of bytes searched so far */
+			uint64_t offset;
+
+			/**
+			 * A c'tor for this struct. Creates the state of a new stream
+			 */
+			StreamState() : state(0), offset(0) {}
+
+			/**
+			 * Reset the state so it can be used for a new stream
+			 */
+			void reset() { state = 0; offset = 0; }
+		};
+
+		/**
+		 * A c'tor for this class. Creates a matcher without patterns
+		 * @param[in] caseInsensitive If true ASCII letters in patterns and data are matched regardless of their case. The default is
+		 * false, meaning patterns are matched byte by byte
+		 */
+		MultiPatternMatcher(bool caseInsensitive = false);
+
+		/**
+		 * Add a pattern. Patterns can't be added after compile() was called, unless clear() is called first
+		 * @param[in] pattern A pointer to the pattern bytes
+		 * @param[in] patternLen The pattern length, must be greater than 0
+		 * @return The ID of the pattern, which is the number of patterns added before it, or -1 if the pattern is empty or the matcher
+		 * is already compiled (in which case an error is written to log). Adding the same pattern twice gives it two IDs and both
+		 * are reported on every occurrence
+		 */
+		int addPattern(const uint8_t* pattern, size_t patternLen);
+
+		/**
+		 * Add a pattern given as a string. The string bytes are matched as they are, so it may contain any byte value
+		 * @param[in] pattern The pattern to add
+		 * @return The ID of the pattern or -1 if it can't be added, see addPattern(const uint8_t*, size_t)
+		 */
+		int addPattern(const std::string& pattern);
+
+		/**
+		 * Parse a pattern given as text, where every byte can also be written in hex: "\x" followed by 2 hex digits. "\\" stands for a
+		 * single backslash, for example "GET /\x00\x01" or "\x4d\x5a\x90"
+		 * @param[in] patternAsText The pattern text
+		 * @param[out] pattern The parsed pattern bytes
+		 * @return True if the text was parsed, false if it contains an invalid escape sequence (in which case an error is written to log)
+		 */
+		static bool parsePattern(const std::string& patternAsText, std::string& pattern);
+
+		/**
+		 * Build the DFA of all the patterns added so far. A matcher must be compiled before it can search
+		 * @return True if the DFA was built, false if there are no patterns or the DFA is too large (in which case an error is written
+		 * to log)
+		 */
+		bool compile();
+
+		/**
+		 * Remove all the patterns and the DFA, so new patterns can be added
+		 */
+		void clear();
+
+		/**
+		 * @return True if the matcher is compiled
+		 */
+		bool isCompiled() const { return !m_Transitions.empty(); }
+
+		/**
+		 * @return The number of patterns added
+		 */
+		size_t getNumOfPatterns() const { return m_Patterns.size(); }
+
+		/**
+		 * @param[in] patternId The ID of a pattern
+		 * @return The pattern, or an empty string if the ID is invalid
+		 */
+		std::string getPattern(uint32_t patternId) const;
+
+		/**
+		 * @return The number of DFA states, 0 if the matcher isn't compiled
+		 */
+		size_t getNumOfStates() const { return (m_NumOfClasses == 0 ? 0 : m_Transitions.size() / m_NumOfClasses); }
+
+		/**
+		 * @return The size in bytes of the DFA transition table, 0 if the matcher isn't compiled
+		 */
+		size_t getTransitionTableSize() const { return m_Transitions.size() * sizeof(uint32_t); }
+
+		/**
+		 * Search data for all the patterns
+		 * @param[in] data A pointer to the data to search
+		 * @param[in] dataLen The data length
+		 * @param[out] matches A vector the occurrences are appended to, ordered by their end offset (occurrences with the same end
+		 * offset are ordered from the longest pattern to the shortest)
+		 * @return The number of occurrences found
+		 */
+		size_t search(const uint8_t* data, size_t dataLen, std::vector<PatternMatch>& matches) const;
+
+		/**
+		 * Search data for all the patterns and invoke a callback for each occurrence
+		 * @param[in] data A pointer to the data to search
+		 * @param[in] dataLen The data length
+		 * @param[in] onMatch The callback to invoke for each occurrence, in the order described in search(const uint8_t*, size_t, std::vector<PatternMatch>&)
+		 * @param[in] userCookie A pointer to an object that is passed to the callback
+		 * @return The number of occurrences found
+		 */
+		size_t search(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Search the next chunk of a stream for all the patterns, including occurrences that started in previous chunks
+		 * @param[in,out] state The state of the stream, updated to the end of this chunk
+		 * @param[in] data A pointer to the chunk
+		 * @param[in] dataLen The chunk length
+		 * @param[in] onMatch The callback to invoke for each occurrence, with offsets from the beginning of the stream
+		 * @param[in] userCookie A pointer to an object that is passed to the callback
+		 * @return The number of occurrences found in this chunk
+		 */
+		size_t search(StreamState& state, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie = NULL) const;
+
+		/**
+		 * Search the payload of a layer (see Layer#getLayerPayload()) for all the patterns
+		 * @param[in] layer The layer whose payload is searched
+		 * @param[out] matches A vector the occurrences are appended to, with offsets from the beginning of the payload
+		 * @return The number of occurrences found
+		 */
+		size_t searchLayerPayload(const Layer& layer, std::vector<PatternMatch>& matches) const;
+
+		/**
+		 * Check whether data contains any of the patterns. The search stops at the first occurrence found
+		 * @param[in] data A pointer to the data to search
+		 * @param[in] dataLen The data length
+		 * @return True if the data contains at least one of the patterns
+		 */
+		bool matchesAny(const uint8_t* data, size_t dataLen) const;
+
+	private:
+		bool m_CaseInsensitive;
+		std::vector<std::string> m_Patterns;
+
+		// the DFA: a row of m_NumOfClasses transitions per state. Each transition holds the row offset of the next state, with
+		// PCPP_PATTERN_MATCH_FLAG set if patterns end in that state
+		std::vector<uint32_t> m_Transitions;
+		uint16_t m_ByteClasses[256];
+		uint32_t m_NumOfClasses;
+
+		// the patterns that end in each state: the patterns of the state itself followed by those of its dictionary suffix link,
+		// which is the next state on its failure chain that has patterns
+		std::vector<uint32_t> m_OutputStart;
+		std::vector<uint32_t> m_OutputIds;
+		std::vector<uint32_t> m_DictionaryLink;
+
+		// the bytes that leave the initial state, used to skip data while no pattern is partially matched
+		std::vector<uint8_t> m_StartBytes;
+		bool m_IsStartByte[256];
+
+		// a search never changes the matcher, but copying one isn't useful and costs the whole DFA
+		MultiPatternMatcher(const MultiPatternMatcher& other);
+		MultiPatternMatcher& operator=(const MultiPatternMatcher& other);
+
+		size_t skipToStartByte(const uint8_t* data, size_t offset, size_t dataLen) const;
+		size_t reportMatches(uint32_t state, uint64_t endOffset, std::vector<PatternMatch>* matches, OnPatternMatch onMatch, void* userCookie) const;
+		size_t run(uint32_t& state, uint64_t baseOffset, const uint8_t* data, size_t dataLen, std::vector<PatternMatch>* matches, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const;
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_MULTI_PATTERN_MATCHER */
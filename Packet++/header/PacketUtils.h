@@ -15,7 +15,8 @@ namespace pcpp
 	/**
 	 * A method that is given a packet and calculates a hash value by the packet's 5-tuple. Supports IPv4, IPv6,
 	 * TCP and UDP. For packets which doesn't have 5-tuple (for example: packets which aren't IPv4/6 or aren't
-	 * TCP/UDP) the value of 0 will be returned
+	 * TCP/UDP) the value of 0 will be returned. The hash is symmetric, meaning both directions of a connection get the same
+	 * value. Use FlowKey when a collision-free flow key is needed
 	 * @param[in] packet The packet to calculate hash for
 	 * @return The hash value calculated for this packet or 0 if the packet doesn't contain 5-tuple
 	 */
@@ -23,12 +24,74 @@ namespace pcpp
 
 	/**
 	 * A method that is given a packet and calculates a hash value by the packet's 2-tuple (IP src + IP dst). Supports
-	 * IPv4 and IPv6. For packets which aren't IPv4/6 the value of 0 will be returned
+	 * IPv4 and IPv6. For packets which aren't IPv4/6 the value of 0 will be returned. The hash is symmetric, meaning both
+	 * directions of a connection get the same value
 	 * @param[in] packet The packet to calculate hash for
 	 * @return The hash value calculated for this packet or 0 if the packet isn't IPv4/6
 	 */
 	uint32_t hash2Tuple(Packet* packet);
 
+	/**
+	 * @struct RawPacketHeaders
+	 * The network and transport headers of raw packet data, as found by parseRawPacketHeaders()
+	 */
+	struct RawPacketHeaders
+	{
+		/** The EtherType of the network layer: PCPP_ETHERTYPE_IP or PCPP_ETHERTYPE_IPV6 */
+		uint16_t etherType;
+		/** The VLAN ID of the outer VLAN tag, or 0 if the packet isn't VLAN tagged */
+		uint16_t vlanId;
+		/** A pointer to the IPv4 or IPv6 header */
+		const uint8_t* ipHeader;
+		/** The number of bytes from the start of the IP header to the end of the data */
+		int ipDataLen;
+		/** The protocol field of the IPv4 header, or the next header field of the IPv6 base header */
+		uint8_t ipProtocol;
+		/** The protocol of the header that follows the IPv4 header or the IPv6 extension headers */
+		uint8_t transportProtocol;
+		/** True if the packet is an IPv4 fragment (including the first one) or has an IPv6 fragment header */
+		bool isFragment;
+		/**
+		 * The offset of the header that follows the IPv4 header or the IPv6 extension headers, from the start of the IP header. It's -1
+		 * in fragments and if less than 4 bytes of that header are in the data, otherwise its first 4 bytes, which are the ports of
+		 * TCP, UDP and SCTP headers, may be read
+		 */
+		int transportOffset;
+	};
+
+	/**
+	 * Find where the network layer of raw packet data starts. This is the link layer part of parseRawPacketHeaders(), for code that
+	 * walks the headers by itself
+	 * @param[in] linkType The link layer type of the data. Ethernet, Linux cooked capture (SLL), NULL/loopback and raw IP link types
+	 * are supported
+	 * @param[out] etherTypeOffset The offset of the EtherType field, or -1 if the link layer has no EtherType field, in which case the
+	 * network protocol is identified by the IP version
+	 * @param[out] networkOffset The offset of the network layer, or of the first VLAN tag if the packet is VLAN tagged
+	 * @return True if the link type is supported, false otherwise
+	 */
+	bool getRawNetworkLayerOffsets(LinkLayerType linkType, int& etherTypeOffset, int& networkOffset);
+
+	/**
+	 * @param[in] etherType An EtherType in host byte order
+	 * @return True if the EtherType is of a VLAN tag: 802.1Q, 802.1ad (QinQ) or 0x9100, which is used by older QinQ devices
+	 */
+	bool isVlanEtherType(uint16_t etherType);
+
+	/**
+	 * Find the IP and transport headers of raw packet data without parsing it into layers, which is much cheaper than creating a Packet
+	 * in per-packet paths. This is the header walk shared by FlowKey#fromRawData(), PacketSampler, ToeplitzHash and NativeFilter:
+	 * - Up to 2 VLAN tags are skipped (see isVlanEtherType()), the VLAN ID is taken from the outer one
+	 * - Like IPv6Layer, IPv6 hop-by-hop, routing, destination options and authentication headers are skipped to find the transport
+	 *   header, which isn't looked for after a fragment header
+	 * - Tunnels aren't followed
+	 * @param[in] data A pointer to the raw packet data
+	 * @param[in] dataLen The raw packet data length
+	 * @param[in] linkType The link layer type of the data, see getRawNetworkLayerOffsets()
+	 * @param[out] headers The headers found
+	 * @return True if the data is an IPv4 or IPv6 packet of a supported link type whose IP header is complete, false otherwise
+	 */
+	bool parseRawPacketHeaders(const uint8_t* data, int dataLen, LinkLayerType linkType, RawPacketHeaders& headers);
+
 } // namespace pcpp
 
 #endif /* PACKETPP_PACKET_UTILS */
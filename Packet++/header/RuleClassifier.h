@@ -0,0 +1,347 @@
+#ifndef PACKETPP_RULE_CLASSIFIER
+#define PACKETPP_RULE_CLASSIFIER
+
+#include "FlowKey.h"
+#include "IpAddress.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+/**
+ * @file
+ * This file provides RuleClassifier, a packet classifier for large rule sets (ACLs) of 5-tuple rules: source and destination IP
+ * prefixes, IP protocol and source and destination port ranges, each rule with a priority. Packets are classified by their FlowKey,
+ * one at a time or in batches
+ */
+
+/**
+ * \namespace pcpp
+ * \brief The main namespace for the PcapPlusPlus lib
+ */
+namespace pcpp
+{
+
+	class Packet;
+
+	/**
+	 * @class ClassifierRule
+	 * A 5-tuple rule for RuleClassifier. A new rule matches every packet, each setter narrows it down:
+	 * - setSrcIPv4() / setSrcIPv6() and setDstIPv4() / setDstIPv6() limit the rule to a source or destination prefix. Setting an IPv4 prefix
+	 *   limits the rule to IPv4 packets and setting an IPv6 prefix limits it to IPv6 packets, so source and destination prefixes must be of
+	 *   the same IP version. A prefix length of 0 matches any address of that version
+	 * - setProtocol() limits the rule to an IP protocol
+	 * - setSrcPortRange() / setDstPortRange() limit the rule to a range of TCP/UDP ports. Packets without ports (see FlowKey#fromPacket())
+	 *   have port 0
+	 *
+	 * Every rule has an ID chosen by the user, which must be unique within a classifier, and a priority. When several rules match a
+	 * packet the one with the highest priority wins, and among rules with the same priority the one added to the classifier first wins
+	 */
+	class ClassifierRule
+	{
+		friend class RuleClassifier;
+	public:
+
+		/**
+		 * A c'tor for this class that creates a rule matching every packet
+		 * @param[in] ruleId The rule ID
+		 * @param[in] priority The rule priority, higher values win
+		 */
+		ClassifierRule(uint32_t ruleId, int priority);
+
+		/**
+		 * Limit the rule to packets whose source address is in an IPv4 prefix
+		 * @param[in] address The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLen The prefix length, between 0 and 32
+		 * @return True if the prefix was set, false if the prefix length is out of range or if the rule already has an IPv6 prefix. In
+		 * this case an error is written to log
+		 */
+		bool setSrcIPv4(const IPv4Address& address, int prefixLen);
+
+		/**
+		 * Limit the rule to packets whose destination address is in an IPv4 prefix
+		 * @param[in] address The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLen The prefix length, between 0 and 32
+		 * @return True if the prefix was set, false if the prefix length is out of range or if the rule already has an IPv6 prefix. In
+		 * this case an error is written to log
+		 */
+		bool setDstIPv4(const IPv4Address& address, int prefixLen);
+
+		/**
+		 * Limit the rule to packets whose source address is in an IPv6 prefix
+		 * @param[in] address The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLen The prefix length, between 0 and 128
+		 * @return True if the prefix was set, false if the prefix length is out of range or if the rule already has an IPv4 prefix. In
+		 * this case an error is written to log
+		 */
+		bool setSrcIPv6(const IPv6Address& address, int prefixLen);
+
+		/**
+		 * Limit the rule to packets whose destination address is in an IPv6 prefix
+		 * @param[in] address The prefix address. Bits beyond the prefix length are ignored
+		 * @param[in] prefixLen The prefix length, between 0 and 128
+		 * @return True if the prefix was set, false if the prefix length is out of range or if the rule already has an IPv4 prefix. In
+		 * this case an error is written to log
+		 */
+		bool setDstIPv6(const IPv6Address& address, int prefixLen);
+
+		/**
+		 * Limit the rule to an IP protocol
+		 * @param[in] protocol The IP protocol number, for example ::PACKETPP_IPPROTO_TCP
+		 */
+		void setProtocol(uint8_t protocol);
+
+		/**
+		 * Limit the rule to a range of source ports
+		 * @param[in] fromPort The lower end of the range
+		 * @param[in] toPort The higher end of the range (inclusive)
+		 * @return True if the range was set, false if fromPort is greater than toPort (in which case an error is written to log)
+		 */
+		bool setSrcPortRange(uint16_t fromPort, uint16_t toPort);
+
+		/**
+		 * Limit the rule to a range of destination ports
+		 * @param[in] fromPort The lower end of the range
+		 * @param[in] toPort The higher end of the range (inclusive)
+		 * @return True if the range was set, false if fromPort is greater than toPort (in which case an error is written to log)
+		 */
+		bool setDstPortRange(uint16_t fromPort, uint16_t toPort);
+
+		/**
+		 * @return The rule ID
+		 */
+		uint32_t getRuleId() const { return m_RuleId; }
+
+		/**
+		 * @return The rule priority
+		 */
+		int getPriority() const { return m_Priority; }
+
+		/**
+		 * @return 4 or 6 if the rule is limited to IPv4 or IPv6 packets, 0 if it matches both
+		 */
+		uint8_t getIPVersion() const { return m_IPVersion; }
+
+		/**
+		 * @return The source prefix length, 0 if the rule matches any source address
+		 */
+		int getSrcPrefixLen() const { return m_SrcPrefixLen; }
+
+		/**
+		 * @return The destination prefix length, 0 if the rule matches any destination address
+		 */
+		int getDstPrefixLen() const { return m_DstPrefixLen; }
+
+		/**
+		 * @return True if the rule is limited to an IP protocol
+		 */
+		bool hasProtocol() const { return m_HasProtocol; }
+
+		/**
+		 * @return The IP protocol the rule is limited to. Relevant only if hasProtocol() is true
+		 */
+		uint8_t getProtocol() const { return m_Protocol; }
+
+		/**
+		 * @return The lower end of the source port range
+		 */
+		uint16_t getSrcPortFrom() const { return m_SrcPortFrom; }
+
+		/**
+		 * @return The higher end of the source port range
+		 */
+		uint16_t getSrcPortTo() const { return m_SrcPortTo; }
+
+		/**
+		 * @return The lower end of the destination port range
+		 */
+		uint16_t getDstPortFrom() const { return m_DstPortFrom; }
+
+		/**
+		 * @return The higher end of the destination port range
+		 */
+		uint16_t getDstPortTo() const { return m_DstPortTo; }
+
+		/**
+		 * Match a flow key with this rule directly, without a classifier. This is mostly useful for testing, classifying with a
+		 * RuleClassifier is much faster for more than a few rules
+		 * @param[in] key The flow key to match
+		 * @return True if the key matches the rule
+		 */
+		bool matchFlowKey(const FlowKey& key) const;
+
+	private:
+		uint32_t m_RuleId;
+		int m_Priority;
+		uint8_t m_IPVersion;
+		uint8_t m_SrcPrefixLen;
+		uint8_t m_DstPrefixLen;
+		bool m_HasProtocol;
+		uint8_t m_Protocol;
+		uint16_t m_SrcPortFrom;
+		uint16_t m_SrcPortTo;
+		uint16_t m_DstPortFrom;
+		uint16_t m_DstPortTo;
+		// the prefixes in network byte order with the bits beyond the prefix length cleared
+		uint8_t m_SrcIP[16];
+		uint8_t m_DstIP[16];
+
+		bool setPrefix(uint8_t* prefixData, uint8_t& prefixLenField, const uint8_t* addressData, uint8_t ipVersion, int prefixLen);
+	};
+
+
+	/**
+	 * @class RuleClassifier
+	 * A classifier that finds the highest priority ClassifierRule matching a packet, built for rule sets of tens of thousands of rules.<BR>
+	 * Rules are grouped into tuples by their shape: IP version, source and destination prefix lengths, and whether the protocol and each
+	 * of the ports is an exact value. Each tuple is a hash table keyed by the rule fields masked to that shape, so classifying a packet
+	 * takes one hash lookup per tuple no matter how many rules there are (tuple space search). Rules with port ranges that aren't a single
+	 * port are checked one by one after the hash lookup, so rule sets with many different ranges over the same prefixes are slower.
+	 * Tuples are searched from the highest priority they contain down and the search stops as soon as no remaining tuple can hold a
+	 * better rule.<BR>
+	 * Rules can be added and removed at any time, each update only touches the tuple of the rule. The classifier isn't thread-safe for
+	 * updates, but classification methods are const and can run from several threads when the rules don't change
+	 */
+	class RuleClassifier
+	{
+	public:
+
+		/**
+		 * A c'tor for this class that creates an empty classifier
+		 */
+		RuleClassifier();
+
+		/**
+		 * A d'tor for this class
+		 */
+		~RuleClassifier();
+
+		/**
+		 * Add a rule to the classifier. The rule is copied
+		 * @param[in] rule The rule to add
+		 * @return True if the rule was added, false if a rule with the same ID already exists (in which case an error is written to log)
+		 */
+		bool addRule(const ClassifierRule& rule);
+
+		/**
+		 * Add a list of rules to the classifier, in order
+		 * @param[in] rules The rules to add
+		 * @return The number of rules added. Rules whose ID already exists are skipped (and an error is written to log for each)
+		 */
+		size_t addRules(const std::vector<ClassifierRule>& rules);
+
+		/**
+		 * Remove a rule from the classifier
+		 * @param[in] ruleId The ID of the rule to remove
+		 * @return True if the rule was removed, false if no rule with this ID exists
+		 */
+		bool removeRule(uint32_t ruleId);
+
+		/**
+		 * Remove all rules
+		 */
+		void clear();
+
+		/**
+		 * Get a rule by its ID
+		 * @param[in] ruleId The rule ID
+		 * @return A pointer to the rule or NULL if no rule with this ID exists. The pointer is valid until the rule is removed
+		 */
+		const ClassifierRule* getRule(uint32_t ruleId) const;
+
+		/**
+		 * @return The number of rules in the classifier
+		 */
+		size_t getNumOfRules() const { return m_Rules.size(); }
+
+		/**
+		 * @return The number of tuples (distinct rule shapes) in the classifier, which is the most hash lookups a single classification
+		 * takes
+		 */
+		size_t getNumOfTuples() const { return m_Tuples.size(); }
+
+		/**
+		 * Classify a flow key
+		 * @param[in] key The flow key to classify
+		 * @return The highest priority rule matching the key, or NULL if no rule matches it or if the key is empty. The pointer is
+		 * valid until the rule is removed
+		 */
+		const ClassifierRule* classify(const FlowKey& key) const;
+
+		/**
+		 * Classify a parsed packet by its flow key (see FlowKey#fromPacket())
+		 * @param[in] packet The packet to classify
+		 * @return The highest priority rule matching the packet, or NULL if no rule matches it or if it isn't an IP packet
+		 */
+		const ClassifierRule* classify(Packet* packet) const;
+
+		/**
+		 * Classify a batch of flow keys. This is faster than classifying the keys one by one since each tuple is searched for all the
+		 * keys together while it's in the CPU cache
+		 * @param[in] keys An array of flow keys
+		 * @param[in] numOfKeys The number of keys in the array
+		 * @param[out] results An array of at least numOfKeys entries, where the highest priority rule matching each key (or NULL) is
+		 * written
+		 * @return The number of keys that matched a rule
+		 */
+		size_t classify(const FlowKey* keys, size_t numOfKeys, const ClassifierRule** results) const;
+
+		/**
+		 * Classify a batch of parsed packets by their flow keys
+		 * @param[in] packets An array of pointers to parsed packets
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[out] results An array of at least numOfPackets entries, where the highest priority rule matching each packet (or NULL)
+		 * is written
+		 * @return The number of packets that matched a rule
+		 */
+		size_t classify(Packet** packets, size_t numOfPackets, const ClassifierRule** results) const;
+
+	private:
+
+		struct StoredRule
+		{
+			ClassifierRule rule;
+			uint64_t sequence;
+
+			StoredRule(const ClassifierRule& r, uint64_t seq) : rule(r), sequence(seq) {}
+		};
+
+		struct TupleKey
+		{
+			uint8_t srcIP[16];
+			uint8_t dstIP[16];
+			uint16_t srcPort;
+			uint16_t dstPort;
+			uint8_t protocol;
+			uint8_t padding[3];
+
+			bool operator==(const TupleKey& other) const;
+		};
+
+		struct TupleNode
+		{
+			TupleKey key;
+			// sorted by priority (highest first) and then by sequence (lowest first)
+			std::vector<const StoredRule*> rules;
+		};
+
+		struct Tuple;
+
+		std::map<uint32_t, StoredRule> m_Rules;
+		// sorted by the highest priority of the rules in each tuple, highest first
+		std::vector<Tuple*> m_Tuples;
+		uint64_t m_NextSequence;
+
+		// the classifier can't be copied since the tuples point to the rules
+		RuleClassifier(const RuleClassifier& other);
+		RuleClassifier& operator=(const RuleClassifier& other);
+
+		Tuple* findTuple(const ClassifierRule& rule) const;
+		void sortTuples();
+		static bool isBetter(const StoredRule* rule, const StoredRule* other);
+		static void searchTuple(const Tuple* tuple, const FlowKey& key, const StoredRule*& best);
+	};
+
+} // namespace pcpp
+
+#endif /* PACKETPP_RULE_CLASSIFIER */
@@ -3,6 +3,7 @@
 
 #include "Packet.h"
 #include "IpAddress.h"
+#include "FlowKey.h"
 #include "PointerVector.h"
 #include <map>
 #include <list>
@@ -85,8 +86,8 @@ struct ConnectionData
 	uint16_t srcPort;
 	/** Destination TCP/UDP port */
 	uint16_t dstPort;
-	/** A 4-byte hash key representing the connection */
-	uint32_t flowKey;
+	/** A key representing the connection. This is the canonical FlowKey of the connection so it's the same for both directions */
+	FlowKey flowKey;
 	/** Start TimeStamp of the connection */
 	timeval startTime;
 	/** End TimeStamp of the connection */
@@ -95,7 +96,7 @@ struct ConnectionData
 	/**
 	 * A c'tor for this struct that basically zeros all members
 	 */
-	ConnectionData() : srcIP(NULL), dstIP(NULL), srcPort(0), dstPort(0), flowKey(0), startTime(), endTime()  {}
+	ConnectionData() : srcIP(NULL), dstIP(NULL), srcPort(0), dstPort(0), flowKey(), startTime(), endTime()  {}
 
 	/**
 	 * A d'tor for this strcut. Notice it frees the memory of srcIP and dstIP members
@@ -243,7 +244,7 @@ public:
 	/**
 	 * The type for storing the connection information
 	 */
-	typedef std::map<uint32_t, ConnectionData> ConnectionInfoList;
+	typedef std::map<FlowKey, ConnectionData> ConnectionInfoList;
 
 	/**
 	 * @typedef OnTcpMessageReady
@@ -304,9 +305,9 @@ public:
 	/**
 	 * Close a connection manually. If the connection doesn't exist or already closed an error log is printed. This method will cause the TcpReassembly#OnTcpConnectionEnd to be invoked with
 	 * a reason of TcpReassembly#TcpReassemblyConnectionClosedManually
-	 * @param[in] flowKey A 4-byte hash key representing the connection. Can be taken from a ConnectionData instance
+	 * @param[in] flowKey The key representing the connection. Can be taken from a ConnectionData instance
 	 */
-	void closeConnection(uint32_t flowKey);
+	void closeConnection(const FlowKey& flowKey);
 
 	/**
 	 * Close all open connections manually. This method will cause the TcpReassembly#OnTcpConnectionEnd to be invoked for each connection with a reason of
@@ -370,8 +371,8 @@ private:
 		TcpReassemblyData() { numOfSides = 0; prevSide = -1; }
 	};
 	
-	typedef std::map<uint32_t, TcpReassemblyData *> ConnectionList;
-	typedef std::map<time_t, std::list<uint32_t> > CleanupList;
+	typedef std::map<FlowKey, TcpReassemblyData *> ConnectionList;
+	typedef std::map<time_t, std::list<FlowKey> > CleanupList;
 
 	OnTcpMessageReady m_OnMessageReadyCallback;
 	OnTcpConnectionStart m_OnConnStart;
@@ -389,11 +390,12 @@ private:
 
 	std::string prepareMissingDataMessage(uint32_t missingDataLen);
 
-	void handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sideIndex, uint32_t flowKey);
+	void handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sideIndex, const FlowKey& flowKey);
 
-	void closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason);
+	// the key is taken by value since it may refer to the connection data which is freed while the connection is closed
+	void closeConnectionInternal(FlowKey flowKey, ConnectionEndReason reason);
 
-	void insertIntoCleanupList(uint32_t flowKey);
+	void insertIntoCleanupList(const FlowKey& flowKey);
 };
 
 }
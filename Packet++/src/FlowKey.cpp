@@ -0,0 +1,475 @@
+#include "FlowKey.h"
+#include "Packet.h"
+#include "VlanLayer.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "GreLayer.h"
+#include "VxlanLayer.h"
+#include "GtpLayer.h"
+#include "EthLayer.h"
+#include "PacketUtils.h"
+#include "EndianPortable.h"
+#include <string.h>
+#include <stdio.h>
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace pcpp
+{
+
+#if !defined(__SSE4_2__)
+
+#define PCPP_XXH_PRIME32_1 2654435761U
+#define PCPP_XXH_PRIME32_2 2246822519U
+#define PCPP_XXH_PRIME32_3 3266489917U
+#define PCPP_XXH_PRIME32_4 668265263U
+#define PCPP_XXH_PRIME32_5 374761393U
+
+static inline uint32_t rotl32(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+static inline uint32_t readUint32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint32_t xxh32Round(uint32_t acc, uint32_t input)
+{
+	acc += input * PCPP_XXH_PRIME32_2;
+	acc = rotl32(acc, 13);
+	return acc * PCPP_XXH_PRIME32_1;
+}
+
+// xxHash32 of a buffer whose length is a multiple of 4
+static uint32_t xxh32(const uint8_t* data, size_t len, uint32_t seed)
+{
+	const uint8_t* end = data + len;
+	uint32_t result;
+
+	if (len >= 16)
+	{
+		uint32_t v1 = seed + PCPP_XXH_PRIME32_1 + PCPP_XXH_PRIME32_2;
+		uint32_t v2 = seed + PCPP_XXH_PRIME32_2;
+		uint32_t v3 = seed;
+		uint32_t v4 = seed - PCPP_XXH_PRIME32_1;
+		const uint8_t* limit = end - 16;
+		do
+		{
+			v1 = xxh32Round(v1, readUint32(data));
+			v2 = xxh32Round(v2, readUint32(data + 4));
+			v3 = xxh32Round(v3, readUint32(data + 8));
+			v4 = xxh32Round(v4, readUint32(data + 12));
+			data += 16;
+		} while (data <= limit);
+
+		result = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+	}
+	else
+	{
+		result = seed + PCPP_XXH_PRIME32_5;
+	}
+
+	result += (uint32_t)len;
+
+	for (; data + 4 <= end; data += 4)
+	{
+		result += readUint32(data) * PCPP_XXH_PRIME32_3;
+		result = rotl32(result, 17) * PCPP_XXH_PRIME32_4;
+	}
+
+	result ^= result >> 15;
+	result *= PCPP_XXH_PRIME32_2;
+	result ^= result >> 13;
+	result *= PCPP_XXH_PRIME32_3;
+	result ^= result >> 16;
+	return result;
+}
+
+#endif // !__SSE4_2__
+
+static inline uint16_t readBigEndianUint16(const uint8_t* data)
+{
+	uint16_t value;
+	memcpy(&value, data, sizeof(value));
+	return be16toh(value);
+}
+
+// hash a flow key laid out as a byte array whose length is a multiple of 4
+static inline uint32_t hashKeyData(const uint8_t* data, size_t len, uint32_t seed)
+{
+#if defined(__SSE4_2__)
+	uint32_t crc = ~seed;
+	size_t offset = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+	uint64_t crc64 = crc;
+	for (; offset + 8 <= len; offset += 8)
+	{
+		uint64_t value;
+		memcpy(&value, data + offset, sizeof(value));
+		crc64 = _mm_crc32_u64(crc64, value);
+	}
+	crc = (uint32_t)crc64;
+#endif
+	for (; offset + 4 <= len; offset += 4)
+	{
+		uint32_t value;
+		memcpy(&value, data + offset, sizeof(value));
+		crc = _mm_crc32_u32(crc, value);
+	}
+	return ~crc;
+#else
+	return xxh32(data, len, seed);
+#endif
+}
+
+FlowKey::FlowKey()
+{
+	clear();
+}
+
+FlowKey::FlowKey(const IPv4Address& srcIP, const IPv4Address& dstIP, uint8_t protocol, uint16_t srcPort, uint16_t dstPort, uint16_t vlanId, uint32_t tunnelId)
+{
+	clear();
+	uint32_t srcIPAsInt = srcIP.toInt();
+	uint32_t dstIPAsInt = dstIP.toInt();
+	memcpy(m_SrcIP, &srcIPAsInt, 4);
+	memcpy(m_DstIP, &dstIPAsInt, 4);
+	m_Protocol = protocol;
+	m_SrcPort = srcPort;
+	m_DstPort = dstPort;
+	m_VlanId = vlanId;
+	m_TunnelId = tunnelId;
+	m_IPVersion = 4;
+}
+
+FlowKey::FlowKey(const IPv6Address& srcIP, const IPv6Address& dstIP, uint8_t protocol, uint16_t srcPort, uint16_t dstPort, uint16_t vlanId, uint32_t tunnelId)
+{
+	clear();
+	srcIP.copyTo(m_SrcIP);
+	dstIP.copyTo(m_DstIP);
+	m_Protocol = protocol;
+	m_SrcPort = srcPort;
+	m_DstPort = dstPort;
+	m_VlanId = vlanId;
+	m_TunnelId = tunnelId;
+	m_IPVersion = 6;
+}
+
+bool FlowKey::fromPacket(Packet* packet)
+{
+	clear();
+
+	// tracks whether the ports may be taken from the current layer, meaning it directly follows the innermost IP layer seen so far
+	bool expectTransport = false;
+
+	for (Layer* curLayer = packet->getFirstLayer(); curLayer != NULL; curLayer = curLayer->getNextLayer())
+	{
+		switch (curLayer->getProtocol())
+		{
+		case VLAN:
+			if (m_IPVersion == 0 && m_VlanId == 0)
+				m_VlanId = ((VlanLayer*)curLayer)->getVlanID();
+			expectTransport = false;
+			break;
+
+		case IPv4:
+		{
+			iphdr* ipHeader = ((IPv4Layer*)curLayer)->getIPv4Header();
+			memset(m_SrcIP, 0, sizeof(m_SrcIP));
+			memset(m_DstIP, 0, sizeof(m_DstIP));
+			memcpy(m_SrcIP, &ipHeader->ipSrc, 4);
+			memcpy(m_DstIP, &ipHeader->ipDst, 4);
+			m_Protocol = ipHeader->protocol;
+			m_SrcPort = 0;
+			m_DstPort = 0;
+			m_IPVersion = 4;
+			expectTransport = true;
+			break;
+		}
+
+		case IPv6:
+		{
+			ip6_hdr* ipHeader = ((IPv6Layer*)curLayer)->getIPv6Header();
+			memcpy(m_SrcIP, ipHeader->ipSrc, 16);
+			memcpy(m_DstIP, ipHeader->ipDst, 16);
+			m_Protocol = ipHeader->nextHeader;
+			m_SrcPort = 0;
+			m_DstPort = 0;
+			m_IPVersion = 6;
+			expectTransport = true;
+			break;
+		}
+
+		case TCP:
+			if (expectTransport)
+			{
+				tcphdr* tcpHeader = ((TcpLayer*)curLayer)->getTcpHeader();
+				m_SrcPort = be16toh(tcpHeader->portSrc);
+				m_DstPort = be16toh(tcpHeader->portDst);
+				m_Protocol = PACKETPP_IPPROTO_TCP;
+			}
+			expectTransport = false;
+			break;
+
+		case UDP:
+			if (expectTransport)
+			{
+				udphdr* udpHeader = ((UdpLayer*)curLayer)->getUdpHeader();
+				m_SrcPort = be16toh(udpHeader->portSrc);
+				m_DstPort = be16toh(udpHeader->portDst);
+				m_Protocol = PACKETPP_IPPROTO_UDP;
+			}
+			expectTransport = false;
+			break;
+
+		case GREv0:
+		{
+			uint32_t key;
+			if (((GREv0Layer*)curLayer)->getKey(key))
+				m_TunnelId = key;
+			expectTransport = false;
+			break;
+		}
+
+		case GREv1:
+			m_TunnelId = be16toh(((GREv1Layer*)curLayer)->getGreHeader()->callID);
+			expectTransport = false;
+			break;
+
+		case VXLAN:
+			m_TunnelId = ((VxlanLayer*)curLayer)->getVNI();
+			expectTransport = false;
+			break;
+
+		case GTPv1:
+			m_TunnelId = be32toh(((GtpV1Layer*)curLayer)->getHeader()->teid);
+			expectTransport = false;
+			break;
+
+		case ICMP:
+			// ICMP error messages quote the IP and transport headers of another packet, which must not override the key
+			return m_IPVersion != 0;
+
+		default:
+			expectTransport = false;
+			break;
+		}
+	}
+
+	return m_IPVersion != 0;
+}
+
+bool FlowKey::fromRawData(const uint8_t* data, int dataLen, LinkLayerType linkType)
+{
+	clear();
+
+	RawPacketHeaders headers;
+	if (!parseRawPacketHeaders(data, dataLen, linkType, headers))
+		return false;
+
+	if (headers.etherType == PCPP_ETHERTYPE_IP)
+	{
+		memcpy(m_SrcIP, headers.ipHeader + 12, 4);
+		memcpy(m_DstIP, headers.ipHeader + 16, 4);
+		m_IPVersion = 4;
+	}
+	else
+	{
+		memcpy(m_SrcIP, headers.ipHeader + 8, 16);
+		memcpy(m_DstIP, headers.ipHeader + 24, 16);
+		m_IPVersion = 6;
+	}
+
+	m_Protocol = headers.ipProtocol;
+
+	// as in fromPacket(), a TCP/UDP packet gets the transport protocol even if IPv6 extension headers were skipped
+	if (headers.transportOffset >= 0 &&
+			(headers.transportProtocol == PACKETPP_IPPROTO_TCP || headers.transportProtocol == PACKETPP_IPPROTO_UDP))
+	{
+		m_Protocol = headers.transportProtocol;
+		m_SrcPort = readBigEndianUint16(headers.ipHeader + headers.transportOffset);
+		m_DstPort = readBigEndianUint16(headers.ipHeader + headers.transportOffset + 2);
+	}
+
+	m_VlanId = headers.vlanId;
+	return true;
+}
+
+IPv4Address FlowKey::getSrcIPv4Address() const
+{
+	if (m_IPVersion != 4)
+		return IPv4Address::Zero;
+
+	uint32_t addr;
+	memcpy(&addr, m_SrcIP, 4);
+	return IPv4Address(addr);
+}
+
+IPv4Address FlowKey::getDstIPv4Address() const
+{
+	if (m_IPVersion != 4)
+		return IPv4Address::Zero;
+
+	uint32_t addr;
+	memcpy(&addr, m_DstIP, 4);
+	return IPv4Address(addr);
+}
+
+IPv6Address FlowKey::getSrcIPv6Address() const
+{
+	if (m_IPVersion != 6)
+		return IPv6Address::Zero;
+
+	return IPv6Address((uint8_t*)m_SrcIP);
+}
+
+IPv6Address FlowKey::getDstIPv6Address() const
+{
+	if (m_IPVersion != 6)
+		return IPv6Address::Zero;
+
+	return IPv6Address((uint8_t*)m_DstIP);
+}
+
+bool FlowKey::isCanonical() const
+{
+	int cmp = memcmp(m_SrcIP, m_DstIP, sizeof(m_SrcIP));
+	return cmp < 0 || (cmp == 0 && m_SrcPort <= m_DstPort);
+}
+
+void FlowKey::clear()
+{
+	memset(m_SrcIP, 0, sizeof(m_SrcIP));
+	memset(m_DstIP, 0, sizeof(m_DstIP));
+	m_TunnelId = 0;
+	m_SrcPort = 0;
+	m_DstPort = 0;
+	m_VlanId = 0;
+	m_Protocol = 0;
+	m_IPVersion = 0;
+}
+
+void FlowKey::swapEndpoints()
+{
+	uint8_t tmpIP[16];
+	memcpy(tmpIP, m_SrcIP, sizeof(tmpIP));
+	memcpy(m_SrcIP, m_DstIP, sizeof(tmpIP));
+	memcpy(m_DstIP, tmpIP, sizeof(tmpIP));
+
+	uint16_t tmpPort = m_SrcPort;
+	m_SrcPort = m_DstPort;
+	m_DstPort = tmpPort;
+}
+
+bool FlowKey::makeCanonical()
+{
+	if (isCanonical())
+		return false;
+
+	swapEndpoints();
+	return true;
+}
+
+FlowKey FlowKey::getCanonical() const
+{
+	FlowKey result(*this);
+	result.makeCanonical();
+	return result;
+}
+
+FlowKey FlowKey::getReversed() const
+{
+	FlowKey result(*this);
+	result.swapEndpoints();
+	return result;
+}
+
+uint32_t FlowKey::hash(uint32_t seed) const
+{
+	return hashKeyData((const uint8_t*)this, sizeof(FlowKey), seed);
+}
+
+uint32_t FlowKey::symmetricHash(uint32_t seed) const
+{
+	if (isCanonical())
+		return hash(seed);
+
+	return getReversed().hash(seed);
+}
+
+std::string FlowKey::toString() const
+{
+	if (m_IPVersion == 0)
+		return "<empty flow key>";
+
+	std::string protocol;
+	switch (m_Protocol)
+	{
+	case PACKETPP_IPPROTO_TCP:
+		protocol = "TCP";
+		break;
+	case PACKETPP_IPPROTO_UDP:
+		protocol = "UDP";
+		break;
+	case PACKETPP_IPPROTO_ICMP:
+		protocol = "ICMP";
+		break;
+	default:
+		char protocolAsString[16];
+		snprintf(protocolAsString, sizeof(protocolAsString), "proto %d", (int)m_Protocol);
+		protocol = protocolAsString;
+	}
+
+	std::string srcIP, dstIP;
+	if (m_IPVersion == 4)
+	{
+		srcIP = getSrcIPv4Address().toString();
+		dstIP = getDstIPv4Address().toString();
+	}
+	else
+	{
+		srcIP = "[" + getSrcIPv6Address().toString() + "]";
+		dstIP = "[" + getDstIPv6Address().toString() + "]";
+	}
+
+	char ports[64];
+	std::string result = protocol + " " + srcIP;
+	snprintf(ports, sizeof(ports), ":%d", (int)m_SrcPort);
+	result += ports;
+	result += " -> " + dstIP;
+	snprintf(ports, sizeof(ports), ":%d", (int)m_DstPort);
+	result += ports;
+
+	if (m_VlanId != 0)
+	{
+		snprintf(ports, sizeof(ports), " vlan %d", (int)m_VlanId);
+		result += ports;
+	}
+
+	if (m_TunnelId != 0)
+	{
+		snprintf(ports, sizeof(ports), " tunnel 0x%X", m_TunnelId);
+		result += ports;
+	}
+
+	return result;
+}
+
+bool FlowKey::operator==(const FlowKey& other) const
+{
+	return memcmp(this, &other, sizeof(FlowKey)) == 0;
+}
+
+bool FlowKey::operator<(const FlowKey& other) const
+{
+	return memcmp(this, &other, sizeof(FlowKey)) < 0;
+}
+
+} // namespace pcpp
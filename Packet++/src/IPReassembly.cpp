@@ -11,39 +11,6 @@
 namespace pcpp
 {
 
-uint32_t IPReassemblyHashPacket(IPv4Layer* ipv4Layer)
-{
-	ScalarBuffer<uint8_t> vec[3];
-
-	vec[0].buffer = (uint8_t*)&ipv4Layer->getIPv4Header()->ipSrc;
-	vec[0].len = 4;
-	vec[1].buffer = (uint8_t*)&ipv4Layer->getIPv4Header()->ipDst;
-	vec[1].len = 4;
-	vec[2].buffer = (uint8_t*)&ipv4Layer->getIPv4Header()->ipId;
-	vec[2].len = 2;
-
-	return pcpp::fnv_hash(vec, 3);
-}
-
-uint32_t IPReassemblyHashBy3Tuple(const IPv4Address& ipSrc, const IPv4Address& ipDst, uint16_t ipID)
-{
-	ScalarBuffer<uint8_t> vec[3];
-
-	uint16_t ipIdNetworkOrder = htobe16(ipID);
-	uint32_t ipSrcAsInt = ipSrc.toInt();
-	uint32_t ipDstAsInt = ipDst.toInt();
-
-
-	vec[0].buffer = (uint8_t*)&ipSrcAsInt;
-	vec[0].len = 4;
-	vec[1].buffer = (uint8_t*)&ipDstAsInt;
-	vec[1].len = 4;
-	vec[2].buffer = (uint8_t*)&ipIdNetworkOrder;
-	vec[2].len = 2;
-
-	return pcpp::fnv_hash(vec, 3);
-}
-
 class IPFragmentWrapper
 {
 public:
@@ -52,7 +19,7 @@ public:
 	virtual bool isLastFragment() = 0;
 	virtual uint16_t getFragmentOffset() = 0;
 	virtual uint32_t getFragmentId() = 0;
-	virtual uint32_t hashPacket() = 0;
+	virtual FlowKey getFlowKey() = 0;
 	virtual IPReassembly::PacketKey* createPacketKey() = 0;
 
 	virtual uint8_t* getIPLayerPayload() = 0;
@@ -100,18 +67,9 @@ public:
 		return (uint32_t)be16toh(m_IPLayer->getIPv4Header()->ipId);
 	}
 
-	uint32_t hashPacket()
+	FlowKey getFlowKey()
 	{
-		ScalarBuffer<uint8_t> vec[3];
-
-		vec[0].buffer = (uint8_t*)&m_IPLayer->getIPv4Header()->ipSrc;
-		vec[0].len = 4;
-		vec[1].buffer = (uint8_t*)&m_IPLayer->getIPv4Header()->ipDst;
-		vec[1].len = 4;
-		vec[2].buffer = (uint8_t*)&m_IPLayer->getIPv4Header()->ipId;
-		vec[2].len = 2;
-
-		return pcpp::fnv_hash(vec, 3);
+		return FlowKey(m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress(), 0, 0, 0, 0, getFragmentId());
 	}
 
 	IPReassembly::PacketKey* createPacketKey()
@@ -183,21 +141,12 @@ public:
 		return be32toh(m_FragHeader->getFragHeader()->id);
 	}
 
-	uint32_t hashPacket()
+	FlowKey getFlowKey()
 	{
 		if (m_FragHeader == NULL)
-			return 0;
-
-		ScalarBuffer<uint8_t> vec[3];
+			return FlowKey();
 
-		vec[0].buffer = m_IPLayer->getIPv6Header()->ipSrc;
-		vec[0].len = 16;
-		vec[1].buffer = m_IPLayer->getIPv6Header()->ipDst;
-		vec[1].len = 16;
-		vec[2].buffer = (uint8_t*)&m_FragHeader->getFragHeader()->id;
-		vec[2].len = 4;
-
-		return pcpp::fnv_hash(vec, 3);
+		return FlowKey(m_IPLayer->getSrcIpAddress(), m_IPLayer->getDstIpAddress(), 0, 0, 0, 0, getFragmentId());
 	}
 
 	IPReassembly::PacketKey* createPacketKey()
@@ -222,43 +171,6 @@ private:
 };
 
 
-uint32_t IPReassembly::IPv4PacketKey::getHashValue() const
-{
-	ScalarBuffer<uint8_t> vec[3];
-
-	uint16_t ipIdNetworkOrder = htobe16(m_IpID);
-	uint32_t ipSrcAsInt = m_SrcIP.toInt();
-	uint32_t ipDstAsInt = m_DstIP.toInt();
-
-	vec[0].buffer = (uint8_t*)&ipSrcAsInt;
-	vec[0].len = 4;
-	vec[1].buffer = (uint8_t*)&ipDstAsInt;
-	vec[1].len = 4;
-	vec[2].buffer = (uint8_t*)&ipIdNetworkOrder;
-	vec[2].len = 2;
-
-	return pcpp::fnv_hash(vec, 3);
-}
-
-uint32_t IPReassembly::IPv6PacketKey::getHashValue() const
-{
-	ScalarBuffer<uint8_t> vec[3];
-
-	uint32_t fragIdNetworkOrder = htobe32(m_FragmentID);
-	uint8_t ipSrcAsByteArr[16];
-	uint8_t ipDstAsByteArr[16];
-	m_SrcIP.copyTo(ipSrcAsByteArr);
-	m_DstIP.copyTo(ipDstAsByteArr);
-
-	vec[0].buffer = ipSrcAsByteArr;
-	vec[0].len = 16;
-	vec[1].buffer = ipDstAsByteArr;
-	vec[1].len = 16;
-	vec[2].buffer = (uint8_t*)&fragIdNetworkOrder;
-	vec[2].len = 4;
-
-	return pcpp::fnv_hash(vec, 3);
-}
 
 
 
@@ -304,13 +216,13 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		return fragment;
 	}
 
-	// create a hash from source IP, destination IP and IP/fragment ID
-	uint32_t hash = fragWrapper->hashPacket();
+	// create a key from source IP, destination IP and IP/fragment ID
+	FlowKey flowKey = fragWrapper->getFlowKey();
 
 	IPFragmentData* fragData = NULL;
 
 	// check whether this packet already exists in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	std::map<FlowKey, IPFragmentData*>::iterator iter = m_FragmentMap.find(flowKey);
 
 	// this is the first fragment seen for this packet
 	if (iter == m_FragmentMap.end())
@@ -321,7 +233,7 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		fragData = new IPFragmentData(fragWrapper->createPacketKey(), fragWrapper->getFragmentId());
 
 		// add the new fragment to the map
-		addNewFragment(hash, fragData);
+		addNewFragment(flowKey, fragData);
 	}
 	else // packet was seen before
 	{
@@ -329,7 +241,7 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		fragData = iter->second;
 
 		// mark this packet as used
-		m_PacketLRU.put(hash, NULL);
+		m_PacketLRU.put(flowKey, NULL);
 	}
 
 	bool gotLastFragment = false;
@@ -462,7 +374,7 @@ Packet* IPReassembly::processPacket(Packet* fragment, ReassemblyStatus& status,
 		// delete the IPFragmentData object and remove it from the map
 		delete fragData;
 		m_FragmentMap.erase(iter);
-		m_PacketLRU.eraseElement(hash);
+		m_PacketLRU.eraseElement(flowKey);
 		status = REASSEMBLED;
 		return reassembledPacket;
 	}
@@ -486,13 +398,13 @@ Packet* IPReassembly::processPacket(RawPacket* fragment, ReassemblyStatus& statu
 
 Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
 {
-	// create a hash out of the packet key
-	uint32_t hash = key.getHashValue();
+	// create a flow key out of the packet key
+	FlowKey flowKey = key.getFlowKey();
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	// look for this key in the map
+	std::map<FlowKey, IPFragmentData*>::iterator iter = m_FragmentMap.find(flowKey);
 
-	// hash was found
+	// key was found
 	if (iter != m_FragmentMap.end())
 	{
 		IPFragmentData* fragData = iter->second;
@@ -542,13 +454,13 @@ Packet* IPReassembly::getCurrentPacket(const PacketKey& key)
 
 void IPReassembly::removePacket(const PacketKey& key)
 {
-	// create a hash out of the packet key
-	uint32_t hash = key.getHashValue();
+	// create a flow key out of the packet key
+	FlowKey flowKey = key.getFlowKey();
 
-	// look for this hash value in the map
-	std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(hash);
+	// look for this key in the map
+	std::map<FlowKey, IPFragmentData*>::iterator iter = m_FragmentMap.find(flowKey);
 
-	// hash was found
+	// key was found
 	if (iter != m_FragmentMap.end())
 	{
 		// free all data saved in the map
@@ -556,19 +468,19 @@ void IPReassembly::removePacket(const PacketKey& key)
 		m_FragmentMap.erase(iter);
 
 		// remove from LRU list
-		m_PacketLRU.eraseElement(hash);
+		m_PacketLRU.eraseElement(flowKey);
 	}
 }
 
-void IPReassembly::addNewFragment(uint32_t hash, IPFragmentData* fragData)
+void IPReassembly::addNewFragment(const FlowKey& flowKey, IPFragmentData* fragData)
 {
 	// put the new frag in the LRU list
-	uint32_t packetRemoved;
+	FlowKey packetRemoved;
 
-	if (m_PacketLRU.put(hash, &packetRemoved) == 1) // this means LRU list was full and the least recently used item was removed
+	if (m_PacketLRU.put(flowKey, &packetRemoved) == 1) // this means LRU list was full and the least recently used item was removed
 	{
 		// remove this item from the fragment map
-		std::map<uint32_t, IPFragmentData*>::iterator iter = m_FragmentMap.find(packetRemoved);
+		std::map<FlowKey, IPFragmentData*>::iterator iter = m_FragmentMap.find(packetRemoved);
 		IPFragmentData* dataRemoved = iter->second;
 
 		PacketKey* key = NULL;
@@ -588,7 +500,7 @@ void IPReassembly::addNewFragment(uint32_t hash, IPFragmentData* fragData)
 	}
 
 	// add the new fragment to the map
-	std::pair<uint32_t, IPFragmentData*> pair(hash, fragData);
+	std::pair<FlowKey, IPFragmentData*> pair(flowKey, fragData);
 	m_FragmentMap.insert(pair);
 }
 
@@ -0,0 +1,442 @@
+#define LOG_MODULE PacketLogModuleMultiPatternMatcher
+
+#include "MultiPatternMatcher.h"
+#include "Layer.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#endif
+
+namespace pcpp
+{
+
+// set in a transition whose target state has patterns ending in it
+#define PCPP_PATTERN_MATCH_FLAG 0x80000000U
+
+#define PCPP_PATTERN_NO_STATE 0xffffffffU
+
+// the largest DFA transition table, in entries (256MB)
+#define PCPP_PATTERN_MAX_TABLE_ENTRIES (1U << 26)
+
+// the largest number of distinct start bytes the SIMD skip is used for, a larger number makes the skip stop too often to be useful
+#define PCPP_PATTERN_MAX_SIMD_START_BYTES 8
+
+static inline uint8_t normalizeByte(uint8_t byte, bool caseInsensitive)
+{
+	if (caseInsensitive && byte >= 'A' && byte <= 'Z')
+		return byte + ('a' - 'A');
+	return byte;
+}
+
+static int hexDigitValue(char digit)
+{
+	if (digit >= '0' && digit <= '9')
+		return digit - '0';
+	if (digit >= 'a' && digit <= 'f')
+		return digit - 'a' + 10;
+	if (digit >= 'A' && digit <= 'F')
+		return digit - 'A' + 10;
+	return -1;
+}
+
+
+MultiPatternMatcher::MultiPatternMatcher(bool caseInsensitive)
+{
+	m_CaseInsensitive = caseInsensitive;
+	m_NumOfClasses = 0;
+	memset(m_ByteClasses, 0, sizeof(m_ByteClasses));
+	memset(m_IsStartByte, 0, sizeof(m_IsStartByte));
+}
+
+int MultiPatternMatcher::addPattern(const uint8_t* pattern, size_t patternLen)
+{
+	if (pattern == NULL || patternLen == 0)
+	{
+		LOG_ERROR("Cannot add an empty pattern");
+		return -1;
+	}
+
+	if (isCompiled())
+	{
+		LOG_ERROR("Cannot add a pattern to a compiled matcher, call clear() first");
+		return -1;
+	}
+
+	m_Patterns.push_back(std::string((const char*)pattern, patternLen));
+	return (int)(m_Patterns.size() - 1);
+}
+
+int MultiPatternMatcher::addPattern(const std::string& pattern)
+{
+	return addPattern((const uint8_t*)pattern.data(), pattern.size());
+}
+
+bool MultiPatternMatcher::parsePattern(const std::string& patternAsText, std::string& pattern)
+{
+	pattern.clear();
+	pattern.reserve(patternAsText.size());
+
+	for (size_t i = 0; i < patternAsText.size(); i++)
+	{
+		if (patternAsText[i] != '\\')
+		{
+			pattern.push_back(patternAsText[i]);
+			continue;
+		}
+
+		if (i + 1 < patternAsText.size() && patternAsText[i + 1] == '\\')
+		{
+			pattern.push_back('\\');
+			i++;
+			continue;
+		}
+
+		int high = -1, low = -1;
+		if (i + 3 < patternAsText.size() && patternAsText[i + 1] == 'x')
+		{
+			high = hexDigitValue(patternAsText[i + 2]);
+			low = hexDigitValue(patternAsText[i + 3]);
+		}
+
+		if (high < 0 || low < 0)
+		{
+			LOG_ERROR("Pattern '%s' contains an invalid escape sequence at offset %d, expected '\\xHH' or '\\\\'", patternAsText.c_str(), (int)i);
+			return false;
+		}
+
+		pattern.push_back((char)(high * 16 + low));
+		i += 3;
+	}
+
+	return true;
+}
+
+bool MultiPatternMatcher::compile()
+{
+	if (m_Patterns.empty())
+	{
+		LOG_ERROR("Cannot compile a matcher without patterns");
+		return false;
+	}
+
+	m_Transitions.clear();
+	m_OutputStart.clear();
+	m_OutputIds.clear();
+	m_DictionaryLink.clear();
+	m_StartBytes.clear();
+
+	// map each distinct pattern byte to a class of its own and all the other bytes to one more class, so the table has a column
+	// per class rather than a column per byte value
+	int classOfByte[256];
+	for (int i = 0; i < 256; i++)
+		classOfByte[i] = -1;
+
+	uint32_t numOfClasses = 0;
+	for (std::vector<std::string>::const_iterator iter = m_Patterns.begin(); iter != m_Patterns.end(); iter++)
+	{
+		for (size_t i = 0; i < iter->size(); i++)
+		{
+			uint8_t byte = normalizeByte((uint8_t)(*iter)[i], m_CaseInsensitive);
+			if (classOfByte[byte] < 0)
+				classOfByte[byte] = numOfClasses++;
+		}
+	}
+
+	uint32_t otherClass = numOfClasses;
+	for (int i = 0; i < 256; i++)
+	{
+		int byteClass = classOfByte[normalizeByte((uint8_t)i, m_CaseInsensitive)];
+		if (byteClass < 0)
+		{
+			byteClass = otherClass;
+			numOfClasses = otherClass + 1;
+		}
+		m_ByteClasses[i] = (uint16_t)byteClass;
+	}
+
+	m_NumOfClasses = numOfClasses;
+
+	// build the trie, states are numbered by creation order and the root is state 0
+	std::vector<uint32_t> table(numOfClasses, PCPP_PATTERN_NO_STATE);
+	std::vector<uint32_t> terminalState(m_Patterns.size());
+	uint32_t numOfStates = 1;
+	for (size_t patternId = 0; patternId < m_Patterns.size(); patternId++)
+	{
+		const std::string& pattern = m_Patterns[patternId];
+		uint32_t state = 0;
+		for (size_t i = 0; i < pattern.size(); i++)
+		{
+			size_t index = (size_t)state * numOfClasses + m_ByteClasses[(uint8_t)pattern[i]];
+			if (table[index] == PCPP_PATTERN_NO_STATE)
+			{
+				if ((size_t)(numOfStates + 1) * numOfClasses > PCPP_PATTERN_MAX_TABLE_ENTRIES)
+				{
+					LOG_ERROR("The patterns are too large, the DFA exceeds %u transitions", PCPP_PATTERN_MAX_TABLE_ENTRIES);
+					m_NumOfClasses = 0;
+					return false;
+				}
+
+				table[index] = numOfStates++;
+				table.resize((size_t)numOfStates * numOfClasses, PCPP_PATTERN_NO_STATE);
+			}
+
+			state = table[index];
+		}
+
+		terminalState[patternId] = state;
+	}
+
+	// the patterns that end in each state, in the order they were added
+	m_OutputStart.assign(numOfStates + 1, 0);
+	for (size_t patternId = 0; patternId < terminalState.size(); patternId++)
+		m_OutputStart[terminalState[patternId] + 1]++;
+	for (uint32_t state = 0; state < numOfStates; state++)
+		m_OutputStart[state + 1] += m_OutputStart[state];
+
+	m_OutputIds.resize(m_Patterns.size());
+	std::vector<uint32_t> outputFill(m_OutputStart.begin(), m_OutputStart.end() - 1);
+	for (size_t patternId = 0; patternId < terminalState.size(); patternId++)
+		m_OutputIds[outputFill[terminalState[patternId]]++] = (uint32_t)patternId;
+
+	// turn the trie into a DFA: visit the states in breadth first order and replace every missing transition with the transition
+	// of the failure state, which is the longest proper suffix of the state that is also a trie state
+	std::vector<uint32_t> failure(numOfStates, 0);
+	m_DictionaryLink.assign(numOfStates, PCPP_PATTERN_NO_STATE);
+	std::vector<uint32_t> queue;
+	queue.reserve(numOfStates);
+
+	for (uint32_t byteClass = 0; byteClass < numOfClasses; byteClass++)
+	{
+		uint32_t& next = table[byteClass];
+		if (next == PCPP_PATTERN_NO_STATE)
+			next = 0;
+		else
+			queue.push_back(next);
+	}
+
+	for (size_t queueIndex = 0; queueIndex < queue.size(); queueIndex++)
+	{
+		uint32_t state = queue[queueIndex];
+		uint32_t failureState = failure[state];
+
+		bool failureHasOutput = (m_OutputStart[failureState + 1] > m_OutputStart[failureState]);
+		m_DictionaryLink[state] = (failureHasOutput ? failureState : m_DictionaryLink[failureState]);
+
+		uint32_t* row = &table[(size_t)state * numOfClasses];
+		const uint32_t* failureRow = &table[(size_t)failureState * numOfClasses];
+		for (uint32_t byteClass = 0; byteClass < numOfClasses; byteClass++)
+		{
+			if (row[byteClass] == PCPP_PATTERN_NO_STATE)
+				row[byteClass] = failureRow[byteClass];
+			else
+			{
+				failure[row[byteClass]] = failureRow[byteClass];
+				queue.push_back(row[byteClass]);
+			}
+		}
+	}
+
+	// store the row offset of the target state in each transition so a search step is a single add and load
+	std::vector<bool> hasOutput(numOfStates);
+	for (uint32_t state = 0; state < numOfStates; state++)
+		hasOutput[state] = (m_OutputStart[state + 1] > m_OutputStart[state] || m_DictionaryLink[state] != PCPP_PATTERN_NO_STATE);
+
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		uint32_t target = table[i];
+		table[i] = target * numOfClasses | (hasOutput[target] ? PCPP_PATTERN_MATCH_FLAG : 0);
+	}
+
+	m_Transitions.swap(table);
+
+	for (int i = 0; i < 256; i++)
+	{
+		m_IsStartByte[i] = (m_Transitions[m_ByteClasses[i]] != 0);
+		if (m_IsStartByte[i])
+			m_StartBytes.push_back((uint8_t)i);
+	}
+
+	LOG_DEBUG("Compiled %d patterns into a DFA of %d states and %d byte classes, %d start bytes",
+			(int)m_Patterns.size(), (int)numOfStates, (int)numOfClasses, (int)m_StartBytes.size());
+
+	return true;
+}
+
+void MultiPatternMatcher::clear()
+{
+	m_Patterns.clear();
+	m_Transitions.clear();
+	m_OutputStart.clear();
+	m_OutputIds.clear();
+	m_DictionaryLink.clear();
+	m_StartBytes.clear();
+	m_NumOfClasses = 0;
+	memset(m_ByteClasses, 0, sizeof(m_ByteClasses));
+	memset(m_IsStartByte, 0, sizeof(m_IsStartByte));
+}
+
+std::string MultiPatternMatcher::getPattern(uint32_t patternId) const
+{
+	if (patternId >= m_Patterns.size())
+		return "";
+
+	return m_Patterns[patternId];
+}
+
+size_t MultiPatternMatcher::skipToStartByte(const uint8_t* data, size_t offset, size_t dataLen) const
+{
+#if defined(__SSE2__) && defined(__GNUC__)
+	size_t numOfStartBytes = m_StartBytes.size();
+	if (numOfStartBytes <= PCPP_PATTERN_MAX_SIMD_START_BYTES)
+	{
+		__m128i startBytes[PCPP_PATTERN_MAX_SIMD_START_BYTES];
+		for (size_t i = 0; i < numOfStartBytes; i++)
+			startBytes[i] = _mm_set1_epi8((char)m_StartBytes[i]);
+
+		for (; offset + 16 <= dataLen; offset += 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i*)(data + offset));
+			__m128i found = _mm_cmpeq_epi8(block, startBytes[0]);
+			for (size_t i = 1; i < numOfStartBytes; i++)
+				found = _mm_or_si128(found, _mm_cmpeq_epi8(block, startBytes[i]));
+
+			int mask = _mm_movemask_epi8(found);
+			if (mask != 0)
+				return offset + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	while (offset < dataLen && !m_IsStartByte[data[offset]])
+		offset++;
+
+	return offset;
+}
+
+size_t MultiPatternMatcher::reportMatches(uint32_t state, uint64_t endOffset, std::vector<PatternMatch>* matches, OnPatternMatch onMatch, void* userCookie) const
+{
+	size_t count = 0;
+
+	// the state's own patterns are the longest ones, the patterns of the dictionary links get shorter along the chain
+	while (state != PCPP_PATTERN_NO_STATE)
+	{
+		for (uint32_t i = m_OutputStart[state]; i < m_OutputStart[state + 1]; i++)
+		{
+			PatternMatch match;
+			match.patternId = m_OutputIds[i];
+			match.endOffset = endOffset;
+
+			if (matches != NULL)
+				matches->push_back(match);
+			if (onMatch != NULL)
+				onMatch(match, userCookie);
+
+			count++;
+		}
+
+		state = m_DictionaryLink[state];
+	}
+
+	return count;
+}
+
+size_t MultiPatternMatcher::run(uint32_t& state, uint64_t baseOffset, const uint8_t* data, size_t dataLen, std::vector<PatternMatch>* matches, OnPatternMatch onMatch, void* userCookie, bool stopAtFirstMatch) const
+{
+	const uint32_t* transitions = &m_Transitions[0];
+	uint32_t current = state;
+	size_t count = 0;
+	size_t offset = 0;
+
+	while (offset < dataLen)
+	{
+		if (current == 0)
+		{
+			offset = skipToStartByte(data, offset, dataLen);
+			if (offset >= dataLen)
+				break;
+		}
+
+		uint32_t next = transitions[current + m_ByteClasses[data[offset]]];
+		offset++;
+
+		if (next & PCPP_PATTERN_MATCH_FLAG)
+		{
+			current = next & ~PCPP_PATTERN_MATCH_FLAG;
+			if (stopAtFirstMatch)
+			{
+				state = current;
+				return 1;
+			}
+
+			count += reportMatches(current / m_NumOfClasses, baseOffset + offset, matches, onMatch, userCookie);
+		}
+		else
+			current = next;
+	}
+
+	state = current;
+	return count;
+}
+
+size_t MultiPatternMatcher::search(const uint8_t* data, size_t dataLen, std::vector<PatternMatch>& matches) const
+{
+	if (!isCompiled())
+	{
+		LOG_ERROR("Matcher isn't compiled");
+		return 0;
+	}
+
+	uint32_t state = 0;
+	return run(state, 0, data, dataLen, &matches, NULL, NULL, false);
+}
+
+size_t MultiPatternMatcher::search(const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	if (!isCompiled())
+	{
+		LOG_ERROR("Matcher isn't compiled");
+		return 0;
+	}
+
+	uint32_t state = 0;
+	return run(state, 0, data, dataLen, NULL, onMatch, userCookie, false);
+}
+
+size_t MultiPatternMatcher::search(StreamState& state, const uint8_t* data, size_t dataLen, OnPatternMatch onMatch, void* userCookie) const
+{
+	if (!isCompiled())
+	{
+		LOG_ERROR("Matcher isn't compiled");
+		return 0;
+	}
+
+	if (state.state >= m_Transitions.size() || state.state % m_NumOfClasses != 0)
+	{
+		LOG_ERROR("Stream state doesn't belong to this matcher");
+		return 0;
+	}
+
+	size_t count = run(state.state, state.offset, data, dataLen, NULL, onMatch, userCookie, false);
+	state.offset += dataLen;
+	return count;
+}
+
+size_t MultiPatternMatcher::searchLayerPayload(const Layer& layer, std::vector<PatternMatch>& matches) const
+{
+	return search(layer.getLayerPayload(), layer.getLayerPayloadSize(), matches);
+}
+
+bool MultiPatternMatcher::matchesAny(const uint8_t* data, size_t dataLen) const
+{
+	if (!isCompiled())
+	{
+		LOG_ERROR("Matcher isn't compiled");
+		return false;
+	}
+
+	uint32_t state = 0;
+	return run(state, 0, data, dataLen, NULL, NULL, NULL, true) > 0;
+}
+
+} // namespace pcpp
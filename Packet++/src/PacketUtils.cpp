@@ -5,10 +5,23 @@
 #include "IPv6Layer.h"
 #include "TcpLayer.h"
 #include "UdpLayer.h"
+#include "EthLayer.h"
+#include "EndianPortable.h"
+
+// IEEE 802.1ad (QinQ) service tag, and the TPID older QinQ devices use instead
+#define PCPP_ETHERTYPE_QINQ         0x88A8
+#define PCPP_ETHERTYPE_QINQ_LEGACY  0x9100
 
 namespace pcpp
 {
 
+static inline uint16_t readBigEndianUint16(const uint8_t* data)
+{
+	uint16_t value;
+	memcpy(&value, data, sizeof(value));
+	return be16toh(value);
+}
+
 uint32_t hash5Tuple(Packet* packet)
 {
 	if (!packet->isPacketOfType(IPv4) && !packet->isPacketOfType(IPv6))
@@ -64,7 +77,7 @@ uint32_t hash5Tuple(Packet* packet)
 	else
 	{
 		IPv6Layer* ipv6Layer = packet->getLayerOfType<IPv6Layer>();
-		if (portSrc == portDst && (uint64_t)ipv6Layer->getIPv6Header()->ipDst < (uint64_t)ipv6Layer->getIPv6Header()->ipSrc)
+		if (portSrc == portDst && memcmp(ipv6Layer->getIPv6Header()->ipDst, ipv6Layer->getIPv6Header()->ipSrc, 16) < 0)
 			srcPosition = 1;
 
 		vec[2 + srcPosition].buffer = ipv6Layer->getIPv6Header()->ipSrc;
@@ -102,8 +115,7 @@ uint32_t hash2Tuple(Packet* packet)
 	{
 		IPv6Layer* ipv6Layer = packet->getLayerOfType<IPv6Layer>();
 		int srcPosition = 0;
-		if ((uint64_t)ipv6Layer->getIPv6Header()->ipDst < (uint64_t)ipv6Layer->getIPv6Header()->ipSrc
-				&& (uint64_t)(ipv6Layer->getIPv6Header()->ipDst+8) < (uint64_t)(ipv6Layer->getIPv6Header()->ipSrc+8))
+		if (memcmp(ipv6Layer->getIPv6Header()->ipDst, ipv6Layer->getIPv6Header()->ipSrc, 16) < 0)
 			srcPosition = 1;
 
 		vec[0 + srcPosition].buffer = ipv6Layer->getIPv6Header()->ipSrc;
@@ -115,4 +127,144 @@ uint32_t hash2Tuple(Packet* packet)
 	return pcpp::fnv_hash(vec, 2);
 }
 
+bool getRawNetworkLayerOffsets(LinkLayerType linkType, int& etherTypeOffset, int& networkOffset)
+{
+	switch (linkType)
+	{
+	case LINKTYPE_ETHERNET:
+		etherTypeOffset = 12;
+		networkOffset = 14;
+		return true;
+
+	case LINKTYPE_LINUX_SLL:
+		etherTypeOffset = 14;
+		networkOffset = 16;
+		return true;
+
+	case LINKTYPE_NULL:
+	case LINKTYPE_LOOP:
+		etherTypeOffset = -1;
+		networkOffset = 4;
+		return true;
+
+	case LINKTYPE_RAW:
+	case LINKTYPE_DLT_RAW1:
+	case LINKTYPE_DLT_RAW2:
+	case LINKTYPE_IPV4:
+	case LINKTYPE_IPV6:
+		etherTypeOffset = -1;
+		networkOffset = 0;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool isVlanEtherType(uint16_t etherType)
+{
+	return etherType == PCPP_ETHERTYPE_VLAN || etherType == PCPP_ETHERTYPE_QINQ || etherType == PCPP_ETHERTYPE_QINQ_LEGACY;
+}
+
+bool parseRawPacketHeaders(const uint8_t* data, int dataLen, LinkLayerType linkType, RawPacketHeaders& headers)
+{
+	if (data == NULL)
+		return false;
+
+	int etherTypeOffset, offset;
+	if (!getRawNetworkLayerOffsets(linkType, etherTypeOffset, offset))
+		return false;
+
+	uint16_t etherType = 0;
+	headers.vlanId = 0;
+	if (etherTypeOffset >= 0)
+	{
+		if (dataLen < offset)
+			return false;
+		etherType = readBigEndianUint16(data + etherTypeOffset);
+	}
+
+	for (int i = 0; i < 2 && isVlanEtherType(etherType); i++)
+	{
+		if (dataLen < offset + 4)
+			return false;
+		if (i == 0)
+			headers.vlanId = readBigEndianUint16(data + offset) & 0xfff;
+		etherType = readBigEndianUint16(data + offset + 2);
+		offset += 4;
+	}
+
+	// link types without an EtherType are identified by the IP version
+	if (etherTypeOffset < 0 && dataLen > offset)
+	{
+		uint8_t ipVersion = data[offset] >> 4;
+		if (ipVersion == 4)
+			etherType = PCPP_ETHERTYPE_IP;
+		else if (ipVersion == 6)
+			etherType = PCPP_ETHERTYPE_IPV6;
+	}
+
+	const uint8_t* ipHeader = data + offset;
+	int ipDataLen = dataLen - offset;
+	int transportOffset;
+
+	if (etherType == PCPP_ETHERTYPE_IP)
+	{
+		// the header length is read only after the fixed header is known to be in the buffer
+		if (ipDataLen < (int)sizeof(iphdr))
+			return false;
+		int headerLen = (ipHeader[0] & 0x0f) * 4;
+		if (headerLen < (int)sizeof(iphdr))
+			return false;
+
+		headers.ipProtocol = ipHeader[9];
+		headers.transportProtocol = headers.ipProtocol;
+		headers.isFragment = (readBigEndianUint16(ipHeader + 6) & 0x3fff) != 0;
+		transportOffset = headerLen;
+	}
+	else if (etherType == PCPP_ETHERTYPE_IPV6)
+	{
+		if (ipDataLen < (int)sizeof(ip6_hdr))
+			return false;
+
+		headers.ipProtocol = ipHeader[6];
+
+		uint8_t nextHeader = headers.ipProtocol;
+		transportOffset = (int)sizeof(ip6_hdr);
+		while (transportOffset + 2 <= ipDataLen)
+		{
+			if (nextHeader == PACKETPP_IPPROTO_HOPOPTS || nextHeader == PACKETPP_IPPROTO_ROUTING || nextHeader == PACKETPP_IPPROTO_DSTOPTS)
+			{
+				nextHeader = ipHeader[transportOffset];
+				transportOffset += (ipHeader[transportOffset + 1] + 1) * 8;
+			}
+			else if (nextHeader == PACKETPP_IPPROTO_AH)
+			{
+				nextHeader = ipHeader[transportOffset];
+				transportOffset += (ipHeader[transportOffset + 1] + 2) * 4;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		headers.transportProtocol = nextHeader;
+		headers.isFragment = (nextHeader == PACKETPP_IPPROTO_FRAGMENT);
+	}
+	else
+	{
+		return false;
+	}
+
+	if (headers.isFragment || transportOffset + 4 > ipDataLen)
+		transportOffset = -1;
+
+	headers.etherType = etherType;
+	headers.ipHeader = ipHeader;
+	headers.ipDataLen = ipDataLen;
+	headers.transportOffset = transportOffset;
+	return true;
+}
+
 }  // namespace pcpp
@@ -0,0 +1,591 @@
+#define LOG_MODULE PacketLogModuleRuleClassifier
+
+#include "RuleClassifier.h"
+#include "Packet.h"
+#include "Logger.h"
+#include <string.h>
+#include <algorithm>
+
+namespace pcpp
+{
+
+// the number of keys a batch classification works on at a time
+#define PCPP_CLASSIFIER_BATCH_SIZE 32
+
+#define PCPP_CLASSIFIER_MIN_BUCKETS 16
+
+static void buildMask(uint8_t* mask, int prefixLen)
+{
+	memset(mask, 0, 16);
+	int fullBytes = prefixLen / 8;
+	memset(mask, 0xff, fullBytes);
+	if (prefixLen % 8 != 0)
+		mask[fullBytes] = (uint8_t)(0xff << (8 - prefixLen % 8));
+}
+
+static inline uint32_t rotl32(uint32_t value, int bits)
+{
+	return (value << bits) | (value >> (32 - bits));
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// ClassifierRule members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+ClassifierRule::ClassifierRule(uint32_t ruleId, int priority)
+{
+	m_RuleId = ruleId;
+	m_Priority = priority;
+	m_IPVersion = 0;
+	m_SrcPrefixLen = 0;
+	m_DstPrefixLen = 0;
+	m_HasProtocol = false;
+	m_Protocol = 0;
+	m_SrcPortFrom = 0;
+	m_SrcPortTo = 0xffff;
+	m_DstPortFrom = 0;
+	m_DstPortTo = 0xffff;
+	memset(m_SrcIP, 0, sizeof(m_SrcIP));
+	memset(m_DstIP, 0, sizeof(m_DstIP));
+}
+
+bool ClassifierRule::setPrefix(uint8_t* prefixData, uint8_t& prefixLenField, const uint8_t* addressData, uint8_t ipVersion, int prefixLen)
+{
+	int maxPrefixLen = (ipVersion == 4 ? 32 : 128);
+	if (prefixLen < 0 || prefixLen > maxPrefixLen)
+	{
+		LOG_ERROR("Rule %u: prefix length %d is out of range for IPv%d", m_RuleId, prefixLen, (int)ipVersion);
+		return false;
+	}
+
+	if (m_IPVersion != 0 && m_IPVersion != ipVersion)
+	{
+		LOG_ERROR("Rule %u: cannot set an IPv%d prefix on an IPv%d rule", m_RuleId, (int)ipVersion, (int)m_IPVersion);
+		return false;
+	}
+
+	uint8_t mask[16];
+	buildMask(mask, prefixLen);
+	memset(prefixData, 0, 16);
+	for (int i = 0; i < (ipVersion == 4 ? 4 : 16); i++)
+		prefixData[i] = addressData[i] & mask[i];
+
+	prefixLenField = (uint8_t)prefixLen;
+	m_IPVersion = ipVersion;
+	return true;
+}
+
+bool ClassifierRule::setSrcIPv4(const IPv4Address& address, int prefixLen)
+{
+	uint32_t addressAsInt = address.toInt();
+	return setPrefix(m_SrcIP, m_SrcPrefixLen, (const uint8_t*)&addressAsInt, 4, prefixLen);
+}
+
+bool ClassifierRule::setDstIPv4(const IPv4Address& address, int prefixLen)
+{
+	uint32_t addressAsInt = address.toInt();
+	return setPrefix(m_DstIP, m_DstPrefixLen, (const uint8_t*)&addressAsInt, 4, prefixLen);
+}
+
+bool ClassifierRule::setSrcIPv6(const IPv6Address& address, int prefixLen)
+{
+	uint8_t addressData[16];
+	address.copyTo(addressData);
+	return setPrefix(m_SrcIP, m_SrcPrefixLen, addressData, 6, prefixLen);
+}
+
+bool ClassifierRule::setDstIPv6(const IPv6Address& address, int prefixLen)
+{
+	uint8_t addressData[16];
+	address.copyTo(addressData);
+	return setPrefix(m_DstIP, m_DstPrefixLen, addressData, 6, prefixLen);
+}
+
+void ClassifierRule::setProtocol(uint8_t protocol)
+{
+	m_HasProtocol = true;
+	m_Protocol = protocol;
+}
+
+bool ClassifierRule::setSrcPortRange(uint16_t fromPort, uint16_t toPort)
+{
+	if (fromPort > toPort)
+	{
+		LOG_ERROR("Rule %u: invalid source port range %d-%d", m_RuleId, (int)fromPort, (int)toPort);
+		return false;
+	}
+
+	m_SrcPortFrom = fromPort;
+	m_SrcPortTo = toPort;
+	return true;
+}
+
+bool ClassifierRule::setDstPortRange(uint16_t fromPort, uint16_t toPort)
+{
+	if (fromPort > toPort)
+	{
+		LOG_ERROR("Rule %u: invalid destination port range %d-%d", m_RuleId, (int)fromPort, (int)toPort);
+		return false;
+	}
+
+	m_DstPortFrom = fromPort;
+	m_DstPortTo = toPort;
+	return true;
+}
+
+bool ClassifierRule::matchFlowKey(const FlowKey& key) const
+{
+	if (!key.isValid())
+		return false;
+
+	if (m_IPVersion != 0 && m_IPVersion != (key.isIPv4() ? 4 : 6))
+		return false;
+
+	uint8_t srcMask[16];
+	uint8_t dstMask[16];
+	buildMask(srcMask, m_SrcPrefixLen);
+	buildMask(dstMask, m_DstPrefixLen);
+	const uint8_t* srcIP = key.getSrcIPData();
+	const uint8_t* dstIP = key.getDstIPData();
+	for (int i = 0; i < 16; i++)
+	{
+		if ((srcIP[i] & srcMask[i]) != m_SrcIP[i] || (dstIP[i] & dstMask[i]) != m_DstIP[i])
+			return false;
+	}
+
+	if (m_HasProtocol && key.getProtocol() != m_Protocol)
+		return false;
+
+	return key.getSrcPort() >= m_SrcPortFrom && key.getSrcPort() <= m_SrcPortTo &&
+			key.getDstPort() >= m_DstPortFrom && key.getDstPort() <= m_DstPortTo;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~
+// RuleClassifier members
+// ~~~~~~~~~~~~~~~~~~~~~~
+
+bool RuleClassifier::TupleKey::operator==(const TupleKey& other) const
+{
+	return memcmp(this, &other, sizeof(TupleKey)) == 0;
+}
+
+/**
+ * All the rules of the same shape: IP version, prefix lengths, and which of the protocol and the ports are exact values. The rules are
+ * kept in a hash table keyed by their fields masked to the shape, so all the rules a packet may match are found with one lookup
+ */
+struct RuleClassifier::Tuple
+{
+	uint8_t ipVersion;
+	uint8_t srcPrefixLen;
+	uint8_t dstPrefixLen;
+	bool exactProtocol;
+	bool exactSrcPort;
+	bool exactDstPort;
+	uint8_t srcMask[16];
+	uint8_t dstMask[16];
+	std::vector<std::vector<TupleNode> > buckets;
+	size_t numOfNodes;
+	// the number of rules of each priority, so the highest priority is known after a rule is removed
+	std::map<int, size_t> priorities;
+	int maxPriority;
+
+	Tuple(const ClassifierRule& rule)
+	{
+		ipVersion = rule.m_IPVersion;
+		srcPrefixLen = rule.m_SrcPrefixLen;
+		dstPrefixLen = rule.m_DstPrefixLen;
+		exactProtocol = rule.m_HasProtocol;
+		exactSrcPort = (rule.m_SrcPortFrom == rule.m_SrcPortTo);
+		exactDstPort = (rule.m_DstPortFrom == rule.m_DstPortTo);
+		buildMask(srcMask, srcPrefixLen);
+		buildMask(dstMask, dstPrefixLen);
+		buckets.resize(PCPP_CLASSIFIER_MIN_BUCKETS);
+		numOfNodes = 0;
+		maxPriority = rule.m_Priority;
+	}
+
+	bool hasShapeOf(const ClassifierRule& rule) const
+	{
+		return ipVersion == rule.m_IPVersion && srcPrefixLen == rule.m_SrcPrefixLen && dstPrefixLen == rule.m_DstPrefixLen &&
+				exactProtocol == rule.m_HasProtocol && exactSrcPort == (rule.m_SrcPortFrom == rule.m_SrcPortTo) &&
+				exactDstPort == (rule.m_DstPortFrom == rule.m_DstPortTo);
+	}
+
+	void makeKey(const uint8_t* srcIP, const uint8_t* dstIP, uint8_t protocol, uint16_t srcPort, uint16_t dstPort, TupleKey& key) const
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			key.srcIP[i] = srcIP[i] & srcMask[i];
+			key.dstIP[i] = dstIP[i] & dstMask[i];
+		}
+		key.protocol = (exactProtocol ? protocol : 0);
+		key.srcPort = (exactSrcPort ? srcPort : 0);
+		key.dstPort = (exactDstPort ? dstPort : 0);
+		memset(key.padding, 0, sizeof(key.padding));
+	}
+
+	void makeKey(const ClassifierRule& rule, TupleKey& key) const
+	{
+		makeKey(rule.m_SrcIP, rule.m_DstIP, rule.m_Protocol, rule.m_SrcPortFrom, rule.m_DstPortFrom, key);
+	}
+
+	void makeKey(const FlowKey& flowKey, TupleKey& key) const
+	{
+		makeKey(flowKey.getSrcIPData(), flowKey.getDstIPData(), flowKey.getProtocol(), flowKey.getSrcPort(), flowKey.getDstPort(), key);
+	}
+
+	static uint32_t hashKey(const TupleKey& key)
+	{
+		// a murmur3-style hash over the key words. The key is 40 bytes without padding holes
+		uint32_t hash = 0;
+		const uint8_t* data = (const uint8_t*)&key;
+		for (size_t offset = 0; offset < sizeof(TupleKey); offset += 4)
+		{
+			uint32_t word;
+			memcpy(&word, data + offset, sizeof(word));
+			word *= 0xcc9e2d51;
+			word = rotl32(word, 15);
+			word *= 0x1b873593;
+			hash ^= word;
+			hash = rotl32(hash, 13) * 5 + 0xe6546b64;
+		}
+
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	std::vector<TupleNode>& getBucket(const TupleKey& key) { return buckets[hashKey(key) & (buckets.size() - 1)]; }
+	const std::vector<TupleNode>& getBucket(const TupleKey& key) const { return buckets[hashKey(key) & (buckets.size() - 1)]; }
+
+	const TupleNode* findNode(const TupleKey& key) const
+	{
+		const std::vector<TupleNode>& bucket = getBucket(key);
+		for (std::vector<TupleNode>::const_iterator iter = bucket.begin(); iter != bucket.end(); iter++)
+		{
+			if (iter->key == key)
+				return &(*iter);
+		}
+
+		return NULL;
+	}
+
+	void insert(const StoredRule* storedRule)
+	{
+		TupleKey key;
+		makeKey(storedRule->rule, key);
+
+		std::vector<TupleNode>& bucket = getBucket(key);
+		TupleNode* node = NULL;
+		for (std::vector<TupleNode>::iterator iter = bucket.begin(); iter != bucket.end(); iter++)
+		{
+			if (iter->key == key)
+			{
+				node = &(*iter);
+				break;
+			}
+		}
+
+		if (node == NULL)
+		{
+			bucket.push_back(TupleNode());
+			node = &bucket.back();
+			node->key = key;
+			numOfNodes++;
+		}
+
+		std::vector<const StoredRule*>::iterator position = std::lower_bound(node->rules.begin(), node->rules.end(), storedRule, RuleClassifier::isBetter);
+		node->rules.insert(position, storedRule);
+
+		priorities[storedRule->rule.m_Priority]++;
+		maxPriority = priorities.rbegin()->first;
+
+		if (numOfNodes > buckets.size())
+			rehash(buckets.size() * 2);
+	}
+
+	void remove(const StoredRule* storedRule)
+	{
+		TupleKey key;
+		makeKey(storedRule->rule, key);
+
+		std::vector<TupleNode>& bucket = getBucket(key);
+		for (std::vector<TupleNode>::iterator iter = bucket.begin(); iter != bucket.end(); iter++)
+		{
+			if (!(iter->key == key))
+				continue;
+
+			iter->rules.erase(std::find(iter->rules.begin(), iter->rules.end(), storedRule));
+			if (iter->rules.empty())
+			{
+				bucket.erase(iter);
+				numOfNodes--;
+			}
+			break;
+		}
+
+		std::map<int, size_t>::iterator priorityIter = priorities.find(storedRule->rule.m_Priority);
+		if (--priorityIter->second == 0)
+			priorities.erase(priorityIter);
+		if (!priorities.empty())
+			maxPriority = priorities.rbegin()->first;
+	}
+
+	void rehash(size_t numOfBuckets)
+	{
+		std::vector<std::vector<TupleNode> > oldBuckets(numOfBuckets);
+		oldBuckets.swap(buckets);
+		for (std::vector<std::vector<TupleNode> >::iterator bucketIter = oldBuckets.begin(); bucketIter != oldBuckets.end(); bucketIter++)
+		{
+			for (std::vector<TupleNode>::iterator nodeIter = bucketIter->begin(); nodeIter != bucketIter->end(); nodeIter++)
+			{
+				std::vector<TupleNode>& newBucket = getBucket(nodeIter->key);
+				newBucket.push_back(TupleNode());
+				newBucket.back().key = nodeIter->key;
+				newBucket.back().rules.swap(nodeIter->rules);
+			}
+		}
+	}
+};
+
+RuleClassifier::RuleClassifier() : m_NextSequence(0)
+{
+}
+
+RuleClassifier::~RuleClassifier()
+{
+	clear();
+}
+
+bool RuleClassifier::isBetter(const StoredRule* rule, const StoredRule* other)
+{
+	if (rule->rule.m_Priority != other->rule.m_Priority)
+		return rule->rule.m_Priority > other->rule.m_Priority;
+
+	return rule->sequence < other->sequence;
+}
+
+RuleClassifier::Tuple* RuleClassifier::findTuple(const ClassifierRule& rule) const
+{
+	for (std::vector<Tuple*>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+	{
+		if ((*iter)->hasShapeOf(rule))
+			return *iter;
+	}
+
+	return NULL;
+}
+
+void RuleClassifier::sortTuples()
+{
+	// tuples are mostly sorted already, only the tuple that changed may be out of place, so insertion sort is linear here
+	for (size_t i = 1; i < m_Tuples.size(); i++)
+	{
+		Tuple* tuple = m_Tuples[i];
+		size_t j = i;
+		while (j > 0 && tuple->maxPriority > m_Tuples[j - 1]->maxPriority)
+		{
+			m_Tuples[j] = m_Tuples[j - 1];
+			j--;
+		}
+		m_Tuples[j] = tuple;
+	}
+}
+
+bool RuleClassifier::addRule(const ClassifierRule& rule)
+{
+	if (m_Rules.find(rule.m_RuleId) != m_Rules.end())
+	{
+		LOG_ERROR("A rule with ID %u already exists", rule.m_RuleId);
+		return false;
+	}
+
+	std::map<uint32_t, StoredRule>::iterator ruleIter = m_Rules.insert(std::pair<uint32_t, StoredRule>(rule.m_RuleId, StoredRule(rule, m_NextSequence++))).first;
+
+	Tuple* tuple = findTuple(rule);
+	bool isNewTuple = (tuple == NULL);
+	if (isNewTuple)
+	{
+		tuple = new Tuple(rule);
+		m_Tuples.push_back(tuple);
+		LOG_DEBUG("Created tuple #%d for rule %u", (int)m_Tuples.size(), rule.m_RuleId);
+	}
+
+	int prevMaxPriority = tuple->maxPriority;
+	tuple->insert(&ruleIter->second);
+	if (isNewTuple || tuple->maxPriority != prevMaxPriority)
+		sortTuples();
+
+	return true;
+}
+
+size_t RuleClassifier::addRules(const std::vector<ClassifierRule>& rules)
+{
+	size_t numOfAdded = 0;
+	for (std::vector<ClassifierRule>::const_iterator iter = rules.begin(); iter != rules.end(); iter++)
+	{
+		if (addRule(*iter))
+			numOfAdded++;
+	}
+
+	return numOfAdded;
+}
+
+bool RuleClassifier::removeRule(uint32_t ruleId)
+{
+	std::map<uint32_t, StoredRule>::iterator ruleIter = m_Rules.find(ruleId);
+	if (ruleIter == m_Rules.end())
+		return false;
+
+	Tuple* tuple = findTuple(ruleIter->second.rule);
+	int prevMaxPriority = tuple->maxPriority;
+	tuple->remove(&ruleIter->second);
+	m_Rules.erase(ruleIter);
+
+	if (tuple->priorities.empty())
+	{
+		m_Tuples.erase(std::find(m_Tuples.begin(), m_Tuples.end(), tuple));
+		delete tuple;
+	}
+	else if (tuple->maxPriority != prevMaxPriority)
+		sortTuples();
+
+	return true;
+}
+
+void RuleClassifier::clear()
+{
+	for (std::vector<Tuple*>::iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+		delete *iter;
+
+	m_Tuples.clear();
+	m_Rules.clear();
+}
+
+const ClassifierRule* RuleClassifier::getRule(uint32_t ruleId) const
+{
+	std::map<uint32_t, StoredRule>::const_iterator ruleIter = m_Rules.find(ruleId);
+	if (ruleIter == m_Rules.end())
+		return NULL;
+
+	return &ruleIter->second.rule;
+}
+
+void RuleClassifier::searchTuple(const Tuple* tuple, const FlowKey& key, const StoredRule*& best)
+{
+	if (tuple->ipVersion != 0 && tuple->ipVersion != (key.isIPv4() ? 4 : 6))
+		return;
+
+	TupleKey tupleKey;
+	tuple->makeKey(key, tupleKey);
+	const TupleNode* node = tuple->findNode(tupleKey);
+	if (node == NULL)
+		return;
+
+	// the rules are sorted, so the first one in port range is the best in this node
+	uint16_t srcPort = key.getSrcPort();
+	uint16_t dstPort = key.getDstPort();
+	for (std::vector<const StoredRule*>::const_iterator iter = node->rules.begin(); iter != node->rules.end(); iter++)
+	{
+		const ClassifierRule& rule = (*iter)->rule;
+		if (best != NULL && !isBetter(*iter, best))
+			return;
+
+		if (srcPort >= rule.m_SrcPortFrom && srcPort <= rule.m_SrcPortTo && dstPort >= rule.m_DstPortFrom && dstPort <= rule.m_DstPortTo)
+		{
+			best = *iter;
+			return;
+		}
+	}
+}
+
+const ClassifierRule* RuleClassifier::classify(const FlowKey& key) const
+{
+	if (!key.isValid())
+		return NULL;
+
+	const StoredRule* best = NULL;
+	for (std::vector<Tuple*>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+	{
+		// no rule in the remaining tuples can beat the best rule found
+		if (best != NULL && (*iter)->maxPriority < best->rule.m_Priority)
+			break;
+
+		searchTuple(*iter, key, best);
+	}
+
+	return (best != NULL ? &best->rule : NULL);
+}
+
+const ClassifierRule* RuleClassifier::classify(Packet* packet) const
+{
+	FlowKey key;
+	if (!key.fromPacket(packet))
+		return NULL;
+
+	return classify(key);
+}
+
+size_t RuleClassifier::classify(const FlowKey* keys, size_t numOfKeys, const ClassifierRule** results) const
+{
+	size_t numOfMatched = 0;
+	const StoredRule* best[PCPP_CLASSIFIER_BATCH_SIZE];
+
+	for (size_t batchStart = 0; batchStart < numOfKeys; batchStart += PCPP_CLASSIFIER_BATCH_SIZE)
+	{
+		size_t batchSize = std::min((size_t)PCPP_CLASSIFIER_BATCH_SIZE, numOfKeys - batchStart);
+		const FlowKey* batchKeys = keys + batchStart;
+		memset(best, 0, sizeof(best));
+
+		// search each tuple for the whole batch before moving to the next tuple
+		for (std::vector<Tuple*>::const_iterator iter = m_Tuples.begin(); iter != m_Tuples.end(); iter++)
+		{
+			const Tuple* tuple = *iter;
+			bool anyKeyLeft = false;
+			for (size_t i = 0; i < batchSize; i++)
+			{
+				if (!batchKeys[i].isValid() || (best[i] != NULL && tuple->maxPriority < best[i]->rule.m_Priority))
+					continue;
+
+				anyKeyLeft = true;
+				searchTuple(tuple, batchKeys[i], best[i]);
+			}
+
+			if (!anyKeyLeft)
+				break;
+		}
+
+		for (size_t i = 0; i < batchSize; i++)
+		{
+			results[batchStart + i] = (best[i] != NULL ? &best[i]->rule : NULL);
+			if (best[i] != NULL)
+				numOfMatched++;
+		}
+	}
+
+	return numOfMatched;
+}
+
+size_t RuleClassifier::classify(Packet** packets, size_t numOfPackets, const ClassifierRule** results) const
+{
+	size_t numOfMatched = 0;
+	FlowKey keys[PCPP_CLASSIFIER_BATCH_SIZE];
+
+	for (size_t batchStart = 0; batchStart < numOfPackets; batchStart += PCPP_CLASSIFIER_BATCH_SIZE)
+	{
+		size_t batchSize = std::min((size_t)PCPP_CLASSIFIER_BATCH_SIZE, numOfPackets - batchStart);
+		for (size_t i = 0; i < batchSize; i++)
+			keys[i].fromPacket(packets[batchStart + i]);
+
+		numOfMatched += classify(keys, batchSize, results + batchStart);
+	}
+
+	return numOfMatched;
+}
+
+} // namespace pcpp
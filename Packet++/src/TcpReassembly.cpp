@@ -4,7 +4,6 @@
 #include "TcpLayer.h"
 #include "IPv4Layer.h"
 #include "IPv6Layer.h"
-#include "PacketUtils.h"
 #include "IpAddress.h"
 #include "Logger.h"
 #include <sstream>
@@ -163,8 +162,15 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 
 	TcpReassemblyData* tcpReassemblyData = NULL;
 
-	// calculate flow key for this packet
-	uint32_t flowKey = hash5Tuple(&tcpData);
+	// calculate flow key for this packet. The canonical form is used so both sides of the connection get the same key
+	// A packet whose key has no TCP ports (the TCP layer doesn't directly follow the innermost IP layer) is ignored
+	FlowKey flowKey;
+	if (!flowKey.fromPacket(&tcpData) || flowKey.getProtocol() != PACKETPP_IPPROTO_TCP)
+	{
+		LOG_DEBUG("Cannot extract the TCP flow key of the packet. Ignoring this packet");
+		return;
+	}
+	flowKey.makeCanonical();
 
 	// find the connection in the connection map
 	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
@@ -173,7 +179,7 @@ void TcpReassembly::reassemblePacket(Packet& tcpData)
 	// the connection is already closed when the value of mapped type is NULL
 	if (iter != m_ConnectionList.end() && iter->second == NULL)
 	{
-		LOG_DEBUG("Ignoring packet of already closed flow [0x%X]", flowKey);
+		LOG_DEBUG("Ignoring packet of already closed flow [%s]", flowKey.toString().c_str());
 		return;
 	}
 
@@ -489,7 +495,7 @@ std::string TcpReassembly::prepareMissingDataMessage(uint32_t missingDataLen)
 	return missingDataTextStream.str();
 }
 
-void TcpReassembly::handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sideIndex, uint32_t flowKey)
+void TcpReassembly::handleFinOrRst(TcpReassemblyData* tcpReassemblyData, int sideIndex, const FlowKey& flowKey)
 {
 	// if this side already saw a FIN or RST packet, do nothing and return
 	if (tcpReassemblyData->twoSides[sideIndex].gotFinOrRst)
@@ -682,25 +688,25 @@ void TcpReassembly::checkOutOfOrderFragments(TcpReassemblyData* tcpReassemblyDat
 	} while (foundSomething);
 }
 
-void TcpReassembly::closeConnection(uint32_t flowKey)
+void TcpReassembly::closeConnection(const FlowKey& flowKey)
 {
 	closeConnectionInternal(flowKey, TcpReassembly::TcpReassemblyConnectionClosedManually);
 }
 
-void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReason reason)
+void TcpReassembly::closeConnectionInternal(FlowKey flowKey, ConnectionEndReason reason)
 {
 	TcpReassemblyData* tcpReassemblyData = NULL;
 	ConnectionList::iterator iter = m_ConnectionList.find(flowKey);
 	if (iter == m_ConnectionList.end())
 	{
-		LOG_ERROR("Cannot close flow with key 0x%X: cannot find flow", flowKey);
+		LOG_ERROR("Cannot close flow with key [%s]: cannot find flow", flowKey.toString().c_str());
 		return;
 	}
 
 	if (iter->second == NULL) // the connection is already closed
 		return;
 
-	LOG_DEBUG("Closing connection with flow key 0x%X", flowKey);
+	LOG_DEBUG("Closing connection with flow key [%s]", flowKey.toString().c_str());
 
 	tcpReassemblyData = iter->second;
 
@@ -717,7 +723,7 @@ void TcpReassembly::closeConnectionInternal(uint32_t flowKey, ConnectionEndReaso
 	iter->second = NULL; // mark the connection as closed
 	insertIntoCleanupList(flowKey);
 
-	LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
+	LOG_DEBUG("Connection with flow key [%s] is closed", flowKey.toString().c_str());
 }
 
 void TcpReassembly::closeAllConnections()
@@ -732,8 +738,8 @@ void TcpReassembly::closeAllConnections()
 
 		TcpReassemblyData* tcpReassemblyData = iter->second;
 
-		uint32_t flowKey = tcpReassemblyData->connData.flowKey;
-		LOG_DEBUG("Closing connection with flow key 0x%X", flowKey);
+		FlowKey flowKey = tcpReassemblyData->connData.flowKey;
+		LOG_DEBUG("Closing connection with flow key [%s]", flowKey.toString().c_str());
 
 		LOG_DEBUG("Calling checkOutOfOrderFragments on side 0");
 		checkOutOfOrderFragments(tcpReassemblyData, 0, true);
@@ -748,7 +754,7 @@ void TcpReassembly::closeAllConnections()
 		iter->second = NULL; // mark the connection as closed
 		insertIntoCleanupList(flowKey);
 
-		LOG_DEBUG("Connection with flow key 0x%X is closed", flowKey);
+		LOG_DEBUG("Connection with flow key [%s] is closed", flowKey.toString().c_str());
 	}
 }
 
@@ -761,7 +767,7 @@ int TcpReassembly::isConnectionOpen(const ConnectionData& connection) const
 	return -1;
 }
 
-void TcpReassembly::insertIntoCleanupList(uint32_t flowKey)
+void TcpReassembly::insertIntoCleanupList(const FlowKey& flowKey)
 {
 	// m_CleanupList is a map with key of type time_t (expiration time). The mapped type is a list that stores the flow keys to be cleared in certain point of time.
 	// m_CleanupList.insert inserts an empty list if the container does not already contain an element with an equivalent key,
@@ -0,0 +1,134 @@
+#ifndef PCAPPP_BPF_JIT
+#define PCAPPP_BPF_JIT
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+//Forward Declaration - used in BpfJit
+struct bpf_program;
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class BpfJit
+	 * A BPF program (as compiled by libpcap, for example with pcap_compile_nopcap()) translated to native code, for matching packets in
+	 * user-space faster than libpcap's pcap_offline_filter(), which interprets the program instruction by instruction.<BR>
+	 * On x86-64 the program is compiled to machine code when compile() is called. On other architectures, or if executable memory can't
+	 * be allocated, the program is run by an interpreter that implements the same semantics. Either way run() returns exactly what
+	 * pcap_offline_filter() returns for the same program and packet: the number of bytes to accept, where 0 means the packet doesn't match.
+	 * A read beyond the captured length, or a division by zero, rejects the packet.<BR>
+	 * The program is validated before it's compiled (as bpf_validate() does) so invalid programs are rejected instead of being run.
+	 * A compiled program keeps no per-packet state, so a single instance may be used by several threads at the same time
+	 */
+	class BpfJit
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Creates an empty program, call compile() before using it
+		 */
+		BpfJit();
+
+		/**
+		 * A d'tor for this class. Frees the native code
+		 */
+		~BpfJit();
+
+		/**
+		 * Compile a BPF program. A previously compiled program is replaced. The BPF instructions are copied, so the bpf_program may be
+		 * freed (for example with pcap_freecode()) after this method returns
+		 * @param[in] program The BPF program to compile
+		 * @param[in] useJit If true (the default) the program is compiled to native code when the architecture supports it, otherwise
+		 * it's always run by the interpreter
+		 * @return True if the program is valid and was compiled, false otherwise (in which case an error is written to log)
+		 */
+		bool compile(const struct bpf_program* program, bool useJit = true);
+
+		/**
+		 * Clear the compiled program and free its native code
+		 */
+		void clear();
+
+		/**
+		 * @return True if a program was compiled successfully
+		 */
+		bool isCompiled() const { return !m_Program.empty(); }
+
+		/**
+		 * @return True if the compiled program runs as native code, false if it's run by the interpreter or if no program was compiled
+		 */
+		bool isJitted() const { return m_JitFunction != NULL; }
+
+		/**
+		 * @return The number of BPF instructions in the compiled program
+		 */
+		size_t getNumOfInstructions() const { return m_Program.size(); }
+
+		/**
+		 * Run the compiled program on a packet
+		 * @param[in] packetData A pointer to the packet data
+		 * @param[in] capturedLen The number of bytes in packetData
+		 * @param[in] wireLen The length of the packet on the wire, which is what BPF "len" loads
+		 * @return The value the program returns: 0 if the packet doesn't match, otherwise the number of bytes to accept. 0 is also
+		 * returned if no program was compiled
+		 */
+		uint32_t run(const uint8_t* packetData, uint32_t capturedLen, uint32_t wireLen) const
+		{
+			if (m_JitFunction != NULL)
+				return m_JitFunction(packetData, capturedLen, wireLen);
+
+			return interpret(packetData, capturedLen, wireLen);
+		}
+
+		/**
+		 * Match a packet with the compiled program
+		 * @param[in] packetData A pointer to the packet data
+		 * @param[in] capturedLen The number of bytes in packetData
+		 * @param[in] wireLen The length of the packet on the wire
+		 * @return True if the packet matches the program, false otherwise
+		 */
+		bool matchPacket(const uint8_t* packetData, uint32_t capturedLen, uint32_t wireLen) const { return run(packetData, capturedLen, wireLen) != 0; }
+
+		/**
+		 * @return True if programs can be compiled to native code on this architecture
+		 */
+		static bool isJitSupported();
+
+	private:
+		struct Instruction
+		{
+			uint16_t code;
+			uint8_t jt;
+			uint8_t jf;
+			uint32_t k;
+		};
+
+		typedef uint32_t (*JitFunction)(const uint8_t* packetData, uint32_t capturedLen, uint32_t wireLen);
+
+		std::vector<Instruction> m_Program;
+		bool m_UsesMemory;
+		JitFunction m_JitFunction;
+		void* m_JitCode;
+		size_t m_JitCodeSize;
+
+		// the native code can't be shared between instances
+		BpfJit(const BpfJit& other);
+		BpfJit& operator=(const BpfJit& other);
+
+		bool validate() const;
+		uint32_t interpret(const uint8_t* packetData, uint32_t capturedLen, uint32_t wireLen) const;
+		bool generateNativeCode();
+		void freeNativeCode();
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_BPF_JIT */
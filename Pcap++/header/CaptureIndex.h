@@ -0,0 +1,447 @@
+#ifndef PCAPPP_CAPTURE_INDEX
+#define PCAPPP_CAPTURE_INDEX
+
+#include "IpAddress.h"
+#include "ProtocolType.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/**
+ * @file
+ * This file provides CaptureIndex, a small summary of a capture file (its time range, packet and byte counts, protocols and the IP addresses,
+ * ports and flows its packets contain) that is built once and saved next to the file. Tools that search large archives of capture files can
+ * consult the summary to skip files that can't contain the packets they look for without reading them, and to find the parts of a file
+ * that may contain them
+ */
+
+/** The default amount of packet data summarized by each chunk of a CaptureIndex */
+#define DEFAULT_CAPTURE_INDEX_CHUNK_SIZE (4 * 1024 * 1024)
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class IFileReaderDevice;
+	class RawPacket;
+
+	/**
+	 * @class BloomFilter
+	 * A Bloom filter: a compact set of byte strings that may answer that an item is in the set when it isn't (with a configurable
+	 * probability) but never answers that an item isn't in the set when it is
+	 */
+	class BloomFilter
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Creates an empty filter sized for the expected number of items
+		 * @param[in] expectedNumOfItems The number of distinct items expected to be added. The default is 0 which creates the smallest
+		 * filter possible
+		 * @param[in] falsePositiveRate The probability of a false positive answer once the expected number of items was added. The default
+		 * is 1%
+		 */
+		BloomFilter(size_t expectedNumOfItems = 0, double falsePositiveRate = 0.01);
+
+		/**
+		 * Add an item to the filter
+		 * @param[in] data A pointer to the item bytes
+		 * @param[in] dataLen The item length
+		 */
+		void add(const uint8_t* data, size_t dataLen);
+
+		/**
+		 * Check whether an item may be in the filter
+		 * @param[in] data A pointer to the item bytes
+		 * @param[in] dataLen The item length
+		 * @return False if the item was never added to the filter, true if it may have been added
+		 */
+		bool mayContain(const uint8_t* data, size_t dataLen) const;
+
+		/**
+		 * Remove all the items from the filter
+		 */
+		void clear();
+
+		/**
+		 * @return The size of the filter in bits
+		 */
+		size_t getNumOfBits() const { return m_Bits.size() * 64; }
+
+		/**
+		 * @return The number of bits set for each item
+		 */
+		int getNumOfHashes() const { return m_NumOfHashes; }
+
+		/**
+		 * Write the filter to a buffer
+		 * @param[out] buffer A buffer the filter is appended to
+		 */
+		void serialize(std::vector<uint8_t>& buffer) const;
+
+		/**
+		 * Read a filter written by serialize()
+		 * @param[in] data A pointer to the serialized filter
+		 * @param[in] dataLen The number of bytes available
+		 * @return The number of bytes read, or 0 if the data doesn't contain a valid filter
+		 */
+		size_t deserialize(const uint8_t* data, size_t dataLen);
+
+	private:
+		friend class CaptureIndex;
+
+		std::vector<uint64_t> m_Bits;
+		int m_NumOfHashes;
+
+		void addHash(uint64_t hash);
+	};
+
+
+	/**
+	 * @class CaptureIndexQuery
+	 * The criteria a CaptureIndex is queried with. A capture file (or a chunk of it) may match a query only if it contains all the addresses,
+	 * ports, flows and protocols of the query, and some of its packets are within the query time range. The default query has no criteria and
+	 * matches every file
+	 */
+	class CaptureIndexQuery
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Creates a query without criteria
+		 */
+		CaptureIndexQuery();
+
+		/**
+		 * Require an IP address to appear in the file, as the source or destination address of an IPv4 or IPv6 packet or as the sender or
+		 * target address of an ARP packet
+		 * @param[in] address The address
+		 */
+		void addAddress(const IPAddress& address);
+
+		/**
+		 * Require a port to appear in the file, as the source or destination port of a TCP, UDP or SCTP packet
+		 * @param[in] port The port
+		 */
+		void addPort(uint16_t port);
+
+		/**
+		 * Require a flow to appear in the file: a TCP, UDP or SCTP packet between 2 endpoints, in either direction
+		 * @param[in] address1 The address of one endpoint
+		 * @param[in] port1 The port of the same endpoint
+		 * @param[in] address2 The address of the other endpoint, of the same IP version as address1
+		 * @param[in] port2 The port of the other endpoint
+		 */
+		void addFlow(const IPAddress& address1, uint16_t port1, const IPAddress& address2, uint16_t port2);
+
+		/**
+		 * Require packets of a protocol to appear in the file
+		 * @param[in] protocol The protocol. If it's a combination of protocols (for example pcpp#IP) packets of any of them are required
+		 */
+		void addProtocol(ProtocolType protocol);
+
+		/**
+		 * Require the file to have packets within a time range
+		 * @param[in] startTime The beginning of the range
+		 * @param[in] endTime The end of the range (inclusive)
+		 */
+		void setTimeRange(timespec startTime, timespec endTime);
+
+		/**
+		 * @return True if the query has no criteria
+		 */
+		bool isEmpty() const
+		{
+			return m_IPv4Addresses.empty() && m_IPv6Addresses.empty() && m_Ports.empty() && m_Flows.empty() && m_Protocols.empty() && !m_HasTimeRange;
+		}
+
+	private:
+		friend class CaptureIndexSummary;
+
+		std::vector<IPv4Address> m_IPv4Addresses;
+		std::vector<IPv6Address> m_IPv6Addresses;
+		std::vector<uint16_t> m_Ports;
+		// flow keys as they are added to the index Bloom filters
+		std::vector<std::string> m_Flows;
+		std::vector<ProtocolType> m_Protocols;
+		bool m_HasTimeRange;
+		timespec m_StartTime;
+		timespec m_EndTime;
+	};
+
+
+	/**
+	 * @class CaptureIndexSummary
+	 * The summary of a range of consecutive packets of a capture file, which is either the whole file (see CaptureIndex#getFileSummary()) or
+	 * one of its chunks (see CaptureIndex#getChunk())
+	 */
+	class CaptureIndexSummary
+	{
+	public:
+
+		/**
+		 * The value of getFileOffset() when the offset isn't known
+		 */
+		static const uint64_t UnknownFileOffset = (uint64_t)-1;
+
+		/**
+		 * A c'tor for this class. Creates a summary of no packets
+		 */
+		CaptureIndexSummary();
+
+		/**
+		 * @return The index of the first packet in the file, where the first packet of the file is 0
+		 */
+		uint64_t getFirstPacketIndex() const { return m_FirstPacketIndex; }
+
+		/**
+		 * @return The offset in the capture file of the record of the first packet. The offset is known for pcap files only, for
+		 * pcap-ng files (whose blocks have a variable length) it's UnknownFileOffset
+		 */
+		uint64_t getFileOffset() const { return m_FileOffset; }
+
+		/**
+		 * @return The number of packets
+		 */
+		uint64_t getPacketCount() const { return m_PacketCount; }
+
+		/**
+		 * @return The number of captured bytes of all the packets, not including the capture file headers
+		 */
+		uint64_t getByteCount() const { return m_ByteCount; }
+
+		/**
+		 * @return The timestamp of the earliest packet, zero if there are no packets
+		 */
+		timespec getStartTime() const { return m_StartTime; }
+
+		/**
+		 * @return The timestamp of the latest packet, zero if there are no packets
+		 */
+		timespec getEndTime() const { return m_EndTime; }
+
+		/**
+		 * @return All the protocols found in the packets, as a bit mask of ProtocolType values
+		 */
+		ProtocolType getProtocols() const { return m_Protocols; }
+
+		/**
+		 * Check whether the packets may match a query
+		 * @param[in] query The query
+		 * @return False if the packets certainly don't match the query, true otherwise
+		 */
+		bool mayMatch(const CaptureIndexQuery& query) const;
+
+	private:
+		friend class CaptureIndex;
+
+		uint64_t m_FirstPacketIndex;
+		uint64_t m_FileOffset;
+		uint64_t m_PacketCount;
+		uint64_t m_ByteCount;
+		timespec m_StartTime;
+		timespec m_EndTime;
+		ProtocolType m_Protocols;
+		// set if some packets couldn't be parsed, in which case the protocols and filters aren't complete
+		bool m_HasUnparsedPackets;
+		BloomFilter m_Addresses;
+		BloomFilter m_Ports;
+		BloomFilter m_Flows;
+
+		void addPacketInfo(const timespec& timestamp, uint64_t packetLen, ProtocolType protocols, bool isParsed);
+		void serialize(std::vector<uint8_t>& buffer) const;
+		size_t deserialize(const uint8_t* data, size_t dataLen);
+	};
+
+
+	/**
+	 * @class CaptureIndex
+	 * A summary of a capture file: the number of packets and bytes, the time range of the packets, the protocols they contain and Bloom
+	 * filters of the IP addresses, ports and flows (pairs of endpoints) they contain. Besides the summary of the whole file, the index keeps
+	 * the same summary for every chunk of consecutive packets holding a few MB of packet data (see DEFAULT_CAPTURE_INDEX_CHUNK_SIZE), so a
+	 * query can find the parts of a large file that may match it, by their packet index or file offset (see getMatchingChunks()).<BR>
+	 * The index is built by reading the file once (see build()) or while the file is written (see PcapFileWriterDevice#setIndexEnabled()),
+	 * and can be saved to an index file next to the capture file (see getIndexFileName()) so later searches read only the index. Since
+	 * Bloom filters may give false positives, mayMatch() may return true for files that don't match a query, but never returns false for
+	 * files that do.<BR>
+	 * The index records the size of the capture file it was built from, so an index that is older than its file (for example of a file that
+	 * was appended to) can be detected with isUpToDate()
+	 */
+	class CaptureIndex
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Creates an empty index
+		 * @param[in] chunkSize The amount of packet data (in bytes) summarized by each chunk. A chunk ends with the first packet that
+		 * brings its data to this size. The default is DEFAULT_CAPTURE_INDEX_CHUNK_SIZE
+		 */
+		CaptureIndex(uint64_t chunkSize = DEFAULT_CAPTURE_INDEX_CHUNK_SIZE);
+
+		/**
+		 * Build the index of a capture file by reading all its packets. The reader must not have a filter set
+		 * @param[in] reader An opened reader of the file. The reader is read until its end
+		 * @return True if the index was built, false if the reader isn't opened (in which case an error is written to log)
+		 */
+		bool build(IFileReaderDevice& reader);
+
+		/**
+		 * Build the index of a capture file by reading all its packets
+		 * @param[in] captureFileName The capture file, in pcap or pcap-ng format
+		 * @return True if the index was built, false if the file couldn't be opened (in which case an error is written to log)
+		 */
+		bool build(const std::string& captureFileName);
+
+		/**
+		 * Start building the index incrementally, for example while the capture file is written. Any previous content of the index is
+		 * removed. Packets are then added in their order in the file with addPacket() or addPackets(), and the index is complete once
+		 * finishBuilding() is called
+		 */
+		void startBuilding();
+
+		/**
+		 * Add the next packet of the file to an index being built
+		 * @param[in] rawPacket The packet
+		 * @param[in] fileOffset The offset of the packet record in the capture file, or CaptureIndexSummary#UnknownFileOffset
+		 * @return False if startBuilding() wasn't called (in which case an error is written to log), true otherwise
+		 */
+		bool addPacket(RawPacket& rawPacket, uint64_t fileOffset = CaptureIndexSummary::UnknownFileOffset);
+
+		/**
+		 * Add all the packets a reader reads to an index being built. If the reader reads a pcap file the packet file offsets are
+		 * calculated, assuming the reader reads the file from its beginning and has no filter set
+		 * @param[in] reader An opened reader. The reader is read until its end
+		 * @return False if startBuilding() wasn't called or the reader isn't opened (in which case an error is written to log), true
+		 * otherwise
+		 */
+		bool addPackets(IFileReaderDevice& reader);
+
+		/**
+		 * Complete an index being built. The Bloom filters are sized by the number of distinct items found in the packets
+		 * @param[in] captureFileSize The size of the capture file, used by isUpToDate()
+		 * @return False if startBuilding() wasn't called (in which case an error is written to log), true otherwise
+		 */
+		bool finishBuilding(uint64_t captureFileSize);
+
+		/**
+		 * Write the index to a file
+		 * @param[in] indexFileName The index file name
+		 * @return True if the index was written, false otherwise (in which case an error is written to log)
+		 */
+		bool writeToFile(const std::string& indexFileName) const;
+
+		/**
+		 * Read an index written by writeToFile()
+		 * @param[in] indexFileName The index file name
+		 * @return True if the index was read, false if the file doesn't exist or isn't a valid index (in which case an error is written
+		 * to log)
+		 */
+		bool readFromFile(const std::string& indexFileName);
+
+		/**
+		 * @param[in] captureFileName A capture file name
+		 * @return The name of the index file kept next to the capture file, which is the capture file name followed by ".pcppidx"
+		 */
+		static std::string getIndexFileName(const std::string& captureFileName);
+
+		/**
+		 * Check whether the index describes the current content of a capture file
+		 * @param[in] captureFileName The capture file name
+		 * @return True if the index was built from this file and the file wasn't changed since, as far as its size shows
+		 */
+		bool isUpToDate(const std::string& captureFileName) const;
+
+		/**
+		 * Check whether the capture file may contain packets that match a query
+		 * @param[in] query The query
+		 * @return False if the file certainly doesn't contain packets that match the query, true otherwise
+		 */
+		bool mayMatch(const CaptureIndexQuery& query) const;
+
+		/**
+		 * Find the chunks of the capture file that may contain packets that match a query
+		 * @param[in] query The query
+		 * @param[out] chunks A vector the chunks that may match are appended to, in their order in the file. The pointers are valid as long
+		 * as the index isn't changed
+		 * @return The number of chunks found
+		 */
+		size_t getMatchingChunks(const CaptureIndexQuery& query, std::vector<const CaptureIndexSummary*>& chunks) const;
+
+		/**
+		 * @return The summary of the whole file
+		 */
+		const CaptureIndexSummary& getFileSummary() const { return m_FileSummary; }
+
+		/**
+		 * @return The number of chunks
+		 */
+		size_t getNumOfChunks() const { return m_Chunks.size(); }
+
+		/**
+		 * @param[in] index The chunk index
+		 * @return The summary of the chunk. The index must be smaller than getNumOfChunks()
+		 */
+		const CaptureIndexSummary& getChunk(size_t index) const { return m_Chunks[index]; }
+
+		/**
+		 * @return The amount of packet data summarized by each chunk
+		 */
+		uint64_t getChunkSize() const { return m_ChunkSize; }
+
+		/**
+		 * @return The number of packets in the file
+		 */
+		uint64_t getPacketCount() const { return m_FileSummary.getPacketCount(); }
+
+		/**
+		 * @return The number of captured bytes in the file, not including the capture file headers
+		 */
+		uint64_t getByteCount() const { return m_FileSummary.getByteCount(); }
+
+		/**
+		 * @return The timestamp of the earliest packet in the file, zero if the file has no packets
+		 */
+		timespec getStartTime() const { return m_FileSummary.getStartTime(); }
+
+		/**
+		 * @return The timestamp of the latest packet in the file, zero if the file has no packets
+		 */
+		timespec getEndTime() const { return m_FileSummary.getEndTime(); }
+
+		/**
+		 * Get the protocol mix of the file
+		 * @param[in] protocols A protocol or a combination of protocols (for example pcpp#IPv4 or pcpp#TCP | pcpp#UDP)
+		 * @return The number of packets that contain any of the protocols
+		 */
+		uint64_t getProtocolPacketCount(ProtocolType protocols) const;
+
+	private:
+		enum FilterType { AddressFilter, PortFilter, FlowFilter, NumOfFilterTypes };
+
+		uint64_t m_ChunkSize;
+		uint64_t m_CaptureFileSize;
+		CaptureIndexSummary m_FileSummary;
+		std::vector<CaptureIndexSummary> m_Chunks;
+		// the number of packets of every combination of protocols found in the file
+		std::map<ProtocolType, uint64_t> m_ProtocolMix;
+
+		// the state of an index being built: the hashed items of the file and of its last chunk, kept until the Bloom filters can be
+		// sized by their number
+		bool m_IsBuilding;
+		std::vector<uint64_t> m_FileItems[NumOfFilterTypes];
+		std::vector<uint64_t> m_ChunkItems[NumOfFilterTypes];
+
+		void clear();
+		void finishChunk();
+		static void fillFilters(CaptureIndexSummary& summary, std::vector<uint64_t> items[NumOfFilterTypes]);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_CAPTURE_INDEX */
@@ -69,7 +69,10 @@ namespace pcpp
 		virtual ~IFilterableDevice() {}
 
 		/**
-		 * Set a filter for the device. When implemented by the device, only packets that match the filter will be received
+		 * Set a filter for the device. When implemented by the device, only packets that match the filter will be received.
+		 * The default implementation sets the BPF string of the filter (see GeneralFilter#parseToString()), which matches more
+		 * packets than the filter if it contains a large filter set (see IFilterWithSet). Devices that match such filters exactly
+		 * override this method
 		 * @param[in] filter The filter to be set in PcapPlusPlus' GeneralFilter format
 		 * @return True if filter set successfully, false otherwise
 		 */
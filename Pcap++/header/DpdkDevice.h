@@ -7,6 +7,9 @@
 #include "SystemUtils.h"
 #include "Device.h"
 #include "MBufRawPacket.h"
+#include "PacketSampler.h"
+#include "BpfJit.h"
+#include "NativeFilter.h"
 
 /**
  * @file
@@ -149,7 +152,8 @@ namespace pcpp
 	 * __Sending packets:__ DpdkDevice has various methods for sending packets. They enable sending raw packets, parsed packets, etc.
 	 * for all opened TX queues. Also, DPDK provides an option to buffer TX packets and send them only when reaching a certain threshold (you
 	 * can read more about it here: http://dpdk.org/doc/api/rte__ethdev_8h.html#a0e941a74ae1b1b886764bc282458d946). DpdkDevice supports that
-	 * option as well. See DpdkDevice#sendPackets()<BR>
+	 * option as well. See DpdkDevice#sendPackets(). For sending from worker cores without having to flush TX buffers manually see
+	 * DpdkTxContext<BR>
 	 *
 	 * __Get interface info__: DpdkDevice provides all kind of information on the interface/device such as MAC address, MTU, link status,
 	 * PCI address, PMD (poll-mode-driver) used for this port, etc. In addition it provides RX/TX statistics when receiving or sending
@@ -165,11 +169,12 @@ namespace pcpp
 	{
 		friend class DpdkDeviceList;
 		friend class MBufRawPacket;
+		friend class DpdkTxContext;
 	public:
 
 		/**
 		 * An enum describing all RSS (Receive Side Scaling) hash functions supported in DPDK. Notice not all
-		 * PMDs support all types of hash functions
+		 * PMDs support all types of hash functions. ToeplitzHash calculates the same hash in software for the IPv4/IPv6 hash functions
 		 */
 		enum DpdkRssHashFunction
 		{
@@ -261,6 +266,23 @@ namespace pcpp
 			 */
 			uint64_t rssHashFunction;
 
+			/**
+			 * By default all mbufs of the device are taken from a single mbuf pool that is allocated on the NUMA node (CPU socket) the
+			 * device is attached to. When this parameter is set, an additional mbuf pool (of the same size) is created on every other
+			 * NUMA node that has DPDK cores, and MBufRawPacket instances created by a core for this device (for example packets built
+			 * for sending) take their mbufs from the pool on the core's own NUMA node. Received packets always come from the pool on
+			 * the device's NUMA node. Notice this multiplies the huge-pages memory used by the device by the number of NUMA nodes
+			 */
+			bool mBufPoolPerNumaNode;
+
+			/**
+			 * The maximum length in bytes of received packets. A value of 0 (the default) means standard Ethernet frames, each received
+			 * into a single mbuf. A larger value enables jumbo frames and scatter RX, in which packets larger than an mbuf are received
+			 * as chained mbufs (see MBufRawPacket), and also enables multi-segment TX so chained mbufs can be sent. The PMD must support
+			 * these capabilities, otherwise opening the device fails. Notice the device MTU may need to be raised as well (see setMtu() )
+			 */
+			uint32_t maxRxPacketLength;
+
 			/**
 			 * A c'tor for this struct
 			 * @param[in] receiveDescriptorsNumber An optional parameter for defining the number of RX descriptors that will be allocated for each RX queue.
@@ -273,13 +295,19 @@ namespace pcpp
 			 * @param[in] rssKey A pointer to an array holding the RSS key to use for hashing specific header of received packets. If not
 			 * specified, there is a default key defined inside DpdkDevice
 			 * @param[in] rssKeyLength The length in bytes of the array pointed by rssKey. Default value is the length of default rssKey
+			 * @param[in] mBufPoolPerNumaNode Create an mbuf pool on every NUMA node that has DPDK cores rather than only on the device's
+			 * NUMA node. Default value is false
+			 * @param[in] maxRxPacketLength The maximum length of received packets. A value larger than 0 enables jumbo frames, scatter RX
+			 * and multi-segment TX. Default value is 0 which means standard Ethernet frames
 			 */
 			DpdkDeviceConfiguration(uint16_t receiveDescriptorsNumber = 128,
 					uint16_t transmitDescriptorsNumber = 512,
 					uint16_t flushTxBufferTimeout = 100,
 					uint64_t rssHashFunction = RSS_IPV4 | RSS_IPV6,
 					uint8_t* rssKey = DpdkDevice::m_RSSKey,
-					uint8_t rssKeyLength = 40)
+					uint8_t rssKeyLength = 40,
+					bool mBufPoolPerNumaNode = false,
+					uint32_t maxRxPacketLength = 0)
 			{
 				this->receiveDescriptorsNumber = receiveDescriptorsNumber;
 				this->transmitDescriptorsNumber = transmitDescriptorsNumber;
@@ -287,6 +315,8 @@ namespace pcpp
 				this->rssKey = rssKey;
 				this->rssKeyLength = rssKeyLength;
 				this->rssHashFunction = rssHashFunction;
+				this->mBufPoolPerNumaNode = mBufPoolPerNumaNode;
+				this->maxRxPacketLength = maxRxPacketLength;
 			}
 		};
 
@@ -353,6 +383,22 @@ namespace pcpp
 			uint64_t rxErroneousPackets;
 			/** Total number of RX mbuf allocation failuers */
 			uint64_t rxMbufAlocFailed;
+			/** Number of TX packets dropped per TX queue because the NIC didn't accept them when flushing a TX buffer or a DpdkTxContext */
+			uint64_t txDroppedPackets[DPDK_MAX_TX_QUEUES];
+			/** Number of TX packets dropped when flushing TX buffers or DpdkTxContext objects, aggregated for all TX queues */
+			uint64_t aggregatedTxDroppedPackets;
+		};
+
+		/**
+		 * @struct RxQueueFilterStats
+		 * A container for the software filter counters of a single RX queue (see setFilter())
+		 */
+		struct RxQueueFilterStats
+		{
+			/** Number of packets that matched the filter and were passed to the application */
+			uint64_t packetsMatched;
+			/** Number of packets that didn't match the filter and were freed */
+			uint64_t packetsDropped;
 		};
 
 		virtual ~DpdkDevice();
@@ -405,6 +451,21 @@ namespace pcpp
 		 */
 		bool isVirtual() const;
 
+		/**
+		 * @return The NUMA node (CPU socket) the device is attached to, or -1 if it's unknown (for example in virtual devices or on
+		 * single socket machines where the kernel doesn't report it)
+		 */
+		int getNumaNode() const { return m_NumaNode; }
+
+		/**
+		 * Check whether a core is on the NUMA node the device is attached to. Polling a device from a core on another NUMA node
+		 * means every packet crosses the interconnect between the CPU sockets, which considerably reduces throughput
+		 * @param[in] coreId The core ID to check
+		 * @return False if the core and the device are known to be on different NUMA nodes, true otherwise (including when the
+		 * NUMA node of the device or the core is unknown)
+		 */
+		bool isCoreOnDeviceNumaNode(uint32_t coreId) const;
+
 		/**
 		 * Get the link status (link up/down, link speed and link duplex)
 		 * @param[out] linkStatus A reference to object the result shall be written to
@@ -494,9 +555,9 @@ namespace pcpp
 
 		/**
 		 * Send an array of parsed packets to the network. Please notice the following:<BR>
-		 * - If some or all of the packets contain raw packets which aren't of type MBufRawPacket, a new temp MBufRawPacket instances
-		 * will be created and packet data will be copied to them. This is necessary to allocate mbufs which will store the data to be sent.
-		 * If performance is a critical factor please make sure you send parsed packets that contain only raw packets of type MBufRawPacket
+		 * - If some or all of the packets contain raw packets which aren't of type MBufRawPacket, new mbufs will be allocated and packet
+		 * data will be copied to them. If performance is a critical factor please make sure you send parsed packets that contain only raw
+		 * packets of type MBufRawPacket
 		 * - If the number of packets to send is higher than 64 this method will run multiple iterations of sending packets to DPDK, each
 		 * iteration of 64 packets
 		 * - If the number of packets to send is higher than a threshold of 80% of total TX descriptors (which is typically around 400 packets),
@@ -534,10 +595,9 @@ namespace pcpp
 
 		/**
 		 * Send a vector of RawPacket pointers to the network. Please notice the following:<BR>
-		 * - If some or all of the raw packets aren't of type MBufRawPacket, a new temp MBufRawPacket instances will be created
-		 * and packet data will be copied to them. This is necessary to allocate mbufs which will store the data to be sent. If
-		 * performance is a critical factor please make sure you send only raw packets of type MBufRawPacket (or use the sendPackets overload
-		 * that sends MBufRawPacketVector)
+		 * - If some or all of the raw packets aren't of type MBufRawPacket, new mbufs will be allocated and packet data will be copied
+		 * to them. If performance is a critical factor please make sure you send only raw packets of type MBufRawPacket (or use the
+		 * sendPackets overload that sends MBufRawPacketVector)
 		 * - If the number of packets to send is higher than 64 this method will run multiple iterations of sending packets to DPDK, each
 		 * iteration of 64 packets
 		 * - If the number of packets to send is higher than a threshold of 80% of total TX descriptors (which is typically around 400 packets),
@@ -555,10 +615,10 @@ namespace pcpp
 		uint16_t sendPackets(RawPacketVector& rawPacketsVec, uint16_t txQueueId = 0, bool useTxBuffer = false);
 
 		/**
-		 * Send a raw packet to the network. Please notice that if the raw packet isn't of type MBufRawPacket, a new temp MBufRawPacket
-		 * will be created and the data will be copied to it. This is necessary to allocate an mbuf which will store the data to be sent.
-		 * If performance is a critical factor please make sure you send a raw packet of type MBufRawPacket. Please also notice that the
-		 * mbuf used or allocated in this method isn't freed by this method, it will be transparently freed by DPDK
+		 * Send a raw packet to the network. Please notice that if the raw packet isn't of type MBufRawPacket, a new mbuf will be allocated
+		 * and the data will be copied to it. If performance is a critical factor please make sure you send a raw packet of type
+		 * MBufRawPacket. Please also notice that the mbuf used or allocated in this method isn't freed by this method, it will be
+		 * transparently freed by DPDK
 		 * @param[in] rawPacket The raw packet to send
 		 * @param[in] txQueueId An optional parameter which indicates to which TX queue the packet will be sent to. The default is
 		 * TX queue 0
@@ -588,9 +648,8 @@ namespace pcpp
 		 * Send a parsed packet to the network. Please notice that the mbuf used or allocated in this method isn't freed by this method,
 		 * it will be transparently freed by DPDK
 		 * @param[in] packet The parsed packet to send. Please notice that if the packet contains a raw packet which isn't of type
-		 * MBufRawPacket, a new temp MBufRawPacket will be created and the data will be copied to it. This is necessary to
-		 * allocate an mbuf which will store the data to be sent. If performance is a critical factor please make sure you send a
-		 * parsed packet that contains a raw packet of type MBufRawPacket
+		 * MBufRawPacket, a new mbuf will be allocated and the packet data will be copied to it. If performance is a critical factor
+		 * please make sure you send a parsed packet that contains a raw packet of type MBufRawPacket
 		 * @param[in] txQueueId An optional parameter which indicates to which TX queue the packet will be sent on. The default is
 		 * TX queue 0
 		 * @param[in] useTxBuffer A flag which indicates whether to use TX buffer mechanism or not. To read more about DPDK's
@@ -602,17 +661,67 @@ namespace pcpp
 		bool sendPacket(Packet& packet, uint16_t txQueueId = 0, bool useTxBuffer = false);
 
 		/**
-		 * Overridden method from IPcapDevice. __BPF filters are currently not implemented for DpdkDevice__
-		 * @return Always false with a "Filters aren't supported in DPDK device" error message
+		 * Set a software filter for the device. The filter is converted to a BPF string (see GeneralFilter#parseToString()) and
+		 * handled by setFilter(std::string). If the filter contains a filter set (IPSetFilter, SubnetSetFilter or PortSetFilter) it's
+		 * compiled to a NativeFilter instead, which shares the sets with the filter, so values added to or removed from the sets take
+		 * effect immediately. Its BPF string is still returned by getFilter()
+		 * @param[in] filter The filter to set
+		 * @return True if filter was compiled and set successfully, false otherwise
 		 */
 		bool setFilter(GeneralFilter& filter);
 
 		/**
-		 * Overridden method from IPcapDevice. __BPF filters are currently not implemented for DpdkDevice__
-		 * @return Always false with a "Filters aren't supported in DPDK device" error message
+		 * Set a software BPF filter for the device. The filter is compiled once by libpcap and then run by BpfJit (as native code where
+		 * it's supported) on every received mbuf, in the capture threads and in all receivePackets() overloads. Mbufs that don't match the filter are
+		 * freed before any MBufRawPacket is built or any callback is invoked. Match and drop counters are kept per RX queue, see
+		 * getRxQueueFilterStats(). The filter is matched against the first segment of each mbuf only. This method should be called
+		 * before capturing starts, the filter stays set until clearFilter() is called
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
+		 * @return True if filter was compiled and set successfully, false otherwise
 		 */
 		bool setFilter(std::string filterAsString);
 
+		/**
+		 * Clear the software filter currently set on the device (if any) and reset the filter counters
+		 * @return Always true
+		 */
+		bool clearFilter();
+
+		/**
+		 * @return The BPF string of the filter currently set on the device, or an empty string if no filter is set
+		 */
+		std::string getFilter() const { return m_FilterAsString; }
+
+		/**
+		 * Get the software filter counters of a certain RX queue
+		 * @param[in] rxQueueId The RX queue ID
+		 * @param[out] stats The counters of this RX queue
+		 * @return True if counters were retrieved successfully, false if the RX queue ID is out of range
+		 */
+		bool getRxQueueFilterStats(uint16_t rxQueueId, RxQueueFilterStats& stats) const;
+
+		/**
+		 * Set a packet sampler for the device. The sampler is applied on the mbufs right after they are received from the NIC, mbufs
+		 * that aren't selected are freed before any MBufRawPacket is built or any callback is invoked. Each RX queue gets its own
+		 * copy of the sampler so queues can be polled from different cores without locking. This method should be called before
+		 * capturing starts
+		 * @param[in] sampler The sampler to set. Setting a default constructed PacketSampler disables sampling
+		 */
+		void setPacketSampler(const PacketSampler& sampler);
+
+		/**
+		 * @return The packet sampler set on the device. Packet callbacks can use it to retrieve the sample rate. The packets seen and
+		 * sampled counters are kept per RX queue, see getRxQueuePacketSampler()
+		 */
+		const PacketSampler& getPacketSampler() const { return m_PacketSampler; }
+
+		/**
+		 * Get the copy of the packet sampler used by a certain RX queue, which holds the packets seen and sampled counters of this queue
+		 * @param[in] rxQueueId The RX queue ID
+		 * @return The sampler of this RX queue, or the device's sampler if the queue ID is out of range
+		 */
+		const PacketSampler& getRxQueuePacketSampler(uint16_t rxQueueId) const;
+
 		/**
 		 * Open the DPDK device. Notice opening the device only makes it ready to use, it doesn't start packet capturing. This method initializes RX and TX queues,
 		 * configures the DPDK port and starts it. Call close() to close the device. The device is opened in promiscuous mode
@@ -657,7 +766,7 @@ namespace pcpp
 		 * available to DPDK, there are not enough opened RX queues to match all cores in the core-mask, or if thread invocation failed. In
 		 * all of these cases an appropriate error message will be printed
 		 */
-		bool startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask);
+		bool startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, const CoreMask& coreMask);
 
 		/**
 		 * If device is in capture mode started by invoking startCaptureSingleThread() or startCaptureMultiThreads(), this method
@@ -666,12 +775,12 @@ namespace pcpp
 		void stopCapture();
 
 		/**
-		 * @return The number of free mbufs in device's mbufs pool
+		 * @return The number of free mbufs in device's mbufs pool (or pools, see DpdkDeviceConfiguration#mBufPoolPerNumaNode)
 		 */
 		int getAmountOfFreeMbufs() const;
 
 		/**
-		 * @return The number of mbufs currently in use in device's mbufs pool
+		 * @return The number of mbufs currently in use in device's mbufs pool (or pools, see DpdkDeviceConfiguration#mBufPoolPerNumaNode)
 		 */
 		int getAmountOfMbufsInUse() const;
 
@@ -750,7 +859,9 @@ namespace pcpp
 		};
 
 		DpdkDevice(int port, uint32_t mBufPoolSize);
-		bool initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize);
+		bool initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize, int numaNode);
+		bool initNumaNodeMemPools();
+		struct rte_mempool* getMBufMempoolForCurrentCore() const;
 
 		bool configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues);
 		bool initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesToInit);
@@ -759,7 +870,7 @@ namespace pcpp
 		static int dpdkCaptureThreadMain(void* ptr);
 
 		void clearCoreConfiguration();
-		bool initCoreConfigurationByCoreMask(CoreMask coreMask);
+		bool initCoreConfigurationByCoreMask(const CoreMask& coreMask);
 		int getCoresInUseCount() const;
 
 		void setDeviceInfo();
@@ -767,6 +878,14 @@ namespace pcpp
 		typedef rte_mbuf* (*PacketIterator)(void* packetStorage, int index);
 		uint16_t sendPacketsInner(uint16_t txQueueId, void* packetStorage, PacketIterator iter, int arrLength, bool useTxBuffer);
 
+		// allocate an mbuf (chained if needed) from the mempool of the current core and copy the data to it
+		struct rte_mbuf* createMBufFromData(const uint8_t* data, int dataLen) const;
+		// get the mbuf of an MBufRawPacket, or a new mbuf with a copy of the data for other raw packets
+		struct rte_mbuf* getMBufForSending(const RawPacket* rawPacket) const;
+		static void releaseMBufAfterSending(const RawPacket* rawPacket, struct rte_mbuf* mBuf, bool sent);
+
+		uint16_t filterPackets(struct rte_mbuf** mBufArray, uint16_t numOfMBufs, uint16_t rxQueueId) const;
+
 		uint64_t convertRssHfToDpdkRssHf(uint64_t rssHF) const;
 		uint64_t convertDpdkRssHfToRssHf(uint64_t dpdkRssHF) const;
 
@@ -780,10 +899,14 @@ namespace pcpp
 		int m_Id;
 		MacAddress m_MacAddress;
 		uint16_t m_DeviceMtu;
+		int m_NumaNode;
+		uint32_t m_MBufPoolSize;
 		struct rte_mempool* m_MBufMempool;
+		std::vector<struct rte_mempool*> m_NumaNodeMBufMempools;
 		struct rte_eth_dev_tx_buffer** m_TxBuffers;
 		uint64_t m_TxBufferDrainTsc;
 		uint64_t* m_TxBufferLastDrainTsc;
+		uint64_t* m_TxDroppedPackets;
 		DpdkCoreConfiguration m_CoreConfiguration[MAX_NUM_OF_CORES];
 		uint16_t m_TotalAvailableRxQueues;
 		uint16_t m_TotalAvailableTxQueues;
@@ -799,6 +922,15 @@ namespace pcpp
 		static uint8_t m_RSSKey[40];
 
 		mutable DpdkDeviceStats m_PrevStats;
+
+		PacketSampler m_PacketSampler;
+		mutable std::vector<PacketSampler> m_RxQueueSamplers;
+
+		struct bpf_program* m_BpfProgram;
+		BpfJit m_BpfJit;
+		NativeFilter m_PostFilter;
+		std::string m_FilterAsString;
+		mutable std::vector<RxQueueFilterStats> m_RxQueueFilterStats;
 	};
 
 } // namespace pcpp
@@ -57,6 +57,22 @@ namespace pcpp
 		virtual uint32_t getCoreId() const = 0;
 	};
 
+	/**
+	 * @struct RxQueueCoreAssignment
+	 * An assignment of a DpdkDevice RX queue to the core that should poll it, as calculated by DpdkDeviceList#assignRxQueuesToCores()
+	 */
+	struct RxQueueCoreAssignment
+	{
+		/** The device the RX queue belongs to */
+		DpdkDevice* device;
+		/** The RX queue ID */
+		uint16_t rxQueueId;
+		/** The core that should poll the RX queue */
+		uint32_t coreId;
+		/** True if the core is on a different NUMA node than the device, which happens only when none of the cores is on the device NUMA node */
+		bool isCrossNuma;
+	};
+
 	class KniDeviceList;
 
 	/**
@@ -83,7 +99,7 @@ namespace pcpp
 
 		bool isInitialized() const { return (m_IsInitialized && m_IsDpdkInitialized); }
 		bool initDpdkDevices(uint32_t mBufPoolSizePerDevice);
-		static bool verifyHugePagesAndDpdkDriver();
+		static bool verifyHugePagesAndDpdkDriver(bool verifyHugePages, bool verifyDpdkDriver);
 
 		static int dpdkWorkerThreadStart(void* ptr);
 	public:
@@ -113,18 +129,26 @@ namespace pcpp
 		 * 
 		 * @param[in] coreMask The cores to initialize DPDK with. After initialization, DPDK will only be able to use these cores
 		 * for its work. The core mask should have a bit set for every core to use. For example: if the user want to use cores 1,2
-		 * the core mask should be 6 (binary: 110)
+		 * the core mask should be 6 (binary: 110). Cores above 63 can be added using CoreMask#addCore(), and all the cores of a NUMA
+		 * node can be retrieved using getCoreMaskForNumaNode()
 		 * @param[in] mBufPoolSizePerDevice The mbuf pool size each DpdkDevice will have. This has to be a number which is a power of 2
 		 * minus 1, for example: 1023 (= 2^10-1) or 4,294,967,295 (= 2^32-1), etc. This is a DPDK limitation, not PcapPlusPlus.
 		 * The size of the mbuf pool size dictates how many packets can be handled by the application at the same time. For example: if
 		 * pool size is 1023 it means that no more than 1023 packets can be handled or stored in application memory at every point in time
 		 * @param[in] masterCore The core DPDK will use as master to control all worker thread. The default, unless set otherwise, is 0
+		 * @param[in] additionalEalArgs Additional arguments to pass to the DPDK EAL, one argument per vector item. This is mostly
+		 * useful for creating virtual devices which are then exposed as normal DpdkDevice instances (after the physical ports), for
+		 * example: "--vdev=net_pcap0,rx_pcap=input.pcap,tx_pcap=output.pcap" for replaying a pcap file, "--vdev=net_ring0" or
+		 * "--vdev=net_null0". When "--no-huge" is given huge-pages aren't verified, and when a "--vdev" or "--no-pci" argument is
+		 * given the DPDK kernel driver isn't verified, so DPDK can be used on machines without a NIC bound to DPDK (e.g for testing
+		 * and benchmarking). The default is no additional arguments
 		 * @return True if initialization succeeded or false if huge-pages or DPDK kernel driver are not loaded, if mBufPoolSizePerDevice
 		 * isn't power of 2 minus 1, if DPDK infra initialization failed or if DpdkDevice initialization failed. Anyway, if this method
 		 * returned false it's impossible to use DPDK with PcapPlusPlus. You can get some more details about mbufs and pools in 
 		 * DpdkDevice.h file description or in DPDK web site
 		 */
-		static bool initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore = 0);
+		static bool initDpdk(const CoreMask& coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore = 0,
+				const std::vector<std::string>& additionalEalArgs = std::vector<std::string>());
 
 		/**
 		 * Get a DpdkDevice by port ID
@@ -187,7 +211,24 @@ namespace pcpp
 		 * returned false), number of cores differs from number of workers, core mask includes DPDK master core or if one of the 
 		 * worker threads couldn't be run
 		 */
-		bool startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkWorkerThread*>& workerThreadsVec);
+		bool startDpdkWorkerThreads(const CoreMask& coreMask, std::vector<DpdkWorkerThread*>& workerThreadsVec);
+
+		/**
+		 * Spread the opened RX queues of several devices between worker cores while keeping every RX queue on a core that is on the
+		 * NUMA node (CPU socket) of its device. Each RX queue is assigned to the least loaded core on the device NUMA node, so the
+		 * queues are evenly spread between these cores. Only if none of the cores is on the device NUMA node (or the NUMA node of the
+		 * device is unknown), the queue is assigned to the least loaded core of all cores, and in case of a different NUMA node it's
+		 * marked as cross-NUMA (see RxQueueCoreAssignment#isCrossNuma) and an error naming the queue, the core and its NUMA node is written
+		 * to log. A typical use is building the configuration of the worker
+		 * threads before calling startDpdkWorkerThreads()
+		 * @param[in] devices The devices whose RX queues should be assigned. All devices should be opened
+		 * @param[in] coreMask The cores to assign the RX queues to. This list shouldn't include DPDK master core
+		 * @param[out] assignment A vector that will contain an assignment for every opened RX queue of every device, in the order of
+		 * the devices and the RX queues
+		 * @return True if the RX queues were assigned, false if the core mask is empty or includes DPDK master core or if one of the
+		 * devices isn't opened
+		 */
+		bool assignRxQueuesToCores(const std::vector<DpdkDevice*>& devices, const CoreMask& coreMask, std::vector<RxQueueCoreAssignment>& assignment) const;
 
 		/**
 		 * Assuming worker threads are running, this method orders them to stop by calling DpdkWorkerThread#stop(). Then it waits until
@@ -0,0 +1,306 @@
+#ifndef PCAPPP_DPDK_PIPELINE
+#define PCAPPP_DPDK_PIPELINE
+
+#include "DpdkDeviceList.h"
+#include "MBufRawPacket.h"
+#include <string>
+#include <vector>
+
+/**
+ * @file
+ * This file provides a multi-stage packet processing pipeline built on top of DpdkWorkerThread. Packets are received on RX cores,
+ * handed over through DPDK rings (rte_ring) to one or more levels of worker stages, and finally handed over to TX cores that send
+ * them. Each stage instance runs on its own core, and the stage-to-core mapping is taken from DpdkPipelineConfig. For details about
+ * PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+struct rte_ring;
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class DpdkPipelineWorker;
+
+	/**
+	 * @class DpdkPipelineStage
+	 * An interface for the user-defined processing done in a worker stage of DpdkPipeline. The pipeline creates one copy of the stage
+	 * (using clone() ) for every core the stage runs on, so an implementation may keep per-core state without any locking
+	 */
+	class DpdkPipelineStage
+	{
+	public:
+		/**
+		 * A virtual d'tor. Can be overridden by child class if needed
+		 */
+		virtual ~DpdkPipelineStage() {}
+
+		/**
+		 * Process a burst of packets. This method is called on the stage core for every non-empty burst taken from the stage input ring.
+		 * The implementation may modify the packets and reorder the array: the packets at the beginning of the array are forwarded
+		 * to the next stage and all the others are dropped (their mbufs are freed)
+		 * @param[in,out] packets An array of the packets in the burst
+		 * @param[in] numOfPackets The number of packets in the array
+		 * @param[in] coreId The core this copy of the stage is running on
+		 * @return The number of packets (from the beginning of the array) to forward to the next stage
+		 */
+		virtual uint16_t processPackets(MBufRawPacket** packets, uint16_t numOfPackets, uint32_t coreId) = 0;
+
+		/**
+		 * Create a copy of this stage. It is called by DpdkPipeline#start() once for every core the stage runs on
+		 * @return A newly allocated copy of this stage. The pipeline frees it when it's stopped
+		 */
+		virtual DpdkPipelineStage* clone() const = 0;
+	};
+
+
+	/**
+	 * @struct DpdkPipelineConfig
+	 * The configuration of DpdkPipeline: the RX queues to read from, the worker stages, the TX queues to send to and the core each of
+	 * them runs on. The core mapping can be set directly in the structs or parsed from a textual mapping using applyCoreMapping()
+	 */
+	struct DpdkPipelineConfig
+	{
+		/**
+		 * @struct RxQueueConfig
+		 * An RX queue the pipeline reads from and the core that polls it. A core may poll several RX queues
+		 */
+		struct RxQueueConfig
+		{
+			/** The device to read from. It should be opened before the pipeline is started */
+			DpdkDevice* device;
+			/** The RX queue to read from */
+			uint16_t rxQueueId;
+			/** The core polling this RX queue */
+			uint32_t coreId;
+
+			/**
+			 * A c'tor for this struct
+			 */
+			RxQueueConfig(DpdkDevice* dev, uint16_t rxQueue, uint32_t core = 0) : device(dev), rxQueueId(rxQueue), coreId(core) {}
+		};
+
+		/**
+		 * @struct WorkerStageConfig
+		 * A worker stage and the cores it runs on. The stage is copied to every core
+		 */
+		struct WorkerStageConfig
+		{
+			/** A name for the stage, used in applyCoreMapping() and in the stage statistics */
+			std::string name;
+			/** The stage prototype. It's cloned for every core and isn't used directly by the pipeline */
+			DpdkPipelineStage* stage;
+			/** The cores this stage runs on */
+			std::vector<uint32_t> coreIds;
+
+			/**
+			 * A c'tor for this struct
+			 */
+			WorkerStageConfig(const std::string& stageName, DpdkPipelineStage* stagePrototype, const std::vector<uint32_t>& cores = std::vector<uint32_t>()) :
+				name(stageName), stage(stagePrototype), coreIds(cores) {}
+		};
+
+		/**
+		 * @struct TxQueueConfig
+		 * A TX queue the pipeline sends to and the core that sends to it. Each TX core sends to a single TX queue
+		 */
+		struct TxQueueConfig
+		{
+			/** The device to send to. It should be opened before the pipeline is started */
+			DpdkDevice* device;
+			/** The TX queue to send to */
+			uint16_t txQueueId;
+			/** The core sending to this TX queue */
+			uint32_t coreId;
+
+			/**
+			 * A c'tor for this struct
+			 */
+			TxQueueConfig(DpdkDevice* dev, uint16_t txQueue, uint32_t core = 0) : device(dev), txQueueId(txQueue), coreId(core) {}
+		};
+
+		/** The RX queues to read from. At least one RX queue is required */
+		std::vector<RxQueueConfig> rxQueues;
+
+		/**
+		 * The worker stages, in the order packets go through them. It may be empty, in which case packets go directly from the RX
+		 * cores to the TX cores
+		 */
+		std::vector<WorkerStageConfig> workerStages;
+
+		/**
+		 * The TX queues to send to. It may be empty, in which case the packets forwarded by the last worker stage are dropped (this is
+		 * useful for pipelines that only analyze traffic)
+		 */
+		std::vector<TxQueueConfig> txQueues;
+
+		/**
+		 * The size of the ring in front of each worker and TX core. It's rounded up to a power of 2 as required by DPDK. The default
+		 * is 1024
+		 */
+		uint32_t ringSize;
+
+		/**
+		 * The maximum number of packets handled in a single burst, between 1 and 64. The default is 32
+		 */
+		uint16_t burstSize;
+
+		/**
+		 * The number of MBufRawPacket objects the pipeline pre-allocates and recycles between the stages. This is the maximum number of
+		 * packets in flight in the pipeline, and should be smaller than the mbuf pool of the RX devices. The default is 4096
+		 */
+		uint32_t packetPoolSize;
+
+		/**
+		 * A c'tor for this struct with default values
+		 */
+		DpdkPipelineConfig() : ringSize(1024), burstSize(32), packetPoolSize(4096) {}
+
+		/**
+		 * Set the cores of the pipeline stages from a textual mapping. The mapping is a list of "stage=cores" items separated by ';', where
+		 * cores is a comma separated list of core IDs or core ranges, for example: "rx=1,2;classify=3-6;tx=7". The "rx" and "tx" stages
+		 * refer to the RX and TX queues, which are assigned to the listed cores in a round-robin manner. Any other stage name refers to the
+		 * worker stage with that name, whose cores are replaced by the listed cores. Stages that don't appear in the mapping are left as is
+		 * @param[in] mapping The textual mapping
+		 * @return True if the mapping was parsed and applied, false if it's malformed or refers to an unknown stage (in which case the
+		 * configuration isn't changed)
+		 */
+		bool applyCoreMapping(const std::string& mapping);
+	};
+
+
+	/**
+	 * @class DpdkPipeline
+	 * A multi-stage packet processing pipeline. The pipeline runs a DpdkWorkerThread on every core in its configuration:
+	 * - RX cores receive bursts of packets from their RX queues
+	 * - Worker cores run the user-defined DpdkPipelineStage on the packets. There may be several levels of worker stages, each running on
+	 *   one or more cores
+	 * - TX cores send the packets to their TX queue<BR>
+	 * Every worker and TX core has an input ring (rte_ring), and bursts of MBufRawPacket pointers are handed over from one level to the
+	 * next without copying the packets. When the next level has more than one core, the core is selected by a symmetric flow hash (see
+	 * PacketSampler#calculateFlowHash() ) so all packets of a flow, in both directions, are handled by the same core. Non-IP packets are
+	 * spread in a round-robin manner. When a ring is full the packets that don't fit are dropped rather than stalling the previous stage.
+	 * The MBufRawPacket objects are taken from a pool that is allocated when the pipeline starts, so no memory is allocated while packets
+	 * are processed<BR>
+	 * For each stage core the pipeline counts the packets, the CPU cycles spent on non-empty bursts and the occupancy of its input ring,
+	 * which can be retrieved at any time using getStageStats() to find the bottleneck stage.<BR>
+	 * The pipeline uses DpdkDeviceList#startDpdkWorkerThreads() so it can't run together with other worker threads, and none of its cores
+	 * may be the DPDK master core
+	 */
+	class DpdkPipeline
+	{
+	public:
+
+		/**
+		 * The stage types of the pipeline
+		 */
+		enum StageType
+		{
+			/** An RX core */
+			RxStage,
+			/** A worker stage core */
+			WorkerStage,
+			/** A TX core */
+			TxStage
+		};
+
+		/**
+		 * @struct StageStats
+		 * The statistics of a single core of the pipeline
+		 */
+		struct StageStats
+		{
+			/** The stage type */
+			StageType type;
+			/** The stage name: "rx", "tx" or the worker stage name */
+			std::string name;
+			/** The core this stage instance runs on */
+			uint32_t coreId;
+			/** Number of packets received from the RX queues (RX stage) or taken from the input ring */
+			uint64_t packetsIn;
+			/** Number of packets forwarded to the next stage (or sent, in TX stage) */
+			uint64_t packetsOut;
+			/**
+			 * Number of packets dropped: by the worker stage, because the next stage ring was full, or because the device couldn't
+			 * send them (TX stage)
+			 */
+			uint64_t packetsDropped;
+			/** Number of CPU cycles (TSC) spent on handling non-empty bursts */
+			uint64_t busyCycles;
+			/** Number of CPU cycles (TSC) since the stage started running, until now or until the pipeline stopped */
+			uint64_t totalCycles;
+			/** The capacity of the input ring. 0 in RX stage which has no input ring */
+			uint32_t ringCapacity;
+			/** The number of packets in the input ring the last time the stage polled it */
+			uint32_t ringCount;
+			/** The highest number of packets seen in the input ring */
+			uint32_t ringHighWatermark;
+		};
+
+		/**
+		 * A c'tor for this class. The configuration is copied and used when the pipeline is started
+		 * @param[in] config The pipeline configuration
+		 */
+		DpdkPipeline(const DpdkPipelineConfig& config);
+
+		/**
+		 * A d'tor for this class. Stops the pipeline if it's running
+		 */
+		~DpdkPipeline();
+
+		/**
+		 * @return The pipeline configuration
+		 */
+		const DpdkPipelineConfig& getConfig() const { return m_Config; }
+
+		/**
+		 * Start the pipeline: verify the configuration, create the rings and the packet pool and start a worker thread on every core
+		 * in the configuration. The RX and TX devices should be opened with the RX and TX queues in the configuration
+		 * @return True if the pipeline started, false if it's already running, if the configuration is invalid (no RX queues, a core
+		 * is used by more than one stage, a device or a queue isn't opened, etc.), if a ring or the packet pool couldn't be created or if
+		 * the worker threads couldn't be started. The reason is printed to log
+		 */
+		bool start();
+
+		/**
+		 * Stop all the pipeline cores, wait until they stop and free the packets left in the rings. The statistics are kept until the
+		 * pipeline is started again
+		 */
+		void stop();
+
+		/**
+		 * @return True if the pipeline is running, false otherwise
+		 */
+		bool isRunning() const { return m_IsRunning; }
+
+		/**
+		 * Get the statistics of all the pipeline cores: first the RX cores, then the cores of each worker stage (in the configuration
+		 * order) and finally the TX cores. The statistics are updated by the running cores without locking so they may be slightly out
+		 * of date
+		 * @param[out] stats A vector that will contain the statistics of all cores
+		 */
+		void getStageStats(std::vector<StageStats>& stats) const;
+
+	private:
+		DpdkPipelineConfig m_Config;
+		std::vector<DpdkPipelineWorker*> m_Workers;
+		std::vector<struct rte_ring*> m_Rings;
+		struct rte_ring* m_PacketPool;
+		std::vector<MBufRawPacket*> m_Packets;
+		bool m_IsRunning;
+
+		bool verifyConfig() const;
+		bool createRing(uint32_t size, bool singleProducer, struct rte_ring*& ring);
+		void clearResources();
+
+		// the pipeline can't be copied
+		DpdkPipeline(const DpdkPipeline& other);
+		DpdkPipeline& operator=(const DpdkPipeline& other);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_PIPELINE */
@@ -0,0 +1,173 @@
+#ifndef PCAPPP_DPDK_TX_CONTEXT
+#define PCAPPP_DPDK_TX_CONTEXT
+
+#include "DpdkDevice.h"
+#include "Packet.h"
+
+/**
+ * @file
+ * This file provides DpdkTxContext, a per-core helper that accumulates packets sent to a DPDK TX queue into bursts and flushes them
+ * automatically. For details about PcapPlusPlus support for DPDK see DpdkDevice.h file description
+ */
+
+struct rte_mbuf;
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class DpdkTxContext
+	 * A TX context accumulates packets sent to a single TX queue of a DpdkDevice and hands them over to the NIC in bursts, so a core
+	 * that forwards packets one at a time (or in small bursts) still pays the cost of a TX burst only once per burst. The pending burst
+	 * is flushed automatically when:
+	 * - It reaches the burst size given in the c'tor
+	 * - A packet is sent and the oldest pending packet has waited longer than the flush timeout
+	 * - flushIfExpired() is called and the oldest pending packet has waited longer than the flush timeout. DPDK has no timers, so a
+	 *   core that may stop receiving packets should call flushIfExpired() in its polling loop, otherwise the last packets are kept until
+	 *   the next packet is sent
+	 * - flush() is called or the context is destroyed
+	 *
+	 * Packets are handed over without copying when they are backed by an mbuf (MBufRawPacket). Other packets are copied directly
+	 * into a newly allocated mbuf. Either way, once a packet is sent through the context its mbuf belongs to DPDK and the packet
+	 * object no longer frees it, so an MBufRawPacket may be reused (for example by DpdkDevice#receivePackets() ) right after sending.
+	 * Packets the NIC doesn't accept when a burst is flushed are dropped: their mbufs are freed and they're counted in
+	 * getPacketsDropped() and in DpdkDeviceStats#txDroppedPackets of the TX queue.<BR>
+	 * A context isn't thread-safe and should be used by a single core. Since DPDK TX queues aren't thread-safe either, every core
+	 * should use its own TX queue, for example by creating one context per core in DpdkWorkerThread#run()
+	 */
+	class DpdkTxContext
+	{
+	public:
+
+		/**
+		 * The maximum burst size of a TX context
+		 */
+		static const uint16_t MaxBurstSize = 512;
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] device The device to send packets to. It should be opened before packets are sent
+		 * @param[in] txQueueId The TX queue to send packets to
+		 * @param[in] burstSize The number of packets accumulated before a burst is flushed. Values larger than MaxBurstSize are
+		 * reduced to MaxBurstSize and 0 is treated as 1. The default is 32
+		 * @param[in] flushTimeoutUsec The maximum time in microseconds a packet waits for its burst to fill up. A value of 0 means
+		 * pending packets are flushed only when the burst is full or when flush() is called. The default is 100
+		 */
+		DpdkTxContext(DpdkDevice* device, uint16_t txQueueId, uint16_t burstSize = 32, uint32_t flushTimeoutUsec = 100);
+
+		/**
+		 * A d'tor for this class. Flushes the pending packets
+		 */
+		~DpdkTxContext();
+
+		/**
+		 * @return True if the context was created with a valid device and TX queue, false otherwise. An invalid context drops every
+		 * packet sent through it
+		 */
+		bool isValid() const { return m_Device != NULL; }
+
+		/**
+		 * @return The device this context sends packets to
+		 */
+		DpdkDevice* getDevice() const { return m_Device; }
+
+		/**
+		 * @return The TX queue this context sends packets to
+		 */
+		uint16_t getTxQueueId() const { return m_TxQueueId; }
+
+		/**
+		 * @return The number of packets accumulated before a burst is flushed
+		 */
+		uint16_t getBurstSize() const { return m_BurstSize; }
+
+		/**
+		 * @return The number of packets waiting in the pending burst
+		 */
+		uint16_t getNumOfPendingPackets() const { return m_NumOfPendingPackets; }
+
+		/**
+		 * Add a packet to the pending burst. If the packet is backed by an mbuf (MBufRawPacket) the mbuf is handed over, otherwise
+		 * the packet data is copied to a new mbuf
+		 * @param[in] rawPacket The packet to send
+		 * @return True if the packet was added to the pending burst (a packet added to the burst may still be dropped when the burst
+		 * is flushed), false if it couldn't be added (for example when an mbuf couldn't be allocated)
+		 */
+		bool sendPacket(RawPacket& rawPacket);
+
+		/**
+		 * Add a parsed packet to the pending burst. See sendPacket(RawPacket&)
+		 * @param[in] packet The packet to send
+		 * @return True if the packet was added to the pending burst, false otherwise
+		 */
+		bool sendPacket(Packet& packet) { return sendPacket(*packet.getRawPacket()); }
+
+		/**
+		 * Add an array of packets to the pending burst, flushing it as many times as needed. See sendPacket(RawPacket&)
+		 * @param[in] rawPacketsArr The array of packets to send
+		 * @param[in] arrLength The array length
+		 * @return The number of packets added to the pending burst
+		 */
+		uint16_t sendPackets(MBufRawPacket** rawPacketsArr, uint16_t arrLength);
+
+		/**
+		 * Add an array of parsed packets to the pending burst, flushing it as many times as needed. See sendPacket(RawPacket&)
+		 * @param[in] packetsArr The array of packets to send
+		 * @param[in] arrLength The array length
+		 * @return The number of packets added to the pending burst
+		 */
+		uint16_t sendPackets(Packet** packetsArr, uint16_t arrLength);
+
+		/**
+		 * Hand the pending burst over to the NIC. Packets the NIC doesn't accept are dropped
+		 * @return The number of packets sent
+		 */
+		uint16_t flush();
+
+		/**
+		 * Flush the pending burst if its oldest packet has waited longer than the flush timeout. This method is cheap when there are
+		 * no pending packets and is meant to be called in every iteration of a polling loop
+		 * @return The number of packets sent
+		 */
+		uint16_t flushIfExpired();
+
+		/**
+		 * @return The number of packets this context sent since it was created or since clearStatistics() was called
+		 */
+		uint64_t getPacketsSent() const { return m_PacketsSent; }
+
+		/**
+		 * @return The number of packets this context dropped since it was created or since clearStatistics() was called
+		 */
+		uint64_t getPacketsDropped() const { return m_PacketsDropped; }
+
+		/**
+		 * Reset the sent and dropped packet counters of this context
+		 */
+		void clearStatistics() { m_PacketsSent = 0; m_PacketsDropped = 0; }
+
+	private:
+		DpdkDevice* m_Device;
+		uint16_t m_TxQueueId;
+		uint16_t m_BurstSize;
+		uint16_t m_NumOfPendingPackets;
+		struct rte_mbuf** m_PendingMBufs;
+		uint64_t m_FlushTimeoutTsc;
+		uint64_t m_FlushDeadlineTsc;
+		uint64_t m_PacketsSent;
+		uint64_t m_PacketsDropped;
+
+		// a context owns the mbufs of its pending burst so it can't be copied
+		DpdkTxContext(const DpdkTxContext& other);
+		DpdkTxContext& operator=(const DpdkTxContext& other);
+
+		void dropPendingPackets(uint16_t fromIndex);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_DPDK_TX_CONTEXT */
@@ -0,0 +1,317 @@
+#ifndef PCAPPP_FILTER_SET
+#define PCAPPP_FILTER_SET
+
+#include "IpAddress.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+/**
+ * @file
+ * This file provides the lookup tables behind IPSetFilter, PortSetFilter and SubnetSetFilter (see PcapFilter.h): IPPrefixSet, a hash
+ * table of IPv4/IPv6 prefixes with longest-prefix-match style lookups, and PortSet, a bitmap of TCP/UDP ports. Both tables are
+ * thread-safe, so they can be updated while packets are matched against them from other threads, and lookups take no lock
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class FilterSet
+	 * The base class of IPPrefixSet and PortSet. A set is shared between the filter that owns it and the NativeFilter programs compiled
+	 * from this filter, so it's reference counted: it's created with a reference count of 1 and deleted when release() drops the count
+	 * to 0.<BR>
+	 * The content of a set is an immutable snapshot published through a pointer, RCU style: an update builds a new snapshot and replaces
+	 * the pointer, so threads that match packets against the set take no lock and see either the old content or the new one. Updates
+	 * are serialized by a mutex, and each one waits until no lookup uses the old snapshot before freeing it. Lookups only announce
+	 * themselves in one of two reader counters, which lets the update wait for the lookups that started before it without being
+	 * starved by the ones that start after it
+	 */
+	class FilterSet
+	{
+	public:
+
+		/**
+		 * Add a reference to this set
+		 */
+		void addRef();
+
+		/**
+		 * Remove a reference from this set. The set is deleted when the last reference is removed
+		 */
+		void release();
+
+		/**
+		 * @return A number that changes whenever the content of the set may have changed, so a value derived from the set (such as the
+		 * BPF string of a set filter) can be cached until it changes
+		 */
+		uint32_t getVersion() const;
+
+	protected:
+		// serializes the updates, lookups don't take it
+		pthread_mutex_t m_UpdateMutex;
+		// incremented by every update that changes the content, under the update mutex
+		volatile uint32_t m_Version;
+
+		/**
+		 * Announces a lookup for as long as it exists, so the snapshot the lookup reads isn't freed under it. The snapshot pointer must be
+		 * read after it's constructed
+		 */
+		class ScopedReader
+		{
+		public:
+			ScopedReader(const FilterSet* set);
+			~ScopedReader();
+		private:
+			const FilterSet* m_Set;
+			int m_Slot;
+		};
+
+		FilterSet();
+		virtual ~FilterSet();
+
+		/**
+		 * Wait until all the lookups that started before the call are done. It's called under the update mutex after a new snapshot is
+		 * published, so the old snapshot can be freed when it returns
+		 */
+		void waitForReaders();
+
+	private:
+		friend class ScopedReader;
+
+		pthread_mutex_t m_RefCountMutex;
+		int m_RefCount;
+		// the number of lookups in progress in each slot, and the slot new lookups are counted in
+		mutable volatile long m_NumOfReaders[2];
+		volatile int m_ReaderSlot;
+
+		// sets are shared by pointer, copying them isn't allowed
+		FilterSet(const FilterSet& other);
+		FilterSet& operator=(const FilterSet& other);
+	};
+
+
+	/**
+	 * @class IPPrefixSet
+	 * A set of IPv4 and IPv6 prefixes (subnets), for example 10.0.0.0/8, 192.168.1.1 (a /32 prefix) or 2001:db8::/32.<BR>
+	 * The prefixes are kept in a single open addressing hash table keyed by the masked address and the prefix length, like a longest
+	 * prefix match table. An address is looked up by masking it to each prefix length the set contains and probing the table, so a
+	 * lookup costs one probe per distinct prefix length regardless of the number of prefixes, and a set of host addresses costs a
+	 * single probe. Adding or removing a prefix copies the table into a new snapshot (see FilterSet), so large sets should be built
+	 * with assign()
+	 */
+	class IPPrefixSet : public FilterSet
+	{
+	public:
+
+		/**
+		 * A prefix in the set
+		 */
+		struct Prefix
+		{
+			/** The 64 most significant bits of the address, for IPv4 the address is stored in the 32 most significant bits */
+			uint64_t high;
+			/** The 64 least significant bits of an IPv6 address, 0 for IPv4 */
+			uint64_t low;
+			/** The prefix length */
+			uint8_t length;
+			/** True for an IPv6 prefix, false for IPv4 */
+			bool isIPv6;
+		};
+
+		/**
+		 * A c'tor for this class. Creates an empty set with a reference count of 1
+		 */
+		IPPrefixSet();
+
+		/**
+		 * Parse a prefix string
+		 * @param[in] prefixAsString An IPv4 or IPv6 address, optionally followed by a prefix length, for example "10.0.0.0/8",
+		 * "1.2.3.4" or "2001:db8::/32". An address without a prefix length is a host prefix (/32 or /128). The address bits beyond the
+		 * prefix length are ignored
+		 * @param[out] prefix The parsed prefix
+		 * @return True if the string is a valid prefix, false otherwise (in which case an error is written to log)
+		 */
+		static bool parsePrefix(const std::string& prefixAsString, Prefix& prefix);
+
+		/**
+		 * Add a prefix to the set. Adding a prefix that already exists does nothing and doesn't change the version of the set
+		 * @param[in] prefix The prefix to add, in the format parsePrefix() accepts
+		 * @return True if the prefix is valid, false otherwise
+		 */
+		bool add(const std::string& prefix);
+
+		/**
+		 * Remove a prefix from the set
+		 * @param[in] prefix The prefix to remove, in the format parsePrefix() accepts
+		 * @return True if the prefix was removed, false if it's invalid or isn't in the set
+		 */
+		bool remove(const std::string& prefix);
+
+		/**
+		 * Replace the whole content of the set. Threads that match packets against the set see either the old content or the new one
+		 * @param[in] prefixes The new prefixes, in the format parsePrefix() accepts
+		 * @return True if all the prefixes are valid and the content was replaced, false if one of them is invalid, in which case
+		 * the set isn't changed
+		 */
+		bool assign(const std::vector<std::string>& prefixes);
+
+		/**
+		 * Remove all the prefixes from the set
+		 */
+		void clear();
+
+		/**
+		 * @return The number of prefixes in the set
+		 */
+		size_t size() const;
+
+		/**
+		 * Get all the prefixes in the set, in no particular order
+		 * @param[out] prefixes A vector the prefixes are written to. Its previous content is cleared
+		 */
+		void getPrefixes(std::vector<Prefix>& prefixes) const;
+
+		/**
+		 * Look up an IPv4 address
+		 * @param[in] address The address as a number, its first octet being the most significant byte. This is the order it's
+		 * read from a packet in, and the reverse of IPv4Address#toInt() on little endian machines
+		 * @return True if the address belongs to one of the IPv4 prefixes in the set
+		 */
+		bool containsIPv4(uint32_t address) const;
+
+		/**
+		 * Look up an IPv6 address
+		 * @param[in] address A pointer to the 16 bytes of the address, as they appear in a packet
+		 * @return True if the address belongs to one of the IPv6 prefixes in the set
+		 */
+		bool containsIPv6(const uint8_t* address) const;
+
+		/**
+		 * Look up an IP address
+		 * @param[in] address The IPv4 or IPv6 address to look up
+		 * @return True if the address belongs to one of the prefixes in the set
+		 */
+		bool contains(const IPAddress& address) const;
+
+	private:
+		struct Entry
+		{
+			uint64_t high;
+			uint64_t low;
+			uint8_t length;
+			uint8_t flags;
+		};
+
+		struct Table
+		{
+			std::vector<Entry> entries;
+			size_t numOfEntries;
+			// the number of prefixes of each length, and the lengths that have prefixes from the longest to the shortest
+			uint32_t lengthCount[2][129];
+			std::vector<uint8_t> lengths[2];
+
+			Table();
+			bool insert(const Prefix& prefix);
+			bool erase(const Prefix& prefix);
+			bool find(uint64_t high, uint64_t low, uint8_t length, bool isIPv6) const;
+			bool lookup(uint64_t high, uint64_t low, bool isIPv6) const;
+			void grow();
+			void updateLengths(bool isIPv6);
+		};
+
+		// the current snapshot, replaced as a whole by every update
+		Table* volatile m_Table;
+
+		~IPPrefixSet();
+		void publish(Table* newTable);
+	};
+
+
+	/**
+	 * @class PortSet
+	 * A set of TCP/UDP ports, kept as a bitmap of all 65536 ports so a lookup is a single bit test. Every update copies the 8KB bitmap
+	 * into a new snapshot (see FilterSet)
+	 */
+	class PortSet : public FilterSet
+	{
+	public:
+
+		/**
+		 * A c'tor for this class. Creates an empty set with a reference count of 1
+		 */
+		PortSet();
+
+		/**
+		 * Add a port to the set
+		 * @param[in] port The port to add
+		 */
+		void add(uint16_t port);
+
+		/**
+		 * Add a range of ports to the set. If all the ports are already in the set nothing is changed
+		 * @param[in] fromPort The lower end of the range
+		 * @param[in] toPort The higher end of the range. If it's lower than fromPort the two are swapped
+		 */
+		void addRange(uint16_t fromPort, uint16_t toPort);
+
+		/**
+		 * Remove a port from the set
+		 * @param[in] port The port to remove
+		 * @return True if the port was removed, false if it isn't in the set
+		 */
+		bool remove(uint16_t port);
+
+		/**
+		 * Replace the whole content of the set. Threads that match packets against the set see either the old content or the new one
+		 * @param[in] ports The new ports
+		 */
+		void assign(const std::vector<uint16_t>& ports);
+
+		/**
+		 * Remove all the ports from the set
+		 */
+		void clear();
+
+		/**
+		 * @return The number of ports in the set
+		 */
+		size_t size() const;
+
+		/**
+		 * Get the content of the set as ranges of consecutive ports
+		 * @param[out] ranges A vector the ranges are written to, sorted by port. Its previous content is cleared
+		 */
+		void getRanges(std::vector<std::pair<uint16_t, uint16_t> >& ranges) const;
+
+		/**
+		 * Look up a port
+		 * @param[in] port The port to look up
+		 * @return True if the port is in the set
+		 */
+		bool contains(uint16_t port) const;
+
+	private:
+		struct Bitmap
+		{
+			uint32_t bits[65536 / 32];
+			size_t numOfPorts;
+		};
+
+		// the current snapshot, replaced as a whole by every update
+		Bitmap* volatile m_Bitmap;
+
+		~PortSet();
+		void publish(Bitmap* newBitmap);
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_FILTER_SET */
@@ -112,7 +112,8 @@ namespace pcpp
 	 *    to do this by calling KniDevice#startRequestHandlerThread;
 	 *  - During lifetime the packets may be send to/received from KNI device via
 	 *    calls to synchronous API (send/receive methods) or asynchronously by
-	 *    running capturing thread using KniDevice#startCapture;
+	 *    running capturing thread using KniDevice#startCapture. The way capturing
+	 *    thread polls the device is controlled by KniDevice#setPollingConfiguration;
 	 *  - KNI device will be destroyed or implicitly on application exit. User must assure
 	 *    that NO OTHER linux application is using KNI device when and after it is beeing
 	 *    destroyed otherwise Linux kernel may crush dramatically.
@@ -266,6 +267,59 @@ namespace pcpp
 			uint32_t kthreadCoreId;
 		};
 
+		/**
+		 * @brief Polling settings of the capture loops (startCapture and startCaptureBlockingMode).
+		 * The capture loop polls the device continuously as long as packets arrive, which gives the lowest latency under load.
+		 * After idleSpinIterations consecutive polls that return no packets it starts sleeping between polls: the first sleep is
+		 * minSleepNanoSeconds long and every further empty poll doubles it up to maxSleepNanoSeconds. The first poll that returns
+		 * packets brings the loop back to continuous polling. This way an idle device doesn't keep a core 100% busy while the
+		 * latency added to the first packet after an idle period is bounded by maxSleepNanoSeconds
+		 */
+		struct KniPollingConfiguration
+		{
+			/** Number of consecutive empty polls before the capture loop starts sleeping. The default is 1000 */
+			uint32_t idleSpinIterations;
+			/** First sleep time in nanoseconds once the device is idle. The default is 1000 (1 microsecond) */
+			long minSleepNanoSeconds;
+			/**
+			 * Maximum sleep time in nanoseconds. A value of 0 disables sleeping so the capture loop polls continuously and keeps its
+			 * core busy even when the device is idle. The default is 1000000 (1 millisecond)
+			 */
+			long maxSleepNanoSeconds;
+			/**
+			 * If set, KNI requests (see handleRequests() ) are also handled in the capture loop: before every sleep and at least once
+			 * every 1024 polls under load. This makes the request handler thread unnecessary while capturing. It must not be set
+			 * when the request handler thread is running because requests of a device can't be handled from two threads.
+			 * The default is false
+			 */
+			bool handleRequests;
+
+			/**
+			 * A c'tor that sets the default values
+			 */
+			KniPollingConfiguration() :
+				idleSpinIterations(1000), minSleepNanoSeconds(1000), maxSleepNanoSeconds(1000000), handleRequests(false)
+			{
+			}
+		};
+
+		/**
+		 * @brief Statistics of the capture loop, used to evaluate the polling settings.
+		 * The counters are updated by the capture thread without synchronization, so values read while capturing is running
+		 * are approximate
+		 */
+		struct KniCaptureStats
+		{
+			/** Number of times the device was polled */
+			uint64_t polls;
+			/** Number of polls that returned no packets */
+			uint64_t emptyPolls;
+			/** Number of times the capture loop slept because the device was idle */
+			uint64_t sleeps;
+			/** Number of packets captured */
+			uint64_t packets;
+		};
+
 	private:
 		/** All instances of this class MUST be produced by KniDeviceList class */
 		KniDevice(const KniDeviceConfiguration& conf, size_t mempoolSize, int unique);
@@ -413,6 +467,8 @@ namespace pcpp
 		 * This thread can be stoped explicitly by calling stopRequestHandlerThread() or
 		 * implicitly on KNI device destruction.
 		 * Linux <a href="http://man7.org/linux/man-pages/man2/nanosleep.2.html">nanosleep()</a> function is used for sleeping.
+		 * While packets are captured requests may be handled by the capturing thread instead
+		 * (see KniPollingConfiguration#handleRequests).
 		 * @note Callbacks provided for this KNI device will be called asynchronously in new thread
 		 * @param[in] sleepSeconds Sleeping time in seconds
 		 * @param[in] sleepNanoSeconds Sleeping time in nanoseconds
@@ -594,6 +650,22 @@ namespace pcpp
 		 * Stop a currently running asynchronous packet capture.
 		 */
 		void stopCapture();
+		/**
+		 * @brief Set the polling settings of the capture loops.
+		 * The settings are applied the next time startCapture() or startCaptureBlockingMode() is called
+		 * @param[in] config The polling settings
+		 */
+		void setPollingConfiguration(const KniPollingConfiguration& config);
+		/**
+		 * @return The polling settings of the capture loops
+		 */
+		inline const KniPollingConfiguration& getPollingConfiguration() const { return m_Capturing.polling; }
+		/**
+		 * @brief Get the statistics of the capture loop.
+		 * The statistics are reset whenever capturing is started
+		 * @param[out] stats A reference to a KniCaptureStats object where the statistics will be written into
+		 */
+		void getCaptureStats(KniCaptureStats& stats) const;
 
 		/* Device control */
 
@@ -631,8 +703,12 @@ namespace pcpp
 			OnKniPacketArriveCallback callback;
 			void* userCookie;
 			KniThread* thread;
+			KniPollingConfiguration polling;
+			KniCaptureStats stats;
 
 			static void* runCapture(void* devicePointer);
+			static bool deliverBurst(OnKniPacketArriveCallback callback, KniDevice* device, void* userCookie,
+				struct rte_mbuf** mBufArray, MBufRawPacket* rawPackets, uint32_t numOfPackets);
 			inline bool isRunning() const { return thread != NULL; }
 			void cleanup();
 		} m_Capturing;
@@ -35,10 +35,22 @@ namespace pcpp
 	 *    - Creating MBufRawPacket from scratch (in order to send it with DpdkDevice, for example). In this case the user should call
 	 *      the init() method after constructing the object in order to allocate a new mbuf from DPDK port pool (encapsulated by DpdkDevice)
 	 *
-	 * Limitations of this class:
-	 *    - Currently chained mbufs are not supported. An mbuf has the capability to be linked to another mbuf and create a linked list
-	 *      of mbufs. This is good for Jumbo packets or other uses. MBufRawPacket doesn't support this capability so there is no way to
-	 *      access the mbufs linked to the mbuf wrapped by MBufRawPacket instance. I hope I'll be able to add this support in the future
+	 *
+	 * Chained mbufs: an mbuf can be linked to other mbufs (segments) to hold packets which are larger than a single mbuf, such as jumbo
+	 * frames or packets received with scatter RX (see DpdkDevice#DpdkDeviceConfiguration#maxRxPacketLength). MBufRawPacket handles
+	 * them as follows:
+	 *    - When a chained mbuf is received its data isn't copied: getRawData() points to the first segment, getRawDataLen() is the
+	 *      first segment length and getFrameLength() is the whole packet length, the same way a packet captured with a snapshot length
+	 *      looks. Since the first segment usually holds all the headers, a Packet object created at this point can parse and edit the
+	 *      headers without any copy. isContiguous() returns false in this state
+	 *    - linearize() makes the whole packet data accessible through getRawData(). If the data fits in the first segment the segments
+	 *      are merged into it, otherwise the data is copied into a separate linear buffer held by this object. Editing methods
+	 *      (appendData(), insertData(), removeData(), etc.) linearize the packet automatically
+	 *    - When the data grows beyond the size of a single mbuf (for example by setRawData() with a jumbo frame or by appending data)
+	 *      it's kept in a linear buffer as well
+	 *    - When the packet is kept in a linear buffer, getMBuf() writes the data back to the mbuf chain, adding or freeing segments as
+	 *      needed. All the send methods of DpdkDevice and KniDevice use getMBuf() so chained packets are sent correctly, provided the
+	 *      device supports multi-segment TX
 	 */
 	class MBufRawPacket : public RawPacket
 	{
@@ -50,10 +62,18 @@ namespace pcpp
 		struct rte_mbuf* m_MBuf;
 		struct rte_mempool* m_Mempool;
 		bool m_FreeMbuf;
+		uint8_t* m_LinearData;
+		size_t m_LinearDataCapacity;
 
 		void setMBuf(struct rte_mbuf* mBuf, timespec timestamp);
 		bool init(struct rte_mempool* mempool);
 		bool initFromRawPacket(const RawPacket* rawPacket, struct rte_mempool* mempool);
+		bool copyFrom(const MBufRawPacket& other);
+		bool resizeData(int newDataLen);
+		bool setLinearDataCapacity(size_t capacity);
+		void freeLinearData();
+		void resetMBufChain();
+		bool updateMBufFromLinearData();
 	public:
 
 		/**
@@ -61,7 +81,7 @@ namespace pcpp
 		 * an mbuf the user should call the init() method. Without calling init() the instance of this class is not usable.
 		 * This c'tor can be used for initializing an array of MBufRawPacket (which requires an empty c'tor)
 		 */
-		MBufRawPacket() : RawPacket(), m_MBuf(NULL), m_Mempool(NULL), m_FreeMbuf(true) { m_DeleteRawDataAtDestructor = false; }
+		MBufRawPacket() : RawPacket(), m_MBuf(NULL), m_Mempool(NULL), m_FreeMbuf(true), m_LinearData(NULL), m_LinearDataCapacity(0) { m_DeleteRawDataAtDestructor = false; }
 
 		/**
 		 * A d'tor for this class. Once called it frees the mbuf attached to it (returning it back to the mbuf pool it was allocated from)
@@ -71,14 +91,16 @@ namespace pcpp
 		/**
 		 * A copy c'tor for this class. The copy c'tor allocates a new mbuf from the same pool the original mbuf was
 		 * allocated from, attaches the new mbuf to this instance of MBufRawPacket and copies the data from the original mbuf
-		 * to the new mbuf
+		 * to the new mbuf. If the original mbuf is chained, the whole packet data is copied
 		 * @param[in] other The MBufRawPacket instance to copy from
 		 */
 		MBufRawPacket(const MBufRawPacket& other);
 
 		/**
 		 * @brief Initialize an instance of this class from DpdkDevice.
-		 * Initialization includes allocating an mbuf from the pool that resides in DpdkDevice.
+		 * Initialization includes allocating an mbuf from the pool that resides in DpdkDevice. If the device has an mbuf pool on
+		 * every NUMA node (see DpdkDevice#DpdkDeviceConfiguration#mBufPoolPerNumaNode), the pool on the NUMA node of the calling core
+		 * is used.
 		 * The user should call this method only once per instance.
 		 * Calling it more than once will result with an error
 		 * @param[in] device The DpdkDevice which has the pool to allocate the mbuf from
@@ -99,8 +121,8 @@ namespace pcpp
 
 		/**
 		 * @brief Initialize an instance of this class and copies the content of a RawPacket object.
-		 * Initialization includes allocating an mbuf from the pool that resides in provided DpdkDevice,
-		 * and copying the data from the input RawPacket object into this mBuf.
+		 * Initialization includes allocating an mbuf from the pool that resides in provided DpdkDevice (on the NUMA node of the
+		 * calling core if the device has a pool on every NUMA node), and copying the data from the input RawPacket object into this mBuf.
 		 * The user should call this method only once per instance.
 		 * Calling it more than once will result with an error
 		 * @param[in] rawPacket A pointer to a RawPacket object from which data will be copied
@@ -123,9 +145,36 @@ namespace pcpp
 		bool initFromRawPacket(const RawPacket* rawPacket, KniDevice* device);
 
 		/**
-		 * @return A pointer to the DPDK mbuf stored in this object
+		 * @return A pointer to the DPDK mbuf stored in this object. If the packet data is kept in a linear buffer (see the class
+		 * description), the mbuf chain is updated with this data first
+		 */
+		inline rte_mbuf* getMBuf()
+		{
+			if (m_LinearData != NULL)
+				updateMBufFromLinearData();
+			return m_MBuf;
+		}
+
+		/**
+		 * @return The number of segments in the mbuf chain, or 0 if no mbuf is attached. When the packet data is kept in a linear buffer
+		 * this is the number of segments the last time the chain was updated (by getMBuf() )
+		 */
+		int getNumOfSegments() const;
+
+		/**
+		 * @return True if the whole packet data is accessible through getRawData(), false if the mbuf is chained and only the first
+		 * segment is accessible. In the latter case linearize() should be called in order to access the rest of the data
+		 */
+		bool isContiguous() const;
+
+		/**
+		 * Make the whole packet data accessible through getRawData(). If the mbuf isn't chained nothing is done. Otherwise, if the
+		 * data fits in the first segment the segments are merged into it, and if not the data is copied to a linear buffer held by
+		 * this object (and written back to the mbuf chain when getMBuf() is called). Notice that the raw data pointer may change, so a
+		 * Packet object that was created before calling this method should be re-created
+		 * @return True if the packet data is contiguous, false if no mbuf is attached
 		 */
-		inline rte_mbuf* getMBuf() { return m_MBuf; }
+		bool linearize();
 
 		// overridden methods
 
@@ -153,8 +202,9 @@ namespace pcpp
 		 * @param[in] layerType The link layer type for this raw data. Default is Ethernet
 		 * @param[in] frameLength When reading from pcap files, sometimes the captured length is different from the actual packet length. This parameter represents the packet
 		 * length. This parameter is optional, if not set or set to -1 it is assumed both lengths are equal
-		 * @return True if raw data was copied to the mbuf successfully, false if rawDataLen is larger than mbuf max size, if initialization
-		 * failed or if copying the data to the mbuf failed. In all of these cases an error will be printed to log
+		 * @return True if raw data was copied to the mbuf successfully, false if initialization failed or if copying the data to the
+		 * mbuf failed. In all of these cases an error will be printed to log. Data which is larger than a single mbuf is kept in a linear
+		 * buffer and is written to an mbuf chain when getMBuf() is called
 		 */
 		bool setRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType = LINKTYPE_ETHERNET, int frameLength = -1);
 
@@ -165,7 +215,8 @@ namespace pcpp
 
 		/**
 		 * Append packet data at the end of current data. This method uses the same mbuf already allocated and tries to append more space and
-		 * copy the data to it. If MBufRawPacket is not initialize (mbuf is NULL) or mbuf append failed an error is printed to log
+		 * copy the data to it. If there is not enough room in the mbuf the data is moved to a linear buffer (see the class description).
+		 * If MBufRawPacket is not initialize (mbuf is NULL) an error is printed to log
 		 * @param[in] dataToAppend A pointer to the data to append
 		 * @param[in] dataToAppendLen Length in bytes of dataToAppend
 		 */
@@ -173,8 +224,9 @@ namespace pcpp
 
 		/**
 		 * Insert raw data at some index of the current data and shift the remaining data to the end. This method uses the
-		 * same mbuf already allocated and tries to append more space to it. Then it just copies dataToAppend at the relevant index and shifts
-		 * the remaining data to the end. If MBufRawPacket is not initialize (mbuf is NULL) or mbuf append failed an error is printed to log
+		 * same mbuf already allocated and tries to append more space to it (or moves the data to a linear buffer if there is not enough room).
+		 * Then it just copies dataToAppend at the relevant index and shifts the remaining data to the end. If MBufRawPacket is not
+		 * initialize (mbuf is NULL) an error is printed to log
 		 * @param[in] atIndex The index to insert the new data to
 		 * @param[in] dataToInsert A pointer to the new data to insert
 		 * @param[in] dataToInsertLen Length in bytes of dataToInsert
@@ -192,10 +244,11 @@ namespace pcpp
 		bool removeData(int atIndex, size_t numOfBytesToRemove);
 
 		/**
-		 * This overridden method,in contrast to its ancestor RawPacket#reallocateData() doesn't need to do anything because mbuf is already
-		 * allocated to its maximum extent. So it only performs a check to verify the size after re-allocation doesn't exceed mbuf max size
+		 * This overridden method,in contrast to its ancestor RawPacket#reallocateData() doesn't need to do anything as long as the new size
+		 * fits in the mbuf, because mbuf is already allocated to its maximum extent. If the new size is larger than the mbuf, the data is
+		 * moved to a linear buffer of the new size (see the class description)
 		 * @param[in] newBufferLength The new buffer length as required by the user
-		 * @return True if new size is larger than current size but smaller than mbuf max size, false otherwise
+		 * @return True if new size is larger than current size, false otherwise
 		 */
 		bool reallocateData(size_t newBufferLength);
 
@@ -0,0 +1,332 @@
+#ifndef PCAPPP_NATIVE_FILTER
+#define PCAPPP_NATIVE_FILTER
+
+#include "PcapFilter.h"
+#include "RawPacket.h"
+#include "MacAddress.h"
+#include "FilterSet.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @file
+ * This file provides NativeFilter, an evaluator that matches packets against GeneralFilter trees (see PcapFilter.h) without libpcap.
+ * A filter tree is compiled once into a flat program of instructions which is then run directly on the raw packet data. This gives
+ * DPDK, PF_RING and offline code a filtering path that doesn't depend on BPF
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	class Packet;
+
+	/**
+	 * @class NativeFilter
+	 * A GeneralFilter tree compiled into a flat program that can be matched against packets without libpcap.<BR>
+	 * Every leaf filter becomes a single instruction and AndFilter, OrFilter and NotFilter become jumps between instructions, so
+	 * matching a packet walks the program once, short-circuits like the BPF code libpcap generates for the same filter and doesn't
+	 * allocate memory. The semantics follow the BPF string each filter produces in GeneralFilter#parseToString():
+	 * - VlanFilter and ProtoFilter(VLAN) shift the offsets of all the filters compiled after them by the size of a VLAN tag, the same way
+	 *   the "vlan" keyword does in libpcap. MacAddressFilter isn't affected by this shift
+	 * - A filter that reads beyond the end of the packet rejects the whole packet, as in BPF
+	 * - IPFilter, IPv4IDFilter, IPv4TotalLengthFilter, TcpWindowSizeFilter, UdpLengthFilter and TcpFlagsFilter match IPv4 packets only,
+	 *   and the TCP/UDP filters don't match non-first fragments
+	 * - PortFilter, PortRangeFilter and ProtoFilter of TCP, UDP, GRE and IGMP match both IPv4 and IPv6
+	 *
+	 * The link types getRawNetworkLayerOffsets() supports are supported: Ethernet, Linux cooked capture (SLL), NULL/loopback and raw
+	 * IPv4/IPv6. VLAN tags (see isVlanEtherType()) are recognized on Ethernet only and
+	 * MAC address filters match Ethernet packets only.<BR>
+	 * Filters that can't be expressed natively, such as BPFStringFilter or IPv6 address filters, fail to compile. A compiled program is
+	 * independent of the filter tree it was compiled from, so the tree may be changed or destroyed after compile(). The only exception
+	 * is the sets of IPSetFilter, SubnetSetFilter and PortSetFilter: the program shares them with the filters (and keeps them alive
+	 * as long as it needs them), so updating a set changes the packets the program matches right away, without compiling it again
+	 */
+	class NativeFilter
+	{
+		friend class NativeFilterBuilder;
+	public:
+
+		/**
+		 * A c'tor for this class. Creates an empty program which doesn't match any packet until compile() is called
+		 */
+		NativeFilter() : m_IsCompiled(false) {}
+
+		/**
+		 * A copy c'tor for this class. The copy shares the sets the original program uses
+		 * @param[in] other The program to copy
+		 */
+		NativeFilter(const NativeFilter& other);
+
+		/**
+		 * A d'tor for this class. Releases the sets the program uses
+		 */
+		~NativeFilter();
+
+		/**
+		 * An assignment operator for this class. The sets the program used before are released
+		 * @param[in] other The program to copy
+		 * @return A reference to this program
+		 */
+		NativeFilter& operator=(const NativeFilter& other);
+
+		/**
+		 * Compile a filter tree into this program. A previously compiled program is replaced
+		 * @param[in] filter The filter tree to compile
+		 * @return True if the filter was compiled successfully, false if the filter or one of the filters it contains can't be
+		 * compiled natively. In this case an error is written to log and the program is cleared
+		 */
+		bool compile(const GeneralFilter& filter);
+
+		/**
+		 * @return True if a filter was compiled successfully into this program
+		 */
+		bool isCompiled() const { return m_IsCompiled; }
+
+		/**
+		 * Clear the program. matchPacket() returns false until another filter is compiled
+		 */
+		void clear();
+
+		/**
+		 * @return The number of instructions in the compiled program
+		 */
+		size_t getProgramSize() const { return m_Program.size(); }
+
+		/**
+		 * Match raw packet data with the compiled filter
+		 * @param[in] data A pointer to the packet data, starting at the link layer
+		 * @param[in] dataLen The packet data length
+		 * @param[in] linkType The link layer type of the packet data. The default is LINKTYPE_ETHERNET
+		 * @return True if the packet matches the filter, false if it doesn't, if the link type isn't supported or if no filter was compiled
+		 */
+		bool matchPacket(const uint8_t* data, int dataLen, LinkLayerType linkType = LINKTYPE_ETHERNET) const;
+
+		/**
+		 * Match a raw packet with the compiled filter
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @return True if the packet matches the filter, false otherwise
+		 */
+		bool matchPacket(const RawPacket* rawPacket) const;
+
+		/**
+		 * Match a parsed packet with the compiled filter. The filter is evaluated on the raw data of the packet, its layers aren't used
+		 * @param[in] packet The packet to match
+		 * @return True if the packet matches the filter, false otherwise
+		 */
+		bool matchPacket(const Packet& packet) const;
+
+	private:
+
+		enum Opcode
+		{
+			OpAlways,
+			OpEtherType,
+			OpVlan,
+			OpMacAddress,
+			OpIPv4Net,
+			OpIPProtocol,
+			OpPortRange,
+			OpIPPrefixSet,
+			OpPortSet,
+			OpField
+		};
+
+		struct Instruction
+		{
+			uint8_t opcode;
+			uint8_t flags;
+			uint8_t fieldLayer;
+			uint8_t fieldSize;
+			uint16_t fieldOffset;
+			uint16_t linkShift;
+			uint8_t op;
+			uint8_t mac[6];
+			uint32_t value;
+			uint32_t mask;
+			uint32_t jumpIfTrue;
+			uint32_t jumpIfFalse;
+			const FilterSet* set;
+		};
+
+		struct PacketView;
+
+		std::vector<Instruction> m_Program;
+		std::vector<FilterSet*> m_Sets;
+		bool m_IsCompiled;
+
+		static int evaluate(const Instruction& instruction, const PacketView& packet);
+	};
+
+
+	/**
+	 * @class NativeFilterBuilder
+	 * The builder a GeneralFilter uses to compile itself into a NativeFilter program, see GeneralFilter#compileNative(). It's created
+	 * by NativeFilter#compile() and isn't meant to be used directly, unless a new GeneralFilter class needs native support.<BR>
+	 * Control flow is expressed with labels: every filter is compiled with a label to jump to if it matches and a label to jump to if it
+	 * doesn't. The predefined labels Accept and Reject end the program, other labels are created by newLabel() and must be placed
+	 * by placeLabel() after the instructions that jump to them, so all jumps in a program go forward. Every emit method adds a single
+	 * instruction that tests one condition and jumps to one of the labels it gets
+	 */
+	class NativeFilterBuilder
+	{
+		friend class NativeFilter;
+	public:
+
+		/**
+		 * A jump target in the program
+		 */
+		typedef uint32_t Label;
+
+		/**
+		 * A label that ends the program and matches the packet
+		 */
+		static const Label Accept = 0;
+
+		/**
+		 * A label that ends the program and rejects the packet
+		 */
+		static const Label Reject = 1;
+
+		/**
+		 * The protocol header a field emitted by emitField() is read from
+		 */
+		enum FieldLayer
+		{
+			/** The IPv4 header. The field is read from IPv4 packets only */
+			IPv4Field,
+			/** The ARP header. The field is read from ARP packets only */
+			ArpField,
+			/** The TCP header. The field is read from TCP over IPv4 packets which aren't non-first fragments only */
+			TcpField,
+			/** The UDP header. The field is read from UDP over IPv4 packets which aren't non-first fragments only */
+			UdpField
+		};
+
+		/**
+		 * @return A new label. It should be placed with placeLabel() after the instructions that jump to it
+		 */
+		Label newLabel();
+
+		/**
+		 * Place a label before the next emitted instruction
+		 * @param[in] label The label to place
+		 */
+		void placeLabel(Label label);
+
+		/**
+		 * Emit an unconditional jump
+		 * @param[in] target The label to jump to
+		 */
+		void emitAlways(Label target);
+
+		/**
+		 * Emit an EtherType test, equivalent to "ether proto X"
+		 * @param[in] etherType The EtherType to test (in host byte order)
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitEtherType(uint16_t etherType, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit a VLAN tag test, equivalent to "vlan" or "vlan X". All the instructions emitted after it read the packet with an offset of
+		 * a VLAN tag, as in libpcap
+		 * @param[in] matchVlanId If true the VLAN ID is tested as well, otherwise only the existence of a VLAN tag is tested
+		 * @param[in] vlanId The VLAN ID to test
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitVlan(bool matchVlanId, uint16_t vlanId, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit an Ethernet MAC address test, equivalent to "ether src/dst/host X"
+		 * @param[in] macAddress The MAC address to test
+		 * @param[in] dir The address to test: source, destination or both
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitMacAddress(const MacAddress& macAddress, Direction dir, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit an IPv4 subnet test, equivalent to "ip and src/dst net X mask Y"
+		 * @param[in] address The subnet address as returned by IPv4Address#toInt()
+		 * @param[in] mask The subnet mask as returned by IPv4Address#toInt()
+		 * @param[in] dir The address to test: source, destination or both
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitIPv4Net(uint32_t address, uint32_t mask, Direction dir, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit an IP protocol test, equivalent to "ip proto X", "ip6 proto X" or "proto X". The IPv6 test also matches the protocol
+		 * after a fragment extension header, as libpcap does
+		 * @param[in] protocol The IP protocol number to test
+		 * @param[in] matchIPv4 Test the protocol of IPv4 packets
+		 * @param[in] matchIPv6 Test the protocol of IPv6 packets
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitIPProtocol(uint8_t protocol, bool matchIPv4, bool matchIPv6, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit a TCP/UDP/SCTP port range test, equivalent to "src/dst portrange X-Y"
+		 * @param[in] fromPort The lower end of the port range
+		 * @param[in] toPort The higher end of the port range. If it's lower than fromPort the two are swapped
+		 * @param[in] dir The port to test: source, destination or both
+		 * @param[in] onMatch The label to jump to if the test succeeds
+		 * @param[in] onMismatch The label to jump to if the test fails
+		 */
+		void emitPortRange(uint16_t fromPort, uint16_t toPort, Direction dir, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit an IP address lookup in a set of prefixes, equivalent to "ip and (src/dst net X or ...) or ip6 and (src/dst net Y or ...)".
+		 * The program keeps a reference to the set and looks it up on every packet, so later changes to the set take effect immediately
+		 * @param[in] set The set to look the addresses up in
+		 * @param[in] dir The address to look up: source, destination or both
+		 * @param[in] onMatch The label to jump to if the address is in the set
+		 * @param[in] onMismatch The label to jump to if it isn't
+		 */
+		void emitIPPrefixSet(IPPrefixSet* set, Direction dir, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit a TCP/UDP/SCTP port lookup in a set of ports, equivalent to "src/dst port X or src/dst port Y or ...". The program keeps
+		 * a reference to the set and looks it up on every packet, so later changes to the set take effect immediately
+		 * @param[in] set The set to look the ports up in
+		 * @param[in] dir The port to look up: source, destination or both
+		 * @param[in] onMatch The label to jump to if the port is in the set
+		 * @param[in] onMismatch The label to jump to if it isn't
+		 */
+		void emitPortSet(PortSet* set, Direction dir, Label onMatch, Label onMismatch);
+
+		/**
+		 * Emit a header field comparison, equivalent to "proto[offset:size] & mask op value", for example "tcp[13] & 0x12 = 0x12"
+		 * @param[in] layer The header the field is read from
+		 * @param[in] offset The field offset from the beginning of the header
+		 * @param[in] size The field size in bytes: 1, 2 or 4
+		 * @param[in] mask A mask to apply to the field before the comparison, or 0 to compare the whole field
+		 * @param[in] op The comparison operator
+		 * @param[in] value The value to compare the field with
+		 * @param[in] onMatch The label to jump to if the comparison succeeds
+		 * @param[in] onMismatch The label to jump to if the comparison fails
+		 * @return True if the field size is valid, false otherwise
+		 */
+		bool emitField(FieldLayer layer, uint16_t offset, uint8_t size, uint32_t mask, FilterOperator op, uint32_t value, Label onMatch, Label onMismatch);
+
+	private:
+		std::vector<NativeFilter::Instruction>& m_Program;
+		std::vector<FilterSet*>& m_Sets;
+		std::vector<uint32_t> m_LabelPositions;
+		uint16_t m_LinkShift;
+
+		NativeFilterBuilder(std::vector<NativeFilter::Instruction>& program, std::vector<FilterSet*>& sets);
+
+		NativeFilter::Instruction& emit(uint8_t opcode, Label onMatch, Label onMismatch);
+		bool resolveLabels();
+	};
+
+} // namespace pcpp
+
+#endif /* PCAPPP_NATIVE_FILTER */
@@ -0,0 +1,136 @@
+#ifndef PCAPPP_PACKET_SAMPLER
+#define PCAPPP_PACKET_SAMPLER
+
+#include "RawPacket.h"
+#include <stdint.h>
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class PacketSampler
+	 * A packet sampler that capture devices apply on the raw packet data before any RawPacket object is built and before the user
+	 * callback is invoked, so packets that are not selected cost almost nothing. The following sampling methods are supported:
+	 * - Count sampling - deterministic 1-in-N sampling: every N-th packet is selected
+	 * - Random sampling - each packet is selected with a probability of 1/N
+	 * - Flow hash sampling - a symmetric hash of the IP addresses, IP protocol and TCP/UDP/SCTP ports is calculated for each packet
+	 *   and roughly 1/N of the flows are selected. All packets of a selected flow are selected (in both directions), and the same
+	 *   flows are selected on every device and every run that uses the same seed. Non-IP packets fall back to count sampling<BR>
+	 * Since the sampler keeps state, every device holds its own copy which is set via the device's setPacketSampler() method. The
+	 * user callbacks can retrieve the sample rate (e.g for scaling statistics) from the device's getPacketSampler() method
+	 */
+	class PacketSampler
+	{
+	public:
+
+		/**
+		 * The available sampling methods
+		 */
+		enum SamplingMethod
+		{
+			/** All packets are selected */
+			NoSampling = 0,
+			/** Deterministic 1-in-N sampling */
+			CountSampling = 1,
+			/** Each packet is selected with a probability of 1/N */
+			RandomSampling = 2,
+			/** Roughly 1/N of the flows are selected, all packets of a selected flow are selected */
+			FlowHashSampling = 3
+		};
+
+		/**
+		 * A c'tor for this class
+		 * @param[in] method The sampling method. The default is NoSampling
+		 * @param[in] sampleRate The sample rate N, meaning 1 in N packets (or flows) are selected. A value of 0 or 1 means all packets
+		 * are selected. The default is 1
+		 * @param[in] seed A seed for the random number generator (in RandomSampling) or for the flow hash (in FlowHashSampling).
+		 * Devices using the same seed select the same flows. The default is 0
+		 */
+		PacketSampler(SamplingMethod method = NoSampling, uint32_t sampleRate = 1, uint32_t seed = 0);
+
+		/**
+		 * @return The sampling method
+		 */
+		SamplingMethod getMethod() const { return m_Method; }
+
+		/**
+		 * @return The sample rate N (1 in N packets or flows are selected). 1 means all packets are selected
+		 */
+		uint32_t getSampleRate() const { return m_SampleRate; }
+
+		/**
+		 * @return The seed used for the random number generator or the flow hash
+		 */
+		uint32_t getSeed() const { return m_Seed; }
+
+		/**
+		 * @return The number of packets the sampler was asked about since it was created or since resetCounters() was called
+		 */
+		uint64_t getNumOfPacketsSeen() const { return m_NumOfPacketsSeen; }
+
+		/**
+		 * @return The number of packets the sampler selected since it was created or since resetCounters() was called
+		 */
+		uint64_t getNumOfPacketsSampled() const { return m_NumOfPacketsSampled; }
+
+		/**
+		 * Reset the packets seen and packets sampled counters
+		 */
+		void resetCounters() { m_NumOfPacketsSeen = 0; m_NumOfPacketsSampled = 0; }
+
+		/**
+		 * Decide whether a packet should be selected. This method is called by the capture devices on the raw packet data
+		 * @param[in] packetData A pointer to the raw packet data
+		 * @param[in] packetDataLen The raw packet data length
+		 * @param[in] linkType The link layer type of the packet. Only used in FlowHashSampling
+		 * @return True if the packet was selected, false if it should be dropped
+		 */
+		inline bool sample(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType)
+		{
+			m_NumOfPacketsSeen++;
+			if (m_Method == NoSampling || isSelected(packetData, packetDataLen, linkType))
+			{
+				m_NumOfPacketsSampled++;
+				return true;
+			}
+
+			return false;
+		}
+
+		/**
+		 * Calculate the symmetric flow hash used in FlowHashSampling. The hash covers the source and destination IP addresses, the IP
+		 * protocol and the TCP/UDP/SCTP ports (ports are ignored in IP fragments), and is the same for both directions of a flow.
+		 * The headers are found by parseRawPacketHeaders(), which lists the supported link types and the skipped VLAN tags and IPv6
+		 * extension headers
+		 * @param[in] packetData A pointer to the raw packet data
+		 * @param[in] packetDataLen The raw packet data length
+		 * @param[in] linkType The link layer type of the packet
+		 * @param[in] seed A seed to mix into the hash
+		 * @param[out] hash The calculated hash
+		 * @return True if the packet is an IPv4 or IPv6 packet and the hash was calculated, false otherwise
+		 */
+		static bool calculateFlowHash(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, uint32_t seed, uint32_t& hash);
+
+	private:
+		SamplingMethod m_Method;
+		uint32_t m_SampleRate;
+		uint32_t m_Seed;
+		uint32_t m_Threshold;
+		uint32_t m_Counter;
+		uint32_t m_RandomState;
+		uint64_t m_NumOfPacketsSeen;
+		uint64_t m_NumOfPacketsSampled;
+
+		bool isSelected(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType);
+		bool countSample();
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_PACKET_SAMPLER
@@ -2,6 +2,9 @@
 #define PCAPPP_PCAP_DEVICE
 
 #include "Device.h"
+#include "PacketSampler.h"
+#include "StatefulFilter.h"
+#include "NativeFilter.h"
 
 /**
  * Next define is ncessery in MinGw environment build context.
@@ -36,9 +39,29 @@ namespace pcpp
 	{
 	protected:
 		pcap_t* m_PcapDescriptor;
+		PacketSampler m_PacketSampler;
+		StatefulFilter* m_StatefulFilter;
+		// exact user-space match of the last GeneralFilter set, compiled only if it contains a filter set
+		NativeFilter m_PostFilter;
 
 		// c'tor should not be public
-		IPcapDevice() : IDevice() { m_PcapDescriptor = NULL; }
+		IPcapDevice() : IDevice() { m_PcapDescriptor = NULL; m_StatefulFilter = NULL; }
+
+		// true if no stateful filter is set or if the packet passes it
+		inline bool matchStatefulFilter(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, const timespec& timestamp)
+		{
+			return m_StatefulFilter == NULL || m_StatefulFilter->matchPacket(packetData, packetDataLen, linkType, timestamp);
+		}
+
+		// true if no post filter is set or if the packet passes it
+		inline bool matchPostFilter(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType) const
+		{
+			return !m_PostFilter.isCompiled() || m_PostFilter.matchPacket(packetData, packetDataLen, linkType);
+		}
+
+		// true if the BPF filter set by setFilter(std::string) drops packets before they reach this process (in the kernel or on a remote
+		// host), which makes it worth keeping as a pre-filter of the post filter. File devices run it in user-space
+		virtual bool isBpfFilterInKernel() const { return true; }
 
 	public:
 		virtual ~IPcapDevice();
@@ -90,10 +113,50 @@ namespace pcpp
 		*/
 		static bool matchPacketWithFilter(GeneralFilter& filter, RawPacket* rawPacket);
 
+		/**
+		 * Set a packet sampler for the device. The sampler is applied on the raw packet data before RawPacket objects are built or
+		 * callbacks are invoked, so packets that aren't selected are dropped at minimal cost. This method should be called before
+		 * capturing or reading starts. The sampler is copied into the device, so its counters start from the ones of the sampler given
+		 * @param[in] sampler The sampler to set. Setting a default constructed PacketSampler disables sampling
+		 */
+		void setPacketSampler(const PacketSampler& sampler) { m_PacketSampler = sampler; }
+
+		/**
+		 * @return The packet sampler currently set on the device. Packet callbacks can use it to retrieve the sample rate
+		 * (see PacketSampler#getSampleRate()) and the number of packets seen and sampled
+		 */
+		const PacketSampler& getPacketSampler() const { return m_PacketSampler; }
+
+		/**
+		 * Set a stateful (flow-aware) filter for the device. The filter is applied on the raw packet data after the packet sampler and
+		 * before RawPacket objects are built or callbacks are invoked, so only packets of accepted flows reach the user. Unlike the
+		 * sampler the filter isn't copied: the device uses the given instance, which lets the user read its statistics, and the
+		 * instance must stay alive and must not be used elsewhere while the device reads or captures. This method should be called
+		 * before capturing or reading starts
+		 * @param[in] filter The filter to set, or NULL to remove the filter currently set
+		 */
+		void setStatefulFilter(StatefulFilter* filter) { m_StatefulFilter = filter; }
+
+		/**
+		 * @return The stateful filter currently set on the device, or NULL if no filter is set
+		 */
+		StatefulFilter* getStatefulFilter() const { return m_StatefulFilter; }
+
 
 		// implement abstract methods
 
-		using IFilterableDevice::setFilter;
+		/**
+		 * Set a filter for the device. The filter is converted to a BPF string and set on libpcap. If the filter contains a filter set
+		 * (IPSetFilter, SubnetSetFilter or PortSetFilter) the BPF string may match more packets than the filter (see
+		 * IFilterWithSet#setMaxBpfTerms()), so the filter is also compiled to a NativeFilter which every packet that passes libpcap
+		 * is matched against before it reaches the user. Since the NativeFilter shares the sets with the filter, removals from the
+		 * sets take effect immediately. File devices run the BPF filter in user-space too, so they set only the NativeFilter, and
+		 * values added to the sets take effect immediately as well. Please note that when the device is closed the filter is reset so when reopening the
+		 * device you need to call this method again in order to reactivate the filter
+		 * @param[in] filter The filter to be set in PcapPlusPlus' GeneralFilter format
+		 * @return True if filter set successfully, false otherwise
+		 */
+		virtual bool setFilter(GeneralFilter& filter);
 
 		/**
 		 * Set a filter for the device. When implemented by the device, only packets that match the filter will be received.
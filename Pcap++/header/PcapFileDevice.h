@@ -3,6 +3,8 @@
 
 #include "PcapDevice.h"
 #include "RawPacket.h"
+#include "BpfJit.h"
+#include "CaptureIndex.h"
 
 /// @file
 
@@ -25,6 +27,8 @@ namespace pcpp
 		IFileDevice(const char* fileName);
 		virtual ~IFileDevice();
 
+		bool isBpfFilterInKernel() const { return false; }
+
 	public:
 
 		/**
@@ -100,6 +104,8 @@ namespace pcpp
 	{
 	private:
 		LinkLayerType m_PcapLinkLayerType;
+		BpfJit m_BpfJit;
+		bool m_LibpcapFilterSet;
 
 		// private copy c'tor
 		PcapFileReaderDevice(const PcapFileReaderDevice& other);
@@ -111,7 +117,7 @@ namespace pcpp
 		 * isn't opened yet, so reading packets will fail. For opening the file call open()
 		 * @param[in] fileName The full path of the file to read
 		 */
-		PcapFileReaderDevice(const char* fileName) : IFileReaderDevice(fileName), m_PcapLinkLayerType(LINKTYPE_ETHERNET) {}
+		PcapFileReaderDevice(const char* fileName) : IFileReaderDevice(fileName), m_PcapLinkLayerType(LINKTYPE_ETHERNET), m_LibpcapFilterSet(false) {}
 
 		/**
 		 * A destructor for this class
@@ -146,6 +152,19 @@ namespace pcpp
 		 * @param[out] stats The stats struct where stats are returned
 		 */
 		void getStatistics(pcap_stat& stats) const;
+
+		using IFileReaderDevice::setFilter;
+
+		/**
+		 * Set a filter for the file reader device. Only packets that match the filter will be received. The filter is compiled by libpcap
+		 * for the link type of the file and run by BpfJit, as native code where it's supported. A program BpfJit rejects (for example one
+		 * longer than BPF_MAXINSNS instructions) is run by libpcap instead. The device must be opened before setting a filter, and the
+		 * filter is cleared when the device is opened again
+		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html). An
+		 * empty string clears the filter
+		 * @return True if filter set successfully, false otherwise
+		 */
+		bool setFilter(std::string filterAsString);
 	};
 
 
@@ -158,6 +177,7 @@ namespace pcpp
 	private:
 		void* m_LightPcapNg;
 		struct bpf_program m_Bpf;
+		BpfJit m_BpfJit;
 		bool m_BpfInitialized;
 		int m_BpfLinkType;
 		std::string m_CurFilter;
@@ -246,6 +266,8 @@ namespace pcpp
 		 */
 		void getStatistics(pcap_stat& stats) const;
 
+		using IFileReaderDevice::setFilter;
+
 		/**
 		 * Set a filter for PcapNG reader device. Only packets that match the filter will be received
 		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
@@ -292,7 +314,9 @@ namespace pcpp
 	 * @class PcapFileWriterDevice
 	 * A class for opening a pcap file for writing or create a new pcap file and write packets to it. This class adds
 	 * a unique capability that isn't supported in WinPcap and in older libpcap versions which is to open a pcap file
-	 * in append mode where packets are written at the end of the pcap file instead of running it over
+	 * in append mode where packets are written at the end of the pcap file instead of running it over.<BR>
+	 * The writer can also build a CaptureIndex of the file while writing it (see setIndexEnabled()), so files of a long capture are indexed
+	 * without being read again
 	 */
 	class PcapFileWriterDevice : public IFileWriterDevice
 	{
@@ -301,6 +325,8 @@ namespace pcpp
 		LinkLayerType m_PcapLinkLayerType;
 		bool m_AppendMode;
 		FILE* m_File;
+		CaptureIndex* m_Index;
+		uint64_t m_NextPacketOffset;
 
 		// private copy c'tor
 		PcapFileWriterDevice(const PcapFileWriterDevice& other);
@@ -320,7 +346,23 @@ namespace pcpp
 		/**
 		 * A destructor for this class
 		 */
-		~PcapFileWriterDevice() {}
+		~PcapFileWriterDevice();
+
+		/**
+		 * Enable or disable building a CaptureIndex of the file while it's written. When enabled, the index is written to the index file
+		 * next to the capture file (see CaptureIndex#getIndexFileName()) when the device is closed. In append mode the packets already in
+		 * the file are read when it's opened so the index covers the whole file. This method must be called before the file is opened
+		 * @param[in] enabled True to build the index, false to stop building it
+		 * @param[in] chunkSize The amount of packet data summarized by each chunk of the index. The default is DEFAULT_CAPTURE_INDEX_CHUNK_SIZE
+		 * @return True if the setting was changed, false if the file is already opened (in which case an error is written to log)
+		 */
+		bool setIndexEnabled(bool enabled, uint64_t chunkSize = DEFAULT_CAPTURE_INDEX_CHUNK_SIZE);
+
+		/**
+		 * @return The index of the file, or NULL if building an index isn't enabled. The index is complete once the device is closed and
+		 * is kept until the file is opened again
+		 */
+		const CaptureIndex* getIndex() const { return m_Index; }
 
 		/**
 		 * Write a RawPacket to the file. Before using this method please verify the file is opened using open(). This method won't change the
@@ -394,6 +436,7 @@ namespace pcpp
 		void* m_LightPcapNg;
 		int m_CompressionLevel;
 		struct bpf_program m_Bpf;
+		BpfJit m_BpfJit;
 		bool m_BpfInitialized;
 		int m_BpfLinkType;
 		std::string m_CurFilter;
@@ -495,6 +538,8 @@ namespace pcpp
 		 */
 		void getStatistics(pcap_stat& stats) const;
 
+		using IFileWriterDevice::setFilter;
+
 		/**
 		 * Set a filter for PcapNG writer device. Only packets that match the filter will be persisted
 		 * @param[in] filterAsString The filter to be set in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html)
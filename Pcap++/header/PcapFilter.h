@@ -35,6 +35,12 @@ namespace pcpp
 {
 	//Forward Declartation - used in GeneralFilter
 	class RawPacket;
+	class NativeFilterBuilder;
+	class NativeFilter;
+	class BpfJit;
+	class FilterSet;
+	class IPPrefixSet;
+	class PortSet;
 
 	/**
 	 * An enum that contains direction (source or destination)
@@ -79,6 +85,8 @@ namespace pcpp
 	{
 	protected:
 		bpf_program* m_program;
+		BpfJit* m_Jit;
+		NativeFilter* m_NativeProgram;
 		std::string m_lastProgramString;
 
 		/**
@@ -94,13 +102,49 @@ namespace pcpp
 		virtual void parseToString(std::string& result) = 0;
 
 		/**
-		* Match a raw packet with a given BPF filter.
+		* Match a raw packet with a given BPF filter. The filter is compiled once and run by BpfJit, as native code where it's supported.
+		* A filter that contains a set filter (see containsFilterSet()) is compiled into a NativeFilter instead and matched against the
+		* current content of its sets, because its BPF string may match more packets than the sets do
 		* @param[in] rawPacket A pointer to the raw packet to match the BPF filter with
 		* @return True if a raw packet matches the BPF filter or false otherwise
 		*/
-		bool matchPacketWithFilter(RawPacket* rawPacket);
+		virtual bool matchPacketWithFilter(RawPacket* rawPacket);
+
+		/**
+		 * @return True if the BPF string of this filter (see parseToString()) matches exactly the packets the filter describes. False if
+		 * it matches a superset of them, which happens when a set filter has more values than its BPF string may hold (see
+		 * IFilterWithSet). A BPF string is never a subset of the filter's packets, so it may always be used as a pre-filter
+		 */
+		virtual bool isBpfExact() { return true; }
+
+		/**
+		 * @return True if this filter is a set filter (see IFilterWithSet) or contains one. The BPF string of such a filter is a
+		 * snapshot of its sets, so matchPacketWithFilter() and the capture devices match it natively against the sets themselves
+		 */
+		virtual bool containsFilterSet() const { return false; }
+
+		/**
+		 * Write a key of the NativeFilter program this filter compiles into (see compileNative()). The key changes when the filter tree
+		 * or the parameters of its filters change, but not when values are added to or removed from a set filter, because the program
+		 * looks the sets up as they are. matchPacketWithFilter() compiles the program of a filter that contains a set filter again only
+		 * when this key changes. The default implementation writes the BPF string of the filter
+		 * @param[out] result The string the key will be written into. If the string isn't empty, its content will be overridden
+		 */
+		virtual void getNativeProgramKey(std::string& result) { parseToString(result); }
+
+		/**
+		 * A method that compiles the class instance into a NativeFilter program, so it can be matched against packets without libpcap.
+		 * Filter classes that can be evaluated natively override this method. This method is called by NativeFilter#compile() and
+		 * normally shouldn't be called directly
+		 * @param[in] builder The builder to emit the filter instructions with
+		 * @param[in] onMatch The label (see NativeFilterBuilder#Label) the program should jump to if the packet matches this filter
+		 * @param[in] onMismatch The label the program should jump to if the packet doesn't match this filter
+		 * @return True if the filter was compiled successfully, false otherwise. The default implementation writes an error to log
+		 * and returns false
+		 */
+		virtual bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
 
-		GeneralFilter() : m_program(NULL) {}
+		GeneralFilter() : m_program(NULL), m_Jit(NULL), m_NativeProgram(NULL) {}
 
 		/**
 		 * Virtual destructor, frees the bpf program
@@ -182,6 +226,81 @@ namespace pcpp
 	};
 
 
+	/**
+	 * @class IFilterWithSet
+	 * An abstract class that is the base class for all filters which match a field against a set of values: IPSetFilter, SubnetSetFilter
+	 * and PortSetFilter. This class cannot be instantiated<BR>
+	 * The set is looked up natively in a hash table or a bitmap (see FilterSet.h) when the filter is compiled with NativeFilter, so
+	 * matching costs the same for 10 or 100,000 values, and the set may be changed while a compiled program matches packets in other
+	 * threads. In BPF form (see parseToString()) every value becomes a term of a long "or" expression, which is evaluated linearly and
+	 * which libpcap and the kernel can't compile beyond a few thousands of terms. So values are first merged into fewer terms
+	 * without changing the matched packets (adjacent addresses into subnets, adjacent ports into port ranges), and if there are still
+	 * more terms than getMaxBpfTerms() they're merged into wider terms that match a superset of the packets (see isBpfExact()). Such a
+	 * BPF filter is meant to be used as a coarse kernel-side pre-filter, with the exact match done natively in user-space. This is what
+	 * matchPacketWithFilter() and the capture devices (see IPcapDevice#setFilter()) do with any filter that contains a set filter, so
+	 * they match exactly the packets of the set, and a value removed from the set stops matching right away. A live device's pre-filter
+	 * is compiled when the filter is set though, so a value added to the set is received only if the pre-filter already lets it through,
+	 * set the filter again to update it. Devices that would run the pre-filter in user-space anyway (file devices and DpdkDevice) match
+	 * only natively, so added values are received right away too. The BPF string is cached until the set changes.<BR>
+	 * For deeper understanding of the filter concept please refer to PcapFilter.h
+	 */
+	class IFilterWithSet : public IFilterWithDirection
+	{
+	private:
+		size_t m_MaxBpfTerms;
+		std::string m_CachedBpfString;
+		bool m_CachedBpfStringValid;
+		bool m_CachedBpfStringExact;
+		uint32_t m_CachedSetVersion;
+		size_t m_CachedMaxBpfTerms;
+		Direction m_CachedDirection;
+		Direction m_NativeProgramDirection;
+
+		void updateBpfString();
+	protected:
+		IFilterWithSet(Direction dir);
+
+		// the set the filter matches against
+		virtual const FilterSet* getFilterSet() const = 0;
+
+		// build the BPF string of the set, limited to getMaxBpfTerms() terms. Returns false if the terms were merged into a superset
+		virtual bool buildBpfString(std::string& result) const = 0;
+	public:
+		/**
+		 * The default maximum number of terms in the BPF string of a set filter
+		 */
+		static const size_t DefaultMaxBpfTerms = 512;
+
+		/**
+		 * Set the maximum number of terms in the BPF string of the filter
+		 * @param[in] maxBpfTerms The maximum number of terms, or 0 for no limit, in which case the BPF string always matches
+		 * exactly the same packets as the native filter
+		 */
+		void setMaxBpfTerms(size_t maxBpfTerms) { m_MaxBpfTerms = maxBpfTerms; }
+
+		/**
+		 * @return The maximum number of terms in the BPF string of the filter, 0 means there is no limit
+		 */
+		size_t getMaxBpfTerms() const { return m_MaxBpfTerms; }
+
+		void parseToString(std::string& result);
+
+		/**
+		 * Match a raw packet against the current content of the set. The filter is compiled into a NativeFilter once, which shares the
+		 * set with this filter, so neither the BPF string nor the program are rebuilt when the set changes
+		 * @param[in] rawPacket A pointer to the raw packet to match
+		 * @return True if the packet matches the filter
+		 */
+		bool matchPacketWithFilter(RawPacket* rawPacket);
+
+		bool isBpfExact();
+
+		bool containsFilterSet() const { return true; }
+
+		void getNativeProgramKey(std::string& result);
+	};
+
+
 
 	/**
 	 * @class IPFilter
@@ -230,6 +349,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the IPv4 address
 		 * @param[in] ipAddress The IPv4 address to build the filter with. If this address is not a valid IPv4 address an error will be
@@ -252,6 +373,173 @@ namespace pcpp
 
 
 
+	/**
+	 * @class IPSetFilter
+	 * A class for filtering IPv4 and IPv6 traffic by a set of addresses, equivalent to "ip and (src host x.x.x.x or src host y.y.y.y or ...)"
+	 * but matched natively with a single hash lookup per address, see IFilterWithSet. The set may hold any number of addresses and may
+	 * be changed at any time, including while a NativeFilter compiled from this filter matches packets in other threads<BR>
+	 * For deeper understanding of the filter concept please refer to PcapFilter.h
+	 */
+	class IPSetFilter : public IFilterWithSet
+	{
+	private:
+		IPPrefixSet* m_Set;
+
+		// the set is shared with compiled programs, copying the filter isn't allowed
+		IPSetFilter(const IPSetFilter& other);
+		IPSetFilter& operator=(const IPSetFilter& other);
+
+		const FilterSet* getFilterSet() const;
+		bool buildBpfString(std::string& result) const;
+	public:
+		/**
+		 * A constructor that creates a filter with an empty set of addresses, which doesn't match any packet
+		 * @param[in] dir The address direction to filter (source or destination)
+		 */
+		IPSetFilter(Direction dir);
+
+		/**
+		 * A constructor that creates the filter from a list of addresses
+		 * @param[in] ipAddresses The IPv4 and IPv6 addresses to build the filter with. If one of them isn't a valid address an error is
+		 * written to log and the set is left empty
+		 * @param[in] dir The address direction to filter (source or destination)
+		 */
+		IPSetFilter(const std::vector<std::string>& ipAddresses, Direction dir);
+
+		/**
+		 * A d'tor for this class. The set is freed once no NativeFilter program uses it
+		 */
+		~IPSetFilter();
+
+		/**
+		 * Add an address to the set
+		 * @param[in] ipAddress The IPv4 or IPv6 address to add
+		 * @return True if the address was added or is already in the set, false if it isn't a valid address
+		 */
+		bool addAddress(const std::string& ipAddress);
+
+		/**
+		 * Remove an address from the set
+		 * @param[in] ipAddress The IPv4 or IPv6 address to remove
+		 * @return True if the address was removed, false if it isn't a valid address or isn't in the set
+		 */
+		bool removeAddress(const std::string& ipAddress);
+
+		/**
+		 * Replace the whole set. Threads matching packets with a NativeFilter compiled from this filter see either the old set or the
+		 * new one, never a mix of the two
+		 * @param[in] ipAddresses The new IPv4 and IPv6 addresses
+		 * @return True if the set was replaced, false if one of the addresses isn't valid, in which case an error is written to log and
+		 * the set isn't changed
+		 */
+		bool setAddresses(const std::vector<std::string>& ipAddresses);
+
+		/**
+		 * Remove all the addresses from the set
+		 */
+		void clearAddresses();
+
+		/**
+		 * @return The number of addresses in the set
+		 */
+		size_t getNumOfAddresses() const;
+
+		/**
+		 * Check whether an address is in the set
+		 * @param[in] ipAddress The address to look up
+		 * @return True if the address is in the set
+		 */
+		bool containsAddress(const IPAddress& ipAddress) const;
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+	};
+
+
+
+	/**
+	 * @class SubnetSetFilter
+	 * A class for filtering IPv4 and IPv6 traffic by a set of subnets, equivalent to "ip and (src net 10.0.0.0/8 or src net 1.2.3.0/24 or ...)"
+	 * but matched natively with a hash lookup per distinct prefix length in the set, see IPPrefixSet and IFilterWithSet. Subnets may
+	 * overlap, a packet matches if its address is in any of them. The set may be changed at any time, including while a NativeFilter
+	 * compiled from this filter matches packets in other threads<BR>
+	 * For deeper understanding of the filter concept please refer to PcapFilter.h
+	 */
+	class SubnetSetFilter : public IFilterWithSet
+	{
+	private:
+		IPPrefixSet* m_Set;
+
+		// the set is shared with compiled programs, copying the filter isn't allowed
+		SubnetSetFilter(const SubnetSetFilter& other);
+		SubnetSetFilter& operator=(const SubnetSetFilter& other);
+
+		const FilterSet* getFilterSet() const;
+		bool buildBpfString(std::string& result) const;
+	public:
+		/**
+		 * A constructor that creates a filter with an empty set of subnets, which doesn't match any packet
+		 * @param[in] dir The address direction to filter (source or destination)
+		 */
+		SubnetSetFilter(Direction dir);
+
+		/**
+		 * A constructor that creates the filter from a list of subnets
+		 * @param[in] subnets The IPv4 and IPv6 subnets to build the filter with, for example "10.0.0.0/8" or "2001:db8::/32". An address
+		 * without a prefix length is a single host. If one of them isn't valid an error is written to log and the set is left empty
+		 * @param[in] dir The address direction to filter (source or destination)
+		 */
+		SubnetSetFilter(const std::vector<std::string>& subnets, Direction dir);
+
+		/**
+		 * A d'tor for this class. The set is freed once no NativeFilter program uses it
+		 */
+		~SubnetSetFilter();
+
+		/**
+		 * Add a subnet to the set
+		 * @param[in] subnet The subnet to add, for example "10.0.0.0/8". The address bits beyond the prefix length are ignored
+		 * @return True if the subnet was added or is already in the set, false if it isn't valid
+		 */
+		bool addSubnet(const std::string& subnet);
+
+		/**
+		 * Remove a subnet from the set. Only the exact subnet is removed, other subnets it overlaps with aren't changed
+		 * @param[in] subnet The subnet to remove
+		 * @return True if the subnet was removed, false if it isn't valid or isn't in the set
+		 */
+		bool removeSubnet(const std::string& subnet);
+
+		/**
+		 * Replace the whole set. Threads matching packets with a NativeFilter compiled from this filter see either the old set or the
+		 * new one, never a mix of the two
+		 * @param[in] subnets The new subnets
+		 * @return True if the set was replaced, false if one of the subnets isn't valid, in which case an error is written to log and
+		 * the set isn't changed
+		 */
+		bool setSubnets(const std::vector<std::string>& subnets);
+
+		/**
+		 * Remove all the subnets from the set
+		 */
+		void clearSubnets();
+
+		/**
+		 * @return The number of subnets in the set
+		 */
+		size_t getNumOfSubnets() const;
+
+		/**
+		 * Check whether an address belongs to one of the subnets in the set
+		 * @param[in] ipAddress The address to look up
+		 * @return True if the address is in one of the subnets
+		 */
+		bool containsAddress(const IPAddress& ipAddress) const;
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+	};
+
+
+
 	/**
 	 * @class IPv4IDFilter
 	 * A class for filtering IPv4 traffic by IP ID field of the IPv4 protocol, For example:
@@ -272,6 +560,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the IP ID to filter
 		 * @param[in] ipID The IP ID to filter
@@ -301,6 +591,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the total length value
 		 * @param[in] totalLength The total length value to filter
@@ -330,6 +622,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the port
 		 * @param[in] port The port to create the filter with
@@ -361,6 +655,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the lower end of the port range
 		 * @param[in] fromPort The lower end of the port range
@@ -376,6 +672,92 @@ namespace pcpp
 
 
 
+	/**
+	 * @class PortSetFilter
+	 * A class for filtering TCP or UDP traffic by a set of ports, equivalent to "dst port 80 or dst port 443 or dst portrange 8000-8080 or ..."
+	 * but matched natively with a single bit test per port, see IFilterWithSet. The set may be changed at any time, including while a
+	 * NativeFilter compiled from this filter matches packets in other threads<BR>
+	 * For deeper understanding of the filter concept please refer to PcapFilter.h
+	 */
+	class PortSetFilter : public IFilterWithSet
+	{
+	private:
+		PortSet* m_Set;
+
+		// the set is shared with compiled programs, copying the filter isn't allowed
+		PortSetFilter(const PortSetFilter& other);
+		PortSetFilter& operator=(const PortSetFilter& other);
+
+		const FilterSet* getFilterSet() const;
+		bool buildBpfString(std::string& result) const;
+	public:
+		/**
+		 * A constructor that creates a filter with an empty set of ports, which doesn't match any packet
+		 * @param[in] dir The port direction to filter (source or destination)
+		 */
+		PortSetFilter(Direction dir);
+
+		/**
+		 * A constructor that creates the filter from a list of ports
+		 * @param[in] ports The ports to build the filter with
+		 * @param[in] dir The port direction to filter (source or destination)
+		 */
+		PortSetFilter(const std::vector<uint16_t>& ports, Direction dir);
+
+		/**
+		 * A d'tor for this class. The set is freed once no NativeFilter program uses it
+		 */
+		~PortSetFilter();
+
+		/**
+		 * Add a port to the set
+		 * @param[in] port The port to add
+		 */
+		void addPort(uint16_t port);
+
+		/**
+		 * Add a range of ports to the set
+		 * @param[in] fromPort The lower end of the range
+		 * @param[in] toPort The higher end of the range
+		 */
+		void addPortRange(uint16_t fromPort, uint16_t toPort);
+
+		/**
+		 * Remove a port from the set
+		 * @param[in] port The port to remove
+		 * @return True if the port was removed, false if it isn't in the set
+		 */
+		bool removePort(uint16_t port);
+
+		/**
+		 * Replace the whole set. Threads matching packets with a NativeFilter compiled from this filter see either the old set or the
+		 * new one, never a mix of the two
+		 * @param[in] ports The new ports
+		 */
+		void setPorts(const std::vector<uint16_t>& ports);
+
+		/**
+		 * Remove all the ports from the set
+		 */
+		void clearPorts();
+
+		/**
+		 * @return The number of ports in the set
+		 */
+		size_t getNumOfPorts() const;
+
+		/**
+		 * Check whether a port is in the set
+		 * @param[in] port The port to look up
+		 * @return True if the port is in the set
+		 */
+		bool containsPort(uint16_t port) const;
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+	};
+
+
+
 	/**
 	 * @class MacAddressFilter
 	 * A class for filtering Ethernet traffic by MAC addresses, for example: "ether src 12:34:56:78:90:12" or "ether dst "10:29:38:47:56:10:29"<BR>
@@ -395,6 +777,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the MAC address
 		 * @param[in] address The MAC address to use for filtering
@@ -423,6 +807,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the EtherType value
 		 * @param[in] etherType The EtherType value to create the filter with
@@ -470,6 +856,14 @@ namespace pcpp
 		void setFilters(std::vector<GeneralFilter*>& filters);
 
 		void parseToString(std::string& result);
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
+		bool isBpfExact();
+
+		bool containsFilterSet() const;
+
+		void getNativeProgramKey(std::string& result);
 	};
 
 
@@ -506,13 +900,23 @@ namespace pcpp
 		void addFilter(GeneralFilter* filter) { m_FilterList.push_back(filter); }
 
 		void parseToString(std::string& result);
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
+		bool isBpfExact();
+
+		bool containsFilterSet() const;
+
+		void getNativeProgramKey(std::string& result);
 	};
 
 
 
 	/**
 	 * @class NotFilter
-	 * A class for creating a filter which is inverse to another filter<BR>
+	 * A class for creating a filter which is inverse to another filter. If the BPF string of the other filter matches a superset of its
+	 * packets (see isBpfExact()), its inverse would miss packets this filter matches, so the BPF string of this filter matches all
+	 * packets instead<BR>
 	 * For deeper understanding of the filter concept please refer to PcapFilter.h
 	 */
 	class NotFilter : public GeneralFilter
@@ -528,6 +932,14 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
+		bool isBpfExact();
+
+		bool containsFilterSet() const;
+
+		void getNativeProgramKey(std::string& result);
+
 		/**
 		 * Set a filter to create an inverse filter from
 		 * @param[in] filterToInverse A pointer to filter which the created filter be the inverse of
@@ -558,6 +970,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the protocol to filter with
 		 * @param[in] proto The protocol to filter, only packets matching this protocol will be received. Please note not all protocols are
@@ -587,6 +1001,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the ARP opcode
 		 * @param[in] opCode The ARP opcode: ::ARP_REQUEST or ::ARP_REPLY
@@ -615,6 +1031,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set the VLAN ID of the filter
 		 * @param[in] vlanId The VLAN ID to use for the filter
@@ -684,6 +1102,8 @@ namespace pcpp
 		void setTcpFlagsBitMask(uint8_t tcpFlagBitMask, MatchOptions matchOption) { m_TcpFlagsBitMask = tcpFlagBitMask; m_MatchOption = matchOption; }
 
 		void parseToString(std::string& result);
+
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
 	};
 
 
@@ -708,6 +1128,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set window-size value
 		 * @param[in] windowSize The window-size value that will be used in the filter
@@ -737,6 +1159,8 @@ namespace pcpp
 
 		void parseToString(std::string& result);
 
+		bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const;
+
 		/**
 		 * Set legnth value
 		 * @param[in] legnth The legnth value that will be used in the filter
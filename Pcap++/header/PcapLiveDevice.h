@@ -40,6 +40,30 @@ namespace pcpp
 	typedef bool (*OnPacketArrivesStopBlocking)(RawPacket* pPacket, PcapLiveDevice* pDevice, void* userData);
 
 
+	/**
+	 * @typedef OnPacketsArriveCallback
+	 * A callback that is called when a burst of packets is captured by PcapLiveDevice in burst mode
+	 * (see PcapLiveDevice#startCaptureBurstMode())
+	 * @param[in] packets An array of the raw packets captured in this burst. The array and the packet data it points to are owned by
+	 * the device and are reused for the next burst, so the user must not free them or keep pointers to them after the callback returns
+	 * @param[in] numOfPackets The number of packets in the array
+	 * @param[in] pDevice A pointer to the PcapLiveDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing stared
+	 */
+	typedef void (*OnPacketsArriveCallback)(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* pDevice, void* userCookie);
+
+	/**
+	 * @typedef OnWorkerPacketArrivesCallback
+	 * A callback that is called on a worker thread for each packet captured by PcapLiveDevice in worker mode
+	 * (see PcapLiveDevice#startCaptureWithWorkers())
+	 * @param[in] pPacket A pointer to the raw packet. The packet data is owned by the worker's ring and is reused once the callback returns
+	 * @param[in] workerId The ID of the worker thread running the callback (a value between 0 and the number of workers minus 1)
+	 * @param[in] pDevice A pointer to the PcapLiveDevice instance
+	 * @param[in] userCookie A pointer to the object put by the user when packet capturing stared
+	 */
+	typedef void (*OnWorkerPacketArrivesCallback)(RawPacket* pPacket, uint8_t workerId, PcapLiveDevice* pDevice, void* userCookie);
+
+
 	/**
 	 * @typedef OnStatsUpdateCallback
 	 * A callback that is called periodically for stats collection if user asked to start packet capturing with periodic stats collection
@@ -52,6 +76,8 @@ namespace pcpp
 	typedef void* (*ThreadStart)(void*);
 
 	struct PcapThread;
+	struct PcapBurstBuffer;
+	struct PcapCaptureWorker;
 
 	/**
 	 * @class PcapLiveDevice
@@ -100,9 +126,20 @@ namespace pcpp
 		OnPacketArrivesStopBlocking m_cbOnPacketArrivesBlockingMode;
 		void* m_cbOnPacketArrivesBlockingModeUserCookie;
 		int m_IntervalToUpdateStats;
+		OnPacketsArriveCallback m_cbOnPacketsArrive;
+		void* m_cbOnPacketsArriveUserCookie;
 		RawPacketVector* m_CapturedPackets;
 		bool m_CaptureCallbackMode;
+		bool m_CaptureBurstMode;
+		PcapBurstBuffer* m_BurstBuffer;
+		bool m_CaptureWorkersMode;
+		std::vector<PcapCaptureWorker*> m_CaptureWorkers;
+		OnWorkerPacketArrivesCallback m_cbOnWorkerPacketArrives;
+		void* m_cbOnWorkerPacketArrivesUserCookie;
 		LinkLayerType m_LinkType;
+		uint32_t m_SendRatePacketsPerSec;
+		uint64_t m_SendRateBitsPerSec;
+		uint64_t m_SendNextTimeNSec;
 
 		// c'tor is not public, there should be only one for every interface (created by PcapLiveDeviceList)
 		PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool calculateMacAddress, bool calculateDefaultGateway);
@@ -115,9 +152,22 @@ namespace pcpp
 		void setDefaultGateway();
 		static void* captureThreadMain(void* ptr);
 		static void* statsThreadMain(void* ptr);
+		bool passesSoftwareFilters(const uint8_t* packet, int packetLen, const timespec& timestamp);
 		static void onPacketArrives(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
 		static void onPacketArrivesNoCallback(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
 		static void onPacketArrivesBlockingMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		static void onPacketArrivesBurstMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		void flushBurst(bool onlyIfTimeoutExpired);
+		void freeBurstBuffer();
+		static void onPacketArrivesWorkersMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet);
+		static void* captureWorkerThreadMain(void* ptr);
+		void stopCaptureWorkers();
+		bool prepareSendBatch(int numOfPackets);
+		int getSendChunkSize() const;
+		void sendPacketsChunk(const uint8_t** packetsData, int* packetsLength, int numOfPackets, int firstPacketIndex);
+		int transmitPackets(const uint8_t** packetsData, const int* packetsLength, const int* packetsIndex, int numOfPackets);
+		void waitForSendRateLimit(int numOfPackets, uint64_t numOfBytes);
+		int finishSendBatch();
 		std::string printThreadId(PcapThread* id);
 		virtual ThreadStart getCaptureThreadStart();
 	public:
@@ -162,10 +212,46 @@ namespace pcpp
 		};
 
 
+		/**
+		 * The timestamp source used by libpcap/the kernel for captured packets (you can read more here:
+		 * <https://www.tcpdump.org/manpages/pcap-tstamp.7.html>). Not all platforms and NICs support all types
+		 */
+		enum TimestampType
+		{
+			/** Use the default timestamp type of the platform */
+			TimestampTypeDefault = -1,
+			/** Timestamp provided by the host on which the capture is being done */
+			TimestampTypeHost = 0,
+			/** Timestamp provided by the host, low precision but fast to obtain */
+			TimestampTypeHostLowPrec = 1,
+			/** Timestamp provided by the host, high precision but possibly expensive to obtain */
+			TimestampTypeHostHiPrec = 2,
+			/** Timestamp provided by the network adapter, synchronized with the system clock */
+			TimestampTypeAdapter = 3,
+			/** Timestamp provided by the network adapter, not synchronized with the system clock */
+			TimestampTypeAdapterUnsynced = 4
+		};
+
+
+		/**
+		 * The precision of packet timestamps delivered by libpcap
+		 */
+		enum TimestampPrecision
+		{
+			/** Timestamps with microsecond precision (the default) */
+			TimestampPrecisionMicro = 0,
+			/** Timestamps with nanosecond precision */
+			TimestampPrecisionNano = 1
+		};
+
+
 		/**
 		 * @struct DeviceConfiguration
 		 * A struct that contains user configurable parameters for opening a device. All parameters have default values so
-		 * the user isn't expected to set all parameters or understand exactly how they work
+		 * the user isn't expected to set all parameters or understand exactly how they work. These parameters drive the
+		 * pcap_create()/pcap_set_*()/pcap_activate() sequence done when the device is opened. Since the kernel or libpcap may
+		 * adjust some of them, the values that were actually granted can be retrieved after the device is opened via
+		 * PcapLiveDevice#getActualConfiguration()
 		 */
 		struct DeviceConfiguration
 		{
@@ -194,6 +280,32 @@ namespace pcpp
 			*/
 			PcapDirection direction;
 
+			/**
+			 * Set the snapshot length, meaning the maximum number of bytes captured from each packet. Any value above 0 is considered
+			 * legal, otherwise the default value of 9000 is used
+			 */
+			int snapshotLength;
+
+			/**
+			 * Set immediate mode, meaning packets are delivered as soon as they arrive instead of being buffered in the kernel until the
+			 * packet buffer timeout expires (you can read more here: <https://www.tcpdump.org/manpages/pcap_set_immediate_mode.3pcap.html>).
+			 * This parameter is only applied when PcapPlusPlus is configured with immediate mode support (libpcap >= 1.5), otherwise
+			 * it is ignored
+			 */
+			bool immediateMode;
+
+			/**
+			 * Set the timestamp source for captured packets. The default value is TimestampTypeDefault which means the platform's
+			 * default is used. If the requested type isn't supported by the device the default is used instead
+			 */
+			TimestampType timestampType;
+
+			/**
+			 * Set the precision of packet timestamps. When set to TimestampPrecisionNano the timestamps of captured RawPacket objects
+			 * have nanosecond resolution (if supported by the platform)
+			 */
+			TimestampPrecision timestampPrecision;
+
 			/**
 			 * A c'tor for this struct
 			 * @param[in] mode The mode to open the device: promiscuous or non-promiscuous. Default value is promiscuous
@@ -203,17 +315,65 @@ namespace pcpp
 			 * (varies between different OS's)
 			 * @param[in] direction Direction for capturing packtes. Default value is INOUT which means capture both incoming
 			 * and outgoing packets (not all platforms support this)
+			 * @param[in] snapshotLength The snapshot length. Default value is 0 which means use the default value of 9000
+			 * @param[in] immediateMode Whether to use immediate mode (if supported). Default value is true
+			 * @param[in] timestampType The timestamp source. Default value is TimestampTypeDefault which means use the platform's default
+			 * @param[in] timestampPrecision The timestamp precision. Default value is microsecond precision
 			 */
-			DeviceConfiguration(DeviceMode mode = Promiscuous, int packetBufferTimeoutMs = 0, int packetBufferSize = 0, PcapDirection direction = PCPP_INOUT)
+			DeviceConfiguration(DeviceMode mode = Promiscuous, int packetBufferTimeoutMs = 0, int packetBufferSize = 0, PcapDirection direction = PCPP_INOUT,
+					int snapshotLength = 0, bool immediateMode = true, TimestampType timestampType = TimestampTypeDefault,
+					TimestampPrecision timestampPrecision = TimestampPrecisionMicro)
 			{
 				this->mode = mode;
 				this->packetBufferTimeoutMs = packetBufferTimeoutMs;
 				this->packetBufferSize = packetBufferSize;
 				this->direction = direction;
+				this->snapshotLength = snapshotLength;
+				this->immediateMode = immediateMode;
+				this->timestampType = timestampType;
+				this->timestampPrecision = timestampPrecision;
 			}
 		};
 
 
+		/**
+		 * @struct CaptureWorkerStats
+		 * A container for the statistics of a single capture worker ring (see startCaptureWithWorkers())
+		 */
+		struct CaptureWorkerStats
+		{
+			/** Number of packets pushed into the worker's ring by the capture thread */
+			uint64_t enqueued;
+			/** Number of packets handed to the user callback by the worker thread */
+			uint64_t processed;
+			/** Number of packets dropped by the capture thread because the worker's ring was full */
+			uint64_t dropped;
+			/** Number of packets currently waiting in the worker's ring */
+			uint32_t occupancy;
+			/** The number of packets the worker's ring can hold */
+			uint32_t capacity;
+		};
+
+
+		/**
+		 * @struct SendPacketsResult
+		 * The detailed outcome of the last sendPackets() call (see getLastSendResult())
+		 */
+		struct SendPacketsResult
+		{
+			/** Number of packets handed to the network successfully */
+			int packetsSent;
+			/** Number of packets that weren't sent because they failed validation (zero length or larger than device MTU) */
+			int packetsInvalid;
+			/** Number of valid packets that couldn't be sent due to an error in libpcap/WinPcap/Npcap or in the OS */
+			int packetsFailed;
+			/** The index (in the input array or vector) of the first packet that wasn't sent, or -1 if all packets were sent */
+			int firstFailedIndex;
+			/** Total number of bytes sent */
+			uint64_t bytesSent;
+		};
+
+
 		/**
 		 * A destructor for this class
 		 */
@@ -372,6 +532,69 @@ namespace pcpp
 		 */
 		virtual int startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacketArrives, void* userCookie, int timeout);
 
+		/**
+		 * Start capturing packets on this network interface (device) in burst mode. Instead of invoking a callback for every packet, captured
+		 * packets are copied into a pre-allocated array of RawPacket objects which is handed to the onPacketsArrive callback once it's full
+		 * or once maxBurstTimeoutUSec microseconds have passed since the first packet of the burst was captured. This amortizes the callback
+		 * overhead over many packets and avoids any memory allocation per packet, similar to the burst callbacks of DpdkDevice and PfRingDevice.
+		 * The capture is done on a new thread created by this method, meaning all callback calls are done in a thread other than the
+		 * caller thread. Capture process will stop and this capture thread will be terminated when calling stopCapture(). Packets
+		 * remaining in a partially filled burst are delivered before the capture thread exits. This method must be called after the device
+		 * is opened (i.e the open() method was called), otherwise an error will be returned.<BR>
+		 * Please notice that the burst timeout is checked each time libpcap returns from reading the kernel buffer, so its resolution is
+		 * bound by the packet buffer timeout the device was opened with (see DeviceConfiguration#packetBufferTimeoutMs)
+		 * @param[in] onPacketsArrive A callback that is called each time a burst of packets is ready
+		 * @param[in] onPacketsArriveUserCookie A pointer to a user provided object. This object will be transferred to the onPacketsArrive
+		 * callback each time it is called
+		 * @param[in] maxBurstSize The maximum number of packets delivered in a single callback call. Must be larger than 0. Default value is 64
+		 * @param[in] maxBurstTimeoutUSec The maximum time in microseconds a captured packet may wait for its burst to fill up. A value of 0
+		 * means a burst is delivered whenever libpcap returns, even if it's not full. Default value is 1000
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - Burst size is 0
+		 * - Capture thread could not be created
+		 */
+		virtual bool startCaptureBurstMode(OnPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, uint32_t maxBurstSize = 64, uint32_t maxBurstTimeoutUSec = 1000);
+
+		/**
+		 * Start capturing packets on this network interface (device) and process them on a pool of worker threads. The capture thread
+		 * only copies each packet into a lock-free single-producer/single-consumer ring owned by one of the workers and returns to libpcap
+		 * immediately, so slow packet processing doesn't directly cause kernel drops. The worker is chosen by a software RSS hash (see ToeplitzHash)
+		 * of the packet's 5-tuple (or 2-tuple for non TCP/UDP packets) with the symmetric key, so both directions of a connection are always
+		 * processed by the same worker and flows are spread between the workers like a NIC spreads them between the same number of RX
+		 * queues. Non-IP packets are processed by worker 0. Packet buffers are pre-allocated in the rings, no memory is allocated per packet. If a worker's ring is full the packet is dropped and
+		 * counted in the worker's stats (see getCaptureWorkerStats()).<BR>
+		 * Capture process and all worker threads will stop when calling stopCapture(). Packets that are already in the rings are processed
+		 * before the worker threads exit. This method must be called after the device is opened (i.e the open() method was called),
+		 * otherwise an error will be returned.
+		 * @param[in] numOfWorkers The number of worker threads to create. Must be larger than 0
+		 * @param[in] onPacketArrives A callback that is called on a worker thread for each captured packet
+		 * @param[in] onPacketArrivesUserCookie A pointer to a user provided object. This object will be transferred to the onPacketArrives
+		 * callback each time it is called. Please notice it is shared between all worker threads
+		 * @param[in] ringSize The number of packets each worker's ring can hold. It's rounded up to the next power of 2. Default value is 1024
+		 * @return True if capture started successfully, false if (relevant log error is printed in any case):
+		 * - Capture is already running
+		 * - Device is not opened
+		 * - Number of workers or ring size is 0
+		 * - Capture thread or one of the worker threads could not be created
+		 */
+		virtual bool startCaptureWithWorkers(uint8_t numOfWorkers, OnWorkerPacketArrivesCallback onPacketArrives, void* onPacketArrivesUserCookie, uint32_t ringSize = 1024);
+
+		/**
+		 * @return The number of worker threads created by the last call to startCaptureWithWorkers(), or 0 if the device isn't capturing
+		 * in worker mode
+		 */
+		uint8_t getNumOfCaptureWorkers() const { return (uint8_t)m_CaptureWorkers.size(); }
+
+		/**
+		 * Get the ring statistics of a capture worker while capturing in worker mode (see startCaptureWithWorkers())
+		 * @param[in] workerId The worker ID (a value between 0 and getNumOfCaptureWorkers() minus 1)
+		 * @param[out] stats The stats struct where stats are returned
+		 * @return True if stats were retrieved successfully, false if the device isn't capturing in worker mode or the worker ID is invalid
+		 */
+		bool getCaptureWorkerStats(uint8_t workerId, CaptureWorkerStats& stats) const;
+
 		/**
 		 * Stop a currently running packet capture. This method terminates gracefully both packet capture thread and periodic stats collection
 		 * thread (both if exist)
@@ -421,6 +644,9 @@ namespace pcpp
 
 		/**
 		 * Send an array of RawPacket objects to the network
+		 * Packets are validated in one pass and sent in batches (using sendmmsg() on Linux where available, pcap_inject() otherwise).
+		 * A packet that can't be sent doesn't stop the rest of the batch, use getLastSendResult() for details on partial failures.
+		 * The rate limit set in setSendRateLimit() is applied
 		 * @param[in] rawPacketsArr The array of RawPacket objects to send. This method treats all packets as read-only, it doesn't change anything
 		 * in them
 		 * @param[in] arrLength The length of the array
@@ -434,6 +660,7 @@ namespace pcpp
 
 		/**
 		 * Send an array of pointers to Packet objects to the network
+		 * @see sendPackets(RawPacket*, int) for how packets are batched and rate limited
 		 * @param[in] packetsArr The array of pointers to Packet objects to send. This method treats all packets as read-only, it doesn't change
 		 * anything in them
 		 * @param[in] arrLength The length of the array
@@ -447,6 +674,7 @@ namespace pcpp
 
 		/**
 		 * Send a vector of pointers to RawPacket objects to the network
+		 * @see sendPackets(RawPacket*, int) for how packets are batched and rate limited
 		 * @param[in] rawPackets The array of pointers to RawPacket objects to send. This method treats all packets as read-only, it doesn't change
 		 * anything in them
 		 * @return The number of packets sent successfully. Sending a packet can fail if:
@@ -457,6 +685,23 @@ namespace pcpp
 		 */
 		virtual int sendPackets(const RawPacketVector& rawPackets);
 
+		/**
+		 * Get the detailed outcome of the last sendPackets() call: how many packets were sent, how many failed validation, how many were
+		 * rejected by libpcap/WinPcap/Npcap or the OS and the index of the first packet that wasn't sent
+		 * @return A reference to the result of the last sendPackets() call
+		 */
+		const SendPacketsResult& getLastSendResult() const { return m_LastSendResult; }
+
+		/**
+		 * Limit the rate in which sendPackets() puts packets on the wire. Packets are paced in small bursts (roughly 1ms worth of traffic
+		 * each) and the pacing carries over between consecutive sendPackets() calls, so a capture replayed in many calls keeps the
+		 * configured rate. Idle time between calls isn't accumulated as credit. sendPacket() isn't rate limited
+		 * @param[in] maxPacketsPerSec Maximum number of packets per second. A value of 0 means no packet rate limit
+		 * @param[in] maxBitsPerSec Maximum number of bits per second, counting only the packet data (without preamble, FCS and
+		 * inter-frame gap). A value of 0 (the default) means no bit rate limit
+		 */
+		void setSendRateLimit(uint32_t maxPacketsPerSec, uint64_t maxBitsPerSec = 0);
+
 
 		// implement abstract methods
 
@@ -481,8 +726,20 @@ namespace pcpp
 
 		virtual void getStatistics(pcap_stat& stats) const;
 
+		/**
+		 * @return The configuration that was actually granted by libpcap and the kernel when the device was last opened. The snapshot length,
+		 * timestamp type and precision, immediate mode and capture direction reflect what was applied to the device (for example: the
+		 * timestamp precision falls back to microseconds if nanoseconds aren't supported). The packet buffer size and timeout can't be
+		 * queried from libpcap so they hold the values that were successfully set. If the device was never opened the default
+		 * configuration is returned
+		 */
+		const DeviceConfiguration& getActualConfiguration() const { return m_ActualConfiguration; }
+
 	protected:
-		pcap_t* doOpen(const DeviceConfiguration& config);
+		DeviceConfiguration m_ActualConfiguration;
+		SendPacketsResult m_LastSendResult;
+
+		pcap_t* doOpen(const DeviceConfiguration& config, DeviceConfiguration* actualConfig = NULL);
 	};
 
 } // namespace pcpp
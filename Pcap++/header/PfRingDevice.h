@@ -61,7 +61,7 @@ namespace pcpp
 
 		PfRingDevice(const char* deviceName);
 
-		bool initCoreConfigurationByCoreMask(CoreMask coreMask);
+		bool initCoreConfigurationByCoreMask(const CoreMask& coreMask);
 		static void* captureThreadMain(void *ptr);
 
 		int openSingleRxChannel(const char* deviceName, pfring** ring);
@@ -155,10 +155,11 @@ namespace pcpp
 		 * requested
 		 * @param[in] onPacketsArrive A callback to call whenever a packet arrives
 		 * @param[in] onPacketsArriveUserCookie A cookie that will be delivered to onPacketsArrive callback on every packet
-		 * @param[in] coreMask The cores to be used as mask. For example:
+		 * @param[in] coreMask The cores to be used as mask. For example: to use cores 1 and 2 the core mask should be 6 (binary: 110).
+		 * Cores above 63 can be added using CoreMask#addCore()
 		 * @return True if this action succeeds, false otherwise
 		 */
-		bool startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask);
+		bool startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, const CoreMask& coreMask);
 
 		/**
 		 * Stops capturing packets (works will all type of startCapture*)
@@ -5,6 +5,8 @@
 
 #include "IpAddress.h"
 #include "Device.h"
+#include "PacketSampler.h"
+#include "NativeFilter.h"
 
 /**
 * \namespace pcpp
@@ -31,13 +33,15 @@ namespace pcpp
 	 *  - Linux doesn't require binding to a specific network interface for receiving packets, but it does require binding
 	 *    for sending packets. Windows requires binding for receiving packets. For the sake of keeping a unified and simple cross-platform interface
 	 *    this class requires binding for both Linux and Windows, on both send and receive
+	 *  - On Linux a filter can be set on the socket (see setFilter()). It's compiled to classic BPF and run by the kernel, so packets
+	 *    that don't match it are dropped before they are copied to user space. Filters aren't supported on Windows
 	 *
 	 * More details about opening the raw socket, receiving and sending packets are explained in the corresponding class methods.
 	 * Raw sockets are supported for both IPv4 and IPv6, so you can create and bind raw sockets to each of the two.
 	 * Also, there is no limit on the number of sockets opened for a specific IP address or network interface, so you can
 	 * create multiple instances of this class and bind all of them to the same interface and IP address.
 	 */
-	class RawSocketDevice : public IDevice
+	class RawSocketDevice : public IDevice, public IFilterableDevice
 	{
 	public:
 
@@ -130,6 +134,20 @@ namespace pcpp
 		 */
 		int sendPackets(const RawPacketVector& packetVec);
 
+		/**
+		 * Set a packet sampler for the device. The sampler is applied on the received data before it is copied into the RawPacket,
+		 * packets that aren't selected are dropped and receivePacket() waits for the next packet until its timeout expires.
+		 * This method should be called before receiving starts
+		 * @param[in] sampler The sampler to set. Setting a default constructed PacketSampler disables sampling
+		 */
+		void setPacketSampler(const PacketSampler& sampler) { m_PacketSampler = sampler; }
+
+		/**
+		 * @return The packet sampler currently set on the device, which can be used to retrieve the sample rate and the number of
+		 * packets seen and sampled
+		 */
+		const PacketSampler& getPacketSampler() const { return m_PacketSampler; }
+
 		// overridden methods
 
 		/**
@@ -143,6 +161,37 @@ namespace pcpp
 		 */
 		virtual void close();
 
+		/**
+		 * Set a filter on the raw socket. The filter is converted to a BPF string and attached to the socket (see
+		 * setFilter(std::string)). If the filter contains a filter set (IPSetFilter, SubnetSetFilter or PortSetFilter) the BPF
+		 * string may match more packets than the filter (see IFilterWithSet#setMaxBpfTerms()), so the filter is also compiled to a
+		 * NativeFilter which every packet that passes the kernel is matched against in receivePacket(). Since the NativeFilter
+		 * shares the sets with the filter, removals from the sets take effect immediately. This method is supported on Linux only
+		 * @param[in] filter The filter to be set in PcapPlusPlus' GeneralFilter format
+		 * @return True if the filter was set, false otherwise (an error is written to log)
+		 */
+		virtual bool setFilter(GeneralFilter& filter);
+
+		/**
+		 * Set a filter on the raw socket. The filter is compiled to classic BPF and attached to the socket (using SO_ATTACH_FILTER), so
+		 * the kernel drops packets that don't match it before they are copied to user space. Packets that were already queued on the
+		 * socket when the filter is set are discarded, so all packets received afterwards match the filter. This method is supported on
+		 * Linux only. Please note that when the device is closed the filter is removed, so it should be set again after reopening the
+		 * device
+		 * @param[in] filterAsString The filter in Berkeley Packet Filter (BPF) syntax (http://biot.com/capstats/bpf.html). Since the socket
+		 * receives Ethernet frames the filter is compiled for Ethernet
+		 * @return True if the filter was set, false if the device isn't opened, the filter can't be compiled, the kernel rejects it or
+		 * the platform isn't Linux (in all cases an error is written to log)
+		 */
+		virtual bool setFilter(std::string filterAsString);
+
+		/**
+		 * Remove the filter set on the raw socket
+		 * @return True if the filter was removed or no filter was set, false if the device isn't opened or the filter couldn't be
+		 * removed (in which case an error is written to log)
+		 */
+		virtual bool clearFilter();
+
 	private:
 
 		enum SocketFamily
@@ -155,6 +204,9 @@ namespace pcpp
 		SocketFamily m_SockFamily;
 		void* m_Socket;
 		IPAddress* m_InterfaceIP;
+		PacketSampler m_PacketSampler;
+		// exact user-space match of the last GeneralFilter set, compiled only if it contains a filter set
+		NativeFilter m_PostFilter;
 
 		RecvPacketResult getError(int& errorCode) const;
 
@@ -0,0 +1,275 @@
+#ifndef PCAPPP_STATEFUL_FILTER
+#define PCAPPP_STATEFUL_FILTER
+
+#include "FlowKey.h"
+#include "NativeFilter.h"
+#include "BpfJit.h"
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @file
+ * This file provides StatefulFilter, a filter that decides once per flow instead of once per packet: when a flow is accepted all its
+ * packets pass, in both directions, including the packets that don't match the filter by themselves (for example a connection whose
+ * first packet matched "dst port 443", or a flow whose first payload contains a signature)
+ */
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class StatefulFilter
+	 * A flow-aware filter which latches a verdict per flow. Flows are identified by the canonical FlowKey (5-tuple and VLAN ID) extracted
+	 * by FlowKey#fromRawData(), so both directions of a connection share the same flow. The verdict of a flow is decided by one of:
+	 * - A flow filter - a GeneralFilter tree (compiled into a NativeFilter) or a BPF string (run by BpfJit). A flow is accepted
+	 *   once one of its packets matches the filter
+	 * - A flow classifier - a user callback which is invoked on the packets of a flow until it accepts or rejects the flow<BR>
+	 * A flow that isn't accepted within its first N packets (see setFlowFilter()) is rejected, so the filter or classifier cost is paid
+	 * only on the first packets of each flow and the rest of the packets only cost a table lookup. Packets of undecided flows are
+	 * dropped unless setPassUndecided() is called. Packets which aren't IPv4 or IPv6 have no flow, so each one of them is decided by
+	 * itself as a flow of a single packet: it passes only if it's accepted.<BR>
+	 * IP fragments have no ports in their flow key, including the first fragment of a datagram. So all fragments between two hosts with
+	 * the same IP protocol share one portless flow and its verdict, which is separate from the verdict of the connection they belong to:
+	 * a flow filter on ports never accepts fragments, while an address-only filter accepts the fragments of all the connections
+	 * between the two hosts. Reassemble the traffic with IPReassembly before filtering if fragments must follow their connection.<BR>
+	 * Tunnels aren't followed, a tunneled packet belongs to the flow of its outer IP header (see FlowKey#fromRawData()).<BR>
+	 * Memory is bounded: the flow table holds at most the number of flows given to the c'tor. Flows that see no packet for longer than
+	 * the idle timeout expire, and when the table is full the least recently seen flow is evicted. Expiry is driven by the packet
+	 * timestamps rather than the wall clock, so reading a file gives the same result as capturing the same traffic live. A flow that
+	 * expired or was evicted is decided again from its next packet.<BR>
+	 * The filter is applied by the capture devices on the raw packet data, after the packet sampler and before any RawPacket is built,
+	 * by setting it on the device with IPcapDevice#setStatefulFilter(). It can also be used directly with matchPacket(). It keeps state,
+	 * so an instance must not be used by more than one device or thread at the same time
+	 */
+	class StatefulFilter
+	{
+	public:
+
+		/**
+		 * The verdict of a flow
+		 */
+		enum Verdict
+		{
+			/** The flow isn't decided yet */
+			Undecided = 0,
+			/** All packets of the flow pass */
+			Accept = 1,
+			/** All packets of the flow are dropped */
+			Reject = 2
+		};
+
+		/**
+		 * @typedef FlowClassifier
+		 * A callback which decides the verdict of a flow
+		 * @param[in] rawPacket A packet of an undecided flow. Its data isn't owned by the packet and is valid only until the callback
+		 * returns
+		 * @param[in] packetIndexInFlow The index of the packet in its flow, starting at 0. Packets without a flow (non-IP) always get 0
+		 * @param[in] userCookie A pointer to the object given by the user to setFlowClassifier()
+		 * @return The verdict of the flow. Returning Undecided asks for the next packet of the flow
+		 */
+		typedef Verdict (*FlowClassifier)(RawPacket& rawPacket, uint32_t packetIndexInFlow, void* userCookie);
+
+		/**
+		 * A c'tor for this class. Creates a filter that passes all packets until setFlowFilter() or setFlowClassifier() is called.
+		 * Each flow in the table takes about 90 bytes. The table grows as flows are added, so a large maximum costs memory only for
+		 * the flows actually seen
+		 * @param[in] maxNumOfFlows The maximum number of flows the flow table holds. A value of 0 is replaced by 1
+		 * @param[in] idleTimeoutSec The number of seconds without packets after which a flow expires. A value of 0 means flows never
+		 * expire and are only evicted when the table is full. The default is 60 seconds
+		 */
+		StatefulFilter(size_t maxNumOfFlows, uint32_t idleTimeoutSec = 60);
+
+		/**
+		 * Decide flows with a filter tree, which is compiled into a NativeFilter. A flow is accepted when one of its first
+		 * maxPacketsToDecide packets matches the filter and rejected otherwise. This method clears the flow table
+		 * @param[in] filter The filter tree. It may be changed or destroyed after this method returns
+		 * @param[in] maxPacketsToDecide The number of packets of a flow the filter is matched with before the flow is rejected. The
+		 * default is 1, meaning a flow is accepted only if its first packet matches. A value of 0 means the flow stays undecided until
+		 * a packet matches
+		 * @return True if the filter was compiled, false if it can't be compiled natively (in which case an error is written to log and
+		 * the previous decision method is kept). BPFStringFilter can't be compiled natively, use setFlowFilter(const std::string&, uint32_t)
+		 * for BPF strings
+		 */
+		bool setFlowFilter(const GeneralFilter& filter, uint32_t maxPacketsToDecide = 1);
+
+		/**
+		 * Decide flows with a filter in BPF syntax (http://biot.com/capstats/bpf.html). The filter is compiled by libpcap for the link
+		 * type of the packets and run by BpfJit. A flow is accepted when one of its first maxPacketsToDecide packets matches the filter
+		 * and rejected otherwise. This method clears the flow table
+		 * @param[in] filterAsString The filter in BPF syntax
+		 * @param[in] maxPacketsToDecide The number of packets of a flow the filter is matched with before the flow is rejected, see
+		 * setFlowFilter(const GeneralFilter&, uint32_t)
+		 * @return True if the filter is valid, false otherwise (in which case an error is written to log and the previous decision
+		 * method is kept)
+		 */
+		bool setFlowFilter(const std::string& filterAsString, uint32_t maxPacketsToDecide = 1);
+
+		/**
+		 * Decide flows with a user callback. The callback is invoked on the packets of each undecided flow until it returns Accept or
+		 * Reject, or until maxPacketsToDecide packets were seen in which case the flow is rejected. This method clears the flow table
+		 * @param[in] classifier The callback to invoke
+		 * @param[in] userCookie A pointer to an object that is passed to the callback
+		 * @param[in] maxPacketsToDecide The number of packets of a flow the callback is invoked on before the flow is rejected. A value of
+		 * 0 (the default) means there's no limit
+		 */
+		void setFlowClassifier(FlowClassifier classifier, void* userCookie = NULL, uint32_t maxPacketsToDecide = 0);
+
+		/**
+		 * Set whether packets of undecided flows pass. By default they are dropped, which means that with a classifier that needs
+		 * several packets the packets before the decision (for example a TCP handshake) are dropped even if the flow is accepted
+		 * @param[in] passUndecided True to pass packets of undecided flows, false to drop them
+		 */
+		void setPassUndecided(bool passUndecided) { m_PassUndecided = passUndecided; }
+
+		/**
+		 * @return True if packets of undecided flows pass
+		 */
+		bool getPassUndecided() const { return m_PassUndecided; }
+
+		/**
+		 * Decide whether a packet passes the filter. This method is called by the capture devices on the raw packet data
+		 * @param[in] packetData A pointer to the raw packet data
+		 * @param[in] packetDataLen The raw packet data length
+		 * @param[in] linkType The link layer type of the packet
+		 * @param[in] timestamp The packet timestamp, which drives the flow expiry
+		 * @return True if the packet passes, false if it should be dropped. If neither a filter nor a classifier was set all packets
+		 * pass
+		 */
+		bool matchPacket(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, const timespec& timestamp);
+
+		/**
+		 * Decide whether a raw packet passes the filter
+		 * @param[in] rawPacket A pointer to the raw packet
+		 * @return True if the packet passes, false if it should be dropped
+		 */
+		bool matchPacket(RawPacket* rawPacket);
+
+		/**
+		 * Remove all flows from the flow table and reset the statistics. The decision method is kept
+		 */
+		void clear();
+
+		/**
+		 * @return The maximum number of flows the flow table holds
+		 */
+		size_t getMaxNumOfFlows() const { return m_MaxNumOfFlows; }
+
+		/**
+		 * @return The number of seconds without packets after which a flow expires, 0 if flows never expire
+		 */
+		uint32_t getIdleTimeout() const { return m_IdleTimeoutSec; }
+
+		/**
+		 * @return The number of flows currently in the flow table
+		 */
+		size_t getNumOfFlows() const { return m_NumOfFlows; }
+
+		/**
+		 * @return The number of flows that were accepted
+		 */
+		uint64_t getNumOfAcceptedFlows() const { return m_NumOfAcceptedFlows; }
+
+		/**
+		 * @return The number of flows that were rejected
+		 */
+		uint64_t getNumOfRejectedFlows() const { return m_NumOfRejectedFlows; }
+
+		/**
+		 * @return The number of flows removed from the flow table because they were idle for longer than the idle timeout
+		 */
+		uint64_t getNumOfExpiredFlows() const { return m_NumOfExpiredFlows; }
+
+		/**
+		 * @return The number of flows removed from the flow table while they were still active because the table was full. A high
+		 * number means the table is too small for the traffic and flows are decided more than once
+		 */
+		uint64_t getNumOfEvictedFlows() const { return m_NumOfEvictedFlows; }
+
+		/**
+		 * @return The number of packets the filter was asked about
+		 */
+		uint64_t getNumOfPacketsSeen() const { return m_NumOfPacketsSeen; }
+
+		/**
+		 * @return The number of packets that passed the filter
+		 */
+		uint64_t getNumOfPacketsPassed() const { return m_NumOfPacketsPassed; }
+
+	private:
+
+		enum DecisionMethod
+		{
+			NoDecision,
+			NativeFilterDecision,
+			BpfFilterDecision,
+			ClassifierDecision
+		};
+
+		struct FlowEntry
+		{
+			// the canonical key of the flow
+			FlowKey key;
+			uint32_t hash;
+			// the next entry in the same bucket, or in the free list
+			uint32_t next;
+			// the neighbours in the LRU list, which starts at the most recently seen flow
+			uint32_t lruPrev;
+			uint32_t lruNext;
+			uint32_t numOfPackets;
+			time_t lastSeen;
+			Verdict verdict;
+		};
+
+		size_t m_MaxNumOfFlows;
+		size_t m_MaxNumOfBuckets;
+		uint32_t m_IdleTimeoutSec;
+		bool m_PassUndecided;
+
+		DecisionMethod m_DecisionMethod;
+		uint32_t m_MaxPacketsToDecide;
+		NativeFilter m_NativeFilter;
+		std::string m_BpfFilter;
+		BpfJit m_BpfJit;
+		int m_BpfLinkType;
+		FlowClassifier m_Classifier;
+		void* m_ClassifierCookie;
+
+		std::vector<FlowEntry> m_Entries;
+		std::vector<uint32_t> m_Buckets;
+		uint32_t m_FreeList;
+		uint32_t m_LruHead;
+		uint32_t m_LruTail;
+		size_t m_NumOfFlows;
+
+		uint64_t m_NumOfAcceptedFlows;
+		uint64_t m_NumOfRejectedFlows;
+		uint64_t m_NumOfExpiredFlows;
+		uint64_t m_NumOfEvictedFlows;
+		uint64_t m_NumOfPacketsSeen;
+		uint64_t m_NumOfPacketsPassed;
+
+		// the flow table holds state that can't be shared
+		StatefulFilter(const StatefulFilter& other);
+		StatefulFilter& operator=(const StatefulFilter& other);
+
+		Verdict classify(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, const timespec& timestamp, uint32_t packetIndexInFlow);
+		bool compileBpf(int linkType);
+		uint32_t findFlow(const FlowKey& key, uint32_t hash) const;
+		uint32_t addFlow(const FlowKey& key, uint32_t hash, time_t now);
+		void removeFlow(uint32_t index);
+		void unlinkLru(uint32_t index);
+		void linkLruHead(uint32_t index);
+		void growBuckets();
+		void expireIdleFlows(time_t now);
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_STATEFUL_FILTER
@@ -0,0 +1,180 @@
+#ifndef PCAPPP_TOEPLITZ_HASH
+#define PCAPPP_TOEPLITZ_HASH
+
+#include "RawPacket.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/// @file
+
+/**
+* \namespace pcpp
+* \brief The main namespace for the PcapPlusPlus lib
+*/
+namespace pcpp
+{
+
+	/**
+	 * @class ToeplitzHash
+	 * A software implementation of the Toeplitz hash used by NICs for Receive Side Scaling (RSS). It calculates the same hash values
+	 * as a NIC configured with the same key and the same hash functions, so flows can be distributed between cores in software
+	 * (libpcap, raw sockets, pcap file replay) exactly like DpdkDevice distributes them between its RX queues.<BR>
+	 * The hash input is built like the NIC builds it: source IP, destination IP, and for TCP/UDP/SCTP packets whose 4-tuple hash
+	 * function is enabled also source port and destination port, all in network byte order. The hash functions are selected by a mask
+	 * of RssHashFunction values, which are identical to DpdkDevice#DpdkRssHashFunction values so the same mask can be used for both.<BR>
+	 * The key is expanded on construction into lookup tables of 256 entries per input byte, so hashing costs a single table lookup and
+	 * XOR per input byte (12 lookups for an IPv4 4-tuple, 36 for an IPv6 4-tuple) instead of 32 operations per input bit. The object
+	 * is immutable after construction and can be shared between threads
+	 */
+	class ToeplitzHash
+	{
+	public:
+
+		/**
+		 * The RSS hash functions supported by the software hash. The values are identical to the matching DpdkDevice#DpdkRssHashFunction
+		 * values
+		 */
+		enum RssHashFunction
+		{
+			/** IPv4 based flow: source and destination IP of every IPv4 packet not covered by a more specific hash function */
+			RSS_IPV4				= 0x1,
+			/** Fragmented IPv4 based flow */
+			RSS_FRAG_IPV4			= 0x2,
+			/** Non-fragmented IPv4 + TCP flow */
+			RSS_NONFRAG_IPV4_TCP	= 0x4,
+			/** Non-fragmented IPv4 + UDP flow */
+			RSS_NONFRAG_IPV4_UDP	= 0x8,
+			/** Non-fragmented IPv4 + SCTP flow */
+			RSS_NONFRAG_IPV4_SCTP	= 0x10,
+			/** Non-fragmented IPv4 + non TCP/UDP/SCTP flow */
+			RSS_NONFRAG_IPV4_OTHER	= 0x20,
+			/** IPv6 based flow: source and destination IP of every IPv6 packet not covered by a more specific hash function */
+			RSS_IPV6				= 0x40,
+			/** Fragmented IPv6 based flow */
+			RSS_FRAG_IPV6			= 0x80,
+			/** Non-fragmented IPv6 + TCP flow */
+			RSS_NONFRAG_IPV6_TCP	= 0x100,
+			/** Non-fragmented IPv6 + UDP flow */
+			RSS_NONFRAG_IPV6_UDP	= 0x200,
+			/** Non-fragmented IPv6 + SCTP flow */
+			RSS_NONFRAG_IPV6_SCTP	= 0x400,
+			/** Non-fragmented IPv6 + non TCP/UDP/SCTP flow */
+			RSS_NONFRAG_IPV6_OTHER	= 0x800
+		};
+
+		/**
+		 * The size in bytes of StandardKey and SymmetricKey
+		 */
+		static const size_t DefaultKeyLength = 40;
+
+		/**
+		 * The well-known RSS key from Microsoft RSS specification, which is the default key of many NICs. Hash values calculated with
+		 * this key are different for the two directions of a flow
+		 */
+		static const uint8_t StandardKey[DefaultKeyLength];
+
+		/**
+		 * A key of repeating 0x6D5A bytes, which makes the hash symmetric: both directions of a flow get the same hash value (and are
+		 * therefore directed to the same queue). This is the key DpdkDevice configures by default
+		 */
+		static const uint8_t SymmetricKey[DefaultKeyLength];
+
+		/**
+		 * A c'tor for this class. Expands the key into the lookup tables
+		 * @param[in] key The RSS key. The default is SymmetricKey
+		 * @param[in] keyLength The key length in bytes. The longest input that can be hashed is keyLength - 4 bytes, so a 40 byte key
+		 * (which most NICs use) covers the IPv6 4-tuple. Keys shorter than 8 bytes are replaced with SymmetricKey. The default is 40
+		 * @param[in] rssHashFunctions A mask of RssHashFunction values (or DpdkDevice#DpdkRssHashFunction values) that determines
+		 * which packets are hashed and which fields are used. The default is RSS_IPV4 | RSS_IPV6 which is DpdkDevice default
+		 */
+		ToeplitzHash(const uint8_t* key = SymmetricKey, size_t keyLength = DefaultKeyLength, uint64_t rssHashFunctions = RSS_IPV4 | RSS_IPV6);
+
+		/**
+		 * @return The RSS key used by this object
+		 */
+		const std::vector<uint8_t>& getKey() const { return m_Key; }
+
+		/**
+		 * @return The mask of RSS hash functions used by this object
+		 */
+		uint64_t getRssHashFunctions() const { return m_RssHashFunctions; }
+
+		/**
+		 * @return The maximum input length in bytes this object can hash (the key length minus 4)
+		 */
+		size_t getMaxInputLength() const { return m_MaxInputLength; }
+
+		/**
+		 * Calculate the Toeplitz hash of an arbitrary input
+		 * @param[in] input The input bytes
+		 * @param[in] inputLength The input length. Bytes beyond getMaxInputLength() are ignored
+		 * @return The hash value
+		 */
+		uint32_t hash(const uint8_t* input, size_t inputLength) const
+		{
+			return hashBytes(input, (inputLength > m_MaxInputLength ? m_MaxInputLength : inputLength), 0);
+		}
+
+		/**
+		 * Calculate the RSS hash of a packet the way a NIC configured with the same key and hash functions calculates it.
+		 * The headers are found by parseRawPacketHeaders(), which lists the supported link types and the skipped VLAN tags and IPv6
+		 * extension headers
+		 * @param[in] packetData A pointer to the raw packet data
+		 * @param[in] packetDataLen The raw packet data length
+		 * @param[in] linkType The link layer type of the packet
+		 * @param[out] hash The calculated hash. Set to 0 if the packet isn't hashed
+		 * @return True if the packet was hashed, false if it's not an IPv4/IPv6 packet, if it's malformed or if none of the enabled
+		 * hash functions applies to it (a NIC directs such packets to queue 0)
+		 */
+		bool calculateHash(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, uint32_t& hash) const;
+
+		/**
+		 * Calculate the RSS hash of a raw packet. See calculateHash(const uint8_t*, int, LinkLayerType, uint32_t&) const
+		 * @param[in] rawPacket The raw packet to hash
+		 * @param[out] hash The calculated hash. Set to 0 if the packet isn't hashed
+		 * @return True if the packet was hashed, false otherwise
+		 */
+		bool calculateHash(const RawPacket* rawPacket, uint32_t& hash) const
+		{
+			return calculateHash(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), hash);
+		}
+
+		/**
+		 * Map a hash value to a queue (or a core, or a worker) the way a NIC does with its default redirection table, which is filled
+		 * with the queue indices in a round-robin manner
+		 * @param[in] hash The hash value
+		 * @param[in] numOfQueues The number of queues. A value of 0 is treated as 1
+		 * @param[in] retaSize The size of the NIC redirection table, must be a power of 2. The default is 128 which is the size used
+		 * by most Intel NICs. A value of 0 means no redirection table, in which case the hash is mapped by modulo
+		 * @return The queue index, between 0 and numOfQueues - 1
+		 */
+		static uint16_t getQueueForHash(uint32_t hash, uint16_t numOfQueues, uint32_t retaSize = 128)
+		{
+			if (numOfQueues <= 1)
+				return 0;
+			if (retaSize > 0)
+				hash &= (retaSize - 1);
+			return (uint16_t)(hash % numOfQueues);
+		}
+
+	private:
+		std::vector<uint8_t> m_Key;
+		std::vector<uint32_t> m_Table;
+		size_t m_MaxInputLength;
+		uint64_t m_RssHashFunctions;
+
+		// hash input bytes placed at a given position of the hash input
+		inline uint32_t hashBytes(const uint8_t* data, size_t len, size_t position) const
+		{
+			const uint32_t* table = &m_Table[position * 256];
+			uint32_t result = 0;
+			for (size_t i = 0; i < len; i++, table += 256)
+				result ^= table[data[i]];
+			return result;
+		}
+	};
+
+} // namespace pcpp
+
+#endif // PCAPPP_TOEPLITZ_HASH
@@ -0,0 +1,867 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "BpfJit.h"
+#include "Logger.h"
+#include <string.h>
+#if defined(WIN32) || defined(WINx64)
+#include <winsock2.h>
+#endif
+#include <pcap.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PCPP_BPF_JIT_X86_64
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+// older libpcap versions don't define these
+#ifndef BPF_MOD
+#define BPF_MOD 0x90
+#endif
+#ifndef BPF_XOR
+#define BPF_XOR 0xa0
+#endif
+#ifndef BPF_MEMWORDS
+#define BPF_MEMWORDS 16
+#endif
+#ifndef BPF_MAXINSNS
+#define BPF_MAXINSNS 4096
+#endif
+
+#ifndef BPF_A
+#define BPF_A 0x10
+#endif
+
+namespace pcpp
+{
+
+namespace
+{
+
+inline uint32_t loadWord(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+inline uint32_t loadHalf(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 8) | data[1];
+}
+
+inline bool isInBounds(uint32_t offset, uint32_t size, uint32_t capturedLen)
+{
+	return (uint64_t)offset + size <= capturedLen;
+}
+
+#ifdef PCPP_BPF_JIT_X86_64
+
+/**
+ * Emits x86-64 machine code for a BPF program. The BPF registers are kept in machine registers for the whole program:
+ * A in eax, X in ecx, the packet data pointer in rdi, the captured length in rsi and the wire length in r9. r8, r10, r11 and edx are
+ * scratch registers and the BPF scratch memory lives on the stack
+ */
+class X86Emitter
+{
+public:
+
+	// jump targets which aren't BPF instructions, they're placed after the code of the last instruction
+	enum SpecialTarget
+	{
+		ReturnZero,
+		Epilogue
+	};
+
+	X86Emitter(size_t numOfInstructions) : m_NumOfInstructions(numOfInstructions)
+	{
+		m_TargetOffsets.resize(numOfInstructions + 2, 0);
+	}
+
+	void emit(uint8_t b1) { m_Code.push_back(b1); }
+	void emit(uint8_t b1, uint8_t b2) { emit(b1); emit(b2); }
+	void emit(uint8_t b1, uint8_t b2, uint8_t b3) { emit(b1, b2); emit(b3); }
+	void emit(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) { emit(b1, b2); emit(b3, b4); }
+	void emit(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5) { emit(b1, b2, b3, b4); emit(b5); }
+
+	void emitImm32(uint32_t value)
+	{
+		emit((uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24));
+	}
+
+	// start the code of a BPF instruction or a special target
+	void placeInstruction(size_t index) { m_TargetOffsets[index] = m_Code.size(); }
+	void placeSpecial(SpecialTarget target) { placeInstruction(m_NumOfInstructions + target); }
+
+	// jmp rel32 / jcc rel32 to a BPF instruction or a special target
+	void emitJump(size_t target) { emit(0xe9); addPendingJump(target); }
+	void emitJumpIf(uint8_t conditionCode, size_t target) { emit(0x0f, conditionCode); addPendingJump(target); }
+	void emitJump(SpecialTarget target) { emitJump(m_NumOfInstructions + target); }
+	void emitJumpIf(uint8_t conditionCode, SpecialTarget target) { emitJumpIf(conditionCode, m_NumOfInstructions + target); }
+
+	// reject the packet unless the captured length is at least offset + size
+	void emitBoundsCheck(uint32_t offset, uint32_t size)
+	{
+		// displacements are signed 32-bit, so anything beyond 2GB can't be in the packet anyway
+		if ((uint64_t)offset + size > 0x7fffffff)
+		{
+			emitJump(ReturnZero);
+			return;
+		}
+
+		emit(0x81, 0xfe); emitImm32(offset + size); // cmp esi, offset+size
+		emitJumpIf(JumpIfBelow, ReturnZero);
+	}
+
+	// A or X = the memory word at index
+	void emitStackAccess(uint8_t opcode, uint8_t modrm, uint32_t index) { emit(opcode, modrm, 0x24, (uint8_t)(index * 4)); }
+
+	void resolveJumps()
+	{
+		for (std::vector<std::pair<size_t, size_t> >::const_iterator iter = m_PendingJumps.begin(); iter != m_PendingJumps.end(); iter++)
+		{
+			size_t patchOffset = iter->first;
+			int32_t relative = (int32_t)(m_TargetOffsets[iter->second] - (patchOffset + 4));
+			memcpy(&m_Code[patchOffset], &relative, sizeof(relative));
+		}
+	}
+
+	const std::vector<uint8_t>& getCode() const { return m_Code; }
+
+	static const uint8_t JumpIfEqual = 0x84;
+	static const uint8_t JumpIfNotEqual = 0x85;
+	static const uint8_t JumpIfBelow = 0x82;
+	static const uint8_t JumpIfAboveOrEqual = 0x83;
+	static const uint8_t JumpIfBelowOrEqual = 0x86;
+	static const uint8_t JumpIfAbove = 0x87;
+
+private:
+	size_t m_NumOfInstructions;
+	std::vector<uint8_t> m_Code;
+	std::vector<size_t> m_TargetOffsets;
+	std::vector<std::pair<size_t, size_t> > m_PendingJumps;
+
+	void addPendingJump(size_t target)
+	{
+		m_PendingJumps.push_back(std::pair<size_t, size_t>(m_Code.size(), target));
+		emitImm32(0);
+	}
+};
+
+#endif // PCPP_BPF_JIT_X86_64
+
+} // namespace
+
+
+BpfJit::BpfJit()
+{
+	m_UsesMemory = false;
+	m_JitFunction = NULL;
+	m_JitCode = NULL;
+	m_JitCodeSize = 0;
+}
+
+BpfJit::~BpfJit()
+{
+	freeNativeCode();
+}
+
+bool BpfJit::isJitSupported()
+{
+#ifdef PCPP_BPF_JIT_X86_64
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool BpfJit::compile(const struct bpf_program* program, bool useJit)
+{
+	clear();
+
+	if (program == NULL || program->bf_insns == NULL || program->bf_len == 0)
+	{
+		LOG_ERROR("Cannot compile an empty BPF program");
+		return false;
+	}
+
+	m_Program.resize(program->bf_len);
+	for (u_int i = 0; i < program->bf_len; i++)
+	{
+		m_Program[i].code = program->bf_insns[i].code;
+		m_Program[i].jt = program->bf_insns[i].jt;
+		m_Program[i].jf = program->bf_insns[i].jf;
+		m_Program[i].k = program->bf_insns[i].k;
+
+		uint16_t code = m_Program[i].code;
+		if (code == (BPF_LD|BPF_MEM) || code == (BPF_LDX|BPF_MEM) || BPF_CLASS(code) == BPF_ST || BPF_CLASS(code) == BPF_STX)
+			m_UsesMemory = true;
+	}
+
+	if (!validate())
+	{
+		LOG_ERROR("Invalid BPF program");
+		clear();
+		return false;
+	}
+
+	if (useJit && !generateNativeCode())
+		LOG_DEBUG("BPF program isn't compiled to native code, it'll run in the interpreter");
+
+	return true;
+}
+
+void BpfJit::clear()
+{
+	freeNativeCode();
+	m_Program.clear();
+	m_UsesMemory = false;
+}
+
+bool BpfJit::validate() const
+{
+	size_t numOfInstructions = m_Program.size();
+	if (numOfInstructions == 0 || numOfInstructions > BPF_MAXINSNS)
+		return false;
+
+	for (size_t i = 0; i < numOfInstructions; i++)
+	{
+		const Instruction& instruction = m_Program[i];
+		// all jumps are forward, so the number of instructions a jump can skip is limited by the instructions left
+		size_t instructionsLeft = numOfInstructions - i - 1;
+
+		switch (instruction.code)
+		{
+		case BPF_LD|BPF_W|BPF_IMM:
+		case BPF_LD|BPF_W|BPF_ABS:
+		case BPF_LD|BPF_H|BPF_ABS:
+		case BPF_LD|BPF_B|BPF_ABS:
+		case BPF_LD|BPF_W|BPF_IND:
+		case BPF_LD|BPF_H|BPF_IND:
+		case BPF_LD|BPF_B|BPF_IND:
+		case BPF_LD|BPF_W|BPF_LEN:
+		case BPF_LDX|BPF_W|BPF_IMM:
+		case BPF_LDX|BPF_W|BPF_LEN:
+		case BPF_LDX|BPF_B|BPF_MSH:
+		case BPF_RET|BPF_K:
+		case BPF_RET|BPF_A:
+		case BPF_MISC|BPF_TAX:
+		case BPF_MISC|BPF_TXA:
+		case BPF_ALU|BPF_ADD|BPF_K:
+		case BPF_ALU|BPF_SUB|BPF_K:
+		case BPF_ALU|BPF_MUL|BPF_K:
+		case BPF_ALU|BPF_OR|BPF_K:
+		case BPF_ALU|BPF_AND|BPF_K:
+		case BPF_ALU|BPF_XOR|BPF_K:
+		case BPF_ALU|BPF_ADD|BPF_X:
+		case BPF_ALU|BPF_SUB|BPF_X:
+		case BPF_ALU|BPF_MUL|BPF_X:
+		case BPF_ALU|BPF_DIV|BPF_X:
+		case BPF_ALU|BPF_MOD|BPF_X:
+		case BPF_ALU|BPF_OR|BPF_X:
+		case BPF_ALU|BPF_AND|BPF_X:
+		case BPF_ALU|BPF_XOR|BPF_X:
+		case BPF_ALU|BPF_LSH|BPF_X:
+		case BPF_ALU|BPF_RSH|BPF_X:
+		case BPF_ALU|BPF_NEG:
+			break;
+
+		case BPF_LD|BPF_MEM:
+		case BPF_LDX|BPF_MEM:
+		case BPF_ST:
+		case BPF_STX:
+			if (instruction.k >= BPF_MEMWORDS)
+				return false;
+			break;
+
+		case BPF_ALU|BPF_DIV|BPF_K:
+		case BPF_ALU|BPF_MOD|BPF_K:
+			if (instruction.k == 0)
+				return false;
+			break;
+
+		case BPF_ALU|BPF_LSH|BPF_K:
+		case BPF_ALU|BPF_RSH|BPF_K:
+			if (instruction.k >= 32)
+				return false;
+			break;
+
+		case BPF_JMP|BPF_JA:
+			if (instruction.k >= instructionsLeft)
+				return false;
+			break;
+
+		case BPF_JMP|BPF_JEQ|BPF_K:
+		case BPF_JMP|BPF_JGT|BPF_K:
+		case BPF_JMP|BPF_JGE|BPF_K:
+		case BPF_JMP|BPF_JSET|BPF_K:
+		case BPF_JMP|BPF_JEQ|BPF_X:
+		case BPF_JMP|BPF_JGT|BPF_X:
+		case BPF_JMP|BPF_JGE|BPF_X:
+		case BPF_JMP|BPF_JSET|BPF_X:
+			if (instruction.jt >= instructionsLeft || instruction.jf >= instructionsLeft)
+				return false;
+			break;
+
+		default:
+			LOG_DEBUG("Unsupported BPF instruction 0x%x at index %d", (int)instruction.code, (int)i);
+			return false;
+		}
+	}
+
+	// the program must not run past its end
+	return BPF_CLASS(m_Program.back().code) == BPF_RET;
+}
+
+uint32_t BpfJit::interpret(const uint8_t* packetData, uint32_t capturedLen, uint32_t wireLen) const
+{
+	if (m_Program.empty())
+		return 0;
+
+	uint32_t A = 0;
+	uint32_t X = 0;
+	uint32_t mem[BPF_MEMWORDS];
+	if (m_UsesMemory)
+		memset(mem, 0, sizeof(mem));
+
+	const Instruction* pc = &m_Program[0];
+	while (true)
+	{
+		uint32_t k = pc->k;
+
+		switch (pc->code)
+		{
+		case BPF_RET|BPF_K:
+			return k;
+		case BPF_RET|BPF_A:
+			return A;
+
+		case BPF_LD|BPF_W|BPF_ABS:
+			if (!isInBounds(k, 4, capturedLen))
+				return 0;
+			A = loadWord(packetData + k);
+			break;
+		case BPF_LD|BPF_H|BPF_ABS:
+			if (!isInBounds(k, 2, capturedLen))
+				return 0;
+			A = loadHalf(packetData + k);
+			break;
+		case BPF_LD|BPF_B|BPF_ABS:
+			if (!isInBounds(k, 1, capturedLen))
+				return 0;
+			A = packetData[k];
+			break;
+		case BPF_LD|BPF_W|BPF_IND:
+			if ((uint64_t)X + k + 4 > capturedLen)
+				return 0;
+			A = loadWord(packetData + X + k);
+			break;
+		case BPF_LD|BPF_H|BPF_IND:
+			if ((uint64_t)X + k + 2 > capturedLen)
+				return 0;
+			A = loadHalf(packetData + X + k);
+			break;
+		case BPF_LD|BPF_B|BPF_IND:
+			if ((uint64_t)X + k + 1 > capturedLen)
+				return 0;
+			A = packetData[X + k];
+			break;
+		case BPF_LD|BPF_W|BPF_LEN:
+			A = wireLen;
+			break;
+		case BPF_LD|BPF_W|BPF_IMM:
+			A = k;
+			break;
+		case BPF_LD|BPF_MEM:
+			A = mem[k];
+			break;
+
+		case BPF_LDX|BPF_W|BPF_IMM:
+			X = k;
+			break;
+		case BPF_LDX|BPF_MEM:
+			X = mem[k];
+			break;
+		case BPF_LDX|BPF_W|BPF_LEN:
+			X = wireLen;
+			break;
+		case BPF_LDX|BPF_B|BPF_MSH:
+			if (!isInBounds(k, 1, capturedLen))
+				return 0;
+			X = (packetData[k] & 0x0f) << 2;
+			break;
+
+		case BPF_ST:
+			mem[k] = A;
+			break;
+		case BPF_STX:
+			mem[k] = X;
+			break;
+
+		case BPF_JMP|BPF_JA:
+			pc += k;
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_K:
+			pc += (A == k) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JGT|BPF_K:
+			pc += (A > k) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JGE|BPF_K:
+			pc += (A >= k) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JSET|BPF_K:
+			pc += (A & k) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_X:
+			pc += (A == X) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JGT|BPF_X:
+			pc += (A > X) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JGE|BPF_X:
+			pc += (A >= X) ? pc->jt : pc->jf;
+			break;
+		case BPF_JMP|BPF_JSET|BPF_X:
+			pc += (A & X) ? pc->jt : pc->jf;
+			break;
+
+		case BPF_ALU|BPF_ADD|BPF_X:
+			A += X;
+			break;
+		case BPF_ALU|BPF_SUB|BPF_X:
+			A -= X;
+			break;
+		case BPF_ALU|BPF_MUL|BPF_X:
+			A *= X;
+			break;
+		case BPF_ALU|BPF_DIV|BPF_X:
+			if (X == 0)
+				return 0;
+			A /= X;
+			break;
+		case BPF_ALU|BPF_MOD|BPF_X:
+			if (X == 0)
+				return 0;
+			A %= X;
+			break;
+		case BPF_ALU|BPF_AND|BPF_X:
+			A &= X;
+			break;
+		case BPF_ALU|BPF_OR|BPF_X:
+			A |= X;
+			break;
+		case BPF_ALU|BPF_XOR|BPF_X:
+			A ^= X;
+			break;
+		case BPF_ALU|BPF_LSH|BPF_X:
+			// like libpcap, shifting by 32 or more clears A instead of being undefined
+			A = (X < 32 ? A << X : 0);
+			break;
+		case BPF_ALU|BPF_RSH|BPF_X:
+			A = (X < 32 ? A >> X : 0);
+			break;
+		case BPF_ALU|BPF_ADD|BPF_K:
+			A += k;
+			break;
+		case BPF_ALU|BPF_SUB|BPF_K:
+			A -= k;
+			break;
+		case BPF_ALU|BPF_MUL|BPF_K:
+			A *= k;
+			break;
+		case BPF_ALU|BPF_DIV|BPF_K:
+			A /= k;
+			break;
+		case BPF_ALU|BPF_MOD|BPF_K:
+			A %= k;
+			break;
+		case BPF_ALU|BPF_AND|BPF_K:
+			A &= k;
+			break;
+		case BPF_ALU|BPF_OR|BPF_K:
+			A |= k;
+			break;
+		case BPF_ALU|BPF_XOR|BPF_K:
+			A ^= k;
+			break;
+		case BPF_ALU|BPF_LSH|BPF_K:
+			A <<= k;
+			break;
+		case BPF_ALU|BPF_RSH|BPF_K:
+			A >>= k;
+			break;
+		case BPF_ALU|BPF_NEG:
+			A = (uint32_t)(-(int64_t)A);
+			break;
+
+		case BPF_MISC|BPF_TAX:
+			X = A;
+			break;
+		case BPF_MISC|BPF_TXA:
+			A = X;
+			break;
+
+		default:
+			// can't happen, the program was validated
+			return 0;
+		}
+
+		pc++;
+	}
+}
+
+#ifdef PCPP_BPF_JIT_X86_64
+
+bool BpfJit::generateNativeCode()
+{
+	size_t numOfInstructions = m_Program.size();
+	X86Emitter code(numOfInstructions);
+
+	// prologue: move the arguments to the registers the program uses and clear A and X
+#if defined(_WIN32)
+	code.emit(0x57);                                // push rdi
+	code.emit(0x56);                                // push rsi
+	code.emit(0x48, 0x89, 0xcf);                    // mov rdi, rcx
+	code.emit(0x89, 0xd6);                          // mov esi, edx
+	code.emit(0x45, 0x89, 0xc1);                    // mov r9d, r8d
+#else
+	code.emit(0x89, 0xf6);                          // mov esi, esi (clear the upper half of rsi)
+	code.emit(0x41, 0x89, 0xd1);                    // mov r9d, edx
+#endif
+	if (m_UsesMemory)
+	{
+		code.emit(0x48, 0x83, 0xec, BPF_MEMWORDS * 4); // sub rsp, BPF_MEMWORDS*4
+		for (int i = 0; i < BPF_MEMWORDS / 2; i++)
+		{
+			code.emit(0x48, 0xc7, 0x44, 0x24, (uint8_t)(i * 8)); // mov qword [rsp+i*8], 0
+			code.emitImm32(0);
+		}
+	}
+	code.emit(0x31, 0xc0);                          // xor eax, eax
+	code.emit(0x31, 0xc9);                          // xor ecx, ecx
+
+	for (size_t i = 0; i < numOfInstructions; i++)
+	{
+		const Instruction& instruction = m_Program[i];
+		uint32_t k = instruction.k;
+		size_t jumpIfTrue = i + 1 + instruction.jt;
+		size_t jumpIfFalse = i + 1 + instruction.jf;
+		uint8_t conditionIfTrue = 0;
+		uint8_t conditionIfFalse = 0;
+
+		code.placeInstruction(i);
+
+		switch (instruction.code)
+		{
+		case BPF_RET|BPF_K:
+			code.emit(0xb8); code.emitImm32(k);     // mov eax, k
+			code.emitJump(X86Emitter::Epilogue);
+			break;
+		case BPF_RET|BPF_A:
+			code.emitJump(X86Emitter::Epilogue);
+			break;
+
+		case BPF_LD|BPF_W|BPF_ABS:
+			code.emitBoundsCheck(k, 4);
+			code.emit(0x8b, 0x87); code.emitImm32(k); // mov eax, [rdi+k]
+			code.emit(0x0f, 0xc8);                  // bswap eax
+			break;
+		case BPF_LD|BPF_H|BPF_ABS:
+			code.emitBoundsCheck(k, 2);
+			code.emit(0x0f, 0xb7, 0x87); code.emitImm32(k); // movzx eax, word [rdi+k]
+			code.emit(0x66, 0xc1, 0xc0, 0x08);      // rol ax, 8
+			break;
+		case BPF_LD|BPF_B|BPF_ABS:
+			code.emitBoundsCheck(k, 1);
+			code.emit(0x0f, 0xb6, 0x87); code.emitImm32(k); // movzx eax, byte [rdi+k]
+			break;
+
+		case BPF_LD|BPF_W|BPF_IND:
+		case BPF_LD|BPF_H|BPF_IND:
+		case BPF_LD|BPF_B|BPF_IND:
+		{
+			uint8_t size = (BPF_SIZE(instruction.code) == BPF_W ? 4 : (BPF_SIZE(instruction.code) == BPF_H ? 2 : 1));
+			// the offset is calculated in 64 bits so X + k can't wrap around
+			code.emit(0x41, 0x89, 0xc8);            // mov r8d, ecx
+			code.emit(0x41, 0xba); code.emitImm32(k); // mov r10d, k
+			code.emit(0x4d, 0x01, 0xd0);            // add r8, r10
+			code.emit(0x4d, 0x8d, 0x58, size);      // lea r11, [r8+size]
+			code.emit(0x49, 0x39, 0xf3);            // cmp r11, rsi
+			code.emitJumpIf(X86Emitter::JumpIfAbove, X86Emitter::ReturnZero);
+			if (size == 4)
+			{
+				code.emit(0x42, 0x8b, 0x04, 0x07);  // mov eax, [rdi+r8]
+				code.emit(0x0f, 0xc8);              // bswap eax
+			}
+			else if (size == 2)
+			{
+				code.emit(0x42, 0x0f, 0xb7, 0x04, 0x07); // movzx eax, word [rdi+r8]
+				code.emit(0x66, 0xc1, 0xc0, 0x08);  // rol ax, 8
+			}
+			else
+				code.emit(0x42, 0x0f, 0xb6, 0x04, 0x07); // movzx eax, byte [rdi+r8]
+			break;
+		}
+
+		case BPF_LD|BPF_W|BPF_LEN:
+			code.emit(0x44, 0x89, 0xc8);            // mov eax, r9d
+			break;
+		case BPF_LD|BPF_W|BPF_IMM:
+			code.emit(0xb8); code.emitImm32(k);     // mov eax, k
+			break;
+		case BPF_LD|BPF_MEM:
+			code.emitStackAccess(0x8b, 0x44, k);    // mov eax, [rsp+k*4]
+			break;
+
+		case BPF_LDX|BPF_W|BPF_IMM:
+			code.emit(0xb9); code.emitImm32(k);     // mov ecx, k
+			break;
+		case BPF_LDX|BPF_MEM:
+			code.emitStackAccess(0x8b, 0x4c, k);    // mov ecx, [rsp+k*4]
+			break;
+		case BPF_LDX|BPF_W|BPF_LEN:
+			code.emit(0x44, 0x89, 0xc9);            // mov ecx, r9d
+			break;
+		case BPF_LDX|BPF_B|BPF_MSH:
+			code.emitBoundsCheck(k, 1);
+			code.emit(0x0f, 0xb6, 0x8f); code.emitImm32(k); // movzx ecx, byte [rdi+k]
+			code.emit(0x83, 0xe1, 0x0f);            // and ecx, 0xf
+			code.emit(0xc1, 0xe1, 0x02);            // shl ecx, 2
+			break;
+
+		case BPF_ST:
+			code.emitStackAccess(0x89, 0x44, k);    // mov [rsp+k*4], eax
+			break;
+		case BPF_STX:
+			code.emitStackAccess(0x89, 0x4c, k);    // mov [rsp+k*4], ecx
+			break;
+
+		case BPF_JMP|BPF_JA:
+			code.emitJump(i + 1 + k);
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_K:
+		case BPF_JMP|BPF_JGT|BPF_K:
+		case BPF_JMP|BPF_JGE|BPF_K:
+			code.emit(0x3d); code.emitImm32(k);     // cmp eax, k
+			break;
+		case BPF_JMP|BPF_JSET|BPF_K:
+			code.emit(0xa9); code.emitImm32(k);     // test eax, k
+			break;
+		case BPF_JMP|BPF_JEQ|BPF_X:
+		case BPF_JMP|BPF_JGT|BPF_X:
+		case BPF_JMP|BPF_JGE|BPF_X:
+			code.emit(0x39, 0xc8);                  // cmp eax, ecx
+			break;
+		case BPF_JMP|BPF_JSET|BPF_X:
+			code.emit(0x85, 0xc8);                  // test eax, ecx
+			break;
+
+		case BPF_ALU|BPF_ADD|BPF_K:
+			code.emit(0x05); code.emitImm32(k);     // add eax, k
+			break;
+		case BPF_ALU|BPF_SUB|BPF_K:
+			code.emit(0x2d); code.emitImm32(k);     // sub eax, k
+			break;
+		case BPF_ALU|BPF_MUL|BPF_K:
+			code.emit(0x69, 0xc0); code.emitImm32(k); // imul eax, eax, k
+			break;
+		case BPF_ALU|BPF_DIV|BPF_K:
+		case BPF_ALU|BPF_MOD|BPF_K:
+			code.emit(0x31, 0xd2);                  // xor edx, edx
+			code.emit(0x41, 0xb8); code.emitImm32(k); // mov r8d, k
+			code.emit(0x41, 0xf7, 0xf0);            // div r8d
+			if (BPF_OP(instruction.code) == BPF_MOD)
+				code.emit(0x89, 0xd0);              // mov eax, edx
+			break;
+		case BPF_ALU|BPF_AND|BPF_K:
+			code.emit(0x25); code.emitImm32(k);     // and eax, k
+			break;
+		case BPF_ALU|BPF_OR|BPF_K:
+			code.emit(0x0d); code.emitImm32(k);     // or eax, k
+			break;
+		case BPF_ALU|BPF_XOR|BPF_K:
+			code.emit(0x35); code.emitImm32(k);     // xor eax, k
+			break;
+		case BPF_ALU|BPF_LSH|BPF_K:
+			code.emit(0xc1, 0xe0, (uint8_t)k);      // shl eax, k
+			break;
+		case BPF_ALU|BPF_RSH|BPF_K:
+			code.emit(0xc1, 0xe8, (uint8_t)k);      // shr eax, k
+			break;
+
+		case BPF_ALU|BPF_ADD|BPF_X:
+			code.emit(0x01, 0xc8);                  // add eax, ecx
+			break;
+		case BPF_ALU|BPF_SUB|BPF_X:
+			code.emit(0x29, 0xc8);                  // sub eax, ecx
+			break;
+		case BPF_ALU|BPF_MUL|BPF_X:
+			code.emit(0x0f, 0xaf, 0xc1);            // imul eax, ecx
+			break;
+		case BPF_ALU|BPF_DIV|BPF_X:
+		case BPF_ALU|BPF_MOD|BPF_X:
+			code.emit(0x85, 0xc9);                  // test ecx, ecx
+			code.emitJumpIf(X86Emitter::JumpIfEqual, X86Emitter::ReturnZero);
+			code.emit(0x31, 0xd2);                  // xor edx, edx
+			code.emit(0xf7, 0xf1);                  // div ecx
+			if (BPF_OP(instruction.code) == BPF_MOD)
+				code.emit(0x89, 0xd0);              // mov eax, edx
+			break;
+		case BPF_ALU|BPF_AND|BPF_X:
+			code.emit(0x21, 0xc8);                  // and eax, ecx
+			break;
+		case BPF_ALU|BPF_OR|BPF_X:
+			code.emit(0x09, 0xc8);                  // or eax, ecx
+			break;
+		case BPF_ALU|BPF_XOR|BPF_X:
+			code.emit(0x31, 0xc8);                  // xor eax, ecx
+			break;
+		case BPF_ALU|BPF_LSH|BPF_X:
+		case BPF_ALU|BPF_RSH|BPF_X:
+			// x86 masks the shift count to 5 bits, BPF clears A when shifting by 32 or more
+			code.emit(0x83, 0xf9, 0x20);            // cmp ecx, 32
+			code.emit(0x72, 0x04);                  // jb shift
+			code.emit(0x31, 0xc0);                  // xor eax, eax
+			code.emit(0xeb, 0x02);                  // jmp done
+			code.emit(0xd3, BPF_OP(instruction.code) == BPF_LSH ? 0xe0 : 0xe8); // shift: shl/shr eax, cl
+			break;
+		case BPF_ALU|BPF_NEG:
+			code.emit(0xf7, 0xd8);                  // neg eax
+			break;
+
+		case BPF_MISC|BPF_TAX:
+			code.emit(0x89, 0xc1);                  // mov ecx, eax
+			break;
+		case BPF_MISC|BPF_TXA:
+			code.emit(0x89, 0xc8);                  // mov eax, ecx
+			break;
+
+		default:
+			// can't happen, the program was validated
+			return false;
+		}
+
+		// conditional jumps: the comparison was emitted above, now branch on its result
+		switch (BPF_OP(instruction.code))
+		{
+		case BPF_JEQ:
+			conditionIfTrue = X86Emitter::JumpIfEqual;
+			conditionIfFalse = X86Emitter::JumpIfNotEqual;
+			break;
+		case BPF_JGT:
+			conditionIfTrue = X86Emitter::JumpIfAbove;
+			conditionIfFalse = X86Emitter::JumpIfBelowOrEqual;
+			break;
+		case BPF_JGE:
+			conditionIfTrue = X86Emitter::JumpIfAboveOrEqual;
+			conditionIfFalse = X86Emitter::JumpIfBelow;
+			break;
+		case BPF_JSET:
+			conditionIfTrue = X86Emitter::JumpIfNotEqual;
+			conditionIfFalse = X86Emitter::JumpIfEqual;
+			break;
+		}
+
+		if (BPF_CLASS(instruction.code) == BPF_JMP && BPF_OP(instruction.code) != BPF_JA)
+		{
+			// a jump offset of 0 falls through to the next instruction
+			if (instruction.jt == 0 && instruction.jf == 0)
+				continue;
+			else if (instruction.jt == 0)
+				code.emitJumpIf(conditionIfFalse, jumpIfFalse);
+			else if (instruction.jf == 0)
+				code.emitJumpIf(conditionIfTrue, jumpIfTrue);
+			else
+			{
+				code.emitJumpIf(conditionIfTrue, jumpIfTrue);
+				code.emitJump(jumpIfFalse);
+			}
+		}
+	}
+
+	// reject: return 0 and fall through to the epilogue
+	code.placeSpecial(X86Emitter::ReturnZero);
+	code.emit(0x31, 0xc0);                          // xor eax, eax
+
+	code.placeSpecial(X86Emitter::Epilogue);
+	if (m_UsesMemory)
+		code.emit(0x48, 0x83, 0xc4, BPF_MEMWORDS * 4); // add rsp, BPF_MEMWORDS*4
+#if defined(_WIN32)
+	code.emit(0x5e);                                // pop rsi
+	code.emit(0x5f);                                // pop rdi
+#endif
+	code.emit(0xc3);                                // ret
+
+	code.resolveJumps();
+
+	// copy the code to executable memory, which is never writable and executable at the same time
+	const std::vector<uint8_t>& machineCode = code.getCode();
+	size_t codeSize = machineCode.size();
+#if defined(_WIN32)
+	void* executableMemory = VirtualAlloc(NULL, codeSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (executableMemory == NULL)
+		return false;
+
+	memcpy(executableMemory, &machineCode[0], codeSize);
+	DWORD oldProtection;
+	if (!VirtualProtect(executableMemory, codeSize, PAGE_EXECUTE_READ, &oldProtection))
+	{
+		VirtualFree(executableMemory, 0, MEM_RELEASE);
+		return false;
+	}
+	FlushInstructionCache(GetCurrentProcess(), executableMemory, codeSize);
+#else
+	void* executableMemory = mmap(NULL, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if (executableMemory == MAP_FAILED)
+		return false;
+
+	memcpy(executableMemory, &machineCode[0], codeSize);
+	if (mprotect(executableMemory, codeSize, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(executableMemory, codeSize);
+		return false;
+	}
+#endif
+
+	m_JitCode = executableMemory;
+	m_JitCodeSize = codeSize;
+	m_JitFunction = (JitFunction)m_JitCode;
+	return true;
+}
+
+void BpfJit::freeNativeCode()
+{
+	if (m_JitCode != NULL)
+	{
+#if defined(_WIN32)
+		VirtualFree(m_JitCode, 0, MEM_RELEASE);
+#else
+		munmap(m_JitCode, m_JitCodeSize);
+#endif
+	}
+
+	m_JitCode = NULL;
+	m_JitCodeSize = 0;
+	m_JitFunction = NULL;
+}
+
+#else
+
+bool BpfJit::generateNativeCode()
+{
+	// no native code generator for this architecture, programs run in the interpreter
+	return false;
+}
+
+void BpfJit::freeNativeCode()
+{
+	m_JitCode = NULL;
+	m_JitCodeSize = 0;
+	m_JitFunction = NULL;
+}
+
+#endif // PCPP_BPF_JIT_X86_64
+
+} // namespace pcpp
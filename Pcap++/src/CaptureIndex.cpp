@@ -0,0 +1,844 @@
+#define LOG_MODULE PcapLogModuleFileDevice
+
+#include "CaptureIndex.h"
+#include "PcapFileDevice.h"
+#include "Packet.h"
+#include "IPv4Layer.h"
+#include "IPv6Layer.h"
+#include "TcpLayer.h"
+#include "UdpLayer.h"
+#include "ArpLayer.h"
+#include "Logger.h"
+#include "EndianPortable.h"
+#include <string.h>
+#include <math.h>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+
+#define CAPTURE_INDEX_MAGIC "PCPPIDX"
+#define CAPTURE_INDEX_VERSION 2
+
+#define CAPTURE_INDEX_FLAG_UNPARSED_PACKETS 0x01
+
+#define CAPTURE_INDEX_IPPROTO_SCTP 132
+
+#define BLOOM_FILTER_MAX_HASHES 16
+
+#define BLOOM_FILTER_LN2 0.69314718055994530942
+
+namespace pcpp
+{
+
+namespace
+{
+
+inline uint64_t mix(uint64_t value)
+{
+	// the 64-bit finalizer of MurmurHash3
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+inline uint64_t hashBytes(const uint8_t* data, size_t dataLen)
+{
+	// FNV-1a, mixed so all the bits depend on all the bytes
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < dataLen; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return mix(hash ^ dataLen);
+}
+
+inline int compareTimespec(const timespec& first, const timespec& second)
+{
+	if (first.tv_sec != second.tv_sec)
+		return (first.tv_sec < second.tv_sec ? -1 : 1);
+	if (first.tv_nsec != second.tv_nsec)
+		return (first.tv_nsec < second.tv_nsec ? -1 : 1);
+	return 0;
+}
+
+void writeUint(std::vector<uint8_t>& buffer, uint64_t value, int size)
+{
+	for (int i = 0; i < size; i++)
+		buffer.push_back((uint8_t)(value >> (8 * i)));
+}
+
+uint64_t readUint(const uint8_t* data, int size)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < size; i++)
+		value |= (uint64_t)data[i] << (8 * i);
+	return value;
+}
+
+uint64_t getCaptureFileSize(const std::string& captureFileName)
+{
+	std::ifstream fileStream(captureFileName.c_str(), std::ifstream::ate | std::ifstream::binary);
+	if (!fileStream.is_open())
+		return 0;
+
+	return fileStream.tellg();
+}
+
+uint16_t readPort(const uint8_t* portInNetworkOrder)
+{
+	return ((uint16_t)portInNetworkOrder[0] << 8) | portInNetworkOrder[1];
+}
+
+// a flow key is the 2 endpoints (address followed by port in network order), the lower endpoint first so both directions have the same key
+void makeFlowKey(const uint8_t* address1, uint16_t port1, const uint8_t* address2, uint16_t port2, size_t addressLen, std::string& key)
+{
+	int cmp = memcmp(address1, address2, addressLen);
+	if (cmp > 0 || (cmp == 0 && port1 > port2))
+	{
+		std::swap(address1, address2);
+		std::swap(port1, port2);
+	}
+
+	uint8_t ports[4] = { (uint8_t)(port1 >> 8), (uint8_t)port1, (uint8_t)(port2 >> 8), (uint8_t)port2 };
+	key.assign((const char*)address1, addressLen);
+	key.append((const char*)ports, 2);
+	key.append((const char*)address2, addressLen);
+	key.append((const char*)ports + 2, 2);
+}
+
+// the hashed addresses, ports and flows of the packets added to an index, one vector per Bloom filter
+struct PacketItemsCollector
+{
+	std::vector<uint64_t>* items;
+	std::string flowKey;
+	const uint8_t* srcAddress;
+	const uint8_t* dstAddress;
+	size_t addressLen;
+
+	PacketItemsCollector(std::vector<uint64_t>* itemVectors) : items(itemVectors), srcAddress(NULL), dstAddress(NULL), addressLen(0) {}
+
+	void addAddress(const uint8_t* address, size_t len) { items[0].push_back(hashBytes(address, len)); }
+
+	void setNetworkAddresses(const uint8_t* src, const uint8_t* dst, size_t len)
+	{
+		srcAddress = src;
+		dstAddress = dst;
+		addressLen = len;
+		addAddress(src, len);
+		addAddress(dst, len);
+	}
+
+	// the source and destination ports are the first 4 bytes of TCP, UDP and SCTP headers
+	void addPorts(const uint8_t* portsInNetworkOrder)
+	{
+		items[1].push_back(hashBytes(portsInNetworkOrder, 2));
+		items[1].push_back(hashBytes(portsInNetworkOrder + 2, 2));
+
+		if (srcAddress == NULL)
+			return;
+
+		makeFlowKey(srcAddress, readPort(portsInNetworkOrder), dstAddress, readPort(portsInNetworkOrder + 2), addressLen, flowKey);
+		items[2].push_back(hashBytes((const uint8_t*)flowKey.data(), flowKey.size()));
+	}
+};
+
+// returns false if the packet couldn't be parsed, meaning its protocols, addresses and ports may be missing from the index
+bool collectPacketItems(RawPacket& rawPacket, std::vector<uint64_t>* items, ProtocolType& protocols)
+{
+	protocols = UnknownProtocol;
+
+	Packet packet(&rawPacket);
+
+	Layer* firstLayer = packet.getFirstLayer();
+	if (firstLayer == NULL || firstLayer->getProtocol() == GenericPayload)
+		return false;
+
+	PacketItemsCollector collector(items);
+	for (Layer* layer = firstLayer; layer != NULL; layer = layer->getNextLayer())
+	{
+		protocols |= layer->getProtocol();
+
+		switch (layer->getProtocol())
+		{
+		case IPv4:
+		{
+			IPv4Layer* ipLayer = (IPv4Layer*)layer;
+			iphdr* ipHeader = ipLayer->getIPv4Header();
+			collector.setNetworkAddresses((const uint8_t*)&ipHeader->ipSrc, (const uint8_t*)&ipHeader->ipDst, 4);
+
+			// Packet++ doesn't parse SCTP, nor anything above a fragmented IPv4 header (even the first fragment). In these cases the
+			// ports are read from the IPv4 payload. Ports of unfragmented TCP and UDP packets are read from their layers below
+			bool isFirstFragment = ((ipHeader->fragmentOffset & htobe16(0x1fff)) == 0);
+			bool hasPorts = (ipHeader->protocol == CAPTURE_INDEX_IPPROTO_SCTP ||
+					ipHeader->protocol == PACKETPP_IPPROTO_TCP || ipHeader->protocol == PACKETPP_IPPROTO_UDP);
+			bool isParsedByPacketpp = (ipHeader->protocol != CAPTURE_INDEX_IPPROTO_SCTP && !ipLayer->isFragment());
+			if (hasPorts && isFirstFragment && !isParsedByPacketpp && layer->getLayerPayloadSize() >= 4)
+				collector.addPorts(layer->getLayerPayload());
+			break;
+		}
+		case IPv6:
+		{
+			ip6_hdr* ipHeader = ((IPv6Layer*)layer)->getIPv6Header();
+			collector.setNetworkAddresses(ipHeader->ipSrc, ipHeader->ipDst, 16);
+
+			if (ipHeader->nextHeader == CAPTURE_INDEX_IPPROTO_SCTP && layer->getLayerPayloadSize() >= 4)
+				collector.addPorts(layer->getLayerPayload());
+			break;
+		}
+		case ARP:
+		{
+			arphdr* arpHeader = ((ArpLayer*)layer)->getArpHeader();
+			collector.addAddress((const uint8_t*)&arpHeader->senderIpAddr, 4);
+			collector.addAddress((const uint8_t*)&arpHeader->targetIpAddr, 4);
+			break;
+		}
+		case TCP:
+		case UDP:
+			if (layer->getDataLen() >= 4)
+				collector.addPorts(layer->getData());
+			break;
+		default:
+			break;
+		}
+	}
+
+	return true;
+}
+
+// returns the length of the packet record headers if the file is in pcap format, 0 otherwise
+size_t getPcapRecordHeaderLen(const std::string& captureFileName)
+{
+	std::ifstream fileStream(captureFileName.c_str(), std::ifstream::binary);
+	uint8_t magic[4];
+	if (!fileStream.read((char*)magic, sizeof(magic)))
+		return 0;
+
+	uint32_t magicNumber = (uint32_t)readUint(magic, 4);
+	switch (magicNumber)
+	{
+	// microsecond and nanosecond resolution, in both byte orders
+	case 0xa1b2c3d4:
+	case 0xd4c3b2a1:
+	case 0xa1b23c4d:
+	case 0x4d3cb2a1:
+		return 16;
+	// the modified format of patched libpcap versions
+	case 0xa1b2cd34:
+	case 0x34cdb2a1:
+		return 24;
+	default:
+		return 0;
+	}
+}
+
+void writeTimespec(std::vector<uint8_t>& buffer, const timespec& value)
+{
+	writeUint(buffer, (uint64_t)(int64_t)value.tv_sec, 8);
+	writeUint(buffer, value.tv_nsec, 4);
+}
+
+timespec readTimespec(const uint8_t* data)
+{
+	timespec value;
+	value.tv_sec = (time_t)(int64_t)readUint(data, 8);
+	value.tv_nsec = (long)readUint(data + 8, 4);
+	return value;
+}
+
+} // namespace
+
+
+// ~~~~~~~~~~~~~~~~~~~
+// BloomFilter members
+// ~~~~~~~~~~~~~~~~~~~
+
+BloomFilter::BloomFilter(size_t expectedNumOfItems, double falsePositiveRate)
+{
+	if (falsePositiveRate <= 0 || falsePositiveRate >= 1)
+		falsePositiveRate = 0.01;
+
+	// the optimal number of bits is -n*ln(p)/ln(2)^2 and the optimal number of hashes is ln(2)*bits/n
+	double numOfBits = (expectedNumOfItems == 0 ? 64 : -(double)expectedNumOfItems * log(falsePositiveRate) / (BLOOM_FILTER_LN2 * BLOOM_FILTER_LN2));
+	size_t numOfWords = (size_t)ceil(numOfBits / 64);
+	if (numOfWords == 0)
+		numOfWords = 1;
+
+	m_Bits.resize(numOfWords, 0);
+
+	m_NumOfHashes = (expectedNumOfItems == 0 ? 1 : (int)(BLOOM_FILTER_LN2 * numOfWords * 64 / expectedNumOfItems + 0.5));
+	if (m_NumOfHashes < 1)
+		m_NumOfHashes = 1;
+	if (m_NumOfHashes > BLOOM_FILTER_MAX_HASHES)
+		m_NumOfHashes = BLOOM_FILTER_MAX_HASHES;
+}
+
+void BloomFilter::add(const uint8_t* data, size_t dataLen)
+{
+	addHash(hashBytes(data, dataLen));
+}
+
+void BloomFilter::addHash(uint64_t hash1)
+{
+	// double hashing: the i-th bit index is h1 + i*h2
+	uint64_t hash2 = mix(hash1 ^ 0x9e3779b97f4a7c15ULL) | 1;
+	uint64_t numOfBits = getNumOfBits();
+	for (int i = 0; i < m_NumOfHashes; i++)
+	{
+		uint64_t bit = (hash1 + i * hash2) % numOfBits;
+		m_Bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+	}
+}
+
+bool BloomFilter::mayContain(const uint8_t* data, size_t dataLen) const
+{
+	uint64_t hash1 = hashBytes(data, dataLen);
+	uint64_t hash2 = mix(hash1 ^ 0x9e3779b97f4a7c15ULL) | 1;
+	uint64_t numOfBits = getNumOfBits();
+	for (int i = 0; i < m_NumOfHashes; i++)
+	{
+		uint64_t bit = (hash1 + i * hash2) % numOfBits;
+		if ((m_Bits[bit / 64] & ((uint64_t)1 << (bit % 64))) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+void BloomFilter::clear()
+{
+	for (size_t i = 0; i < m_Bits.size(); i++)
+		m_Bits[i] = 0;
+}
+
+void BloomFilter::serialize(std::vector<uint8_t>& buffer) const
+{
+	writeUint(buffer, m_NumOfHashes, 4);
+	writeUint(buffer, m_Bits.size(), 4);
+	for (size_t i = 0; i < m_Bits.size(); i++)
+		writeUint(buffer, m_Bits[i], 8);
+}
+
+size_t BloomFilter::deserialize(const uint8_t* data, size_t dataLen)
+{
+	if (dataLen < 8)
+		return 0;
+
+	int numOfHashes = (int)readUint(data, 4);
+	size_t numOfWords = (size_t)readUint(data + 4, 4);
+	if (numOfHashes < 1 || numOfHashes > BLOOM_FILTER_MAX_HASHES || numOfWords == 0 || (dataLen - 8) / 8 < numOfWords)
+		return 0;
+
+	m_NumOfHashes = numOfHashes;
+	m_Bits.resize(numOfWords);
+	for (size_t i = 0; i < numOfWords; i++)
+		m_Bits[i] = readUint(data + 8 + i * 8, 8);
+
+	return 8 + numOfWords * 8;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// CaptureIndexQuery members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+
+CaptureIndexQuery::CaptureIndexQuery()
+{
+	m_HasTimeRange = false;
+	m_StartTime.tv_sec = 0;
+	m_StartTime.tv_nsec = 0;
+	m_EndTime = m_StartTime;
+}
+
+void CaptureIndexQuery::addAddress(const IPAddress& address)
+{
+	if (address.getType() == IPAddress::IPv4AddressType)
+		m_IPv4Addresses.push_back(IPv4Address(address.toString()));
+	else
+		m_IPv6Addresses.push_back(IPv6Address(address.toString()));
+}
+
+void CaptureIndexQuery::addPort(uint16_t port)
+{
+	m_Ports.push_back(port);
+}
+
+void CaptureIndexQuery::addFlow(const IPAddress& address1, uint16_t port1, const IPAddress& address2, uint16_t port2)
+{
+	std::string key;
+	if (address1.getType() == IPAddress::IPv4AddressType && address2.getType() == IPAddress::IPv4AddressType)
+	{
+		uint32_t addresses[2] = { IPv4Address(address1.toString()).toInt(), IPv4Address(address2.toString()).toInt() };
+		makeFlowKey((const uint8_t*)&addresses[0], port1, (const uint8_t*)&addresses[1], port2, 4, key);
+	}
+	else if (address1.getType() == IPAddress::IPv6AddressType && address2.getType() == IPAddress::IPv6AddressType)
+	{
+		uint8_t addresses[2][16];
+		IPv6Address(address1.toString()).copyTo(addresses[0]);
+		IPv6Address(address2.toString()).copyTo(addresses[1]);
+		makeFlowKey(addresses[0], port1, addresses[1], port2, 16, key);
+	}
+
+	// a flow between addresses of different IP versions doesn't exist, its empty key is never found
+	m_Flows.push_back(key);
+}
+
+void CaptureIndexQuery::addProtocol(ProtocolType protocol)
+{
+	m_Protocols.push_back(protocol);
+}
+
+void CaptureIndexQuery::setTimeRange(timespec startTime, timespec endTime)
+{
+	m_HasTimeRange = true;
+	m_StartTime = startTime;
+	m_EndTime = endTime;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// CaptureIndexSummary members
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+const uint64_t CaptureIndexSummary::UnknownFileOffset;
+
+CaptureIndexSummary::CaptureIndexSummary()
+{
+	m_FirstPacketIndex = 0;
+	m_FileOffset = UnknownFileOffset;
+	m_PacketCount = 0;
+	m_ByteCount = 0;
+	m_StartTime.tv_sec = 0;
+	m_StartTime.tv_nsec = 0;
+	m_EndTime = m_StartTime;
+	m_Protocols = UnknownProtocol;
+	m_HasUnparsedPackets = false;
+}
+
+void CaptureIndexSummary::addPacketInfo(const timespec& timestamp, uint64_t packetLen, ProtocolType protocols, bool isParsed)
+{
+	if (m_PacketCount == 0 || compareTimespec(timestamp, m_StartTime) < 0)
+		m_StartTime = timestamp;
+	if (m_PacketCount == 0 || compareTimespec(timestamp, m_EndTime) > 0)
+		m_EndTime = timestamp;
+
+	m_PacketCount++;
+	m_ByteCount += packetLen;
+	m_Protocols |= protocols;
+	if (!isParsed)
+		m_HasUnparsedPackets = true;
+}
+
+bool CaptureIndexSummary::mayMatch(const CaptureIndexQuery& query) const
+{
+	if (query.m_HasTimeRange)
+	{
+		if (m_PacketCount == 0 || compareTimespec(m_EndTime, query.m_StartTime) < 0 || compareTimespec(m_StartTime, query.m_EndTime) > 0)
+			return false;
+	}
+
+	if (m_HasUnparsedPackets)
+		return true;
+
+	for (std::vector<ProtocolType>::const_iterator iter = query.m_Protocols.begin(); iter != query.m_Protocols.end(); iter++)
+	{
+		if ((m_Protocols & *iter) == 0)
+			return false;
+	}
+
+	for (std::vector<IPv4Address>::const_iterator iter = query.m_IPv4Addresses.begin(); iter != query.m_IPv4Addresses.end(); iter++)
+	{
+		uint32_t address = iter->toInt();
+		if (!m_Addresses.mayContain((const uint8_t*)&address, sizeof(address)))
+			return false;
+	}
+
+	for (std::vector<IPv6Address>::const_iterator iter = query.m_IPv6Addresses.begin(); iter != query.m_IPv6Addresses.end(); iter++)
+	{
+		uint8_t address[16];
+		iter->copyTo(address);
+		if (!m_Addresses.mayContain(address, sizeof(address)))
+			return false;
+	}
+
+	for (std::vector<uint16_t>::const_iterator iter = query.m_Ports.begin(); iter != query.m_Ports.end(); iter++)
+	{
+		uint8_t portBytes[2] = { (uint8_t)(*iter >> 8), (uint8_t)*iter };
+		if (!m_Ports.mayContain(portBytes, sizeof(portBytes)))
+			return false;
+	}
+
+	for (std::vector<std::string>::const_iterator iter = query.m_Flows.begin(); iter != query.m_Flows.end(); iter++)
+	{
+		if (iter->empty() || !m_Flows.mayContain((const uint8_t*)iter->data(), iter->size()))
+			return false;
+	}
+
+	return true;
+}
+
+void CaptureIndexSummary::serialize(std::vector<uint8_t>& buffer) const
+{
+	writeUint(buffer, m_FirstPacketIndex, 8);
+	writeUint(buffer, m_FileOffset, 8);
+	writeUint(buffer, m_PacketCount, 8);
+	writeUint(buffer, m_ByteCount, 8);
+	writeTimespec(buffer, m_StartTime);
+	writeTimespec(buffer, m_EndTime);
+	writeUint(buffer, m_Protocols, 8);
+	buffer.push_back(m_HasUnparsedPackets ? CAPTURE_INDEX_FLAG_UNPARSED_PACKETS : 0);
+	m_Addresses.serialize(buffer);
+	m_Ports.serialize(buffer);
+	m_Flows.serialize(buffer);
+}
+
+size_t CaptureIndexSummary::deserialize(const uint8_t* data, size_t dataLen)
+{
+	// first packet index, file offset, packet and byte counts, start and end time, protocols, flags
+	const size_t fixedLen = 8 + 8 + 8 + 8 + 12 + 12 + 8 + 1;
+	if (dataLen < fixedLen)
+		return 0;
+
+	m_FirstPacketIndex = readUint(data, 8);
+	m_FileOffset = readUint(data + 8, 8);
+	m_PacketCount = readUint(data + 16, 8);
+	m_ByteCount = readUint(data + 24, 8);
+	m_StartTime = readTimespec(data + 32);
+	m_EndTime = readTimespec(data + 44);
+	m_Protocols = readUint(data + 56, 8);
+	m_HasUnparsedPackets = ((data[64] & CAPTURE_INDEX_FLAG_UNPARSED_PACKETS) != 0);
+
+	size_t offset = fixedLen;
+	BloomFilter* filters[3] = { &m_Addresses, &m_Ports, &m_Flows };
+	for (int i = 0; i < 3; i++)
+	{
+		size_t filterLen = filters[i]->deserialize(data + offset, dataLen - offset);
+		if (filterLen == 0)
+			return 0;
+		offset += filterLen;
+	}
+
+	return offset;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~
+// CaptureIndex members
+// ~~~~~~~~~~~~~~~~~~~~
+
+CaptureIndex::CaptureIndex(uint64_t chunkSize)
+{
+	m_ChunkSize = chunkSize;
+	clear();
+}
+
+void CaptureIndex::clear()
+{
+	m_CaptureFileSize = 0;
+	m_FileSummary = CaptureIndexSummary();
+	m_Chunks.clear();
+	m_ProtocolMix.clear();
+	m_IsBuilding = false;
+	for (int i = 0; i < NumOfFilterTypes; i++)
+	{
+		m_FileItems[i].clear();
+		m_ChunkItems[i].clear();
+	}
+}
+
+void CaptureIndex::fillFilters(CaptureIndexSummary& summary, std::vector<uint64_t> items[NumOfFilterTypes])
+{
+	BloomFilter* filters[NumOfFilterTypes] = { &summary.m_Addresses, &summary.m_Ports, &summary.m_Flows };
+	for (int i = 0; i < NumOfFilterTypes; i++)
+	{
+		std::sort(items[i].begin(), items[i].end());
+		items[i].erase(std::unique(items[i].begin(), items[i].end()), items[i].end());
+
+		*filters[i] = BloomFilter(items[i].size());
+		for (std::vector<uint64_t>::iterator iter = items[i].begin(); iter != items[i].end(); iter++)
+			filters[i]->addHash(*iter);
+	}
+}
+
+void CaptureIndex::finishChunk()
+{
+	fillFilters(m_Chunks.back(), m_ChunkItems);
+
+	// the file items are made distinct when the file is finished, the distinct items of each chunk keep them from growing with the
+	// number of packets
+	for (int i = 0; i < NumOfFilterTypes; i++)
+	{
+		m_FileItems[i].insert(m_FileItems[i].end(), m_ChunkItems[i].begin(), m_ChunkItems[i].end());
+		m_ChunkItems[i].clear();
+	}
+}
+
+void CaptureIndex::startBuilding()
+{
+	clear();
+	m_IsBuilding = true;
+}
+
+bool CaptureIndex::addPacket(RawPacket& rawPacket, uint64_t fileOffset)
+{
+	if (!m_IsBuilding)
+	{
+		LOG_ERROR("Cannot add a packet to an index that isn't being built");
+		return false;
+	}
+
+	// the previous chunk was finished once its data reached the chunk size
+	if (m_Chunks.empty() || m_Chunks.back().m_ByteCount >= m_ChunkSize)
+	{
+		m_Chunks.push_back(CaptureIndexSummary());
+		m_Chunks.back().m_FirstPacketIndex = m_FileSummary.m_PacketCount;
+		m_Chunks.back().m_FileOffset = fileOffset;
+	}
+
+	ProtocolType protocols;
+	bool isParsed = collectPacketItems(rawPacket, m_ChunkItems, protocols);
+
+	timespec timestamp = rawPacket.getPacketTimeStamp();
+	uint64_t packetLen = rawPacket.getRawDataLen();
+	m_FileSummary.addPacketInfo(timestamp, packetLen, protocols, isParsed);
+	m_Chunks.back().addPacketInfo(timestamp, packetLen, protocols, isParsed);
+	m_ProtocolMix[protocols]++;
+
+	if (m_Chunks.back().m_ByteCount >= m_ChunkSize)
+		finishChunk();
+
+	return true;
+}
+
+bool CaptureIndex::addPackets(IFileReaderDevice& reader)
+{
+	if (!m_IsBuilding)
+	{
+		LOG_ERROR("Cannot add packets to an index that isn't being built");
+		return false;
+	}
+
+	if (!reader.isOpened())
+	{
+		LOG_ERROR("Cannot add packets to an index, reader of file '%s' isn't opened", reader.getFileName().c_str());
+		return false;
+	}
+
+	// the records of a pcap file follow its 24-byte header, each record is a header followed by the captured bytes
+	size_t recordHeaderLen = getPcapRecordHeaderLen(reader.getFileName());
+	uint64_t fileOffset = (recordHeaderLen > 0 ? 24 : CaptureIndexSummary::UnknownFileOffset);
+
+	RawPacket rawPacket;
+	while (reader.getNextPacket(rawPacket))
+	{
+		addPacket(rawPacket, fileOffset);
+		if (recordHeaderLen > 0)
+			fileOffset += recordHeaderLen + rawPacket.getRawDataLen();
+	}
+
+	return true;
+}
+
+bool CaptureIndex::finishBuilding(uint64_t captureFileSize)
+{
+	if (!m_IsBuilding)
+	{
+		LOG_ERROR("Cannot finish an index that isn't being built");
+		return false;
+	}
+
+	if (!m_Chunks.empty() && m_Chunks.back().m_ByteCount < m_ChunkSize)
+		finishChunk();
+
+	fillFilters(m_FileSummary, m_FileItems);
+
+	LOG_DEBUG("Built index: %d packets in %d chunks, %d addresses, %d ports, %d flows", (int)m_FileSummary.m_PacketCount, (int)m_Chunks.size(),
+			(int)m_FileItems[AddressFilter].size(), (int)m_FileItems[PortFilter].size(), (int)m_FileItems[FlowFilter].size());
+
+	for (int i = 0; i < NumOfFilterTypes; i++)
+		std::vector<uint64_t>().swap(m_FileItems[i]);
+
+	m_CaptureFileSize = captureFileSize;
+	m_IsBuilding = false;
+	return true;
+}
+
+bool CaptureIndex::build(IFileReaderDevice& reader)
+{
+	if (!reader.isOpened())
+	{
+		LOG_ERROR("Cannot build an index, reader of file '%s' isn't opened", reader.getFileName().c_str());
+		return false;
+	}
+
+	startBuilding();
+	addPackets(reader);
+	return finishBuilding(reader.getFileSize());
+}
+
+bool CaptureIndex::build(const std::string& captureFileName)
+{
+	IFileReaderDevice* reader = IFileReaderDevice::getReader(captureFileName.c_str());
+	if (!reader->open())
+	{
+		LOG_ERROR("Cannot build an index, couldn't open file '%s'", captureFileName.c_str());
+		delete reader;
+		return false;
+	}
+
+	bool result = build(*reader);
+	reader->close();
+	delete reader;
+	return result;
+}
+
+bool CaptureIndex::writeToFile(const std::string& indexFileName) const
+{
+	std::vector<uint8_t> buffer;
+	buffer.insert(buffer.end(), CAPTURE_INDEX_MAGIC, CAPTURE_INDEX_MAGIC + strlen(CAPTURE_INDEX_MAGIC));
+	buffer.push_back(CAPTURE_INDEX_VERSION);
+	writeUint(buffer, m_CaptureFileSize, 8);
+	writeUint(buffer, m_ChunkSize, 8);
+
+	writeUint(buffer, m_ProtocolMix.size(), 4);
+	for (std::map<ProtocolType, uint64_t>::const_iterator iter = m_ProtocolMix.begin(); iter != m_ProtocolMix.end(); iter++)
+	{
+		writeUint(buffer, iter->first, 8);
+		writeUint(buffer, iter->second, 8);
+	}
+
+	m_FileSummary.serialize(buffer);
+
+	writeUint(buffer, m_Chunks.size(), 4);
+	for (std::vector<CaptureIndexSummary>::const_iterator iter = m_Chunks.begin(); iter != m_Chunks.end(); iter++)
+		iter->serialize(buffer);
+
+	std::ofstream indexFile(indexFileName.c_str(), std::ofstream::binary | std::ofstream::trunc);
+	if (!indexFile.is_open())
+	{
+		LOG_ERROR("Couldn't open index file '%s' for writing", indexFileName.c_str());
+		return false;
+	}
+
+	indexFile.write((const char*)&buffer[0], buffer.size());
+	if (!indexFile.good())
+	{
+		LOG_ERROR("Couldn't write index file '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool CaptureIndex::readFromFile(const std::string& indexFileName)
+{
+	std::ifstream indexFile(indexFileName.c_str(), std::ifstream::binary);
+	if (!indexFile.is_open())
+	{
+		LOG_ERROR("Couldn't open index file '%s'", indexFileName.c_str());
+		return false;
+	}
+
+	std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(indexFile)), std::istreambuf_iterator<char>());
+
+	// magic, version, file size, chunk size, protocol mix size
+	size_t magicLen = strlen(CAPTURE_INDEX_MAGIC);
+	size_t offset = magicLen + 1 + 8 + 8 + 4;
+	if (buffer.size() < offset || memcmp(&buffer[0], CAPTURE_INDEX_MAGIC, magicLen) != 0 || buffer[magicLen] != CAPTURE_INDEX_VERSION)
+	{
+		LOG_ERROR("File '%s' isn't a valid index file", indexFileName.c_str());
+		return false;
+	}
+
+	clear();
+	const uint8_t* data = &buffer[0];
+	m_CaptureFileSize = readUint(data + magicLen + 1, 8);
+	m_ChunkSize = readUint(data + magicLen + 9, 8);
+
+	bool isValid = true;
+	size_t protocolMixSize = (size_t)readUint(data + offset - 4, 4);
+	if ((buffer.size() - offset) / 16 < protocolMixSize)
+		isValid = false;
+
+	for (size_t i = 0; isValid && i < protocolMixSize; i++, offset += 16)
+		m_ProtocolMix[readUint(data + offset, 8)] = readUint(data + offset + 8, 8);
+
+	size_t summaryLen = (isValid ? m_FileSummary.deserialize(data + offset, buffer.size() - offset) : 0);
+	offset += summaryLen;
+	if (summaryLen == 0 || buffer.size() - offset < 4)
+		isValid = false;
+
+	size_t numOfChunks = (isValid ? (size_t)readUint(data + offset, 4) : 0);
+	offset += 4;
+	for (size_t i = 0; isValid && i < numOfChunks; i++)
+	{
+		CaptureIndexSummary chunk;
+		summaryLen = chunk.deserialize(data + offset, buffer.size() - offset);
+		if (summaryLen == 0)
+			isValid = false;
+		else
+			m_Chunks.push_back(chunk);
+		offset += summaryLen;
+	}
+
+	if (!isValid)
+	{
+		LOG_ERROR("File '%s' isn't a valid index file", indexFileName.c_str());
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+std::string CaptureIndex::getIndexFileName(const std::string& captureFileName)
+{
+	return captureFileName + ".pcppidx";
+}
+
+bool CaptureIndex::isUpToDate(const std::string& captureFileName) const
+{
+	return m_CaptureFileSize != 0 && getCaptureFileSize(captureFileName) == m_CaptureFileSize;
+}
+
+bool CaptureIndex::mayMatch(const CaptureIndexQuery& query) const
+{
+	return m_FileSummary.mayMatch(query);
+}
+
+size_t CaptureIndex::getMatchingChunks(const CaptureIndexQuery& query, std::vector<const CaptureIndexSummary*>& chunks) const
+{
+	if (!mayMatch(query))
+		return 0;
+
+	size_t numOfChunksFound = 0;
+	for (std::vector<CaptureIndexSummary>::const_iterator iter = m_Chunks.begin(); iter != m_Chunks.end(); iter++)
+	{
+		if (iter->mayMatch(query))
+		{
+			chunks.push_back(&(*iter));
+			numOfChunksFound++;
+		}
+	}
+
+	return numOfChunksFound;
+}
+
+uint64_t CaptureIndex::getProtocolPacketCount(ProtocolType protocols) const
+{
+	uint64_t packetCount = 0;
+	for (std::map<ProtocolType, uint64_t>::const_iterator iter = m_ProtocolMix.begin(); iter != m_ProtocolMix.end(); iter++)
+	{
+		if ((iter->first & protocols) != 0)
+			packetCount += iter->second;
+	}
+
+	return packetCount;
+}
+
+} // namespace pcpp
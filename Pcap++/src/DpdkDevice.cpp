@@ -18,6 +18,8 @@
 #include "rte_errno.h"
 #include "rte_malloc.h"
 #include "rte_cycles.h"
+#include "PcapFilter.h"
+#include <pcap.h>
 #include <string>
 #include <stdint.h>
 #include <unistd.h>
@@ -56,6 +58,7 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 	: m_Id(port), m_MacAddress(MacAddress::Zero)
 {
 	snprintf((char*)m_DeviceName, 30, "DPDK_%d", m_Id);
+	m_BpfProgram = NULL;
 
 #if (RTE_VER_YEAR > 19) || (RTE_VER_YEAR == 19 && RTE_VER_MONTH >= 8)
 	struct rte_ether_addr etherAddr;
@@ -69,9 +72,14 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 
 	rte_eth_dev_get_mtu((uint8_t) m_Id, &m_DeviceMtu);
 
+	// the mbuf pool and the queues are allocated on the NUMA node of the device. If it's unknown, they're allocated on the
+	// NUMA node of the master core
+	m_NumaNode = rte_eth_dev_socket_id((uint8_t) m_Id);
+	m_MBufPoolSize = mBufPoolSize;
+
 	char mBufMemPoolName[32];
 	sprintf(mBufMemPoolName, "MBufMemPool%d", m_Id);
-	if (!initMemPool(m_MBufMempool, mBufMemPoolName, mBufPoolSize))
+	if (!initMemPool(m_MBufMempool, mBufMemPoolName, mBufPoolSize, (m_NumaNode >= 0 ? m_NumaNode : (int)rte_socket_id())))
 	{
 		LOG_ERROR("Could not initialize mBuf mempool. Device not initialized");
 		return;
@@ -86,6 +94,7 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 
 	m_TxBuffers = NULL;
 	m_TxBufferLastDrainTsc = NULL;
+	m_TxDroppedPackets = NULL;
 
 	m_DeviceOpened = false;
 	m_WasOpened = false;
@@ -94,11 +103,16 @@ DpdkDevice::DpdkDevice(int port, uint32_t mBufPoolSize)
 
 DpdkDevice::~DpdkDevice()
 {
+	clearFilter();
+
 	if (m_TxBuffers != NULL)
 		delete [] m_TxBuffers;
 
 	if (m_TxBufferLastDrainTsc != NULL)
 		delete [] m_TxBufferLastDrainTsc;
+
+	if (m_TxDroppedPackets != NULL)
+		delete [] m_TxDroppedPackets;
 }
 
 uint32_t DpdkDevice::getCurrentCoreId() const
@@ -141,6 +155,9 @@ bool DpdkDevice::openMultiQueues(uint16_t numOfRxQueuesToOpen, uint16_t numOfTxQ
 
 	m_Config = config;
 
+	if (m_Config.mBufPoolPerNumaNode && !initNumaNodeMemPools())
+		return false;
+
 	if (!configurePort(numOfRxQueuesToOpen, numOfTxQueuesToOpen))
 	{
 		m_DeviceOpened = false;
@@ -194,6 +211,12 @@ void DpdkDevice::close()
 		delete [] m_TxBufferLastDrainTsc;
 		m_TxBufferLastDrainTsc = NULL;
 	}
+
+	if (m_TxDroppedPackets != NULL)
+	{
+		delete [] m_TxDroppedPackets;
+		m_TxDroppedPackets = NULL;
+	}
 	
 	m_DeviceOpened = false;
 }
@@ -249,6 +272,28 @@ bool DpdkDevice::configurePort(uint8_t numOfRxQueues, uint8_t numOfTxQueues)
 	portConf.rx_adv_conf.rss_conf.rss_key_len = m_Config.rssKeyLength;
 	portConf.rx_adv_conf.rss_conf.rss_hf = convertRssHfToDpdkRssHf(m_Config.rssHashFunction);
 
+	// packets larger than an mbuf are received as chained mbufs, so multi-segment TX is enabled as well for sending them
+	if (m_Config.maxRxPacketLength > 0)
+	{
+#if (RTE_VER_YEAR < 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH < 8)
+		portConf.rxmode.jumbo_frame = 1;
+		portConf.rxmode.enable_scatter = 1;
+#else
+		rte_eth_dev_info devInfo;
+		rte_eth_dev_info_get(m_Id, &devInfo);
+		uint64_t rxOffloads = DEV_RX_OFFLOAD_SCATTER | DEV_RX_OFFLOAD_JUMBO_FRAME;
+		if ((devInfo.rx_offload_capa & rxOffloads) != rxOffloads || (devInfo.tx_offload_capa & DEV_TX_OFFLOAD_MULTI_SEGS) == 0)
+		{
+			LOG_ERROR("PMD '%s' doesn't support jumbo frames, scatter RX or multi-segment TX", m_PMDName.c_str());
+			return false;
+		}
+
+		portConf.rxmode.offloads |= rxOffloads;
+		portConf.txmode.offloads |= DEV_TX_OFFLOAD_MULTI_SEGS;
+#endif
+		portConf.rxmode.max_rx_pkt_len = m_Config.maxRxPacketLength;
+	}
+
 	int res = rte_eth_dev_configure((uint8_t) m_Id, numOfRxQueues, numOfTxQueues, &portConf);
 	if (res < 0)
 	{
@@ -277,10 +322,13 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 		return false;
 	}
 
+	// the descriptor rings are allocated on the device NUMA node, like the mbuf pool they refer to
+	unsigned int socketId = (m_NumaNode >= 0 ? (unsigned int)m_NumaNode : (unsigned int)SOCKET_ID_ANY);
+
 	for (uint8_t i = 0; i < numOfRxQueuesToInit; i++)
 	{
 		int ret = rte_eth_rx_queue_setup((uint8_t) m_Id, i,
-				m_Config.receiveDescriptorsNumber, 0,
+				m_Config.receiveDescriptorsNumber, socketId,
 				NULL, m_MBufMempool);
 
 		if (ret < 0)
@@ -292,11 +340,20 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 
 	LOG_DEBUG("Successfully initialized %d RX queues for device [%s]", numOfRxQueuesToInit, m_DeviceName);
 
+	struct rte_eth_txconf* txConf = NULL;
+#if (RTE_VER_YEAR < 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH < 8)
+	// some PMDs disable multi-segment TX by default, it's needed for sending chained mbufs
+	struct rte_eth_txconf multiSegTxConf = devInfo.default_txconf;
+	multiSegTxConf.txq_flags &= ~ETH_TXQ_FLAGS_NOMULTSEGS;
+	if (m_Config.maxRxPacketLength > 0)
+		txConf = &multiSegTxConf;
+#endif
+
 	for (uint8_t i = 0; i < numOfTxQueuesToInit; i++)
 	{
 		int ret = rte_eth_tx_queue_setup((uint8_t) m_Id, i,
 				m_Config.transmitDescriptorsNumber,
-					0, NULL);
+					socketId, txConf);
 		if (ret < 0)
 		{
 			LOG_ERROR("Failed to init TX queue #%d for port %d. Error was: '%s' [Error code: %d]", i, m_Id, rte_strerror(ret), ret);
@@ -310,13 +367,18 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 	if (m_TxBufferLastDrainTsc != NULL)
 		delete [] m_TxBufferLastDrainTsc;
 
+	if (m_TxDroppedPackets != NULL)
+		delete [] m_TxDroppedPackets;
+
 	m_TxBuffers = new rte_eth_dev_tx_buffer*[numOfTxQueuesToInit];
 	m_TxBufferLastDrainTsc = new uint64_t[numOfTxQueuesToInit];
 	memset(m_TxBufferLastDrainTsc, 0, sizeof(uint64_t)*numOfTxQueuesToInit);
+	m_TxDroppedPackets = new uint64_t[numOfTxQueuesToInit];
+	memset(m_TxDroppedPackets, 0, sizeof(uint64_t)*numOfTxQueuesToInit);
 
 	for (uint8_t i = 0; i < numOfTxQueuesToInit; i++)
 	{
-		m_TxBuffers[i] = (rte_eth_dev_tx_buffer*)rte_zmalloc_socket("tx_buffer", RTE_ETH_TX_BUFFER_SIZE(MAX_BURST_SIZE), 0, rte_eth_dev_socket_id(m_Id));
+		m_TxBuffers[i] = (rte_eth_dev_tx_buffer*)rte_zmalloc_socket("tx_buffer", RTE_ETH_TX_BUFFER_SIZE(MAX_BURST_SIZE), 0, m_NumaNode);
 
 		if (m_TxBuffers[i] == NULL)
 		{
@@ -331,6 +393,15 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 			LOG_ERROR("Failed to init TX buffer for port %d TX queue %d", m_Id, (int)i);
 			return false;
 		}
+
+		// packets the NIC doesn't accept when the buffer is flushed are freed and counted as TX drops of this queue
+		res = rte_eth_tx_buffer_set_err_callback(m_TxBuffers[i], rte_eth_tx_buffer_count_callback, &m_TxDroppedPackets[i]);
+
+		if (res != 0)
+		{
+			LOG_ERROR("Failed to set TX buffer error callback for port %d TX queue %d", m_Id, (int)i);
+			return false;
+		}
 	}
 
 	m_TxBufferDrainTsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * m_Config.flushTxBufferTimeout;
@@ -343,12 +414,12 @@ bool DpdkDevice::initQueues(uint8_t numOfRxQueuesToInit, uint8_t numOfTxQueuesTo
 }
 
 
-bool DpdkDevice::initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize)
+bool DpdkDevice::initMemPool(struct rte_mempool*& memPool, const char* mempoolName, uint32_t mBufPoolSize, int numaNode)
 {
 	bool ret = false;
 
 	// create mbuf pool
-	memPool = rte_pktmbuf_pool_create(mempoolName, mBufPoolSize, MEMPOOL_CACHE_SIZE, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	memPool = rte_pktmbuf_pool_create(mempoolName, mBufPoolSize, MEMPOOL_CACHE_SIZE, 0, RTE_MBUF_DEFAULT_BUF_SIZE, numaNode);
 	if (memPool == NULL)
 	{
 		LOG_ERROR("Failed to create packets memory pool for port %d, pool name: %s. Error was: '%s' [Error code: %d]",
@@ -356,12 +427,58 @@ bool DpdkDevice::initMemPool(struct rte_mempool*& memPool, const char* mempoolNa
 	}
 	else
 	{
-		LOG_DEBUG("Successfully initialized packets pool of size [%d] for device [%s]", mBufPoolSize, m_DeviceName);
+		LOG_DEBUG("Successfully initialized packets pool of size [%d] on NUMA node %d for device [%s]", mBufPoolSize, numaNode, m_DeviceName);
 		ret = true;
 	}
 	return ret;
 }
 
+bool DpdkDevice::initNumaNodeMemPools()
+{
+	// the pools are created once and kept when the device is closed and opened again, like the device's main pool
+	for (unsigned int lcoreId = 0; lcoreId < RTE_MAX_LCORE; lcoreId++)
+	{
+		if (!rte_lcore_is_enabled(lcoreId))
+			continue;
+
+		int numaNode = (int)rte_lcore_to_socket_id(lcoreId);
+		if (numaNode < 0 || numaNode >= RTE_MAX_NUMA_NODES)
+			continue;
+
+		if ((int)m_NumaNodeMBufMempools.size() <= numaNode)
+			m_NumaNodeMBufMempools.resize(numaNode + 1, NULL);
+
+		if (m_NumaNodeMBufMempools[numaNode] != NULL)
+			continue;
+
+		if (numaNode == m_NumaNode)
+		{
+			m_NumaNodeMBufMempools[numaNode] = m_MBufMempool;
+			continue;
+		}
+
+		char mBufMemPoolName[32];
+		snprintf(mBufMemPoolName, sizeof(mBufMemPoolName), "MBufMemPool%d_%d", m_Id, numaNode);
+		if (!initMemPool(m_NumaNodeMBufMempools[numaNode], mBufMemPoolName, m_MBufPoolSize, numaNode))
+		{
+			LOG_ERROR("Could not initialize mBuf mempool on NUMA node %d for device [%s]", numaNode, m_DeviceName);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+struct rte_mempool* DpdkDevice::getMBufMempoolForCurrentCore() const
+{
+	// threads which aren't DPDK cores have an unknown NUMA node and get the main pool
+	unsigned int numaNode = rte_socket_id();
+	if (numaNode < m_NumaNodeMBufMempools.size() && m_NumaNodeMBufMempools[numaNode] != NULL)
+		return m_NumaNodeMBufMempools[numaNode];
+
+	return m_MBufMempool;
+}
+
 bool DpdkDevice::startDevice()
 {
 	int ret = rte_eth_dev_start((uint8_t) m_Id);
@@ -433,11 +550,11 @@ void DpdkDevice::setDeviceInfo()
 		m_PMDType = PMD_IXGBEVF;
 	else if (m_PMDName == "librte_pmd_mlx4")
 		m_PMDType = PMD_MLX4;
-	else if (m_PMDName == "eth_null")
+	else if (m_PMDName == "eth_null" || m_PMDName == "net_null")
 		m_PMDType = PMD_NULL;
-	else if (m_PMDName == "eth_pcap")
+	else if (m_PMDName == "eth_pcap" || m_PMDName == "net_pcap")
 		m_PMDType = PMD_PCAP;
-	else if (m_PMDName == "eth_ring")
+	else if (m_PMDName == "eth_ring" || m_PMDName == "net_ring")
 		m_PMDType = PMD_RING;
 	else if (m_PMDName == "rte_virtio_pmd")
 		m_PMDType = PMD_VIRTIO;
@@ -449,13 +566,19 @@ void DpdkDevice::setDeviceInfo()
 		m_PMDType = PMD_UNKNOWN;
 
 #if (RTE_VER_YEAR < 18) || (RTE_VER_YEAR == 18 && RTE_VER_MONTH < 5) // before 18.05
-	char pciName[30];
+	// virtual devices don't have a PCI device, use the PMD name instead
+	if (portInfo.pci_dev != NULL)
+	{
+		char pciName[30];
 	#if (RTE_VER_YEAR > 17) || (RTE_VER_YEAR == 17 && RTE_VER_MONTH >= 11) // 17.11 - 18.02
-	rte_pci_device_name(&(portInfo.pci_dev->addr), pciName, 30);
+		rte_pci_device_name(&(portInfo.pci_dev->addr), pciName, 30);
 	#else // 16.11 - 17.11
-	rte_eal_pci_device_name(&(portInfo.pci_dev->addr), pciName, 30);
+		rte_eal_pci_device_name(&(portInfo.pci_dev->addr), pciName, 30);
 	#endif
-	m_PciAddress = std::string(pciName);
+		m_PciAddress = std::string(pciName);
+	}
+	else
+		m_PciAddress = m_PMDName;
 #else // 18.05 forward
 	m_PciAddress = std::string(portInfo.device->name);
 #endif 
@@ -497,40 +620,37 @@ void DpdkDevice::getLinkStatus(LinkStatus& linkStatus) const
 }
 
 
-bool DpdkDevice::initCoreConfigurationByCoreMask(CoreMask coreMask)
+bool DpdkDevice::initCoreConfigurationByCoreMask(const CoreMask& coreMask)
 {
-	int i = 0;
 	int numOfCores = getNumOfCores();
+	int highestCoreId = coreMask.getHighestCoreId();
 	clearCoreConfiguration();
-	while ((coreMask != 0) && (i < numOfCores))
-	{
-		if (coreMask & 1)
-		{
-			if (i == DpdkDeviceList::getInstance().getDpdkMasterCore().Id)
-			{
-				LOG_ERROR("Core %d is the master core, you can't use it for capturing threads", i);
-				clearCoreConfiguration();
-				return false;
-			}
-
-			if (!rte_lcore_is_enabled(i))
-			{
-				LOG_ERROR("Trying to use core #%d which isn't initialized by DPDK", i);
-				clearCoreConfiguration();
-				return false;
-			}
-			m_CoreConfiguration[i].IsCoreInUse = true;
-		}
 
-		coreMask = coreMask >> 1;
-		i++;
+	if (highestCoreId >= numOfCores || highestCoreId >= MAX_NUM_OF_CORES) // this mean coreMask contains a core that doesn't exist
+	{
+		LOG_ERROR("Trying to use a core [%d] that doesn't exist while machine has %d cores", highestCoreId, numOfCores);
+		return false;
 	}
 
-	if (coreMask != 0) // this mean coreMask contains a core that doesn't exist
+	for (int i = 0; i <= highestCoreId; i++)
 	{
-		LOG_ERROR("Trying to use a core [%d] that doesn't exist while machine has %d cores", i, numOfCores);
-		clearCoreConfiguration();
-		return false;
+		if (!coreMask.isCoreSet(i))
+			continue;
+
+		if (i == DpdkDeviceList::getInstance().getDpdkMasterCore().Id)
+		{
+			LOG_ERROR("Core %d is the master core, you can't use it for capturing threads", i);
+			clearCoreConfiguration();
+			return false;
+		}
+
+		if (!rte_lcore_is_enabled(i))
+		{
+			LOG_ERROR("Trying to use core #%d which isn't initialized by DPDK", i);
+			clearCoreConfiguration();
+			return false;
+		}
+		m_CoreConfiguration[i].IsCoreInUse = true;
 	}
 
 	return true;
@@ -585,7 +705,17 @@ bool DpdkDevice::startCaptureSingleThread(OnDpdkPacketsArriveCallback onPacketsA
 	return false;
 }
 
-bool DpdkDevice::startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask)
+bool DpdkDevice::isCoreOnDeviceNumaNode(uint32_t coreId) const
+{
+	if (m_NumaNode < 0)
+		return true;
+
+	int coreNumaNode = getNumaNodeOfCore((int)coreId);
+	return (coreNumaNode < 0 || coreNumaNode == m_NumaNode);
+}
+
+
+bool DpdkDevice::startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, const CoreMask& coreMask)
 {
 	if (!m_DeviceOpened)
 	{
@@ -610,6 +740,10 @@ bool DpdkDevice::startCaptureMultiThreads(OnDpdkPacketsArriveCallback onPacketsA
 		if (!m_CoreConfiguration[coreId].IsCoreInUse)
 			continue;
 
+		if (!isCoreOnDeviceNumaNode(coreId))
+			LOG_ERROR("Core %d polling RX queue %d of device [%s] is on NUMA node %d and the device is on NUMA node %d, packets will cross NUMA nodes",
+					coreId, rxQueue, m_DeviceName, getNumaNodeOfCore(coreId), m_NumaNode);
+
 		// create a new thread
 		m_CoreConfiguration[coreId].RxQueueId = rxQueue++;
 		int err = rte_eal_remote_launch(dpdkCaptureThreadMain, (void*)this, coreId);
@@ -661,6 +795,7 @@ int DpdkDevice::dpdkCaptureThreadMain(void *ptr)
 	while (likely(!pThis->m_StopThread))
 	{
 		uint32_t numOfPktsReceived = rte_eth_rx_burst(pThis->m_Id, queueId, mBufArray, MAX_BURST_SIZE);
+		numOfPktsReceived = pThis->filterPackets(mBufArray, numOfPktsReceived, queueId);
 
 		if (unlikely(numOfPktsReceived == 0))
 			continue;
@@ -729,6 +864,12 @@ void DpdkDevice::getStatistics(DpdkDeviceStats& stats) const
 		stats.txStats[i].bytesPerSec = (stats.txStats[i].bytes - m_PrevStats.txStats[i].bytes) / secsElapsed;
 	}
 
+	stats.aggregatedTxDroppedPackets = 0;
+	for (int i = 0; i < DPDK_MAX_TX_QUEUES; i++)
+		stats.txDroppedPackets[i] = (i < m_NumOfTxQueuesOpened ? m_TxDroppedPackets[i] : 0);
+	for (int i = 0; i < m_NumOfTxQueuesOpened; i++)
+		stats.aggregatedTxDroppedPackets += m_TxDroppedPackets[i];
+
 	//m_PrevStats = stats;
 	memcpy(&m_PrevStats, &stats, sizeof(m_PrevStats));
 }
@@ -737,21 +878,153 @@ void DpdkDevice::clearStatistics()
 {
 	rte_eth_stats_reset(m_Id);
 	memset(&m_PrevStats, 0 ,sizeof(m_PrevStats));
+	if (m_TxDroppedPackets != NULL)
+		memset(m_TxDroppedPackets, 0, sizeof(uint64_t)*m_NumOfTxQueuesOpened);
 }
 
 
 bool DpdkDevice::setFilter(GeneralFilter& filter)
 {
-	//TODO: I think DPDK supports filters
-	LOG_ERROR("Filters aren't supported in DPDK device");
-	return false;
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+	if (!filter.containsFilterSet())
+		return setFilter(filterAsString);
+
+	// there's no kernel stage to pre-filter in, the BPF string of the sets would only be one more pass over every mbuf, and one that
+	// drops values added to the sets later. So only the native program is set, the BPF string is kept for getFilter()
+	clearFilter();
+	if (!m_PostFilter.compile(filter))
+	{
+		LOG_ERROR("Cannot compile the filter set of the filter");
+		return false;
+	}
+
+	m_FilterAsString = filterAsString;
+	RxQueueFilterStats emptyStats;
+	memset(&emptyStats, 0, sizeof(emptyStats));
+	m_RxQueueFilterStats.assign(m_TotalAvailableRxQueues, emptyStats);
+
+	LOG_DEBUG("Native filter '%s' set on device [%s]", filterAsString.c_str(), m_DeviceName);
+	return true;
 }
 
 bool DpdkDevice::setFilter(std::string filterAsString)
 {
-	//TODO: I think DPDK supports filters
-	LOG_ERROR("Filters aren't supported in DPDK device");
-	return false;
+	LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
+	struct bpf_program* program = new bpf_program();
+	if (pcap_compile_nopcap(9000, LINKTYPE_ETHERNET, program, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Couldn't compile filter '%s'", filterAsString.c_str());
+		delete program;
+		return false;
+	}
+
+	clearFilter();
+	m_BpfProgram = program;
+	m_BpfJit.compile(m_BpfProgram);
+	m_FilterAsString = filterAsString;
+	RxQueueFilterStats emptyStats;
+	memset(&emptyStats, 0, sizeof(emptyStats));
+	m_RxQueueFilterStats.assign(m_TotalAvailableRxQueues, emptyStats);
+
+	LOG_DEBUG("Filter '%s' set on device [%s]", filterAsString.c_str(), m_DeviceName);
+	return true;
+}
+
+bool DpdkDevice::clearFilter()
+{
+	if (m_BpfProgram != NULL)
+	{
+		pcap_freecode(m_BpfProgram);
+		delete m_BpfProgram;
+		m_BpfProgram = NULL;
+	}
+
+	m_BpfJit.clear();
+	m_PostFilter.clear();
+	m_FilterAsString = "";
+	m_RxQueueFilterStats.clear();
+	return true;
+}
+
+bool DpdkDevice::getRxQueueFilterStats(uint16_t rxQueueId, RxQueueFilterStats& stats) const
+{
+	if (rxQueueId >= m_TotalAvailableRxQueues)
+	{
+		LOG_ERROR("RX queue ID #%d not available for this device", rxQueueId);
+		return false;
+	}
+
+	if (rxQueueId >= m_RxQueueFilterStats.size())
+	{
+		memset(&stats, 0, sizeof(stats));
+		return true;
+	}
+
+	stats = m_RxQueueFilterStats[rxQueueId];
+	return true;
+}
+
+void DpdkDevice::setPacketSampler(const PacketSampler& sampler)
+{
+	m_PacketSampler = sampler;
+	m_RxQueueSamplers.assign(m_TotalAvailableRxQueues, sampler);
+}
+
+const PacketSampler& DpdkDevice::getRxQueuePacketSampler(uint16_t rxQueueId) const
+{
+	if (rxQueueId >= m_RxQueueSamplers.size())
+		return m_PacketSampler;
+
+	return m_RxQueueSamplers[rxQueueId];
+}
+
+uint16_t DpdkDevice::filterPackets(struct rte_mbuf** mBufArray, uint16_t numOfMBufs, uint16_t rxQueueId) const
+{
+	bool useFilter = ((m_BpfProgram != NULL || m_PostFilter.isCompiled()) && rxQueueId < m_RxQueueFilterStats.size());
+	bool useSampler = (m_PacketSampler.getMethod() != PacketSampler::NoSampling && rxQueueId < m_RxQueueSamplers.size());
+	if (likely(!useFilter && !useSampler))
+		return numOfMBufs;
+
+	// compact the mbufs that pass the filter and the sampler to the beginning of the array and free the rest
+	struct pcap_pkthdr pktHdr;
+	memset(&pktHdr, 0, sizeof(pktHdr));
+	uint16_t numOfPassed = 0;
+	for (uint16_t index = 0; index < numOfMBufs; ++index)
+	{
+		struct rte_mbuf* mBuf = mBufArray[index];
+		const uint8_t* data = rte_pktmbuf_mtod(mBuf, const uint8_t*);
+		bool pass = true;
+
+		if (useFilter)
+		{
+			// a filter that contains a filter set is set as a native program only (see setFilter(GeneralFilter&))
+			if (m_PostFilter.isCompiled())
+				pass = m_PostFilter.matchPacket(data, rte_pktmbuf_data_len(mBuf), LINKTYPE_ETHERNET);
+			else if (likely(m_BpfJit.isCompiled()))
+				pass = m_BpfJit.matchPacket(data, rte_pktmbuf_data_len(mBuf), rte_pktmbuf_pkt_len(mBuf));
+			else
+			{
+				pktHdr.caplen = rte_pktmbuf_data_len(mBuf);
+				pktHdr.len = rte_pktmbuf_pkt_len(mBuf);
+				pass = (pcap_offline_filter(m_BpfProgram, &pktHdr, data) != 0);
+			}
+			if (pass)
+				m_RxQueueFilterStats[rxQueueId].packetsMatched++;
+			else
+				m_RxQueueFilterStats[rxQueueId].packetsDropped++;
+		}
+
+		if (pass && useSampler)
+			pass = m_RxQueueSamplers[rxQueueId].sample(data, rte_pktmbuf_data_len(mBuf), LINKTYPE_ETHERNET);
+
+		if (pass)
+			mBufArray[numOfPassed++] = mBuf;
+		else
+			rte_pktmbuf_free(mBuf);
+	}
+
+	return numOfPassed;
 }
 
 uint16_t DpdkDevice::receivePackets(MBufRawPacketVector& rawPacketsArr, uint16_t rxQueueId) const
@@ -776,6 +1049,7 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacketVector& rawPacketsArr, uint16_t
 
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
 	uint32_t numOfPktsReceived  = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, MAX_BURST_SIZE);
+	numOfPktsReceived = filterPackets(mBufArray, numOfPktsReceived, rxQueueId);
 
 	//the following line trashes the log with many messages. Uncomment only if necessary
 	//LOG_DEBUG("Captured %d packets", numOfPktsReceived);
@@ -827,6 +1101,7 @@ uint16_t DpdkDevice::receivePackets(MBufRawPacket** rawPacketsArr, uint16_t rawP
 
 	struct rte_mbuf* mBufArray[rawPacketArrLength];
 	uint16_t packetsReceived = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, rawPacketArrLength);
+	packetsReceived = filterPackets(mBufArray, packetsReceived, rxQueueId);
 	//LOG_DEBUG("Captured %d packets", rawPacketArrLength);
 
 	if (unlikely(packetsReceived <= 0))
@@ -871,6 +1146,7 @@ uint16_t DpdkDevice::receivePackets(Packet** packetsArr, uint16_t packetsArrLeng
 
 	struct rte_mbuf* mBufArray[packetsArrLength];
 	uint16_t packetsReceived = rte_eth_rx_burst(m_Id, rxQueueId, mBufArray, packetsArrLength);
+	packetsReceived = filterPackets(mBufArray, packetsReceived, rxQueueId);
 	//LOG_DEBUG("Captured %d packets", packetsArrLength);
 
 	if (unlikely(packetsReceived <= 0))
@@ -939,6 +1215,66 @@ static rte_mbuf* getNextPacketFromMBufRawPacket(void* packetStorage, int index)
 	return mbufRawPacket->getMBuf();
 }
 
+rte_mbuf* DpdkDevice::getMBufForSending(const RawPacket* rawPacket) const
+{
+	if (rawPacket->getObjectType() == MBUFRAWPACKET_OBJECT_TYPE)
+		return ((MBufRawPacket*)rawPacket)->getMBuf();
+
+	return createMBufFromData(rawPacket->getRawData(), rawPacket->getRawDataLen());
+}
+
+void DpdkDevice::releaseMBufAfterSending(const RawPacket* rawPacket, rte_mbuf* mBuf, bool sent)
+{
+	// a sent mbuf is freed by DPDK so the MBufRawPacket it belongs to shouldn't free it. An unsent mbuf stays with its
+	// MBufRawPacket, or is freed if it was allocated only for sending
+	if (rawPacket->getObjectType() == MBUFRAWPACKET_OBJECT_TYPE)
+		((MBufRawPacket*)rawPacket)->setFreeMbuf(!sent);
+	else if (!sent)
+		rte_pktmbuf_free(mBuf);
+}
+
+struct rte_mbuf* DpdkDevice::createMBufFromData(const uint8_t* data, int dataLen) const
+{
+	struct rte_mempool* mempool = getMBufMempoolForCurrentCore();
+	struct rte_mbuf* mBuf = rte_pktmbuf_alloc(mempool);
+	if (unlikely(mBuf == NULL))
+	{
+		LOG_ERROR("Couldn't allocate mbuf");
+		return NULL;
+	}
+
+	// copy the data directly to the mbuf, and chain more segments if it doesn't fit in one
+	struct rte_mbuf* lastSeg = mBuf;
+	int offset = 0;
+	while (true)
+	{
+		int segDataLen = RTE_MIN((int)rte_pktmbuf_tailroom(lastSeg), dataLen - offset);
+		memcpy(rte_pktmbuf_mtod(lastSeg, uint8_t*), data + offset, segDataLen);
+		lastSeg->data_len = segDataLen;
+		offset += segDataLen;
+
+		if (offset >= dataLen)
+			break;
+
+		struct rte_mbuf* newSeg = rte_pktmbuf_alloc(mempool);
+		if (unlikely(newSeg == NULL))
+		{
+			LOG_ERROR("Couldn't allocate mbuf segments for %d bytes of data", dataLen);
+			rte_pktmbuf_free(mBuf);
+			return NULL;
+		}
+
+		// only the first segment needs headroom
+		newSeg->data_off = 0;
+		lastSeg->next = newSeg;
+		lastSeg = newSeg;
+		mBuf->nb_segs++;
+	}
+
+	mBuf->pkt_len = dataLen;
+	return mBuf;
+}
+
 uint16_t DpdkDevice::sendPacketsInner(uint16_t txQueueId, void* packetStorage, PacketIterator iter, int arrLength, bool useTxBuffer)
 {
 	if (unlikely(!m_DeviceOpened))
@@ -1029,38 +1365,24 @@ uint16_t DpdkDevice::sendPackets(MBufRawPacket** rawPacketsArr, uint16_t arrLeng
 uint16_t DpdkDevice::sendPackets(Packet** packetsArr, uint16_t arrLength, uint16_t txQueueId, bool useTxBuffer)
 {
 	rte_mbuf* mBufArr[arrLength];
-	MBufRawPacketVector mBufVec;
-	MBufRawPacket* mBufRawPacketArr[arrLength];
 
-	for (size_t i = 0; i < arrLength; i++)
+	for (uint16_t i = 0; i < arrLength; i++)
 	{
-		MBufRawPacket* rawPacket = NULL;
-		uint8_t rawPacketType = packetsArr[i]->getRawPacketReadOnly()->getObjectType();
-		if (rawPacketType != MBUFRAWPACKET_OBJECT_TYPE)
-		{
-			rawPacket = new MBufRawPacket();
-			if (unlikely(!rawPacket->initFromRawPacket(packetsArr[i]->getRawPacketReadOnly(), this)))
-			{
-				delete rawPacket;
-				return 0;
-			}
-
-			mBufVec.pushBack(rawPacket);
-		}
-		else
+		const RawPacket* rawPacket = packetsArr[i]->getRawPacketReadOnly();
+		mBufArr[i] = getMBufForSending(rawPacket);
+		if (unlikely(mBufArr[i] == NULL))
 		{
-			rawPacket = (MBufRawPacket*)packetsArr[i]->getRawPacketReadOnly();
+			for (uint16_t j = 0; j < i; j++)
+				releaseMBufAfterSending(packetsArr[j]->getRawPacketReadOnly(), mBufArr[j], false);
+			return 0;
 		}
-
-		mBufArr[i] = rawPacket->getMBuf();
-		mBufRawPacketArr[i] = rawPacket;
 	}
 
 	uint16_t packetsSent = sendPacketsInner(txQueueId, (void*)mBufArr, getNextPacketFromMBufArray, arrLength, useTxBuffer);
 
-	bool needToFreeMbuf = (!useTxBuffer && (packetsSent != arrLength));
-	for (int index = 0; index < arrLength; index++)
-		mBufRawPacketArr[index]->setFreeMbuf(needToFreeMbuf);
+	// when using TX buffer all packets are handed over to DPDK, packets that weren't sent are freed by the buffer
+	for (uint16_t index = 0; index < arrLength; index++)
+		releaseMBufAfterSending(packetsArr[index]->getRawPacketReadOnly(), mBufArr[index], useTxBuffer || index < packetsSent);
 
 	return packetsSent;
 }
@@ -1069,39 +1391,23 @@ uint16_t DpdkDevice::sendPackets(RawPacketVector& rawPacketsVec, uint16_t txQueu
 {
 	size_t vecSize = rawPacketsVec.size();
 	rte_mbuf* mBufArr[vecSize];
-	MBufRawPacket* mBufRawPacketArr[vecSize];
-	MBufRawPacketVector mBufVec;
-	int mBufIndex = 0;
 
-	for (RawPacketVector::ConstVectorIterator iter = rawPacketsVec.begin(); iter != rawPacketsVec.end(); iter++)
+	for (size_t i = 0; i < vecSize; i++)
 	{
-		MBufRawPacket* rawPacket = NULL;
-		uint8_t rawPacketType = (*iter)->getObjectType();
-		if (rawPacketType != MBUFRAWPACKET_OBJECT_TYPE)
-		{
-			rawPacket = new MBufRawPacket();
-			if (unlikely(!rawPacket->initFromRawPacket(*iter, this)))
-			{
-				delete rawPacket;
-				return 0;
-			}
-
-			mBufVec.pushBack(rawPacket);
-		}
-		else
+		mBufArr[i] = getMBufForSending(rawPacketsVec.at(i));
+		if (unlikely(mBufArr[i] == NULL))
 		{
-			rawPacket = (MBufRawPacket*)(*iter);
+			for (size_t j = 0; j < i; j++)
+				releaseMBufAfterSending(rawPacketsVec.at(j), mBufArr[j], false);
+			return 0;
 		}
-
-		mBufRawPacketArr[mBufIndex] = rawPacket;
-		mBufArr[mBufIndex++] = rawPacket->getMBuf();
 	}
 
 	uint16_t packetsSent = sendPacketsInner(txQueueId, (void*)mBufArr, getNextPacketFromMBufArray, vecSize, useTxBuffer);
 
-	bool needToFreeMbuf = (!useTxBuffer && (packetsSent != vecSize));
-	for (size_t index = 0; index < rawPacketsVec.size(); index++)
-		mBufRawPacketArr[index]->setFreeMbuf(needToFreeMbuf);
+	// when using TX buffer all packets are handed over to DPDK, packets that weren't sent are freed by the buffer
+	for (size_t index = 0; index < vecSize; index++)
+		releaseMBufAfterSending(rawPacketsVec.at(index), mBufArr[index], useTxBuffer || index < packetsSent);
 
 	return packetsSent;
 }
@@ -1111,32 +1417,25 @@ uint16_t DpdkDevice::sendPackets(MBufRawPacketVector& rawPacketsVec, uint16_t tx
 	size_t vecSize = rawPacketsVec.size();
 	uint16_t packetsSent = sendPacketsInner(txQueueId, (void*)(&rawPacketsVec), getNextPacketFromMBufRawPacketVec, vecSize, useTxBuffer);
 
-	bool needToFreeMbuf = (!useTxBuffer && (packetsSent != vecSize));
-
+	// only the mbufs that weren't sent should be freed by their MBufRawPacket
 	for (size_t index = 0; index < vecSize; index++)
-		rawPacketsVec.at(index)->setFreeMbuf(needToFreeMbuf);
+		rawPacketsVec.at(index)->setFreeMbuf(!useTxBuffer && index >= packetsSent);
 
 	return packetsSent;
 }
 
 bool DpdkDevice::sendPacket(RawPacket& rawPacket, uint16_t txQueueId, bool useTxBuffer)
 {
-	uint8_t rawPacketType = rawPacket.getObjectType();
-	if (rawPacketType == MBUFRAWPACKET_OBJECT_TYPE)
-	{
-		bool packetSent = (sendPacketsInner(txQueueId, (MBufRawPacket*)&rawPacket, getNextPacketFromMBufRawPacket, 1, useTxBuffer) == 1);
-		bool needToFreeMbuf = (!useTxBuffer && !packetSent);
-		((MBufRawPacket*)&rawPacket)->setFreeMbuf(needToFreeMbuf);
-		return packetSent;
-	}
+	if (rawPacket.getObjectType() == MBUFRAWPACKET_OBJECT_TYPE)
+		return sendPacket((MBufRawPacket&)rawPacket, txQueueId, useTxBuffer);
 
-	MBufRawPacket mbufRawPacket;
-	if (unlikely(!mbufRawPacket.initFromRawPacket(&rawPacket, this)))
+	rte_mbuf* mBuf = createMBufFromData(rawPacket.getRawData(), rawPacket.getRawDataLen());
+	if (unlikely(mBuf == NULL))
 		return false;
 
-	bool packetSent = (sendPacketsInner(txQueueId, &mbufRawPacket, getNextPacketFromMBufRawPacket, 1, useTxBuffer) == 1);
-	bool needToFreeMbuf = (!useTxBuffer && !packetSent);
-	mbufRawPacket.setFreeMbuf(needToFreeMbuf);
+	bool packetSent = (sendPacketsInner(txQueueId, (void*)&mBuf, getNextPacketFromMBufArray, 1, useTxBuffer) == 1);
+	if (!useTxBuffer && !packetSent)
+		rte_pktmbuf_free(mBuf);
 
 	return packetSent;
 }
@@ -1151,17 +1450,31 @@ bool DpdkDevice::sendPacket(MBufRawPacket& rawPacket, uint16_t txQueueId, bool u
 
 bool DpdkDevice::sendPacket(Packet& packet, uint16_t txQueueId, bool useTxBuffer)
 {
-	return sendPacket(*(packet.getRawPacket()), txQueueId);
+	return sendPacket(*(packet.getRawPacket()), txQueueId, useTxBuffer);
 }
 
 int DpdkDevice::getAmountOfFreeMbufs() const
 {
-	return (int)rte_mempool_avail_count(m_MBufMempool);
+	int result = (int)rte_mempool_avail_count(m_MBufMempool);
+	for (size_t i = 0; i < m_NumaNodeMBufMempools.size(); i++)
+	{
+		if (m_NumaNodeMBufMempools[i] != NULL && m_NumaNodeMBufMempools[i] != m_MBufMempool)
+			result += (int)rte_mempool_avail_count(m_NumaNodeMBufMempools[i]);
+	}
+
+	return result;
 }
 
 int DpdkDevice::getAmountOfMbufsInUse() const
 {
-	return (int)rte_mempool_in_use_count(m_MBufMempool);
+	int result = (int)rte_mempool_in_use_count(m_MBufMempool);
+	for (size_t i = 0; i < m_NumaNodeMBufMempools.size(); i++)
+	{
+		if (m_NumaNodeMBufMempools[i] != NULL && m_NumaNodeMBufMempools[i] != m_MBufMempool)
+			result += (int)rte_mempool_in_use_count(m_NumaNodeMBufMempools[i]);
+	}
+
+	return result;
 }
 
 uint64_t DpdkDevice::convertRssHfToDpdkRssHf(uint64_t rssHF) const
@@ -44,7 +44,7 @@ namespace pcpp
 {
 
 bool DpdkDeviceList::m_IsDpdkInitialized = false;
-CoreMask DpdkDeviceList::m_CoreMask = 0;
+CoreMask DpdkDeviceList::m_CoreMask;
 uint32_t DpdkDeviceList::m_MBufPoolSizePerDevice = 0;
 
 DpdkDeviceList::DpdkDeviceList()
@@ -62,11 +62,7 @@ DpdkDeviceList::~DpdkDeviceList()
 	m_DpdkDeviceList.clear();
 }
 
-const uint32_t initDpdkArgc = 7;
-const uint32_t maxArgLen = 20;
-char** initDpdkArgv;
-
-bool DpdkDeviceList::initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore)
+bool DpdkDeviceList::initDpdk(const CoreMask& coreMask, uint32_t mBufPoolSizePerDevice, uint8_t masterCore, const std::vector<std::string>& additionalEalArgs)
 {
 	if (m_IsDpdkInitialized)
 	{
@@ -79,7 +75,18 @@ bool DpdkDeviceList::initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice,
 		}
 	}
 
-	if (!verifyHugePagesAndDpdkDriver())
+	// huge-pages aren't needed with --no-huge, and the DPDK kernel driver isn't needed when virtual devices are used
+	bool useHugePages = true;
+	bool useVirtualDevices = false;
+	for (std::vector<std::string>::const_iterator iter = additionalEalArgs.begin(); iter != additionalEalArgs.end(); iter++)
+	{
+		if (*iter == "--no-huge")
+			useHugePages = false;
+		else if (iter->compare(0, 6, "--vdev") == 0 || *iter == "--no-pci")
+			useVirtualDevices = true;
+	}
+
+	if (!verifyHugePagesAndDpdkDriver(useHugePages, !useVirtualDevices))
 	{
 		return false;
 	}
@@ -92,49 +99,37 @@ bool DpdkDeviceList::initDpdk(CoreMask coreMask, uint32_t mBufPoolSizePerDevice,
 		return false;
 	}
 
-
-	std::stringstream dpdkParamsStream;
-	dpdkParamsStream << "pcapplusplusapp ";
-	dpdkParamsStream << "-n ";
-	dpdkParamsStream << "2 ";
-	dpdkParamsStream << "-c ";
-	dpdkParamsStream << "0x" << std::hex << std::setw(2) << std::setfill('0') << coreMask << " ";
-	dpdkParamsStream << "--master-lcore ";
-	dpdkParamsStream << (int)masterCore;
-
-	std::string dpdkParamsArray[initDpdkArgc];
-	initDpdkArgv = new char*[initDpdkArgc];
-	uint32_t i = 0;
-    while (dpdkParamsStream.good() && i < initDpdkArgc){
-    	dpdkParamsStream >> dpdkParamsArray[i];
-    	initDpdkArgv[i] = new char[maxArgLen];
-    	strcpy(initDpdkArgv[i], dpdkParamsArray[i].c_str());
-        i++;
-    }
-
-    char* lastParam = initDpdkArgv[i-1];
-
-	for (i = 0; i < initDpdkArgc; i++)
+	std::vector<std::string> dpdkParams;
+	dpdkParams.push_back("pcapplusplusapp");
+	dpdkParams.push_back("-n");
+	dpdkParams.push_back("2");
+	dpdkParams.push_back("-c");
+	dpdkParams.push_back("0x" + coreMask.toHexString());
+	dpdkParams.push_back("--master-lcore");
+	std::stringstream masterCoreStream;
+	masterCoreStream << (int)masterCore;
+	dpdkParams.push_back(masterCoreStream.str());
+	dpdkParams.insert(dpdkParams.end(), additionalEalArgs.begin(), additionalEalArgs.end());
+
+	// EAL may keep pointers to the arguments (e.g the huge-pages file prefix) after rte_eal_init() returns, so they are never freed
+	int initDpdkArgc = (int)dpdkParams.size();
+	char** initDpdkArgv = new char*[initDpdkArgc + 1];
+	for (int i = 0; i < initDpdkArgc; i++)
 	{
+		initDpdkArgv[i] = new char[dpdkParams[i].length() + 1];
+		strcpy(initDpdkArgv[i], dpdkParams[i].c_str());
 		LOG_DEBUG("DPDK initialization params: %s", initDpdkArgv[i]);
 	}
+	initDpdkArgv[initDpdkArgc] = NULL;
 
 	optind = 1;
 	// init the EAL
-	int ret = rte_eal_init(initDpdkArgc, (char**)initDpdkArgv);
+	int ret = rte_eal_init(initDpdkArgc, initDpdkArgv);
 	if (ret < 0) {
 		LOG_ERROR("failed to init the DPDK EAL");
 		return false;
 	}
 
-	for (i = 0; i < initDpdkArgc-1; i++)
-	{
-		delete [] initDpdkArgv[i];
-	}
-	delete [] lastParam;
-
-	delete [] initDpdkArgv;
-
 	m_CoreMask = coreMask;
 	m_IsDpdkInitialized = true;
 
@@ -218,33 +213,39 @@ DpdkDevice* DpdkDeviceList::getDeviceByPciAddress(const std::string& pciAddr) co
 	return NULL;
 }
 
-bool DpdkDeviceList::verifyHugePagesAndDpdkDriver()
+bool DpdkDeviceList::verifyHugePagesAndDpdkDriver(bool verifyHugePages, bool verifyDpdkDriver)
 {
-	std::string execResult = executeShellCommand("cat /proc/meminfo | grep -s HugePages_Total | awk '{print $2}'");
-	// trim '\n' at the end
-	execResult.erase(std::remove(execResult.begin(), execResult.end(), '\n'), execResult.end());
+	if (verifyHugePages)
+	{
+		std::string execResult = executeShellCommand("cat /proc/meminfo | grep -s HugePages_Total | awk '{print $2}'");
+		// trim '\n' at the end
+		execResult.erase(std::remove(execResult.begin(), execResult.end(), '\n'), execResult.end());
 
-	// convert the result to long
-	char* endPtr;
-	long totalHugePages = strtol(execResult.c_str(), &endPtr, 10);
+		// convert the result to long
+		char* endPtr;
+		long totalHugePages = strtol(execResult.c_str(), &endPtr, 10);
 
-	LOG_DEBUG("Total number of huge-pages is %lu", totalHugePages);
+		LOG_DEBUG("Total number of huge-pages is %lu", totalHugePages);
 
-	if (totalHugePages <= 0)
-	{
-		LOG_ERROR("Huge pages aren't set, DPDK cannot be initialized. Please run <PcapPlusPlus_Root>/setup_dpdk.sh");
-		return false;
+		if (totalHugePages <= 0)
+		{
+			LOG_ERROR("Huge pages aren't set, DPDK cannot be initialized. Please run <PcapPlusPlus_Root>/setup_dpdk.sh");
+			return false;
+		}
 	}
 
-	execResult = executeShellCommand("lsmod | grep -s igb_uio");
-	if (execResult == "")
+	if (verifyDpdkDriver)
 	{
-		LOG_ERROR("igb_uio driver isn't loaded, DPDK cannot be initialized. Please run <PcapPlusPlus_Root>/setup_dpdk.sh");
-		return false;
+		std::string execResult = executeShellCommand("lsmod | grep -s igb_uio");
+		if (execResult == "")
+		{
+			LOG_ERROR("igb_uio driver isn't loaded, DPDK cannot be initialized. Please run <PcapPlusPlus_Root>/setup_dpdk.sh");
+			return false;
 
+		}
+		else
+			LOG_DEBUG("igb_uio driver is loaded");
 	}
-	else
-		LOG_DEBUG("igb_uio driver is loaded");
 
 	return true;
 }
@@ -293,7 +294,7 @@ int DpdkDeviceList::dpdkWorkerThreadStart(void *ptr)
 	return 0;
 }
 
-bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkWorkerThread*>& workerThreadsVec)
+bool DpdkDeviceList::startDpdkWorkerThreads(const CoreMask& coreMask, std::vector<DpdkWorkerThread*>& workerThreadsVec)
 {
 	if (!isInitialized())
 	{
@@ -301,23 +302,26 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 		return false;
 	}
 
-	CoreMask tempCoreMask = coreMask;
 	size_t numOfCoresInMask = 0;
-	int coreNum = 0;
-	while (tempCoreMask > 0)
+	int highestCoreId = coreMask.getHighestCoreId();
+	if (highestCoreId >= MAX_NUM_OF_CORES)
 	{
-		if (tempCoreMask & 1)
-		{
-			if (!rte_lcore_is_enabled(coreNum))
-			{
-				LOG_ERROR("Trying to use core #%d which isn't initialized by DPDK", coreNum);
-				return false;
-			}
+		LOG_ERROR("Core #%d is out of range, the highest supported core is #%d", highestCoreId, MAX_NUM_OF_CORES - 1);
+		return false;
+	}
 
-			numOfCoresInMask++;
+	for (int coreNum = 0; coreNum <= highestCoreId; coreNum++)
+	{
+		if (!coreMask.isCoreSet(coreNum))
+			continue;
+
+		if (!rte_lcore_is_enabled(coreNum))
+		{
+			LOG_ERROR("Trying to use core #%d which isn't initialized by DPDK", coreNum);
+			return false;
 		}
-		tempCoreMask = tempCoreMask >> 1;
-		coreNum++;
+
+		numOfCoresInMask++;
 	}
 
 	if (numOfCoresInMask == 0)
@@ -332,7 +336,7 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 		return false;
 	}
 
-	if (coreMask & getDpdkMasterCore().Mask)
+	if (coreMask.isCoreSet(getDpdkMasterCore().Id))
 	{
 		LOG_ERROR("Cannot run worker thread on DPDK master core");
 		return false;
@@ -344,7 +348,7 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 	while (iter != workerThreadsVec.end())
 	{
 		SystemCore core = SystemCores::IdToSystemCore[index];
-		if (!(coreMask & core.Mask))
+		if (!coreMask.isCoreSet(core.Id))
 		{
 			index++;
 			continue;
@@ -371,6 +375,69 @@ bool DpdkDeviceList::startDpdkWorkerThreads(CoreMask coreMask, std::vector<DpdkW
 	return true;
 }
 
+bool DpdkDeviceList::assignRxQueuesToCores(const std::vector<DpdkDevice*>& devices, const CoreMask& coreMask, std::vector<RxQueueCoreAssignment>& assignment) const
+{
+	assignment.clear();
+
+	if (coreMask.isCoreSet(getDpdkMasterCore().Id))
+	{
+		LOG_ERROR("Cannot assign RX queues to DPDK master core");
+		return false;
+	}
+
+	std::vector<SystemCore> cores;
+	createCoreVectorFromCoreMask(coreMask, cores);
+	if (cores.empty())
+	{
+		LOG_ERROR("Core mask is empty");
+		return false;
+	}
+
+	std::vector<int> coreLoad(cores.size(), 0);
+
+	for (std::vector<DpdkDevice*>::const_iterator iter = devices.begin(); iter != devices.end(); iter++)
+	{
+		DpdkDevice* device = *iter;
+		if (device == NULL || !device->isOpened())
+		{
+			LOG_ERROR("Cannot assign RX queues of a device which isn't opened");
+			assignment.clear();
+			return false;
+		}
+
+		for (uint16_t rxQueueId = 0; rxQueueId < device->getNumOfOpenedRxQueues(); rxQueueId++)
+		{
+			// find the least loaded core on the device NUMA node, and the least loaded core of all cores as a fallback
+			int localCoreIndex = -1;
+			int anyCoreIndex = -1;
+			for (size_t i = 0; i < cores.size(); i++)
+			{
+				if (anyCoreIndex < 0 || coreLoad[i] < coreLoad[anyCoreIndex])
+					anyCoreIndex = (int)i;
+
+				if (device->isCoreOnDeviceNumaNode(cores[i].Id) && (localCoreIndex < 0 || coreLoad[i] < coreLoad[localCoreIndex]))
+					localCoreIndex = (int)i;
+			}
+
+			RxQueueCoreAssignment queueAssignment;
+			queueAssignment.device = device;
+			queueAssignment.rxQueueId = rxQueueId;
+			queueAssignment.isCrossNuma = (localCoreIndex < 0);
+			int coreIndex = (queueAssignment.isCrossNuma ? anyCoreIndex : localCoreIndex);
+			queueAssignment.coreId = cores[coreIndex].Id;
+			coreLoad[coreIndex]++;
+
+			if (queueAssignment.isCrossNuma)
+				LOG_ERROR("None of the cores is on NUMA node %d of device [%s], RX queue %d is assigned to core %d on NUMA node %d. Packets of this queue will cross NUMA nodes",
+						device->getNumaNode(), device->getDeviceName().c_str(), rxQueueId, queueAssignment.coreId, getNumaNodeOfCore((int)queueAssignment.coreId));
+
+			assignment.push_back(queueAssignment);
+		}
+	}
+
+	return true;
+}
+
 void DpdkDeviceList::stopDpdkWorkerThreads()
 {
 	if (m_WorkerThreads.empty())
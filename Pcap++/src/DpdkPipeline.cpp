@@ -0,0 +1,781 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkDevice
+
+#include "DpdkPipeline.h"
+#include "PacketSampler.h"
+#include "Logger.h"
+
+#include <rte_config.h>
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_branch_prediction.h>
+#include <rte_ring.h>
+#include <rte_mbuf.h>
+#include <rte_version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <set>
+#include <sstream>
+
+#define PCPP_PIPELINE_MAX_BURST_SIZE 64
+
+namespace pcpp
+{
+
+// the burst functions of rte_ring got an additional parameter in DPDK 17.05
+static inline unsigned pipelineRingEnqueue(struct rte_ring* ring, MBufRawPacket** packets, unsigned count)
+{
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+	return rte_ring_enqueue_burst(ring, (void* const*)packets, count, NULL);
+#else
+	return rte_ring_enqueue_burst(ring, (void* const*)packets, count);
+#endif
+}
+
+static inline unsigned pipelineRingDequeue(struct rte_ring* ring, MBufRawPacket** packets, unsigned count)
+{
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 5, 0, 0)
+	return rte_ring_dequeue_burst(ring, (void**)packets, count, NULL);
+#else
+	return rte_ring_dequeue_burst(ring, (void**)packets, count);
+#endif
+}
+
+
+/**
+ * A worker thread running a single core of the pipeline. It's internal to DpdkPipeline and created in DpdkPipeline#start()
+ */
+class DpdkPipelineWorker : public DpdkWorkerThread
+{
+public:
+	DpdkPipeline::StageStats Stats;
+
+	// RX stage: the queues this core polls. TX stage: the single queue it sends to
+	std::vector<DpdkPipelineConfig::RxQueueConfig> RxQueues;
+	DpdkDevice* TxDevice;
+	uint16_t TxQueueId;
+
+	// worker stage: the stage copy this core runs, owned by the worker
+	DpdkPipelineStage* Stage;
+
+	struct rte_ring* InputRing;
+	std::vector<struct rte_ring*> NextRings;
+	struct rte_ring* PacketPool;
+	uint16_t BurstSize;
+
+	DpdkPipelineWorker(DpdkPipeline::StageType type, const std::string& name, uint32_t coreId) :
+		TxDevice(NULL), TxQueueId(0), Stage(NULL), InputRing(NULL), PacketPool(NULL), BurstSize(PCPP_PIPELINE_MAX_BURST_SIZE),
+		m_Stop(true), m_StartTsc(0), m_StopTsc(0), m_RoundRobin(0), m_CacheCount(0)
+	{
+		Stats.type = type;
+		Stats.name = name;
+		Stats.coreId = coreId;
+		resetStats();
+	}
+
+	~DpdkPipelineWorker()
+	{
+		delete Stage;
+	}
+
+	void resetStats()
+	{
+		Stats.packetsIn = 0;
+		Stats.packetsOut = 0;
+		Stats.packetsDropped = 0;
+		Stats.busyCycles = 0;
+		Stats.totalCycles = 0;
+		Stats.ringCapacity = 0;
+		Stats.ringCount = 0;
+		Stats.ringHighWatermark = 0;
+	}
+
+	void getStats(DpdkPipeline::StageStats& stats) const
+	{
+		stats = Stats;
+		if (m_StartTsc != 0)
+			stats.totalCycles = (m_StopTsc != 0 ? m_StopTsc : rte_rdtsc()) - m_StartTsc;
+	}
+
+	// return the packet objects held by this worker to the pool. Called after the worker stopped
+	void releaseCache()
+	{
+		recyclePackets(m_Cache, m_CacheCount);
+		m_CacheCount = 0;
+	}
+
+	bool run(uint32_t coreId)
+	{
+		Stats.coreId = coreId;
+		m_BucketCounts.resize(NextRings.size());
+		m_BucketStart.resize(NextRings.size());
+		m_Stop = false;
+		m_StopTsc = 0;
+		m_StartTsc = rte_rdtsc();
+
+		switch (Stats.type)
+		{
+		case DpdkPipeline::RxStage:
+			runRx();
+			break;
+		case DpdkPipeline::WorkerStage:
+			runWorker();
+			break;
+		case DpdkPipeline::TxStage:
+			runTx();
+			break;
+		}
+
+		m_StopTsc = rte_rdtsc();
+		return true;
+	}
+
+	void stop()
+	{
+		m_Stop = true;
+	}
+
+	uint32_t getCoreId() const
+	{
+		return Stats.coreId;
+	}
+
+private:
+	volatile bool m_Stop;
+	uint64_t m_StartTsc;
+	uint64_t m_StopTsc;
+	uint32_t m_RoundRobin;
+	MBufRawPacket* m_Cache[PCPP_PIPELINE_MAX_BURST_SIZE];
+	uint16_t m_CacheCount;
+	MBufRawPacket* m_Buckets[PCPP_PIPELINE_MAX_BURST_SIZE];
+	std::vector<uint16_t> m_BucketCounts;
+	std::vector<uint16_t> m_BucketStart;
+
+	void runRx()
+	{
+		size_t queueIndex = 0;
+		while (likely(!m_Stop))
+		{
+			uint64_t startTsc = rte_rdtsc();
+
+			// keep a burst worth of empty packet objects taken from the pool
+			if (m_CacheCount < BurstSize)
+				m_CacheCount += pipelineRingDequeue(PacketPool, m_Cache + m_CacheCount, BurstSize - m_CacheCount);
+
+			if (unlikely(m_CacheCount == 0))
+				continue;
+
+			const DpdkPipelineConfig::RxQueueConfig& rxQueue = RxQueues[queueIndex];
+			if (++queueIndex == RxQueues.size())
+				queueIndex = 0;
+
+			uint16_t packetsReceived = rxQueue.device->receivePackets(m_Cache, m_CacheCount, rxQueue.rxQueueId);
+			if (packetsReceived == 0)
+				continue;
+
+			Stats.packetsIn += packetsReceived;
+			forwardPackets(m_Cache, packetsReceived);
+
+			// move the objects that weren't used to the beginning of the cache
+			for (uint16_t i = packetsReceived; i < m_CacheCount; i++)
+				m_Cache[i - packetsReceived] = m_Cache[i];
+			m_CacheCount -= packetsReceived;
+
+			Stats.busyCycles += rte_rdtsc() - startTsc;
+		}
+	}
+
+	void runWorker()
+	{
+		MBufRawPacket* packets[PCPP_PIPELINE_MAX_BURST_SIZE];
+		while (likely(!m_Stop))
+		{
+			uint64_t startTsc = rte_rdtsc();
+
+			uint16_t numOfPackets = pollInputRing(packets);
+			if (numOfPackets == 0)
+				continue;
+
+			uint16_t packetsToForward = Stage->processPackets(packets, numOfPackets, Stats.coreId);
+			if (unlikely(packetsToForward > numOfPackets))
+				packetsToForward = numOfPackets;
+
+			if (packetsToForward < numOfPackets)
+			{
+				Stats.packetsDropped += numOfPackets - packetsToForward;
+				recyclePackets(packets + packetsToForward, numOfPackets - packetsToForward);
+			}
+
+			forwardPackets(packets, packetsToForward);
+
+			Stats.busyCycles += rte_rdtsc() - startTsc;
+		}
+	}
+
+	void runTx()
+	{
+		MBufRawPacket* packets[PCPP_PIPELINE_MAX_BURST_SIZE];
+		while (likely(!m_Stop))
+		{
+			uint64_t startTsc = rte_rdtsc();
+
+			uint16_t numOfPackets = pollInputRing(packets);
+			if (numOfPackets == 0)
+				continue;
+
+			// sendPackets() marks the mbufs that were sent so they aren't freed when the objects are recycled
+			uint16_t packetsSent = TxDevice->sendPackets(packets, numOfPackets, TxQueueId);
+			Stats.packetsOut += packetsSent;
+			Stats.packetsDropped += numOfPackets - packetsSent;
+			recyclePackets(packets, numOfPackets);
+
+			Stats.busyCycles += rte_rdtsc() - startTsc;
+		}
+	}
+
+	inline uint16_t pollInputRing(MBufRawPacket** packets)
+	{
+		uint32_t ringCount = rte_ring_count(InputRing);
+		Stats.ringCount = ringCount;
+		if (ringCount > Stats.ringHighWatermark)
+			Stats.ringHighWatermark = ringCount;
+
+		if (ringCount == 0)
+			return 0;
+
+		uint16_t numOfPackets = (uint16_t)pipelineRingDequeue(InputRing, packets, BurstSize);
+		Stats.packetsIn += numOfPackets;
+		return numOfPackets;
+	}
+
+	inline void recyclePackets(MBufRawPacket** packets, uint16_t numOfPackets)
+	{
+		if (numOfPackets == 0)
+			return;
+
+		// frees the mbufs that weren't handed over to the NIC
+		for (uint16_t i = 0; i < numOfPackets; i++)
+		{
+			packets[i]->clear();
+			packets[i]->setFreeMbuf(true);
+		}
+
+		// the pool ring is large enough to hold all the objects so this never fails
+		pipelineRingEnqueue(PacketPool, packets, numOfPackets);
+	}
+
+	inline void enqueuePackets(struct rte_ring* ring, MBufRawPacket** packets, uint16_t numOfPackets)
+	{
+		uint16_t packetsEnqueued = (uint16_t)pipelineRingEnqueue(ring, packets, numOfPackets);
+		Stats.packetsOut += packetsEnqueued;
+		if (unlikely(packetsEnqueued < numOfPackets))
+		{
+			Stats.packetsDropped += numOfPackets - packetsEnqueued;
+			recyclePackets(packets + packetsEnqueued, numOfPackets - packetsEnqueued);
+		}
+	}
+
+	void forwardPackets(MBufRawPacket** packets, uint16_t numOfPackets)
+	{
+		if (numOfPackets == 0)
+			return;
+
+		size_t numOfNextRings = NextRings.size();
+
+		// last stage without TX queues: the pipeline only analyzes the traffic
+		if (numOfNextRings == 0)
+		{
+			Stats.packetsOut += numOfPackets;
+			recyclePackets(packets, numOfPackets);
+			return;
+		}
+
+		if (numOfNextRings == 1)
+		{
+			enqueuePackets(NextRings[0], packets, numOfPackets);
+			return;
+		}
+
+		// sort the packets into per-ring buckets by flow so all packets of a flow reach the same core. Each packet goes to exactly one
+		// bucket, so the buckets are laid out consecutively in m_Buckets after counting them
+		uint16_t ringIndexes[PCPP_PIPELINE_MAX_BURST_SIZE];
+		for (size_t i = 0; i < numOfNextRings; i++)
+			m_BucketCounts[i] = 0;
+
+		for (uint16_t i = 0; i < numOfPackets; i++)
+		{
+			uint32_t hash;
+			if (!PacketSampler::calculateFlowHash(packets[i]->getRawData(), packets[i]->getRawDataLen(), packets[i]->getLinkLayerType(), 0, hash))
+				hash = m_RoundRobin++;
+
+			ringIndexes[i] = (uint16_t)(hash % numOfNextRings);
+			m_BucketCounts[ringIndexes[i]]++;
+		}
+
+		uint16_t offset = 0;
+		for (size_t i = 0; i < numOfNextRings; i++)
+		{
+			m_BucketStart[i] = offset;
+			offset += m_BucketCounts[i];
+			m_BucketCounts[i] = 0;
+		}
+
+		for (uint16_t i = 0; i < numOfPackets; i++)
+		{
+			uint16_t ringIndex = ringIndexes[i];
+			m_Buckets[m_BucketStart[ringIndex] + m_BucketCounts[ringIndex]++] = packets[i];
+		}
+
+		for (size_t i = 0; i < numOfNextRings; i++)
+		{
+			if (m_BucketCounts[i] > 0)
+				enqueuePackets(NextRings[i], m_Buckets + m_BucketStart[i], m_BucketCounts[i]);
+		}
+	}
+};
+
+
+static bool parseCoreList(const std::string& coreList, std::vector<uint32_t>& coreIds)
+{
+	std::stringstream stream(coreList);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		unsigned int first, last;
+		char extra;
+		if (sscanf(item.c_str(), "%u-%u%c", &first, &last, &extra) == 2)
+		{
+			if (first > last)
+				return false;
+		}
+		else if (sscanf(item.c_str(), "%u%c", &first, &extra) == 1)
+		{
+			last = first;
+		}
+		else
+		{
+			return false;
+		}
+
+		for (unsigned int core = first; core <= last; core++)
+			coreIds.push_back(core);
+	}
+
+	return !coreIds.empty();
+}
+
+bool DpdkPipelineConfig::applyCoreMapping(const std::string& mapping)
+{
+	// parse everything first so the configuration isn't changed if the mapping is invalid
+	std::vector<std::pair<std::string, std::vector<uint32_t> > > stageCores;
+
+	std::stringstream stream(mapping);
+	std::string item;
+	while (std::getline(stream, item, ';'))
+	{
+		// ignore whitespaces
+		std::string trimmedItem;
+		for (std::string::const_iterator iter = item.begin(); iter != item.end(); iter++)
+		{
+			if (!isspace(*iter))
+				trimmedItem += *iter;
+		}
+
+		if (trimmedItem.empty())
+			continue;
+
+		size_t separator = trimmedItem.find('=');
+		if (separator == std::string::npos || separator == 0)
+		{
+			LOG_ERROR("Malformed stage mapping '%s', expected 'stage=cores'", item.c_str());
+			return false;
+		}
+
+		std::string stageName = trimmedItem.substr(0, separator);
+		std::vector<uint32_t> coreIds;
+		if (!parseCoreList(trimmedItem.substr(separator + 1), coreIds))
+		{
+			LOG_ERROR("Malformed core list for stage '%s'", stageName.c_str());
+			return false;
+		}
+
+		if (stageName != "rx" && stageName != "tx")
+		{
+			bool stageFound = false;
+			for (std::vector<WorkerStageConfig>::const_iterator iter = workerStages.begin(); iter != workerStages.end(); iter++)
+			{
+				if (iter->name == stageName)
+				{
+					stageFound = true;
+					break;
+				}
+			}
+
+			if (!stageFound)
+			{
+				LOG_ERROR("Unknown pipeline stage '%s'", stageName.c_str());
+				return false;
+			}
+		}
+
+		stageCores.push_back(std::pair<std::string, std::vector<uint32_t> >(stageName, coreIds));
+	}
+
+	for (std::vector<std::pair<std::string, std::vector<uint32_t> > >::const_iterator iter = stageCores.begin(); iter != stageCores.end(); iter++)
+	{
+		const std::vector<uint32_t>& coreIds = iter->second;
+		if (iter->first == "rx")
+		{
+			for (size_t i = 0; i < rxQueues.size(); i++)
+				rxQueues[i].coreId = coreIds[i % coreIds.size()];
+		}
+		else if (iter->first == "tx")
+		{
+			for (size_t i = 0; i < txQueues.size(); i++)
+				txQueues[i].coreId = coreIds[i % coreIds.size()];
+		}
+		else
+		{
+			for (std::vector<WorkerStageConfig>::iterator stageIter = workerStages.begin(); stageIter != workerStages.end(); stageIter++)
+			{
+				if (stageIter->name == iter->first)
+					stageIter->coreIds = coreIds;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+DpdkPipeline::DpdkPipeline(const DpdkPipelineConfig& config) : m_Config(config), m_PacketPool(NULL), m_IsRunning(false)
+{
+}
+
+DpdkPipeline::~DpdkPipeline()
+{
+	if (m_IsRunning)
+		stop();
+
+	clearResources();
+}
+
+bool DpdkPipeline::verifyConfig() const
+{
+	if (m_Config.rxQueues.empty())
+	{
+		LOG_ERROR("Pipeline has no RX queues");
+		return false;
+	}
+
+	if (m_Config.burstSize == 0 || m_Config.burstSize > PCPP_PIPELINE_MAX_BURST_SIZE)
+	{
+		LOG_ERROR("Pipeline burst size must be between 1 and %d", PCPP_PIPELINE_MAX_BURST_SIZE);
+		return false;
+	}
+
+	if (m_Config.ringSize < m_Config.burstSize || m_Config.packetPoolSize < m_Config.burstSize)
+	{
+		LOG_ERROR("Pipeline ring size and packet pool size must be at least the burst size");
+		return false;
+	}
+
+	uint32_t masterCore = DpdkDeviceList::getInstance().getDpdkMasterCore().Id;
+
+	// a core may poll several RX queues but can't be shared between stages
+	std::set<uint32_t> rxCores;
+	for (std::vector<DpdkPipelineConfig::RxQueueConfig>::const_iterator iter = m_Config.rxQueues.begin(); iter != m_Config.rxQueues.end(); iter++)
+	{
+		if (iter->device == NULL || !iter->device->isOpened())
+		{
+			LOG_ERROR("Pipeline RX device is NULL or not opened");
+			return false;
+		}
+
+		if (iter->rxQueueId >= iter->device->getNumOfOpenedRxQueues())
+		{
+			LOG_ERROR("RX queue #%d isn't opened in device '%s'", iter->rxQueueId, iter->device->getDeviceName().c_str());
+			return false;
+		}
+
+		if (!iter->device->isCoreOnDeviceNumaNode(iter->coreId))
+			LOG_DEBUG("RX queue #%d of device '%s' is polled by core %d which is on another NUMA node", iter->rxQueueId,
+					iter->device->getDeviceName().c_str(), iter->coreId);
+
+		rxCores.insert(iter->coreId);
+	}
+
+	std::set<uint32_t> usedCores(rxCores);
+	std::vector<uint32_t> otherCores;
+
+	for (std::vector<DpdkPipelineConfig::WorkerStageConfig>::const_iterator iter = m_Config.workerStages.begin(); iter != m_Config.workerStages.end(); iter++)
+	{
+		if (iter->stage == NULL)
+		{
+			LOG_ERROR("Pipeline stage '%s' is NULL", iter->name.c_str());
+			return false;
+		}
+
+		if (iter->coreIds.empty())
+		{
+			LOG_ERROR("Pipeline stage '%s' has no cores", iter->name.c_str());
+			return false;
+		}
+
+		otherCores.insert(otherCores.end(), iter->coreIds.begin(), iter->coreIds.end());
+	}
+
+	for (std::vector<DpdkPipelineConfig::TxQueueConfig>::const_iterator iter = m_Config.txQueues.begin(); iter != m_Config.txQueues.end(); iter++)
+	{
+		if (iter->device == NULL || !iter->device->isOpened())
+		{
+			LOG_ERROR("Pipeline TX device is NULL or not opened");
+			return false;
+		}
+
+		if (iter->txQueueId >= iter->device->getNumOfOpenedTxQueues())
+		{
+			LOG_ERROR("TX queue #%d isn't opened in device '%s'", iter->txQueueId, iter->device->getDeviceName().c_str());
+			return false;
+		}
+
+		otherCores.push_back(iter->coreId);
+	}
+
+	for (std::vector<uint32_t>::const_iterator iter = otherCores.begin(); iter != otherCores.end(); iter++)
+	{
+		if (!usedCores.insert(*iter).second)
+		{
+			LOG_ERROR("Core #%d is used by more than one pipeline stage", *iter);
+			return false;
+		}
+	}
+
+	for (std::set<uint32_t>::const_iterator iter = usedCores.begin(); iter != usedCores.end(); iter++)
+	{
+		if (*iter >= MAX_NUM_OF_CORES)
+		{
+			LOG_ERROR("Core #%d is out of range", *iter);
+			return false;
+		}
+
+		if (*iter == masterCore)
+		{
+			LOG_ERROR("Pipeline stage can't run on DPDK master core #%d", *iter);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool DpdkPipeline::createRing(uint32_t size, bool singleProducer, struct rte_ring*& ring)
+{
+	static uint32_t ringCounter = 0;
+
+	char ringName[32];
+	snprintf(ringName, sizeof(ringName), "pcpp_pipeline_%u", ringCounter++);
+
+	unsigned flags = RING_F_SC_DEQ;
+	if (singleProducer)
+		flags |= RING_F_SP_ENQ;
+
+	// ring size must be a power of 2 and its usable capacity is one less than its size
+	ring = rte_ring_create(ringName, rte_align32pow2(size + 1), SOCKET_ID_ANY, flags);
+	if (ring == NULL)
+	{
+		LOG_ERROR("Couldn't create pipeline ring '%s' of size %d", ringName, size);
+		return false;
+	}
+
+	m_Rings.push_back(ring);
+	return true;
+}
+
+bool DpdkPipeline::start()
+{
+	if (m_IsRunning)
+	{
+		LOG_ERROR("Pipeline is already running");
+		return false;
+	}
+
+	if (!verifyConfig())
+		return false;
+
+	clearResources();
+
+	// the packet pool is shared by all cores so it's multi-producer and multi-consumer
+	char poolName[32];
+	static uint32_t poolCounter = 0;
+	snprintf(poolName, sizeof(poolName), "pcpp_pipeline_pool_%u", poolCounter++);
+	m_PacketPool = rte_ring_create(poolName, rte_align32pow2(m_Config.packetPoolSize + 1), SOCKET_ID_ANY, 0);
+	if (m_PacketPool == NULL)
+	{
+		LOG_ERROR("Couldn't create pipeline packet pool of size %d", m_Config.packetPoolSize);
+		return false;
+	}
+
+	m_Packets.reserve(m_Config.packetPoolSize);
+	for (uint32_t i = 0; i < m_Config.packetPoolSize; i++)
+	{
+		MBufRawPacket* packet = new MBufRawPacket();
+		m_Packets.push_back(packet);
+		rte_ring_enqueue(m_PacketPool, packet);
+	}
+
+	// RX workers: one per core, polling all the RX queues assigned to this core
+	std::vector<DpdkPipelineWorker*> previousLevel;
+	for (std::vector<DpdkPipelineConfig::RxQueueConfig>::const_iterator iter = m_Config.rxQueues.begin(); iter != m_Config.rxQueues.end(); iter++)
+	{
+		DpdkPipelineWorker* worker = NULL;
+		for (std::vector<DpdkPipelineWorker*>::iterator workerIter = previousLevel.begin(); workerIter != previousLevel.end(); workerIter++)
+		{
+			if ((*workerIter)->getCoreId() == iter->coreId)
+			{
+				worker = *workerIter;
+				break;
+			}
+		}
+
+		if (worker == NULL)
+		{
+			worker = new DpdkPipelineWorker(RxStage, "rx", iter->coreId);
+			previousLevel.push_back(worker);
+			m_Workers.push_back(worker);
+		}
+
+		worker->RxQueues.push_back(*iter);
+	}
+
+	// worker stages and then TX: every core has an input ring, fed by all the cores of the previous level
+	size_t numOfLevels = m_Config.workerStages.size() + (m_Config.txQueues.empty() ? 0 : 1);
+	for (size_t level = 0; level < numOfLevels; level++)
+	{
+		bool isTxLevel = (level == m_Config.workerStages.size());
+		size_t numOfCores = (isTxLevel ? m_Config.txQueues.size() : m_Config.workerStages[level].coreIds.size());
+
+		std::vector<DpdkPipelineWorker*> currentLevel;
+		for (size_t i = 0; i < numOfCores; i++)
+		{
+			DpdkPipelineWorker* worker;
+			if (isTxLevel)
+			{
+				const DpdkPipelineConfig::TxQueueConfig& txQueue = m_Config.txQueues[i];
+				worker = new DpdkPipelineWorker(TxStage, "tx", txQueue.coreId);
+				worker->TxDevice = txQueue.device;
+				worker->TxQueueId = txQueue.txQueueId;
+			}
+			else
+			{
+				const DpdkPipelineConfig::WorkerStageConfig& stage = m_Config.workerStages[level];
+				worker = new DpdkPipelineWorker(WorkerStage, stage.name, stage.coreIds[i]);
+				worker->Stage = stage.stage->clone();
+			}
+
+			m_Workers.push_back(worker);
+			currentLevel.push_back(worker);
+
+			if (!createRing(m_Config.ringSize, previousLevel.size() == 1, worker->InputRing))
+			{
+				clearResources();
+				return false;
+			}
+
+			worker->Stats.ringCapacity = rte_align32pow2(m_Config.ringSize + 1) - 1;
+
+			for (std::vector<DpdkPipelineWorker*>::iterator prevIter = previousLevel.begin(); prevIter != previousLevel.end(); prevIter++)
+				(*prevIter)->NextRings.push_back(worker->InputRing);
+		}
+
+		previousLevel = currentLevel;
+	}
+
+	// DpdkDeviceList assigns the workers to the cores in the core mask in ascending core order
+	std::vector<DpdkWorkerThread*> workersByCore;
+	std::vector<int> coreIds;
+	for (uint32_t coreId = 0; coreId < MAX_NUM_OF_CORES; coreId++)
+	{
+		for (std::vector<DpdkPipelineWorker*>::iterator iter = m_Workers.begin(); iter != m_Workers.end(); iter++)
+		{
+			if ((*iter)->getCoreId() == coreId)
+			{
+				(*iter)->PacketPool = m_PacketPool;
+				(*iter)->BurstSize = m_Config.burstSize;
+				workersByCore.push_back(*iter);
+				coreIds.push_back(coreId);
+			}
+		}
+	}
+
+	if (!DpdkDeviceList::getInstance().startDpdkWorkerThreads(createCoreMaskFromCoreIds(coreIds), workersByCore))
+	{
+		LOG_ERROR("Couldn't start pipeline worker threads");
+		clearResources();
+		return false;
+	}
+
+	m_IsRunning = true;
+	LOG_DEBUG("Pipeline started on %d cores", (int)m_Workers.size());
+	return true;
+}
+
+void DpdkPipeline::stop()
+{
+	if (!m_IsRunning)
+		return;
+
+	DpdkDeviceList::getInstance().stopDpdkWorkerThreads();
+	m_IsRunning = false;
+
+	// return all packets to the pool so their mbufs are freed. The workers and rings are kept so the statistics can still be read
+	for (std::vector<DpdkPipelineWorker*>::iterator iter = m_Workers.begin(); iter != m_Workers.end(); iter++)
+		(*iter)->releaseCache();
+
+	for (std::vector<MBufRawPacket*>::iterator iter = m_Packets.begin(); iter != m_Packets.end(); iter++)
+		(*iter)->clear();
+
+	LOG_DEBUG("Pipeline stopped");
+}
+
+void DpdkPipeline::clearResources()
+{
+	for (std::vector<DpdkPipelineWorker*>::iterator iter = m_Workers.begin(); iter != m_Workers.end(); iter++)
+		delete *iter;
+	m_Workers.clear();
+
+	for (std::vector<MBufRawPacket*>::iterator iter = m_Packets.begin(); iter != m_Packets.end(); iter++)
+		delete *iter;
+	m_Packets.clear();
+
+// rte_ring_free() is available since DPDK 17.02. In older versions the rings are never freed
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 2, 0, 0)
+	for (std::vector<struct rte_ring*>::iterator iter = m_Rings.begin(); iter != m_Rings.end(); iter++)
+		rte_ring_free(*iter);
+
+	if (m_PacketPool != NULL)
+		rte_ring_free(m_PacketPool);
+#endif
+
+	m_Rings.clear();
+	m_PacketPool = NULL;
+}
+
+void DpdkPipeline::getStageStats(std::vector<StageStats>& stats) const
+{
+	stats.clear();
+	for (std::vector<DpdkPipelineWorker*>::const_iterator iter = m_Workers.begin(); iter != m_Workers.end(); iter++)
+	{
+		StageStats workerStats;
+		(*iter)->getStats(workerStats);
+		stats.push_back(workerStats);
+	}
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,153 @@
+#ifdef USE_DPDK
+
+#define LOG_MODULE PcapLogModuleDpdkDevice
+
+#include "DpdkTxContext.h"
+#include "Logger.h"
+
+#include <rte_config.h>
+#include <rte_common.h>
+#include <rte_cycles.h>
+#include <rte_branch_prediction.h>
+#include <rte_ethdev.h>
+#include <rte_mbuf.h>
+
+namespace pcpp
+{
+
+const uint16_t DpdkTxContext::MaxBurstSize;
+
+DpdkTxContext::DpdkTxContext(DpdkDevice* device, uint16_t txQueueId, uint16_t burstSize, uint32_t flushTimeoutUsec)
+{
+	m_Device = device;
+	m_TxQueueId = txQueueId;
+	m_BurstSize = RTE_MAX(RTE_MIN(burstSize, MaxBurstSize), (uint16_t)1);
+	m_NumOfPendingPackets = 0;
+	m_FlushDeadlineTsc = 0;
+	m_PacketsSent = 0;
+	m_PacketsDropped = 0;
+
+	// round the number of cycles per microsecond up so short timeouts don't become 0 on slow TSCs
+	m_FlushTimeoutTsc = ((rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S) * flushTimeoutUsec;
+
+	if (m_Device == NULL)
+	{
+		LOG_ERROR("Cannot create TX context for a NULL device");
+	}
+	else if (txQueueId >= m_Device->getTotalNumOfTxQueues())
+	{
+		LOG_ERROR("TX queue %d is out of range for device [%s]. Device has %d TX queues", txQueueId, m_Device->getDeviceName().c_str(), m_Device->getTotalNumOfTxQueues());
+		m_Device = NULL;
+	}
+
+	m_PendingMBufs = new struct rte_mbuf*[m_BurstSize];
+}
+
+DpdkTxContext::~DpdkTxContext()
+{
+	flush();
+	delete [] m_PendingMBufs;
+}
+
+bool DpdkTxContext::sendPacket(RawPacket& rawPacket)
+{
+	if (unlikely(m_Device == NULL))
+	{
+		m_PacketsDropped++;
+		return false;
+	}
+
+	struct rte_mbuf* mBuf = m_Device->getMBufForSending(&rawPacket);
+	if (unlikely(mBuf == NULL))
+	{
+		m_PacketsDropped++;
+		return false;
+	}
+
+	// the mbuf now belongs to the pending burst
+	DpdkDevice::releaseMBufAfterSending(&rawPacket, mBuf, true);
+
+	uint64_t curTsc = rte_rdtsc();
+	if (m_NumOfPendingPackets == 0)
+		m_FlushDeadlineTsc = curTsc + m_FlushTimeoutTsc;
+
+	m_PendingMBufs[m_NumOfPendingPackets++] = mBuf;
+
+	if (m_NumOfPendingPackets >= m_BurstSize || (m_FlushTimeoutTsc > 0 && curTsc >= m_FlushDeadlineTsc))
+		flush();
+
+	return true;
+}
+
+uint16_t DpdkTxContext::sendPackets(MBufRawPacket** rawPacketsArr, uint16_t arrLength)
+{
+	uint16_t packetsAdded = 0;
+	for (uint16_t i = 0; i < arrLength; i++)
+	{
+		if (sendPacket(*rawPacketsArr[i]))
+			packetsAdded++;
+	}
+
+	return packetsAdded;
+}
+
+uint16_t DpdkTxContext::sendPackets(Packet** packetsArr, uint16_t arrLength)
+{
+	uint16_t packetsAdded = 0;
+	for (uint16_t i = 0; i < arrLength; i++)
+	{
+		if (sendPacket(*packetsArr[i]))
+			packetsAdded++;
+	}
+
+	return packetsAdded;
+}
+
+uint16_t DpdkTxContext::flush()
+{
+	if (m_NumOfPendingPackets == 0)
+		return 0;
+
+	if (unlikely(m_Device == NULL || !m_Device->isOpened() || m_TxQueueId >= m_Device->getNumOfOpenedTxQueues()))
+	{
+		LOG_ERROR("Device is not opened or TX queue %d is not opened, dropping %d pending packets", m_TxQueueId, m_NumOfPendingPackets);
+		dropPendingPackets(0);
+		return 0;
+	}
+
+	uint16_t packetsSent = rte_eth_tx_burst(m_Device->getDeviceId(), m_TxQueueId, m_PendingMBufs, m_NumOfPendingPackets);
+
+	// a full TX ring usually has room again after a single retry, anything left after that is dropped rather than stalling the core
+	if (packetsSent < m_NumOfPendingPackets)
+		packetsSent += rte_eth_tx_burst(m_Device->getDeviceId(), m_TxQueueId, m_PendingMBufs + packetsSent, m_NumOfPendingPackets - packetsSent);
+
+	m_PacketsSent += packetsSent;
+	dropPendingPackets(packetsSent);
+
+	return packetsSent;
+}
+
+uint16_t DpdkTxContext::flushIfExpired()
+{
+	if (m_NumOfPendingPackets == 0 || m_FlushTimeoutTsc == 0 || rte_rdtsc() < m_FlushDeadlineTsc)
+		return 0;
+
+	return flush();
+}
+
+void DpdkTxContext::dropPendingPackets(uint16_t fromIndex)
+{
+	uint16_t numOfDropped = m_NumOfPendingPackets - fromIndex;
+	for (uint16_t i = fromIndex; i < m_NumOfPendingPackets; i++)
+		rte_pktmbuf_free(m_PendingMBufs[i]);
+
+	m_PacketsDropped += numOfDropped;
+	if (numOfDropped > 0 && m_Device != NULL && m_Device->m_TxDroppedPackets != NULL)
+		m_Device->m_TxDroppedPackets[m_TxQueueId] += numOfDropped;
+
+	m_NumOfPendingPackets = 0;
+}
+
+} // namespace pcpp
+
+#endif /* USE_DPDK */
@@ -0,0 +1,623 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "FilterSet.h"
+#include "Logger.h"
+#include "EndianPortable.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+// IPPrefixSet entry flags
+#define FILTER_SET_ENTRY_USED       0x01
+#define FILTER_SET_ENTRY_IPV6       0x02
+
+#define FILTER_SET_INITIAL_CAPACITY 16
+
+// An atomic add and a full memory barrier, used by lookups to announce themselves and by updates to publish snapshots
+#if defined(_MSC_VER)
+#define FILTER_SET_ATOMIC_ADD(ptr, value) InterlockedExchangeAdd((volatile LONG*)(ptr), value)
+#define FILTER_SET_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define FILTER_SET_ATOMIC_ADD(ptr, value) __sync_fetch_and_add(ptr, value)
+#define FILTER_SET_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+namespace pcpp
+{
+
+namespace
+{
+
+class ScopedLock
+{
+public:
+	ScopedLock(pthread_mutex_t* mutex) : m_Mutex(mutex) { pthread_mutex_lock(m_Mutex); }
+	~ScopedLock() { pthread_mutex_unlock(m_Mutex); }
+private:
+	pthread_mutex_t* m_Mutex;
+};
+
+inline uint64_t highMask(uint8_t length)
+{
+	if (length == 0)
+		return 0;
+
+	return (length >= 64 ? ~(uint64_t)0 : ~(uint64_t)0 << (64 - length));
+}
+
+inline uint64_t lowMask(uint8_t length)
+{
+	if (length <= 64)
+		return 0;
+
+	return (length >= 128 ? ~(uint64_t)0 : ~(uint64_t)0 << (128 - length));
+}
+
+inline uint64_t mix(uint64_t value)
+{
+	// the 64-bit finalizer of MurmurHash3
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+inline size_t hashPrefix(uint64_t high, uint64_t low, uint8_t length, bool isIPv6)
+{
+	return (size_t)mix(high ^ mix(low ^ ((uint64_t)length << 1) ^ (isIPv6 ? 1 : 0)));
+}
+
+inline uint64_t readUint64(const uint8_t* data)
+{
+	uint64_t result = 0;
+	for (int i = 0; i < 8; i++)
+		result = (result << 8) | data[i];
+	return result;
+}
+
+} // namespace
+
+
+FilterSet::ScopedReader::ScopedReader(const FilterSet* set) : m_Set(set)
+{
+	// the counter is incremented with a full barrier, so either the update that waits for this slot sees the lookup, or the lookup
+	// reads the snapshot the update published
+	m_Slot = set->m_ReaderSlot;
+	FILTER_SET_ATOMIC_ADD(&set->m_NumOfReaders[m_Slot], 1);
+}
+
+FilterSet::ScopedReader::~ScopedReader()
+{
+	FILTER_SET_ATOMIC_ADD(&m_Set->m_NumOfReaders[m_Slot], -1);
+}
+
+FilterSet::FilterSet() : m_Version(0), m_RefCount(1), m_ReaderSlot(0)
+{
+	m_NumOfReaders[0] = 0;
+	m_NumOfReaders[1] = 0;
+	pthread_mutex_init(&m_UpdateMutex, NULL);
+	pthread_mutex_init(&m_RefCountMutex, NULL);
+}
+
+FilterSet::~FilterSet()
+{
+	pthread_mutex_destroy(&m_RefCountMutex);
+	pthread_mutex_destroy(&m_UpdateMutex);
+}
+
+void FilterSet::waitForReaders()
+{
+	// a lookup that started before the update is counted in one of the two slots, possibly in the one it read before a previous update
+	// switched it, so both slots are drained. New lookups are directed to the other slot before a slot is drained, so they can't keep
+	// it busy
+	for (int i = 0; i < 2; i++)
+	{
+		int drainedSlot = m_ReaderSlot;
+		m_ReaderSlot = 1 - drainedSlot;
+		FILTER_SET_MEMORY_BARRIER();
+		// read with an atomic operation so the snapshot reads of the lookups are done before the old snapshot is freed
+		while (FILTER_SET_ATOMIC_ADD(&m_NumOfReaders[drainedSlot], 0) != 0)
+			sched_yield();
+	}
+}
+
+void FilterSet::addRef()
+{
+	pthread_mutex_lock(&m_RefCountMutex);
+	m_RefCount++;
+	pthread_mutex_unlock(&m_RefCountMutex);
+}
+
+uint32_t FilterSet::getVersion() const
+{
+	return m_Version;
+}
+
+void FilterSet::release()
+{
+	pthread_mutex_lock(&m_RefCountMutex);
+	bool isLastReference = (--m_RefCount == 0);
+	pthread_mutex_unlock(&m_RefCountMutex);
+
+	if (isLastReference)
+		delete this;
+}
+
+
+IPPrefixSet::Table::Table()
+{
+	Entry emptyEntry;
+	memset(&emptyEntry, 0, sizeof(emptyEntry));
+	entries.assign(FILTER_SET_INITIAL_CAPACITY, emptyEntry);
+	numOfEntries = 0;
+	memset(lengthCount, 0, sizeof(lengthCount));
+}
+
+bool IPPrefixSet::Table::find(uint64_t high, uint64_t low, uint8_t length, bool isIPv6) const
+{
+	uint8_t flags = FILTER_SET_ENTRY_USED | (isIPv6 ? FILTER_SET_ENTRY_IPV6 : 0);
+	size_t mask = entries.size() - 1;
+	size_t index = hashPrefix(high, low, length, isIPv6) & mask;
+	while (entries[index].flags != 0)
+	{
+		const Entry& entry = entries[index];
+		if (entry.high == high && entry.low == low && entry.length == length && entry.flags == flags)
+			return true;
+
+		index = (index + 1) & mask;
+	}
+
+	return false;
+}
+
+bool IPPrefixSet::Table::lookup(uint64_t high, uint64_t low, bool isIPv6) const
+{
+	const std::vector<uint8_t>& familyLengths = lengths[isIPv6 ? 1 : 0];
+	for (std::vector<uint8_t>::const_iterator iter = familyLengths.begin(); iter != familyLengths.end(); iter++)
+	{
+		if (find(high & highMask(*iter), low & lowMask(*iter), *iter, isIPv6))
+			return true;
+	}
+
+	return false;
+}
+
+void IPPrefixSet::Table::grow()
+{
+	std::vector<Entry> oldEntries;
+	oldEntries.swap(entries);
+
+	Entry emptyEntry;
+	memset(&emptyEntry, 0, sizeof(emptyEntry));
+	entries.assign(oldEntries.size() * 2, emptyEntry);
+
+	size_t mask = entries.size() - 1;
+	for (std::vector<Entry>::const_iterator iter = oldEntries.begin(); iter != oldEntries.end(); iter++)
+	{
+		if (iter->flags == 0)
+			continue;
+
+		size_t index = hashPrefix(iter->high, iter->low, iter->length, (iter->flags & FILTER_SET_ENTRY_IPV6) != 0) & mask;
+		while (entries[index].flags != 0)
+			index = (index + 1) & mask;
+		entries[index] = *iter;
+	}
+}
+
+bool IPPrefixSet::Table::insert(const Prefix& prefix)
+{
+	if (find(prefix.high, prefix.low, prefix.length, prefix.isIPv6))
+		return false;
+
+	// keep the load factor at 1/2 at most so probe sequences stay short
+	if ((numOfEntries + 1) * 2 > entries.size())
+		grow();
+
+	size_t mask = entries.size() - 1;
+	size_t index = hashPrefix(prefix.high, prefix.low, prefix.length, prefix.isIPv6) & mask;
+	while (entries[index].flags != 0)
+		index = (index + 1) & mask;
+
+	Entry& entry = entries[index];
+	entry.high = prefix.high;
+	entry.low = prefix.low;
+	entry.length = prefix.length;
+	entry.flags = FILTER_SET_ENTRY_USED | (prefix.isIPv6 ? FILTER_SET_ENTRY_IPV6 : 0);
+	numOfEntries++;
+
+	int family = (prefix.isIPv6 ? 1 : 0);
+	if (lengthCount[family][prefix.length]++ == 0)
+		updateLengths(prefix.isIPv6);
+
+	return true;
+}
+
+bool IPPrefixSet::Table::erase(const Prefix& prefix)
+{
+	uint8_t flags = FILTER_SET_ENTRY_USED | (prefix.isIPv6 ? FILTER_SET_ENTRY_IPV6 : 0);
+	size_t mask = entries.size() - 1;
+	size_t index = hashPrefix(prefix.high, prefix.low, prefix.length, prefix.isIPv6) & mask;
+	while (true)
+	{
+		const Entry& entry = entries[index];
+		if (entry.flags == 0)
+			return false;
+
+		if (entry.high == prefix.high && entry.low == prefix.low && entry.length == prefix.length && entry.flags == flags)
+			break;
+
+		index = (index + 1) & mask;
+	}
+
+	// backward shift deletion: move up every following entry of the probe sequence that may be placed in the freed slot, so
+	// lookups never stop at a hole that used to be in the middle of their probe sequence
+	size_t next = index;
+	while (true)
+	{
+		next = (next + 1) & mask;
+		const Entry& entry = entries[next];
+		if (entry.flags == 0)
+			break;
+
+		size_t home = hashPrefix(entry.high, entry.low, entry.length, (entry.flags & FILTER_SET_ENTRY_IPV6) != 0) & mask;
+		bool homeBetween = (index <= next ? (home > index && home <= next) : (home > index || home <= next));
+		if (!homeBetween)
+		{
+			entries[index] = entry;
+			index = next;
+		}
+	}
+
+	memset(&entries[index], 0, sizeof(Entry));
+	numOfEntries--;
+
+	int family = (prefix.isIPv6 ? 1 : 0);
+	if (--lengthCount[family][prefix.length] == 0)
+		updateLengths(prefix.isIPv6);
+
+	return true;
+}
+
+void IPPrefixSet::Table::updateLengths(bool isIPv6)
+{
+	int family = (isIPv6 ? 1 : 0);
+	int maxLength = (isIPv6 ? 128 : 32);
+	lengths[family].clear();
+	for (int length = maxLength; length >= 0; length--)
+	{
+		if (lengthCount[family][length] > 0)
+			lengths[family].push_back((uint8_t)length);
+	}
+}
+
+
+IPPrefixSet::IPPrefixSet() : m_Table(new Table())
+{
+}
+
+IPPrefixSet::~IPPrefixSet()
+{
+	delete m_Table;
+}
+
+void IPPrefixSet::publish(Table* newTable)
+{
+	Table* oldTable = m_Table;
+	// the content of the new table is written before the pointer to it
+	FILTER_SET_MEMORY_BARRIER();
+	m_Table = newTable;
+	m_Version++;
+	waitForReaders();
+	delete oldTable;
+}
+
+bool IPPrefixSet::parsePrefix(const std::string& prefixAsString, Prefix& prefix)
+{
+	std::string addressAsString = prefixAsString;
+	std::string lengthAsString;
+	size_t slashPos = prefixAsString.find('/');
+	if (slashPos != std::string::npos)
+	{
+		addressAsString = prefixAsString.substr(0, slashPos);
+		lengthAsString = prefixAsString.substr(slashPos + 1);
+	}
+
+	IPAddress::Ptr_t address = IPAddress::fromString(addressAsString);
+	if (address.get() == NULL || !address->isValid())
+	{
+		LOG_ERROR("Invalid IP address '%s'", addressAsString.c_str());
+		return false;
+	}
+
+	prefix.isIPv6 = (address->getType() == IPAddress::IPv6AddressType);
+	long maxLength = (prefix.isIPv6 ? 128 : 32);
+	long length = maxLength;
+	if (slashPos != std::string::npos)
+	{
+		char* endPtr = NULL;
+		length = strtol(lengthAsString.c_str(), &endPtr, 10);
+		if (lengthAsString.empty() || *endPtr != '\0' || length < 0 || length > maxLength)
+		{
+			LOG_ERROR("Invalid prefix length in '%s'", prefixAsString.c_str());
+			return false;
+		}
+	}
+
+	prefix.length = (uint8_t)length;
+	if (prefix.isIPv6)
+	{
+		uint8_t addressBytes[16];
+		((IPv6Address*)address.get())->copyTo(addressBytes);
+		prefix.high = readUint64(addressBytes) & highMask(prefix.length);
+		prefix.low = readUint64(addressBytes + 8) & lowMask(prefix.length);
+	}
+	else
+	{
+		prefix.high = ((uint64_t)be32toh(((IPv4Address*)address.get())->toInt()) << 32) & highMask(prefix.length);
+		prefix.low = 0;
+	}
+
+	return true;
+}
+
+bool IPPrefixSet::add(const std::string& prefix)
+{
+	Prefix parsedPrefix;
+	if (!parsePrefix(prefix, parsedPrefix))
+		return false;
+
+	ScopedLock lock(&m_UpdateMutex);
+	if (m_Table->find(parsedPrefix.high, parsedPrefix.low, parsedPrefix.length, parsedPrefix.isIPv6))
+		return true;
+
+	Table* newTable = new Table(*m_Table);
+	newTable->insert(parsedPrefix);
+	publish(newTable);
+	return true;
+}
+
+bool IPPrefixSet::remove(const std::string& prefix)
+{
+	Prefix parsedPrefix;
+	if (!parsePrefix(prefix, parsedPrefix))
+		return false;
+
+	ScopedLock lock(&m_UpdateMutex);
+	if (!m_Table->find(parsedPrefix.high, parsedPrefix.low, parsedPrefix.length, parsedPrefix.isIPv6))
+		return false;
+
+	Table* newTable = new Table(*m_Table);
+	newTable->erase(parsedPrefix);
+	publish(newTable);
+	return true;
+}
+
+bool IPPrefixSet::assign(const std::vector<std::string>& prefixes)
+{
+	// the new table is built before the update mutex is taken
+	Table* newTable = new Table();
+	for (std::vector<std::string>::const_iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+	{
+		Prefix parsedPrefix;
+		if (!parsePrefix(*iter, parsedPrefix))
+		{
+			delete newTable;
+			return false;
+		}
+
+		newTable->insert(parsedPrefix);
+	}
+
+	ScopedLock lock(&m_UpdateMutex);
+	publish(newTable);
+	return true;
+}
+
+void IPPrefixSet::clear()
+{
+	Table* newTable = new Table();
+	ScopedLock lock(&m_UpdateMutex);
+	publish(newTable);
+}
+
+size_t IPPrefixSet::size() const
+{
+	ScopedReader reader(this);
+	return m_Table->numOfEntries;
+}
+
+void IPPrefixSet::getPrefixes(std::vector<Prefix>& prefixes) const
+{
+	prefixes.clear();
+
+	ScopedReader reader(this);
+	const Table* table = m_Table;
+	prefixes.reserve(table->numOfEntries);
+	for (std::vector<Entry>::const_iterator iter = table->entries.begin(); iter != table->entries.end(); iter++)
+	{
+		if (iter->flags == 0)
+			continue;
+
+		Prefix prefix;
+		prefix.high = iter->high;
+		prefix.low = iter->low;
+		prefix.length = iter->length;
+		prefix.isIPv6 = (iter->flags & FILTER_SET_ENTRY_IPV6) != 0;
+		prefixes.push_back(prefix);
+	}
+}
+
+bool IPPrefixSet::containsIPv4(uint32_t address) const
+{
+	ScopedReader reader(this);
+	return m_Table->lookup((uint64_t)address << 32, 0, false);
+}
+
+bool IPPrefixSet::containsIPv6(const uint8_t* address) const
+{
+	uint64_t high = readUint64(address);
+	uint64_t low = readUint64(address + 8);
+
+	ScopedReader reader(this);
+	return m_Table->lookup(high, low, true);
+}
+
+bool IPPrefixSet::contains(const IPAddress& address) const
+{
+	if (!address.isValid())
+		return false;
+
+	if (address.getType() == IPAddress::IPv4AddressType)
+		return containsIPv4(be32toh(((const IPv4Address&)address).toInt()));
+
+	uint8_t addressBytes[16];
+	((const IPv6Address&)address).copyTo(addressBytes);
+	return containsIPv6(addressBytes);
+}
+
+
+PortSet::PortSet() : m_Bitmap(new Bitmap())
+{
+	memset(m_Bitmap, 0, sizeof(Bitmap));
+}
+
+PortSet::~PortSet()
+{
+	delete m_Bitmap;
+}
+
+void PortSet::publish(Bitmap* newBitmap)
+{
+	Bitmap* oldBitmap = m_Bitmap;
+	// the content of the new bitmap is written before the pointer to it
+	FILTER_SET_MEMORY_BARRIER();
+	m_Bitmap = newBitmap;
+	m_Version++;
+	waitForReaders();
+	delete oldBitmap;
+}
+
+void PortSet::add(uint16_t port)
+{
+	addRange(port, port);
+}
+
+void PortSet::addRange(uint16_t fromPort, uint16_t toPort)
+{
+	if (fromPort > toPort)
+		std::swap(fromPort, toPort);
+
+	ScopedLock lock(&m_UpdateMutex);
+	Bitmap* newBitmap = NULL;
+	for (uint32_t port = fromPort; port <= toPort; port++)
+	{
+		uint32_t bit = (uint32_t)1 << (port & 31);
+		if ((m_Bitmap->bits[port >> 5] & bit) != 0)
+			continue;
+
+		// the bitmap is copied only if one of the ports is new
+		if (newBitmap == NULL)
+			newBitmap = new Bitmap(*m_Bitmap);
+
+		newBitmap->bits[port >> 5] |= bit;
+		newBitmap->numOfPorts++;
+	}
+
+	if (newBitmap != NULL)
+		publish(newBitmap);
+}
+
+bool PortSet::remove(uint16_t port)
+{
+	uint32_t bit = (uint32_t)1 << (port & 31);
+
+	ScopedLock lock(&m_UpdateMutex);
+	if ((m_Bitmap->bits[port >> 5] & bit) == 0)
+		return false;
+
+	Bitmap* newBitmap = new Bitmap(*m_Bitmap);
+	newBitmap->bits[port >> 5] &= ~bit;
+	newBitmap->numOfPorts--;
+	publish(newBitmap);
+	return true;
+}
+
+void PortSet::assign(const std::vector<uint16_t>& ports)
+{
+	Bitmap* newBitmap = new Bitmap();
+	memset(newBitmap, 0, sizeof(Bitmap));
+	for (std::vector<uint16_t>::const_iterator iter = ports.begin(); iter != ports.end(); iter++)
+	{
+		uint32_t bit = (uint32_t)1 << (*iter & 31);
+		if ((newBitmap->bits[*iter >> 5] & bit) == 0)
+		{
+			newBitmap->bits[*iter >> 5] |= bit;
+			newBitmap->numOfPorts++;
+		}
+	}
+
+	ScopedLock lock(&m_UpdateMutex);
+	publish(newBitmap);
+}
+
+void PortSet::clear()
+{
+	Bitmap* newBitmap = new Bitmap();
+	memset(newBitmap, 0, sizeof(Bitmap));
+	ScopedLock lock(&m_UpdateMutex);
+	publish(newBitmap);
+}
+
+size_t PortSet::size() const
+{
+	ScopedReader reader(this);
+	return m_Bitmap->numOfPorts;
+}
+
+void PortSet::getRanges(std::vector<std::pair<uint16_t, uint16_t> >& ranges) const
+{
+	ranges.clear();
+
+	ScopedReader reader(this);
+	const uint32_t* bits = m_Bitmap->bits;
+	bool inRange = false;
+	uint32_t rangeStart = 0;
+	for (uint32_t port = 0; port < 65536; port++)
+	{
+		// skip empty words quickly when not inside a range
+		if (!inRange && (port & 31) == 0 && bits[port >> 5] == 0)
+		{
+			port += 31;
+			continue;
+		}
+
+		bool isSet = (bits[port >> 5] & ((uint32_t)1 << (port & 31))) != 0;
+		if (isSet && !inRange)
+		{
+			rangeStart = port;
+			inRange = true;
+		}
+		else if (!isSet && inRange)
+		{
+			ranges.push_back(std::pair<uint16_t, uint16_t>((uint16_t)rangeStart, (uint16_t)(port - 1)));
+			inRange = false;
+		}
+	}
+
+	if (inRange)
+		ranges.push_back(std::pair<uint16_t, uint16_t>((uint16_t)rangeStart, 65535));
+}
+
+bool PortSet::contains(uint16_t port) const
+{
+	ScopedReader reader(this);
+	return (m_Bitmap->bits[port >> 5] & ((uint32_t)1 << (port & 31))) != 0;
+}
+
+} // namespace pcpp
@@ -35,6 +35,10 @@
 #ifndef MAX_BURST_SIZE
 #	define MAX_BURST_SIZE 64
 #endif
+// under load KNI requests are handled by the capture loop at least once every this many polls
+#ifndef KNI_REQUEST_POLL_INTERVAL
+#	define KNI_REQUEST_POLL_INTERVAL 1024
+#endif
 
 #define CPP_VLA(TYPE, SIZE) (TYPE*)__builtin_alloca(sizeof(TYPE) * SIZE)
 
@@ -178,6 +182,72 @@ inline struct rte_mempool* createMempool(size_t mempoolSize, int unique, const c
 	return result;
 }
 
+/**
+ * The idle strategy of the capture loops: poll continuously while packets arrive and back off exponentially when the device is
+ * idle. See KniDevice::KniPollingConfiguration
+ */
+class KniAdaptivePoller
+{
+public:
+	KniAdaptivePoller(const KniDevice::KniPollingConfiguration& config, struct rte_kni* kni, KniDevice::KniCaptureStats& stats) :
+		m_Config(config), m_Kni(kni), m_Stats(stats), m_IdlePolls(0), m_PollsSinceRequests(0), m_SleepNs(config.minSleepNanoSeconds)
+	{
+		if (m_SleepNs <= 0)
+			m_SleepNs = 1;
+		if (m_Config.maxSleepNanoSeconds > 0 && m_SleepNs > m_Config.maxSleepNanoSeconds)
+			m_SleepNs = m_Config.maxSleepNanoSeconds;
+	}
+
+	// called after every poll of the device with the number of packets it returned
+	inline void onPoll(uint32_t numOfPktsReceived)
+	{
+		m_Stats.polls++;
+
+		if (likely(numOfPktsReceived > 0))
+		{
+			m_Stats.packets += numOfPktsReceived;
+			m_IdlePolls = 0;
+			m_SleepNs = RTE_MAX(m_Config.minSleepNanoSeconds, 1L);
+			if (unlikely(m_Config.handleRequests && ++m_PollsSinceRequests >= KNI_REQUEST_POLL_INTERVAL))
+				handleRequests();
+			return;
+		}
+
+		m_Stats.emptyPolls++;
+		if (m_Config.maxSleepNanoSeconds <= 0 || ++m_IdlePolls <= m_Config.idleSpinIterations)
+		{
+			if (unlikely(m_Config.handleRequests && ++m_PollsSinceRequests >= KNI_REQUEST_POLL_INTERVAL))
+				handleRequests();
+			return;
+		}
+
+		if (m_Config.handleRequests)
+			handleRequests();
+
+		struct timespec sleepTime;
+		sleepTime.tv_sec = m_SleepNs / 1000000000L;
+		sleepTime.tv_nsec = m_SleepNs % 1000000000L;
+		nanosleep(&sleepTime, NULL);
+		m_Stats.sleeps++;
+
+		m_SleepNs = RTE_MIN(m_SleepNs * 2, m_Config.maxSleepNanoSeconds);
+	}
+
+private:
+	KniDevice::KniPollingConfiguration m_Config;
+	struct rte_kni* m_Kni;
+	KniDevice::KniCaptureStats& m_Stats;
+	uint32_t m_IdlePolls;
+	uint32_t m_PollsSinceRequests;
+	long m_SleepNs;
+
+	inline void handleRequests()
+	{
+		rte_kni_handle_request(m_Kni);
+		m_PollsSinceRequests = 0;
+	}
+};
+
 } // namespace
 
 KniDevice::KniDevice(const KniDeviceConfiguration& conf, size_t mempoolSize, int unique) :
@@ -185,11 +255,13 @@ KniDevice::KniDevice(const KniDeviceConfiguration& conf, size_t mempoolSize, int
 {
 	struct rte_kni_ops kniOps;
 	struct rte_kni_conf kniConf;
+	m_Capturing.callback = NULL;
+	m_Capturing.userCookie = NULL;
+	m_Capturing.thread = NULL;
+	std::memset(&m_Capturing.stats, 0, sizeof(m_Capturing.stats));
+	std::memset(&m_Requests, 0, sizeof(m_Requests));
 	if (!m_DeviceInfo.init(conf))
 		return;
-	m_Requests.thread = NULL;
-	std::memset(&m_Capturing, 0, sizeof(m_Capturing));
-	std::memset(&m_Requests, 0, sizeof(m_Requests));
 
 	if ((m_MBufMempool = createMempool(mempoolSize, unique, conf.name.c_str())) == NULL)
 		return;
@@ -545,7 +617,7 @@ uint16_t KniDevice::receivePackets(MBufRawPacket** rawPacketsArr, uint16_t rawPa
 	}
 
 	struct rte_mbuf** mBufArray = CPP_VLA(struct rte_mbuf*, rawPacketArrLength);
-	uint16_t packetsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
+	uint16_t packetsReceived = rte_kni_rx_burst(m_Device, mBufArray, rawPacketArrLength);
 
 	//LOG_DEBUG("KNI Captured %d packets", rawPacketArrLength);
 
@@ -588,7 +660,7 @@ uint16_t KniDevice::receivePackets(Packet** packetsArr, uint16_t packetsArrLengt
 
 
 	struct rte_mbuf** mBufArray = CPP_VLA(struct rte_mbuf*, packetsArrLength);
-	uint16_t packetsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
+	uint16_t packetsReceived = rte_kni_rx_burst(m_Device, mBufArray, packetsArrLength);
 
 	//LOG_DEBUG("KNI Captured %d packets", packetsArrLength);
 
@@ -830,37 +902,59 @@ void* KniDevice::KniCapturing::runCapture(void* devicePointer)
 	void* userCookie = device->m_Capturing.userCookie;
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
 	struct rte_kni* kni = device->m_Device;
+	KniAdaptivePoller poller(device->m_Capturing.polling, kni, device->m_Capturing.stats);
+	// the packet objects are reused for every burst, their mbufs are released right after the callback returns
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
 
 	LOG_DEBUG("Starting KNI capture thread for device \"%s\"", device->m_DeviceInfo.name.c_str());
 
 	for(;;)
 	{
 		uint32_t numOfPktsReceived = rte_kni_rx_burst(kni, mBufArray, MAX_BURST_SIZE);
+		poller.onPoll(numOfPktsReceived);
 		if (unlikely(numOfPktsReceived == 0))
 		{
 			pthread_testcancel();
 			continue;
 		}
 
-		timespec time;
-		clock_gettime(CLOCK_REALTIME, &time);
-
 		if (likely(callback != NULL))
 		{
-			MBufRawPacket rawPackets[MAX_BURST_SIZE];
-			for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-			{
-				rawPackets[index].setMBuf(mBufArray[index], time);
-			}
-
-			if (!callback(rawPackets, numOfPktsReceived, device, userCookie))
+			if (!deliverBurst(callback, device, userCookie, mBufArray, rawPackets, numOfPktsReceived))
 				break;
 		}
+		else
+		{
+			for (uint32_t index = 0; index < numOfPktsReceived; ++index)
+				rte_pktmbuf_free(mBufArray[index]);
+		}
 		pthread_testcancel();
 	}
 	return NULL;
 }
 
+bool KniDevice::KniCapturing::deliverBurst(OnKniPacketArriveCallback callback, KniDevice* device, void* userCookie,
+	struct rte_mbuf** mBufArray, MBufRawPacket* rawPackets, uint32_t numOfPackets)
+{
+	timespec time;
+	clock_gettime(CLOCK_REALTIME, &time);
+
+	for (uint32_t index = 0; index < numOfPackets; ++index)
+	{
+		rawPackets[index].setMBuf(mBufArray[index], time);
+	}
+
+	bool continueCapturing = callback(rawPackets, numOfPackets, device, userCookie);
+
+	// mbufs which weren't sent by the callback are freed here
+	for (uint32_t index = 0; index < numOfPackets; ++index)
+	{
+		rawPackets[index].clear();
+	}
+
+	return continueCapturing;
+}
+
 void KniDevice::KniCapturing::cleanup()
 {
 	if (thread)
@@ -889,6 +983,7 @@ bool KniDevice::startCapture(
 
 	m_Capturing.callback = onPacketArrives;
 	m_Capturing.userCookie = onPacketArrivesUserCookie;
+	std::memset(&m_Capturing.stats, 0, sizeof(m_Capturing.stats));
 
 	m_Capturing.thread = new KniThread(KniThread::JOINABLE, KniCapturing::runCapture, (void*)this);
 	if (m_Capturing.thread->m_CleanupState == KniThread::INVALID)
@@ -911,6 +1006,16 @@ void KniDevice::stopCapture()
 	m_Capturing.cleanup();
 }
 
+void KniDevice::setPollingConfiguration(const KniPollingConfiguration& config)
+{
+	m_Capturing.polling = config;
+}
+
+void KniDevice::getCaptureStats(KniCaptureStats& stats) const
+{
+	stats = m_Capturing.stats;
+}
+
 int KniDevice::startCaptureBlockingMode(
 	OnKniPacketArriveCallback onPacketArrives,
 	void* onPacketArrivesUserCookie,
@@ -936,56 +1041,33 @@ int KniDevice::startCaptureBlockingMode(
 	}
 
 	struct rte_mbuf* mBufArray[MAX_BURST_SIZE];
+	MBufRawPacket rawPackets[MAX_BURST_SIZE];
+	std::memset(&m_Capturing.stats, 0, sizeof(m_Capturing.stats));
+	KniAdaptivePoller poller(m_Capturing.polling, m_Device, m_Capturing.stats);
+	int result = -1;
+
+	long startTimeSec = 0, startTimeNSec = 0;
+	long curTimeSec = 0, curTimeNSec = 0;
+	clockGetTime(startTimeSec, startTimeNSec);
 
-	if (timeout <= 0)
+	while (timeout <= 0 || curTimeSec <= (startTimeSec + timeout))
 	{
-		for(;;)
+		uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
+		poller.onPoll(numOfPktsReceived);
+		if (likely(numOfPktsReceived != 0))
 		{
-			uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
-			if (likely(numOfPktsReceived != 0))
+			if (!KniCapturing::deliverBurst(m_Capturing.callback, this, m_Capturing.userCookie, mBufArray, rawPackets, numOfPktsReceived))
 			{
-				MBufRawPacket rawPackets[MAX_BURST_SIZE];
-				timespec time;
-				clock_gettime(CLOCK_REALTIME, &time);
-
-				for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-				{
-					rawPackets[index].setMBuf(mBufArray[index], time);
-				}
-
-				if (!m_Capturing.callback(rawPackets, numOfPktsReceived, this, m_Capturing.userCookie))
-					return 1;
+				result = 1;
+				break;
 			}
 		}
-	}
-	else
-	{
-		long startTimeSec = 0, startTimeNSec = 0;
-		long curTimeSec = 0, curTimeNSec = 0;
-		clockGetTime(startTimeSec, startTimeNSec);
 
-		while(curTimeSec <= (startTimeSec + timeout))
-		{
+		if (timeout > 0)
 			clockGetTime(curTimeSec, curTimeNSec);
-			uint32_t numOfPktsReceived = rte_kni_rx_burst(m_Device, mBufArray, MAX_BURST_SIZE);
-			if (likely(numOfPktsReceived != 0))
-			{
-				MBufRawPacket rawPackets[MAX_BURST_SIZE];
-				timespec time;
-				time.tv_sec = curTimeSec;
-				time.tv_nsec = curTimeNSec;
-
-				for (uint32_t index = 0; index < numOfPktsReceived; ++index)
-				{
-					rawPackets[index].setMBuf(mBufArray[index], time);
-				}
-
-				if (!m_Capturing.callback(rawPackets, numOfPktsReceived, this, m_Capturing.userCookie))
-					return 1;
-			}
-		}
 	}
-	return -1;
+
+	return result;
 }
 
 bool KniDevice::open()
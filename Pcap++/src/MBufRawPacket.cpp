@@ -33,12 +33,24 @@ namespace pcpp
 
 const int MBufRawPacket::MBUF_DATA_SIZE = MBUF_DATA_SIZE_DEFINE;
 
+// copy the data of all segments of an mbuf chain to a linear buffer
+static void copyMBufChainData(const struct rte_mbuf* mBuf, uint8_t* dest)
+{
+	for (const struct rte_mbuf* seg = mBuf; seg != NULL; seg = seg->next)
+	{
+		memcpy(dest, rte_pktmbuf_mtod(seg, const uint8_t*), rte_pktmbuf_data_len(seg));
+		dest += rte_pktmbuf_data_len(seg);
+	}
+}
+
 MBufRawPacket::~MBufRawPacket()
 {
 	if (m_MBuf != NULL && m_FreeMbuf)
 	{
 		rte_pktmbuf_free(m_MBuf);
 	}
+
+	freeLinearData();
 }
 
 bool MBufRawPacket::init(struct rte_mempool* mempool)
@@ -68,7 +80,7 @@ bool MBufRawPacket::init(struct rte_mempool* mempool)
 
 bool MBufRawPacket::init(DpdkDevice* device)
 {
-	return init(device->m_MBufMempool);
+	return init(device->getMBufMempoolForCurrentCore());
 }
 
 bool MBufRawPacket::init(KniDevice* device)
@@ -84,15 +96,12 @@ bool MBufRawPacket::initFromRawPacket(const RawPacket* rawPacket, struct rte_mem
 	m_RawPacketSet = false;
 
 	// mbuf is allocated with length of 0, need to adjust it to the size of other
-	if (rte_pktmbuf_append(m_MBuf, rawPacket->getRawDataLen()) == NULL)
+	if (!resizeData(rawPacket->getRawDataLen()))
 	{
 		LOG_ERROR("Couldn't append %d bytes to mbuf", rawPacket->getRawDataLen());
 		return false;
 	}
 
-	m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
-	m_RawDataLen = rte_pktmbuf_pkt_len(m_MBuf);
-
 	copyDataFrom(*rawPacket, false);
 
 	return true;
@@ -100,7 +109,7 @@ bool MBufRawPacket::initFromRawPacket(const RawPacket* rawPacket, struct rte_mem
 
 bool MBufRawPacket::initFromRawPacket(const RawPacket* rawPacket, DpdkDevice* device)
 {
-	return initFromRawPacket(rawPacket, device->m_MBufMempool);
+	return initFromRawPacket(rawPacket, device->getMBufMempoolForCurrentCore());
 }
 
 bool MBufRawPacket::initFromRawPacket(const RawPacket* rawPacket, KniDevice* device)
@@ -115,27 +124,31 @@ MBufRawPacket::MBufRawPacket(const MBufRawPacket& other)
 	m_RawDataLen = 0;
 	m_RawPacketSet = false;
 	m_RawData = NULL;
+	m_FreeMbuf = true;
+	m_LinearData = NULL;
+	m_LinearDataCapacity = 0;
 	m_Mempool = other.m_Mempool;
 
-	rte_mbuf* newMbuf = rte_pktmbuf_alloc(m_Mempool);
-	if (newMbuf == NULL)
+	// received packets don't have a mempool set, use the pool their mbuf was allocated from
+	if (m_Mempool == NULL && other.m_MBuf != NULL)
+		m_Mempool = other.m_MBuf->pool;
+
+	if (m_Mempool == NULL)
 	{
-		LOG_ERROR("Couldn't allocate mbuf");
+		LOG_ERROR("Couldn't copy an uninitialized MBufRawPacket");
 		return;
 	}
 
-	// mbuf is allocated with length of 0, need to adjust it to the size of other
-	if (rte_pktmbuf_append(newMbuf, other.m_RawDataLen) == NULL)
+	rte_mbuf* newMbuf = rte_pktmbuf_alloc(m_Mempool);
+	if (newMbuf == NULL)
 	{
-		LOG_ERROR("Couldn't append %d bytes to mbuf", other.m_RawDataLen);
+		LOG_ERROR("Couldn't allocate mbuf");
 		return;
 	}
 
 	setMBuf(newMbuf, other.m_TimeStamp);
 
-	m_RawPacketSet = false;
-
-	copyDataFrom(other, false);
+	copyFrom(other);
 }
 
 MBufRawPacket& MBufRawPacket::operator=(const MBufRawPacket& other)
@@ -146,39 +159,44 @@ MBufRawPacket& MBufRawPacket::operator=(const MBufRawPacket& other)
 		return *this;
 	}
 
-	// adjust the size of the mbuf to the new data
-	if (m_RawDataLen < other.m_RawDataLen)
-	{
-		if (rte_pktmbuf_append(m_MBuf, other.m_RawDataLen - m_RawDataLen) == NULL)
-		{
-			LOG_ERROR("Couldn't append %d bytes to mbuf", other.m_RawDataLen - m_RawDataLen);
-			return *this;
-		}
-	}
-	else if (m_RawDataLen > other.m_RawDataLen)
-	{
-		if (rte_pktmbuf_adj(m_MBuf, m_RawDataLen - other.m_RawDataLen) == NULL)
-		{
-			LOG_ERROR("Couldn't remove %d bytes to mbuf", m_RawDataLen - other.m_RawDataLen);
-			return *this;
-		}
-	}
+	if (this == &other)
+		return *this;
 
-	m_RawPacketSet = false;
+	// the whole data is replaced so the current chain and linear buffer aren't needed anymore
+	freeLinearData();
+	resetMBufChain();
+	m_RawDataLen = 0;
 
-	copyDataFrom(other, false);
+	copyFrom(other);
 
 	return *this;
 }
 
-bool MBufRawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType, int frameLength)
+bool MBufRawPacket::copyFrom(const MBufRawPacket& other)
 {
-	if (rawDataLen > MBUF_DATA_SIZE)
+	// if other is a chained mbuf which wasn't linearized, its raw data is only the first segment
+	bool isOtherChained = !other.isContiguous();
+	int dataLen = (isOtherChained ? (int)rte_pktmbuf_pkt_len(other.m_MBuf) : other.m_RawDataLen);
+
+	// mbuf is allocated with length of 0, need to adjust it to the size of other
+	if (!resizeData(dataLen))
 	{
-		LOG_ERROR("Cannot set raw data which length is larger than mBuf max size. mBuf max length: %d; requested length: %d", MBUF_DATA_SIZE, rawDataLen);
+		LOG_ERROR("Couldn't append %d bytes to mbuf", dataLen);
 		return false;
 	}
 
+	m_RawPacketSet = false;
+
+	copyDataFrom(other, false);
+
+	if (isOtherChained)
+		copyMBufChainData(other.m_MBuf, m_RawData);
+
+	return true;
+}
+
+bool MBufRawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timespec timestamp, LinkLayerType layerType, int frameLength)
+{
 	if (m_MBuf == NULL)
 	{
 		if (!(init(m_Mempool)))
@@ -188,31 +206,22 @@ bool MBufRawPacket::setRawData(const uint8_t* pRawData, int rawDataLen, timespec
 		}
 	}
 
+	// the whole data is replaced so the current chain and linear buffer aren't needed anymore
+	freeLinearData();
+	resetMBufChain();
+
 	// adjust the size of the mbuf to the new data
-	if (m_RawDataLen < rawDataLen)
+	if (!resizeData(rawDataLen))
 	{
-		if (rte_pktmbuf_append(m_MBuf, rawDataLen - m_RawDataLen) == NULL)
-		{
-			LOG_ERROR("Couldn't append %d bytes to mbuf", rawDataLen - m_RawDataLen);
-			return false;
-		}
-	}
-	else if (m_RawDataLen > rawDataLen)
-	{
-		if (rte_pktmbuf_adj(m_MBuf, m_RawDataLen - rawDataLen) == NULL)
-		{
-			LOG_ERROR("Couldn't remove %d bytes to mbuf", m_RawDataLen - rawDataLen);
-			return false;
-		}
+		LOG_ERROR("Couldn't append %d bytes to mbuf", rawDataLen);
+		return false;
 	}
 
-	m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
-	m_RawDataLen = rte_pktmbuf_pkt_len(m_MBuf);
 	memcpy(m_RawData, pRawData, m_RawDataLen);
 	delete [] pRawData;
 	m_TimeStamp = timestamp;
 	m_RawPacketSet = true;
-	m_FrameLength = frameLength;
+	m_FrameLength = (frameLength == -1 ? rawDataLen : frameLength);
 	m_LinkLayerType = layerType;
 
 	return true;
@@ -227,6 +236,8 @@ void MBufRawPacket::clear()
 
 	m_MBuf = NULL;
 
+	freeLinearData();
+
 	m_RawData = NULL;
 
 	RawPacket::clear();
@@ -240,13 +251,18 @@ void MBufRawPacket::appendData(const uint8_t* dataToAppend, size_t dataToAppendL
 		return; //TODO: need to return false here or something
 	}
 
-	char* startOfNewlyAppendedData = rte_pktmbuf_append(m_MBuf, dataToAppendLen);
-	if (startOfNewlyAppendedData == NULL)
+	// the data after the first segment of a chained mbuf should be accessible before it's moved
+	if (!linearize())
+		return;
+
+	int curDataLen = m_RawDataLen;
+	if (!resizeData(curDataLen + dataToAppendLen))
 	{
-		LOG_ERROR("Couldn't append %d bytes to RawPacket - not enough room in mBuf", (int)dataToAppendLen);
+		LOG_ERROR("Couldn't append %d bytes to RawPacket", (int)dataToAppendLen);
 		return; //TODO: need to return false here or something
 	}
 
+	m_RawDataLen = curDataLen;
 	RawPacket::appendData(dataToAppend, dataToAppendLen);
 
 	LOG_DEBUG("Appended %d bytes to MBufRawPacket", (int)dataToAppendLen);
@@ -260,13 +276,18 @@ void MBufRawPacket::insertData(int atIndex, const uint8_t* dataToInsert, size_t
 		return; //TODO: need to return false here or something
 	}
 
-	char* startOfNewlyAppendedData = rte_pktmbuf_append(m_MBuf, dataToInsertLen);
-	if (startOfNewlyAppendedData == NULL)
+	// the data after the first segment of a chained mbuf should be accessible before it's moved
+	if (!linearize())
+		return;
+
+	int curDataLen = m_RawDataLen;
+	if (!resizeData(curDataLen + dataToInsertLen))
 	{
-		LOG_ERROR("Couldn't append %d bytes to RawPacket - not enough room in mBuf", (int)dataToInsertLen);
+		LOG_ERROR("Couldn't insert %d bytes to RawPacket", (int)dataToInsertLen);
 		return; //TODO: need to return false here or something
 	}
 
+	m_RawDataLen = curDataLen;
 	RawPacket::insertData(atIndex, dataToInsert, dataToInsertLen);
 
 	LOG_DEBUG("Inserted %d bytes to MBufRawPacket", (int)dataToInsertLen);
@@ -280,9 +301,16 @@ bool MBufRawPacket::removeData(int atIndex, size_t numOfBytesToRemove)
 		return false;
 	}
 
+	if (!linearize())
+		return false;
+
 	if (!RawPacket::removeData(atIndex, numOfBytesToRemove))
 		return false;
 
+	// data in a linear buffer is written to the mbuf chain when the mbuf is requested
+	if (m_LinearData != NULL)
+		return true;
+
 	if (rte_pktmbuf_trim(m_MBuf, numOfBytesToRemove) != 0)
 	{
 		LOG_ERROR("Couldn't trim the mBuf");
@@ -296,19 +324,196 @@ bool MBufRawPacket::removeData(int atIndex, size_t numOfBytesToRemove)
 
 bool MBufRawPacket::reallocateData(size_t newBufferLength)
 {
+	if (m_MBuf == NULL)
+	{
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
+		return false;
+	}
+
+	if (!linearize())
+		return false;
+
 	if ((int)newBufferLength < m_RawDataLen)
 	{
 		LOG_ERROR("Cannot reallocate mBuf raw packet to a smaller size. Current data length: %d; requested length: %d", m_RawDataLen, (int)newBufferLength);
 		return false;
 	}
 
-	if (newBufferLength > MBUF_DATA_SIZE)
+	// no need to do any memory allocation if the mbuf is large enough because mbuf is already allocated
+	if (m_LinearData == NULL && newBufferLength <= (size_t)(rte_pktmbuf_data_len(m_MBuf) + rte_pktmbuf_tailroom(m_MBuf)))
+		return true;
+
+	return setLinearDataCapacity(newBufferLength);
+}
+
+int MBufRawPacket::getNumOfSegments() const
+{
+	if (m_MBuf == NULL)
+		return 0;
+
+	return (int)m_MBuf->nb_segs;
+}
+
+bool MBufRawPacket::isContiguous() const
+{
+	return (m_MBuf == NULL || m_LinearData != NULL || rte_pktmbuf_is_contiguous(m_MBuf));
+}
+
+bool MBufRawPacket::linearize()
+{
+	if (m_MBuf == NULL)
 	{
-		LOG_ERROR("Cannot reallocate mBuf raw packet to a size larger than mBuf data. mBuf max length: %d; requested length: %d", MBUF_DATA_SIZE, (int)newBufferLength);
+		LOG_ERROR("MBufRawPacket not initialized. Please call the init() method");
 		return false;
 	}
 
-	// no need to do any memory allocation because mbuf is already allocated
+	if (isContiguous())
+		return true;
+
+#if RTE_VERSION >= RTE_VERSION_NUM(17, 11, 0, 0)
+	// when there is enough room in the first segment the data of all other segments is moved into it
+	if (rte_pktmbuf_linearize(m_MBuf) == 0)
+	{
+		m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
+		m_RawDataLen = rte_pktmbuf_pkt_len(m_MBuf);
+		return true;
+	}
+#endif
+
+	return setLinearDataCapacity(rte_pktmbuf_pkt_len(m_MBuf));
+}
+
+bool MBufRawPacket::resizeData(int newDataLen)
+{
+	if (m_LinearData == NULL && rte_pktmbuf_is_contiguous(m_MBuf))
+	{
+		int curDataLen = (int)rte_pktmbuf_pkt_len(m_MBuf);
+		bool resized = (newDataLen >= curDataLen ?
+				rte_pktmbuf_append(m_MBuf, newDataLen - curDataLen) != NULL :
+				rte_pktmbuf_trim(m_MBuf, curDataLen - newDataLen) == 0);
+
+		if (resized)
+		{
+			m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
+			m_RawDataLen = newDataLen;
+			return true;
+		}
+	}
+
+	// the data doesn't fit in the mbuf, keep it in a linear buffer
+	if (!setLinearDataCapacity(newDataLen))
+		return false;
+
+	m_RawDataLen = newDataLen;
+	return true;
+}
+
+bool MBufRawPacket::setLinearDataCapacity(size_t capacity)
+{
+	if (m_LinearData != NULL && capacity <= m_LinearDataCapacity)
+		return true;
+
+	int dataLen = (m_LinearData != NULL ? m_RawDataLen : (int)rte_pktmbuf_pkt_len(m_MBuf));
+	if (capacity < (size_t)dataLen)
+		capacity = dataLen;
+
+	uint8_t* newLinearData = new uint8_t[capacity];
+	if (m_LinearData != NULL)
+		memcpy(newLinearData, m_LinearData, dataLen);
+	else
+		copyMBufChainData(m_MBuf, newLinearData);
+
+	freeLinearData();
+	m_LinearData = newLinearData;
+	m_LinearDataCapacity = capacity;
+	m_RawData = m_LinearData;
+	m_RawDataLen = dataLen;
+
+	LOG_DEBUG("Moved %d bytes of MBufRawPacket data to a linear buffer of %d bytes", dataLen, (int)capacity);
+
+	return true;
+}
+
+void MBufRawPacket::freeLinearData()
+{
+	if (m_LinearData == NULL)
+		return;
+
+	delete [] m_LinearData;
+	m_LinearData = NULL;
+	m_LinearDataCapacity = 0;
+}
+
+void MBufRawPacket::resetMBufChain()
+{
+	if (m_MBuf->next != NULL)
+	{
+		rte_pktmbuf_free(m_MBuf->next);
+		m_MBuf->next = NULL;
+		m_MBuf->nb_segs = 1;
+	}
+
+	m_MBuf->data_off = RTE_MIN(RTE_PKTMBUF_HEADROOM, (uint16_t)m_MBuf->buf_len);
+	m_MBuf->data_len = 0;
+	m_MBuf->pkt_len = 0;
+	m_RawData = rte_pktmbuf_mtod(m_MBuf, uint8_t*);
+}
+
+bool MBufRawPacket::updateMBufFromLinearData()
+{
+	// find how many of the existing segments are needed for the data
+	struct rte_mbuf* lastSeg = m_MBuf;
+	int capacity = lastSeg->buf_len - lastSeg->data_off;
+	while (capacity < m_RawDataLen && lastSeg->next != NULL)
+	{
+		lastSeg = lastSeg->next;
+		capacity += lastSeg->buf_len - lastSeg->data_off;
+	}
+
+	// allocate the missing segments before changing the chain, so the chain is left intact if the allocation fails
+	struct rte_mbuf* newSegs = NULL;
+	struct rte_mbuf* newSegsTail = NULL;
+	while (capacity < m_RawDataLen)
+	{
+		struct rte_mbuf* newSeg = rte_pktmbuf_alloc(m_MBuf->pool);
+		if (newSeg == NULL)
+		{
+			LOG_ERROR("Couldn't allocate mbuf segments for %d bytes of data", m_RawDataLen);
+			if (newSegs != NULL)
+				rte_pktmbuf_free(newSegs);
+			return false;
+		}
+
+		// only the first segment needs headroom
+		newSeg->data_off = 0;
+		capacity += newSeg->buf_len;
+
+		if (newSegs == NULL)
+			newSegs = newSeg;
+		else
+			newSegsTail->next = newSeg;
+		newSegsTail = newSeg;
+	}
+
+	// free the segments that aren't needed anymore and attach the new ones
+	if (lastSeg->next != NULL)
+		rte_pktmbuf_free(lastSeg->next);
+	lastSeg->next = newSegs;
+
+	// scatter the data between the segments
+	int offset = 0;
+	uint16_t numOfSegs = 0;
+	for (struct rte_mbuf* seg = m_MBuf; seg != NULL; seg = seg->next)
+	{
+		int segDataLen = RTE_MIN(seg->buf_len - seg->data_off, m_RawDataLen - offset);
+		memcpy(rte_pktmbuf_mtod(seg, uint8_t*), m_LinearData + offset, segDataLen);
+		seg->data_len = segDataLen;
+		offset += segDataLen;
+		numOfSegs++;
+	}
+
+	m_MBuf->nb_segs = numOfSegs;
+	m_MBuf->pkt_len = m_RawDataLen;
 
 	return true;
 }
@@ -318,6 +523,8 @@ void MBufRawPacket::setMBuf(struct rte_mbuf* mBuf, timespec timestamp)
 	if (m_MBuf != NULL && m_FreeMbuf)
 		rte_pktmbuf_free(m_MBuf);
 
+	freeLinearData();
+
 	if (mBuf == NULL)
 	{
 		LOG_ERROR("mbuf to set is NULL");
@@ -325,7 +532,11 @@ void MBufRawPacket::setMBuf(struct rte_mbuf* mBuf, timespec timestamp)
 	}
 
 	m_MBuf = mBuf;
-	RawPacket::setRawData(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_pkt_len(mBuf), timestamp, LINKTYPE_ETHERNET);
+	// the object owns the new mbuf even if the previous one was handed over to DPDK when it was sent
+	m_FreeMbuf = true;
+
+	// a chained mbuf isn't copied: the raw data is its first segment and the frame length is the whole packet length
+	RawPacket::setRawData(rte_pktmbuf_mtod(mBuf, const uint8_t*), rte_pktmbuf_data_len(mBuf), timestamp, LINKTYPE_ETHERNET, rte_pktmbuf_pkt_len(mBuf));
 }
 
 } // namespace pcpp
@@ -0,0 +1,684 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "NativeFilter.h"
+#include "Packet.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "PacketUtils.h"
+#include "Logger.h"
+#include "EndianPortable.h"
+#include <string.h>
+
+#define NATIVE_FILTER_VLAN_TAG_SIZE     4
+
+// instruction flags
+#define NATIVE_FILTER_FLAG_SRC          0x01
+#define NATIVE_FILTER_FLAG_DST          0x02
+#define NATIVE_FILTER_FLAG_IPV4         0x04
+#define NATIVE_FILTER_FLAG_IPV6         0x08
+#define NATIVE_FILTER_FLAG_VLAN_ID      0x10
+
+// the result of an instruction that read beyond the end of the packet
+#define NATIVE_FILTER_OUT_OF_BOUNDS     (-1)
+
+namespace pcpp
+{
+
+/**
+ * The parts of a packet the instructions need, calculated once per matched packet
+ */
+struct NativeFilter::PacketView
+{
+	const uint8_t* data;
+	uint32_t dataLen;
+	bool isEthernet;
+	// for NULL/loopback and raw IP packets there is no EtherType field, it's derived from the IP version
+	bool isRawIP;
+	uint32_t etherTypeOffset;
+	uint32_t networkOffset;
+};
+
+namespace
+{
+
+inline bool loadByte(const uint8_t* data, uint32_t dataLen, uint32_t offset, uint32_t& result)
+{
+	if (offset >= dataLen)
+		return false;
+
+	result = data[offset];
+	return true;
+}
+
+inline bool loadHalf(const uint8_t* data, uint32_t dataLen, uint32_t offset, uint32_t& result)
+{
+	if (offset + 2 > dataLen)
+		return false;
+
+	result = ((uint32_t)data[offset] << 8) | data[offset + 1];
+	return true;
+}
+
+inline bool loadWord(const uint8_t* data, uint32_t dataLen, uint32_t offset, uint32_t& result)
+{
+	if (offset + 4 > dataLen)
+		return false;
+
+	result = ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) | ((uint32_t)data[offset + 2] << 8) | data[offset + 3];
+	return true;
+}
+
+inline bool compareValues(uint8_t op, uint32_t left, uint32_t right)
+{
+	switch (op)
+	{
+	case EQUALS:
+		return left == right;
+	case NOT_EQUALS:
+		return left != right;
+	case GREATER_THAN:
+		return left > right;
+	case GREATER_OR_EQUAL:
+		return left >= right;
+	case LESS_THAN:
+		return left < right;
+	default: // LESS_OR_EQUAL
+		return left <= right;
+	}
+}
+
+inline uint8_t directionToFlags(Direction dir)
+{
+	switch (dir)
+	{
+	case SRC:
+		return NATIVE_FILTER_FLAG_SRC;
+	case DST:
+		return NATIVE_FILTER_FLAG_DST;
+	default: // SRC_OR_DST
+		return NATIVE_FILTER_FLAG_SRC | NATIVE_FILTER_FLAG_DST;
+	}
+}
+
+inline bool isPortProtocol(uint32_t protocol)
+{
+	return protocol == PACKETPP_IPPROTO_TCP || protocol == PACKETPP_IPPROTO_UDP || protocol == PACKETPP_IPPROTO_SCTP;
+}
+
+// find the offset of the TCP/UDP/SCTP ports the way libpcap's "port" and "portrange" do. Returns 1 if the packet has ports, 0 if it
+// doesn't and NATIVE_FILTER_OUT_OF_BOUNDS if the headers are truncated
+inline int locatePorts(const uint8_t* data, uint32_t dataLen, uint32_t etherType, uint32_t networkOffset, uint32_t& portsOffset)
+{
+	uint32_t value;
+	if (etherType == PCPP_ETHERTYPE_IP)
+	{
+		if (!loadByte(data, dataLen, networkOffset + 9, value))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		if (!isPortProtocol(value))
+			return 0;
+
+		// non-first fragments don't contain the ports
+		if (!loadHalf(data, dataLen, networkOffset + 6, value))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		if ((value & 0x1fff) != 0)
+			return 0;
+
+		if (!loadByte(data, dataLen, networkOffset, value))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		portsOffset = networkOffset + (value & 0x0f) * 4;
+		return 1;
+	}
+
+	if (etherType == PCPP_ETHERTYPE_IPV6)
+	{
+		if (!loadByte(data, dataLen, networkOffset + 6, value))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		if (!isPortProtocol(value))
+			return 0;
+
+		portsOffset = networkOffset + 40;
+		return 1;
+	}
+
+	return 0;
+}
+
+} // namespace
+
+
+NativeFilter::NativeFilter(const NativeFilter& other) : m_Program(other.m_Program), m_Sets(other.m_Sets), m_IsCompiled(other.m_IsCompiled)
+{
+	for (std::vector<FilterSet*>::iterator iter = m_Sets.begin(); iter != m_Sets.end(); iter++)
+		(*iter)->addRef();
+}
+
+NativeFilter::~NativeFilter()
+{
+	clear();
+}
+
+NativeFilter& NativeFilter::operator=(const NativeFilter& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+	m_Program = other.m_Program;
+	m_Sets = other.m_Sets;
+	m_IsCompiled = other.m_IsCompiled;
+	for (std::vector<FilterSet*>::iterator iter = m_Sets.begin(); iter != m_Sets.end(); iter++)
+		(*iter)->addRef();
+
+	return *this;
+}
+
+bool NativeFilter::compile(const GeneralFilter& filter)
+{
+	clear();
+
+	NativeFilterBuilder builder(m_Program, m_Sets);
+	if (!filter.compileNative(builder, NativeFilterBuilder::Accept, NativeFilterBuilder::Reject) || !builder.resolveLabels())
+	{
+		LOG_ERROR("Cannot compile the filter natively");
+		clear();
+		return false;
+	}
+
+	m_IsCompiled = true;
+	return true;
+}
+
+void NativeFilter::clear()
+{
+	m_Program.clear();
+	for (std::vector<FilterSet*>::iterator iter = m_Sets.begin(); iter != m_Sets.end(); iter++)
+		(*iter)->release();
+	m_Sets.clear();
+	m_IsCompiled = false;
+}
+
+bool NativeFilter::matchPacket(const uint8_t* data, int dataLen, LinkLayerType linkType) const
+{
+	if (!m_IsCompiled || data == NULL || dataLen < 0)
+		return false;
+
+	PacketView packet;
+	packet.data = data;
+	packet.dataLen = (uint32_t)dataLen;
+	packet.isEthernet = (linkType == LINKTYPE_ETHERNET);
+
+	int etherTypeOffset, networkOffset;
+	if (!getRawNetworkLayerOffsets(linkType, etherTypeOffset, networkOffset))
+		return false;
+
+	packet.isRawIP = (etherTypeOffset < 0);
+	packet.etherTypeOffset = (packet.isRawIP ? 0 : (uint32_t)etherTypeOffset);
+	packet.networkOffset = (uint32_t)networkOffset;
+
+	uint32_t programSize = (uint32_t)m_Program.size();
+	const Instruction* program = &m_Program[0];
+	uint32_t pc = 0;
+	while (pc < programSize)
+	{
+		const Instruction& instruction = program[pc];
+		int result = evaluate(instruction, packet);
+		if (result == NATIVE_FILTER_OUT_OF_BOUNDS)
+			return false;
+
+		pc = (result != 0 ? instruction.jumpIfTrue : instruction.jumpIfFalse);
+	}
+
+	return pc == programSize;
+}
+
+bool NativeFilter::matchPacket(const RawPacket* rawPacket) const
+{
+	if (rawPacket == NULL)
+		return false;
+
+	return matchPacket(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType());
+}
+
+bool NativeFilter::matchPacket(const Packet& packet) const
+{
+	return matchPacket(packet.getRawPacketReadOnly());
+}
+
+int NativeFilter::evaluate(const Instruction& instruction, const PacketView& packet)
+{
+	if (instruction.opcode == OpAlways)
+		return 1;
+
+	const uint8_t* data = packet.data;
+	uint32_t dataLen = packet.dataLen;
+
+	if (instruction.opcode == OpMacAddress)
+	{
+		if (!packet.isEthernet)
+			return 0;
+
+		if (dataLen < 12)
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		if ((instruction.flags & NATIVE_FILTER_FLAG_SRC) && memcmp(data + 6, instruction.mac, 6) == 0)
+			return 1;
+
+		return (instruction.flags & NATIVE_FILTER_FLAG_DST) && memcmp(data, instruction.mac, 6) == 0;
+	}
+
+	uint32_t etherTypeOffset = packet.etherTypeOffset + instruction.linkShift;
+	uint32_t networkOffset = packet.networkOffset + instruction.linkShift;
+
+	// all other instructions start by reading the EtherType
+	uint32_t etherType = 0;
+	if (packet.isRawIP)
+	{
+		uint32_t version;
+		if (!loadByte(data, dataLen, packet.networkOffset, version))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		version >>= 4;
+		if (version == 4)
+			etherType = PCPP_ETHERTYPE_IP;
+		else if (version == 6)
+			etherType = PCPP_ETHERTYPE_IPV6;
+	}
+	else if (!loadHalf(data, dataLen, etherTypeOffset, etherType))
+		return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+	uint32_t value;
+
+	switch (instruction.opcode)
+	{
+	case OpEtherType:
+		return etherType == instruction.value;
+
+	case OpVlan:
+	{
+		if (!packet.isEthernet)
+			return 0;
+
+		if (!isVlanEtherType((uint16_t)etherType))
+			return 0;
+
+		if (!(instruction.flags & NATIVE_FILTER_FLAG_VLAN_ID))
+			return 1;
+
+		if (!loadHalf(data, dataLen, etherTypeOffset + 2, value))
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		return (value & 0x0fff) == instruction.value;
+	}
+
+	case OpIPv4Net:
+	{
+		if (etherType != PCPP_ETHERTYPE_IP)
+			return 0;
+
+		if (instruction.flags & NATIVE_FILTER_FLAG_SRC)
+		{
+			if (!loadWord(data, dataLen, networkOffset + 12, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if ((value & instruction.mask) == instruction.value)
+				return 1;
+		}
+
+		if (instruction.flags & NATIVE_FILTER_FLAG_DST)
+		{
+			if (!loadWord(data, dataLen, networkOffset + 16, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if ((value & instruction.mask) == instruction.value)
+				return 1;
+		}
+
+		return 0;
+	}
+
+	case OpIPProtocol:
+	{
+		if (etherType == PCPP_ETHERTYPE_IP && (instruction.flags & NATIVE_FILTER_FLAG_IPV4))
+		{
+			if (!loadByte(data, dataLen, networkOffset + 9, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			return value == instruction.value;
+		}
+
+		if (etherType == PCPP_ETHERTYPE_IPV6 && (instruction.flags & NATIVE_FILTER_FLAG_IPV6))
+		{
+			if (!loadByte(data, dataLen, networkOffset + 6, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if (value == instruction.value)
+				return 1;
+
+			if (value != PACKETPP_IPPROTO_FRAGMENT)
+				return 0;
+
+			if (!loadByte(data, dataLen, networkOffset + 40, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			return value == instruction.value;
+		}
+
+		return 0;
+	}
+
+	case OpPortRange:
+	case OpPortSet:
+	{
+		uint32_t portsOffset;
+		int result = locatePorts(data, dataLen, etherType, networkOffset, portsOffset);
+		if (result != 1)
+			return result;
+
+		const PortSet* portSet = (const PortSet*)instruction.set;
+
+		if (instruction.flags & NATIVE_FILTER_FLAG_SRC)
+		{
+			if (!loadHalf(data, dataLen, portsOffset, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if (instruction.opcode == OpPortSet ? portSet->contains((uint16_t)value) : (value >= instruction.value && value <= instruction.mask))
+				return 1;
+		}
+
+		if (instruction.flags & NATIVE_FILTER_FLAG_DST)
+		{
+			if (!loadHalf(data, dataLen, portsOffset + 2, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if (instruction.opcode == OpPortSet ? portSet->contains((uint16_t)value) : (value >= instruction.value && value <= instruction.mask))
+				return 1;
+		}
+
+		return 0;
+	}
+
+	case OpIPPrefixSet:
+	{
+		const IPPrefixSet* prefixSet = (const IPPrefixSet*)instruction.set;
+
+		if (etherType == PCPP_ETHERTYPE_IP)
+		{
+			if (instruction.flags & NATIVE_FILTER_FLAG_SRC)
+			{
+				if (!loadWord(data, dataLen, networkOffset + 12, value))
+					return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+				if (prefixSet->containsIPv4(value))
+					return 1;
+			}
+
+			if (instruction.flags & NATIVE_FILTER_FLAG_DST)
+			{
+				if (!loadWord(data, dataLen, networkOffset + 16, value))
+					return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+				if (prefixSet->containsIPv4(value))
+					return 1;
+			}
+		}
+		else if (etherType == PCPP_ETHERTYPE_IPV6)
+		{
+			if (instruction.flags & NATIVE_FILTER_FLAG_SRC)
+			{
+				if (networkOffset + 24 > dataLen)
+					return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+				if (prefixSet->containsIPv6(data + networkOffset + 8))
+					return 1;
+			}
+
+			if (instruction.flags & NATIVE_FILTER_FLAG_DST)
+			{
+				if (networkOffset + 40 > dataLen)
+					return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+				if (prefixSet->containsIPv6(data + networkOffset + 24))
+					return 1;
+			}
+		}
+
+		return 0;
+	}
+
+	case OpField:
+	{
+		uint32_t fieldOffset;
+		switch (instruction.fieldLayer)
+		{
+		case NativeFilterBuilder::IPv4Field:
+			if (etherType != PCPP_ETHERTYPE_IP)
+				return 0;
+			fieldOffset = networkOffset;
+			break;
+
+		case NativeFilterBuilder::ArpField:
+			if (etherType != PCPP_ETHERTYPE_ARP)
+				return 0;
+			fieldOffset = networkOffset;
+			break;
+
+		default: // TcpField, UdpField
+			if (etherType != PCPP_ETHERTYPE_IP)
+				return 0;
+
+			if (!loadByte(data, dataLen, networkOffset + 9, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if (value != (instruction.fieldLayer == NativeFilterBuilder::TcpField ? PACKETPP_IPPROTO_TCP : PACKETPP_IPPROTO_UDP))
+				return 0;
+
+			if (!loadHalf(data, dataLen, networkOffset + 6, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			if ((value & 0x1fff) != 0)
+				return 0;
+
+			if (!loadByte(data, dataLen, networkOffset, value))
+				return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+			fieldOffset = networkOffset + (value & 0x0f) * 4;
+			break;
+		}
+
+		fieldOffset += instruction.fieldOffset;
+
+		bool loaded;
+		if (instruction.fieldSize == 1)
+			loaded = loadByte(data, dataLen, fieldOffset, value);
+		else if (instruction.fieldSize == 2)
+			loaded = loadHalf(data, dataLen, fieldOffset, value);
+		else
+			loaded = loadWord(data, dataLen, fieldOffset, value);
+
+		if (!loaded)
+			return NATIVE_FILTER_OUT_OF_BOUNDS;
+
+		if (instruction.mask != 0)
+			value &= instruction.mask;
+
+		return compareValues(instruction.op, value, instruction.value);
+	}
+
+	default:
+		return 0;
+	}
+}
+
+
+const NativeFilterBuilder::Label NativeFilterBuilder::Accept;
+const NativeFilterBuilder::Label NativeFilterBuilder::Reject;
+
+NativeFilterBuilder::NativeFilterBuilder(std::vector<NativeFilter::Instruction>& program, std::vector<FilterSet*>& sets) :
+	m_Program(program), m_Sets(sets), m_LinkShift(0)
+{
+}
+
+NativeFilterBuilder::Label NativeFilterBuilder::newLabel()
+{
+	// labels created here start after Accept and Reject, their position is unknown until they're placed
+	m_LabelPositions.push_back((uint32_t)-1);
+	return (Label)(m_LabelPositions.size() + Reject);
+}
+
+void NativeFilterBuilder::placeLabel(Label label)
+{
+	if (label <= Reject || label - Reject > m_LabelPositions.size())
+	{
+		LOG_ERROR("Cannot place unknown label %d", (int)label);
+		return;
+	}
+
+	m_LabelPositions[label - Reject - 1] = (uint32_t)m_Program.size();
+}
+
+NativeFilter::Instruction& NativeFilterBuilder::emit(uint8_t opcode, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction instruction;
+	memset(&instruction, 0, sizeof(instruction));
+	instruction.opcode = opcode;
+	instruction.linkShift = m_LinkShift;
+	instruction.jumpIfTrue = onMatch;
+	instruction.jumpIfFalse = onMismatch;
+	m_Program.push_back(instruction);
+	return m_Program.back();
+}
+
+void NativeFilterBuilder::emitAlways(Label target)
+{
+	emit(NativeFilter::OpAlways, target, target);
+}
+
+void NativeFilterBuilder::emitEtherType(uint16_t etherType, Label onMatch, Label onMismatch)
+{
+	emit(NativeFilter::OpEtherType, onMatch, onMismatch).value = etherType;
+}
+
+void NativeFilterBuilder::emitVlan(bool matchVlanId, uint16_t vlanId, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpVlan, onMatch, onMismatch);
+	if (matchVlanId)
+	{
+		instruction.flags = NATIVE_FILTER_FLAG_VLAN_ID;
+		instruction.value = vlanId & 0x0fff;
+	}
+
+	// like libpcap, everything compiled after a VLAN test looks behind the VLAN tag
+	m_LinkShift += NATIVE_FILTER_VLAN_TAG_SIZE;
+}
+
+void NativeFilterBuilder::emitMacAddress(const MacAddress& macAddress, Direction dir, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpMacAddress, onMatch, onMismatch);
+	instruction.flags = directionToFlags(dir);
+	macAddress.copyTo(instruction.mac);
+}
+
+void NativeFilterBuilder::emitIPv4Net(uint32_t address, uint32_t mask, Direction dir, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpIPv4Net, onMatch, onMismatch);
+	instruction.flags = directionToFlags(dir);
+	instruction.mask = be32toh(mask);
+	instruction.value = be32toh(address) & instruction.mask;
+}
+
+void NativeFilterBuilder::emitIPProtocol(uint8_t protocol, bool matchIPv4, bool matchIPv6, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpIPProtocol, onMatch, onMismatch);
+	instruction.flags = (matchIPv4 ? NATIVE_FILTER_FLAG_IPV4 : 0) | (matchIPv6 ? NATIVE_FILTER_FLAG_IPV6 : 0);
+	instruction.value = protocol;
+}
+
+void NativeFilterBuilder::emitPortRange(uint16_t fromPort, uint16_t toPort, Direction dir, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpPortRange, onMatch, onMismatch);
+	instruction.flags = directionToFlags(dir);
+	instruction.value = (fromPort <= toPort ? fromPort : toPort);
+	instruction.mask = (fromPort <= toPort ? toPort : fromPort);
+}
+
+void NativeFilterBuilder::emitIPPrefixSet(IPPrefixSet* set, Direction dir, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpIPPrefixSet, onMatch, onMismatch);
+	instruction.flags = directionToFlags(dir);
+	instruction.set = set;
+
+	// the program holds the set until it's cleared, so the filter that owns the set may be destroyed before the program
+	set->addRef();
+	m_Sets.push_back(set);
+}
+
+void NativeFilterBuilder::emitPortSet(PortSet* set, Direction dir, Label onMatch, Label onMismatch)
+{
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpPortSet, onMatch, onMismatch);
+	instruction.flags = directionToFlags(dir);
+	instruction.set = set;
+	set->addRef();
+	m_Sets.push_back(set);
+}
+
+bool NativeFilterBuilder::emitField(FieldLayer layer, uint16_t offset, uint8_t size, uint32_t mask, FilterOperator op, uint32_t value, Label onMatch, Label onMismatch)
+{
+	if (size != 1 && size != 2 && size != 4)
+	{
+		LOG_ERROR("Invalid field size %d, only 1, 2 or 4 bytes are supported", (int)size);
+		return false;
+	}
+
+	NativeFilter::Instruction& instruction = emit(NativeFilter::OpField, onMatch, onMismatch);
+	instruction.fieldLayer = (uint8_t)layer;
+	instruction.fieldOffset = offset;
+	instruction.fieldSize = size;
+	instruction.mask = mask;
+	instruction.op = (uint8_t)op;
+	instruction.value = value;
+	return true;
+}
+
+bool NativeFilterBuilder::resolveLabels()
+{
+	uint32_t programSize = (uint32_t)m_Program.size();
+	if (programSize == 0)
+	{
+		LOG_ERROR("The filter didn't emit any instruction");
+		return false;
+	}
+
+	for (uint32_t pc = 0; pc < programSize; pc++)
+	{
+		uint32_t* targets[2] = { &m_Program[pc].jumpIfTrue, &m_Program[pc].jumpIfFalse };
+		for (int i = 0; i < 2; i++)
+		{
+			uint32_t& target = *targets[i];
+			if (target == Accept)
+				target = programSize;
+			else if (target == Reject)
+				target = programSize + 1;
+			else if (target - Reject > m_LabelPositions.size() || m_LabelPositions[target - Reject - 1] >= programSize)
+			{
+				LOG_ERROR("Jump to an unknown label %d or to a label that isn't followed by any instruction", (int)target);
+				return false;
+			}
+			// like bpf_validate(), only forward jumps are allowed so the program always ends
+			else if (m_LabelPositions[target - Reject - 1] <= pc)
+			{
+				LOG_ERROR("Instruction %d jumps backward to label %d", (int)pc, (int)target);
+				return false;
+			}
+			else
+				target = m_LabelPositions[target - Reject - 1];
+		}
+	}
+
+	return true;
+}
+
+} // namespace pcpp
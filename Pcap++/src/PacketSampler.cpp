@@ -0,0 +1,153 @@
+#include "PacketSampler.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "PacketUtils.h"
+#include "EndianPortable.h"
+#include <string.h>
+
+namespace pcpp
+{
+
+static inline uint16_t readUint16(const uint8_t* data)
+{
+	uint16_t value;
+	memcpy(&value, data, sizeof(value));
+	return be16toh(value);
+}
+
+static inline uint32_t readUint32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+// a MurmurHash3 style mixing step and finalizer. The input doesn't come from the user so there is no need for anything stronger
+static inline uint32_t mixHash(uint32_t hash, uint32_t value)
+{
+	value *= 0xcc9e2d51;
+	value = (value << 15) | (value >> 17);
+	value *= 0x1b873593;
+	hash ^= value;
+	hash = (hash << 13) | (hash >> 19);
+	return hash * 5 + 0xe6546b64;
+}
+
+static inline uint32_t finalizeHash(uint32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+PacketSampler::PacketSampler(SamplingMethod method, uint32_t sampleRate, uint32_t seed)
+{
+	m_SampleRate = (sampleRate == 0 ? 1 : sampleRate);
+	m_Method = (m_SampleRate == 1 ? NoSampling : method);
+	m_Seed = seed;
+	m_Threshold = 0xFFFFFFFF / m_SampleRate;
+	m_Counter = 0;
+	m_RandomState = seed ^ 0x9E3779B9;
+	if (m_RandomState == 0)
+		m_RandomState = 1;
+	m_NumOfPacketsSeen = 0;
+	m_NumOfPacketsSampled = 0;
+}
+
+bool PacketSampler::countSample()
+{
+	if (++m_Counter < m_SampleRate)
+		return false;
+
+	m_Counter = 0;
+	return true;
+}
+
+bool PacketSampler::isSelected(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType)
+{
+	switch (m_Method)
+	{
+	case CountSampling:
+		return countSample();
+
+	case RandomSampling:
+		// xorshift32
+		m_RandomState ^= m_RandomState << 13;
+		m_RandomState ^= m_RandomState >> 17;
+		m_RandomState ^= m_RandomState << 5;
+		return m_RandomState < m_Threshold;
+
+	case FlowHashSampling:
+	{
+		uint32_t hash;
+		if (!calculateFlowHash(packetData, packetDataLen, linkType, m_Seed, hash))
+			return countSample();
+		return hash < m_Threshold;
+	}
+
+	default:
+		return true;
+	}
+}
+
+bool PacketSampler::calculateFlowHash(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, uint32_t seed, uint32_t& hash)
+{
+	RawPacketHeaders headers;
+	if (!parseRawPacketHeaders(packetData, packetDataLen, linkType, headers))
+		return false;
+
+	// all fragments of a datagram must hash the same, so ports are ignored in fragments (there's no transport offset for them)
+	uint8_t protocol = headers.transportProtocol;
+	uint32_t srcPort = 0, dstPort = 0;
+	if (headers.transportOffset >= 0 &&
+			(protocol == PACKETPP_IPPROTO_TCP || protocol == PACKETPP_IPPROTO_UDP || protocol == PACKETPP_IPPROTO_SCTP))
+	{
+		srcPort = readUint16(headers.ipHeader + headers.transportOffset);
+		dstPort = readUint16(headers.ipHeader + headers.transportOffset + 2);
+	}
+
+	uint32_t result = seed;
+
+	if (headers.etherType == PCPP_ETHERTYPE_IP)
+	{
+		uint32_t srcIP = readUint32(headers.ipHeader + 12);
+		uint32_t dstIP = readUint32(headers.ipHeader + 16);
+
+		// order the endpoints so both directions of the flow hash the same
+		if (srcIP > dstIP || (srcIP == dstIP && srcPort > dstPort))
+		{
+			uint32_t tmp = srcIP; srcIP = dstIP; dstIP = tmp;
+			tmp = srcPort; srcPort = dstPort; dstPort = tmp;
+		}
+
+		result = mixHash(result, srcIP);
+		result = mixHash(result, dstIP);
+	}
+	else
+	{
+		const uint8_t* srcIP = headers.ipHeader + 8;
+		const uint8_t* dstIP = headers.ipHeader + 24;
+
+		int cmp = memcmp(srcIP, dstIP, 16);
+		if (cmp > 0 || (cmp == 0 && srcPort > dstPort))
+		{
+			const uint8_t* tmpIP = srcIP; srcIP = dstIP; dstIP = tmpIP;
+			uint32_t tmpPort = srcPort; srcPort = dstPort; dstPort = tmpPort;
+		}
+
+		for (int i = 0; i < 16; i += 4)
+			result = mixHash(result, readUint32(srcIP + i));
+		for (int i = 0; i < 16; i += 4)
+			result = mixHash(result, readUint32(dstIP + i));
+	}
+
+	result = mixHash(result, (srcPort << 16) | dstPort);
+	result = mixHash(result, protocol);
+	hash = finalizeHash(result);
+	return true;
+}
+
+} // namespace pcpp
@@ -1,5 +1,6 @@
 #include "PcapDevice.h"
 #include "PcapFilter.h"
+#include "BpfJit.h"
 #include "Logger.h"
 #include "TimespecTimeval.h"
 #include <pcap.h>
@@ -11,9 +12,47 @@ IPcapDevice::~IPcapDevice()
 {
 }
 
+bool IPcapDevice::setFilter(GeneralFilter& filter)
+{
+	// the BPF string of the sets would be one more user-space pass over every packet, and one that drops values added to the sets later
+	if (filter.containsFilterSet() && !isBpfFilterInKernel())
+	{
+		// clearFilter() clears the previous post filter too
+		if (!clearFilter())
+			return false;
+
+		if (!m_PostFilter.compile(filter))
+		{
+			LOG_ERROR("Cannot compile the filter set of the filter");
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+	if (!setFilter(filterAsString))
+		return false;
+
+	if (!filter.containsFilterSet())
+		return true;
+
+	// setFilter(std::string) cleared the previous post filter
+	if (!m_PostFilter.compile(filter))
+	{
+		LOG_ERROR("Cannot compile the filter set of the filter, clearing the filter");
+		clearFilter();
+		return false;
+	}
+
+	return true;
+}
+
 bool IPcapDevice::setFilter(std::string filterAsString)
 {
 	LOG_DEBUG("Filter to be set: '%s'", filterAsString.c_str());
+	m_PostFilter.clear();
 	if (!m_DeviceOpened)
 	{
 		LOG_ERROR("Device not Opened!! cannot set filter");
@@ -74,18 +113,24 @@ bool IPcapDevice::matchPacketWithFilter(std::string filterAsString, RawPacket* r
 {
 	static std::string curFilter = "";
 	static struct bpf_program prog;
+	static BpfJit jit;
 	if (curFilter != filterAsString)
 	{
 		LOG_DEBUG("Compiling the filter '%s'", filterAsString.c_str());
 		pcap_freecode(&prog);
+		jit.clear();
 		if (pcap_compile_nopcap(9000, pcpp::LINKTYPE_ETHERNET, &prog, filterAsString.c_str(), 1, 0) < 0)
 		{
 			return false;
 		}
 
+		jit.compile(&prog);
 		curFilter = filterAsString;
 	}
 
+	if (jit.isCompiled())
+		return jit.matchPacket(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getRawDataLen());
+
 	struct pcap_pkthdr pktHdr;
 	pktHdr.caplen = rawPacket->getRawDataLen();
 	pktHdr.len = rawPacket->getRawDataLen();
@@ -140,6 +140,9 @@ bool PcapFileReaderDevice::open()
 	}
 
 	m_PcapLinkLayerType = static_cast<LinkLayerType>(pcap_datalink(m_PcapDescriptor));
+	m_BpfJit.clear();
+	m_LibpcapFilterSet = false;
+	m_PostFilter.clear();
 
 	LOG_DEBUG("Successfully opened file reader device for filename '%s'", m_FileName);
 	m_DeviceOpened = true;
@@ -163,12 +166,27 @@ bool PcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 		return false;
 	}
 	pcap_pkthdr pkthdr;
-	const uint8_t* pPacketData = pcap_next(m_PcapDescriptor, &pkthdr);
-	if (pPacketData == NULL)
+	const uint8_t* pPacketData = NULL;
+	bool packetMatched;
+	do
 	{
-		LOG_DEBUG("Packet could not be read. Probably end-of-file");
-		return false;
-	}
+		pPacketData = pcap_next(m_PcapDescriptor, &pkthdr);
+		if (pPacketData == NULL)
+		{
+			LOG_DEBUG("Packet could not be read. Probably end-of-file");
+			return false;
+		}
+
+		packetMatched = (!m_BpfJit.isCompiled() || m_BpfJit.matchPacket(pPacketData, pkthdr.caplen, pkthdr.len)) &&
+			matchPostFilter(pPacketData, pkthdr.caplen, static_cast<LinkLayerType>(m_PcapLinkLayerType)) &&
+			m_PacketSampler.sample(pPacketData, pkthdr.caplen, static_cast<LinkLayerType>(m_PcapLinkLayerType));
+		if (packetMatched && m_StatefulFilter != NULL)
+		{
+			timespec ts;
+			TIMEVAL_TO_TIMESPEC(&pkthdr.ts, &ts);
+			packetMatched = matchStatefulFilter(pPacketData, pkthdr.caplen, static_cast<LinkLayerType>(m_PcapLinkLayerType), ts);
+		}
+	} while (!packetMatched);
 
 	uint8_t* pMyPacketData = new uint8_t[pkthdr.caplen];
 	memcpy(pMyPacketData, pPacketData, pkthdr.caplen);
@@ -181,6 +199,73 @@ bool PcapFileReaderDevice::getNextPacket(RawPacket& rawPacket)
 	return true;
 }
 
+bool PcapFileReaderDevice::setFilter(std::string filterAsString)
+{
+	LOG_DEBUG("Filter to be set: '%s'", filterAsString.c_str());
+	m_PostFilter.clear();
+	if (m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("File device '%s' not opened, cannot set filter", m_FileName);
+		return false;
+	}
+
+	// filtering is done here rather than by pcap_setfilter() so the program runs as native code
+	struct bpf_program prog;
+	if (pcap_compile(m_PcapDescriptor, &prog, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Error compiling filter. Error message is: %s", pcap_geterr(m_PcapDescriptor));
+		return false;
+	}
+
+	bool useLibpcap = false;
+	if (filterAsString.empty())
+	{
+		m_BpfJit.clear();
+	}
+	else if (!m_BpfJit.compile(&prog))
+	{
+		// BpfJit rejects programs it can't validate, libpcap runs them anyway
+		LOG_DEBUG("BpfJit can't run the filter '%s', filtering with libpcap instead", filterAsString.c_str());
+		useLibpcap = true;
+	}
+
+	bool result = true;
+	if (useLibpcap || m_LibpcapFilterSet)
+	{
+		// an empty string compiles to a program that accepts all packets, which removes the filter libpcap runs
+		struct bpf_program acceptAll;
+		struct bpf_program* libpcapProg = &prog;
+		if (!useLibpcap && !filterAsString.empty())
+		{
+			if (pcap_compile(m_PcapDescriptor, &acceptAll, "", 1, 0) < 0)
+			{
+				LOG_ERROR("Error compiling an empty filter. Error message is: %s", pcap_geterr(m_PcapDescriptor));
+				m_BpfJit.clear();
+				pcap_freecode(&prog);
+				return false;
+			}
+			libpcapProg = &acceptAll;
+		}
+
+		if (pcap_setfilter(m_PcapDescriptor, libpcapProg) < 0)
+		{
+			LOG_ERROR("Error setting filter. Error message is: %s", pcap_geterr(m_PcapDescriptor));
+			m_BpfJit.clear();
+			result = false;
+		}
+		else
+		{
+			m_LibpcapFilterSet = useLibpcap;
+		}
+
+		if (libpcapProg == &acceptAll)
+			pcap_freecode(&acceptAll);
+	}
+
+	pcap_freecode(&prog);
+	return result;
+}
+
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // PcapNgFileReaderDevice members
@@ -196,6 +281,10 @@ PcapNgFileReaderDevice::PcapNgFileReaderDevice(const char* fileName) : IFileRead
 
 bool PcapNgFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, size_t packetLen, timespec packetTimestamp, uint16_t linkType)
 {
+	// the post filter may be set without a BPF filter
+	if (!matchPostFilter(packetData, (int)packetLen, static_cast<LinkLayerType>(linkType)))
+		return false;
+
 	if (m_CurFilter == "")
 		return true;
 
@@ -206,16 +295,21 @@ bool PcapNgFileReaderDevice::matchPacketWithFilter(const uint8_t* packetData, si
 		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), linkTypeAsInt);
 		if (m_BpfInitialized)
 			pcap_freecode(&m_Bpf);
+		m_BpfJit.clear();
 		if (pcap_compile_nopcap(9000, linkTypeAsInt, &m_Bpf, m_CurFilter.c_str(), 1, 0) < 0)
 		{
 			m_BpfInitialized = false;
 			return false;
 		}
 
+		m_BpfJit.compile(&m_Bpf);
 		m_BpfLinkType = linkTypeAsInt;
 		m_BpfInitialized = true;
 	}
 
+	if (m_BpfJit.isCompiled())
+		return m_BpfJit.matchPacket(packetData, packetLen, packetLen);
+
 	struct pcap_pkthdr pktHdr;
 	pktHdr.caplen = packetLen;
 	pktHdr.len = packetLen;
@@ -267,7 +361,9 @@ bool PcapNgFileReaderDevice::getNextPacket(RawPacket& rawPacket, std::string& pa
 		return false;
 	}
 
-	while (!matchPacketWithFilter(pktData, pktHeader.captured_length, pktHeader.timestamp, pktHeader.data_link))
+	while (!matchPacketWithFilter(pktData, pktHeader.captured_length, pktHeader.timestamp, pktHeader.data_link) ||
+			!m_PacketSampler.sample(pktData, pktHeader.captured_length, static_cast<LinkLayerType>(pktHeader.data_link)) ||
+			!matchStatefulFilter(pktData, pktHeader.captured_length, static_cast<LinkLayerType>(pktHeader.data_link), pktHeader.timestamp))
 	{
 		if (!light_get_next_packet((light_pcapng_t*)m_LightPcapNg, &pktHeader, &pktData))
 		{
@@ -307,6 +403,8 @@ void PcapNgFileReaderDevice::getStatistics(pcap_stat& stats) const
 
 bool PcapNgFileReaderDevice::setFilter(std::string filterAsString)
 {
+	m_PostFilter.clear();
+
 	struct bpf_program prog;
 	if (pcap_compile_nopcap(9000, 1, &prog, filterAsString.c_str(), 1, 0) < 0)
 	{
@@ -425,6 +523,26 @@ PcapFileWriterDevice::PcapFileWriterDevice(const char* fileName, LinkLayerType l
 	m_PcapLinkLayerType = linkLayerType;
 	m_AppendMode = false;
 	m_File = NULL;
+	m_Index = NULL;
+	m_NextPacketOffset = 0;
+}
+
+PcapFileWriterDevice::~PcapFileWriterDevice()
+{
+	delete m_Index;
+}
+
+bool PcapFileWriterDevice::setIndexEnabled(bool enabled, uint64_t chunkSize)
+{
+	if (m_DeviceOpened)
+	{
+		LOG_ERROR("Cannot change the index setting of file '%s' while it's opened", m_FileName);
+		return false;
+	}
+
+	delete m_Index;
+	m_Index = (enabled ? new CaptureIndex(chunkSize) : NULL);
+	return true;
 }
 
 void PcapFileWriterDevice::closeFile()
@@ -477,6 +595,14 @@ bool PcapFileWriterDevice::writePacket(RawPacket const& packet)
 		fwrite(&pktHdrTemp, sizeof(pktHdrTemp), 1, m_File);
 		fwrite(((RawPacket&)packet).getRawData(), pktHdrTemp.caplen, 1, m_File);
 	}
+
+	if (m_Index != NULL)
+	{
+		// both pcap_dump and the code above write a 16-byte record header followed by the packet data
+		m_Index->addPacket((RawPacket&)packet, m_NextPacketOffset);
+		m_NextPacketOffset += sizeof(packet_header) + pktHdr.caplen;
+	}
+
 	LOG_DEBUG("Packet written successfully to '%s'", m_FileName);
 	m_NumOfPacketsWritten++;
 	return true;
@@ -532,6 +658,12 @@ bool PcapFileWriterDevice::open()
 		return false;
 	}
 
+	if (m_Index != NULL)
+	{
+		m_Index->startBuilding();
+		m_NextPacketOffset = sizeof(pcap_file_header);
+	}
+
 	m_DeviceOpened = true;
 	LOG_DEBUG("File writer device for file '%s' opened successfully", m_FileName);
 	return true;
@@ -575,6 +707,13 @@ void PcapFileWriterDevice::close()
 
 	m_PcapDumpHandler = NULL;
 	m_File = NULL;
+
+	if (m_Index != NULL)
+	{
+		m_Index->finishBuilding(m_NextPacketOffset);
+		m_Index->writeToFile(CaptureIndex::getIndexFileName(m_FileName));
+	}
+
 	LOG_DEBUG("File writer closed for file '%s'", m_FileName);
 }
 
@@ -635,6 +774,20 @@ bool PcapFileWriterDevice::open(bool appendMode)
 
 	m_PcapDumpHandler = ((pcap_dumper_t *)m_File);
 
+	if (m_Index != NULL)
+	{
+		// index the packets already in the file so the index covers the whole file
+		m_Index->startBuilding();
+		PcapFileReaderDevice reader(m_FileName);
+		if (reader.open())
+		{
+			m_Index->addPackets(reader);
+			reader.close();
+		}
+
+		m_NextPacketOffset = (uint64_t)ftell(m_File);
+	}
+
 	m_DeviceOpened = true;
 	LOG_DEBUG("File writer device for file '%s' opened successfully in append mode", m_FileName);
 	return true;
@@ -656,6 +809,10 @@ PcapNgFileWriterDevice::PcapNgFileWriterDevice(const char* fileName, int compres
 
 bool PcapNgFileWriterDevice::matchPacketWithFilter(const uint8_t* packetData, size_t packetLen, timespec packetTimestamp, uint16_t linkType)
 {
+	// the post filter may be set without a BPF filter
+	if (!matchPostFilter(packetData, (int)packetLen, static_cast<LinkLayerType>(linkType)))
+		return false;
+
 	if (m_CurFilter == "")
 		return true;
 
@@ -666,16 +823,21 @@ bool PcapNgFileWriterDevice::matchPacketWithFilter(const uint8_t* packetData, si
 		LOG_DEBUG("Compiling the filter '%s' for link type %d", m_CurFilter.c_str(), linkTypeAsInt);
 		if (m_BpfInitialized)
 			pcap_freecode(&m_Bpf);
+		m_BpfJit.clear();
 		if (pcap_compile_nopcap(9000, linkTypeAsInt, &m_Bpf, m_CurFilter.c_str(), 1, 0) < 0)
 		{
 			m_BpfInitialized = false;
 			return false;
 		}
 
+		m_BpfJit.compile(&m_Bpf);
 		m_BpfLinkType = linkTypeAsInt;
 		m_BpfInitialized = true;
 	}
 
+	if (m_BpfJit.isCompiled())
+		return m_BpfJit.matchPacket(packetData, packetLen, packetLen);
+
 	struct pcap_pkthdr pktHdr;
 	pktHdr.caplen = packetLen;
 	pktHdr.len = packetLen;
@@ -837,6 +999,8 @@ void PcapNgFileWriterDevice::getStatistics(pcap_stat& stats) const
 
 bool PcapNgFileWriterDevice::setFilter(std::string filterAsString)
 {
+	m_PostFilter.clear();
+
 	struct bpf_program prog;
 	if (pcap_compile_nopcap(9000, 1, &prog, filterAsString.c_str(), 1, 0) < 0)
 	{
@@ -1,21 +1,343 @@
 #define LOG_MODULE PcapLogModuleLiveDevice
 
 #include "PcapFilter.h"
+#include "NativeFilter.h"
+#include "BpfJit.h"
+#include "FilterSet.h"
 #include "Logger.h"
+#include "EthLayer.h"
 #include "IPv4Layer.h"
 #include <sstream>
+#include <algorithm>
+#include <stdlib.h>
 #if defined(WINx64)
 #include <winsock2.h>
 #endif
 #include <pcap.h>
 #include "RawPacket.h"
 #include "TimespecTimeval.h"
+#include "EndianPortable.h"
+
+// a BPF expression that doesn't match any real packet, used for empty sets. libpcap refuses to compile expressions its optimizer
+// proves to reject all packets, so it can't be a contradiction such as "ip and ip6"
+#define EMPTY_SET_BPF_STRING "len = 0"
+
+// a BPF expression that matches all packets, used where a superset of the packets is needed but no narrower one is known
+#define ALL_PACKETS_BPF_STRING "len >= 0"
 
 namespace pcpp
 {
 
+namespace
+{
+
+typedef IPPrefixSet::Prefix Prefix;
+typedef std::pair<uint16_t, uint16_t> PortRange;
+
+bool prefixLess(const Prefix& first, const Prefix& second)
+{
+	if (first.high != second.high)
+		return first.high < second.high;
+	if (first.low != second.low)
+		return first.low < second.low;
+	return first.length < second.length;
+}
+
+Prefix truncatePrefix(const Prefix& prefix, uint8_t length)
+{
+	Prefix result = prefix;
+	result.length = length;
+	result.high &= (length == 0 ? 0 : (length >= 64 ? ~(uint64_t)0 : ~(uint64_t)0 << (64 - length)));
+	result.low &= (length <= 64 ? 0 : (length >= 128 ? ~(uint64_t)0 : ~(uint64_t)0 << (128 - length)));
+	return result;
+}
+
+bool prefixContains(const Prefix& outer, const Prefix& inner)
+{
+	if (outer.length > inner.length)
+		return false;
+
+	Prefix truncated = truncatePrefix(inner, outer.length);
+	return truncated.high == outer.high && truncated.low == outer.low;
+}
+
+// turn a list of prefixes of the same family into the shortest list that covers exactly the same addresses: prefixes contained in
+// other prefixes are dropped and pairs of sibling prefixes are merged into their parent, for example 10.0.0.0/25 + 10.0.0.128/25
+// into 10.0.0.0/24
+void aggregatePrefixes(std::vector<Prefix>& prefixes)
+{
+	std::sort(prefixes.begin(), prefixes.end(), prefixLess);
+
+	std::vector<Prefix> result;
+	result.reserve(prefixes.size());
+	for (std::vector<Prefix>::const_iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+	{
+		// the list is sorted, so only the last prefix kept may contain this one
+		if (!result.empty() && prefixContains(result.back(), *iter))
+			continue;
+
+		result.push_back(*iter);
+		while (result.size() >= 2)
+		{
+			const Prefix& last = result[result.size() - 1];
+			const Prefix& beforeLast = result[result.size() - 2];
+			if (last.length != beforeLast.length || last.length == 0)
+				break;
+
+			Prefix parent = truncatePrefix(beforeLast, last.length - 1);
+			if (!prefixContains(parent, last))
+				break;
+
+			result.pop_back();
+			result.back() = parent;
+		}
+	}
+
+	prefixes.swap(result);
+}
+
+// aggregate the prefixes and, while there are more than maxPrefixes, shorten the longest ones by one bit. The result covers all the
+// original addresses and possibly more
+void coarsenPrefixes(std::vector<Prefix>& prefixes, size_t maxPrefixes)
+{
+	aggregatePrefixes(prefixes);
+	while (maxPrefixes > 0 && prefixes.size() > maxPrefixes)
+	{
+		uint8_t longestLength = 0;
+		for (std::vector<Prefix>::const_iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+			longestLength = std::max(longestLength, iter->length);
+
+		for (std::vector<Prefix>::iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+		{
+			if (iter->length == longestLength)
+				*iter = truncatePrefix(*iter, longestLength - 1);
+		}
+
+		aggregatePrefixes(prefixes);
+	}
+}
+
+std::string prefixToBpfTerm(const Prefix& prefix, const std::string& dir)
+{
+	std::string address;
+	if (prefix.isIPv6)
+	{
+		uint8_t addressBytes[16];
+		for (int i = 0; i < 8; i++)
+		{
+			addressBytes[i] = (uint8_t)(prefix.high >> (56 - 8 * i));
+			addressBytes[8 + i] = (uint8_t)(prefix.low >> (56 - 8 * i));
+		}
+		address = IPv6Address(addressBytes).toString();
+	}
+	else
+		address = IPv4Address(htobe32((uint32_t)(prefix.high >> 32))).toString();
+
+	if (prefix.length == (prefix.isIPv6 ? 128 : 32))
+		return dir + "host " + address;
+
+	std::ostringstream stream;
+	stream << (int)prefix.length;
+	return dir + "net " + address + '/' + stream.str();
+}
+
+std::string prefixesToBpfString(const std::vector<Prefix>& prefixes, const std::string& protocol, const std::string& dir)
+{
+	// after aggregation a /0 prefix is the only one, and it matches every packet of the family
+	if (prefixes.size() == 1 && prefixes.front().length == 0)
+		return protocol;
+
+	std::string terms;
+	for (std::vector<Prefix>::const_iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+	{
+		if (!terms.empty())
+			terms += " or ";
+		terms += prefixToBpfTerm(*iter, dir);
+	}
+
+	return protocol + " and " + (prefixes.size() > 1 ? '(' + terms + ')' : terms);
+}
+
+// returns false if the prefixes were coarsened and the result matches a superset of the packets
+bool prefixSetToBpfString(const IPPrefixSet* prefixSet, Direction direction, size_t maxBpfTerms, std::string& result)
+{
+	std::vector<Prefix> prefixes;
+	prefixSet->getPrefixes(prefixes);
+
+	std::vector<Prefix> ipv4Prefixes;
+	std::vector<Prefix> ipv6Prefixes;
+	for (std::vector<Prefix>::const_iterator iter = prefixes.begin(); iter != prefixes.end(); iter++)
+		(iter->isIPv6 ? ipv6Prefixes : ipv4Prefixes).push_back(*iter);
+
+	aggregatePrefixes(ipv4Prefixes);
+	aggregatePrefixes(ipv6Prefixes);
+
+	// share the terms between the families in proportion to their sizes
+	bool isExact = true;
+	if (maxBpfTerms > 0 && ipv4Prefixes.size() + ipv6Prefixes.size() > maxBpfTerms)
+	{
+		isExact = false;
+		size_t ipv6MaxTerms = 0;
+		if (!ipv6Prefixes.empty())
+			ipv6MaxTerms = std::max((size_t)1, maxBpfTerms * ipv6Prefixes.size() / (ipv4Prefixes.size() + ipv6Prefixes.size()));
+		size_t ipv4MaxTerms = (maxBpfTerms > ipv6MaxTerms ? maxBpfTerms - ipv6MaxTerms : 1);
+
+		coarsenPrefixes(ipv4Prefixes, ipv4MaxTerms);
+		coarsenPrefixes(ipv6Prefixes, ipv6MaxTerms);
+	}
+
+	// libpcap's default direction is "src or dst", leaving it out keeps the string short
+	std::string dir = (direction == SRC ? "src " : (direction == DST ? "dst " : ""));
+
+	if (!ipv4Prefixes.empty() && !ipv6Prefixes.empty())
+		result = '(' + prefixesToBpfString(ipv4Prefixes, "ip", dir) + ") or (" + prefixesToBpfString(ipv6Prefixes, "ip6", dir) + ')';
+	else if (!ipv4Prefixes.empty())
+		result = prefixesToBpfString(ipv4Prefixes, "ip", dir);
+	else if (!ipv6Prefixes.empty())
+		result = prefixesToBpfString(ipv6Prefixes, "ip6", dir);
+	else
+		result = EMPTY_SET_BPF_STRING;
+
+	return isExact;
+}
+
+bool gapLess(const std::pair<uint32_t, size_t>& first, const std::pair<uint32_t, size_t>& second)
+{
+	if (first.first != second.first)
+		return first.first < second.first;
+	return first.second < second.second;
+}
+
+// merge the port ranges separated by the smallest gaps until there are at most maxRanges ranges. The result covers all the original
+// ports and possibly more. Returns false if ranges were merged
+bool coarsenPortRanges(std::vector<PortRange>& ranges, size_t maxRanges)
+{
+	if (maxRanges == 0 || ranges.size() <= maxRanges)
+		return true;
+
+	std::vector<std::pair<uint32_t, size_t> > gaps;
+	gaps.reserve(ranges.size() - 1);
+	for (size_t i = 0; i + 1 < ranges.size(); i++)
+		gaps.push_back(std::pair<uint32_t, size_t>((uint32_t)ranges[i + 1].first - ranges[i].second, i));
+
+	std::sort(gaps.begin(), gaps.end(), gapLess);
+
+	// closing the gap after range i merges it with range i + 1
+	std::vector<bool> closeGap(ranges.size(), false);
+	for (size_t i = 0; i < ranges.size() - maxRanges; i++)
+		closeGap[gaps[i].second] = true;
+
+	std::vector<PortRange> result;
+	result.reserve(maxRanges);
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (i > 0 && closeGap[i - 1])
+			result.back().second = ranges[i].second;
+		else
+			result.push_back(ranges[i]);
+	}
+
+	ranges.swap(result);
+	return false;
+}
+
+bool validateHostAddresses(const std::vector<std::string>& ipAddresses)
+{
+	for (std::vector<std::string>::const_iterator iter = ipAddresses.begin(); iter != ipAddresses.end(); iter++)
+	{
+		if (iter->find('/') != std::string::npos)
+		{
+			LOG_ERROR("'%s' isn't an IP address, use SubnetSetFilter for subnets", iter->c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+} // namespace
+
+const size_t IFilterWithSet::DefaultMaxBpfTerms;
+
+IFilterWithSet::IFilterWithSet(Direction dir) : IFilterWithDirection(dir), m_MaxBpfTerms(DefaultMaxBpfTerms), m_CachedBpfStringValid(false),
+	m_CachedBpfStringExact(true), m_CachedSetVersion(0), m_CachedMaxBpfTerms(0), m_CachedDirection(dir), m_NativeProgramDirection(dir)
+{
+}
+
+void IFilterWithSet::updateBpfString()
+{
+	// the version is read before the content, so a change made while the string is built is caught by the next call
+	uint32_t setVersion = getFilterSet()->getVersion();
+	if (m_CachedBpfStringValid && m_CachedSetVersion == setVersion && m_CachedMaxBpfTerms == m_MaxBpfTerms && m_CachedDirection == getDir())
+		return;
+
+	m_CachedBpfStringExact = buildBpfString(m_CachedBpfString);
+	m_CachedSetVersion = setVersion;
+	m_CachedMaxBpfTerms = m_MaxBpfTerms;
+	m_CachedDirection = getDir();
+	m_CachedBpfStringValid = true;
+}
+
+void IFilterWithSet::parseToString(std::string& result)
+{
+	updateBpfString();
+	result = m_CachedBpfString;
+}
+
+bool IFilterWithSet::isBpfExact()
+{
+	updateBpfString();
+	return m_CachedBpfStringExact;
+}
+
+bool IFilterWithSet::matchPacketWithFilter(RawPacket* rawPacket)
+{
+	if (m_NativeProgram == NULL || m_NativeProgramDirection != getDir())
+	{
+		freeProgram();
+		m_NativeProgram = new NativeFilter();
+		if (!m_NativeProgram->compile(*this))
+		{
+			freeProgram();
+			return false;
+		}
+		m_NativeProgramDirection = getDir();
+	}
+
+	return m_NativeProgram->matchPacket(rawPacket);
+}
+
+void IFilterWithSet::getNativeProgramKey(std::string& result)
+{
+	// the program keeps a reference to the set, so another set can't be created at the same address while the program exists
+	std::ostringstream stream;
+	stream << "set " << (const void*)getFilterSet() << ' ' << (int)getDir();
+	result = stream.str();
+}
+
 bool GeneralFilter::matchPacketWithFilter(RawPacket* rawPacket)
 {
+	// the BPF string of a set may match more packets than the set, so a filter that contains one is matched natively. The program
+	// shares the sets with the filters, so it's compiled again only if the filter tree changes, and the BPF string isn't built
+	if (containsFilterSet())
+	{
+		std::string programKey;
+		getNativeProgramKey(programKey);
+		if (m_NativeProgram == NULL || m_lastProgramString != programKey)
+		{
+			freeProgram();
+			m_NativeProgram = new NativeFilter();
+			if (!m_NativeProgram->compile(*this))
+			{
+				freeProgram();
+				return false;
+			}
+			m_lastProgramString = programKey;
+		}
+
+		return m_NativeProgram->matchPacket(rawPacket);
+	}
+
 	std::string filterStr;
 	parseToString(filterStr);
 
@@ -35,6 +357,17 @@ bool GeneralFilter::matchPacketWithFilter(RawPacket* rawPacket)
 		m_lastProgramString = filterStr;
 	}
 
+	if (m_Jit == NULL)
+	{
+		// the program may have been compiled by BPFStringFilter::verifyFilter()
+		m_Jit = new BpfJit();
+		m_Jit->compile(m_program);
+	}
+
+	// fall back to libpcap if the JIT rejected the program
+	if (m_Jit->isCompiled())
+		return m_Jit->matchPacket(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getRawDataLen());
+
 	struct pcap_pkthdr pktHdr;
 	pktHdr.caplen = rawPacket->getRawDataLen();
 	pktHdr.len = rawPacket->getRawDataLen();
@@ -51,8 +384,19 @@ void GeneralFilter::freeProgram()
 		pcap_freecode(m_program);
 		delete m_program;
 		m_program = NULL;
-		m_lastProgramString.clear();
 	}
+
+	delete m_Jit;
+	m_Jit = NULL;
+	delete m_NativeProgram;
+	m_NativeProgram = NULL;
+	m_lastProgramString.clear();
+}
+
+bool GeneralFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	LOG_ERROR("This filter type can't be compiled natively");
+	return false;
 }
 
 
@@ -218,6 +562,172 @@ void IPFilter::parseToString(std::string& result)
 	}
 }
 
+bool IPFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	// like the BPF string, the native filter supports only IPv4 addresses
+	IPv4Address ipAddr(m_Address);
+	if (!ipAddr.isValid())
+	{
+		LOG_ERROR("Native IP filter must be used with a valid IPv4 address, '%s' isn't one", m_Address.c_str());
+		return false;
+	}
+
+	uint32_t mask = 0xffffffff;
+	if (!m_IPv4Mask.empty())
+	{
+		IPv4Address maskAsAddr(m_IPv4Mask);
+		if (!maskAsAddr.isValid())
+		{
+			LOG_ERROR("Invalid IPv4 mask '%s'", m_IPv4Mask.c_str());
+			return false;
+		}
+
+		mask = maskAsAddr.toInt();
+	}
+	else if (m_Len > 0)
+	{
+		if (m_Len > 32)
+		{
+			LOG_ERROR("Invalid IPv4 subnet length %d", m_Len);
+			return false;
+		}
+
+		mask = htobe32(m_Len == 32 ? 0xffffffff : ~(0xffffffff >> m_Len));
+	}
+
+	builder.emitIPv4Net(ipAddr.toInt(), mask, getDir(), onMatch, onMismatch);
+	return true;
+}
+
+IPSetFilter::IPSetFilter(Direction dir) : IFilterWithSet(dir), m_Set(new IPPrefixSet())
+{
+}
+
+IPSetFilter::IPSetFilter(const std::vector<std::string>& ipAddresses, Direction dir) : IFilterWithSet(dir), m_Set(new IPPrefixSet())
+{
+	setAddresses(ipAddresses);
+}
+
+IPSetFilter::~IPSetFilter()
+{
+	m_Set->release();
+}
+
+bool IPSetFilter::addAddress(const std::string& ipAddress)
+{
+	if (!validateHostAddresses(std::vector<std::string>(1, ipAddress)))
+		return false;
+
+	return m_Set->add(ipAddress);
+}
+
+bool IPSetFilter::removeAddress(const std::string& ipAddress)
+{
+	if (!validateHostAddresses(std::vector<std::string>(1, ipAddress)))
+		return false;
+
+	return m_Set->remove(ipAddress);
+}
+
+bool IPSetFilter::setAddresses(const std::vector<std::string>& ipAddresses)
+{
+	if (!validateHostAddresses(ipAddresses))
+		return false;
+
+	return m_Set->assign(ipAddresses);
+}
+
+void IPSetFilter::clearAddresses()
+{
+	m_Set->clear();
+}
+
+size_t IPSetFilter::getNumOfAddresses() const
+{
+	return m_Set->size();
+}
+
+bool IPSetFilter::containsAddress(const IPAddress& ipAddress) const
+{
+	return m_Set->contains(ipAddress);
+}
+
+const FilterSet* IPSetFilter::getFilterSet() const
+{
+	return m_Set;
+}
+
+bool IPSetFilter::buildBpfString(std::string& result) const
+{
+	return prefixSetToBpfString(m_Set, getDir(), getMaxBpfTerms(), result);
+}
+
+bool IPSetFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitIPPrefixSet(m_Set, getDir(), onMatch, onMismatch);
+	return true;
+}
+
+SubnetSetFilter::SubnetSetFilter(Direction dir) : IFilterWithSet(dir), m_Set(new IPPrefixSet())
+{
+}
+
+SubnetSetFilter::SubnetSetFilter(const std::vector<std::string>& subnets, Direction dir) : IFilterWithSet(dir), m_Set(new IPPrefixSet())
+{
+	setSubnets(subnets);
+}
+
+SubnetSetFilter::~SubnetSetFilter()
+{
+	m_Set->release();
+}
+
+bool SubnetSetFilter::addSubnet(const std::string& subnet)
+{
+	return m_Set->add(subnet);
+}
+
+bool SubnetSetFilter::removeSubnet(const std::string& subnet)
+{
+	return m_Set->remove(subnet);
+}
+
+bool SubnetSetFilter::setSubnets(const std::vector<std::string>& subnets)
+{
+	return m_Set->assign(subnets);
+}
+
+void SubnetSetFilter::clearSubnets()
+{
+	m_Set->clear();
+}
+
+size_t SubnetSetFilter::getNumOfSubnets() const
+{
+	return m_Set->size();
+}
+
+bool SubnetSetFilter::containsAddress(const IPAddress& ipAddress) const
+{
+	return m_Set->contains(ipAddress);
+}
+
+const FilterSet* SubnetSetFilter::getFilterSet() const
+{
+	return m_Set;
+}
+
+bool SubnetSetFilter::buildBpfString(std::string& result) const
+{
+	return prefixSetToBpfString(m_Set, getDir(), getMaxBpfTerms(), result);
+}
+
+bool SubnetSetFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitIPPrefixSet(m_Set, getDir(), onMatch, onMismatch);
+	return true;
+}
+
 void IPv4IDFilter::parseToString(std::string& result)
 {
 	std::string op = parseOperator();
@@ -226,6 +736,11 @@ void IPv4IDFilter::parseToString(std::string& result)
 	result = "ip[4:2] " + op + ' ' + stream.str();
 }
 
+bool IPv4IDFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	return builder.emitField(NativeFilterBuilder::IPv4Field, 4, 2, 0, getOperator(), m_IpID, onMatch, onMismatch);
+}
+
 void IPv4TotalLengthFilter::parseToString(std::string& result)
 {
 	std::string op = parseOperator();
@@ -234,6 +749,11 @@ void IPv4TotalLengthFilter::parseToString(std::string& result)
 	result = "ip[2:2] " + op + ' ' + stream.str();
 }
 
+bool IPv4TotalLengthFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	return builder.emitField(NativeFilterBuilder::IPv4Field, 2, 2, 0, getOperator(), m_TotalLength, onMatch, onMismatch);
+}
+
 void PortFilter::portToString(uint16_t portAsInt)
 {
 	std::ostringstream stream;
@@ -253,6 +773,13 @@ void PortFilter::parseToString(std::string& result)
 	result = dir + " port " + m_Port;
 }
 
+bool PortFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	uint16_t port = (uint16_t)atoi(m_Port.c_str());
+	builder.emitPortRange(port, port, getDir(), onMatch, onMismatch);
+	return true;
+}
+
 void PortRangeFilter::parseToString(std::string& result)
 {
 	std::string dir;
@@ -266,6 +793,103 @@ void PortRangeFilter::parseToString(std::string& result)
 	result = dir + " portrange " + fromPortStream.str() + '-' + toPortStream.str();
 }
 
+bool PortRangeFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitPortRange(m_FromPort, m_ToPort, getDir(), onMatch, onMismatch);
+	return true;
+}
+
+PortSetFilter::PortSetFilter(Direction dir) : IFilterWithSet(dir), m_Set(new PortSet())
+{
+}
+
+PortSetFilter::PortSetFilter(const std::vector<uint16_t>& ports, Direction dir) : IFilterWithSet(dir), m_Set(new PortSet())
+{
+	m_Set->assign(ports);
+}
+
+PortSetFilter::~PortSetFilter()
+{
+	m_Set->release();
+}
+
+void PortSetFilter::addPort(uint16_t port)
+{
+	m_Set->add(port);
+}
+
+void PortSetFilter::addPortRange(uint16_t fromPort, uint16_t toPort)
+{
+	m_Set->addRange(fromPort, toPort);
+}
+
+bool PortSetFilter::removePort(uint16_t port)
+{
+	return m_Set->remove(port);
+}
+
+void PortSetFilter::setPorts(const std::vector<uint16_t>& ports)
+{
+	m_Set->assign(ports);
+}
+
+void PortSetFilter::clearPorts()
+{
+	m_Set->clear();
+}
+
+size_t PortSetFilter::getNumOfPorts() const
+{
+	return m_Set->size();
+}
+
+bool PortSetFilter::containsPort(uint16_t port) const
+{
+	return m_Set->contains(port);
+}
+
+const FilterSet* PortSetFilter::getFilterSet() const
+{
+	return m_Set;
+}
+
+bool PortSetFilter::buildBpfString(std::string& result) const
+{
+	std::vector<PortRange> ranges;
+	m_Set->getRanges(ranges);
+	bool isExact = coarsenPortRanges(ranges, getMaxBpfTerms());
+
+	if (ranges.empty())
+	{
+		result = EMPTY_SET_BPF_STRING;
+		return true;
+	}
+
+	// libpcap's default direction is "src or dst", leaving it out keeps the string short
+	std::string dir = (getDir() == SRC ? "src " : (getDir() == DST ? "dst " : ""));
+
+	std::ostringstream stream;
+	for (std::vector<PortRange>::const_iterator iter = ranges.begin(); iter != ranges.end(); iter++)
+	{
+		if (iter != ranges.begin())
+			stream << " or ";
+
+		if (iter->first == iter->second)
+			stream << dir << "port " << iter->first;
+		else
+			stream << dir << "portrange " << iter->first << '-' << iter->second;
+	}
+
+	result = stream.str();
+	return isExact;
+}
+
+bool PortSetFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitPortSet(m_Set, getDir(), onMatch, onMismatch);
+	return true;
+}
+
 void MacAddressFilter::parseToString(std::string& result)
 {
 	if (getDir() != SRC_OR_DST)
@@ -278,6 +902,12 @@ void MacAddressFilter::parseToString(std::string& result)
 		result = "ether host " + m_MacAddress.toString();
 }
 
+bool MacAddressFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitMacAddress(m_MacAddress, getDir(), onMatch, onMismatch);
+	return true;
+}
+
 void EtherTypeFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -285,6 +915,12 @@ void EtherTypeFilter::parseToString(std::string& result)
 	result = "ether proto " + stream.str();
 }
 
+bool EtherTypeFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	builder.emitEtherType(m_EtherType, onMatch, onMismatch);
+	return true;
+}
+
 AndFilter::AndFilter(std::vector<GeneralFilter*>& filters)
 {
 	for(std::vector<GeneralFilter*>::iterator it = filters.begin(); it != filters.end(); ++it)
@@ -318,6 +954,36 @@ void AndFilter::parseToString(std::string& result)
 	}
 }
 
+bool AndFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	// an empty filter list is parsed to an empty BPF string, which matches all packets
+	if (m_FilterList.empty())
+	{
+		builder.emitAlways(onMatch);
+		return true;
+	}
+
+	for (std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if (*it == NULL)
+		{
+			LOG_ERROR("Cannot compile a NULL filter");
+			return false;
+		}
+
+		if (it + 1 == m_FilterList.end())
+			return (*it)->compileNative(builder, onMatch, onMismatch);
+
+		// the next filter is evaluated only if this one matches
+		NativeFilterBuilder::Label nextFilter = builder.newLabel();
+		if (!(*it)->compileNative(builder, nextFilter, onMismatch))
+			return false;
+		builder.placeLabel(nextFilter);
+	}
+
+	return true;
+}
+
 OrFilter::OrFilter(std::vector<GeneralFilter*>& filters)
 {
 	for(std::vector<GeneralFilter*>::iterator it = filters.begin(); it != filters.end(); ++it)
@@ -341,13 +1007,145 @@ void OrFilter::parseToString(std::string& result)
 	}
 }
 
+bool AndFilter::isBpfExact()
+{
+	for (std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if (!(*it)->isBpfExact())
+			return false;
+	}
+
+	return true;
+}
+
+bool AndFilter::containsFilterSet() const
+{
+	for (std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if ((*it)->containsFilterSet())
+			return true;
+	}
+
+	return false;
+}
+
+void AndFilter::getNativeProgramKey(std::string& result)
+{
+	result = "and";
+	for (std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		std::string innerKey;
+		(*it)->getNativeProgramKey(innerKey);
+		result += " (" + innerKey + ')';
+	}
+}
+
+bool OrFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	// an empty filter list is parsed to an empty BPF string, which matches all packets
+	if (m_FilterList.empty())
+	{
+		builder.emitAlways(onMatch);
+		return true;
+	}
+
+	for (std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if (*it == NULL)
+		{
+			LOG_ERROR("Cannot compile a NULL filter");
+			return false;
+		}
+
+		if (it + 1 == m_FilterList.end())
+			return (*it)->compileNative(builder, onMatch, onMismatch);
+
+		// the next filter is evaluated only if this one doesn't match
+		NativeFilterBuilder::Label nextFilter = builder.newLabel();
+		if (!(*it)->compileNative(builder, onMatch, nextFilter))
+			return false;
+		builder.placeLabel(nextFilter);
+	}
+
+	return true;
+}
+
+bool OrFilter::isBpfExact()
+{
+	for (std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if (!(*it)->isBpfExact())
+			return false;
+	}
+
+	return true;
+}
+
+bool OrFilter::containsFilterSet() const
+{
+	for (std::vector<GeneralFilter*>::const_iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		if ((*it)->containsFilterSet())
+			return true;
+	}
+
+	return false;
+}
+
+void OrFilter::getNativeProgramKey(std::string& result)
+{
+	result = "or";
+	for (std::vector<GeneralFilter*>::iterator it = m_FilterList.begin(); it != m_FilterList.end(); ++it)
+	{
+		std::string innerKey;
+		(*it)->getNativeProgramKey(innerKey);
+		result += " (" + innerKey + ')';
+	}
+}
+
 void NotFilter::parseToString(std::string& result)
 {
 	std::string innerFilterAsString;
 	m_FilterToInverse->parseToString(innerFilterAsString);
+
+	// the inverse of a superset would be a subset, which can't be used as a pre-filter
+	if (!m_FilterToInverse->isBpfExact())
+	{
+		result = ALL_PACKETS_BPF_STRING;
+		return;
+	}
+
 	result = "not (" + innerFilterAsString + ')';
 }
 
+bool NotFilter::isBpfExact()
+{
+	return m_FilterToInverse->isBpfExact();
+}
+
+bool NotFilter::containsFilterSet() const
+{
+	return m_FilterToInverse != NULL && m_FilterToInverse->containsFilterSet();
+}
+
+void NotFilter::getNativeProgramKey(std::string& result)
+{
+	std::string innerKey;
+	m_FilterToInverse->getNativeProgramKey(innerKey);
+	result = "not (" + innerKey + ')';
+}
+
+bool NotFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	if (m_FilterToInverse == NULL)
+	{
+		LOG_ERROR("Cannot compile a NULL filter");
+		return false;
+	}
+
+	return m_FilterToInverse->compileNative(builder, onMismatch, onMatch);
+}
+
 void ProtoFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -391,6 +1189,45 @@ void ProtoFilter::parseToString(std::string& result)
 	}
 }
 
+bool ProtoFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	switch (m_Proto)
+	{
+	case TCP:
+		builder.emitIPProtocol(PACKETPP_IPPROTO_TCP, true, true, onMatch, onMismatch);
+		break;
+	case UDP:
+		builder.emitIPProtocol(PACKETPP_IPPROTO_UDP, true, true, onMatch, onMismatch);
+		break;
+	case ICMP:
+		builder.emitIPProtocol(PACKETPP_IPPROTO_ICMP, true, false, onMatch, onMismatch);
+		break;
+	case VLAN:
+		builder.emitVlan(false, 0, onMatch, onMismatch);
+		break;
+	case IPv4:
+		builder.emitEtherType(PCPP_ETHERTYPE_IP, onMatch, onMismatch);
+		break;
+	case IPv6:
+		builder.emitEtherType(PCPP_ETHERTYPE_IPV6, onMatch, onMismatch);
+		break;
+	case ARP:
+		builder.emitEtherType(PCPP_ETHERTYPE_ARP, onMatch, onMismatch);
+		break;
+	case GRE:
+		builder.emitIPProtocol(PACKETPP_IPPROTO_GRE, true, true, onMatch, onMismatch);
+		break;
+	case IGMP:
+		builder.emitIPProtocol(PACKETPP_IPPROTO_IGMP, true, true, onMatch, onMismatch);
+		break;
+	default:
+		LOG_ERROR("Protocol isn't supported by the native filter");
+		return false;
+	}
+
+	return true;
+}
+
 void ArpFilter::parseToString(std::string& result)
 {
 	std::ostringstream sstream;
@@ -398,6 +1235,11 @@ void ArpFilter::parseToString(std::string& result)
 	result += sstream.str();
 }
 
+bool ArpFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	return builder.emitField(NativeFilterBuilder::ArpField, 7, 1, 0, EQUALS, (uint32_t)m_OpCode, onMatch, onMismatch);
+}
+
 void VlanFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -405,6 +1247,18 @@ void VlanFilter::parseToString(std::string& result)
 	result = "vlan " + stream.str();
 }
 
+bool VlanFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	if (m_VlanID > 0x0fff)
+	{
+		LOG_ERROR("Invalid VLAN ID %d", m_VlanID);
+		return false;
+	}
+
+	builder.emitVlan(true, m_VlanID, onMatch, onMismatch);
+	return true;
+}
+
 void TcpFlagsFilter::parseToString(std::string& result)
 {
 	if (m_TcpFlagsBitMask == 0)
@@ -440,6 +1294,21 @@ void TcpFlagsFilter::parseToString(std::string& result)
 	}
 }
 
+bool TcpFlagsFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	// an empty bit mask is parsed to an empty BPF string, which matches all packets
+	if (m_TcpFlagsBitMask == 0)
+	{
+		builder.emitAlways(onMatch);
+		return true;
+	}
+
+	if (m_MatchOption == MatchOneAtLeast)
+		return builder.emitField(NativeFilterBuilder::TcpField, 13, 1, m_TcpFlagsBitMask, NOT_EQUALS, 0, onMatch, onMismatch);
+	else //m_MatchOption == MatchAll
+		return builder.emitField(NativeFilterBuilder::TcpField, 13, 1, m_TcpFlagsBitMask, EQUALS, m_TcpFlagsBitMask, onMatch, onMismatch);
+}
+
 void TcpWindowSizeFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -447,6 +1316,11 @@ void TcpWindowSizeFilter::parseToString(std::string& result)
 	result = "tcp[14:2] " + parseOperator() + ' ' + stream.str();
 }
 
+bool TcpWindowSizeFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	return builder.emitField(NativeFilterBuilder::TcpField, 14, 2, 0, getOperator(), m_WindowSize, onMatch, onMismatch);
+}
+
 void UdpLengthFilter::parseToString(std::string& result)
 {
 	std::ostringstream stream;
@@ -454,4 +1328,9 @@ void UdpLengthFilter::parseToString(std::string& result)
 	result = "udp[4:2] " + parseOperator() + ' ' + stream.str();
 }
 
+bool UdpLengthFilter::compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+{
+	return builder.emitField(NativeFilterBuilder::UdpField, 4, 2, 0, getOperator(), m_Length, onMatch, onMismatch);
+}
+
 } // namespace pcpp
@@ -10,10 +10,15 @@
 #include "Logger.h"
 #include "PlatformSpecificUtils.h"
 #include "SystemUtils.h"
+#include "ToeplitzHash.h"
+#include "TimespecTimeval.h"
 #include <string.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <new>
+#include <sched.h>
+#include <time.h>
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 // The definition of BPF_MAJOR_VERSION is required to support Npcap. In Npcap there are 
 // compilation errors due to struct redefinition when including both Packet32.h and pcap.h
@@ -45,6 +50,23 @@
 
 static const int DEFAULT_SNAPLEN = 9000;
 
+// The maximum number of packets sendPackets() validates and hands to the kernel at once
+#define PCPP_SEND_BATCH_SIZE 64
+
+// sendmmsg() is available on Linux since kernel 3.0 and glibc 2.14
+#if defined(LINUX) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+#define PCPP_HAS_SENDMMSG
+#include <sys/socket.h>
+#include <errno.h>
+#endif
+
+// A full memory barrier used to publish ring slots between the capture thread and the worker threads
+#if defined(_MSC_VER)
+#define PCPP_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define PCPP_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
 namespace pcpp
 {
 
@@ -53,6 +75,102 @@ struct PcapThread
 	pthread_t pthread;
 };
 
+// A reusable array of RawPacket objects used in burst mode. The packets point into one contiguous buffer that is divided
+// into fixed size slots (one per packet), so no memory is allocated while capturing
+struct PcapBurstBuffer
+{
+	RawPacket* packets;
+	uint8_t* data;
+	uint32_t capacity;
+	uint32_t slotSize;
+	uint32_t count;
+	uint32_t timeoutUSec;
+	long firstPacketSec;
+	long firstPacketNSec;
+
+	PcapBurstBuffer(uint32_t burstSize, uint32_t packetSlotSize, uint32_t burstTimeoutUSec, LinkLayerType linkType)
+	{
+		capacity = burstSize;
+		slotSize = packetSlotSize;
+		count = 0;
+		timeoutUSec = burstTimeoutUSec;
+		firstPacketSec = 0;
+		firstPacketNSec = 0;
+		data = new uint8_t[(size_t)capacity * slotSize];
+		packets = static_cast<RawPacket*>(::operator new(sizeof(RawPacket) * capacity));
+		timeval ts = { 0, 0 };
+		for (uint32_t i = 0; i < capacity; i++)
+			new (&packets[i]) RawPacket(data + (size_t)i * slotSize, 0, ts, false, linkType);
+	}
+
+	~PcapBurstBuffer()
+	{
+		for (uint32_t i = 0; i < capacity; i++)
+			packets[i].~RawPacket();
+		::operator delete(packets);
+		delete [] data;
+	}
+};
+
+// A capture worker thread and its lock-free single-producer/single-consumer ring. The capture thread is the only writer of 'head'
+// and the worker thread is the only writer of 'tail'. Both are free-running counters, a slot index is the counter masked by the ring size.
+// Each slot holds a RawPacket pointing to a pre-allocated packet buffer
+struct PcapCaptureWorker
+{
+	PcapThread thread;
+	bool threadStarted;
+	uint8_t id;
+	PcapLiveDevice* device;
+	RawPacket* packets;
+	uint8_t* data;
+	uint32_t capacity;
+	uint32_t mask;
+	uint32_t slotSize;
+	volatile bool stop;
+
+	// producer side, kept on a different cache line than the consumer side to avoid false sharing
+	char pad0[64];
+	volatile uint32_t head;
+	uint64_t enqueued;
+	uint64_t dropped;
+
+	// consumer side
+	char pad1[64];
+	volatile uint32_t tail;
+	uint64_t processed;
+	char pad2[64];
+
+	PcapCaptureWorker(uint8_t workerId, PcapLiveDevice* dev, uint32_t ringSize, uint32_t packetSlotSize, LinkLayerType linkType)
+	{
+		threadStarted = false;
+		id = workerId;
+		device = dev;
+		capacity = ringSize;
+		mask = ringSize - 1;
+		slotSize = packetSlotSize;
+		stop = false;
+		head = 0;
+		enqueued = 0;
+		dropped = 0;
+		tail = 0;
+		processed = 0;
+		memset(&thread, 0, sizeof(thread));
+		data = new uint8_t[(size_t)capacity * slotSize];
+		packets = static_cast<RawPacket*>(::operator new(sizeof(RawPacket) * capacity));
+		timeval ts = { 0, 0 };
+		for (uint32_t i = 0; i < capacity; i++)
+			new (&packets[i]) RawPacket(data + (size_t)i * slotSize, 0, ts, false, linkType);
+	}
+
+	~PcapCaptureWorker()
+	{
+		for (uint32_t i = 0; i < capacity; i++)
+			packets[i].~RawPacket();
+		::operator delete(packets);
+		delete [] data;
+	}
+};
+
 #ifdef HAS_SET_DIRECTION_ENABLED
 static pcap_direction_t directionTypeMap(PcapLiveDevice::PcapDirection direction)
 {
@@ -62,9 +180,28 @@ static pcap_direction_t directionTypeMap(PcapLiveDevice::PcapDirection direction
 		case PcapLiveDevice::PCPP_OUT:   return PCAP_D_OUT;
 		case PcapLiveDevice::PCPP_INOUT: return PCAP_D_INOUT;
 	}
+
+	return PCAP_D_INOUT;
 }
 #endif
 
+// with nanosecond precision libpcap stores the nanoseconds in the tv_usec field of the packet header timestamp
+static inline timespec pcapTimestampToTimespec(const timeval& ts, bool nanoPrecision)
+{
+	timespec result;
+	if (nanoPrecision)
+	{
+		result.tv_sec = ts.tv_sec;
+		result.tv_nsec = ts.tv_usec;
+	}
+	else
+	{
+		TIMEVAL_TO_TIMESPEC(&ts, &result);
+	}
+
+	return result;
+}
+
 
 
 PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool calculateMacAddress, bool calculateDefaultGateway) : IPcapDevice(),
@@ -131,8 +268,20 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	m_IntervalToUpdateStats = 0;
 	m_cbOnPacketArrivesUserCookie = NULL;
 	m_cbOnStatsUpdateUserCookie = NULL;
+	m_cbOnPacketsArrive = NULL;
+	m_cbOnPacketsArriveUserCookie = NULL;
 	m_CaptureCallbackMode = true;
+	m_CaptureBurstMode = false;
+	m_BurstBuffer = NULL;
+	m_CaptureWorkersMode = false;
+	m_cbOnWorkerPacketArrives = NULL;
+	m_cbOnWorkerPacketArrivesUserCookie = NULL;
 	m_CapturedPackets = NULL;
+	m_SendRatePacketsPerSec = 0;
+	m_SendRateBitsPerSec = 0;
+	m_SendNextTimeNSec = 0;
+	memset(&m_LastSendResult, 0, sizeof(m_LastSendResult));
+	m_LastSendResult.firstFailedIndex = -1;
 	if (calculateMacAddress)
 	{
 		setDeviceMacAddress();
@@ -141,6 +290,18 @@ PcapLiveDevice::PcapLiveDevice(pcap_if_t* pInterface, bool calculateMTU, bool ca
 	}
 }
 
+bool PcapLiveDevice::passesSoftwareFilters(const uint8_t* packet, int packetLen, const timespec& timestamp)
+{
+	// the post filter, the sampler and the stateful filter run in this order on every captured packet, before it's copied
+	if (!matchPostFilter(packet, packetLen, m_LinkType))
+		return false;
+
+	if (!m_PacketSampler.sample(packet, packetLen, m_LinkType))
+		return false;
+
+	return matchStatefulFilter(packet, packetLen, m_LinkType, timestamp);
+}
+
 void PcapLiveDevice::onPacketArrives(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
@@ -150,7 +311,11 @@ void PcapLiveDevice::onPacketArrives(uint8_t* user, const struct pcap_pkthdr* pk
 		return;
 	}
 
-	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
+	timespec ts = pcapTimestampToTimespec(pkthdr->ts, pThis->m_ActualConfiguration.timestampPrecision == TimestampPrecisionNano);
+	if (!pThis->passesSoftwareFilters(packet, pkthdr->caplen, ts))
+		return;
+
+	RawPacket rawPacket(packet, pkthdr->caplen, ts, false, pThis->getLinkType());
 
 	if (pThis->m_cbOnPacketArrives != NULL)
 		pThis->m_cbOnPacketArrives(&rawPacket, pThis, pThis->m_cbOnPacketArrivesUserCookie);
@@ -165,9 +330,13 @@ void PcapLiveDevice::onPacketArrivesNoCallback(uint8_t* user, const struct pcap_
 		return;
 	}
 
+	timespec ts = pcapTimestampToTimespec(pkthdr->ts, pThis->m_ActualConfiguration.timestampPrecision == TimestampPrecisionNano);
+	if (!pThis->passesSoftwareFilters(packet, pkthdr->caplen, ts))
+		return;
+
 	uint8_t* packetData = new uint8_t[pkthdr->caplen];
 	memcpy(packetData, packet, pkthdr->caplen);
-	RawPacket* rawPacketPtr = new RawPacket(packetData, pkthdr->caplen, pkthdr->ts, true, pThis->getLinkType());
+	RawPacket* rawPacketPtr = new RawPacket(packetData, pkthdr->caplen, ts, true, pThis->getLinkType());
 	pThis->m_CapturedPackets->pushBack(rawPacketPtr);
 }
 
@@ -180,13 +349,185 @@ void PcapLiveDevice::onPacketArrivesBlockingMode(uint8_t* user, const struct pca
 		return;
 	}
 
-	RawPacket rawPacket(packet, pkthdr->caplen, pkthdr->ts, false, pThis->getLinkType());
+	timespec ts = pcapTimestampToTimespec(pkthdr->ts, pThis->m_ActualConfiguration.timestampPrecision == TimestampPrecisionNano);
+	if (!pThis->passesSoftwareFilters(packet, pkthdr->caplen, ts))
+		return;
+
+	RawPacket rawPacket(packet, pkthdr->caplen, ts, false, pThis->getLinkType());
 
 	if (pThis->m_cbOnPacketArrivesBlockingMode != NULL)
 		if (pThis->m_cbOnPacketArrivesBlockingMode(&rawPacket, pThis, pThis->m_cbOnPacketArrivesBlockingModeUserCookie))
 			pThis->m_StopThread = true;
 }
 
+void PcapLiveDevice::onPacketArrivesBurstMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet)
+{
+	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
+	if (pThis == NULL || pThis->m_BurstBuffer == NULL)
+	{
+		LOG_ERROR("Unable to extract PcapLiveDevice instance");
+		return;
+	}
+
+	timespec ts = pcapTimestampToTimespec(pkthdr->ts, pThis->m_ActualConfiguration.timestampPrecision == TimestampPrecisionNano);
+	if (!pThis->passesSoftwareFilters(packet, pkthdr->caplen, ts))
+		return;
+
+	PcapBurstBuffer* burst = pThis->m_BurstBuffer;
+	if (burst->count == 0)
+		clockGetTime(burst->firstPacketSec, burst->firstPacketNSec);
+
+	uint32_t caplen = (pkthdr->caplen > burst->slotSize ? burst->slotSize : pkthdr->caplen);
+	uint8_t* slot = burst->data + (size_t)burst->count * burst->slotSize;
+	memcpy(slot, packet, caplen);
+	burst->packets[burst->count].setRawData(slot, caplen, ts, pThis->getLinkType(), pkthdr->len);
+	burst->count++;
+
+	if (burst->count == burst->capacity)
+		pThis->flushBurst(false);
+}
+
+void PcapLiveDevice::flushBurst(bool onlyIfTimeoutExpired)
+{
+	if (m_BurstBuffer == NULL || m_BurstBuffer->count == 0)
+		return;
+
+	if (onlyIfTimeoutExpired && m_BurstBuffer->timeoutUSec > 0)
+	{
+		long curSec = 0, curNSec = 0;
+		clockGetTime(curSec, curNSec);
+		long elapsedUSec = (curSec - m_BurstBuffer->firstPacketSec) * 1000000L + (curNSec - m_BurstBuffer->firstPacketNSec) / 1000L;
+		if (elapsedUSec < (long)m_BurstBuffer->timeoutUSec)
+			return;
+	}
+
+	if (m_cbOnPacketsArrive != NULL)
+		m_cbOnPacketsArrive(m_BurstBuffer->packets, m_BurstBuffer->count, this, m_cbOnPacketsArriveUserCookie);
+
+	m_BurstBuffer->count = 0;
+}
+
+void PcapLiveDevice::freeBurstBuffer()
+{
+	if (m_BurstBuffer != NULL)
+	{
+		delete m_BurstBuffer;
+		m_BurstBuffer = NULL;
+	}
+}
+
+// the RSS hash used for choosing the capture worker. It covers the IPs and the TCP/UDP ports and uses the symmetric key, so flows
+// are spread between the workers exactly like a NIC with the same configuration spreads them between the same number of RX queues
+static const ToeplitzHash& getWorkersRssHash()
+{
+	static const ToeplitzHash workersRssHash(ToeplitzHash::SymmetricKey, ToeplitzHash::DefaultKeyLength,
+			ToeplitzHash::RSS_IPV4 | ToeplitzHash::RSS_NONFRAG_IPV4_TCP | ToeplitzHash::RSS_NONFRAG_IPV4_UDP |
+			ToeplitzHash::RSS_IPV6 | ToeplitzHash::RSS_NONFRAG_IPV6_TCP | ToeplitzHash::RSS_NONFRAG_IPV6_UDP);
+	return workersRssHash;
+}
+
+void PcapLiveDevice::onPacketArrivesWorkersMode(uint8_t* user, const struct pcap_pkthdr* pkthdr, const uint8_t* packet)
+{
+	PcapLiveDevice* pThis = (PcapLiveDevice*)user;
+	if (pThis == NULL || pThis->m_CaptureWorkers.empty())
+	{
+		LOG_ERROR("Unable to extract PcapLiveDevice instance");
+		return;
+	}
+
+	timespec ts = pcapTimestampToTimespec(pkthdr->ts, pThis->m_ActualConfiguration.timestampPrecision == TimestampPrecisionNano);
+	if (!pThis->passesSoftwareFilters(packet, pkthdr->caplen, ts))
+		return;
+
+	// choose the worker by a symmetric flow hash so both directions of a connection reach the same worker. Packets that aren't
+	// hashed (non-IP) go to worker 0 like a NIC sends them to queue 0
+	uint32_t hash;
+	getWorkersRssHash().calculateHash(packet, pkthdr->caplen, pThis->m_LinkType, hash);
+
+	PcapCaptureWorker* worker = pThis->m_CaptureWorkers[ToeplitzHash::getQueueForHash(hash, (uint16_t)pThis->m_CaptureWorkers.size())];
+
+	uint32_t head = worker->head;
+	if (head - worker->tail >= worker->capacity)
+	{
+		worker->dropped++;
+		return;
+	}
+
+	uint32_t caplen = (pkthdr->caplen > worker->slotSize ? worker->slotSize : pkthdr->caplen);
+	uint32_t slotIndex = head & worker->mask;
+	uint8_t* slot = worker->data + (size_t)slotIndex * worker->slotSize;
+	memcpy(slot, packet, caplen);
+	worker->packets[slotIndex].setRawData(slot, caplen, ts, pThis->getLinkType(), pkthdr->len);
+
+	// make sure the slot is fully written before the worker can see it
+	PCPP_MEMORY_BARRIER();
+	worker->head = head + 1;
+	worker->enqueued++;
+}
+
+void* PcapLiveDevice::captureWorkerThreadMain(void* ptr)
+{
+	PcapCaptureWorker* worker = (PcapCaptureWorker*)ptr;
+	if (worker == NULL || worker->device == NULL)
+	{
+		LOG_ERROR("Capture worker thread: Unable to extract worker instance");
+		return 0;
+	}
+
+	PcapLiveDevice* pThis = worker->device;
+	LOG_DEBUG("Started capture worker thread #%d for device '%s'", (int)worker->id, pThis->m_Name);
+	while (true)
+	{
+		uint32_t tail = worker->tail;
+		if (tail == worker->head)
+		{
+			// the capture thread is already stopped when 'stop' is set, so an empty ring at this point means there is nothing left to process
+			if (worker->stop)
+			{
+				PCPP_MEMORY_BARRIER();
+				if (tail == worker->head)
+					break;
+				continue;
+			}
+
+			sched_yield();
+			continue;
+		}
+
+		// make sure the slot is read only after the capture thread published it
+		PCPP_MEMORY_BARRIER();
+		RawPacket* rawPacket = &worker->packets[tail & worker->mask];
+		if (pThis->m_cbOnWorkerPacketArrives != NULL)
+			pThis->m_cbOnWorkerPacketArrives(rawPacket, worker->id, pThis, pThis->m_cbOnWorkerPacketArrivesUserCookie);
+		worker->processed++;
+
+		// make sure the slot is no longer used before handing it back to the capture thread
+		PCPP_MEMORY_BARRIER();
+		worker->tail = tail + 1;
+	}
+
+	LOG_DEBUG("Ended capture worker thread #%d for device '%s'", (int)worker->id, pThis->m_Name);
+	return 0;
+}
+
+void PcapLiveDevice::stopCaptureWorkers()
+{
+	for (std::vector<PcapCaptureWorker*>::iterator iter = m_CaptureWorkers.begin(); iter != m_CaptureWorkers.end(); iter++)
+		(*iter)->stop = true;
+
+	for (std::vector<PcapCaptureWorker*>::iterator iter = m_CaptureWorkers.begin(); iter != m_CaptureWorkers.end(); iter++)
+	{
+		if ((*iter)->threadStarted)
+		{
+			LOG_DEBUG("Stopping capture worker thread #%d, waiting for it to join...", (int)(*iter)->id);
+			pthread_join((*iter)->thread.pthread, NULL);
+		}
+		delete *iter;
+	}
+
+	m_CaptureWorkers.clear();
+}
+
 void* PcapLiveDevice::captureThreadMain(void* ptr)
 {
 	PcapLiveDevice* pThis = (PcapLiveDevice*)ptr;
@@ -197,7 +538,22 @@ void* PcapLiveDevice::captureThreadMain(void* ptr)
 	}
 
 	LOG_DEBUG("Started capture thread for device '%s'", pThis->m_Name);
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_CaptureBurstMode)
+	{
+		while (!pThis->m_StopThread)
+		{
+			int cnt = (int)(pThis->m_BurstBuffer->capacity - pThis->m_BurstBuffer->count);
+			pcap_dispatch(pThis->m_PcapDescriptor, cnt, onPacketArrivesBurstMode, (uint8_t*)pThis);
+			pThis->flushBurst(true);
+		}
+		pThis->flushBurst(false);
+	}
+	else if (pThis->m_CaptureWorkersMode)
+	{
+		while (!pThis->m_StopThread)
+			pcap_dispatch(pThis->m_PcapDescriptor, -1, onPacketArrivesWorkersMode, (uint8_t*)pThis);
+	}
+	else if (pThis->m_CaptureCallbackMode)
 	{
 		while (!pThis->m_StopThread)
 			pcap_dispatch(pThis->m_PcapDescriptor, -1, onPacketArrives, (uint8_t*)pThis);
@@ -232,7 +588,7 @@ void* PcapLiveDevice::statsThreadMain(void* ptr)
 	return 0;
 }
 
-pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config)
+pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config, DeviceConfiguration* actualConfig)
 {
 	char errbuf[PCAP_ERRBUF_SIZE] = {'\0'};
 	pcap_t* pcap = pcap_create(m_Name, errbuf);
@@ -241,7 +597,11 @@ pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config)
 		LOG_ERROR("%s", errbuf);
 		return pcap;
 	}
-	int ret = pcap_set_snaplen(pcap, DEFAULT_SNAPLEN);
+
+	DeviceConfiguration granted(config);
+
+	granted.snapshotLength = (config.snapshotLength <= 0 ? DEFAULT_SNAPLEN : config.snapshotLength);
+	int ret = pcap_set_snaplen(pcap, granted.snapshotLength);
 	if (ret != 0)
 	{
 		LOG_ERROR("%s", pcap_geterr(pcap));
@@ -265,33 +625,86 @@ pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config)
 		if (ret != 0)
 		{
 			LOG_ERROR("%s", pcap_geterr(pcap));
+			granted.packetBufferSize = 0;
 		}
 	}
+	else
+	{
+		granted.packetBufferSize = 0;
+	}
 
 #ifdef HAS_PCAP_IMMEDIATE_MODE
-	ret = pcap_set_immediate_mode(pcap, 1);
+	ret = pcap_set_immediate_mode(pcap, config.immediateMode ? 1 : 0);
 	if (ret == 0)
 	{
-		LOG_DEBUG("Immediate mode is activated");
+		LOG_DEBUG("Immediate mode is %s", config.immediateMode ? "activated" : "deactivated");
 	}
 	else
 	{
-		LOG_ERROR("Failed to activate immediate mode, error code: '%d', error message: '%s'", ret, pcap_geterr(pcap));
+		LOG_ERROR("Failed to set immediate mode, error code: '%d', error message: '%s'", ret, pcap_geterr(pcap));
+		granted.immediateMode = false;
+	}
+#else
+	granted.immediateMode = false;
+#endif
+
+	// timestamp types were added in libpcap 1.2 and timestamp precision in libpcap 1.5, PCAP_TSTAMP_* are defined accordingly
+#ifdef PCAP_TSTAMP_HOST
+	if (config.timestampType != TimestampTypeDefault)
+	{
+		ret = pcap_set_tstamp_type(pcap, (int)config.timestampType);
+		if (ret != 0)
+		{
+			LOG_ERROR("Failed to set timestamp type %d, error code: '%d', error message: '%s'", (int)config.timestampType, ret, pcap_geterr(pcap));
+			granted.timestampType = TimestampTypeDefault;
+		}
+	}
+#else
+	granted.timestampType = TimestampTypeDefault;
+#endif
+
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+	if (config.timestampPrecision == TimestampPrecisionNano)
+	{
+		ret = pcap_set_tstamp_precision(pcap, PCAP_TSTAMP_PRECISION_NANO);
+		if (ret != 0)
+		{
+			LOG_ERROR("Failed to set nanosecond timestamp precision, error code: '%d', error message: '%s'", ret, pcap_geterr(pcap));
+		}
 	}
 #endif
 
+	ret = pcap_activate(pcap);
+	if (ret < 0)
+	{
+		LOG_ERROR("%s", pcap_geterr(pcap));
+		pcap_close(pcap);
+		return NULL;
+	}
+
+	// a positive value is a warning, the device is activated but some settings might not have been applied
+	if (ret > 0)
+	{
+		LOG_DEBUG("Device '%s' activated with a warning: '%d', message: '%s'", m_Name, ret, pcap_geterr(pcap));
+#ifdef PCAP_WARNING_TSTAMP_TYPE_NOTSUP
+		if (ret == PCAP_WARNING_TSTAMP_TYPE_NOTSUP)
+			granted.timestampType = TimestampTypeDefault;
+#endif
+	}
+
 #ifdef HAS_SET_DIRECTION_ENABLED
+	// the direction can only be set on an activated device
 	pcap_direction_t directionToSet = directionTypeMap(config.direction);
 	ret = pcap_setdirection(pcap, directionToSet);
-	if (ret != 0)
+	if (ret == 0)
 	{
 		if (config.direction == PCPP_IN)
 		{
-		  LOG_DEBUG("Only incoming traffics will be captured");
+			LOG_DEBUG("Only incoming traffics will be captured");
 		}
-		else if (config.direction == PCPP_OUT) 
+		else if (config.direction == PCPP_OUT)
 		{
-		  LOG_DEBUG("Only outgoing traffics will be captured");
+			LOG_DEBUG("Only outgoing traffics will be captured");
 		}
 		else
 		{
@@ -301,31 +714,38 @@ pcap_t* PcapLiveDevice::doOpen(const DeviceConfiguration& config)
 	else
 	{
 		LOG_ERROR("Failed to set direction for capturing packets, error code: '%d', error message: '%s'", ret, pcap_geterr(pcap));
+		granted.direction = PCPP_INOUT;
 	}
+#else
+	granted.direction = PCPP_INOUT;
 #endif
-	ret = pcap_activate(pcap);
-	if (ret != 0)
+
+	granted.snapshotLength = pcap_snapshot(pcap);
+#ifdef PCAP_TSTAMP_PRECISION_NANO
+	granted.timestampPrecision = (pcap_get_tstamp_precision(pcap) == PCAP_TSTAMP_PRECISION_NANO ? TimestampPrecisionNano : TimestampPrecisionMicro);
+#else
+	granted.timestampPrecision = TimestampPrecisionMicro;
+#endif
+
+	LOG_DEBUG("Device '%s' activated: snaplen=%d, timestamp type=%d, timestamp precision=%s",
+			m_Name, granted.snapshotLength, (int)granted.timestampType, (granted.timestampPrecision == TimestampPrecisionNano ? "nsec" : "usec"));
+
+	int dlt = pcap_datalink(pcap);
+	const char* dlt_name = pcap_datalink_val_to_name(dlt);
+	if (dlt_name)
 	{
-		LOG_ERROR("%s", pcap_geterr(pcap));
-		pcap_close(pcap);
-		pcap = NULL;
+		LOG_DEBUG("link-type %u: %s (%s)\n", dlt, dlt_name, pcap_datalink_val_to_description(dlt));
 	}
-
-	if (pcap)
+	else
 	{
-		int dlt = pcap_datalink(pcap);
-		const char* dlt_name = pcap_datalink_val_to_name(dlt);
-		if (dlt_name)
-		{
-			LOG_DEBUG("link-type %u: %s (%s)\n", dlt, dlt_name, pcap_datalink_val_to_description(dlt));
-		}
-		else
-		{
-			LOG_DEBUG("link-type %u\n", dlt);
-		}
-
-		m_LinkType = static_cast<LinkLayerType>(dlt);
+		LOG_DEBUG("link-type %u\n", dlt);
 	}
+
+	m_LinkType = static_cast<LinkLayerType>(dlt);
+
+	if (actualConfig != NULL)
+		*actualConfig = granted;
+
 	return pcap;
 }
 
@@ -337,10 +757,16 @@ bool PcapLiveDevice::open(const DeviceConfiguration& config)
 		return true;
 	}
 
-	m_PcapDescriptor = doOpen(config);
+	m_PcapDescriptor = doOpen(config, &m_ActualConfiguration);
 	m_PcapSendDescriptor = doOpen(config);
 	if (m_PcapDescriptor == NULL || m_PcapSendDescriptor == NULL)
 	{
+		if (m_PcapDescriptor != NULL)
+			pcap_close(m_PcapDescriptor);
+		if (m_PcapSendDescriptor != NULL)
+			pcap_close(m_PcapSendDescriptor);
+		m_PcapDescriptor = NULL;
+		m_PcapSendDescriptor = NULL;
 		m_DeviceOpened = false;
 		return false;
 	}
@@ -375,6 +801,7 @@ void PcapLiveDevice::close()
 		LOG_DEBUG("Send pcap descriptor closed");
 	}
 
+	m_PostFilter.clear();
 	m_DeviceOpened = false;
 	LOG_DEBUG("Device '%s' closed", m_Name);
 }
@@ -406,6 +833,8 @@ bool PcapLiveDevice::startCapture(OnPacketArrivesCallback onPacketArrives, void*
 	m_IntervalToUpdateStats = intervalInSecondsToUpdateStats;
 
 	m_CaptureCallbackMode = true;
+	m_CaptureBurstMode = false;
+	m_CaptureWorkersMode = false;
 	m_cbOnPacketArrives = onPacketArrives;
 	m_cbOnPacketArrivesUserCookie = onPacketArrivesUserCookie;
 	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
@@ -452,6 +881,8 @@ bool PcapLiveDevice::startCapture(RawPacketVector& capturedPacketsVector)
 	m_CapturedPackets->clear();
 
 	m_CaptureCallbackMode = false;
+	m_CaptureBurstMode = false;
+	m_CaptureWorkersMode = false;
 	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
 	if (err != 0)
 	{
@@ -464,6 +895,141 @@ bool PcapLiveDevice::startCapture(RawPacketVector& capturedPacketsVector)
 	return true;
 }
 
+bool PcapLiveDevice::startCaptureBurstMode(OnPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, uint32_t maxBurstSize, uint32_t maxBurstTimeoutUSec)
+{
+	if (!m_DeviceOpened || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' not opened", m_Name);
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing traffic", m_Name);
+		return false;
+	}
+
+	if (maxBurstSize == 0)
+	{
+		LOG_ERROR("Burst size must be larger than 0");
+		return false;
+	}
+
+	int snaplen = pcap_snapshot(m_PcapDescriptor);
+	if (snaplen <= 0)
+		snaplen = DEFAULT_SNAPLEN;
+
+	freeBurstBuffer();
+	m_BurstBuffer = new PcapBurstBuffer(maxBurstSize, (uint32_t)snaplen, maxBurstTimeoutUSec, m_LinkType);
+
+	m_CaptureCallbackMode = true;
+	m_CaptureBurstMode = true;
+	m_CaptureWorkersMode = false;
+	m_cbOnPacketArrives = NULL;
+	m_cbOnPacketArrivesUserCookie = NULL;
+	m_cbOnPacketsArrive = onPacketsArrive;
+	m_cbOnPacketsArriveUserCookie = onPacketsArriveUserCookie;
+	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create LiveCapture thread for device '%s': [%s]", m_Name, strerror(err));
+		m_CaptureBurstMode = false;
+		freeBurstBuffer();
+		return false;
+	}
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created burst mode capture thread for device '%s'. Thread id: %s", m_Name, printThreadId(m_CaptureThread).c_str());
+
+	return true;
+}
+
+bool PcapLiveDevice::startCaptureWithWorkers(uint8_t numOfWorkers, OnWorkerPacketArrivesCallback onPacketArrives, void* onPacketArrivesUserCookie, uint32_t ringSize)
+{
+	if (!m_DeviceOpened || m_PcapDescriptor == NULL)
+	{
+		LOG_ERROR("Device '%s' not opened", m_Name);
+		return false;
+	}
+
+	if (m_CaptureThreadStarted)
+	{
+		LOG_ERROR("Device '%s' already capturing traffic", m_Name);
+		return false;
+	}
+
+	if (numOfWorkers == 0 || ringSize == 0)
+	{
+		LOG_ERROR("Number of workers and ring size must be larger than 0");
+		return false;
+	}
+
+	// round the ring size up to a power of 2 so slot indices can be calculated with a mask
+	uint32_t actualRingSize = 1;
+	while (actualRingSize < ringSize && actualRingSize < 0x80000000)
+		actualRingSize <<= 1;
+
+	int snaplen = pcap_snapshot(m_PcapDescriptor);
+	if (snaplen <= 0)
+		snaplen = DEFAULT_SNAPLEN;
+
+	// build the hash tables before the capture thread starts using them
+	getWorkersRssHash();
+
+	m_cbOnWorkerPacketArrives = onPacketArrives;
+	m_cbOnWorkerPacketArrivesUserCookie = onPacketArrivesUserCookie;
+
+	for (uint8_t i = 0; i < numOfWorkers; i++)
+	{
+		PcapCaptureWorker* worker = new PcapCaptureWorker(i, this, actualRingSize, (uint32_t)snaplen, m_LinkType);
+		m_CaptureWorkers.push_back(worker);
+		int err = pthread_create(&(worker->thread.pthread), NULL, &captureWorkerThreadMain, (void*)worker);
+		if (err != 0)
+		{
+			LOG_ERROR("Cannot create capture worker thread #%d for device '%s': [%s]", (int)i, m_Name, strerror(err));
+			stopCaptureWorkers();
+			return false;
+		}
+		worker->threadStarted = true;
+		LOG_DEBUG("Successfully created capture worker thread #%d for device '%s'. Thread id: %s", (int)i, m_Name, printThreadId(&worker->thread).c_str());
+	}
+
+	m_CaptureCallbackMode = true;
+	m_CaptureBurstMode = false;
+	m_CaptureWorkersMode = true;
+	m_cbOnPacketArrives = NULL;
+	m_cbOnPacketArrivesUserCookie = NULL;
+	int err = pthread_create(&(m_CaptureThread->pthread), NULL, getCaptureThreadStart(), (void*)this);
+	if (err != 0)
+	{
+		LOG_ERROR("Cannot create LiveCapture thread for device '%s': [%s]", m_Name, strerror(err));
+		m_CaptureWorkersMode = false;
+		stopCaptureWorkers();
+		return false;
+	}
+	m_CaptureThreadStarted = true;
+	LOG_DEBUG("Successfully created capture thread for device '%s' with %d workers. Thread id: %s", m_Name, (int)numOfWorkers, printThreadId(m_CaptureThread).c_str());
+
+	return true;
+}
+
+bool PcapLiveDevice::getCaptureWorkerStats(uint8_t workerId, CaptureWorkerStats& stats) const
+{
+	if (workerId >= m_CaptureWorkers.size())
+	{
+		LOG_ERROR("Capture worker #%d doesn't exist", (int)workerId);
+		return false;
+	}
+
+	const PcapCaptureWorker* worker = m_CaptureWorkers[workerId];
+	uint32_t tail = worker->tail;
+	uint32_t head = worker->head;
+	stats.enqueued = worker->enqueued;
+	stats.processed = worker->processed;
+	stats.dropped = worker->dropped;
+	stats.occupancy = head - tail;
+	stats.capacity = worker->capacity;
+	return true;
+}
 
 int PcapLiveDevice::startCaptureBlockingMode(OnPacketArrivesStopBlocking onPacketArrives, void* userCookie, int timeout)
 {
@@ -538,6 +1104,17 @@ void PcapLiveDevice::stopCapture()
 		m_CaptureThreadStarted = false;
 	}
 	LOG_DEBUG("Capture thread stopped for device '%s'", m_Name);
+	if (m_CaptureBurstMode)
+	{
+		m_CaptureBurstMode = false;
+		freeBurstBuffer();
+	}
+	if (m_CaptureWorkersMode)
+	{
+		m_CaptureWorkersMode = false;
+		stopCaptureWorkers();
+		LOG_DEBUG("Capture worker threads stopped for device '%s'", m_Name);
+	}
 	if (m_StatsThreadStarted)
 	{
 		LOG_DEBUG("Stopping stats thread, waiting for it to join...");
@@ -604,43 +1181,269 @@ bool PcapLiveDevice::sendPacket(Packet* packet)
 	return sendPacket(*rawPacket);
 }
 
-int PcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
+// A monotonic clock (where available) used for pacing packets when a send rate limit is set
+static uint64_t getSendClockNSec()
+{
+#if defined(LINUX)
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+	long sec = 0, nsec = 0;
+	clockGetTime(sec, nsec);
+	return (uint64_t)sec * 1000000000ULL + (uint64_t)nsec;
+#endif
+}
+
+void PcapLiveDevice::setSendRateLimit(uint32_t maxPacketsPerSec, uint64_t maxBitsPerSec)
+{
+	m_SendRatePacketsPerSec = maxPacketsPerSec;
+	m_SendRateBitsPerSec = maxBitsPerSec;
+	m_SendNextTimeNSec = 0;
+}
+
+bool PcapLiveDevice::prepareSendBatch(int numOfPackets)
+{
+	memset(&m_LastSendResult, 0, sizeof(m_LastSendResult));
+	m_LastSendResult.firstFailedIndex = -1;
+
+	if (!m_DeviceOpened)
+	{
+		LOG_ERROR("Device '%s' not opened!", m_Name);
+		if (numOfPackets > 0)
+		{
+			m_LastSendResult.packetsFailed = numOfPackets;
+			m_LastSendResult.firstFailedIndex = 0;
+		}
+		return false;
+	}
+
+	return true;
+}
+
+int PcapLiveDevice::getSendChunkSize() const
+{
+	// when sending is rate limited keep each burst at roughly 1ms worth of traffic
+	uint64_t chunkSize = PCPP_SEND_BATCH_SIZE;
+	if (m_SendRatePacketsPerSec > 0 && m_SendRatePacketsPerSec / 1000 < chunkSize)
+		chunkSize = m_SendRatePacketsPerSec / 1000;
+	if (m_SendRateBitsPerSec > 0 && m_SendRateBitsPerSec / (8 * 1500 * 1000) < chunkSize)
+		chunkSize = m_SendRateBitsPerSec / (8 * 1500 * 1000);
+
+	return (chunkSize > 0 ? (int)chunkSize : 1);
+}
+
+void PcapLiveDevice::waitForSendRateLimit(int numOfPackets, uint64_t numOfBytes)
+{
+	if (m_SendRatePacketsPerSec == 0 && m_SendRateBitsPerSec == 0)
+		return;
+
+	uint64_t now = getSendClockNSec();
+
+	// don't let idle time between calls accumulate into a burst, allow only 1ms of lag
+	if (m_SendNextTimeNSec + 1000000ULL < now)
+		m_SendNextTimeNSec = now;
+
+	while (now < m_SendNextTimeNSec)
+	{
+		uint64_t remaining = m_SendNextTimeNSec - now;
+		// sleep for most of the remaining time and busy-wait the last 100us for accuracy
+		if (remaining > 200000ULL)
+		{
+#if defined(_MSC_VER)
+			Sleep((DWORD)(remaining / 1000000ULL));
+#else
+			usleep((useconds_t)((remaining - 100000ULL) / 1000ULL));
+#endif
+		}
+		now = getSendClockNSec();
+	}
+
+	uint64_t durationNSec = 0;
+	if (m_SendRatePacketsPerSec > 0)
+		durationNSec = (uint64_t)numOfPackets * 1000000000ULL / m_SendRatePacketsPerSec;
+	if (m_SendRateBitsPerSec > 0)
+	{
+		uint64_t bitsDurationNSec = numOfBytes * 8ULL * 1000000000ULL / m_SendRateBitsPerSec;
+		if (bitsDurationNSec > durationNSec)
+			durationNSec = bitsDurationNSec;
+	}
+
+	m_SendNextTimeNSec += durationNSec;
+}
+
+int PcapLiveDevice::transmitPackets(const uint8_t** packetsData, const int* packetsLength, const int* packetsIndex, int numOfPackets)
 {
 	int packetsSent = 0;
-	for (int i = 0; i < arrLength; i++)
+	int nextPacket = 0;
+
+#ifdef PCPP_HAS_SENDMMSG
+	// on Linux the libpcap descriptor is a packet socket bound to the interface, so the whole batch can be handed to the kernel in
+	// a single system call. This is exactly what pcap_inject() does for a single packet
+	int sendFd = (m_LinkType == LINKTYPE_ETHERNET ? pcap_get_selectable_fd(m_PcapSendDescriptor) : -1);
+	if (sendFd >= 0)
 	{
-		if (sendPacket(rawPacketsArr[i]))
-			packetsSent++;
+		struct mmsghdr msgs[PCPP_SEND_BATCH_SIZE];
+		struct iovec iovecs[PCPP_SEND_BATCH_SIZE];
+		memset(msgs, 0, sizeof(struct mmsghdr) * numOfPackets);
+		for (int i = 0; i < numOfPackets; i++)
+		{
+			iovecs[i].iov_base = (void*)packetsData[i];
+			iovecs[i].iov_len = packetsLength[i];
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		while (nextPacket < numOfPackets)
+		{
+			int res = sendmmsg(sendFd, msgs + nextPacket, numOfPackets - nextPacket, 0);
+			if (res > 0)
+			{
+				for (int i = nextPacket; i < nextPacket + res; i++)
+					m_LastSendResult.bytesSent += packetsLength[i];
+				nextPacket += res;
+				packetsSent += res;
+			}
+			else if (res < 0 && errno == EINTR)
+				continue;
+			else
+				// the kernel rejected the next packet. Send the rest of the batch with pcap_inject() which also reports a meaningful error
+				break;
+		}
 	}
+#endif
 
-	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, arrLength-packetsSent);
+	for (; nextPacket < numOfPackets; nextPacket++)
+	{
+		if (pcap_inject(m_PcapSendDescriptor, packetsData[nextPacket], packetsLength[nextPacket]) != packetsLength[nextPacket])
+		{
+			LOG_ERROR("Error sending packet #%d: %s", packetsIndex[nextPacket], pcap_geterr(m_PcapSendDescriptor));
+			m_LastSendResult.packetsFailed++;
+			if (m_LastSendResult.firstFailedIndex < 0 || packetsIndex[nextPacket] < m_LastSendResult.firstFailedIndex)
+				m_LastSendResult.firstFailedIndex = packetsIndex[nextPacket];
+			continue;
+		}
+
+		m_LastSendResult.bytesSent += packetsLength[nextPacket];
+		packetsSent++;
+	}
+
+	m_LastSendResult.packetsSent += packetsSent;
 	return packetsSent;
 }
 
+void PcapLiveDevice::sendPacketsChunk(const uint8_t** packetsData, int* packetsLength, int numOfPackets, int firstPacketIndex)
+{
+	// validate all packets in one pass and compact the valid ones to the beginning of the arrays
+	int packetsIndex[PCPP_SEND_BATCH_SIZE];
+	int numOfValidPackets = 0;
+	uint64_t numOfBytes = 0;
+	for (int i = 0; i < numOfPackets; i++)
+	{
+		if (packetsData[i] == NULL || packetsLength[i] <= 0 || packetsLength[i] > (int)m_DeviceMtu)
+		{
+			LOG_ERROR("Packet #%d length [%d] is 0 or larger than device MTU [%d], not sending it", firstPacketIndex + i, packetsLength[i], (int)m_DeviceMtu);
+			m_LastSendResult.packetsInvalid++;
+			if (m_LastSendResult.firstFailedIndex < 0)
+				m_LastSendResult.firstFailedIndex = firstPacketIndex + i;
+			continue;
+		}
+
+		packetsData[numOfValidPackets] = packetsData[i];
+		packetsLength[numOfValidPackets] = packetsLength[i];
+		packetsIndex[numOfValidPackets] = firstPacketIndex + i;
+		numOfBytes += packetsLength[i];
+		numOfValidPackets++;
+	}
+
+	if (numOfValidPackets == 0)
+		return;
+
+	waitForSendRateLimit(numOfValidPackets, numOfBytes);
+	transmitPackets(packetsData, packetsLength, packetsIndex, numOfValidPackets);
+}
+
+int PcapLiveDevice::finishSendBatch()
+{
+	LOG_DEBUG("%d packets sent successfully (%llu bytes). %d packets were invalid, %d packets failed to send",
+			m_LastSendResult.packetsSent, (unsigned long long)m_LastSendResult.bytesSent,
+			m_LastSendResult.packetsInvalid, m_LastSendResult.packetsFailed);
+	return m_LastSendResult.packetsSent;
+}
+
+int PcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
+{
+	if (!prepareSendBatch(arrLength))
+		return 0;
+
+	const uint8_t* packetsData[PCPP_SEND_BATCH_SIZE];
+	int packetsLength[PCPP_SEND_BATCH_SIZE];
+	int chunkSize = getSendChunkSize();
+	for (int i = 0; i < arrLength; i += chunkSize)
+	{
+		int numOfPackets = (arrLength - i < chunkSize ? arrLength - i : chunkSize);
+		for (int j = 0; j < numOfPackets; j++)
+		{
+			packetsData[j] = rawPacketsArr[i + j].getRawData();
+			packetsLength[j] = rawPacketsArr[i + j].getRawDataLen();
+		}
+		sendPacketsChunk(packetsData, packetsLength, numOfPackets, i);
+	}
+
+	return finishSendBatch();
+}
+
 int PcapLiveDevice::sendPackets(Packet** packetsArr, int arrLength)
 {
-	int packetsSent = 0;
-	for (int i = 0; i < arrLength; i++)
+	if (!prepareSendBatch(arrLength))
+		return 0;
+
+	const uint8_t* packetsData[PCPP_SEND_BATCH_SIZE];
+	int packetsLength[PCPP_SEND_BATCH_SIZE];
+	int chunkSize = getSendChunkSize();
+	for (int i = 0; i < arrLength; i += chunkSize)
 	{
-		if (sendPacket(packetsArr[i]))
-			packetsSent++;
+		int numOfPackets = (arrLength - i < chunkSize ? arrLength - i : chunkSize);
+		for (int j = 0; j < numOfPackets; j++)
+		{
+			RawPacket* rawPacket = (packetsArr[i + j] != NULL ? packetsArr[i + j]->getRawPacketReadOnly() : NULL);
+			packetsData[j] = (rawPacket != NULL ? rawPacket->getRawData() : NULL);
+			packetsLength[j] = (rawPacket != NULL ? rawPacket->getRawDataLen() : 0);
+		}
+		sendPacketsChunk(packetsData, packetsLength, numOfPackets, i);
 	}
 
-	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, arrLength-packetsSent);
-	return packetsSent;
+	return finishSendBatch();
 }
 
 int PcapLiveDevice::sendPackets(const RawPacketVector& rawPackets)
 {
-	int packetsSent = 0;
+	int arrLength = (int)rawPackets.size();
+	if (!prepareSendBatch(arrLength))
+		return 0;
+
+	const uint8_t* packetsData[PCPP_SEND_BATCH_SIZE];
+	int packetsLength[PCPP_SEND_BATCH_SIZE];
+	int chunkSize = getSendChunkSize();
+	int numOfPackets = 0;
+	int firstPacketIndex = 0;
 	for (RawPacketVector::ConstVectorIterator iter = rawPackets.begin(); iter != rawPackets.end(); iter++)
 	{
-		if (sendPacket(**iter))
-			packetsSent++;
+		packetsData[numOfPackets] = (*iter)->getRawData();
+		packetsLength[numOfPackets] = (*iter)->getRawDataLen();
+		numOfPackets++;
+		if (numOfPackets == chunkSize)
+		{
+			sendPacketsChunk(packetsData, packetsLength, numOfPackets, firstPacketIndex);
+			firstPacketIndex += numOfPackets;
+			numOfPackets = 0;
+		}
 	}
 
-	LOG_DEBUG("%d packets sent successfully. %d packets not sent", packetsSent, (int)rawPackets.size()-packetsSent);
-	return packetsSent;
+	if (numOfPackets > 0)
+		sendPacketsChunk(packetsData, packetsLength, numOfPackets, firstPacketIndex);
+
+	return finishSendBatch();
 }
 
 std::string PcapLiveDevice::printThreadId(PcapThread* id)
@@ -938,6 +1741,7 @@ PcapLiveDevice::~PcapLiveDevice()
 		delete [] m_Description;
 	delete m_CaptureThread;
 	delete m_StatsThread;
+	freeBurstBuffer();
 }
 
 } // namespace pcpp
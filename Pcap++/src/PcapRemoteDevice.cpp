@@ -84,7 +84,25 @@ void* PcapRemoteDevice::remoteDeviceCaptureThreadMain(void *ptr)
 	pcap_pkthdr* pkthdr;
 	const uint8_t* pktData;
 
-	if (pThis->m_CaptureCallbackMode)
+	if (pThis->m_CaptureBurstMode)
+	{
+		while (!pThis->m_StopThread)
+		{
+			if (pcap_next_ex(pThis->m_PcapDescriptor, &pkthdr, &pktData) > 0)
+				onPacketArrivesBurstMode((uint8_t*)pThis, pkthdr, pktData);
+			pThis->flushBurst(true);
+		}
+		pThis->flushBurst(false);
+	}
+	else if (pThis->m_CaptureWorkersMode)
+	{
+		while (!pThis->m_StopThread)
+		{
+			if (pcap_next_ex(pThis->m_PcapDescriptor, &pkthdr, &pktData) > 0)
+				onPacketArrivesWorkersMode((uint8_t*)pThis, pkthdr, pktData);
+		}
+	}
+	else if (pThis->m_CaptureCallbackMode)
 	{
 		while (!pThis->m_StopThread)
 		{
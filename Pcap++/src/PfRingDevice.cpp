@@ -397,33 +397,30 @@ void PfRingDevice::close()
 	LOG_DEBUG("Device [%s] closed", m_DeviceName);
 }
 
-bool PfRingDevice::initCoreConfigurationByCoreMask(CoreMask coreMask)
+bool PfRingDevice::initCoreConfigurationByCoreMask(const CoreMask& coreMask)
 {
-	int i = 0;
 	int numOfCores = getNumOfCores();
+	int highestCoreId = coreMask.getHighestCoreId();
 	clearCoreConfiguration();
-	while ((coreMask != 0) && (i < numOfCores))
-	{
-		if (coreMask & 1)
-		{
-			m_CoreConfiguration[i].IsInUse = true;
-		}
 
-		coreMask = coreMask >> 1;
-		i++;
+	if (highestCoreId >= numOfCores || highestCoreId >= MAX_NUM_OF_CORES) // this mean coreMask contains a core that doesn't exist
+	{
+		LOG_ERROR("Trying to use a core [%d] that doesn't exist while machine has %d cores", highestCoreId, numOfCores);
+		return false;
 	}
 
-	if (coreMask != 0) // this mean coreMask contains a core that doesn't exist
+	for (int i = 0; i <= highestCoreId; i++)
 	{
-		LOG_ERROR("Trying to use a core [%d] that doesn't exist while machine has %d cores", i, numOfCores);
-		clearCoreConfiguration();
-		return false;
+		if (coreMask.isCoreSet(i))
+		{
+			m_CoreConfiguration[i].IsInUse = true;
+		}
 	}
 
 	return true;
 }
 
-bool PfRingDevice::startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, CoreMask coreMask)
+bool PfRingDevice::startCaptureMultiThread(OnPfRingPacketsArriveCallback onPacketsArrive, void* onPacketsArriveUserCookie, const CoreMask& coreMask)
 {
 	if (!m_StopThread)
 	{
@@ -604,7 +601,7 @@ void* PfRingDevice::captureThreadMain(void* ptr)
 void PfRingDevice::getThreadStatistics(SystemCore core, PfRingStats& stats) const
 {
 	pfring* ring = NULL;
-	uint8_t coreId = core.Id;
+	uint16_t coreId = core.Id;
 
 	ring = m_CoreConfiguration[coreId].Channel;
 
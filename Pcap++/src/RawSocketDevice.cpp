@@ -5,6 +5,9 @@
 #include <errno.h>
 #include <unistd.h>
 #include <linux/if_ether.h>
+// pcap.h comes first so the kernel headers don't redefine its BPF macros
+#include <pcap.h>
+#include <linux/filter.h>
 #include <netpacket/packet.h>
 #include <ifaddrs.h>
 #include <net/if.h>
@@ -15,12 +18,29 @@
 #include "SystemUtils.h"
 #include "Packet.h"
 #include "EthLayer.h"
+#include <vector>
 
 namespace pcpp
 {
 
 #define RAW_SOCKET_BUFFER_LEN 65536
 
+// the maximum length of a classic BPF program the Linux kernel accepts
+#define RAW_SOCKET_MAX_FILTER_LEN 4096
+
+#if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV) || defined(LINUX)
+
+// the time left until a deadline taken from clockGetTime(), in microseconds. At least 1 so it can be set as a socket timeout
+static long getMicrosecondsUntil(long deadlineSec, long deadlineNsec)
+{
+	long curSec, curNsec;
+	clockGetTime(curSec, curNsec);
+	long remaining = (deadlineSec - curSec) * 1000000 + (deadlineNsec - curNsec) / 1000;
+	return (remaining > 0 ? remaining : 1);
+}
+
+#endif
+
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
 
 #ifndef SIO_RCVALL
@@ -123,8 +143,27 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 	DWORD timeoutVal = timeout * 1000;
 	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
 
+	long deadlineSec, deadlineNsec;
+	clockGetTime(deadlineSec, deadlineNsec);
+	deadlineSec += timeout;
+
 	//recvfrom(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0, (struct sockaddr*)&sockAddr,(socklen_t*)&sockAddrLen);
-	int bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
+	// packets the sampler doesn't select are dropped here, before they are copied into the RawPacket. The timeout is shortened after
+	// each dropped packet so it counts from the call and not from the last packet received
+	int bufferLen = 0;
+	while (true)
+	{
+		bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
+		if (bufferLen <= 0 || m_PacketSampler.sample((const uint8_t*)buffer, bufferLen, LINKTYPE_DLT_RAW1))
+			break;
+
+		if (blocking && timeout > 0)
+		{
+			timeoutVal = (DWORD)((getMicrosecondsUntil(deadlineSec, deadlineNsec) + 999) / 1000);
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
+		}
+	}
+
 	if (bufferLen < 0)
 	{
 		delete [] buffer;
@@ -185,7 +224,30 @@ RawSocketDevice::RecvPacketResult RawSocketDevice::receivePacket(RawPacket& rawP
 	timeoutVal.tv_usec = 0;
 	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
 
-	int bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
+	long deadlineSec, deadlineNsec;
+	clockGetTime(deadlineSec, deadlineNsec);
+	deadlineSec += timeout;
+
+	// packets the post filter or the sampler doesn't select are dropped here, before they are copied into the RawPacket. The timeout
+	// is shortened after each dropped packet so it counts from the call and not from the last packet received
+	int bufferLen = 0;
+	while (true)
+	{
+		bufferLen = recv(fd, buffer, RAW_SOCKET_BUFFER_LEN, 0);
+		if (bufferLen <= 0 ||
+				((!m_PostFilter.isCompiled() || m_PostFilter.matchPacket((const uint8_t*)buffer, bufferLen, LINKTYPE_ETHERNET)) &&
+				m_PacketSampler.sample((const uint8_t*)buffer, bufferLen, LINKTYPE_ETHERNET)))
+			break;
+
+		if (blocking && timeout > 0)
+		{
+			long remaining = getMicrosecondsUntil(deadlineSec, deadlineNsec);
+			timeoutVal.tv_sec = remaining / 1000000;
+			timeoutVal.tv_usec = remaining % 1000000;
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutVal, sizeof(timeoutVal));
+		}
+	}
+
 	if (bufferLen < 0)
 	{
 		delete [] buffer;
@@ -542,10 +604,143 @@ void RawSocketDevice::close()
 #endif
 		delete sockContainer;
 		m_Socket = NULL;
+		m_PostFilter.clear();
 		m_DeviceOpened = false;
 	}
 }
 
+bool RawSocketDevice::setFilter(GeneralFilter& filter)
+{
+	std::string filterAsString;
+	filter.parseToString(filterAsString);
+	if (!setFilter(filterAsString))
+		return false;
+
+	if (!filter.containsFilterSet())
+		return true;
+
+	// setFilter(std::string) cleared the previous post filter
+	if (!m_PostFilter.compile(filter))
+	{
+		LOG_ERROR("Cannot compile the filter set of the filter, clearing the filter");
+		clearFilter();
+		return false;
+	}
+
+	return true;
+}
+
+bool RawSocketDevice::setFilter(std::string filterAsString)
+{
+	m_PostFilter.clear();
+
+#if defined(LINUX)
+
+	if (!isOpened())
+	{
+		LOG_ERROR("Device not opened, cannot set filter");
+		return false;
+	}
+
+	int fd = ((SocketContainer*)m_Socket)->fd;
+
+	// the socket receives Ethernet frames of up to RAW_SOCKET_BUFFER_LEN bytes, see receivePacket()
+	struct bpf_program program;
+	if (pcap_compile_nopcap(RAW_SOCKET_BUFFER_LEN, LINKTYPE_ETHERNET, &program, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Couldn't compile filter '%s'", filterAsString.c_str());
+		return false;
+	}
+
+	// libpcap and the kernel use the same classic BPF instruction format
+	std::vector<sock_filter> instructions(program.bf_len);
+	for (u_int i = 0; i < program.bf_len; i++)
+	{
+		instructions[i].code = program.bf_insns[i].code;
+		instructions[i].jt = program.bf_insns[i].jt;
+		instructions[i].jf = program.bf_insns[i].jf;
+		instructions[i].k = program.bf_insns[i].k;
+	}
+	pcap_freecode(&program);
+
+	if (instructions.empty() || instructions.size() > RAW_SOCKET_MAX_FILTER_LEN)
+	{
+		LOG_ERROR("Filter '%s' was compiled to %d instructions, the kernel accepts 1 to %d instructions", filterAsString.c_str(),
+				(int)instructions.size(), RAW_SOCKET_MAX_FILTER_LEN);
+		return false;
+	}
+
+	// packets already queued on the socket weren't matched by the new filter. A filter that drops all packets is attached first and
+	// the queue is drained, so every packet received after the new filter is attached matches it
+	sock_filter dropAll = BPF_STMT(BPF_RET | BPF_K, 0);
+	sock_fprog dropAllProgram;
+	dropAllProgram.len = 1;
+	dropAllProgram.filter = &dropAll;
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &dropAllProgram, sizeof(dropAllProgram)) == -1)
+	{
+		LOG_ERROR("Couldn't attach a filter to the raw socket. Error was: '%s'", strerror(errno));
+		return false;
+	}
+
+	char buffer;
+	while (recv(fd, &buffer, sizeof(buffer), MSG_DONTWAIT | MSG_TRUNC) >= 0)
+		;
+
+	sock_fprog filterProgram;
+	filterProgram.len = (unsigned short)instructions.size();
+	filterProgram.filter = &instructions[0];
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &filterProgram, sizeof(filterProgram)) == -1)
+	{
+		LOG_ERROR("The kernel rejected filter '%s'. Error was: '%s'", filterAsString.c_str(), strerror(errno));
+		// don't leave the socket dropping all packets
+		int dummy = 0;
+		setsockopt(fd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy));
+		return false;
+	}
+
+	LOG_DEBUG("Filter '%s' attached to the raw socket (%d instructions)", filterAsString.c_str(), (int)instructions.size());
+	return true;
+
+#else
+
+	LOG_ERROR("Filters on raw sockets are supported on Linux only");
+	return false;
+
+#endif
+}
+
+bool RawSocketDevice::clearFilter()
+{
+	m_PostFilter.clear();
+
+#if defined(LINUX)
+
+	if (!isOpened())
+	{
+		LOG_ERROR("Device not opened, cannot clear filter");
+		return false;
+	}
+
+	int fd = ((SocketContainer*)m_Socket)->fd;
+
+	// the kernel ignores the option value but requires one. ENOENT means no filter was attached
+	int dummy = 0;
+	if (setsockopt(fd, SOL_SOCKET, SO_DETACH_FILTER, &dummy, sizeof(dummy)) == -1 && errno != ENOENT)
+	{
+		LOG_ERROR("Couldn't detach the filter from the raw socket. Error was: '%s'", strerror(errno));
+		return false;
+	}
+
+	return true;
+
+#else
+
+	LOG_ERROR("Filters on raw sockets are supported on Linux only");
+	return false;
+
+#endif
+}
+
 RawSocketDevice::RecvPacketResult RawSocketDevice::getError(int& errorCode) const
 {
 #if defined(WIN32) || defined(WINx64) || defined(PCAPPP_MINGW_ENV)
@@ -0,0 +1,375 @@
+#define LOG_MODULE PcapLogModuleLiveDevice
+
+#include "StatefulFilter.h"
+#include "Logger.h"
+#include <algorithm>
+#if defined(WINx64)
+#include <winsock2.h>
+#endif
+#include <pcap.h>
+
+// the snapshot length BPF filters are compiled with, the same as in the file devices
+#define STATEFUL_FILTER_BPF_SNAPLEN 9000
+
+namespace pcpp
+{
+
+static const uint32_t NoEntry = 0xFFFFFFFF;
+
+// the number of hash buckets of an empty table, it's doubled as flows are added
+static const size_t InitialNumOfBuckets = 64;
+
+StatefulFilter::StatefulFilter(size_t maxNumOfFlows, uint32_t idleTimeoutSec)
+{
+	// entries are indexed by 32-bit indexes and NoEntry marks the end of lists
+	if (maxNumOfFlows == 0)
+		maxNumOfFlows = 1;
+	else if (maxNumOfFlows >= NoEntry)
+		maxNumOfFlows = NoEntry - 1;
+
+	m_MaxNumOfFlows = maxNumOfFlows;
+	m_IdleTimeoutSec = idleTimeoutSec;
+	m_PassUndecided = false;
+
+	m_DecisionMethod = NoDecision;
+	m_MaxPacketsToDecide = 0;
+	m_BpfLinkType = -1;
+	m_Classifier = NULL;
+	m_ClassifierCookie = NULL;
+
+	// a power of 2 number of buckets, so a bucket is selected by masking the hash. The table starts small and the buckets are doubled
+	// whenever there are more flows than buckets (see growBuckets()) until there is one per flow, so chains stay short and memory is
+	// allocated only for the flows the table actually holds
+	m_MaxNumOfBuckets = 1;
+	while (m_MaxNumOfBuckets < m_MaxNumOfFlows && m_MaxNumOfBuckets < ((size_t)1 << 31))
+		m_MaxNumOfBuckets <<= 1;
+
+	clear();
+}
+
+bool StatefulFilter::setFlowFilter(const GeneralFilter& filter, uint32_t maxPacketsToDecide)
+{
+	if (!m_NativeFilter.compile(filter))
+	{
+		LOG_ERROR("Couldn't compile the flow filter");
+		return false;
+	}
+
+	m_DecisionMethod = NativeFilterDecision;
+	m_MaxPacketsToDecide = maxPacketsToDecide;
+	m_BpfFilter.clear();
+	m_BpfJit.clear();
+	m_Classifier = NULL;
+	m_ClassifierCookie = NULL;
+	clear();
+	return true;
+}
+
+bool StatefulFilter::setFlowFilter(const std::string& filterAsString, uint32_t maxPacketsToDecide)
+{
+	if (filterAsString.empty())
+	{
+		LOG_ERROR("Flow filter is empty");
+		return false;
+	}
+
+	// the filter is compiled for the link type of the packets when they arrive, so it's only validated here
+	struct bpf_program prog;
+	if (pcap_compile_nopcap(STATEFUL_FILTER_BPF_SNAPLEN, LINKTYPE_ETHERNET, &prog, filterAsString.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Flow filter '%s' is not valid", filterAsString.c_str());
+		return false;
+	}
+	pcap_freecode(&prog);
+
+	m_DecisionMethod = BpfFilterDecision;
+	m_MaxPacketsToDecide = maxPacketsToDecide;
+	m_NativeFilter.clear();
+	m_BpfFilter = filterAsString;
+	m_BpfJit.clear();
+	m_BpfLinkType = -1;
+	m_Classifier = NULL;
+	m_ClassifierCookie = NULL;
+	clear();
+	return true;
+}
+
+void StatefulFilter::setFlowClassifier(FlowClassifier classifier, void* userCookie, uint32_t maxPacketsToDecide)
+{
+	m_DecisionMethod = (classifier == NULL ? NoDecision : ClassifierDecision);
+	m_MaxPacketsToDecide = maxPacketsToDecide;
+	m_NativeFilter.clear();
+	m_BpfFilter.clear();
+	m_BpfJit.clear();
+	m_Classifier = classifier;
+	m_ClassifierCookie = userCookie;
+	clear();
+}
+
+void StatefulFilter::clear()
+{
+	// the memory of the previous flows is released rather than kept for the next ones
+	std::vector<FlowEntry>().swap(m_Entries);
+	std::vector<uint32_t>(std::min(InitialNumOfBuckets, m_MaxNumOfBuckets), NoEntry).swap(m_Buckets);
+	m_FreeList = NoEntry;
+	m_LruHead = NoEntry;
+	m_LruTail = NoEntry;
+	m_NumOfFlows = 0;
+
+	m_NumOfAcceptedFlows = 0;
+	m_NumOfRejectedFlows = 0;
+	m_NumOfExpiredFlows = 0;
+	m_NumOfEvictedFlows = 0;
+	m_NumOfPacketsSeen = 0;
+	m_NumOfPacketsPassed = 0;
+}
+
+bool StatefulFilter::compileBpf(int linkType)
+{
+	LOG_DEBUG("Compiling the flow filter '%s' for link type %d", m_BpfFilter.c_str(), linkType);
+	m_BpfJit.clear();
+	m_BpfLinkType = linkType;
+
+	struct bpf_program prog;
+	if (pcap_compile_nopcap(STATEFUL_FILTER_BPF_SNAPLEN, linkType, &prog, m_BpfFilter.c_str(), 1, 0) < 0)
+	{
+		LOG_ERROR("Couldn't compile the flow filter '%s' for link type %d", m_BpfFilter.c_str(), linkType);
+		return false;
+	}
+
+	bool result = m_BpfJit.compile(&prog);
+	pcap_freecode(&prog);
+	return result;
+}
+
+StatefulFilter::Verdict StatefulFilter::classify(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, const timespec& timestamp, uint32_t packetIndexInFlow)
+{
+	switch (m_DecisionMethod)
+	{
+	case NativeFilterDecision:
+		return (m_NativeFilter.matchPacket(packetData, packetDataLen, linkType) ? Accept : Undecided);
+
+	case BpfFilterDecision:
+		// a link type the filter can't be compiled for is compiled once and then never matches
+		if (m_BpfLinkType != (int)linkType)
+			compileBpf((int)linkType);
+		return (m_BpfJit.isCompiled() && m_BpfJit.matchPacket(packetData, packetDataLen, packetDataLen) ? Accept : Undecided);
+
+	case ClassifierDecision:
+	{
+		RawPacket rawPacket(packetData, packetDataLen, timestamp, false, linkType);
+		return m_Classifier(rawPacket, packetIndexInFlow, m_ClassifierCookie);
+	}
+
+	default:
+		return Accept;
+	}
+}
+
+uint32_t StatefulFilter::findFlow(const FlowKey& key, uint32_t hash) const
+{
+	uint32_t index = m_Buckets[hash & (m_Buckets.size() - 1)];
+	while (index != NoEntry)
+	{
+		const FlowEntry& entry = m_Entries[index];
+		if (entry.hash == hash && entry.key == key)
+			return index;
+		index = entry.next;
+	}
+
+	return NoEntry;
+}
+
+void StatefulFilter::unlinkLru(uint32_t index)
+{
+	FlowEntry& entry = m_Entries[index];
+	if (entry.lruPrev != NoEntry)
+		m_Entries[entry.lruPrev].lruNext = entry.lruNext;
+	else
+		m_LruHead = entry.lruNext;
+
+	if (entry.lruNext != NoEntry)
+		m_Entries[entry.lruNext].lruPrev = entry.lruPrev;
+	else
+		m_LruTail = entry.lruPrev;
+}
+
+void StatefulFilter::linkLruHead(uint32_t index)
+{
+	FlowEntry& entry = m_Entries[index];
+	entry.lruPrev = NoEntry;
+	entry.lruNext = m_LruHead;
+	if (m_LruHead != NoEntry)
+		m_Entries[m_LruHead].lruPrev = index;
+	else
+		m_LruTail = index;
+	m_LruHead = index;
+}
+
+void StatefulFilter::removeFlow(uint32_t index)
+{
+	FlowEntry& entry = m_Entries[index];
+
+	uint32_t* link = &m_Buckets[entry.hash & (m_Buckets.size() - 1)];
+	while (*link != index)
+		link = &m_Entries[*link].next;
+	*link = entry.next;
+
+	unlinkLru(index);
+
+	entry.next = m_FreeList;
+	m_FreeList = index;
+	m_NumOfFlows--;
+}
+
+void StatefulFilter::growBuckets()
+{
+	std::vector<uint32_t>(m_Buckets.size() * 2, NoEntry).swap(m_Buckets);
+
+	// only the flows in the LRU list are in the table, the other entries are in the free list
+	for (uint32_t index = m_LruHead; index != NoEntry; index = m_Entries[index].lruNext)
+	{
+		uint32_t& bucket = m_Buckets[m_Entries[index].hash & (m_Buckets.size() - 1)];
+		m_Entries[index].next = bucket;
+		bucket = index;
+	}
+}
+
+uint32_t StatefulFilter::addFlow(const FlowKey& key, uint32_t hash, time_t now)
+{
+	if (m_NumOfFlows >= m_MaxNumOfFlows)
+	{
+		removeFlow(m_LruTail);
+		m_NumOfEvictedFlows++;
+	}
+	else if (m_NumOfFlows >= m_Buckets.size() && m_Buckets.size() < m_MaxNumOfBuckets)
+	{
+		growBuckets();
+	}
+
+	uint32_t index;
+	if (m_FreeList != NoEntry)
+	{
+		index = m_FreeList;
+		m_FreeList = m_Entries[index].next;
+	}
+	else
+	{
+		index = (uint32_t)m_Entries.size();
+		m_Entries.push_back(FlowEntry());
+	}
+
+	FlowEntry& entry = m_Entries[index];
+	entry.key = key;
+	entry.hash = hash;
+	entry.numOfPackets = 0;
+	entry.lastSeen = now;
+	entry.verdict = Undecided;
+
+	uint32_t& bucket = m_Buckets[hash & (m_Buckets.size() - 1)];
+	entry.next = bucket;
+	bucket = index;
+
+	linkLruHead(index);
+	m_NumOfFlows++;
+	return index;
+}
+
+void StatefulFilter::expireIdleFlows(time_t now)
+{
+	if (m_IdleTimeoutSec == 0)
+		return;
+
+	// the LRU list is ordered by the time flows were last seen, so idle flows are at its tail
+	while (m_LruTail != NoEntry && now - m_Entries[m_LruTail].lastSeen > (time_t)m_IdleTimeoutSec)
+	{
+		removeFlow(m_LruTail);
+		m_NumOfExpiredFlows++;
+	}
+}
+
+bool StatefulFilter::matchPacket(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, const timespec& timestamp)
+{
+	m_NumOfPacketsSeen++;
+
+	if (m_DecisionMethod == NoDecision)
+	{
+		m_NumOfPacketsPassed++;
+		return true;
+	}
+
+	Verdict verdict;
+	FlowKey key;
+	if (!key.fromRawData(packetData, packetDataLen, linkType))
+	{
+		// a packet without a flow is a flow of its own, which has no more packets to decide on
+		verdict = classify(packetData, packetDataLen, linkType, timestamp, 0);
+		if (verdict == Undecided)
+			verdict = Reject;
+	}
+	else
+	{
+		// the LRU list must stay ordered by the time flows were last seen, which is what expireIdleFlows() relies on, so every flow
+		// that is moved to its head must be the most recently seen one. Packets may be slightly out of order, so a packet older than the
+		// head of the list counts as seen at the time of the head
+		time_t now = timestamp.tv_sec;
+		if (m_LruHead != NoEntry && now < m_Entries[m_LruHead].lastSeen)
+			now = m_Entries[m_LruHead].lastSeen;
+		expireIdleFlows(now);
+
+		// both directions of a connection share a flow
+		key.makeCanonical();
+		uint32_t hash = key.hash();
+		uint32_t index = findFlow(key, hash);
+		if (index == NoEntry)
+		{
+			index = addFlow(key, hash, now);
+		}
+		else
+		{
+			unlinkLru(index);
+			linkLruHead(index);
+			m_Entries[index].lastSeen = now;
+		}
+
+		FlowEntry& entry = m_Entries[index];
+		if (entry.verdict == Undecided)
+		{
+			Verdict newVerdict = classify(packetData, packetDataLen, linkType, timestamp, entry.numOfPackets);
+			entry.numOfPackets++;
+			if (newVerdict == Undecided && m_MaxPacketsToDecide > 0 && entry.numOfPackets >= m_MaxPacketsToDecide)
+				newVerdict = Reject;
+
+			if (newVerdict == Accept)
+				m_NumOfAcceptedFlows++;
+			else if (newVerdict == Reject)
+				m_NumOfRejectedFlows++;
+
+			entry.verdict = newVerdict;
+		}
+		else if (entry.numOfPackets < NoEntry)
+		{
+			entry.numOfPackets++;
+		}
+
+		verdict = entry.verdict;
+	}
+
+	if (verdict == Accept || (verdict == Undecided && m_PassUndecided))
+	{
+		m_NumOfPacketsPassed++;
+		return true;
+	}
+
+	return false;
+}
+
+bool StatefulFilter::matchPacket(RawPacket* rawPacket)
+{
+	if (rawPacket == NULL)
+		return false;
+
+	return matchPacket(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), rawPacket->getPacketTimeStamp());
+}
+
+} // namespace pcpp
@@ -0,0 +1,116 @@
+#include "ToeplitzHash.h"
+#include "EthLayer.h"
+#include "IPv4Layer.h"
+#include "PacketUtils.h"
+
+namespace pcpp
+{
+
+const size_t ToeplitzHash::DefaultKeyLength;
+
+const uint8_t ToeplitzHash::StandardKey[ToeplitzHash::DefaultKeyLength] = {
+	0x6D, 0x5A, 0x56, 0xDA, 0x25, 0x5B, 0x0E, 0xC2,
+	0x41, 0x67, 0x25, 0x3D, 0x43, 0xA3, 0x8F, 0xB0,
+	0xD0, 0xCA, 0x2B, 0xCB, 0xAE, 0x7B, 0x30, 0xB4,
+	0x77, 0xCB, 0x2D, 0xA3, 0x80, 0x30, 0xF2, 0x0C,
+	0x6A, 0x42, 0xB7, 0x3B, 0xBE, 0xAC, 0x01, 0xFA
+};
+
+const uint8_t ToeplitzHash::SymmetricKey[ToeplitzHash::DefaultKeyLength] = {
+	0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+	0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+	0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+	0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A,
+	0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A, 0x6D, 0x5A
+};
+
+ToeplitzHash::ToeplitzHash(const uint8_t* key, size_t keyLength, uint64_t rssHashFunctions)
+{
+	if (key == NULL || keyLength < 8)
+	{
+		key = SymmetricKey;
+		keyLength = DefaultKeyLength;
+	}
+
+	m_Key.assign(key, key + keyLength);
+	m_MaxInputLength = keyLength - 4;
+	m_RssHashFunctions = rssHashFunctions;
+
+	// input bit i contributes the 32 key bits starting at bit i. Build the 32-bit key window of every input bit and combine the
+	// windows of each input byte into a table of 256 entries indexed by the byte value
+	m_Table.resize(m_MaxInputLength * 256);
+	for (size_t bytePos = 0; bytePos < m_MaxInputLength; bytePos++)
+	{
+		uint32_t windows[8];
+		for (int bit = 0; bit < 8; bit++)
+		{
+			size_t firstKeyBit = bytePos * 8 + bit;
+			uint32_t window = 0;
+			for (size_t keyBit = firstKeyBit; keyBit < firstKeyBit + 32; keyBit++)
+				window = (window << 1) | ((m_Key[keyBit / 8] >> (7 - keyBit % 8)) & 1);
+			windows[bit] = window;
+		}
+
+		uint32_t* table = &m_Table[bytePos * 256];
+		for (int value = 0; value < 256; value++)
+		{
+			uint32_t result = 0;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				if (value & (0x80 >> bit))
+					result ^= windows[bit];
+			}
+			table[value] = result;
+		}
+	}
+}
+
+bool ToeplitzHash::calculateHash(const uint8_t* packetData, int packetDataLen, LinkLayerType linkType, uint32_t& hash) const
+{
+	hash = 0;
+	RawPacketHeaders headers;
+	if (!parseRawPacketHeaders(packetData, packetDataLen, linkType, headers))
+		return false;
+
+	bool isIPv4 = (headers.etherType == PCPP_ETHERTYPE_IP);
+	size_t addressesLength = (isIPv4 ? 8 : 32);
+	if (m_MaxInputLength < addressesLength)
+		return false;
+
+	uint64_t l4HashFunction = 0;
+	if (!headers.isFragment)
+	{
+		switch (headers.transportProtocol)
+		{
+		case PACKETPP_IPPROTO_TCP:
+			l4HashFunction = (isIPv4 ? RSS_NONFRAG_IPV4_TCP : RSS_NONFRAG_IPV6_TCP);
+			break;
+		case PACKETPP_IPPROTO_UDP:
+			l4HashFunction = (isIPv4 ? RSS_NONFRAG_IPV4_UDP : RSS_NONFRAG_IPV6_UDP);
+			break;
+		case PACKETPP_IPPROTO_SCTP:
+			l4HashFunction = (isIPv4 ? RSS_NONFRAG_IPV4_SCTP : RSS_NONFRAG_IPV6_SCTP);
+			break;
+		}
+	}
+
+	bool hashPorts = (m_RssHashFunctions & l4HashFunction) != 0 && headers.transportOffset >= 0 && m_MaxInputLength >= addressesLength + 4;
+	if (!hashPorts)
+	{
+		uint64_t l3HashFunctions;
+		if (isIPv4)
+			l3HashFunctions = RSS_IPV4 | (headers.isFragment ? RSS_FRAG_IPV4 : (l4HashFunction == 0 ? RSS_NONFRAG_IPV4_OTHER : 0));
+		else
+			l3HashFunctions = RSS_IPV6 | (headers.isFragment ? RSS_FRAG_IPV6 : (l4HashFunction == 0 ? RSS_NONFRAG_IPV6_OTHER : 0));
+		if ((m_RssHashFunctions & l3HashFunctions) == 0)
+			return false;
+	}
+
+	// source and destination IPs are adjacent in the IPv4 and IPv6 headers, and so are the source and destination ports
+	hash = hashBytes(headers.ipHeader + (isIPv4 ? 12 : 8), addressesLength, 0);
+	if (hashPorts)
+		hash ^= hashBytes(headers.ipHeader + headers.transportOffset, 4, addressesLength);
+	return true;
+}
+
+} // namespace pcpp
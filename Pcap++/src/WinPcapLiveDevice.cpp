@@ -52,11 +52,8 @@ bool WinPcapLiveDevice::startCapture(int intervalInSecondsToUpdateStats, OnStats
 
 int WinPcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
 {
-	if (!m_DeviceOpened || m_PcapDescriptor == NULL)
-	{
-		LOG_ERROR("Device '%s' not opened", m_Name);
+	if (!prepareSendBatch(arrLength))
 		return 0;
-	}
 
 	int dataSize = 0;
 	int packetsSent = 0;
@@ -86,26 +83,33 @@ int WinPcapLiveDevice::sendPackets(RawPacket* rawPacketsArr, int arrLength)
 	if ((res = pcap_sendqueue_transmit(m_PcapDescriptor, sendQueue, 0)) < (int)(sendQueue->len))
 	{
 		LOG_ERROR("An error occurred sending the packets: %s. Only %d bytes were sent\n", pcap_geterr(m_PcapDescriptor), res);
+		int packetsQueued = packetsSent;
 		packetsSent = 0;
 		dataSize = 0;
-		for (int i = 0; i < arrLength; i++)
+		for (int i = 0; i < packetsQueued; i++)
 		{
-			dataSize += rawPacketsArr[i].getRawDataLen();
-			//printf("dataSize = %d\n", dataSize);
+			dataSize += rawPacketsArr[i].getRawDataLen() + sizeof(pcap_pkthdr);
 			if (dataSize > res)
-			{
-				return packetsSent;
-			}
+				break;
 			packetsSent++;
 		}
-		return packetsSent;
 	}
-	LOG_DEBUG("Packets were sent successfully");
+	else
+	{
+		LOG_DEBUG("Packets were sent successfully");
+	}
 
 	pcap_sendqueue_destroy(sendQueue);
 	LOG_DEBUG("Send queue destroyed");
 
 	delete[] packetHeader;
+
+	m_LastSendResult.packetsSent = packetsSent;
+	m_LastSendResult.packetsFailed = arrLength - packetsSent;
+	m_LastSendResult.firstFailedIndex = (packetsSent < arrLength ? packetsSent : -1);
+	for (int i = 0; i < packetsSent; i++)
+		m_LastSendResult.bytesSent += rawPacketsArr[i].getRawDataLen();
+
 	return packetsSent;
 }
 
@@ -29,6 +29,10 @@
 #include <EthDot3Layer.h>
 #include <BgpLayer.h>
 #include <IpAddress.h>
+#include <FlowKey.h>
+#include <RuleClassifier.h>
+#include <MultiPatternMatcher.h>
+#include <PacketUtils.h>
 #include <fstream>
 #include <stdlib.h>
 #include "PcppTestFramework.h"
@@ -8290,6 +8294,224 @@ PTF_TEST_CASE(BgpLayerEditTest)
 } // BgpLayerEditTest
 
 
+PTF_TEST_CASE(FlowKeyTest)
+{
+	// IPv4 TCP: extraction, reversed direction and canonical form
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	IPv4Layer ip4Layer(IPv4Address(std::string("10.0.0.2")), IPv4Address(std::string("10.0.0.1")));
+	ip4Layer.getIPv4Header()->timeToLive = 64;
+	TcpLayer tcpLayer(80, 1234);
+	Packet tcpPacket(100);
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&ip4Layer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpLayer));
+	tcpPacket.computeCalculateFields();
+
+	FlowKey tcpKey;
+	PTF_ASSERT_TRUE(tcpKey.fromPacket(&tcpPacket));
+	PTF_ASSERT_TRUE(tcpKey.isValid());
+	PTF_ASSERT_TRUE(tcpKey.isIPv4());
+	PTF_ASSERT_EQUAL(tcpKey.getSrcIPv4Address(), IPv4Address(std::string("10.0.0.2")), object);
+	PTF_ASSERT_EQUAL(tcpKey.getDstIPv4Address(), IPv4Address(std::string("10.0.0.1")), object);
+	PTF_ASSERT_EQUAL(tcpKey.getSrcPort(), 80, u16);
+	PTF_ASSERT_EQUAL(tcpKey.getDstPort(), 1234, u16);
+	PTF_ASSERT_EQUAL(tcpKey.getProtocol(), PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(tcpKey.getVlanId(), 0, u16);
+	PTF_ASSERT_EQUAL(tcpKey.getTunnelId(), 0, u32);
+	PTF_ASSERT_EQUAL(tcpKey.toString(), "TCP 10.0.0.2:80 -> 10.0.0.1:1234", string);
+
+	FlowKey expectedKey(IPv4Address(std::string("10.0.0.2")), IPv4Address(std::string("10.0.0.1")), PACKETPP_IPPROTO_TCP, 80, 1234);
+	PTF_ASSERT_TRUE(tcpKey == expectedKey);
+
+	FlowKey reversedKey = tcpKey.getReversed();
+	PTF_ASSERT_TRUE(reversedKey != tcpKey);
+	PTF_ASSERT_EQUAL(reversedKey.getSrcPort(), 1234, u16);
+	PTF_ASSERT_EQUAL(reversedKey.getDstIPv4Address(), IPv4Address(std::string("10.0.0.2")), object);
+	PTF_ASSERT_TRUE(tcpKey < reversedKey || reversedKey < tcpKey);
+	PTF_ASSERT_FALSE(tcpKey.isCanonical());
+	PTF_ASSERT_TRUE(reversedKey.isCanonical());
+	PTF_ASSERT_TRUE(tcpKey.getCanonical() == reversedKey.getCanonical());
+	PTF_ASSERT_TRUE(tcpKey.symmetricHash() == reversedKey.symmetricHash());
+	PTF_ASSERT_TRUE(tcpKey.hash() != reversedKey.hash());
+	PTF_ASSERT_TRUE(tcpKey.hash() != tcpKey.hash(1));
+	PTF_ASSERT_TRUE(tcpKey.makeCanonical());
+	PTF_ASSERT_FALSE(tcpKey.makeCanonical());
+	PTF_ASSERT_TRUE(tcpKey == reversedKey);
+
+	// swap the packet's direction: hash5Tuple() and hash2Tuple() are symmetric
+	uint32_t hash5TupleValue = hash5Tuple(&tcpPacket);
+	uint32_t hash2TupleValue = hash2Tuple(&tcpPacket);
+	PTF_ASSERT_TRUE(hash5TupleValue != 0);
+	ip4Layer.setSrcIpAddress(IPv4Address(std::string("10.0.0.1")));
+	ip4Layer.setDstIpAddress(IPv4Address(std::string("10.0.0.2")));
+	tcpLayer.getTcpHeader()->portSrc = htobe16(1234);
+	tcpLayer.getTcpHeader()->portDst = htobe16(80);
+	PTF_ASSERT_EQUAL(hash5Tuple(&tcpPacket), hash5TupleValue, u32);
+	PTF_ASSERT_EQUAL(hash2Tuple(&tcpPacket), hash2TupleValue, u32);
+
+	// IPv6 UDP over VLAN: addresses that differ only in their last byte must be ordered by value
+	EthLayer ethLayer2(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	VlanLayer vlanLayer(100, false, 0, PCPP_ETHERTYPE_IPV6);
+	IPv6Layer ip6Layer(IPv6Address(std::string("2001:db8::10")), IPv6Address(std::string("2001:db8::2")));
+	UdpLayer udpLayer(5000, 53);
+	Packet udpPacket(100);
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&ethLayer2));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&vlanLayer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&ip6Layer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpLayer));
+	udpPacket.computeCalculateFields();
+
+	FlowKey udpKey;
+	PTF_ASSERT_TRUE(udpKey.fromPacket(&udpPacket));
+	PTF_ASSERT_TRUE(udpKey.isIPv6());
+	PTF_ASSERT_EQUAL(udpKey.getSrcIPv6Address(), IPv6Address(std::string("2001:db8::10")), object);
+	PTF_ASSERT_EQUAL(udpKey.getDstIPv6Address(), IPv6Address(std::string("2001:db8::2")), object);
+	PTF_ASSERT_EQUAL(udpKey.getProtocol(), PACKETPP_IPPROTO_UDP, u8);
+	PTF_ASSERT_EQUAL(udpKey.getVlanId(), 100, u16);
+	PTF_ASSERT_EQUAL(udpKey.getSrcPort(), 5000, u16);
+	PTF_ASSERT_FALSE(udpKey.isCanonical());
+	FlowKey canonicalUdpKey = udpKey.getCanonical();
+	PTF_ASSERT_EQUAL(canonicalUdpKey.getSrcIPv6Address(), IPv6Address(std::string("2001:db8::2")), object);
+	PTF_ASSERT_EQUAL(canonicalUdpKey.getSrcPort(), 53, u16);
+	PTF_ASSERT_EQUAL(canonicalUdpKey.getVlanId(), 100, u16);
+
+	// the IPv6 addresses are ordered by value, so the hashes of both directions are the same
+	hash5TupleValue = hash5Tuple(&udpPacket);
+	hash2TupleValue = hash2Tuple(&udpPacket);
+	PTF_ASSERT_TRUE(hash5TupleValue != 0);
+	IPv6Address(std::string("2001:db8::2")).copyTo(ip6Layer.getIPv6Header()->ipSrc);
+	IPv6Address(std::string("2001:db8::10")).copyTo(ip6Layer.getIPv6Header()->ipDst);
+	udpLayer.getUdpHeader()->portSrc = htobe16(53);
+	udpLayer.getUdpHeader()->portDst = htobe16(5000);
+	PTF_ASSERT_EQUAL(hash5Tuple(&udpPacket), hash5TupleValue, u32);
+	PTF_ASSERT_EQUAL(hash2Tuple(&udpPacket), hash2TupleValue, u32);
+	udpLayer.getUdpHeader()->portSrc = htobe16(5000);
+	udpLayer.getUdpHeader()->portDst = htobe16(53);
+	IPv6Address(std::string("2001:db8::10")).copyTo(ip6Layer.getIPv6Header()->ipSrc);
+	IPv6Address(std::string("2001:db8::2")).copyTo(ip6Layer.getIPv6Header()->ipDst);
+
+	// ICMP: the IP and UDP headers quoted inside the ICMP message are ignored
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/IcmpDestUnreachableUdp.dat", bufferLength);
+	PTF_ASSERT(!(buffer == NULL), "cannot read file IcmpDestUnreachableUdp.dat");
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket icmpRawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet icmpPacket(&icmpRawPacket);
+	IPv4Layer* icmpIPLayer = icmpPacket.getLayerOfType<IPv4Layer>();
+	PTF_ASSERT_NOT_NULL(icmpIPLayer);
+
+	FlowKey icmpKey;
+	PTF_ASSERT_TRUE(icmpKey.fromPacket(&icmpPacket));
+	PTF_ASSERT_EQUAL(icmpKey.getProtocol(), PACKETPP_IPPROTO_ICMP, u8);
+	PTF_ASSERT_EQUAL(icmpKey.getSrcIPv4Address(), icmpIPLayer->getSrcIpAddress(), object);
+	PTF_ASSERT_EQUAL(icmpKey.getDstIPv4Address(), icmpIPLayer->getDstIpAddress(), object);
+	PTF_ASSERT_EQUAL(icmpKey.getSrcPort(), 0, u16);
+	PTF_ASSERT_EQUAL(icmpKey.getDstPort(), 0, u16);
+	PTF_ASSERT_EQUAL(hash5Tuple(&icmpPacket), 0, u32);
+
+	// a non-first UDP fragment has no ports, so it has no 5-tuple hash
+	int fragBufferLength = 0;
+	uint8_t* fragBuffer = readFileIntoBuffer("PacketExamples/IPv4Frag2.dat", fragBufferLength);
+	PTF_ASSERT(!(fragBuffer == NULL), "cannot read file IPv4Frag2.dat");
+	RawPacket fragRawPacket((const uint8_t*)fragBuffer, fragBufferLength, time, true);
+	Packet fragPacket(&fragRawPacket);
+	PTF_ASSERT_EQUAL(hash5Tuple(&fragPacket), 0, u32);
+	PTF_ASSERT_TRUE(hash2Tuple(&fragPacket) != 0);
+
+	// GRE tunnel: the key is taken from the tunneled flow and the GRE key is the tunnel ID
+	IPv4Layer outerIPLayer(IPv4Address(std::string("192.168.1.1")), IPv4Address(std::string("192.168.1.2")));
+	GREv0Layer greLayer;
+	PTF_ASSERT_TRUE(greLayer.setKey(0xABCD));
+	IPv4Layer innerIPLayer(IPv4Address(std::string("172.16.0.1")), IPv4Address(std::string("172.16.0.2")));
+	UdpLayer innerUdpLayer(1111, 2222);
+	Packet grePacket(100);
+	PTF_ASSERT_TRUE(grePacket.addLayer(&outerIPLayer));
+	PTF_ASSERT_TRUE(grePacket.addLayer(&greLayer));
+	PTF_ASSERT_TRUE(grePacket.addLayer(&innerIPLayer));
+	PTF_ASSERT_TRUE(grePacket.addLayer(&innerUdpLayer));
+	grePacket.computeCalculateFields();
+
+	FlowKey greKey;
+	PTF_ASSERT_TRUE(greKey.fromPacket(&grePacket));
+	PTF_ASSERT_EQUAL(greKey.getSrcIPv4Address(), IPv4Address(std::string("172.16.0.1")), object);
+	PTF_ASSERT_EQUAL(greKey.getDstPort(), 2222, u16);
+	PTF_ASSERT_EQUAL(greKey.getTunnelId(), 0xABCD, u32);
+
+	// raw data extraction gives the same keys as the parsed packets, except for tunnels which aren't followed
+	FlowKey rawKey;
+	RawPacket* rawPacket = tcpPacket.getRawPacket();
+	PTF_ASSERT_TRUE(rawKey.fromRawData(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType()));
+	PTF_ASSERT_TRUE(tcpKey.fromPacket(&tcpPacket));
+	PTF_ASSERT_TRUE(rawKey == tcpKey);
+	rawPacket = udpPacket.getRawPacket();
+	PTF_ASSERT_TRUE(rawKey.fromRawData(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType()));
+	PTF_ASSERT_TRUE(rawKey == udpKey);
+	PTF_ASSERT_TRUE(rawKey.fromRawData(icmpRawPacket.getRawData(), icmpRawPacket.getRawDataLen(), icmpRawPacket.getLinkLayerType()));
+	PTF_ASSERT_TRUE(rawKey == icmpKey);
+	rawPacket = grePacket.getRawPacket();
+	PTF_ASSERT_TRUE(rawKey.fromRawData(rawPacket->getRawData(), rawPacket->getRawDataLen(), LINKTYPE_RAW));
+	PTF_ASSERT_TRUE(rawKey == FlowKey(IPv4Address(std::string("192.168.1.1")), IPv4Address(std::string("192.168.1.2")), PACKETPP_IPPROTO_GRE));
+	PTF_ASSERT_FALSE(rawKey.fromRawData(rawPacket->getRawData(), 10, LINKTYPE_RAW));
+	PTF_ASSERT_FALSE(rawKey.isValid());
+
+	// truncated frames are copied to buffers of their exact length, nothing past the end may be read. An Ethernet header whose
+	// EtherType is IPv4 but has no IPv4 header, and a VLAN tag cut in the middle, give no key
+	uint8_t* truncatedData = new uint8_t[14];
+	memcpy(truncatedData, tcpPacket.getRawPacket()->getRawData(), 14);
+	PTF_ASSERT_FALSE(rawKey.fromRawData(truncatedData, 14, LINKTYPE_ETHERNET));
+	delete [] truncatedData;
+	truncatedData = new uint8_t[16];
+	memcpy(truncatedData, udpPacket.getRawPacket()->getRawData(), 16);
+	PTF_ASSERT_FALSE(rawKey.fromRawData(truncatedData, 16, LINKTYPE_ETHERNET));
+	delete [] truncatedData;
+	// an IPv4 header length beyond the end of the data leaves the key without ports
+	truncatedData = new uint8_t[38];
+	memcpy(truncatedData, tcpPacket.getRawPacket()->getRawData(), 38);
+	truncatedData[14] = 0x4f;
+	PTF_ASSERT_TRUE(rawKey.fromRawData(truncatedData, 38, LINKTYPE_ETHERNET));
+	PTF_ASSERT_EQUAL(rawKey.getProtocol(), PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(rawKey.getSrcPort(), 0, u16);
+	delete [] truncatedData;
+
+	// the first fragment of a datagram has no ports, like the other fragments
+	ip4Layer.getIPv4Header()->fragmentOffset = htobe16(PCPP_IP_MORE_FRAGMENTS << 8);
+	Packet fragmentPacket(tcpPacket.getRawPacket());
+	PTF_ASSERT_TRUE(tcpKey.fromPacket(&fragmentPacket));
+	PTF_ASSERT_EQUAL(tcpKey.getSrcPort(), 0, u16);
+	PTF_ASSERT_EQUAL(tcpKey.getProtocol(), PACKETPP_IPPROTO_TCP, u8);
+	rawPacket = fragmentPacket.getRawPacket();
+	PTF_ASSERT_TRUE(rawKey.fromRawData(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType()));
+	PTF_ASSERT_TRUE(rawKey == tcpKey);
+
+	// the raw header walk fromRawData() shares with the other raw data parsers
+	RawPacketHeaders rawHeaders;
+	PTF_ASSERT_TRUE(parseRawPacketHeaders(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), rawHeaders));
+	PTF_ASSERT_TRUE(rawHeaders.isFragment);
+	PTF_ASSERT_EQUAL(rawHeaders.transportOffset, -1, int);
+	ip4Layer.getIPv4Header()->fragmentOffset = 0;
+	PTF_ASSERT_TRUE(parseRawPacketHeaders(rawPacket->getRawData(), rawPacket->getRawDataLen(), rawPacket->getLinkLayerType(), rawHeaders));
+	PTF_ASSERT_FALSE(rawHeaders.isFragment);
+	PTF_ASSERT_EQUAL(rawHeaders.etherType, PCPP_ETHERTYPE_IP, u16);
+	PTF_ASSERT_EQUAL(rawHeaders.transportProtocol, PACKETPP_IPPROTO_TCP, u8);
+	PTF_ASSERT_EQUAL(rawHeaders.transportOffset, (int)ip4Layer.getHeaderLen(), int);
+	PTF_ASSERT_TRUE(isVlanEtherType(0x9100));
+	PTF_ASSERT_FALSE(isVlanEtherType(PCPP_ETHERTYPE_IP));
+
+	// a packet without an IP layer has an empty key
+	EthLayer ethLayer3(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"), PCPP_ETHERTYPE_ARP);
+	ArpLayer arpLayer(ARP_REQUEST, MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress::Zero, IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("10.0.0.2")));
+	Packet arpPacket(100);
+	PTF_ASSERT_TRUE(arpPacket.addLayer(&ethLayer3));
+	PTF_ASSERT_TRUE(arpPacket.addLayer(&arpLayer));
+	FlowKey arpKey;
+	PTF_ASSERT_FALSE(arpKey.fromPacket(&arpPacket));
+	PTF_ASSERT_FALSE(arpKey.isValid());
+	PTF_ASSERT_TRUE(arpKey == FlowKey());
+	PTF_ASSERT_EQUAL(hash2Tuple(&arpPacket), 0, u32);
+} // FlowKeyTest
+
+
 static struct option PacketTestOptions[] =
 {
 	{"tags",  required_argument, 0, 't'},
@@ -8309,6 +8531,341 @@ void print_usage()
 }
 
 
+PTF_TEST_CASE(RuleClassifierTest)
+{
+	// priorities, prefixes, port ranges and protocols
+	RuleClassifier classifier;
+	ClassifierRule defaultRule(1, 0);
+	ClassifierRule subnetRule(2, 10);
+	PTF_ASSERT_TRUE(subnetRule.setDstIPv4(IPv4Address(std::string("10.1.2.3")), 16));
+	ClassifierRule httpRule(3, 20);
+	PTF_ASSERT_TRUE(httpRule.setDstIPv4(IPv4Address(std::string("10.1.0.0")), 16));
+	httpRule.setProtocol(PACKETPP_IPPROTO_TCP);
+	PTF_ASSERT_TRUE(httpRule.setDstPortRange(80, 80));
+	ClassifierRule highPortsRule(4, 20);
+	PTF_ASSERT_TRUE(highPortsRule.setSrcIPv4(IPv4Address(std::string("192.168.0.0")), 24));
+	PTF_ASSERT_TRUE(highPortsRule.setSrcPortRange(1024, 65535));
+	ClassifierRule ip6Rule(5, 5);
+	PTF_ASSERT_TRUE(ip6Rule.setSrcIPv6(IPv6Address(std::string("2001:db8::")), 32));
+	PTF_ASSERT_TRUE(classifier.addRule(defaultRule));
+	PTF_ASSERT_TRUE(classifier.addRule(subnetRule));
+	PTF_ASSERT_TRUE(classifier.addRule(httpRule));
+	PTF_ASSERT_TRUE(classifier.addRule(highPortsRule));
+	PTF_ASSERT_TRUE(classifier.addRule(ip6Rule));
+	PTF_ASSERT_EQUAL(classifier.getNumOfRules(), 5, size);
+	PTF_ASSERT_EQUAL(classifier.getNumOfTuples(), 5, size);
+
+	FlowKey httpKey(IPv4Address(std::string("192.168.0.7")), IPv4Address(std::string("10.1.200.1")), PACKETPP_IPPROTO_TCP, 5000, 80);
+	FlowKey sshKey(IPv4Address(std::string("172.16.0.7")), IPv4Address(std::string("10.1.200.1")), PACKETPP_IPPROTO_TCP, 5000, 22);
+	FlowKey udpKey(IPv4Address(std::string("172.16.0.7")), IPv4Address(std::string("10.2.0.1")), PACKETPP_IPPROTO_UDP, 53, 53);
+	FlowKey ip6Key(IPv6Address(std::string("2001:db8:1::1")), IPv6Address(std::string("2001:db9::1")), PACKETPP_IPPROTO_UDP, 53, 53);
+	FlowKey emptyKey;
+	const ClassifierRule* rule = classifier.classify(httpKey);
+	PTF_ASSERT_NOT_NULL(rule);
+	// httpRule and highPortsRule have the same priority, the one added first wins
+	PTF_ASSERT_EQUAL(rule->getRuleId(), 3, u32);
+	PTF_ASSERT_EQUAL(classifier.classify(sshKey)->getRuleId(), 2, u32);
+	PTF_ASSERT_EQUAL(classifier.classify(udpKey)->getRuleId(), 1, u32);
+	PTF_ASSERT_EQUAL(classifier.classify(ip6Key)->getRuleId(), 5, u32);
+	PTF_ASSERT_NULL(classifier.classify(emptyKey));
+
+	// incremental updates
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(classifier.addRule(ClassifierRule(3, 100)));
+	PTF_ASSERT_FALSE(ip6Rule.setDstIPv4(IPv4Address(std::string("10.0.0.0")), 8));
+	PTF_ASSERT_FALSE(subnetRule.setSrcIPv4(IPv4Address(std::string("10.0.0.0")), 33));
+	PTF_ASSERT_FALSE(subnetRule.setDstPortRange(100, 99));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(classifier.removeRule(3));
+	PTF_ASSERT_FALSE(classifier.removeRule(3));
+	PTF_ASSERT_NULL(classifier.getRule(3));
+	PTF_ASSERT_EQUAL(classifier.classify(httpKey)->getRuleId(), 4, u32);
+	PTF_ASSERT_TRUE(classifier.removeRule(1));
+	PTF_ASSERT_NULL(classifier.classify(udpKey));
+	PTF_ASSERT_EQUAL(classifier.getNumOfTuples(), 3, size);
+	ClassifierRule overrideRule(6, 50);
+	PTF_ASSERT_TRUE(classifier.addRule(overrideRule));
+	PTF_ASSERT_EQUAL(classifier.classify(httpKey)->getRuleId(), 6, u32);
+	PTF_ASSERT_EQUAL(classifier.classify(ip6Key)->getRuleId(), 6, u32);
+	classifier.clear();
+	PTF_ASSERT_EQUAL(classifier.getNumOfRules(), 0, size);
+	PTF_ASSERT_NULL(classifier.classify(httpKey));
+
+	// parsed packets
+	PTF_ASSERT_TRUE(classifier.addRule(httpRule));
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	IPv4Layer ip4Layer(IPv4Address(std::string("192.168.0.7")), IPv4Address(std::string("10.1.200.1")));
+	TcpLayer tcpLayer(5000, 80);
+	Packet tcpPacket(100);
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&ip4Layer));
+	PTF_ASSERT_TRUE(tcpPacket.addLayer(&tcpLayer));
+	tcpPacket.computeCalculateFields();
+	PTF_ASSERT_EQUAL(classifier.classify(&tcpPacket)->getRuleId(), 3, u32);
+	classifier.clear();
+
+	// random rule sets with updates: the classifier must pick the same rule as a linear search over the rules
+	srand(1);
+	std::vector<ClassifierRule> rules;
+	for (uint32_t ruleId = 0; ruleId < 2000; ruleId++)
+	{
+		ClassifierRule randomRule(ruleId, rand() % 50);
+		uint32_t srcAddress = htobe32(0x0a000000 | (rand() % 4) << 16 | (rand() % 4) << 8);
+		uint32_t dstAddress = htobe32(0xc0a80000 | (rand() % 4) << 8 | (rand() % 4));
+		if (rand() % 4 != 0)
+			randomRule.setSrcIPv4(IPv4Address(srcAddress), 8 + rand() % 17);
+		if (rand() % 4 != 0)
+			randomRule.setDstIPv4(IPv4Address(dstAddress), 16 + rand() % 17);
+		if (rand() % 2 == 0)
+			randomRule.setProtocol(rand() % 2 == 0 ? PACKETPP_IPPROTO_TCP : PACKETPP_IPPROTO_UDP);
+		if (rand() % 3 == 0)
+		{
+			uint16_t port = rand() % 100;
+			randomRule.setDstPortRange(port, rand() % 2 == 0 ? port : port + rand() % 50);
+		}
+		if (rand() % 5 == 0)
+			randomRule.setSrcPortRange(1024, 65535);
+		rules.push_back(randomRule);
+	}
+	PTF_ASSERT_EQUAL(classifier.addRules(rules), 2000, size);
+
+	std::vector<FlowKey> keys;
+	for (int i = 0; i < 3000; i++)
+	{
+		uint32_t srcAddress = htobe32(0x0a000000 | (rand() % 4) << 16 | (rand() % 4) << 8 | (rand() % 2));
+		uint32_t dstAddress = htobe32(0xc0a80000 | (rand() % 4) << 8 | (rand() % 4));
+		keys.push_back(FlowKey(IPv4Address(srcAddress), IPv4Address(dstAddress), rand() % 2 == 0 ? PACKETPP_IPPROTO_TCP : PACKETPP_IPPROTO_UDP,
+				1000 + rand() % 100, rand() % 150));
+	}
+
+	std::vector<const ClassifierRule*> batchResults(keys.size());
+	for (uint32_t round = 0; round < 3; round++)
+	{
+		size_t numOfMatched = classifier.classify(&keys[0], keys.size(), &batchResults[0]);
+		size_t expectedNumOfMatched = 0;
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			// the first rule with the highest priority, since rules were added in order
+			const ClassifierRule* expected = NULL;
+			for (std::vector<ClassifierRule>::const_iterator iter = rules.begin(); iter != rules.end(); iter++)
+			{
+				if (classifier.getRule(iter->getRuleId()) != NULL && iter->matchFlowKey(keys[i]) && (expected == NULL || iter->getPriority() > expected->getPriority()))
+					expected = &(*iter);
+			}
+
+			const ClassifierRule* result = classifier.classify(keys[i]);
+			PTF_ASSERT_TRUE(result == batchResults[i]);
+			if (expected == NULL)
+			{
+				PTF_ASSERT_NULL(result);
+				continue;
+			}
+
+			expectedNumOfMatched++;
+			PTF_ASSERT_NOT_NULL(result);
+			PTF_ASSERT_EQUAL(result->getRuleId(), expected->getRuleId(), u32);
+		}
+		PTF_ASSERT_EQUAL(numOfMatched, expectedNumOfMatched, size);
+
+		// remove a third of the rules and check again
+		for (uint32_t ruleId = round; ruleId < 2000; ruleId += 3)
+			PTF_ASSERT_TRUE(classifier.removeRule(ruleId));
+	}
+
+	PTF_ASSERT_EQUAL(classifier.getNumOfRules(), 0, size);
+	PTF_ASSERT_EQUAL(classifier.getNumOfTuples(), 0, size);
+}
+
+
+struct MultiPatternMatchCollector
+{
+	std::vector<PatternMatch> matches;
+};
+
+static void onMultiPatternMatch(const PatternMatch& match, void* userCookie)
+{
+	((MultiPatternMatchCollector*)userCookie)->matches.push_back(match);
+}
+
+// the occurrences of all the patterns found by comparing each pattern at each offset, in the order MultiPatternMatcher reports them
+static void findPatternsNaively(const std::vector<std::string>& patterns, const std::string& data, std::vector<PatternMatch>& matches)
+{
+	for (size_t end = 1; end <= data.size(); end++)
+	{
+		for (size_t len = end; len > 0; len--)
+		{
+			for (size_t id = 0; id < patterns.size(); id++)
+			{
+				if (patterns[id].size() == len && data.compare(end - len, len, patterns[id]) == 0)
+				{
+					PatternMatch match;
+					match.patternId = (uint32_t)id;
+					match.endOffset = end;
+					matches.push_back(match);
+				}
+			}
+		}
+	}
+}
+
+static bool compareMatches(const std::vector<PatternMatch>& first, const std::vector<PatternMatch>& second)
+{
+	if (first.size() != second.size())
+		return false;
+
+	for (size_t i = 0; i < first.size(); i++)
+	{
+		if (first[i].patternId != second[i].patternId || first[i].endOffset != second[i].endOffset)
+			return false;
+	}
+
+	return true;
+}
+
+PTF_TEST_CASE(MultiPatternMatcherTest)
+{
+	// overlapping patterns
+	MultiPatternMatcher matcher;
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("he")), 0, int);
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("she")), 1, int);
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("his")), 2, int);
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("hers")), 3, int);
+	PTF_ASSERT_FALSE(matcher.isCompiled());
+	PTF_ASSERT_TRUE(matcher.compile());
+	PTF_ASSERT_TRUE(matcher.isCompiled());
+	PTF_ASSERT_EQUAL(matcher.getNumOfPatterns(), 4, size);
+	PTF_ASSERT_EQUAL(matcher.getNumOfStates(), 10, size);
+	PTF_ASSERT_EQUAL(matcher.getPattern(3), "hers", string);
+
+	std::string text = "ushers and his hershey";
+	std::vector<PatternMatch> matches;
+	PTF_ASSERT_EQUAL(matcher.search((const uint8_t*)text.data(), text.size(), matches), 8, size);
+	std::vector<PatternMatch> expected;
+	std::vector<std::string> patterns;
+	patterns.push_back("he");
+	patterns.push_back("she");
+	patterns.push_back("his");
+	patterns.push_back("hers");
+	findPatternsNaively(patterns, text, expected);
+	PTF_ASSERT_TRUE(compareMatches(matches, expected));
+	// "she" and "he" end at the same offset, the longer pattern comes first
+	PTF_ASSERT_EQUAL(matches[0].patternId, 1, u32);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 0, u32);
+	PTF_ASSERT_EQUAL(matches[1].endOffset, 4, size);
+	PTF_ASSERT_TRUE(matcher.matchesAny((const uint8_t*)text.data(), text.size()));
+	PTF_ASSERT_FALSE(matcher.matchesAny((const uint8_t*)"ushrs", 5));
+
+	// patterns can't be changed after compile() until clear() is called
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("hi")), -1, int);
+	PTF_ASSERT_EQUAL(matcher.addPattern(std::string("")), -1, int);
+	matcher.clear();
+	PTF_ASSERT_FALSE(matcher.isCompiled());
+	PTF_ASSERT_FALSE(matcher.compile());
+	PTF_ASSERT_EQUAL(matcher.search((const uint8_t*)text.data(), text.size(), matches), 0, size);
+	LoggerPP::getInstance().enableErrors();
+
+	// binary patterns, escape sequences and case insensitive matching
+	std::string binaryPattern;
+	PTF_ASSERT_TRUE(MultiPatternMatcher::parsePattern("\\x00\\xffAB\\\\", binaryPattern));
+	PTF_ASSERT_EQUAL(binaryPattern.size(), 5, size);
+	PTF_ASSERT_EQUAL((uint8_t)binaryPattern[1], 0xff, u8);
+	PTF_ASSERT_EQUAL(binaryPattern[4], '\\', int);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(MultiPatternMatcher::parsePattern("ab\\x4", binaryPattern));
+	PTF_ASSERT_FALSE(MultiPatternMatcher::parsePattern("ab\\n", binaryPattern));
+	LoggerPP::getInstance().enableErrors();
+
+	MultiPatternMatcher binaryMatcher;
+	PTF_ASSERT_EQUAL(binaryMatcher.addPattern((const uint8_t*)"\x00\xff\x00", 3), 0, int);
+	PTF_ASSERT_EQUAL(binaryMatcher.addPattern((const uint8_t*)"\x00", 1), 1, int);
+	PTF_ASSERT_TRUE(binaryMatcher.compile());
+	uint8_t binaryData[] = { 0x01, 0x00, 0xff, 0x00, 0xff, 0x00 };
+	matches.clear();
+	PTF_ASSERT_EQUAL(binaryMatcher.search(binaryData, sizeof(binaryData), matches), 5, size);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 0, u32);
+	PTF_ASSERT_EQUAL(matches[1].endOffset, 4, size);
+
+	MultiPatternMatcher caseInsensitiveMatcher(true);
+	caseInsensitiveMatcher.addPattern(std::string("User-Agent"));
+	PTF_ASSERT_TRUE(caseInsensitiveMatcher.compile());
+	PTF_ASSERT_TRUE(caseInsensitiveMatcher.matchesAny((const uint8_t*)"\r\nUSER-agent: x", 15));
+	PTF_ASSERT_FALSE(caseInsensitiveMatcher.matchesAny((const uint8_t*)"\r\nUSER_agent: x", 15));
+
+	// a random set of patterns over a small alphabet, so they overlap a lot, compared with a naive search both on a single buffer and
+	// on the same buffer split into chunks of random sizes
+	srand(1);
+	MultiPatternMatcher randomMatcher;
+	patterns.clear();
+	for (int i = 0; i < 200; i++)
+	{
+		std::string pattern;
+		size_t len = 1 + rand() % 6;
+		for (size_t j = 0; j < len; j++)
+			pattern.push_back((char)('a' + rand() % 4));
+		patterns.push_back(pattern);
+		PTF_ASSERT_EQUAL(randomMatcher.addPattern(pattern), i, int);
+	}
+	PTF_ASSERT_TRUE(randomMatcher.compile());
+
+	std::string randomText;
+	for (int i = 0; i < 5000; i++)
+		randomText.push_back((char)('a' + rand() % 6));
+	expected.clear();
+	findPatternsNaively(patterns, randomText, expected);
+	matches.clear();
+	PTF_ASSERT_EQUAL(randomMatcher.search((const uint8_t*)randomText.data(), randomText.size(), matches), expected.size(), size);
+	PTF_ASSERT_TRUE(compareMatches(matches, expected));
+
+	MultiPatternMatchCollector collector;
+	MultiPatternMatcher::StreamState streamState;
+	size_t offset = 0;
+	while (offset < randomText.size())
+	{
+		size_t chunkLen = std::min<size_t>(rand() % 40, randomText.size() - offset);
+		randomMatcher.search(streamState, (const uint8_t*)randomText.data() + offset, chunkLen, onMultiPatternMatch, &collector);
+		offset += chunkLen;
+	}
+	PTF_ASSERT_EQUAL(streamState.offset, randomText.size(), size);
+	PTF_ASSERT_TRUE(compareMatches(collector.matches, expected));
+
+	// a pattern split between two chunks of a stream
+	collector.matches.clear();
+	streamState.reset();
+	PTF_ASSERT_EQUAL(randomMatcher.search(streamState, (const uint8_t*)"x", 1, onMultiPatternMatch, &collector), 0, size);
+	MultiPatternMatcher::StreamState splitState;
+	MultiPatternMatcher splitMatcher;
+	splitMatcher.addPattern(std::string("GET /index.html"));
+	PTF_ASSERT_TRUE(splitMatcher.compile());
+	PTF_ASSERT_EQUAL(splitMatcher.search(splitState, (const uint8_t*)"xxGET /ind", 10, onMultiPatternMatch, &collector), 0, size);
+	PTF_ASSERT_EQUAL(splitMatcher.search(splitState, (const uint8_t*)"ex.html", 7, onMultiPatternMatch, &collector), 1, size);
+	PTF_ASSERT_EQUAL(collector.matches[0].endOffset, 17, size);
+
+	// a layer payload
+	int bufferLength = 0;
+	uint8_t* buffer = readFileIntoBuffer("PacketExamples/TwoHttpRequests1.dat", bufferLength);
+	PTF_ASSERT_NOT_NULL(buffer);
+	timeval time;
+	gettimeofday(&time, NULL);
+	RawPacket rawPacket((const uint8_t*)buffer, bufferLength, time, true);
+	Packet httpPacket(&rawPacket);
+	TcpLayer* tcpLayer = httpPacket.getLayerOfType<TcpLayer>();
+	PTF_ASSERT_NOT_NULL(tcpLayer);
+
+	MultiPatternMatcher httpMatcher;
+	httpMatcher.addPattern(std::string("GET "));
+	httpMatcher.addPattern(std::string("HTTP/1.1\r\n"));
+	httpMatcher.addPattern(std::string("no such header"));
+	PTF_ASSERT_TRUE(httpMatcher.compile());
+	matches.clear();
+	PTF_ASSERT_EQUAL(httpMatcher.searchLayerPayload(*tcpLayer, matches), 2, size);
+	PTF_ASSERT_EQUAL(matches[0].patternId, 0, u32);
+	PTF_ASSERT_EQUAL(matches[0].endOffset, 4, size);
+	PTF_ASSERT_EQUAL(matches[1].patternId, 1, u32);
+	std::string payload((const char*)tcpLayer->getLayerPayload(), tcpLayer->getLayerPayloadSize());
+	PTF_ASSERT_EQUAL(matches[1].endOffset, payload.find("HTTP/1.1\r\n") + 10, size);
+}
+
 int main(int argc, char* argv[]) {
 
 	int optionIndex = 0;
@@ -8459,6 +9016,9 @@ int main(int argc, char* argv[]) {
 	PTF_RUN_TEST(BgpLayerParsingTest, "bgp");
 	PTF_RUN_TEST(BgpLayerCreationTest, "bgp");
 	PTF_RUN_TEST(BgpLayerEditTest, "bgp");
+	PTF_RUN_TEST(FlowKeyTest, "flow_key;packet");
+	PTF_RUN_TEST(RuleClassifierTest, "rule_classifier;packet");
+	PTF_RUN_TEST(MultiPatternMatcherTest, "multi_pattern_matcher;packet");
 
 	PTF_END_RUNNING_TESTS;
 }
@@ -3,11 +3,13 @@
 #include <sstream>
 #include <algorithm>
 #include <map>
+#include <set>
 #include <Logger.h>
 #include <IpAddress.h>
 #include <MacAddress.h>
 #include <Packet.h>
 #include <PacketUtils.h>
+#include <EthLayer.h>
 #include <IPv4Layer.h>
 #include <IPv6Layer.h>
 #include <TcpLayer.h>
@@ -32,6 +34,10 @@
 #include <string>
 #include <vector>
 #include <PcapFilter.h>
+#include <NativeFilter.h>
+#include <BpfJit.h>
+#include <CaptureIndex.h>
+#include <StatefulFilter.h>
 #include <PlatformSpecificUtils.h>
 #include <PcapPlusPlusVersion.h>
 #include <getopt.h>
@@ -39,10 +45,13 @@
 #include <SystemUtils.h>
 #include <DpdkDeviceList.h>
 #include <DpdkDevice.h>
+#include <DpdkPipeline.h>
+#include <DpdkTxContext.h>
 #include <KniDevice.h>
 #include <KniDeviceList.h>
 #include <NetworkUtils.h>
 #include <RawSocketDevice.h>
+#include <ToeplitzHash.h>
 #include "PcppTestFramework.h"
 #include <EndianPortable.h>
 #include <GeneralUtils.h>
@@ -86,6 +95,7 @@ struct PcapTestArgs
 	string remoteIp;
 	uint16_t remotePort;
 	int dpdkPort;
+	vector<string> dpdkEalArgs;
 	string kniIp;
 	char* errString;
 };
@@ -386,6 +396,30 @@ public:
 	bool threadRanAndStopped() { return m_RanAndStopped; }
 };
 
+class DpdkTestPipelineStage : public DpdkPipelineStage
+{
+public:
+	// forward only IPv4 packets so both the forward and the drop paths of the pipeline are used
+	uint16_t processPackets(MBufRawPacket** packets, uint16_t numOfPackets, uint32_t)
+	{
+		uint16_t packetsToForward = 0;
+		for (uint16_t i = 0; i < numOfPackets; i++)
+		{
+			Packet packet(packets[i]);
+			if (!packet.isPacketOfType(IPv4))
+				continue;
+
+			MBufRawPacket* temp = packets[packetsToForward];
+			packets[packetsToForward++] = packets[i];
+			packets[i] = temp;
+		}
+
+		return packetsToForward;
+	}
+
+	DpdkPipelineStage* clone() const { return new DpdkTestPipelineStage(); }
+};
+
 #ifdef LINUX
 struct KniRequestsCallbacksMock
 {
@@ -631,6 +665,66 @@ bool packetArrivesBlockingModeStartCapture(RawPacket* pRawPacket, PcapLiveDevice
 }
 
 
+void packetArrivesMaxRawDataLen(RawPacket* pRawPacket, PcapLiveDevice* pDevice, void* userCookie)
+{
+	int* maxRawDataLen = (int*)userCookie;
+	if (pRawPacket->getRawDataLen() > *maxRawDataLen)
+		*maxRawDataLen = pRawPacket->getRawDataLen();
+}
+
+struct BurstModePacketData
+{
+	int PacketCount;
+	int BurstCount;
+	uint32_t MaxBurstSize;
+	bool BurstSizeExceeded;
+	bool EmptyPacketFound;
+
+	BurstModePacketData(uint32_t maxBurstSize) : PacketCount(0), BurstCount(0), MaxBurstSize(maxBurstSize), BurstSizeExceeded(false), EmptyPacketFound(false) {}
+};
+
+void packetsArriveBurstMode(RawPacket* packets, uint32_t numOfPackets, PcapLiveDevice* dev, void* userCookie)
+{
+	BurstModePacketData* data = (BurstModePacketData*)userCookie;
+	data->BurstCount++;
+	data->PacketCount += numOfPackets;
+	if (numOfPackets > data->MaxBurstSize)
+		data->BurstSizeExceeded = true;
+	for (uint32_t i = 0; i < numOfPackets; i++)
+	{
+		if (packets[i].getRawDataLen() <= 0 || packets[i].getRawData() == NULL)
+			data->EmptyPacketFound = true;
+	}
+}
+
+#define NUM_OF_CAPTURE_WORKERS 4
+
+struct WorkersModePacketData
+{
+	int PacketCount[NUM_OF_CAPTURE_WORKERS];
+	std::set<uint32_t> FlowKeys[NUM_OF_CAPTURE_WORKERS];
+	bool InvalidWorkerId;
+
+	WorkersModePacketData() : InvalidWorkerId(false) { memset(PacketCount, 0, sizeof(PacketCount)); }
+};
+
+void packetArrivesWorkersMode(RawPacket* pRawPacket, uint8_t workerId, PcapLiveDevice* dev, void* userCookie)
+{
+	WorkersModePacketData* data = (WorkersModePacketData*)userCookie;
+	if (workerId >= NUM_OF_CAPTURE_WORKERS)
+	{
+		data->InvalidWorkerId = true;
+		return;
+	}
+
+	// each worker only touches its own counters so no locking is needed
+	data->PacketCount[workerId]++;
+	Packet packet(pRawPacket);
+	uint32_t flowKey = hash5Tuple(&packet);
+	if (flowKey != 0)
+		data->FlowKeys[workerId].insert(flowKey);
+}
+
 bool packetArrivesBlockingModeStopCapture(RawPacket* pRawPacket, PcapLiveDevice* dev, void* userCookie)
 {
 	// shouldn't do anything
@@ -1391,6 +1485,703 @@ PTF_TEST_CASE(TestPcapNgFileReadWriteAdv)
 	writerDev2.close();
 }
 
+PTF_TEST_CASE(TestPcapFileReaderSampling)
+{
+	// read all packets once without sampling and calculate the expected results
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacket rawPacket;
+	int totalPackets = 0;
+	int expectedFlowSampled = 0;
+	int nonIPPackets = 0;
+	const uint32_t sampleRate = 10;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		totalPackets++;
+		uint32_t hash = 0;
+		if (PacketSampler::calculateFlowHash(rawPacket.getRawData(), rawPacket.getRawDataLen(), rawPacket.getLinkLayerType(), 1234, hash))
+		{
+			if (hash < 0xFFFFFFFF / sampleRate)
+				expectedFlowSampled++;
+		}
+		else if (++nonIPPackets % sampleRate == 0)
+			expectedFlowSampled++;
+	}
+	readerDev.close();
+	PTF_ASSERT_TRUE(totalPackets > 0);
+
+	// 1-in-N sampling
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setPacketSampler(PacketSampler(PacketSampler::CountSampling, sampleRate));
+	int packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	PTF_ASSERT_EQUAL(packetCount, totalPackets / (int)sampleRate, int);
+	PTF_ASSERT_TRUE(readerDev.getPacketSampler().getNumOfPacketsSeen() == (uint64_t)totalPackets);
+	PTF_ASSERT_TRUE(readerDev.getPacketSampler().getNumOfPacketsSampled() == (uint64_t)packetCount);
+	PTF_ASSERT_EQUAL(readerDev.getPacketSampler().getSampleRate(), sampleRate, u32);
+	readerDev.close();
+
+	// probabilistic sampling
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setPacketSampler(PacketSampler(PacketSampler::RandomSampling, sampleRate, 1));
+	packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	PTF_ASSERT(packetCount > totalPackets / (int)sampleRate / 2 && packetCount < totalPackets / (int)sampleRate * 2,
+			"Random sampling selected %d packets out of %d", packetCount, totalPackets);
+	readerDev.close();
+
+	// flow hash sampling
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setPacketSampler(PacketSampler(PacketSampler::FlowHashSampling, sampleRate, 1234));
+	packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	PTF_ASSERT_EQUAL(packetCount, expectedFlowSampled, int);
+	readerDev.close();
+
+	// sampling in pcapng reader
+	PcapNgFileReaderDevice readerNgDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT_TRUE(readerNgDev.open());
+	int totalPcapNgPackets = 0;
+	while (readerNgDev.getNextPacket(rawPacket))
+		totalPcapNgPackets++;
+	readerNgDev.close();
+	PTF_ASSERT_TRUE(readerNgDev.open());
+	readerNgDev.setPacketSampler(PacketSampler(PacketSampler::CountSampling, 2));
+	packetCount = 0;
+	while (readerNgDev.getNextPacket(rawPacket))
+		packetCount++;
+	PTF_ASSERT_EQUAL(packetCount, totalPcapNgPackets / 2, int);
+	readerNgDev.close();
+
+	// flow hash is symmetric
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("20.0.0.2")));
+	TcpLayer tcpLayer(12345, 80);
+	Packet clientToServer(100);
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&ipLayer));
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&tcpLayer));
+	clientToServer.computeCalculateFields();
+
+	EthLayer ethLayer2(MacAddress("11:22:33:44:55:66"), MacAddress("aa:bb:cc:dd:ee:ff"));
+	IPv4Layer ipLayer2(IPv4Address(std::string("20.0.0.2")), IPv4Address(std::string("10.0.0.1")));
+	TcpLayer tcpLayer2(80, 12345);
+	Packet serverToClient(100);
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&ethLayer2));
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&ipLayer2));
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&tcpLayer2));
+	serverToClient.computeCalculateFields();
+
+	uint32_t hash1 = 0, hash2 = 0;
+	PTF_ASSERT_TRUE(PacketSampler::calculateFlowHash(clientToServer.getRawPacket()->getRawData(), clientToServer.getRawPacket()->getRawDataLen(), LINKTYPE_ETHERNET, 7, hash1));
+	PTF_ASSERT_TRUE(PacketSampler::calculateFlowHash(serverToClient.getRawPacket()->getRawData(), serverToClient.getRawPacket()->getRawDataLen(), LINKTYPE_ETHERNET, 7, hash2));
+	PTF_ASSERT_EQUAL(hash1, hash2, u32);
+}
+
+
+
+struct StatefulFilterClassifierData
+{
+	int numOfCalls;
+	uint32_t acceptAtIndex;
+};
+
+static StatefulFilter::Verdict statefulFilterClassifier(RawPacket& rawPacket, uint32_t packetIndexInFlow, void* userCookie)
+{
+	StatefulFilterClassifierData* data = (StatefulFilterClassifierData*)userCookie;
+	data->numOfCalls++;
+	return (packetIndexInFlow >= data->acceptAtIndex ? StatefulFilter::Accept : StatefulFilter::Undecided);
+}
+
+PTF_TEST_CASE(TestPcapFileReaderStatefulFilter)
+{
+	// read all packets once and find the flows whose first packet is sent to port 80
+	PortFilter portFilter(80, DST);
+	NativeFilter nativeFilter;
+	PTF_ASSERT_TRUE(nativeFilter.compile(portFilter));
+
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacket rawPacket;
+	std::map<FlowKey, bool> flowVerdicts;
+	int totalPackets = 0;
+	int matchingPackets = 0;
+	int expectedPackets = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		totalPackets++;
+		bool matches = nativeFilter.matchPacket(&rawPacket);
+		if (matches)
+			matchingPackets++;
+
+		FlowKey key;
+		if (!key.fromRawData(rawPacket.getRawData(), rawPacket.getRawDataLen(), rawPacket.getLinkLayerType()))
+		{
+			if (matches)
+				expectedPackets++;
+			continue;
+		}
+
+		key.makeCanonical();
+		std::map<FlowKey, bool>::iterator iter = flowVerdicts.find(key);
+		if (iter == flowVerdicts.end())
+			iter = flowVerdicts.insert(std::pair<FlowKey, bool>(key, matches)).first;
+		if (iter->second)
+			expectedPackets++;
+	}
+	readerDev.close();
+	PTF_ASSERT_TRUE(matchingPackets > 0);
+	PTF_ASSERT_TRUE(expectedPackets > matchingPackets);
+	PTF_ASSERT_TRUE(expectedPackets < totalPackets);
+
+	// all packets of the accepted flows pass, in both directions
+	StatefulFilter statefulFilter(flowVerdicts.size(), 0);
+	PTF_ASSERT_TRUE(statefulFilter.setFlowFilter(portFilter));
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setStatefulFilter(&statefulFilter);
+	PTF_ASSERT_TRUE(readerDev.getStatefulFilter() == &statefulFilter);
+	int packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	readerDev.close();
+	PTF_ASSERT_EQUAL(packetCount, expectedPackets, int);
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfPacketsSeen() == (uint64_t)totalPackets);
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfPacketsPassed() == (uint64_t)packetCount);
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfFlows() == flowVerdicts.size());
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfAcceptedFlows() + statefulFilter.getNumOfRejectedFlows() == flowVerdicts.size());
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfEvictedFlows() == 0);
+
+	// the same flows are accepted when the filter is given as a BPF string
+	std::string filterAsString;
+	portFilter.parseToString(filterAsString);
+	PTF_ASSERT_TRUE(statefulFilter.setFlowFilter(filterAsString));
+	PTF_ASSERT_TRUE(statefulFilter.getNumOfFlows() == 0);
+	PTF_ASSERT_TRUE(readerDev.open());
+	packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	readerDev.close();
+	PTF_ASSERT_EQUAL(packetCount, expectedPackets, int);
+
+	// a table smaller than the number of flows evicts the least recently seen flows
+	StatefulFilter smallFilter(2, 0);
+	PTF_ASSERT_TRUE(smallFilter.setFlowFilter(portFilter));
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setStatefulFilter(&smallFilter);
+	while (readerDev.getNextPacket(rawPacket))
+		;
+	readerDev.close();
+	readerDev.setStatefulFilter(NULL);
+	PTF_ASSERT_TRUE(smallFilter.getNumOfFlows() == 2);
+	PTF_ASSERT_TRUE(smallFilter.getNumOfEvictedFlows() > 0);
+
+	// a table for a billion flows allocates memory only for the flows it holds and gives the same result
+	StatefulFilter largeFilter((size_t)1 << 30, 0);
+	PTF_ASSERT_TRUE(largeFilter.setFlowFilter(portFilter));
+	PTF_ASSERT_TRUE(readerDev.open());
+	readerDev.setStatefulFilter(&largeFilter);
+	packetCount = 0;
+	while (readerDev.getNextPacket(rawPacket))
+		packetCount++;
+	readerDev.close();
+	readerDev.setStatefulFilter(NULL);
+	PTF_ASSERT_EQUAL(packetCount, expectedPackets, int);
+	PTF_ASSERT_TRUE(largeFilter.getNumOfFlows() == flowVerdicts.size());
+
+	// a classifier that accepts flows on their second packet, with a 10 seconds idle timeout
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("20.0.0.2")));
+	TcpLayer tcpLayer(12345, 80);
+	Packet clientToServer(100);
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&ipLayer));
+	PTF_ASSERT_TRUE(clientToServer.addLayer(&tcpLayer));
+	clientToServer.computeCalculateFields();
+
+	EthLayer ethLayer2(MacAddress("11:22:33:44:55:66"), MacAddress("aa:bb:cc:dd:ee:ff"));
+	IPv4Layer ipLayer2(IPv4Address(std::string("20.0.0.2")), IPv4Address(std::string("10.0.0.1")));
+	TcpLayer tcpLayer2(80, 12345);
+	Packet serverToClient(100);
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&ethLayer2));
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&ipLayer2));
+	PTF_ASSERT_TRUE(serverToClient.addLayer(&tcpLayer2));
+	serverToClient.computeCalculateFields();
+
+	const uint8_t* clientData = clientToServer.getRawPacket()->getRawData();
+	int clientDataLen = clientToServer.getRawPacket()->getRawDataLen();
+	const uint8_t* serverData = serverToClient.getRawPacket()->getRawData();
+	int serverDataLen = serverToClient.getRawPacket()->getRawDataLen();
+
+	StatefulFilter timedFilter(16, 10);
+	StatefulFilterClassifierData classifierData = { 0, 1 };
+	timedFilter.setFlowClassifier(statefulFilterClassifier, &classifierData);
+	timespec timestamp = { 100, 0 };
+	PTF_ASSERT_FALSE(timedFilter.matchPacket(clientData, clientDataLen, LINKTYPE_ETHERNET, timestamp));
+	timestamp.tv_sec = 105;
+	PTF_ASSERT_TRUE(timedFilter.matchPacket(serverData, serverDataLen, LINKTYPE_ETHERNET, timestamp));
+	timestamp.tv_sec = 110;
+	PTF_ASSERT_TRUE(timedFilter.matchPacket(clientData, clientDataLen, LINKTYPE_ETHERNET, timestamp));
+	PTF_ASSERT_EQUAL(classifierData.numOfCalls, 2, int);
+	PTF_ASSERT_TRUE(timedFilter.getNumOfFlows() == 1);
+	PTF_ASSERT_TRUE(timedFilter.getNumOfAcceptedFlows() == 1);
+
+	// a packet that is out of order doesn't move the time the flow was last seen back
+	timestamp.tv_sec = 104;
+	PTF_ASSERT_TRUE(timedFilter.matchPacket(serverData, serverDataLen, LINKTYPE_ETHERNET, timestamp));
+	PTF_ASSERT_TRUE(timedFilter.getNumOfExpiredFlows() == 0);
+
+	// after the idle timeout the flow is decided again
+	timestamp.tv_sec = 121;
+	PTF_ASSERT_FALSE(timedFilter.matchPacket(serverData, serverDataLen, LINKTYPE_ETHERNET, timestamp));
+	PTF_ASSERT_TRUE(timedFilter.getNumOfExpiredFlows() == 1);
+	PTF_ASSERT_EQUAL(classifierData.numOfCalls, 3, int);
+
+	// packets of undecided flows pass if requested
+	timedFilter.setPassUndecided(true);
+	timestamp.tv_sec = 200;
+	PTF_ASSERT_TRUE(timedFilter.matchPacket(clientData, clientDataLen, LINKTYPE_ETHERNET, timestamp));
+	PTF_ASSERT_TRUE(timedFilter.getNumOfExpiredFlows() == 2);
+	PTF_ASSERT_TRUE(timedFilter.getNumOfAcceptedFlows() == 1);
+
+	// filters that can't be compiled are rejected and the classifier is kept
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(timedFilter.setFlowFilter(BPFStringFilter("tcp")));
+	PTF_ASSERT_FALSE(timedFilter.setFlowFilter(std::string("invalid filter")));
+	LoggerPP::getInstance().enableErrors();
+	timestamp.tv_sec = 201;
+	PTF_ASSERT_TRUE(timedFilter.matchPacket(serverData, serverDataLen, LINKTYPE_ETHERNET, timestamp));
+	PTF_ASSERT_TRUE(timedFilter.getNumOfAcceptedFlows() == 2);
+}
+
+
+
+PTF_TEST_CASE(TestPcapFileIndex)
+{
+	// collect the addresses, ports and time range of the file
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacket rawPacket;
+	std::set<std::string> addresses;
+	std::set<uint16_t> ports;
+	uint64_t packetCount = 0;
+	timespec startTime = { 0, 0 }, endTime = { 0, 0 };
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		timespec timestamp = rawPacket.getPacketTimeStamp();
+		if (packetCount == 0 || timestamp.tv_sec < startTime.tv_sec || (timestamp.tv_sec == startTime.tv_sec && timestamp.tv_nsec < startTime.tv_nsec))
+			startTime = timestamp;
+		if (packetCount == 0 || timestamp.tv_sec > endTime.tv_sec || (timestamp.tv_sec == endTime.tv_sec && timestamp.tv_nsec > endTime.tv_nsec))
+			endTime = timestamp;
+		packetCount++;
+
+		Packet packet(&rawPacket);
+		IPv4Layer* ipv4Layer = packet.getLayerOfType<IPv4Layer>();
+		if (ipv4Layer != NULL)
+		{
+			addresses.insert(ipv4Layer->getSrcIpAddress().toString());
+			addresses.insert(ipv4Layer->getDstIpAddress().toString());
+		}
+		TcpLayer* tcpLayer = packet.getLayerOfType<TcpLayer>();
+		if (tcpLayer != NULL)
+		{
+			ports.insert(be16toh(tcpLayer->getTcpHeader()->portSrc));
+			ports.insert(be16toh(tcpLayer->getTcpHeader()->portDst));
+		}
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		if (udpLayer != NULL)
+		{
+			ports.insert(be16toh(udpLayer->getUdpHeader()->portSrc));
+			ports.insert(be16toh(udpLayer->getUdpHeader()->portDst));
+		}
+	}
+	readerDev.close();
+	PTF_ASSERT_FALSE(addresses.empty());
+	PTF_ASSERT_FALSE(ports.empty());
+
+	CaptureIndex index;
+	PTF_ASSERT_TRUE(index.build(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_TRUE(index.getPacketCount() == packetCount);
+	PTF_ASSERT_TRUE(index.getStartTime().tv_sec == startTime.tv_sec && index.getStartTime().tv_nsec == startTime.tv_nsec);
+	PTF_ASSERT_TRUE(index.getEndTime().tv_sec == endTime.tv_sec && index.getEndTime().tv_nsec == endTime.tv_nsec);
+	PTF_ASSERT_TRUE(index.isUpToDate(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_FALSE(index.isUpToDate(EXAMPLE2_PCAP_PATH));
+
+	// write the index and read it back, both copies must give the same answers
+	std::string indexFileName = CaptureIndex::getIndexFileName(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(index.writeToFile(indexFileName));
+	CaptureIndex indexFromFile;
+	PTF_ASSERT_TRUE(indexFromFile.readFromFile(indexFileName));
+	PTF_ASSERT_TRUE(indexFromFile.getPacketCount() == packetCount);
+	PTF_ASSERT_TRUE(indexFromFile.isUpToDate(EXAMPLE_PCAP_PATH));
+
+	// the index never misses an address or a port of the file
+	CaptureIndexQuery emptyQuery;
+	PTF_ASSERT_TRUE(emptyQuery.isEmpty());
+	PTF_ASSERT_TRUE(index.mayMatch(emptyQuery));
+	for (std::set<std::string>::iterator iter = addresses.begin(); iter != addresses.end(); iter++)
+	{
+		CaptureIndexQuery query;
+		query.addAddress(IPv4Address(*iter));
+		PTF_ASSERT(index.mayMatch(query), "Index misses address %s", iter->c_str());
+		PTF_ASSERT(indexFromFile.mayMatch(query), "Index read from file misses address %s", iter->c_str());
+	}
+	for (std::set<uint16_t>::iterator iter = ports.begin(); iter != ports.end(); iter++)
+	{
+		CaptureIndexQuery query;
+		query.addPort(*iter);
+		query.addAddress(IPv4Address(*addresses.begin()));
+		PTF_ASSERT(index.mayMatch(query), "Index misses port %d", (int)*iter);
+		PTF_ASSERT(indexFromFile.mayMatch(query), "Index read from file misses port %d", (int)*iter);
+	}
+
+	// and rarely reports addresses that aren't in the file
+	int falsePositives = 0;
+	int numOfAbsentAddresses = 0;
+	for (uint32_t i = 1; i <= 2000; i++)
+	{
+		IPv4Address address(htobe32(0xc6120000 + i)); // 198.18.0.0/15 isn't used in the file
+		if (addresses.find(address.toString()) != addresses.end())
+			continue;
+
+		numOfAbsentAddresses++;
+		CaptureIndexQuery query;
+		query.addAddress(address);
+		if (index.mayMatch(query))
+			falsePositives++;
+	}
+	PTF_ASSERT(falsePositives < numOfAbsentAddresses / 20, "Too many false positives: %d out of %d", falsePositives, numOfAbsentAddresses);
+
+	// time ranges
+	CaptureIndexQuery timeQuery;
+	timespec rangeStart = { endTime.tv_sec + 1, 0 }, rangeEnd = { endTime.tv_sec + 100, 0 };
+	timeQuery.setTimeRange(rangeStart, rangeEnd);
+	PTF_ASSERT_FALSE(index.mayMatch(timeQuery));
+	rangeStart.tv_sec = startTime.tv_sec - 100;
+	rangeEnd = startTime;
+	timeQuery.setTimeRange(rangeStart, rangeEnd);
+	PTF_ASSERT_TRUE(index.mayMatch(timeQuery));
+	PTF_ASSERT_TRUE(indexFromFile.mayMatch(timeQuery));
+
+	// IPv6 addresses and pcap-ng files
+	CaptureIndex ipv6Index;
+	PTF_ASSERT_TRUE(ipv6Index.build(EXAMPLE_PCAPNG_PATH));
+	PTF_ASSERT_TRUE(ipv6Index.getPacketCount() > 0);
+	PcapNgFileReaderDevice readerNgDev(EXAMPLE_PCAPNG_PATH);
+	PTF_ASSERT_TRUE(readerNgDev.open());
+	while (readerNgDev.getNextPacket(rawPacket))
+	{
+		Packet packet(&rawPacket);
+		IPv6Layer* ipv6Layer = packet.getLayerOfType<IPv6Layer>();
+		if (ipv6Layer == NULL)
+			continue;
+
+		CaptureIndexQuery query;
+		query.addAddress(ipv6Layer->getSrcIpAddress());
+		query.addAddress(ipv6Layer->getDstIpAddress());
+		PTF_ASSERT_TRUE(ipv6Index.mayMatch(query));
+	}
+	readerNgDev.close();
+
+	// Packet++ doesn't parse the UDP header of IPv4 fragments, so the ports of first fragments are read from the IPv4 payload. Only
+	// the fragments of ip4_fragments.pcap are indexed, so the ports can't come from its unfragmented packets
+	PcapFileReaderDevice fragmentsReaderDev("PcapExamples/ip4_fragments.pcap");
+	PcapFileWriterDevice fragmentsWriterDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(fragmentsReaderDev.open());
+	PTF_ASSERT_TRUE(fragmentsWriterDev.open());
+	int numOfFirstFragments = 0;
+	while (fragmentsReaderDev.getNextPacket(rawPacket))
+	{
+		Packet packet(&rawPacket);
+		IPv4Layer* ipv4Layer = packet.getLayerOfType<IPv4Layer>();
+		if (ipv4Layer == NULL || !ipv4Layer->isFragment())
+			continue;
+
+		PTF_ASSERT_NULL(packet.getLayerOfType<UdpLayer>());
+		PTF_ASSERT_TRUE(fragmentsWriterDev.writePacket(rawPacket));
+		if (ipv4Layer->isFirstFragment())
+			numOfFirstFragments++;
+	}
+	fragmentsReaderDev.close();
+	fragmentsWriterDev.close();
+	PTF_ASSERT_TRUE(numOfFirstFragments > 0);
+
+	CaptureIndex fragmentsIndex;
+	PTF_ASSERT_TRUE(fragmentsIndex.build(EXAMPLE_PCAP_WRITE_PATH));
+	// the first fragments are NFS over UDP, from port 789 to port 2049
+	CaptureIndexQuery fragmentPortQuery;
+	fragmentPortQuery.addPort(789);
+	PTF_ASSERT_TRUE(fragmentsIndex.mayMatch(fragmentPortQuery));
+	CaptureIndexQuery fragmentFlowQuery;
+	fragmentFlowQuery.addFlow(IPv4Address(std::string("10.118.213.212")), 789, IPv4Address(std::string("10.118.213.211")), 2049);
+	PTF_ASSERT_TRUE(fragmentsIndex.mayMatch(fragmentFlowQuery));
+
+	// invalid index files
+	LoggerPP::getInstance().supressErrors();
+	CaptureIndex invalidIndex;
+	PTF_ASSERT_FALSE(invalidIndex.readFromFile(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_FALSE(invalidIndex.readFromFile("PcapExamples/no_such_file.pcppidx"));
+	PTF_ASSERT_FALSE(invalidIndex.build("PcapExamples/no_such_file.pcap"));
+	LoggerPP::getInstance().enableErrors();
+
+	remove(indexFileName.c_str());
+}
+
+
+
+PTF_TEST_CASE(TestPcapFileIndexChunks)
+{
+	// small chunks so the file has several of them
+	const uint64_t chunkSize = 64 * 1024;
+	CaptureIndex index(chunkSize);
+	PTF_ASSERT_TRUE(index.build(EXAMPLE_PCAP_PATH));
+	PTF_ASSERT_TRUE(index.getNumOfChunks() > 1);
+	PTF_ASSERT_TRUE(index.getChunkSize() == chunkSize);
+
+	// the chunks cover the whole file, in order and without gaps
+	std::ifstream captureFile(EXAMPLE_PCAP_PATH, std::ifstream::ate | std::ifstream::binary);
+	uint64_t captureFileSize = (uint64_t)captureFile.tellg();
+	uint64_t nextPacketIndex = 0, nextFileOffset = 24, byteCount = 0;
+	for (size_t i = 0; i < index.getNumOfChunks(); i++)
+	{
+		const CaptureIndexSummary& chunk = index.getChunk(i);
+		PTF_ASSERT_TRUE(chunk.getFirstPacketIndex() == nextPacketIndex);
+		PTF_ASSERT_TRUE(chunk.getFileOffset() == nextFileOffset);
+		PTF_ASSERT_TRUE(chunk.getPacketCount() > 0);
+		PTF_ASSERT_TRUE(i == index.getNumOfChunks() - 1 || chunk.getByteCount() >= chunkSize);
+		nextPacketIndex += chunk.getPacketCount();
+		nextFileOffset += chunk.getPacketCount() * 16 + chunk.getByteCount();
+		byteCount += chunk.getByteCount();
+	}
+	PTF_ASSERT_TRUE(nextPacketIndex == index.getPacketCount());
+	PTF_ASSERT_TRUE(nextFileOffset == captureFileSize);
+	PTF_ASSERT_TRUE(byteCount == index.getByteCount());
+
+	// every packet is found by its flow in its own chunk, and the protocol mix matches the packets
+	PcapFileReaderDevice readerDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(readerDev.open());
+	RawPacket rawPacket;
+	uint64_t packetIndex = 0, tcpPacketCount = 0, ipv4PacketCount = 0, flowsChecked = 0;
+	size_t chunkIndex = 0;
+	while (readerDev.getNextPacket(rawPacket))
+	{
+		const CaptureIndexSummary& chunk = index.getChunk(chunkIndex);
+		if (packetIndex == chunk.getFirstPacketIndex() + chunk.getPacketCount())
+			chunkIndex++;
+
+		Packet packet(&rawPacket);
+		if (packet.isPacketOfType(TCP))
+			tcpPacketCount++;
+		if (packet.isPacketOfType(IPv4))
+			ipv4PacketCount++;
+
+		IPv4Layer* ipv4Layer = packet.getLayerOfType<IPv4Layer>();
+		TcpLayer* tcpLayer = packet.getLayerOfType<TcpLayer>();
+		if (ipv4Layer != NULL && tcpLayer != NULL && packetIndex % 10 == 0)
+		{
+			// the reverse direction of the flow
+			CaptureIndexQuery query;
+			query.addFlow(ipv4Layer->getDstIpAddress(), be16toh(tcpLayer->getTcpHeader()->portDst),
+					ipv4Layer->getSrcIpAddress(), be16toh(tcpLayer->getTcpHeader()->portSrc));
+			query.addProtocol(TCP);
+			std::vector<const CaptureIndexSummary*> chunks;
+			PTF_ASSERT_TRUE(index.getMatchingChunks(query, chunks) > 0);
+			PTF_ASSERT_TRUE(std::find(chunks.begin(), chunks.end(), &index.getChunk(chunkIndex)) != chunks.end());
+			flowsChecked++;
+		}
+
+		packetIndex++;
+	}
+	readerDev.close();
+	PTF_ASSERT_TRUE(flowsChecked > 0);
+	PTF_ASSERT_TRUE(index.getProtocolPacketCount(TCP) == tcpPacketCount);
+	PTF_ASSERT_TRUE(index.getProtocolPacketCount(IPv4) == ipv4PacketCount);
+	PTF_ASSERT_TRUE(index.getProtocolPacketCount(TCP | UDP) >= tcpPacketCount);
+
+	// a flow that isn't in the file is found in few chunks at most, and a protocol that isn't in the file in none
+	CaptureIndexQuery absentQuery;
+	absentQuery.addFlow(IPv4Address(std::string("198.18.0.1")), 1234, IPv4Address(std::string("198.18.0.2")), 80);
+	std::vector<const CaptureIndexSummary*> absentChunks;
+	index.getMatchingChunks(absentQuery, absentChunks);
+	PTF_ASSERT_TRUE(absentChunks.size() < index.getNumOfChunks());
+	CaptureIndexQuery mixedVersionsQuery;
+	mixedVersionsQuery.addFlow(IPv4Address(std::string("198.18.0.1")), 1234, IPv6Address(std::string("2001:db8::1")), 80);
+	PTF_ASSERT_FALSE(index.mayMatch(mixedVersionsQuery));
+	if (index.getProtocolPacketCount(SSL) == 0)
+	{
+		CaptureIndexQuery protocolQuery;
+		protocolQuery.addProtocol(SSL);
+		PTF_ASSERT_FALSE(index.mayMatch(protocolQuery));
+	}
+
+	// the chunks are kept in the index file
+	std::string indexFileName = CaptureIndex::getIndexFileName(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(index.writeToFile(indexFileName));
+	CaptureIndex indexFromFile;
+	PTF_ASSERT_TRUE(indexFromFile.readFromFile(indexFileName));
+	PTF_ASSERT_TRUE(indexFromFile.getNumOfChunks() == index.getNumOfChunks());
+	PTF_ASSERT_TRUE(indexFromFile.getChunkSize() == chunkSize);
+	PTF_ASSERT_TRUE(indexFromFile.getProtocolPacketCount(TCP) == tcpPacketCount);
+	for (size_t i = 0; i < index.getNumOfChunks(); i++)
+	{
+		PTF_ASSERT_TRUE(indexFromFile.getChunk(i).getFileOffset() == index.getChunk(i).getFileOffset());
+		PTF_ASSERT_TRUE(indexFromFile.getChunk(i).getProtocols() == index.getChunk(i).getProtocols());
+	}
+	remove(indexFileName.c_str());
+
+	// pcap-ng blocks have a variable length so their offsets aren't known
+	CaptureIndex pcapngIndex;
+	PTF_ASSERT_TRUE(pcapngIndex.build(EXAMPLE_PCAPNG_PATH));
+	PTF_ASSERT_TRUE(pcapngIndex.getNumOfChunks() == 1);
+	PTF_ASSERT_TRUE(pcapngIndex.getChunk(0).getFileOffset() == CaptureIndexSummary::UnknownFileOffset);
+
+	// an index built while writing the file is the same as an index built from the written file
+	PcapFileWriterDevice writerDev(EXAMPLE_PCAP_WRITE_PATH);
+	PTF_ASSERT_TRUE(writerDev.setIndexEnabled(true, chunkSize));
+	PTF_ASSERT_TRUE(writerDev.open());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(writerDev.setIndexEnabled(false));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(readerDev.open());
+	while (readerDev.getNextPacket(rawPacket))
+		writerDev.writePacket(rawPacket);
+	readerDev.close();
+	writerDev.close();
+
+	PTF_ASSERT_NOT_NULL(writerDev.getIndex());
+	CaptureIndex writtenFileIndex(chunkSize);
+	PTF_ASSERT_TRUE(writtenFileIndex.build(EXAMPLE_PCAP_WRITE_PATH));
+	PTF_ASSERT_TRUE(writerDev.getIndex()->getPacketCount() == writtenFileIndex.getPacketCount());
+	PTF_ASSERT_TRUE(writerDev.getIndex()->getNumOfChunks() == writtenFileIndex.getNumOfChunks());
+	for (size_t i = 0; i < writtenFileIndex.getNumOfChunks(); i++)
+		PTF_ASSERT_TRUE(writerDev.getIndex()->getChunk(i).getFileOffset() == writtenFileIndex.getChunk(i).getFileOffset());
+	PTF_ASSERT_TRUE(indexFromFile.readFromFile(indexFileName));
+	PTF_ASSERT_TRUE(indexFromFile.isUpToDate(EXAMPLE_PCAP_WRITE_PATH));
+
+	// in append mode the index covers the packets that were already in the file
+	PTF_ASSERT_TRUE(writerDev.open(true));
+	PTF_ASSERT_TRUE(readerDev.open());
+	for (int i = 0; i < 10 && readerDev.getNextPacket(rawPacket); i++)
+		writerDev.writePacket(rawPacket);
+	readerDev.close();
+	writerDev.close();
+	PTF_ASSERT_TRUE(writerDev.getIndex()->getPacketCount() == writtenFileIndex.getPacketCount() + 10);
+	PTF_ASSERT_TRUE(indexFromFile.readFromFile(indexFileName));
+	PTF_ASSERT_TRUE(indexFromFile.isUpToDate(EXAMPLE_PCAP_WRITE_PATH));
+	PTF_ASSERT_TRUE(indexFromFile.getPacketCount() == writtenFileIndex.getPacketCount() + 10);
+
+	remove(indexFileName.c_str());
+}
+
+
+
+PTF_TEST_CASE(TestToeplitzHash)
+{
+	// verification vectors from Microsoft RSS specification
+	ToeplitzHash standardHash(ToeplitzHash::StandardKey, ToeplitzHash::DefaultKeyLength,
+			ToeplitzHash::RSS_IPV4 | ToeplitzHash::RSS_IPV6 | ToeplitzHash::RSS_NONFRAG_IPV4_TCP | ToeplitzHash::RSS_NONFRAG_IPV6_UDP);
+	ToeplitzHash standardHashNoPorts(ToeplitzHash::StandardKey);
+
+	struct
+	{
+		const char* srcIP;
+		const char* dstIP;
+		uint16_t srcPort;
+		uint16_t dstPort;
+		uint32_t ipHash;
+		uint32_t ipPortsHash;
+	} vectors[] = {
+		{ "66.9.149.187", "161.142.100.80", 2794, 1766, 0x323e8fc2, 0x51ccc178 },
+		{ "199.92.111.2", "65.69.140.83", 14230, 4739, 0xd718262a, 0xc626b0ea },
+		{ "24.19.198.95", "12.22.207.184", 12898, 38024, 0xd2d0a5de, 0x5c2b394a },
+		{ "38.27.205.30", "209.142.163.6", 48228, 2217, 0x82989176, 0xafc7327f },
+		{ "153.39.163.191", "202.188.127.2", 44251, 1303, 0x5d1809c5, 0x10e828a2 },
+		{ "3ffe:2501:200:1fff::7", "3ffe:2501:200:3::1", 2794, 1766, 0x2cc18cd5, 0x40207d3d },
+		{ "3ffe:501:8::260:97ff:fe40:efab", "ff02::1", 14230, 4739, 0x0f0c461c, 0xdde51bbf },
+		{ "3ffe:1900:4545:3:200:f8ff:fe21:67cf", "fe80::200:f8ff:fe21:67cf", 44251, 38024, 0x4b61e985, 0x02d1feef }
+	};
+
+	for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+	{
+		bool isIPv4 = (strchr(vectors[i].srcIP, ':') == NULL);
+
+		// the IPv4 vectors are hashed as TCP and the IPv6 vectors as UDP
+		EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+		IPv4Layer ipv4Layer(isIPv4 ? IPv4Address(std::string(vectors[i].srcIP)) : IPv4Address::Zero, isIPv4 ? IPv4Address(std::string(vectors[i].dstIP)) : IPv4Address::Zero);
+		IPv6Layer ipv6Layer(isIPv4 ? IPv6Address::Zero : IPv6Address(std::string(vectors[i].srcIP)), isIPv4 ? IPv6Address::Zero : IPv6Address(std::string(vectors[i].dstIP)));
+		TcpLayer tcpLayer(vectors[i].srcPort, vectors[i].dstPort);
+		UdpLayer udpLayer(vectors[i].srcPort, vectors[i].dstPort);
+		Packet packet(100);
+		PTF_ASSERT_TRUE(packet.addLayer(&ethLayer));
+		if (isIPv4)
+		{
+			PTF_ASSERT_TRUE(packet.addLayer(&ipv4Layer));
+			PTF_ASSERT_TRUE(packet.addLayer(&tcpLayer));
+		}
+		else
+		{
+			PTF_ASSERT_TRUE(packet.addLayer(&ipv6Layer));
+			PTF_ASSERT_TRUE(packet.addLayer(&udpLayer));
+		}
+		packet.computeCalculateFields();
+
+		uint32_t hash = 0;
+		PTF_ASSERT_TRUE(standardHash.calculateHash(packet.getRawPacket(), hash));
+		PTF_ASSERT_EQUAL(hash, vectors[i].ipPortsHash, u32);
+		PTF_ASSERT_TRUE(standardHashNoPorts.calculateHash(packet.getRawPacket(), hash));
+		PTF_ASSERT_EQUAL(hash, vectors[i].ipHash, u32);
+
+		// a fragment is hashed by its IPs only
+		if (isIPv4)
+		{
+			ipv4Layer.getIPv4Header()->fragmentOffset = htobe16(0x2000);
+			PTF_ASSERT_TRUE(standardHash.calculateHash(packet.getRawPacket(), hash));
+			PTF_ASSERT_EQUAL(hash, vectors[i].ipHash, u32);
+		}
+	}
+
+	// packets that no enabled hash function applies to aren't hashed
+	ToeplitzHash tcpOnlyHash(ToeplitzHash::StandardKey, ToeplitzHash::DefaultKeyLength, ToeplitzHash::RSS_NONFRAG_IPV4_TCP);
+	EthLayer ethLayer(MacAddress("aa:bb:cc:dd:ee:ff"), MacAddress("11:22:33:44:55:66"));
+	IPv4Layer ipLayer(IPv4Address(std::string("10.0.0.1")), IPv4Address(std::string("20.0.0.2")));
+	UdpLayer udpLayer(12345, 53);
+	Packet udpPacket(100);
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&ethLayer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&ipLayer));
+	PTF_ASSERT_TRUE(udpPacket.addLayer(&udpLayer));
+	udpPacket.computeCalculateFields();
+	uint32_t hash = 1;
+	PTF_ASSERT_FALSE(tcpOnlyHash.calculateHash(udpPacket.getRawPacket(), hash));
+	PTF_ASSERT_EQUAL(hash, 0, u32);
+
+	// the symmetric key gives the same hash to both directions of a flow
+	ToeplitzHash symmetricHash(ToeplitzHash::SymmetricKey, ToeplitzHash::DefaultKeyLength, ToeplitzHash::RSS_IPV4 | ToeplitzHash::RSS_NONFRAG_IPV4_UDP);
+	EthLayer ethLayer2(MacAddress("11:22:33:44:55:66"), MacAddress("aa:bb:cc:dd:ee:ff"));
+	IPv4Layer ipLayer2(IPv4Address(std::string("20.0.0.2")), IPv4Address(std::string("10.0.0.1")));
+	UdpLayer udpLayer2(53, 12345);
+	Packet udpPacket2(100);
+	PTF_ASSERT_TRUE(udpPacket2.addLayer(&ethLayer2));
+	PTF_ASSERT_TRUE(udpPacket2.addLayer(&ipLayer2));
+	PTF_ASSERT_TRUE(udpPacket2.addLayer(&udpLayer2));
+	udpPacket2.computeCalculateFields();
+	uint32_t hash2 = 0;
+	PTF_ASSERT_TRUE(symmetricHash.calculateHash(udpPacket.getRawPacket(), hash));
+	PTF_ASSERT_TRUE(symmetricHash.calculateHash(udpPacket2.getRawPacket(), hash2));
+	PTF_ASSERT_EQUAL(hash, hash2, u32);
+	PTF_ASSERT_TRUE(standardHash.calculateHash(udpPacket.getRawPacket(), hash));
+	PTF_ASSERT_TRUE(standardHash.calculateHash(udpPacket2.getRawPacket(), hash2));
+	PTF_ASSERT_TRUE(hash != hash2);
+
+	// queue mapping through the redirection table
+	PTF_ASSERT_EQUAL(ToeplitzHash::getQueueForHash(0x51ccc178, 1), 0, u16);
+	PTF_ASSERT_EQUAL(ToeplitzHash::getQueueForHash(0x51ccc178, 3), (0x51ccc178 & 127) % 3, u16);
+	PTF_ASSERT_EQUAL(ToeplitzHash::getQueueForHash(0x51ccc178, 3, 0), 0x51ccc178 % 3, u16);
+} // TestToeplitzHash
+
+
+
 PTF_TEST_CASE(TestPcapLiveDeviceList)
 {
     vector<PcapLiveDevice*> devList = PcapLiveDeviceList::getInstance().getPcapLiveDevicesList();
@@ -1640,9 +2431,135 @@ PTF_TEST_CASE(TestPcapLiveDeviceSpecialCfg)
 	liveDev->close();
 #endif 
 
+	// create a configuration with a small snapshot length and nanosecond timestamps, and verify what was actually granted
+	PcapLiveDevice::DeviceConfiguration devConfigSnaplen(PcapLiveDevice::Promiscuous, 10, 2000000, PcapLiveDevice::PCPP_INOUT, 128, true,
+			PcapLiveDevice::TimestampTypeDefault, PcapLiveDevice::TimestampPrecisionNano);
+	PTF_ASSERT_TRUE(liveDev->open(devConfigSnaplen));
+	PTF_ASSERT_EQUAL(liveDev->getActualConfiguration().snapshotLength, 128, int);
+	PTF_ASSERT_EQUAL(liveDev->getActualConfiguration().packetBufferSize, 2000000, int);
+	PTF_ASSERT_EQUAL(liveDev->getActualConfiguration().timestampType, PcapLiveDevice::TimestampTypeDefault, enum);
+
+	int maxRawDataLen = 0;
+	PTF_ASSERT_TRUE(liveDev->startCapture(packetArrivesMaxRawDataLen, &maxRawDataLen));
+	sendURLRequest("www.google.com");
+	PCAP_SLEEP(2);
+	liveDev->stopCapture();
+	liveDev->close();
+	PTF_ASSERT(maxRawDataLen > 0, "No packets are captured with snapshot length of 128");
+	PTF_ASSERT(maxRawDataLen <= 128, "Captured packet length %d is larger than the snapshot length", maxRawDataLen);
 }
 
 
+PTF_TEST_CASE(TestPcapLiveDeviceBurstMode)
+{
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+
+	// a negative test - device isn't opened
+	BurstModePacketData data(8);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(packetsArriveBurstMode, &data, 8, 1000));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(liveDev->open());
+
+	// a negative test - burst size of 0
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(packetsArriveBurstMode, &data, 0, 1000));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(liveDev->startCaptureBurstMode(packetsArriveBurstMode, &data, 8, 1000));
+	PTF_ASSERT_TRUE(liveDev->captureActive());
+
+	// a negative test - capture is already running
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureBurstMode(packetsArriveBurstMode, &data, 8, 1000));
+	LoggerPP::getInstance().enableErrors();
+
+	sendURLRequest("www.google.com");
+	PCAP_SLEEP(5);
+	liveDev->stopCapture();
+	PTF_ASSERT_FALSE(liveDev->captureActive());
+
+	PTF_ASSERT(data.PacketCount > 0, "No packets were captured in burst mode");
+	PTF_ASSERT(data.BurstCount > 0, "Burst callback was never called");
+	PTF_ASSERT(data.BurstCount <= data.PacketCount, "More bursts than packets: %d bursts, %d packets", data.BurstCount, data.PacketCount);
+	PTF_ASSERT_FALSE(data.BurstSizeExceeded);
+	PTF_ASSERT_FALSE(data.EmptyPacketFound);
+
+	// verify it's possible to capture in regular callback mode after burst mode
+	int packetCount = 0;
+	PTF_ASSERT_TRUE(liveDev->startCapture(packetArrives, &packetCount));
+	sendURLRequest("www.google.com");
+	PCAP_SLEEP(2);
+	liveDev->stopCapture();
+	PTF_ASSERT(packetCount > 0, "No packets were captured in callback mode after burst mode");
+
+	liveDev->close();
+	PTF_ASSERT_FALSE(liveDev->isOpened());
+}
+
+PTF_TEST_CASE(TestPcapLiveDeviceWorkersMode)
+{
+	PcapLiveDevice* liveDev = PcapLiveDeviceList::getInstance().getPcapLiveDeviceByIp(PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT(liveDev != NULL, "Device used in this test %s doesn't exist", PcapGlobalArgs.ipToSendReceivePackets.c_str());
+	PTF_ASSERT_TRUE(liveDev->open());
+
+	// a negative test - no workers
+	WorkersModePacketData data;
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->startCaptureWithWorkers(0, packetArrivesWorkersMode, &data));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(liveDev->startCaptureWithWorkers(NUM_OF_CAPTURE_WORKERS, packetArrivesWorkersMode, &data, 1000));
+	PTF_ASSERT_EQUAL(liveDev->getNumOfCaptureWorkers(), NUM_OF_CAPTURE_WORKERS, int);
+
+	PcapLiveDevice::CaptureWorkerStats stats;
+	PTF_ASSERT_TRUE(liveDev->getCaptureWorkerStats(0, stats));
+	PTF_ASSERT_EQUAL(stats.capacity, 1024, u32);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(liveDev->getCaptureWorkerStats(NUM_OF_CAPTURE_WORKERS, stats));
+	LoggerPP::getInstance().enableErrors();
+
+	sendURLRequest("www.google.com");
+	sendURLRequest("www.ebay.com");
+	PCAP_SLEEP(5);
+
+	uint64_t totalEnqueued = 0;
+	for (uint8_t i = 0; i < NUM_OF_CAPTURE_WORKERS; i++)
+	{
+		PTF_ASSERT_TRUE(liveDev->getCaptureWorkerStats(i, stats));
+		PTF_ASSERT(stats.occupancy <= stats.capacity, "Worker #%d ring occupancy %u is larger than its capacity", (int)i, stats.occupancy);
+		totalEnqueued += stats.enqueued;
+	}
+
+	liveDev->stopCapture();
+	PTF_ASSERT_EQUAL(liveDev->getNumOfCaptureWorkers(), 0, int);
+
+	int totalPacketCount = 0;
+	for (int i = 0; i < NUM_OF_CAPTURE_WORKERS; i++)
+		totalPacketCount += data.PacketCount[i];
+
+	PTF_ASSERT_FALSE(data.InvalidWorkerId);
+	PTF_ASSERT(totalPacketCount > 0, "No packets were captured in workers mode");
+	PTF_ASSERT(totalEnqueued <= (uint64_t)totalPacketCount, "Not all enqueued packets were processed by the workers");
+
+	// verify each flow was handled by exactly one worker
+	for (int i = 0; i < NUM_OF_CAPTURE_WORKERS; i++)
+	{
+		for (int j = i + 1; j < NUM_OF_CAPTURE_WORKERS; j++)
+		{
+			for (std::set<uint32_t>::iterator iter = data.FlowKeys[i].begin(); iter != data.FlowKeys[i].end(); iter++)
+			{
+				PTF_ASSERT(data.FlowKeys[j].find(*iter) == data.FlowKeys[j].end(), "Flow 0x%X was handled by workers #%d and #%d", *iter, i, j);
+			}
+		}
+	}
+
+	liveDev->close();
+	PTF_ASSERT_FALSE(liveDev->isOpened());
+}
+
 PTF_TEST_CASE(TestWinPcapLiveDevice)
 {
 #ifdef WIN32
@@ -2313,35 +3230,713 @@ PTF_TEST_CASE(TestPcapFiltersOffline)
 	filterVec.push_back(&andFilter);
 	OrFilter orFilter(filterVec);
 
-	orFilter.parseToString(filterAsString);
+	orFilter.parseToString(filterAsString);
+
+    PTF_ASSERT(fileReaderDev3.open(), "Cannot open file reader device for filter '%s'", filterAsString.c_str());
+    PTF_ASSERT(fileReaderDev3.setFilter(orFilter), "Could not set filter: %s", filterAsString.c_str());
+    fileReaderDev3.getNextPackets(rawPacketVec);
+    fileReaderDev3.close();
+
+	PTF_ASSERT(rawPacketVec.size() == 19, "Complex filter test: Captured less or more than 19 packets");
+	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		Packet packet(*iter);
+		if (packet.isPacketOfType(ARP))
+		{
+			continue;
+		}
+		else
+		{
+			PTF_ASSERT(packet.isPacketOfType(GRE), "Complex filter test: one of the captured packets isn't of type ARP or GRE");
+			PTF_ASSERT(packet.isPacketOfType(IPv4), "Complex filter test: one of the captured packets isn't of type IPv4");
+			IPv4Layer* ipv4Layer = packet.getLayerOfType<IPv4Layer>();
+			PTF_ASSERT(ipv4Layer->getSrcIpAddress() == IPv4Address(std::string("20.0.0.1"))
+					|| ipv4Layer->getDstIpAddress() == IPv4Address(std::string("20.0.0.1")),
+					"complex filter test: srcIP or dstIP is not 20.0.0.1");
+		}
+
+	}
+	rawPacketVec.clear();
+}
+
+// a filter whose native program jumps back to its own instruction, which would never end if the program was accepted
+class BackwardJumpFilter : public GeneralFilter
+{
+public:
+	void parseToString(std::string& result) { result = "len >= 0"; }
+
+	bool compileNative(NativeFilterBuilder& builder, uint32_t onMatch, uint32_t onMismatch) const
+	{
+		NativeFilterBuilder::Label loop = builder.newLabel();
+		builder.placeLabel(loop);
+		builder.emitAlways(loop);
+		return true;
+	}
+};
+
+PTF_TEST_CASE(TestPcapFiltersNative)
+{
+	RawPacketVector vlanPackets;
+	RawPacketVector examplePackets;
+	RawPacketVector grePackets;
+
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_VLAN);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file reader device for '%s'", EXAMPLE_PCAP_VLAN);
+	fileReaderDev.getNextPackets(vlanPackets);
+	fileReaderDev.close();
+
+	PcapFileReaderDevice fileReaderDev2(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev2.open(), "Cannot open file reader device for '%s'", EXAMPLE_PCAP_PATH);
+	fileReaderDev2.getNextPackets(examplePackets);
+	fileReaderDev2.close();
+
+	PcapFileReaderDevice fileReaderDev3(EXAMPLE_PCAP_GRE);
+	PTF_ASSERT(fileReaderDev3.open(), "Cannot open file reader device for '%s'", EXAMPLE_PCAP_GRE);
+	fileReaderDev3.getNextPackets(grePackets);
+	fileReaderDev3.close();
+
+	VlanFilter vlanFilter(118);
+	MacAddressFilter macAddrFilter(MacAddress("00:13:c3:df:ae:18"), DST);
+	EtherTypeFilter ethTypeFilter(PCPP_ETHERTYPE_VLAN);
+	IPv4IDFilter ipIDFilter(0x9900, GREATER_THAN);
+	IPv4TotalLengthFilter ipTotalLengthFilter(576, LESS_OR_EQUAL);
+	TcpWindowSizeFilter tcpWindowSizeFilter(8312, NOT_EQUALS);
+	UdpLengthFilter udpLengthFilter(46, EQUALS);
+	IPFilter ipFilterWithMask("212.199.202.9", SRC, "255.255.255.0");
+	IPFilter ipFilterWithLen("212.199.202.9", DST, 16);
+	PortFilter portFilter(80, SRC_OR_DST);
+	PortRangeFilter portRangeFilter(40000, 50000, SRC);
+	TcpFlagsFilter tcpFlagsAllFilter(TcpFlagsFilter::tcpSyn|TcpFlagsFilter::tcpAck, TcpFlagsFilter::MatchAll);
+	TcpFlagsFilter tcpFlagsOneFilter(TcpFlagsFilter::tcpSyn|TcpFlagsFilter::tcpAck, TcpFlagsFilter::MatchOneAtLeast);
+	ProtoFilter arpFilter(ARP);
+	ProtoFilter tcpFilter(TCP);
+	ProtoFilter greFilter(GRE);
+	ProtoFilter vlanProtoFilter(VLAN);
+	IPFilter ipFilter("20.0.0.1", SRC_OR_DST);
+
+	// (arp) or ((proto 47) and (ip and src or dst net 20.0.0.1))
+	AndFilter greAndIPFilter;
+	greAndIPFilter.addFilter(&greFilter);
+	greAndIPFilter.addFilter(&ipFilter);
+	OrFilter complexFilter;
+	complexFilter.addFilter(&arpFilter);
+	complexFilter.addFilter(&greAndIPFilter);
+	NotFilter notComplexFilter(&complexFilter);
+
+	// (vlan) and (vlan) and (ip): each VLAN test shifts the tests after it behind another VLAN tag
+	ProtoFilter ipv4Filter(IPv4);
+	AndFilter qinqAndIPFilter;
+	qinqAndIPFilter.addFilter(&vlanProtoFilter);
+	qinqAndIPFilter.addFilter(&vlanProtoFilter);
+	qinqAndIPFilter.addFilter(&ipv4Filter);
+
+	struct
+	{
+		GeneralFilter* filter;
+		RawPacketVector* packets;
+	} testCases[] = {
+		{ &vlanFilter, &vlanPackets },
+		{ &macAddrFilter, &vlanPackets },
+		{ &ethTypeFilter, &vlanPackets },
+		{ &qinqAndIPFilter, &vlanPackets },
+		{ &ipIDFilter, &examplePackets },
+		{ &ipTotalLengthFilter, &examplePackets },
+		{ &tcpWindowSizeFilter, &examplePackets },
+		{ &udpLengthFilter, &examplePackets },
+		{ &ipFilterWithMask, &examplePackets },
+		{ &ipFilterWithLen, &examplePackets },
+		{ &portFilter, &examplePackets },
+		{ &portRangeFilter, &examplePackets },
+		{ &tcpFlagsAllFilter, &examplePackets },
+		{ &tcpFlagsOneFilter, &examplePackets },
+		{ &tcpFilter, &grePackets },
+		{ &complexFilter, &grePackets },
+		{ &notComplexFilter, &grePackets }
+	};
+
+	// the native filter should match exactly the packets libpcap matches with the BPF string of the same filter
+	for (size_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++)
+	{
+		std::string filterAsString;
+		testCases[i].filter->parseToString(filterAsString);
+
+		NativeFilter nativeFilter;
+		PTF_ASSERT(nativeFilter.compile(*testCases[i].filter), "Cannot compile filter '%s' natively", filterAsString.c_str());
+
+		int matchCount = 0;
+		for (RawPacketVector::VectorIterator iter = testCases[i].packets->begin(); iter != testCases[i].packets->end(); iter++)
+		{
+			bool nativeMatch = nativeFilter.matchPacket(*iter);
+			PTF_ASSERT(nativeMatch == testCases[i].filter->matchPacketWithFilter(*iter), "Native filter '%s' and libpcap disagree on a packet", filterAsString.c_str());
+			if (nativeMatch)
+				matchCount++;
+		}
+
+		PTF_ASSERT(matchCount > 0, "Native filter '%s' didn't match any packet", filterAsString.c_str());
+	}
+
+	NativeFilter nativeFilter;
+	PTF_ASSERT_TRUE(nativeFilter.compile(complexFilter));
+	PTF_ASSERT_EQUAL(nativeFilter.getProgramSize(), 3, size);
+	int complexFilterCount = 0;
+	for (RawPacketVector::VectorIterator iter = grePackets.begin(); iter != grePackets.end(); iter++)
+	{
+		Packet packet(*iter);
+		if (nativeFilter.matchPacket(packet))
+			complexFilterCount++;
+	}
+	PTF_ASSERT_EQUAL(complexFilterCount, 19, int);
+
+	// filters without a native form don't compile and a program that failed to compile doesn't match anything
+	LoggerPP::getInstance().supressErrors();
+	BPFStringFilter bpfStringFilter("tcp");
+	PTF_ASSERT_FALSE(nativeFilter.compile(bpfStringFilter));
+	IPFilter ipv6Filter("2001:db8::1", SRC);
+	PTF_ASSERT_FALSE(nativeFilter.compile(ipv6Filter));
+	NotFilter notNullFilter(NULL);
+	PTF_ASSERT_FALSE(nativeFilter.compile(notNullFilter));
+	BackwardJumpFilter backwardJumpFilter;
+	PTF_ASSERT_FALSE(nativeFilter.compile(backwardJumpFilter));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_FALSE(nativeFilter.isCompiled());
+	PTF_ASSERT_FALSE(nativeFilter.matchPacket(grePackets.front()));
+}
+
+PTF_TEST_CASE(TestPcapFiltersSet)
+{
+	RawPacketVector examplePackets;
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT(fileReaderDev.open(), "Cannot open file reader device for '%s'", EXAMPLE_PCAP_PATH);
+	fileReaderDev.getNextPackets(examplePackets);
+	fileReaderDev.close();
+
+	// take the source addresses of every 20th IPv4 packet, and build the same filter as a set and as an "or" of IPFilters
+	std::set<std::string> srcAddresses;
+	int packetIndex = 0;
+	for (RawPacketVector::VectorIterator iter = examplePackets.begin(); iter != examplePackets.end(); iter++, packetIndex++)
+	{
+		Packet packet(*iter);
+		IPv4Layer* ipLayer = packet.getLayerOfType<IPv4Layer>();
+		if (ipLayer != NULL && packetIndex % 20 == 0)
+			srcAddresses.insert(ipLayer->getSrcIpAddress().toString());
+	}
+	PTF_ASSERT_TRUE(srcAddresses.size() > 1);
+
+	std::vector<std::string> srcAddressList(srcAddresses.begin(), srcAddresses.end());
+	IPSetFilter ipSetFilter(srcAddressList, SRC);
+	PTF_ASSERT_EQUAL(ipSetFilter.getNumOfAddresses(), srcAddresses.size(), size);
+	PointerVector<GeneralFilter> ipFilters;
+	OrFilter ipFiltersOr;
+	for (std::set<std::string>::iterator iter = srcAddresses.begin(); iter != srcAddresses.end(); iter++)
+	{
+		IPFilter* ipFilter = new IPFilter(*iter, SRC);
+		ipFilters.pushBack(ipFilter);
+		ipFiltersOr.addFilter(ipFilter);
+	}
+
+	SubnetSetFilter subnetSetFilter(SRC_OR_DST);
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("212.199.202.0/24"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("10.0.0.0/8"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("10.0.0.0/16"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("2001:db8::/32"));
+	PTF_ASSERT_EQUAL(subnetSetFilter.getNumOfSubnets(), 4, size);
+
+	PortSetFilter portSetFilter(SRC_OR_DST);
+	portSetFilter.addPort(80);
+	portSetFilter.addPort(443);
+	portSetFilter.addPortRange(40000, 50000);
+	PortFilter port80Filter(80, SRC_OR_DST);
+	PortFilter port443Filter(443, SRC_OR_DST);
+	PortRangeFilter portRangeFilter(40000, 50000, SRC_OR_DST);
+	OrFilter portFiltersOr;
+	portFiltersOr.addFilter(&port80Filter);
+	portFiltersOr.addFilter(&port443Filter);
+	portFiltersOr.addFilter(&portRangeFilter);
+
+	struct
+	{
+		GeneralFilter* setFilter;
+		GeneralFilter* equivalentFilter;
+	} testCases[] = {
+		{ &ipSetFilter, &ipFiltersOr },
+		{ &subnetSetFilter, NULL },
+		{ &portSetFilter, &portFiltersOr }
+	};
+
+	// a set filter should match exactly the packets libpcap matches with its BPF string, and the packets its equivalent filter matches
+	for (size_t i = 0; i < sizeof(testCases) / sizeof(testCases[0]); i++)
+	{
+		std::string filterAsString;
+		testCases[i].setFilter->parseToString(filterAsString);
+
+		NativeFilter nativeFilter;
+		PTF_ASSERT(nativeFilter.compile(*testCases[i].setFilter), "Cannot compile filter '%s' natively", filterAsString.c_str());
+		NativeFilter equivalentNativeFilter;
+		if (testCases[i].equivalentFilter != NULL)
+			PTF_ASSERT_TRUE(equivalentNativeFilter.compile(*testCases[i].equivalentFilter));
+
+		PTF_ASSERT_TRUE(testCases[i].setFilter->isBpfExact());
+		BPFStringFilter bpfFilter(filterAsString);
+
+		int matchCount = 0;
+		for (RawPacketVector::VectorIterator iter = examplePackets.begin(); iter != examplePackets.end(); iter++)
+		{
+			bool nativeMatch = nativeFilter.matchPacket(*iter);
+			PTF_ASSERT(nativeMatch == bpfFilter.matchPacketWithFilter(*iter), "Set filter '%s' and libpcap disagree on a packet", filterAsString.c_str());
+			PTF_ASSERT(nativeMatch == testCases[i].setFilter->matchPacketWithFilter(*iter), "Set filter '%s' doesn't match a packet like its native program", filterAsString.c_str());
+			if (testCases[i].equivalentFilter != NULL)
+				PTF_ASSERT(nativeMatch == equivalentNativeFilter.matchPacket(*iter), "Set filter '%s' and its equivalent filter disagree on a packet", filterAsString.c_str());
+			if (nativeMatch)
+				matchCount++;
+		}
+
+		PTF_ASSERT(matchCount > 0, "Set filter '%s' didn't match any packet", filterAsString.c_str());
+	}
+
+	// updating the set changes what a compiled program matches, and the program keeps working after the filter is destroyed
+	NativeFilter reloadedFilter;
+	RawPacket* firstPacket = examplePackets.front();
+	Packet firstParsedPacket(firstPacket);
+	std::string firstSrcAddress = firstParsedPacket.getLayerOfType<IPv4Layer>()->getSrcIpAddress().toString();
+	{
+		IPSetFilter hotReloadFilter(SRC);
+		PTF_ASSERT_TRUE(reloadedFilter.compile(hotReloadFilter));
+		PTF_ASSERT_FALSE(reloadedFilter.matchPacket(firstPacket));
+		PTF_ASSERT_TRUE(hotReloadFilter.addAddress(firstSrcAddress));
+		PTF_ASSERT_TRUE(reloadedFilter.matchPacket(firstPacket));
+		PTF_ASSERT_TRUE(hotReloadFilter.setAddresses(std::vector<std::string>(1, "1.2.3.4")));
+		PTF_ASSERT_FALSE(reloadedFilter.matchPacket(firstPacket));
+		PTF_ASSERT_TRUE(hotReloadFilter.setAddresses(srcAddressList));
+		PTF_ASSERT_TRUE(reloadedFilter.matchPacket(firstPacket));
+	}
+	PTF_ASSERT_TRUE(reloadedFilter.matchPacket(firstPacket));
+
+	// matchPacketWithFilter() of a filter tree follows the changes of its sets and of its other filters
+	AndFilter setTreeFilter;
+	IPSetFilter setTreeSetFilter(SRC);
+	ProtoFilter setTreeProtoFilter(IPv4);
+	setTreeFilter.addFilter(&setTreeSetFilter);
+	setTreeFilter.addFilter(&setTreeProtoFilter);
+	PTF_ASSERT_FALSE(setTreeFilter.matchPacketWithFilter(firstPacket));
+	PTF_ASSERT_TRUE(setTreeSetFilter.addAddress(firstSrcAddress));
+	PTF_ASSERT_TRUE(setTreeFilter.matchPacketWithFilter(firstPacket));
+	setTreeProtoFilter.setProto(IPv6);
+	PTF_ASSERT_FALSE(setTreeFilter.matchPacketWithFilter(firstPacket));
+
+	// with a limited number of BPF terms the BPF string matches a superset of the packets the set matches, while matchPacketWithFilter()
+	// and the devices still match exactly the members of the set
+	IPSetFilter largeSetFilter(SRC_OR_DST);
+	for (uint32_t i = 0; i < 5000; i++)
+		PTF_ASSERT_TRUE(largeSetFilter.addAddress(IPv4Address(htobe32(0x0a000000 | (i * 2654435761UL & 0xffffff))).toString()));
+	for (std::vector<std::string>::iterator iter = srcAddressList.begin(); iter != srcAddressList.end(); iter++)
+		largeSetFilter.addAddress(*iter);
+	largeSetFilter.setMaxBpfTerms(16);
+	std::string largeSetFilterAsString;
+	largeSetFilter.parseToString(largeSetFilterAsString);
+	BPFStringFilter largeSetBpfFilter(largeSetFilterAsString);
+	PTF_ASSERT(largeSetBpfFilter.verifyFilter(), "The BPF string of a large set '%s' isn't valid", largeSetFilterAsString.c_str());
+	PTF_ASSERT_FALSE(largeSetFilter.isBpfExact());
+	NativeFilter largeSetNativeFilter;
+	PTF_ASSERT_TRUE(largeSetNativeFilter.compile(largeSetFilter));
+	NotFilter notLargeSetFilter(&largeSetFilter);
+	PTF_ASSERT_FALSE(notLargeSetFilter.isBpfExact());
+	int largeSetMatchCount = 0;
+	for (RawPacketVector::VectorIterator iter = examplePackets.begin(); iter != examplePackets.end(); iter++)
+	{
+		bool nativeMatch = largeSetNativeFilter.matchPacket(*iter);
+		if (nativeMatch)
+		{
+			PTF_ASSERT_TRUE(largeSetBpfFilter.matchPacketWithFilter(*iter));
+			largeSetMatchCount++;
+		}
+		PTF_ASSERT_EQUAL(largeSetFilter.matchPacketWithFilter(*iter), nativeMatch, int);
+		PTF_ASSERT_EQUAL(IPcapDevice::matchPacketWithFilter(largeSetFilter, *iter), nativeMatch, int);
+		PTF_ASSERT_EQUAL(notLargeSetFilter.matchPacketWithFilter(*iter), !nativeMatch, int);
+	}
+	PTF_ASSERT_TRUE(largeSetMatchCount > 0);
+
+	PcapFileReaderDevice largeSetReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(largeSetReaderDev.open());
+	PTF_ASSERT_TRUE(largeSetReaderDev.setFilter(largeSetFilter));
+	RawPacket rawPacket;
+	int largeSetReadCount = 0;
+	while (largeSetReaderDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT_TRUE(largeSetNativeFilter.matchPacket(&rawPacket));
+		largeSetReadCount++;
+	}
+	PTF_ASSERT_EQUAL(largeSetReadCount, largeSetMatchCount, int);
+	largeSetReaderDev.close();
+
+	// removing addresses takes effect without setting the filter again
+	PTF_ASSERT_TRUE(largeSetReaderDev.open());
+	PTF_ASSERT_TRUE(largeSetReaderDev.setFilter(largeSetFilter));
+	for (std::vector<std::string>::iterator iter = srcAddressList.begin(); iter != srcAddressList.end(); iter++)
+		largeSetFilter.removeAddress(*iter);
+	int largeSetReloadedCount = 0;
+	while (largeSetReaderDev.getNextPacket(rawPacket))
+	{
+		PTF_ASSERT_TRUE(largeSetNativeFilter.matchPacket(&rawPacket));
+		largeSetReloadedCount++;
+	}
+	PTF_ASSERT_TRUE(largeSetReloadedCount < largeSetMatchCount);
+	largeSetReaderDev.close();
+	for (RawPacketVector::VectorIterator iter = examplePackets.begin(); iter != examplePackets.end(); iter++)
+		PTF_ASSERT_EQUAL(largeSetFilter.matchPacketWithFilter(*iter), largeSetNativeFilter.matchPacket(*iter), int);
+
+	// file devices match set filters natively only, so adding addresses takes effect without setting the filter again too
+	IPSetFilter addedSetFilter(SRC);
+	PcapFileReaderDevice addedSetReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(addedSetReaderDev.open());
+	PTF_ASSERT_TRUE(addedSetReaderDev.setFilter(addedSetFilter));
+	PTF_ASSERT_TRUE(addedSetFilter.addAddress(firstSrcAddress));
+	PTF_ASSERT_TRUE(addedSetReaderDev.getNextPacket(rawPacket));
+	PTF_ASSERT_EQUAL(rawPacket.getRawDataLen(), firstPacket->getRawDataLen(), int);
+	PTF_ASSERT_BUF_COMPARE(rawPacket.getRawData(), firstPacket->getRawData(), firstPacket->getRawDataLen());
+	addedSetReaderDev.close();
+
+	// invalid values are rejected and leave the set unchanged
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(ipSetFilter.addAddress("10.0.0.0/8"));
+	PTF_ASSERT_FALSE(ipSetFilter.addAddress("not an address"));
+	std::vector<std::string> invalidAddressList = srcAddressList;
+	invalidAddressList.push_back("1.2.3");
+	PTF_ASSERT_FALSE(ipSetFilter.setAddresses(invalidAddressList));
+	PTF_ASSERT_FALSE(subnetSetFilter.addSubnet("10.0.0.0/33"));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_EQUAL(ipSetFilter.getNumOfAddresses(), srcAddresses.size(), size);
+	PTF_ASSERT_TRUE(subnetSetFilter.removeSubnet("10.0.0.0/8"));
+	PTF_ASSERT_FALSE(subnetSetFilter.removeSubnet("10.0.0.0/8"));
+	PTF_ASSERT_TRUE(subnetSetFilter.containsAddress(IPv4Address("10.0.1.1")));
+	PTF_ASSERT_FALSE(subnetSetFilter.containsAddress(IPv4Address("10.1.0.1")));
+	PTF_ASSERT_TRUE(subnetSetFilter.containsAddress(IPv6Address(std::string("2001:db8::1"))));
+	PTF_ASSERT_TRUE(portSetFilter.removePort(80));
+	PTF_ASSERT_FALSE(portSetFilter.containsPort(80));
+	PTF_ASSERT_EQUAL(portSetFilter.getNumOfPorts(), 10002, size);
+}
+
+// all the captures in PcapExamples except example_copy.pcap, which the tests write, listed explicitly because there's no portable way
+// to list a directory
+static const char* AllPcapExampleFiles[] = {
+	"PcapExamples/4KHttpRequests.pcap", "PcapExamples/650HttpResponses.pcap", "PcapExamples/DnsPackets.pcap",
+	"PcapExamples/GrePackets.cap", "PcapExamples/IgmpPackets.pcap", "PcapExamples/VlanPackets.pcap",
+	"PcapExamples/example.pcap", "PcapExamples/example2.pcap", "PcapExamples/four_ipv6_http_streams.pcap",
+	"PcapExamples/frag_http_req.pcap", "PcapExamples/ip4_fragments.pcap", "PcapExamples/ip6_fragments.pcap",
+	"PcapExamples/many_interfaces-1.pcapng", "PcapExamples/one_http_stream_fin.pcap", "PcapExamples/one_http_stream_fin2.pcap",
+	"PcapExamples/one_http_stream_rst.pcap", "PcapExamples/one_ipv6_http_stream.pcap", "PcapExamples/one_tcp_stream.pcap",
+	"PcapExamples/one_tcp_stream_max_seq.pcap", "PcapExamples/pcapng-example.pcapng", "PcapExamples/raw_ip.pcap",
+	"PcapExamples/sll.pcap", "PcapExamples/three_http_streams.pcap"
+};
+
+PTF_TEST_CASE(TestPcapFiltersJit)
+{
+	// filters chosen to cover all the BPF instruction classes libpcap generates
+	const char* filters[] = {
+		"tcp", "udp port 53", "ip[2:2] > 500", "tcp[tcpflags] & tcp-syn != 0", "vlan and ip", "ip6", "len > 100", "ether[0] & 1 = 1",
+		"icmp or arp", "portrange 1000-2000", "net 10.0.0.0/8", "not ip", "ip[8] * 2 - 10 >= 100", "ip[6:2] & 0x1fff != 0",
+		"tcp[((tcp[12] & 0xf0) >> 2):4] = 0x47455420", "(ip[2:2] / 3) % 7 = 2", "udp[8:2] ^ 0xffff = 0x7ffe", "ip6 and tcp port 80",
+		"ip[0] & 0xf != 5", "tcp and (ip[2:2] - ((ip[0] & 0xf) << 2) - ((tcp[12] & 0xf0) >> 2)) != 0", "len - 14 < 60 or len <= 54",
+		"igmp", "ip proto 47", "host 212.199.202.9", "ip and (ip[9] = 6 or ip[9] = 17) and ip[9] << 1 != 34"
+	};
+
+	int totalMatched = 0;
+	for (size_t fileIndex = 0; fileIndex < sizeof(AllPcapExampleFiles) / sizeof(AllPcapExampleFiles[0]); fileIndex++)
+	{
+		IFileReaderDevice* reader = IFileReaderDevice::getReader(AllPcapExampleFiles[fileIndex]);
+		PTF_ASSERT(reader->open(), "Cannot open '%s'", AllPcapExampleFiles[fileIndex]);
+		RawPacketVector packets;
+		reader->getNextPackets(packets);
+		reader->close();
+		delete reader;
+
+		for (size_t filterIndex = 0; filterIndex < sizeof(filters) / sizeof(filters[0]); filterIndex++)
+		{
+			struct bpf_program program;
+			bool programCompiled = false;
+			int programLinkType = -1;
+			BpfJit jit;
+			BpfJit interpreter;
+
+			for (RawPacketVector::VectorIterator iter = packets.begin(); iter != packets.end(); iter++)
+			{
+				RawPacket* rawPacket = *iter;
+
+				// the program is compiled per link type, since a pcap-ng file can mix them
+				int linkType = (rawPacket->getLinkLayerType() == LINKTYPE_RAW ? LINKTYPE_DLT_RAW1 : rawPacket->getLinkLayerType());
+				if (linkType != programLinkType)
+				{
+					if (programCompiled)
+						pcap_freecode(&program);
+					programLinkType = linkType;
+					programCompiled = (pcap_compile_nopcap(9000, linkType, &program, filters[filterIndex], 1, 0) == 0);
+					// some filters don't apply to some link types, for example "vlan" to raw IP
+					if (!programCompiled)
+						continue;
+
+					PTF_ASSERT(jit.compile(&program), "Cannot JIT filter '%s'", filters[filterIndex]);
+					PTF_ASSERT(interpreter.compile(&program, false), "Cannot interpret filter '%s'", filters[filterIndex]);
+					PTF_ASSERT(jit.isJitted() == BpfJit::isJitSupported(), "Filter '%s' wasn't compiled to native code", filters[filterIndex]);
+					PTF_ASSERT_FALSE(interpreter.isJitted());
+				}
+
+				if (!programCompiled)
+					continue;
+
+				struct pcap_pkthdr pktHdr;
+				memset(&pktHdr, 0, sizeof(pktHdr));
+				pktHdr.caplen = rawPacket->getRawDataLen();
+				pktHdr.len = rawPacket->getFrameLength();
+				uint32_t expected = pcap_offline_filter(&program, &pktHdr, rawPacket->getRawData());
+				uint32_t jitResult = jit.run(rawPacket->getRawData(), pktHdr.caplen, pktHdr.len);
+				uint32_t interpreterResult = interpreter.run(rawPacket->getRawData(), pktHdr.caplen, pktHdr.len);
+				PTF_ASSERT(jitResult == expected, "JIT and libpcap disagree on filter '%s' in '%s': %u != %u", filters[filterIndex], AllPcapExampleFiles[fileIndex], jitResult, expected);
+				PTF_ASSERT(interpreterResult == expected, "Interpreter and libpcap disagree on filter '%s' in '%s': %u != %u", filters[filterIndex], AllPcapExampleFiles[fileIndex], interpreterResult, expected);
+				if (expected != 0)
+					totalMatched++;
+			}
+
+			if (programCompiled)
+				pcap_freecode(&program);
+		}
+	}
+
+	PTF_ASSERT(totalMatched > 0, "No filter matched any packet");
+
+	// PcapFileReaderDevice filters with the JIT too
+	PcapFileReaderDevice fileReaderDev(EXAMPLE_PCAP_PATH);
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	RawPacketVector examplePackets;
+	fileReaderDev.getNextPackets(examplePackets);
+	fileReaderDev.close();
+
+	int tcpCount = 0;
+	int firstTcpIndex = -1;
+	int packetIndex = 0;
+	for (RawPacketVector::VectorIterator iter = examplePackets.begin(); iter != examplePackets.end(); iter++, packetIndex++)
+	{
+		Packet packet(*iter);
+		if (!packet.isPacketOfType(TCP))
+			continue;
+		if (firstTcpIndex < 0)
+			firstTcpIndex = packetIndex;
+		tcpCount++;
+	}
+
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter("tcp"));
+	RawPacketVector filteredPackets;
+	fileReaderDev.getNextPackets(filteredPackets);
+	PTF_ASSERT_EQUAL((int)filteredPackets.size(), tcpCount, int);
+	fileReaderDev.close();
+
+	// a filter that doesn't compile doesn't replace the current filter, an empty filter clears it
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter("tcp"));
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(fileReaderDev.setFilter("tcp and and"));
+	LoggerPP::getInstance().enableErrors();
+	RawPacket rawPacket;
+	PTF_ASSERT_TRUE(fileReaderDev.getNextPacket(rawPacket));
+	Packet firstTcpPacket(&rawPacket);
+	PTF_ASSERT_TRUE(firstTcpPacket.isPacketOfType(TCP));
+	PTF_ASSERT_TRUE(fileReaderDev.clearFilter());
+	filteredPackets.clear();
+	fileReaderDev.getNextPackets(filteredPackets);
+	PTF_ASSERT_EQUAL((int)filteredPackets.size(), (int)examplePackets.size() - firstTcpIndex - 1, int);
+	fileReaderDev.close();
+
+	// a program longer than BpfJit accepts is run by libpcap instead. The filter has one host that appears in the file and many
+	// that don't, so it must match the same packets as the short filter with that host only
+	std::stringstream longFilter;
+	longFilter << "ip host 212.199.202.9";
+	for (int i = 0; i < 1200; i++)
+		longFilter << " or ip host 198.18." << (i / 250) << "." << (i % 250 + 1);
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter("ip host 212.199.202.9"));
+	RawPacketVector shortFilterPackets;
+	fileReaderDev.getNextPackets(shortFilterPackets);
+	PTF_ASSERT_TRUE(shortFilterPackets.size() > 0);
+	fileReaderDev.close();
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter(longFilter.str()));
+	LoggerPP::getInstance().enableErrors();
+	RawPacketVector longFilterPackets;
+	fileReaderDev.getNextPackets(longFilterPackets);
+	PTF_ASSERT_EQUAL(longFilterPackets.size(), shortFilterPackets.size(), size);
+	fileReaderDev.close();
+
+	// a filter BpfJit runs replaces the one libpcap runs, and an empty filter clears it
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter(longFilter.str()));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter("tcp"));
+	filteredPackets.clear();
+	fileReaderDev.getNextPackets(filteredPackets);
+	PTF_ASSERT_EQUAL((int)filteredPackets.size(), tcpCount, int);
+	fileReaderDev.close();
+	PTF_ASSERT_TRUE(fileReaderDev.open());
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_TRUE(fileReaderDev.setFilter(longFilter.str()));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(fileReaderDev.clearFilter());
+	filteredPackets.clear();
+	fileReaderDev.getNextPackets(filteredPackets);
+	PTF_ASSERT_EQUAL(filteredPackets.size(), examplePackets.size(), size);
+	fileReaderDev.close();
+}
+
+PTF_TEST_CASE(TestPcapFiltersDifferential)
+{
+	// a corpus of filter trees built from the PcapFilter.h classes. Every tree is matched by NativeFilter and, through its BPF string,
+	// by libpcap, by BpfJit native code and by the BpfJit interpreter. libpcap is the reference the other backends must agree with
+	IPFilter hostFilter("212.199.202.9", SRC_OR_DST);
+	IPFilter netFilter("10.0.0.0", DST, 8);
+	IPv4IDFilter ipIDFilter(0x9900, GREATER_THAN);
+	IPv4TotalLengthFilter ipTotalLengthFilter(576, LESS_OR_EQUAL);
+	PortFilter httpFilter(80, SRC_OR_DST);
+	PortFilter dnsFilter(53, DST);
+	PortRangeFilter portRangeFilter(1000, 2000, SRC_OR_DST);
+	MacAddressFilter macAddrFilter(MacAddress("00:13:c3:df:ae:18"), DST);
+	EtherTypeFilter ipv6EtherTypeFilter(PCPP_ETHERTYPE_IPV6);
+	ProtoFilter tcpFilter(TCP);
+	ProtoFilter udpFilter(UDP);
+	ProtoFilter icmpFilter(ICMP);
+	ProtoFilter igmpFilter(IGMP);
+	ProtoFilter greFilter(GRE);
+	ProtoFilter arpFilter(ARP);
+	ProtoFilter vlanProtoFilter(VLAN);
+	ArpFilter arpRequestFilter(ARP_REQUEST);
+	VlanFilter vlanFilter(118);
+	TcpFlagsFilter synFilter(TcpFlagsFilter::tcpSyn, TcpFlagsFilter::MatchOneAtLeast);
+	TcpFlagsFilter synAckFilter(TcpFlagsFilter::tcpSyn|TcpFlagsFilter::tcpAck, TcpFlagsFilter::MatchAll);
+	TcpWindowSizeFilter tcpWindowSizeFilter(8312, NOT_EQUALS);
+	UdpLengthFilter udpLengthFilter(46, EQUALS);
+
+	PortSetFilter portSetFilter(SRC_OR_DST);
+	portSetFilter.addPort(80);
+	portSetFilter.addPort(443);
+	portSetFilter.addPort(8080);
+	portSetFilter.addPortRange(40000, 50000);
+	SubnetSetFilter subnetSetFilter(SRC_OR_DST);
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("212.199.202.0/24"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("10.0.0.0/8"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("2001:db8::/32"));
+	PTF_ASSERT_TRUE(subnetSetFilter.addSubnet("fe80::/10"));
+
+	// ((tcp) and (port 80)) or ((udp) and (dst port 53)), and its negation
+	AndFilter webFilter;
+	webFilter.addFilter(&tcpFilter);
+	webFilter.addFilter(&httpFilter);
+	AndFilter dnsQueryFilter;
+	dnsQueryFilter.addFilter(&udpFilter);
+	dnsQueryFilter.addFilter(&dnsFilter);
+	OrFilter webOrDnsFilter;
+	webOrDnsFilter.addFilter(&webFilter);
+	webOrDnsFilter.addFilter(&dnsQueryFilter);
+	NotFilter notWebOrDnsFilter(&webOrDnsFilter);
+
+	// (vlan) and (vlan) and (icmp): each VLAN test shifts the tests after it behind another VLAN tag (QinQ)
+	AndFilter qinqIcmpFilter;
+	qinqIcmpFilter.addFilter(&vlanProtoFilter);
+	qinqIcmpFilter.addFilter(&vlanProtoFilter);
+	qinqIcmpFilter.addFilter(&icmpFilter);
+
+	GeneralFilter* filters[] = {
+		&hostFilter, &netFilter, &ipIDFilter, &ipTotalLengthFilter, &httpFilter, &dnsFilter, &portRangeFilter, &macAddrFilter,
+		&ipv6EtherTypeFilter, &tcpFilter, &udpFilter, &icmpFilter, &igmpFilter, &greFilter, &arpFilter, &vlanProtoFilter,
+		&arpRequestFilter, &vlanFilter, &synFilter, &synAckFilter, &tcpWindowSizeFilter, &udpLengthFilter, &portSetFilter,
+		&subnetSetFilter, &webOrDnsFilter, &notWebOrDnsFilter, &qinqIcmpFilter
+	};
+	const size_t numOfFilters = sizeof(filters) / sizeof(filters[0]);
+
+	std::vector<std::string> filterStrings(numOfFilters);
+	std::vector<NativeFilter> nativeFilters(numOfFilters);
+	std::vector<int> matchCounts(numOfFilters, 0);
+	for (size_t filterIndex = 0; filterIndex < numOfFilters; filterIndex++)
+	{
+		filters[filterIndex]->parseToString(filterStrings[filterIndex]);
+		PTF_ASSERT(nativeFilters[filterIndex].compile(*filters[filterIndex]), "Cannot compile filter '%s' natively", filterStrings[filterIndex].c_str());
+	}
+
+	for (size_t fileIndex = 0; fileIndex < sizeof(AllPcapExampleFiles) / sizeof(AllPcapExampleFiles[0]); fileIndex++)
+	{
+		IFileReaderDevice* reader = IFileReaderDevice::getReader(AllPcapExampleFiles[fileIndex]);
+		PTF_ASSERT(reader->open(), "Cannot open '%s'", AllPcapExampleFiles[fileIndex]);
+		RawPacketVector packets;
+		reader->getNextPackets(packets);
+		reader->close();
+		delete reader;
+
+		for (size_t filterIndex = 0; filterIndex < numOfFilters; filterIndex++)
+		{
+			const char* filterAsString = filterStrings[filterIndex].c_str();
+			struct bpf_program program;
+			bool programCompiled = false;
+			int programLinkType = -1;
+			BpfJit jit;
+			BpfJit interpreter;
+
+			int packetIndex = 0;
+			for (RawPacketVector::VectorIterator iter = packets.begin(); iter != packets.end(); iter++, packetIndex++)
+			{
+				RawPacket* rawPacket = *iter;
+				LinkLayerType linkType = rawPacket->getLinkLayerType();
+
+				// the program is compiled per link type, since a pcap-ng file can mix them
+				int bpfLinkType = (linkType == LINKTYPE_RAW ? LINKTYPE_DLT_RAW1 : linkType);
+				if (bpfLinkType != programLinkType)
+				{
+					if (programCompiled)
+						pcap_freecode(&program);
+					programLinkType = bpfLinkType;
+					programCompiled = (pcap_compile_nopcap(9000, bpfLinkType, &program, filterAsString, 1, 0) == 0);
+					// some filters don't apply to some link types, for example MAC addresses to raw IP
+					if (!programCompiled)
+						continue;
+
+					PTF_ASSERT(jit.compile(&program), "Cannot JIT filter '%s'", filterAsString);
+					PTF_ASSERT(interpreter.compile(&program, false), "Cannot interpret filter '%s'", filterAsString);
+				}
 
-    PTF_ASSERT(fileReaderDev3.open(), "Cannot open file reader device for filter '%s'", filterAsString.c_str());
-    PTF_ASSERT(fileReaderDev3.setFilter(orFilter), "Could not set filter: %s", filterAsString.c_str());
-    fileReaderDev3.getNextPackets(rawPacketVec);
-    fileReaderDev3.close();
+				if (!programCompiled)
+					continue;
+
+				struct pcap_pkthdr pktHdr;
+				memset(&pktHdr, 0, sizeof(pktHdr));
+				pktHdr.caplen = rawPacket->getRawDataLen();
+				pktHdr.len = rawPacket->getFrameLength();
+				bool expected = (pcap_offline_filter(&program, &pktHdr, rawPacket->getRawData()) != 0);
+				PTF_ASSERT(jit.matchPacket(rawPacket->getRawData(), pktHdr.caplen, pktHdr.len) == expected,
+						"JIT and libpcap disagree on filter '%s' in '%s' packet #%d", filterAsString, AllPcapExampleFiles[fileIndex], packetIndex);
+				PTF_ASSERT(interpreter.matchPacket(rawPacket->getRawData(), pktHdr.caplen, pktHdr.len) == expected,
+						"Interpreter and libpcap disagree on filter '%s' in '%s' packet #%d", filterAsString, AllPcapExampleFiles[fileIndex], packetIndex);
+
+				// the native filter supports Ethernet, Linux cooked capture and raw IP, on other link types it doesn't match anything
+				if (linkType == LINKTYPE_ETHERNET || linkType == LINKTYPE_LINUX_SLL || linkType == LINKTYPE_RAW ||
+						linkType == LINKTYPE_DLT_RAW1 || linkType == LINKTYPE_DLT_RAW2 || linkType == LINKTYPE_IPV4 || linkType == LINKTYPE_IPV6)
+				{
+					PTF_ASSERT(nativeFilters[filterIndex].matchPacket(rawPacket) == expected,
+							"Native filter and libpcap disagree on filter '%s' in '%s' packet #%d", filterAsString, AllPcapExampleFiles[fileIndex], packetIndex);
+				}
 
-	PTF_ASSERT(rawPacketVec.size() == 19, "Complex filter test: Captured less or more than 19 packets");
-	for (RawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
-	{
-		Packet packet(*iter);
-		if (packet.isPacketOfType(ARP))
-		{
-			continue;
-		}
-		else
-		{
-			PTF_ASSERT(packet.isPacketOfType(GRE), "Complex filter test: one of the captured packets isn't of type ARP or GRE");
-			PTF_ASSERT(packet.isPacketOfType(IPv4), "Complex filter test: one of the captured packets isn't of type IPv4");
-			IPv4Layer* ipv4Layer = packet.getLayerOfType<IPv4Layer>();
-			PTF_ASSERT(ipv4Layer->getSrcIpAddress() == IPv4Address(std::string("20.0.0.1"))
-					|| ipv4Layer->getDstIpAddress() == IPv4Address(std::string("20.0.0.1")),
-					"complex filter test: srcIP or dstIP is not 20.0.0.1");
-		}
+				if (expected)
+					matchCounts[filterIndex]++;
+			}
 
+			if (programCompiled)
+				pcap_freecode(&program);
+		}
 	}
-	rawPacketVec.clear();
+
+	// a filter that matches nothing wouldn't test much
+	for (size_t filterIndex = 0; filterIndex < numOfFilters; filterIndex++)
+		PTF_ASSERT(matchCounts[filterIndex] > 0, "Filter '%s' didn't match any packet", filterStrings[filterIndex].c_str());
 }
 
+
+
 PTF_TEST_CASE(TestSendPacket)
 {
 	PcapLiveDevice* liveDev = NULL;
@@ -2418,9 +4013,49 @@ PTF_TEST_CASE(TestSendPackets)
 
     PTF_ASSERT(packetsSentAsRaw == packetsRead, "Not all packets were sent as raw. Expected (read from file): %d; Sent: %d", packetsRead, packetsSentAsRaw);
     PTF_ASSERT(packetsSentAsParsed == packetsRead, "Not all packets were sent as parsed. Expected (read from file): %d; Sent: %d", packetsRead, packetsSentAsParsed);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().packetsSent, packetsRead, int);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().firstFailedIndex, -1, int);
+
+    //send a vector which contains an invalid packet, make sure the rest are sent and the failure is reported
+    RawPacketVector rawPacketVec;
+    int oversizedPacketLen = liveDev->getMtu() + 100;
+    uint8_t* oversizedPacketData = new uint8_t[oversizedPacketLen];
+    memset(oversizedPacketData, 0, oversizedPacketLen);
+    timeval time;
+    gettimeofday(&time, NULL);
+    for (int i = 0; i < 100; i++)
+    {
+    	if (i == 50)
+    		rawPacketVec.pushBack(new RawPacket(oversizedPacketData, oversizedPacketLen, time, true));
+    	rawPacketVec.pushBack(new RawPacket(rawPacketArr[i % packetsRead]));
+    }
+    LoggerPP::getInstance().supressErrors();
+    int packetsSentAsVector = liveDev->sendPackets(rawPacketVec);
+    LoggerPP::getInstance().enableErrors();
+    PTF_ASSERT_EQUAL(packetsSentAsVector, 100, int);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().packetsInvalid, 1, int);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().packetsFailed, 0, int);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().firstFailedIndex, 50, int);
+
+    //send with a rate limit of 1000 packets per second, 200 packets should take at least ~200ms
+    liveDev->setSendRateLimit(1000);
+    long startSec = 0, startNSec = 0, endSec = 0, endNSec = 0;
+    clockGetTime(startSec, startNSec);
+    PTF_ASSERT_EQUAL(liveDev->sendPackets(rawPacketArr, 200), 200, int);
+    clockGetTime(endSec, endNSec);
+    liveDev->setSendRateLimit(0);
+    long elapsedMSec = (endSec - startSec) * 1000 + (endNSec - startNSec) / 1000000;
+    PTF_ASSERT(elapsedMSec >= 180, "Rate limited send of 200 packets at 1000pps took only %ldms", elapsedMSec);
 
     liveDev->close();
     fileReaderDev.close();
+
+    //sending on a closed device fails all packets
+    LoggerPP::getInstance().supressErrors();
+    PTF_ASSERT_EQUAL(liveDev->sendPackets(rawPacketArr, 10), 0, int);
+    LoggerPP::getInstance().enableErrors();
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().packetsFailed, 10, int);
+    PTF_ASSERT_EQUAL(liveDev->getLastSendResult().firstFailedIndex, 0, int);
 }
 
 PTF_TEST_CASE(TestRemoteCapture)
@@ -2871,7 +4506,7 @@ PTF_TEST_CASE(TestPfRingDeviceSingleChannel)
 }
 
 
-void TestPfRingDeviceMultiThread(int& ptfResult, CoreMask coreMask)
+void TestPfRingDeviceMultiThread(int& ptfResult, const CoreMask& coreMask)
 {
 #ifdef USE_PF_RING
 	PfRingDeviceList& devList = PfRingDeviceList::getInstance();
@@ -2885,17 +4520,12 @@ void TestPfRingDeviceMultiThread(int& ptfResult, CoreMask coreMask)
 	PTF_ASSERT(dev->getNumOfOpenedRxChannels() == 0, "There are still open RX channels after device close");
 	int totalnumOfCores = getNumOfCores();
 	int numOfCoresInUse = 0;
-	CoreMask tempCoreMaske = coreMask;
-	int i = 0;
-	while ((tempCoreMaske != 0) && (i < totalnumOfCores))
+	for (int i = 0; i < totalnumOfCores; i++)
 	{
-		if (tempCoreMaske & 1)
+		if (coreMask.isCoreSet(i))
 		{
 			numOfCoresInUse++;
 		}
-
-		tempCoreMaske = tempCoreMaske >> 1;
-		i++;
 	}
 
 	PTF_ASSERT(dev->openMultiRxChannels((uint8_t)numOfCoresInUse, PfRingDevice::PerFlow) == true, "Couldn't open device with %d channels", totalnumOfCores);
@@ -2910,7 +4540,7 @@ void TestPfRingDeviceMultiThread(int& ptfResult, CoreMask coreMask)
 	PfRingDevice::PfRingStats stats;
 	for (int i = 0; i < totalnumOfCores; i++)
 	{
-		if ((SystemCores::IdToSystemCore[i].Mask & coreMask) == 0)
+		if (!coreMask.isCoreSet(i))
 			continue;
 
 		PTF_PRINT_VERBOSE("Thread ID: %d", packetDataMultiThread[i].ThreadId);
@@ -3372,7 +5002,7 @@ PTF_TEST_CASE(TestDpdkInitDevice)
 	CoreMask coreMask = 0;
 	for (int i = 0; i < getNumOfCores(); i++)
 		coreMask |= SystemCores::IdToSystemCore[i].Mask;
-	PTF_ASSERT_TRUE(DpdkDeviceList::initDpdk(coreMask, 16383));
+	PTF_ASSERT_TRUE(DpdkDeviceList::initDpdk(coreMask, 16383, 0, PcapGlobalArgs.dpdkEalArgs));
 	PTF_ASSERT(devList.getDpdkDeviceList().size() > 0, "No DPDK devices");
 
 	PTF_ASSERT_EQUAL(devList.getDpdkLogLevel(), LoggerPP::Normal, enum);
@@ -3548,7 +5178,7 @@ PTF_TEST_CASE(TestDpdkMultiThread)
 
 	for (int i = 0; i < getNumOfCores(); i++)
 	{
-		if ((SystemCores::IdToSystemCore[i].Mask & coreMask) == 0)
+		if (!coreMask.isCoreSet(i))
 			continue;
 
 		PTF_PRINT_VERBOSE("Thread ID: %d", packetDataMultiThread[i].ThreadId);
@@ -3581,12 +5211,12 @@ PTF_TEST_CASE(TestDpdkMultiThread)
 
 	for (int firstCoreId = 0; firstCoreId < getNumOfCores(); firstCoreId++)
 	{
-		if ((SystemCores::IdToSystemCore[firstCoreId].Mask & coreMask) == 0)
+		if (!coreMask.isCoreSet(firstCoreId))
 			continue;
 
 		for (int secondCoreId = firstCoreId+1; secondCoreId < getNumOfCores(); secondCoreId++)
 		{
-			if ((SystemCores::IdToSystemCore[secondCoreId].Mask & coreMask) == 0)
+			if (!coreMask.isCoreSet(secondCoreId))
 				continue;
 
 			map<uint32_t, pair<RawPacketVector, RawPacketVector> > res;
@@ -4183,6 +5813,12 @@ PTF_TEST_CASE(TestKniDeviceSendReceive)
 		device->stopCapture();
 		PTF_PRINT_VERBOSE("KNI have captured %u packets in single burst on device " KNI_TEST_NAME, counter, KNI::DEVICE1);
 		counter = 0;
+		// back off quickly so the capture thread sleeps while the device is idle
+		KniDevice::KniPollingConfiguration pollingConfig;
+		pollingConfig.idleSpinIterations = 100;
+		pollingConfig.maxSleepNanoSeconds = 100000;
+		device->setPollingConfiguration(pollingConfig);
+		PTF_ASSERT_EQUAL(device->getPollingConfiguration().idleSpinIterations, 100, u32);
 		PTF_ASSERT(device->startCapture(KniRequestsCallbacksMock::onPacketsCallback, &counter),
 			"KNI failed to start capturing thread on device " KNI_TEST_NAME, KNI::DEVICE1);
 		PCAP_SLEEP(1); // Give some time to start capture thread
@@ -4207,6 +5843,11 @@ PTF_TEST_CASE(TestKniDeviceSendReceive)
 		PCAP_SLEEP(1); // Give some time to receive packets
 		device->stopCapture();
 		PTF_PRINT_VERBOSE("KNI have captured %u packets on device " KNI_TEST_NAME, counter, KNI::DEVICE1);
+		KniDevice::KniCaptureStats captureStats;
+		device->getCaptureStats(captureStats);
+		PTF_ASSERT_EQUAL(captureStats.packets, counter, u32);
+		PTF_ASSERT_TRUE(captureStats.sleeps > 0);
+		device->setPollingConfiguration(KniDevice::KniPollingConfiguration());
 		counter = 0;
 		while (fileReaderDev.getNextPacket(rawPacket))
 		{
@@ -4316,6 +5957,235 @@ PTF_TEST_CASE(TestKniDeviceSendReceive)
 	
 }
 
+PTF_TEST_CASE(TestDpdkDeviceFilter)
+{
+#ifdef USE_DPDK
+	PTF_ASSERT(DpdkDeviceList::getInstance().getDpdkDeviceList().size() > 0, "Couldn't find DPDK device, please run the TestDpdkInitDevice test-case");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(dev->setFilter("this is not a filter"));
+	LoggerPP::getInstance().enableErrors();
+	PTF_ASSERT_TRUE(dev->getFilter() == "");
+
+	PTF_ASSERT(dev->open() == true, "Couldn't open DPDK device");
+
+	ProtoFilter protoFilter(IPv4);
+	PTF_ASSERT_TRUE(dev->setFilter(protoFilter));
+	PTF_ASSERT_TRUE(dev->getFilter() != "");
+
+	MBufRawPacketVector rawPacketVec;
+	int numOfAttempts = 0;
+	while (numOfAttempts < 20)
+	{
+		dev->receivePackets(rawPacketVec, 0);
+		PCAP_SLEEP(1);
+		if (rawPacketVec.size() > 0)
+			break;
+		numOfAttempts++;
+	}
+
+	PTF_ASSERT_AND_RUN_COMMAND(numOfAttempts < 20, dev->close(), "No IPv4 packets were received");
+
+	for (MBufRawPacketVector::VectorIterator iter = rawPacketVec.begin(); iter != rawPacketVec.end(); iter++)
+	{
+		Packet packet(*iter);
+		PTF_ASSERT_AND_RUN_COMMAND(packet.isPacketOfType(IPv4), dev->close(), "Received a non-IPv4 packet although filter was set");
+	}
+
+	DpdkDevice::RxQueueFilterStats filterStats;
+	PTF_ASSERT_TRUE(dev->getRxQueueFilterStats(0, filterStats));
+	PTF_ASSERT_EQUAL((int)filterStats.packetsMatched, (int)rawPacketVec.size(), int);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(dev->getRxQueueFilterStats(dev->getTotalNumOfRxQueues(), filterStats));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(dev->clearFilter());
+	PTF_ASSERT_TRUE(dev->getFilter() == "");
+	dev->close();
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkDeviceNumaPlacement)
+{
+#ifdef USE_DPDK
+	PTF_ASSERT(DpdkDeviceList::getInstance().getDpdkDeviceList().size() > 0, "Couldn't find DPDK device, please run the TestDpdkInitDevice test-case");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	PTF_ASSERT_TRUE(dev->getNumaNode() >= -1 && dev->getNumaNode() < getNumOfNumaNodes());
+	int masterCore = DpdkDeviceList::getInstance().getDpdkMasterCore().Id;
+	int masterCoreNumaNode = getNumaNodeOfCore(masterCore);
+	PTF_ASSERT_TRUE(dev->isCoreOnDeviceNumaNode(masterCore) == (dev->getNumaNode() < 0 || masterCoreNumaNode < 0 || masterCoreNumaNode == dev->getNumaNode()));
+
+	DpdkDevice::DpdkDeviceConfiguration config;
+	config.mBufPoolPerNumaNode = true;
+	PTF_ASSERT(dev->openMultiQueues(dev->getTotalNumOfRxQueues(), dev->getTotalNumOfTxQueues(), config) == true, "Cannot open DPDK device");
+
+	// an mbuf allocated on the master core is taken from one of the device pools
+	int mbufsInUse = dev->getAmountOfMbufsInUse();
+	MBufRawPacket* mBufRawPacket = new MBufRawPacket();
+	PTF_ASSERT_AND_RUN_COMMAND(mBufRawPacket->init(dev), dev->close(), "Couldn't init MBufRawPacket");
+	PTF_ASSERT_EQUAL(dev->getAmountOfMbufsInUse(), mbufsInUse + 1, int);
+	delete mBufRawPacket;
+	PTF_ASSERT_EQUAL(dev->getAmountOfMbufsInUse(), mbufsInUse, int);
+
+	// RX queues can't be assigned to the master core
+	std::vector<DpdkDevice*> devices;
+	devices.push_back(dev);
+	std::vector<RxQueueCoreAssignment> assignment;
+	CoreMask workerCores = getCoreMaskForAllMachineCores();
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(DpdkDeviceList::getInstance().assignRxQueuesToCores(devices, workerCores, assignment));
+	LoggerPP::getInstance().enableErrors();
+
+	workerCores.removeCore(masterCore);
+	if (workerCores.isEmpty())
+	{
+		dev->close();
+		PTF_SKIP_TEST("Not enough cores to assign RX queues to");
+	}
+
+	PTF_ASSERT_TRUE(DpdkDeviceList::getInstance().assignRxQueuesToCores(devices, workerCores, assignment));
+	PTF_ASSERT_EQUAL((int)assignment.size(), (int)dev->getNumOfOpenedRxQueues(), int);
+
+	// every RX queue is assigned to a core on the device NUMA node if there is one, and the queues are spread evenly between these cores
+	int numOfLocalCores = 0;
+	for (int coreId = 0; coreId <= workerCores.getHighestCoreId(); coreId++)
+	{
+		if (workerCores.isCoreSet(coreId) && dev->isCoreOnDeviceNumaNode(coreId))
+			numOfLocalCores++;
+	}
+
+	int maxQueuesPerCore = (numOfLocalCores > 0 ? (dev->getNumOfOpenedRxQueues() + numOfLocalCores - 1) / numOfLocalCores : dev->getNumOfOpenedRxQueues());
+	std::map<uint32_t, int> queuesPerCore;
+	for (size_t i = 0; i < assignment.size(); i++)
+	{
+		PTF_ASSERT_TRUE(assignment[i].device == dev);
+		PTF_ASSERT_EQUAL(assignment[i].rxQueueId, (uint16_t)i, u16);
+		PTF_ASSERT_TRUE(workerCores.isCoreSet(assignment[i].coreId));
+		PTF_ASSERT_TRUE(assignment[i].isCrossNuma == (numOfLocalCores == 0));
+		PTF_ASSERT_TRUE(assignment[i].isCrossNuma == !dev->isCoreOnDeviceNumaNode(assignment[i].coreId));
+		PTF_ASSERT_TRUE(++queuesPerCore[assignment[i].coreId] <= maxQueuesPerCore);
+	}
+
+	dev->close();
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(DpdkDeviceList::getInstance().assignRxQueuesToCores(devices, workerCores, assignment));
+	LoggerPP::getInstance().enableErrors();
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkPipeline)
+{
+#ifdef USE_DPDK
+	PTF_ASSERT(DpdkDeviceList::getInstance().getDpdkDeviceList().size() > 0, "Couldn't find DPDK device, please run the TestDpdkInitDevice test-case");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	// the pipeline needs 3 cores which aren't the master core: RX, worker and TX
+	std::vector<int> pipelineCores;
+	SystemCore masterCore = DpdkDeviceList::getInstance().getDpdkMasterCore();
+	for (int i = 0; i < getNumOfCores() && pipelineCores.size() < 3; i++)
+	{
+		if (i != masterCore.Id)
+			pipelineCores.push_back(i);
+	}
+
+	if (pipelineCores.size() < 3)
+	{
+		PTF_SKIP_TEST("Not enough cores for a pipeline");
+	}
+
+	PTF_ASSERT(dev->openMultiQueues(1, 1) == true, "Couldn't open DPDK device");
+
+	DpdkTestPipelineStage ipv4Stage;
+	DpdkPipelineConfig config;
+	config.rxQueues.push_back(DpdkPipelineConfig::RxQueueConfig(dev, 0));
+	config.workerStages.push_back(DpdkPipelineConfig::WorkerStageConfig("ipv4", &ipv4Stage));
+	config.txQueues.push_back(DpdkPipelineConfig::TxQueueConfig(dev, 0));
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(config.applyCoreMapping("unknown=1") == false, dev->close(), "Managed to map an unknown stage");
+	PTF_ASSERT_AND_RUN_COMMAND(config.applyCoreMapping("rx=a") == false, dev->close(), "Managed to apply a malformed core list");
+	PTF_ASSERT_AND_RUN_COMMAND(config.applyCoreMapping("rx") == false, dev->close(), "Managed to apply a mapping without cores");
+	LoggerPP::getInstance().enableErrors();
+
+	std::stringstream mapping;
+	mapping << "rx=" << pipelineCores[0] << "; ipv4=" << pipelineCores[1] << "; tx=" << pipelineCores[2];
+	PTF_ASSERT_AND_RUN_COMMAND(config.applyCoreMapping(mapping.str()) == true, dev->close(), "Couldn't apply core mapping '%s'", mapping.str().c_str());
+	PTF_ASSERT_EQUAL((int)config.rxQueues[0].coreId, pipelineCores[0], int);
+	PTF_ASSERT_EQUAL((int)config.workerStages[0].coreIds.size(), 1, int);
+	PTF_ASSERT_EQUAL((int)config.workerStages[0].coreIds[0], pipelineCores[1], int);
+	PTF_ASSERT_EQUAL((int)config.txQueues[0].coreId, pipelineCores[2], int);
+
+	// a core can't run two stages
+	DpdkPipelineConfig badConfig = config;
+	badConfig.txQueues[0].coreId = pipelineCores[1];
+	DpdkPipeline badPipeline(badConfig);
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(badPipeline.start() == false, dev->close(), "Managed to start a pipeline with a core shared between stages");
+	LoggerPP::getInstance().enableErrors();
+
+	DpdkPipeline pipeline(config);
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.start() == true, dev->close(), "Couldn't start pipeline");
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.isRunning() == true, pipeline.stop(); dev->close(), "Pipeline isn't running after start");
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.start() == false, pipeline.stop(); dev->close(), "Managed to start a running pipeline");
+	LoggerPP::getInstance().enableErrors();
+
+	PCAP_SLEEP(10);
+	pipeline.stop();
+	PTF_ASSERT_AND_RUN_COMMAND(pipeline.isRunning() == false, dev->close(), "Pipeline is still running after stop");
+
+	std::vector<DpdkPipeline::StageStats> stats;
+	pipeline.getStageStats(stats);
+	PTF_ASSERT_AND_RUN_COMMAND(stats.size() == 3, dev->close(), "Expected stats of 3 stages, got %d", (int)stats.size());
+
+	DpdkPipeline::StageStats& rxStats = stats[0];
+	DpdkPipeline::StageStats& workerStats = stats[1];
+	DpdkPipeline::StageStats& txStats = stats[2];
+	PTF_ASSERT_EQUAL(rxStats.type, DpdkPipeline::RxStage, enum);
+	PTF_ASSERT_EQUAL(workerStats.type, DpdkPipeline::WorkerStage, enum);
+	PTF_ASSERT_EQUAL(workerStats.name, "ipv4", string);
+	PTF_ASSERT_EQUAL(txStats.type, DpdkPipeline::TxStage, enum);
+
+	PTF_PRINT_VERBOSE("RX: in=%d out=%d dropped=%d", (int)rxStats.packetsIn, (int)rxStats.packetsOut, (int)rxStats.packetsDropped);
+	PTF_PRINT_VERBOSE("Worker: in=%d out=%d dropped=%d ring high watermark=%d", (int)workerStats.packetsIn, (int)workerStats.packetsOut, (int)workerStats.packetsDropped, (int)workerStats.ringHighWatermark);
+	PTF_PRINT_VERBOSE("TX: in=%d out=%d dropped=%d ring high watermark=%d", (int)txStats.packetsIn, (int)txStats.packetsOut, (int)txStats.packetsDropped, (int)txStats.ringHighWatermark);
+
+	PTF_ASSERT_AND_RUN_COMMAND(rxStats.packetsIn > 0, dev->close(), "Pipeline didn't receive any packets");
+	PTF_ASSERT_AND_RUN_COMMAND(rxStats.packetsIn == rxStats.packetsOut + rxStats.packetsDropped, dev->close(), "RX stage packet counters don't add up");
+	// packets may be left in the rings when the pipeline stops
+	PTF_ASSERT_AND_RUN_COMMAND(workerStats.packetsIn <= rxStats.packetsOut, dev->close(), "Worker stage got more packets than RX stage forwarded");
+	PTF_ASSERT_AND_RUN_COMMAND(workerStats.packetsIn == workerStats.packetsOut + workerStats.packetsDropped, dev->close(), "Worker stage packet counters don't add up");
+	PTF_ASSERT_AND_RUN_COMMAND(txStats.packetsIn <= workerStats.packetsOut, dev->close(), "TX stage got more packets than worker stage forwarded");
+	PTF_ASSERT_AND_RUN_COMMAND(txStats.packetsIn == txStats.packetsOut + txStats.packetsDropped, dev->close(), "TX stage packet counters don't add up");
+
+	for (std::vector<DpdkPipeline::StageStats>::iterator iter = stats.begin(); iter != stats.end(); iter++)
+	{
+		PTF_ASSERT_AND_RUN_COMMAND(iter->busyCycles <= iter->totalCycles, dev->close(), "Busy cycles of stage '%s' exceed total cycles", iter->name.c_str());
+		PTF_ASSERT_AND_RUN_COMMAND(iter->ringHighWatermark <= iter->ringCapacity, dev->close(), "Ring high watermark of stage '%s' exceeds ring capacity", iter->name.c_str());
+	}
+
+	PTF_ASSERT_EQUAL((int)rxStats.ringCapacity, 0, int);
+	PTF_ASSERT_EQUAL((int)workerStats.ringCapacity, 1023, int);
+
+	dev->close();
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
 PTF_TEST_CASE(TestDpdkMbufRawPacket)
 {
 #ifdef USE_DPDK
@@ -4500,6 +6370,156 @@ PTF_TEST_CASE(TestDpdkMbufRawPacket)
 #endif
 }
 
+PTF_TEST_CASE(TestDpdkMbufRawPacketChained)
+{
+#ifdef USE_DPDK
+	PTF_ASSERT(DpdkDeviceList::getInstance().getDpdkDeviceList().size() > 0, "Couldn't find DPDK device, please run the TestDpdkInitDevice test-case");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	PTF_ASSERT(dev->open() == true, "Cannot open DPDK device");
+
+	// find a UDP packet and extend it to a jumbo frame
+	PcapFileReaderDevice reader(EXAMPLE2_PCAP_PATH);
+	PTF_ASSERT_AND_RUN_COMMAND(reader.open(), dev->close(), "Cannot open file '%s'", EXAMPLE2_PCAP_PATH);
+	RawPacket udpRawPacket;
+	bool udpPacketFound = false;
+	while (!udpPacketFound && reader.getNextPacket(udpRawPacket))
+	{
+		Packet packet(&udpRawPacket);
+		udpPacketFound = packet.isPacketOfType(UDP);
+	}
+	reader.close();
+	PTF_ASSERT_AND_RUN_COMMAND(udpPacketFound, dev->close(), "Couldn't find a UDP packet");
+
+	const int jumboFrameLen = 9000;
+	int udpPacketLen = udpRawPacket.getRawDataLen();
+	std::vector<uint8_t> expectedData(jumboFrameLen);
+	memcpy(&expectedData[0], udpRawPacket.getRawData(), udpPacketLen);
+	for (int i = udpPacketLen; i < jumboFrameLen; i++)
+		expectedData[i] = (uint8_t)(i % 251);
+
+	// data larger than an mbuf is kept in a linear buffer and written to an mbuf chain when the mbuf is requested
+	MBufRawPacket jumboRawPacket;
+	PTF_ASSERT_AND_RUN_COMMAND(jumboRawPacket.init(dev), dev->close(), "Couldn't init MBufRawPacket");
+	uint8_t* jumboData = new uint8_t[jumboFrameLen];
+	memcpy(jumboData, &expectedData[0], jumboFrameLen);
+	PTF_ASSERT_TRUE(jumboRawPacket.setRawData(jumboData, jumboFrameLen, udpRawPacket.getPacketTimeStamp()));
+	PTF_ASSERT_EQUAL(jumboRawPacket.getRawDataLen(), jumboFrameLen, int);
+	PTF_ASSERT_TRUE(jumboRawPacket.isContiguous());
+	PTF_ASSERT_TRUE(memcmp(jumboRawPacket.getRawData(), &expectedData[0], jumboFrameLen) == 0);
+	PTF_ASSERT_TRUE(jumboRawPacket.getMBuf() != NULL);
+	PTF_ASSERT_TRUE(jumboRawPacket.getNumOfSegments() > 1);
+
+	{
+		Packet jumboPacket(&jumboRawPacket);
+		PTF_ASSERT_TRUE(jumboPacket.isPacketOfType(UDP));
+	}
+
+	// the copy c'tor copies the whole data
+	MBufRawPacket jumboRawPacketCopy(jumboRawPacket);
+	PTF_ASSERT_EQUAL(jumboRawPacketCopy.getRawDataLen(), jumboFrameLen, int);
+	PTF_ASSERT_TRUE(memcmp(jumboRawPacketCopy.getRawData(), &expectedData[0], jumboFrameLen) == 0);
+
+	// removing data shrinks the mbuf chain back to a single segment
+	PTF_ASSERT_TRUE(jumboRawPacket.removeData(udpPacketLen, jumboFrameLen - udpPacketLen));
+	PTF_ASSERT_EQUAL(jumboRawPacket.getRawDataLen(), udpPacketLen, int);
+	PTF_ASSERT_TRUE(jumboRawPacket.getMBuf() != NULL);
+	PTF_ASSERT_EQUAL(jumboRawPacket.getNumOfSegments(), 1, int);
+	PTF_ASSERT_TRUE(memcmp(jumboRawPacket.getRawData(), &expectedData[0], udpPacketLen) == 0);
+
+	// appending data beyond the mbuf size builds an mbuf chain again
+	MBufRawPacket appendedRawPacket;
+	PTF_ASSERT_AND_RUN_COMMAND(appendedRawPacket.initFromRawPacket(&udpRawPacket, dev), dev->close(), "Couldn't init MBufRawPacket from RawPacket");
+	PTF_ASSERT_EQUAL(appendedRawPacket.getNumOfSegments(), 1, int);
+	appendedRawPacket.appendData(&expectedData[udpPacketLen], jumboFrameLen - udpPacketLen);
+	PTF_ASSERT_EQUAL(appendedRawPacket.getRawDataLen(), jumboFrameLen, int);
+	PTF_ASSERT_TRUE(memcmp(appendedRawPacket.getRawData(), &expectedData[0], jumboFrameLen) == 0);
+	PTF_ASSERT_TRUE(appendedRawPacket.getMBuf() != NULL);
+	PTF_ASSERT_TRUE(appendedRawPacket.getNumOfSegments() > 1);
+
+	dev->close();
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
+PTF_TEST_CASE(TestDpdkTxContext)
+{
+#ifdef USE_DPDK
+	PTF_ASSERT(DpdkDeviceList::getInstance().getDpdkDeviceList().size() > 0, "Couldn't find DPDK device, please run the TestDpdkInitDevice test-case");
+
+	DpdkDevice* dev = DpdkDeviceList::getInstance().getDeviceByPort(PcapGlobalArgs.dpdkPort);
+	PTF_ASSERT(dev != NULL, "DpdkDevice is NULL");
+
+	// a context for a TX queue the device doesn't have is invalid
+	DpdkTxContext invalidContext(dev, dev->getTotalNumOfTxQueues());
+	PTF_ASSERT_FALSE(invalidContext.isValid());
+
+	PTF_ASSERT(dev->open() == true, "Cannot open DPDK device");
+	dev->clearStatistics();
+
+	PcapFileReaderDevice reader(EXAMPLE2_PCAP_PATH);
+	PTF_ASSERT_AND_RUN_COMMAND(reader.open(), dev->close(), "Cannot open file '%s'", EXAMPLE2_PCAP_PATH);
+	RawPacketVector rawPacketVec;
+	reader.getNextPackets(rawPacketVec, 100);
+	reader.close();
+	PTF_ASSERT_AND_RUN_COMMAND(rawPacketVec.size() == 100, dev->close(), "Couldn't read 100 packets from file");
+
+	uint64_t packetsAdded = 0;
+	{
+		// the timeout is long enough that bursts are flushed only when they're full
+		DpdkTxContext txContext(dev, 0, 32, 1000000);
+		PTF_ASSERT_TRUE(txContext.isValid());
+		PTF_ASSERT_EQUAL(txContext.getBurstSize(), 32, u16);
+
+		// RawPackets are copied to new mbufs, MBufRawPackets hand their mbufs over
+		for (int i = 0; i < 50; i++)
+		{
+			if (txContext.sendPacket(*rawPacketVec.at(i)))
+				packetsAdded++;
+		}
+
+		MBufRawPacket mBufRawPackets[50];
+		for (int i = 0; i < 50; i++)
+		{
+			PTF_ASSERT_AND_RUN_COMMAND(mBufRawPackets[i].initFromRawPacket(rawPacketVec.at(50 + i), dev), dev->close(), "Couldn't init MBufRawPacket");
+			Packet packet(&mBufRawPackets[i]);
+			if (txContext.sendPacket(packet))
+				packetsAdded++;
+		}
+
+		// 3 full bursts were flushed and 4 packets are pending
+		PTF_ASSERT_EQUAL(packetsAdded, 100, u32);
+		PTF_ASSERT_EQUAL(txContext.getNumOfPendingPackets(), 4, u16);
+		PTF_ASSERT_EQUAL(txContext.getPacketsSent() + txContext.getPacketsDropped(), 96, u32);
+
+		// the timeout didn't expire yet
+		PTF_ASSERT_EQUAL(txContext.flushIfExpired(), 0, u16);
+		PTF_ASSERT_EQUAL(txContext.getNumOfPendingPackets(), 4, u16);
+
+		txContext.flush();
+		PTF_ASSERT_EQUAL(txContext.getNumOfPendingPackets(), 0, u16);
+		PTF_ASSERT_EQUAL(txContext.getPacketsSent() + txContext.getPacketsDropped(), 100, u32);
+
+		// packets dropped by the context are counted in the device statistics of the TX queue
+		DpdkDevice::DpdkDeviceStats stats;
+		dev->getStatistics(stats);
+		PTF_ASSERT_EQUAL(stats.txDroppedPackets[0], txContext.getPacketsDropped(), u32);
+
+		// pending packets are flushed when the context is destroyed. The MBufRawPackets are destroyed before it and must not free
+		// the mbufs they handed over
+		PTF_ASSERT_TRUE(txContext.sendPacket(*rawPacketVec.at(0)));
+		PTF_ASSERT_EQUAL(txContext.getNumOfPendingPackets(), 1, u16);
+	}
+
+	dev->close();
+#else
+	PTF_SKIP_TEST("DPDK not configured");
+#endif
+}
+
 PTF_TEST_CASE(TestGetMacAddress)
 {
 	PcapLiveDevice* liveDev = NULL;
@@ -4566,8 +6586,8 @@ struct TcpReassemblyStats
 
 typedef struct
 {
-	typedef std::vector<uint32_t> FlowKeysList;
-	typedef std::map<uint32_t, TcpReassemblyStats> Stats;
+	typedef std::vector<FlowKey> FlowKeysList;
+	typedef std::map<FlowKey, TcpReassemblyStats> Stats;
 
 	Stats stats;
 	FlowKeysList flowKeysList;
@@ -4580,6 +6600,18 @@ typedef struct
 
 } TcpReassemblyMultipleConnStats;
 
+// stats are ordered by FlowKey, so tests with several connections look them up by the client port
+TcpReassemblyMultipleConnStats::Stats::iterator tcpReassemblyFindConnBySrcPort(TcpReassemblyMultipleConnStats::Stats& stats, uint16_t srcPort)
+{
+	for (TcpReassemblyMultipleConnStats::Stats::iterator iter = stats.begin(); iter != stats.end(); iter++)
+	{
+		if (iter->second.connData.srcPort == srcPort)
+			return iter;
+	}
+
+	return stats.end();
+}
+
 std::string readFileIntoString(std::string fileName)
 {
 	std::ifstream infile(fileName.c_str(), std::ios::binary);
@@ -4617,7 +6649,7 @@ void tcpReassemblyMsgReadyCallback(int sideIndex, const TcpStreamData& tcpData,
 
 	iter->second.numOfDataPackets++;
 	iter->second.reassembledData += std::string((char*)tcpData.getData(), tcpData.getDataLength());
-	//printf("\n***** got %d bytes from side %d conn 0x%X *****\n", tcpData.getDataLength(), sideIndex, tcpData.getConnectionData().flowKey);
+	//printf("\n***** got %d bytes from side %d conn %s *****\n", tcpData.getDataLength(), sideIndex, tcpData.getConnectionData().flowKey.toString().c_str());
 }
 
 void tcpReassemblyConnectionStartCallback(const ConnectionData& connectionData, void* userCookie)
@@ -4638,7 +6670,7 @@ void tcpReassemblyConnectionStartCallback(const ConnectionData& connectionData,
 	iter->second.connectionsStarted = true;
 	iter->second.connData = connectionData;
 
-	//printf("conn 0x%X started\n", connectionData.flowKey);
+	//printf("conn %s started\n", connectionData.flowKey.toString().c_str());
 }
 
 void tcpReassemblyConnectionEndCallback(const ConnectionData& connectionData, TcpReassembly::ConnectionEndReason reason, void* userCookie)
@@ -4661,7 +6693,7 @@ void tcpReassemblyConnectionEndCallback(const ConnectionData& connectionData, Tc
 	else
 		iter->second.connectionsEnded = true;
 
-	//printf("conn 0x%X ended\n", connectionData.flowKey);
+	//printf("conn %s ended\n", connectionData.flowKey.toString().c_str());
 }
 
 bool tcpReassemblyReadPcapIntoPacketVec(std::string pcapFileName, std::vector<RawPacket>& packetStream, std::string& errMsg)
@@ -5134,7 +7166,8 @@ PTF_TEST_CASE(TestTcpReassemblyMultipleConns)
 	PTF_ASSERT(stats.size() == 3, "Num of connections isn't 3");
 	PTF_ASSERT(results.flowKeysList.size() == 3, "Num of flow keys isn't 3");
 
-	TcpReassemblyMultipleConnStats::Stats::iterator iter = stats.begin();
+	TcpReassemblyMultipleConnStats::Stats::iterator iter = tcpReassemblyFindConnBySrcPort(stats, 44305);
+	PTF_ASSERT(iter != stats.end(), "Conn #1: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 2, "Conn #1: Num of data packets isn't 2, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 1, "Conn #1: Num of messages from side 0 isn't 1");
@@ -5145,7 +7178,8 @@ PTF_TEST_CASE(TestTcpReassemblyMultipleConns)
 	expectedReassemblyData = readFileIntoString(std::string("PcapExamples/three_http_streams_conn_1_output.txt"));
 	PTF_ASSERT(expectedReassemblyData == iter->second.reassembledData, "Conn #1: Reassembly data different than expected");
 
-	iter++;
+	iter = tcpReassemblyFindConnBySrcPort(stats, 52328);
+	PTF_ASSERT(iter != stats.end(), "Conn #2: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 2, "Conn #2: Num of data packets isn't 2, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 1, "Conn #2: Num of messages from side 0 isn't 1");
@@ -5156,7 +7190,8 @@ PTF_TEST_CASE(TestTcpReassemblyMultipleConns)
 	expectedReassemblyData = readFileIntoString(std::string("PcapExamples/three_http_streams_conn_2_output.txt"));
 	PTF_ASSERT(expectedReassemblyData == iter->second.reassembledData, "Conn #2: Reassembly data different than expected");
 
-	iter++;
+	iter = tcpReassemblyFindConnBySrcPort(stats, 54615);
+	PTF_ASSERT(iter != stats.end(), "Conn #3: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 2, "Conn #3: Num of data packets isn't 2, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 1, "Conn #3: Num of messages from side 0 isn't 1");
@@ -5184,7 +7219,7 @@ PTF_TEST_CASE(TestTcpReassemblyMultipleConns)
 	PTF_ASSERT(tcpReassembly.isConnectionOpen(iterConn3->second) == 0, "Connection #3 is still open");
 
 	ConnectionData dummyConn;
-	dummyConn.flowKey = 0x12345678;
+	dummyConn.flowKey = FlowKey(IPv4Address(std::string("1.2.3.4")), IPv4Address(std::string("5.6.7.8")), PACKETPP_IPPROTO_TCP, 1234, 5678);
 	PTF_ASSERT(tcpReassembly.isConnectionOpen(dummyConn) < 0, "Dummy connection exists");
 
 
@@ -5257,7 +7292,8 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	TcpReassemblyMultipleConnStats::Stats &stats = tcpReassemblyResults.stats;
 	PTF_ASSERT(stats.size() == 4, "Num of connections isn't 4");
 
-	TcpReassemblyMultipleConnStats::Stats::iterator iter = stats.begin();
+	TcpReassemblyMultipleConnStats::Stats::iterator iter = tcpReassemblyFindConnBySrcPort(stats, 35995);
+	PTF_ASSERT(iter != stats.end(), "Conn #1: Connection not found");
 
 	IPv6Address expectedSrcIP(std::string("2001:618:400::5199:cc70"));
 	IPv6Address expectedDstIP1(std::string("2001:618:1:8000::5"));
@@ -5281,7 +7317,8 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	expectedReassemblyData = readFileIntoString(std::string("PcapExamples/one_ipv6_http_stream4.txt"));
 	PTF_ASSERT(expectedReassemblyData == iter->second.reassembledData, "Conn #1: Reassembly data different than expected");
 
-	iter++;
+	iter = tcpReassemblyFindConnBySrcPort(stats, 35999);
+	PTF_ASSERT(iter != stats.end(), "Conn #2: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 10, "Conn #2: Num of data packets isn't 10, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 1, "Conn #2: Num of messages from side 0 isn't 1");
@@ -5299,7 +7336,8 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	PTF_ASSERT(stats.begin()->second.connData.endTime.tv_sec == 0, "Bad end time seconds, expected 0");
 	PTF_ASSERT(stats.begin()->second.connData.endTime.tv_usec == 0, "Bad end time microseconds, expected 0");
 
-	iter++;
+	iter = tcpReassemblyFindConnBySrcPort(stats, 40426);
+	PTF_ASSERT(iter != stats.end(), "Conn #3: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 2, "Conn #3: Num of data packets isn't 2, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 1, "Conn #3: Num of messages from side 0 isn't 1");
@@ -5319,7 +7357,8 @@ PTF_TEST_CASE(TestTcpReassemblyIPv6MultConns)
 	expectedReassemblyData = readFileIntoString(std::string("PcapExamples/one_ipv6_http_stream3.txt"));
 	PTF_ASSERT(expectedReassemblyData == iter->second.reassembledData, "Conn #3: Reassembly data different than expected");
 
-	iter++;
+	iter = tcpReassemblyFindConnBySrcPort(stats, 35997);
+	PTF_ASSERT(iter != stats.end(), "Conn #4: Connection not found");
 
 	PTF_ASSERT(iter->second.numOfDataPackets == 13, "Conn #4: Num of data packets isn't 13, it's %d", iter->second.numOfDataPackets);
 	PTF_ASSERT(iter->second.numOfMessagesFromSide[0] == 4, "Conn #4: Num of messages from side 0 isn't 4");
@@ -5530,6 +7569,85 @@ PTF_TEST_CASE(TestGeneralUtils)
 } // TestGeneralUtils
 
 
+PTF_TEST_CASE(TestCoreMask)
+{
+	// backward compatible integer masks
+	CoreMask coreMask = 0x6;
+	PTF_ASSERT_FALSE(coreMask.isCoreSet(0));
+	PTF_ASSERT_TRUE(coreMask.isCoreSet(1));
+	PTF_ASSERT_TRUE(coreMask.isCoreSet(2));
+	PTF_ASSERT_EQUAL(coreMask.getCoreCount(), 2, int);
+	PTF_ASSERT_EQUAL(coreMask.getHighestCoreId(), 2, int);
+	PTF_ASSERT_TRUE(coreMask == (SystemCores::Core1.Mask | SystemCores::Core2.Mask));
+	PTF_ASSERT_TRUE(coreMask & SystemCores::Core1.Mask);
+	PTF_ASSERT_FALSE(coreMask & SystemCores::Core0.Mask);
+	PTF_ASSERT_TRUE((coreMask & SystemCores::Core0.Mask) == 0);
+	PTF_ASSERT_TRUE((coreMask & ~SystemCores::Core1.Mask) == 0x4);
+	PTF_ASSERT_TRUE(coreMask != 0);
+	PTF_ASSERT_EQUAL((uint32_t)coreMask.getLowCoresMask(), 0x6, u32);
+
+	// cores beyond the first 32 and 64 cores
+	coreMask.addCore(40);
+	coreMask.addCore(127);
+	PTF_ASSERT_TRUE(coreMask.isCoreSet(127));
+	PTF_ASSERT_FALSE(coreMask.isCoreSet(126));
+	PTF_ASSERT_FALSE(coreMask.isCoreSet(1000));
+	PTF_ASSERT_EQUAL(coreMask.getCoreCount(), 4, int);
+	PTF_ASSERT_EQUAL(coreMask.getHighestCoreId(), 127, int);
+	PTF_ASSERT_EQUAL(coreMask.toHexString(), "80000000000000000000010000000006", string);
+	PTF_ASSERT_TRUE(SystemCores::IdToSystemCore[127].Mask.isCoreSet(127));
+	PTF_ASSERT_EQUAL(SystemCores::IdToSystemCore[MAX_NUM_OF_CORES - 1].Id, MAX_NUM_OF_CORES - 1, u16);
+	PTF_ASSERT_TRUE((coreMask & SystemCores::IdToSystemCore[40].Mask) == SystemCores::IdToSystemCore[40].Mask);
+
+	CoreMask parsedCoreMask;
+	PTF_ASSERT_TRUE(CoreMask::fromHexString("0x80000000000000000000010000000006", parsedCoreMask));
+	PTF_ASSERT_TRUE(parsedCoreMask == coreMask);
+	PTF_ASSERT_FALSE(CoreMask::fromHexString("0x", parsedCoreMask));
+	PTF_ASSERT_FALSE(CoreMask::fromHexString("12g4", parsedCoreMask));
+	// core 256 is beyond MAX_NUM_OF_CORES, leading zeros are not
+	PTF_ASSERT_FALSE(CoreMask::fromHexString("1" + std::string(MAX_NUM_OF_CORES / 4, '0'), parsedCoreMask));
+	PTF_ASSERT_TRUE(CoreMask::fromHexString("0" + std::string(MAX_NUM_OF_CORES / 4, '0'), parsedCoreMask));
+	PTF_ASSERT_TRUE(parsedCoreMask.isEmpty());
+	PTF_ASSERT_EQUAL((~parsedCoreMask).getCoreCount(), MAX_NUM_OF_CORES, int);
+
+	coreMask.removeCore(127);
+	coreMask.removeCore(40);
+	PTF_ASSERT_TRUE(coreMask == CoreMask(0x6));
+	PTF_ASSERT_TRUE(coreMask != CoreMask(0x7));
+	coreMask &= CoreMask(0x1);
+	PTF_ASSERT_TRUE(coreMask.isEmpty());
+	PTF_ASSERT_EQUAL(coreMask.getHighestCoreId(), -1, int);
+	PTF_ASSERT_EQUAL(coreMask.toHexString(), "0", string);
+
+	std::vector<int> coreIds;
+	coreIds.push_back(3);
+	coreIds.push_back(100);
+	std::vector<SystemCore> coreVec;
+	createCoreVectorFromCoreMask(createCoreMaskFromCoreIds(coreIds), coreVec);
+	PTF_ASSERT_EQUAL(coreVec.size(), 2, size);
+	PTF_ASSERT_EQUAL(coreVec[0].Id, 3, u16);
+	PTF_ASSERT_EQUAL(coreVec[1].Id, 100, u16);
+
+	// NUMA: every machine core belongs to exactly one NUMA node
+	int numOfCores = getNumOfCores() < MAX_NUM_OF_CORES ? getNumOfCores() : MAX_NUM_OF_CORES;
+	PTF_ASSERT_EQUAL(getCoreMaskForAllMachineCores().getCoreCount(), numOfCores, int);
+	PTF_ASSERT_TRUE(getNumOfNumaNodes() >= 1);
+	CoreMask allNumaCores;
+	int numOfNumaCores = 0;
+	for (int node = 0; node < getNumOfNumaNodes(); node++)
+	{
+		CoreMask nodeCores = getCoreMaskForNumaNode(node);
+		numOfNumaCores += nodeCores.getCoreCount();
+		allNumaCores |= nodeCores;
+	}
+	PTF_ASSERT_EQUAL(numOfNumaCores, numOfCores, int);
+	PTF_ASSERT_TRUE(allNumaCores == getCoreMaskForAllMachineCores());
+	PTF_ASSERT_TRUE(getNumaNodeOfCore(0) >= 0);
+	PTF_ASSERT_EQUAL(getNumaNodeOfCore(-1), -1, int);
+	PTF_ASSERT_EQUAL(getNumaNodeOfCore(getNumOfCores()), -1, int);
+} // TestCoreMask
+
+
 void savePacketToFile(RawPacket& packet, std::string fileName)
 {
 	PcapFileWriterDevice writerDev(fileName.c_str());
@@ -6710,6 +8828,114 @@ PTF_TEST_CASE(TestRawSockets)
 
 
 
+PTF_TEST_CASE(TestRawSocketKernelFilter)
+{
+#if defined(LINUX)
+	// the filter is checked on the loopback interface: one socket sends UDP packets to 2 ports and another socket, filtered by one of
+	// the ports, must receive only the packets sent to that port
+	IPv4Address loopbackAddress(std::string("127.0.0.1"));
+	RawSocketDevice rawSock(loopbackAddress);
+	RawSocketDevice senderSock(loopbackAddress);
+
+	ProtoFilter udpFilter(UDP);
+	PortFilter portFilter(40001, DST);
+	std::vector<GeneralFilter*> filters;
+	filters.push_back(&udpFilter);
+	filters.push_back(&portFilter);
+	AndFilter andFilter(filters);
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(rawSock.setFilter(andFilter));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(rawSock.open());
+	PTF_ASSERT_TRUE(senderSock.open());
+
+	LoggerPP::getInstance().supressErrors();
+	PTF_ASSERT_FALSE(rawSock.setFilter("no such filter syntax"));
+	LoggerPP::getInstance().enableErrors();
+
+	PTF_ASSERT_TRUE(rawSock.setFilter(andFilter));
+
+	RawPacketVector packetsToSend;
+	for (int i = 0; i < 20; i++)
+	{
+		Packet packet(100);
+		EthLayer ethLayer(MacAddress::Zero, MacAddress::Zero, PCPP_ETHERTYPE_IP);
+		IPv4Layer ipLayer(loopbackAddress, loopbackAddress);
+		ipLayer.getIPv4Header()->timeToLive = 64;
+		UdpLayer udpLayer(40000, (i % 2 == 0 ? 40001 : 40002));
+		uint8_t payload[16] = { 0 };
+		PayloadLayer payloadLayer(payload, sizeof(payload), false);
+		packet.addLayer(&ethLayer);
+		packet.addLayer(&ipLayer);
+		packet.addLayer(&udpLayer);
+		packet.addLayer(&payloadLayer);
+		packet.computeCalculateFields();
+		packetsToSend.pushBack(new RawPacket(*packet.getRawPacket()));
+	}
+	PTF_ASSERT_EQUAL(senderSock.sendPackets(packetsToSend), 20, int);
+
+	// the packets are looped back before sendPackets() returns. Only the packets that passed the kernel filter are queued on the socket
+	int matchingPackets = 0;
+	RawPacket rawPacket;
+	while (rawSock.receivePacket(rawPacket, false) == RawSocketDevice::RecvSuccess)
+	{
+		Packet packet(&rawPacket);
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		PTF_ASSERT_NOT_NULL(udpLayer);
+		PTF_ASSERT_EQUAL(be16toh(udpLayer->getUdpHeader()->portDst), 40001, int);
+		matchingPackets++;
+	}
+	PTF_ASSERT_TRUE(matchingPackets >= 10);
+
+	// without the filter the packets to the other port are received as well
+	PTF_ASSERT_TRUE(rawSock.clearFilter());
+	PTF_ASSERT_EQUAL(senderSock.sendPackets(packetsToSend), 20, int);
+	int otherPortPackets = 0;
+	while (rawSock.receivePacket(rawPacket, false) == RawSocketDevice::RecvSuccess)
+	{
+		Packet packet(&rawPacket);
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		if (udpLayer != NULL && be16toh(udpLayer->getUdpHeader()->portDst) == 40002)
+			otherPortPackets++;
+	}
+	PTF_ASSERT_TRUE(otherPortPackets >= 10);
+
+	// the BPF string of a port set limited to 1 term is a port range that covers both ports. The kernel lets the packets to the other
+	// port through and the post filter drops them, and a port removed from the set stops matching without setting the filter again
+	PortSetFilter portSetFilter(DST);
+	portSetFilter.addPort(40001);
+	portSetFilter.addPort(40003);
+	portSetFilter.setMaxBpfTerms(1);
+	PTF_ASSERT_FALSE(portSetFilter.isBpfExact());
+	PTF_ASSERT_TRUE(rawSock.setFilter(portSetFilter));
+	PTF_ASSERT_EQUAL(senderSock.sendPackets(packetsToSend), 20, int);
+	int portSetPackets = 0;
+	while (rawSock.receivePacket(rawPacket, false) == RawSocketDevice::RecvSuccess)
+	{
+		Packet packet(&rawPacket);
+		UdpLayer* udpLayer = packet.getLayerOfType<UdpLayer>();
+		PTF_ASSERT_NOT_NULL(udpLayer);
+		PTF_ASSERT_EQUAL(be16toh(udpLayer->getUdpHeader()->portDst), 40001, int);
+		portSetPackets++;
+	}
+	PTF_ASSERT_TRUE(portSetPackets >= 10);
+
+	PTF_ASSERT_TRUE(portSetFilter.removePort(40001));
+	PTF_ASSERT_EQUAL(senderSock.sendPackets(packetsToSend), 20, int);
+	PTF_ASSERT_TRUE(rawSock.receivePacket(rawPacket, false) != RawSocketDevice::RecvSuccess);
+
+	senderSock.close();
+	rawSock.close();
+#else
+	PTF_SKIP_TEST("Filters on raw sockets are supported on Linux only");
+#endif
+}
+
+
+
+
 
 
 static struct option PcapTestOptions[] =
@@ -6719,6 +8945,7 @@ static struct option PcapTestOptions[] =
 	{"remote-ip", required_argument, 0, 'r'},
 	{"remote-port", required_argument, 0, 'p'},
 	{"dpdk-port", required_argument, 0, 'k' },
+	{"dpdk-eal-arg", required_argument, 0, 'e' },
 	{"no-networking", no_argument, 0, 'n' },
 	{"verbose", no_argument, 0, 'v' },
 	{"mem-verbose", no_argument, 0, 'm' },
@@ -6730,13 +8957,15 @@ static struct option PcapTestOptions[] =
 
 void print_usage()
 {
-    printf("Usage: Pcap++Test -i ip_to_use | -n [-d] [-s] [-m] [-r ip_addr] [-p port] [-k dpdk_port] [-a ip_addr] [-t tags]\n\n"
+    printf("Usage: Pcap++Test -i ip_to_use | -n [-d] [-s] [-m] [-r ip_addr] [-p port] [-k dpdk_port] [-e eal_arg]... [-a ip_addr] [-t tags]\n\n"
     		"Flags:\n"
     		"-i --use-ip              IP to use for sending and receiving packets\n"
     		"-d --debug-mode          Set log level to DEBUG\n"
     		"-r --remote-ip	          IP of remote machine running rpcapd to test remote capture\n"
     		"-p --remote-port         Port of remote machine running rpcapd to test remote capture\n"
     		"-k --dpdk-port           The DPDK NIC port to test. Required if compiling with DPDK\n"
+    		"-e --dpdk-eal-arg        An additional DPDK EAL argument, can be given multiple times. For example:\n"
+    		"                         '-e --no-huge -e --vdev=net_ring0' to run DPDK tests without a NIC bound to DPDK\n"
     		"-n --no-networking       Do not run tests that requires networking\n"
 			"-v --verbose             Run in verbose mode (emits more output in several tests)\n"
 			"-m --mem-verbose         Output information about each memory allocation and deallocation\n"			
@@ -6763,7 +8992,7 @@ int main(int argc, char* argv[])
 
 	int optionIndex = 0;
 	char opt = 0;
-	while((opt = getopt_long (argc, argv, "di:r:p:k:a:nvmst:", PcapTestOptions, &optionIndex)) != -1)
+	while((opt = getopt_long (argc, argv, "di:r:p:k:e:a:nvmst:", PcapTestOptions, &optionIndex)) != -1)
 	{
 		switch (opt)
 		{
@@ -6787,6 +9016,9 @@ int main(int argc, char* argv[])
 			case 'k':
 				PcapGlobalArgs.dpdkPort = (int)atoi(optarg);
 				break;
+			case 'e':
+				PcapGlobalArgs.dpdkEalArgs.push_back(optarg);
+				break;
 			case 'n':
 				runWithNetworking = false;
 				break;
@@ -6883,6 +9115,11 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapFileAppend, "no_network;pcap");
 	PTF_RUN_TEST(TestPcapNgFileReadWrite, "no_network;pcap;pcapng");
 	PTF_RUN_TEST(TestPcapNgFileReadWriteAdv, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapFileReaderSampling, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapFileReaderStatefulFilter, "no_network;pcap;filters");
+	PTF_RUN_TEST(TestPcapFileIndex, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestPcapFileIndexChunks, "no_network;pcap;pcapng");
+	PTF_RUN_TEST(TestToeplitzHash, "no_network;rss");
 	PTF_RUN_TEST(TestPcapLiveDeviceList, "no_network;live_device;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapLiveDeviceListSearch, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDevice, "live_device");
@@ -6890,11 +9127,17 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestPcapLiveDeviceStatsMode, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceBlockingMode, "live_device");
 	PTF_RUN_TEST(TestPcapLiveDeviceSpecialCfg, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceBurstMode, "live_device");
+	PTF_RUN_TEST(TestPcapLiveDeviceWorkersMode, "live_device");
 	PTF_RUN_TEST(TestWinPcapLiveDevice, "live_device;winpcap");
 	PTF_RUN_TEST(TestPcapLiveDeviceByInvalidIp, "no_network;live_device");
 	PTF_RUN_TEST(TestPcapFiltersLive, "filters");
 	PTF_RUN_TEST(TestPcapFilters_General_BPFStr, "no_network;filters;skip_mem_leak_check");
 	PTF_RUN_TEST(TestPcapFiltersOffline, "no_network;filters");
+	PTF_RUN_TEST(TestPcapFiltersNative, "no_network;filters");
+	PTF_RUN_TEST(TestPcapFiltersSet, "no_network;filters");
+	PTF_RUN_TEST(TestPcapFiltersJit, "no_network;filters");
+	PTF_RUN_TEST(TestPcapFiltersDifferential, "no_network;filters");
 	PTF_RUN_TEST(TestSendPacket, "send");
 	PTF_RUN_TEST(TestSendPackets, "send");
 	PTF_RUN_TEST(TestRemoteCapture, "remote_capture;winpcap");
@@ -6916,7 +9159,12 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestKniDevice, "dpdk;kni");
 	PTF_RUN_TEST(TestKniDeviceSendReceive, "dpdk;kni");
 	PTF_RUN_TEST(TestDpdkMbufRawPacket, "dpdk");
+	PTF_RUN_TEST(TestDpdkMbufRawPacketChained, "dpdk");
+	PTF_RUN_TEST(TestDpdkTxContext, "dpdk");
 	PTF_RUN_TEST(TestDpdkDeviceWorkerThreads, "dpdk");
+	PTF_RUN_TEST(TestDpdkDeviceFilter, "dpdk");
+	PTF_RUN_TEST(TestDpdkDeviceNumaPlacement, "dpdk");
+	PTF_RUN_TEST(TestDpdkPipeline, "dpdk");
 	PTF_RUN_TEST(TestGetMacAddress, "mac");
 	PTF_RUN_TEST(TestTcpReassemblySanity, "no_network;tcp_reassembly");
 	PTF_RUN_TEST(TestTcpReassemblyRetran, "no_network;tcp_reassembly");
@@ -6937,8 +9185,10 @@ int main(int argc, char* argv[])
 	PTF_RUN_TEST(TestIPFragMapOverflow, "no_network;ip_frag");
 	PTF_RUN_TEST(TestIPFragRemove, "no_network;ip_frag");
 	PTF_RUN_TEST(TestRawSockets, "raw_sockets");
+	PTF_RUN_TEST(TestRawSocketKernelFilter, "raw_sockets");
 	PTF_RUN_TEST(TestLRUList, "no_network");
 	PTF_RUN_TEST(TestGeneralUtils, "no_network");
+	PTF_RUN_TEST(TestCoreMask, "no_network");
 
 	PTF_END_RUNNING_TESTS;
 }
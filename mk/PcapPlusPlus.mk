@@ -0,0 +1,33 @@
+PCAPPLUSPLUS_HOME := /root/repo
+
+### COMMON ###
+
+# includes
+PCAPPP_INCLUDES := -I$(PCAPPLUSPLUS_HOME)/Dist/header
+
+# libs dir
+PCAPPP_LIBS_DIR := -L$(PCAPPLUSPLUS_HOME)/Dist
+
+# libs
+PCAPPP_LIBS := -lPcap++ -lPacket++ -lCommon++
+
+# post build
+PCAPPP_POST_BUILD :=
+
+# build flags
+PCAPPP_BUILD_FLAGS :=
+
+ifdef PCAPPP_ENABLE_CPP_FEATURE_DETECTION
+	PCAPPP_BUILD_FLAGS += -DPCAPPP_CPP_FEATURE_DETECTION -std=c++11 
+endif
+### LINUX ###
+
+# includes
+PCAPPP_INCLUDES += -I/usr/include/netinet
+
+# libs
+PCAPPP_LIBS += -lpcap -lpthread
+
+# allow user to add custom LDFLAGS
+PCAPPP_BUILD_FLAGS += $(LDFLAGS)
+
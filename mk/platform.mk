@@ -0,0 +1,26 @@
+LINUX := 1
+
+BIN_EXT :=
+
+LIB_PREFIX := lib
+
+LIB_EXT := .a
+
+CXX := g++
+
+CC := gcc
+
+AR := ar
+
+RM := rm
+
+CP := cp
+
+MKDIR := mkdir
+
+INSTALL_SCRIPT := install.sh
+
+UNINSTALL_SCRIPT := uninstall.sh
+
+
+PCAPPLUSPLUS_HOME := /root/repo